@@ -57,7 +57,8 @@ public:
       return;
     }
 
-    bpm_.init(make_unique<VacuousDoubleWriteBuffer>());
+    bpm_ = CreateBufferPoolManager(state);
+    bpm_->init(make_unique<VacuousDoubleWriteBuffer>());
 
     string log_name       = this->Name() + ".log";
     string btree_filename = this->Name() + ".btree";
@@ -71,7 +72,7 @@ public:
     const char *filename = btree_filename.c_str();
 
     RC rc = handler_.create(
-        log_handler_, bpm_, filename, AttrType::INTS, sizeof(int32_t) /*attr_len*/, internal_max_size, leaf_max_size);
+        log_handler_, *bpm_, filename, AttrType::INTS, sizeof(int32_t) /*attr_len*/, internal_max_size, leaf_max_size);
     if (rc != RC::SUCCESS) {
       throw runtime_error("failed to create btree handler");
     }
@@ -86,12 +87,18 @@ public:
     }
 
     handler_.close();
+    bpm_.reset();
     LOG_INFO("test %s teardown done. threads=%d, thread index=%d",
         this->Name().c_str(),
         state.threads(),
         state.thread_index());
   }
 
+  virtual unique_ptr<BufferPoolManager> CreateBufferPoolManager(const State &state)
+  {
+    return make_unique<BufferPoolManager>(512);
+  }
+
   void FillUp(uint32_t min, uint32_t max)
   {
     for (uint32_t value = min; value < max; ++value) {
@@ -181,9 +188,9 @@ public:
   }
 
 protected:
-  BufferPoolManager bpm_{512};
-  BplusTreeHandler  handler_;
-  VacuousLogHandler log_handler_;
+  unique_ptr<BufferPoolManager> bpm_;
+  BplusTreeHandler              handler_;
+  VacuousLogHandler             log_handler_;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -294,6 +301,111 @@ BENCHMARK_REGISTER_F(ScanBenchmark, Scan)->Threads(10)->Arg(4 * 10000);
 
 ////////////////////////////////////////////////////////////////////////////////
 
+/**
+ * @brief 测试页帧管理器分片的扩展性
+ * @details 内存足够放下所有的页面，每次查询都会命中缓存，主要的开销是在页帧管理器中查找页面。
+ * 参数是数据量和页帧管理器的分片个数，分别使用不同的线程数运行，可以看到吞吐量随线程数的变化。
+ */
+class LookupBenchmark : public BenchmarkBase
+{
+public:
+  string Name() const override { return "lookup"; }
+
+  unique_ptr<BufferPoolManager> CreateBufferPoolManager(const State &state) override
+  {
+    const int memory_size = 64 * 1024 * 1024;
+    return make_unique<BufferPoolManager>(memory_size, static_cast<int>(state.range(1)));
+  }
+
+  void SetUp(const State &state) override
+  {
+    if (0 != state.thread_index()) {
+      return;
+    }
+
+    BenchmarkBase::SetUp(state);
+
+    uint32_t max = GetRangeMax(state);
+    ASSERT(max > 0, "invalid argument count. %ld", state.range(0));
+    FillUp(0, max);
+  }
+};
+
+BENCHMARK_DEFINE_F(LookupBenchmark, Lookup)(State &state)
+{
+  IntegerGenerator generator(0, GetRangeMax(state) - 1);
+  Stat             stat;
+
+  for (auto _ : state) {
+    uint32_t value = static_cast<uint32_t>(generator.next());
+    Scan(value, value, stat);
+  }
+
+  state.counters["success"]  = Counter(stat.scan_success_count, Counter::kIsRate);
+  state.counters["mismatch"] = Counter(stat.mismatch_count, Counter::kIsRate);
+  state.counters["other"]    = Counter(stat.scan_open_failed_count + stat.scan_other_count, Counter::kIsRate);
+}
+
+BENCHMARK_REGISTER_F(LookupBenchmark, Lookup)
+    ->ArgsProduct({{4 * 10000}, {1, BPFrameManager::DEFAULT_SHARD_NUM}})
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief 测试只读操作使用乐观读时的扩展性
+ * @details 参数是数据量和是否使用乐观读。加锁的方式下每次查找都要对根节点和经过的内部节点加读锁，
+ * 线程多时这几把锁就成了热点；乐观读只对叶子节点加锁，对比两种方式下吞吐量随线程数的变化。
+ */
+class OptimisticReadBenchmark : public BenchmarkBase
+{
+public:
+  string Name() const override { return "optimistic_read"; }
+
+  unique_ptr<BufferPoolManager> CreateBufferPoolManager(const State &state) override
+  {
+    const int memory_size = 64 * 1024 * 1024;
+    return make_unique<BufferPoolManager>(memory_size);
+  }
+
+  void SetUp(const State &state) override
+  {
+    if (0 != state.thread_index()) {
+      return;
+    }
+
+    BenchmarkBase::SetUp(state);
+    handler_.set_optimistic_read(state.range(1) != 0);
+
+    uint32_t max = GetRangeMax(state);
+    ASSERT(max > 0, "invalid argument count. %ld", state.range(0));
+    FillUp(0, max);
+  }
+};
+
+BENCHMARK_DEFINE_F(OptimisticReadBenchmark, Lookup)(State &state)
+{
+  IntegerGenerator generator(0, GetRangeMax(state) - 1);
+  Stat             stat;
+
+  for (auto _ : state) {
+    uint32_t value = static_cast<uint32_t>(generator.next());
+    Scan(value, value, stat);
+  }
+
+  state.counters["success"]  = Counter(stat.scan_success_count, Counter::kIsRate);
+  state.counters["mismatch"] = Counter(stat.mismatch_count, Counter::kIsRate);
+  state.counters["other"]    = Counter(stat.scan_open_failed_count + stat.scan_other_count, Counter::kIsRate);
+}
+
+BENCHMARK_REGISTER_F(OptimisticReadBenchmark, Lookup)
+    ->ArgsProduct({{4 * 10000}, {0, 1}})
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+
+////////////////////////////////////////////////////////////////////////////////
+
 struct MixtureBenchmark : public BenchmarkBase
 {
   string Name() const override { return "mixture"; }
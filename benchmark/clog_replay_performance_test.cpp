@@ -0,0 +1,187 @@
+/* Copyright (c) 2021-2022 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <benchmark/benchmark.h>
+
+#include "common/lang/filesystem.h"
+#include "common/lang/stdexcept.h"
+#include "common/log/log.h"
+#include "storage/buffer/disk_buffer_pool.h"
+#include "storage/buffer/double_write_buffer.h"
+#include "storage/clog/disk_log_handler.h"
+#include "storage/clog/integrated_log_replayer.h"
+#include "storage/record/record_manager.h"
+#include "storage/trx/vacuous_trx.h"
+
+using namespace std;
+using namespace common;
+using namespace benchmark;
+
+/**
+ * @brief 测试重启时回放日志的耗时
+ * @details 先在多个数据文件中插入数据并记录日志，然后模拟数据页都没有落盘就崩溃的场景，
+ * 分别使用不同的线程数回放日志。
+ */
+class ClogReplayBenchmark : public Fixture
+{
+public:
+  static constexpr int FILE_NUM        = 8;
+  static constexpr int RECORD_PER_FILE = 20000;
+
+  struct TestRecord
+  {
+    int32_t int_fields[15];
+  };
+
+  void SetUp(const State &state) override
+  {
+    if (prepared_) {
+      return;
+    }
+
+    LoggerFactory::init_default("clog_replay_performance_test.log", LOG_LEVEL_INFO);
+
+    filesystem::remove_all(test_path_);
+    filesystem::create_directories(test_path_ / "origin");
+
+    BufferPoolManager bpm;
+    bpm.init(make_unique<VacuousDoubleWriteBuffer>());
+
+    DiskLogHandler        log_handler;
+    VacuousTrxLogReplayer trx_replayer;
+    check(log_handler.init(clog_path().c_str()), "failed to init log handler");
+    check(log_handler.replay(trx_replayer, 0), "failed to replay log");
+    check(log_handler.start(), "failed to start log handler");
+
+    vector<DiskBufferPool *>    buffer_pools;
+    vector<RecordFileHandler *> record_handlers;
+    for (int i = 0; i < FILE_NUM; i++) {
+      string filename = file_path(i);
+      check(bpm.create_file(filename.c_str()), "failed to create file");
+
+      // 保存刚创建的文件，回放前用它来模拟数据页都没有落盘的场景
+      filesystem::copy_file(filename, origin_file_path(i));
+
+      DiskBufferPool *buffer_pool = nullptr;
+      check(bpm.open_file(log_handler, filename.c_str(), buffer_pool), "failed to open file");
+      auto handler = new RecordFileHandler(StorageFormat::ROW_FORMAT);
+      check(handler->init(*buffer_pool, log_handler, nullptr), "failed to init record file handler");
+
+      buffer_pools.push_back(buffer_pool);
+      record_handlers.push_back(handler);
+    }
+
+    TestRecord record;
+    RID        rid;
+    for (int i = 0; i < RECORD_PER_FILE; i++) {
+      for (int f = 0; f < FILE_NUM; f++) {
+        record.int_fields[0] = i;
+        check(record_handlers[f]->insert_record(reinterpret_cast<const char *>(&record), sizeof(record), &rid),
+            "failed to insert record");
+      }
+    }
+
+    check(log_handler.stop(), "failed to stop log handler");
+    check(log_handler.await_termination(), "failed to wait log handler");
+
+    for (int i = 0; i < FILE_NUM; i++) {
+      record_handlers[i]->close();
+      delete record_handlers[i];
+      buffer_pools[i]->close_file();
+      bpm.close_file(file_path(i).c_str());
+      file_sizes_[i] = filesystem::file_size(file_path(i));
+    }
+
+    prepared_ = true;
+  }
+
+  /// 恢复到没有数据页落盘的状态。文件大小保持不变，与真实崩溃时的情况一致
+  void ResetFiles()
+  {
+    for (int i = 0; i < FILE_NUM; i++) {
+      filesystem::copy_file(origin_file_path(i), file_path(i), filesystem::copy_options::overwrite_existing);
+      filesystem::resize_file(file_path(i), file_sizes_[i]);
+    }
+  }
+
+  void Replay(int worker_num)
+  {
+    bpm_ = make_unique<BufferPoolManager>();
+    bpm_->init(make_unique<VacuousDoubleWriteBuffer>());
+
+    // 页面刷盘时会检查日志是否落盘，所以日志处理器要在文件关闭后才能销毁
+    log_handler_ = make_unique<DiskLogHandler>();
+    buffer_pools_.clear();
+    for (int i = 0; i < FILE_NUM; i++) {
+      DiskBufferPool *buffer_pool = nullptr;
+      check(bpm_->open_file(*log_handler_, file_path(i).c_str(), buffer_pool), "failed to open file");
+      buffer_pools_.push_back(buffer_pool);
+    }
+
+    IntegratedLogReplayer replayer(*bpm_, make_unique<VacuousTrxLogReplayer>(), worker_num);
+    check(log_handler_->init(clog_path().c_str()), "failed to init log handler");
+    check(log_handler_->replay(replayer, 0), "failed to replay log");
+    check(replayer.on_done(), "failed to replay log");
+  }
+
+  void CloseFiles()
+  {
+    for (int i = 0; i < FILE_NUM; i++) {
+      buffer_pools_[i]->close_file();
+      bpm_->close_file(file_path(i).c_str());
+    }
+    buffer_pools_.clear();
+    bpm_.reset();
+    log_handler_.reset();
+  }
+
+private:
+  static void check(RC rc, const char *message)
+  {
+    if (OB_FAIL(rc)) {
+      throw runtime_error(string(message) + ". rc=" + strrc(rc));
+    }
+  }
+
+  string clog_path() const { return (test_path_ / "clog").string(); }
+  string file_path(int i) const { return (test_path_ / ("data_" + to_string(i) + ".bp")).string(); }
+  string origin_file_path(int i) const { return (test_path_ / "origin" / ("data_" + to_string(i) + ".bp")).string(); }
+
+private:
+  static inline bool             prepared_ = false;
+  static inline filesystem::path test_path_{"clog_replay_performance_test"};
+  static inline uintmax_t        file_sizes_[FILE_NUM];
+
+  unique_ptr<BufferPoolManager> bpm_;
+  unique_ptr<DiskLogHandler>    log_handler_;
+  vector<DiskBufferPool *>      buffer_pools_;
+};
+
+BENCHMARK_DEFINE_F(ClogReplayBenchmark, Replay)(State &state)
+{
+  const int worker_num = static_cast<int>(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    ResetFiles();
+    state.ResumeTiming();
+
+    Replay(worker_num);
+
+    // 关闭文件时会把页面刷到磁盘，不计入回放时间
+    state.PauseTiming();
+    CloseFiles();
+    state.ResumeTiming();
+  }
+}
+
+// 参数是回放线程数，0表示串行回放
+BENCHMARK_REGISTER_F(ClogReplayBenchmark, Replay)->Arg(0)->Arg(2)->Arg(4)->Arg(8)->Unit(kMillisecond);
+
+BENCHMARK_MAIN();
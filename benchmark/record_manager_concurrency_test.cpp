@@ -84,7 +84,8 @@ public:
       return;
     }
 
-    bpm_.init(make_unique<VacuousDoubleWriteBuffer>());
+    bpm_ = CreateBufferPoolManager(state);
+    bpm_->init(make_unique<VacuousDoubleWriteBuffer>());
 
     string log_name        = this->Name() + ".log";
     string record_filename = this->record_filename();
@@ -92,13 +93,13 @@ public:
 
     ::remove(record_filename.c_str());
 
-    RC rc = bpm_.create_file(record_filename.c_str());
+    RC rc = bpm_->create_file(record_filename.c_str());
     if (rc != RC::SUCCESS) {
       LOG_WARN("failed to create record buffer pool file. filename=%s, rc=%s", record_filename.c_str(), strrc(rc));
       throw runtime_error("failed to create record buffer pool file.");
     }
 
-    rc = bpm_.open_file(log_handler_, record_filename.c_str(), buffer_pool_);
+    rc = bpm_->open_file(log_handler_, record_filename.c_str(), buffer_pool_);
     if (rc != RC::SUCCESS) {
       LOG_WARN("failed to open record file. filename=%s, rc=%s", record_filename.c_str(), strrc(rc));
       throw runtime_error("failed to open record file");
@@ -126,14 +127,20 @@ public:
     // TODO 很怪，引入double write buffer后，必须要求先close buffer pool，再执行bpm.close_file。
     // 以后必须修理好bpm、buffer pool、double write buffer之间的关系
     buffer_pool_->close_file();
-    bpm_.close_file(this->record_filename().c_str());
+    bpm_->close_file(this->record_filename().c_str());
     buffer_pool_ = nullptr;
+    bpm_.reset();
     LOG_INFO("test %s teardown done. threads=%d, thread index=%d",
         this->Name().c_str(),
         state.threads(),
         state.thread_index());
   }
 
+  virtual unique_ptr<BufferPoolManager> CreateBufferPoolManager(const State &state)
+  {
+    return make_unique<BufferPoolManager>(512);
+  }
+
   void FillUp(int32_t min, int32_t max, vector<RID> &rids)
   {
     rids.reserve(max - min);
@@ -229,10 +236,10 @@ public:
   }
 
 protected:
-  BufferPoolManager  bpm_{512};
-  DiskBufferPool    *buffer_pool_ = nullptr;
-  RecordFileHandler *handler_;
-  VacuousLogHandler  log_handler_;
+  unique_ptr<BufferPoolManager> bpm_;
+  DiskBufferPool               *buffer_pool_ = nullptr;
+  RecordFileHandler            *handler_;
+  VacuousLogHandler             log_handler_;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -311,6 +318,228 @@ BENCHMARK_REGISTER_F(DeletionBenchmark, Deletion)->Threads(10)->Arg(4 * 10000);
 
 ////////////////////////////////////////////////////////////////////////////////
 
+/**
+ * @brief 测试页帧管理器分片的扩展性
+ * @details 内存足够放下所有的页面，按照RID随机读取记录，每次都会命中缓存。
+ * 参数是数据量和页帧管理器的分片个数，分别使用不同的线程数运行，可以看到吞吐量随线程数的变化。
+ */
+class FetchBenchmark : public BenchmarkBase
+{
+public:
+  string Name() const override { return "fetch"; }
+
+  unique_ptr<BufferPoolManager> CreateBufferPoolManager(const State &state) override
+  {
+    const int memory_size = 64 * 1024 * 1024;
+    return make_unique<BufferPoolManager>(memory_size, static_cast<int>(state.range(1)));
+  }
+
+  void SetUp(const State &state) override
+  {
+    if (0 != state.thread_index()) {
+      while (!setup_done_) {
+        this_thread::sleep_for(chrono::milliseconds(100));
+      }
+      return;
+    }
+
+    BenchmarkBase::SetUp(state);
+
+    uint32_t max = GetRangeMax(state);
+    ASSERT(max > 0, "invalid argument count. %ld", state.range(0));
+    rids_.clear();
+    FillUp(0, max, rids_);
+    setup_done_ = true;
+  }
+
+  void TearDown(const State &state) override
+  {
+    if (0 != state.thread_index()) {
+      return;
+    }
+
+    BenchmarkBase::TearDown(state);
+    // 同一个对象会按照不同的参数运行多次
+    setup_done_ = false;
+  }
+
+protected:
+  volatile bool setup_done_ = false;
+  vector<RID>   rids_;
+};
+
+BENCHMARK_DEFINE_F(FetchBenchmark, Fetch)(State &state)
+{
+  IntegerGenerator generator(0, static_cast<int>(rids_.size() - 1));
+  int64_t          success_count = 0;
+  int64_t          other_count   = 0;
+
+  Record record;
+  for (auto _ : state) {
+    RC rc = handler_->get_record(rids_[generator.next()], record);
+    if (OB_SUCC(rc)) {
+      success_count++;
+    } else {
+      other_count++;
+    }
+  }
+
+  state.counters["success"] = Counter(success_count, Counter::kIsRate);
+  state.counters["other"]   = Counter(other_count, Counter::kIsRate);
+}
+
+BENCHMARK_REGISTER_F(FetchBenchmark, Fetch)
+    ->ArgsProduct({{4 * 10000}, {1, BPFrameManager::DEFAULT_SHARD_NUM}})
+    ->ThreadRange(1, 16)
+    ->UseRealTime();
+
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief 测试全表扫描对热点页面的影响
+ * @details 页帧只能放下一部分数据。第0个线程不停地做全表扫描，其它线程按照RID随机读取少量热点页面上的记录。
+ * 参数是数据量和页帧的置换策略，输出缓存命中率。使用LRU时，全表扫描会把热点页面挤出去，命中率会明显下降。
+ */
+class ScanResistanceBenchmark : public BenchmarkBase
+{
+public:
+  static constexpr const char *REPLACERS[] = {"lru", "2q"};
+
+  /// 热点页面的个数，是页帧个数的四分之一
+  static constexpr int HOT_PAGE_NUM = DEFAULT_ITEM_NUM_PER_POOL / 4;
+
+public:
+  string Name() const override { return "scan_resistance"; }
+
+  unique_ptr<BufferPoolManager> CreateBufferPoolManager(const State &state) override
+  {
+    const int memory_size = DEFAULT_ITEM_NUM_PER_POOL * BP_PAGE_SIZE;
+    return make_unique<BufferPoolManager>(
+        memory_size, BPFrameManager::DEFAULT_SHARD_NUM, REPLACERS[state.range(1)]);
+  }
+
+  void SetUp(const State &state) override
+  {
+    if (0 != state.thread_index()) {
+      while (!setup_done_) {
+        this_thread::sleep_for(chrono::milliseconds(100));
+      }
+      return;
+    }
+
+    BenchmarkBase::SetUp(state);
+
+    uint32_t max = GetRangeMax(state);
+    ASSERT(max > 0, "invalid argument count. %ld", state.range(0));
+    vector<RID> rids;
+    FillUp(0, max, rids);
+
+    hot_rids_.clear();
+    for (const RID &rid : rids) {
+      if (rid.page_num <= HOT_PAGE_NUM) {
+        hot_rids_.push_back(rid);
+      }
+    }
+    ASSERT(!hot_rids_.empty(), "no records on hot pages");
+
+    BPFrameManager &frame_manager = bpm_->get_frame_manager();
+    hit_count_                    = frame_manager.hit_count();
+    miss_count_                   = frame_manager.miss_count();
+    setup_done_                   = true;
+  }
+
+  void TearDown(const State &state) override
+  {
+    if (0 != state.thread_index()) {
+      return;
+    }
+
+    BenchmarkBase::TearDown(state);
+    setup_done_ = false;
+  }
+
+  /**
+   * @brief 按顺序扫描下一个页面上的所有记录，扫描到最后时从头再来
+   * @details 与 RecordFileScanner 一样逐个页面地访问，但是每次迭代结束时不持有页面的latch，
+   * 否则其它线程在等待latch时，这个线程会在迭代结束时等待其它线程，导致死锁
+   */
+  void ScanPage(BufferPoolIterator &bp_iterator, Stat &stat)
+  {
+    if (!bp_iterator.has_next()) {
+      bp_iterator.init(*buffer_pool_, 1);
+    }
+
+    unique_ptr<RecordPageHandler> page_handler(RecordPageHandler::create(StorageFormat::ROW_FORMAT));
+    RC rc = page_handler->init(*buffer_pool_, log_handler_, bp_iterator.next(), ReadWriteMode::READ_ONLY);
+    if (OB_FAIL(rc)) {
+      stat.scan_open_failed_count++;
+      return;
+    }
+
+    RecordPageIterator record_iterator;
+    record_iterator.init(page_handler.get());
+
+    Record record;
+    while (record_iterator.has_next()) {
+      if (OB_SUCC(record_iterator.next(record))) {
+        stat.scan_success_count++;
+      } else {
+        stat.scan_other_count++;
+      }
+    }
+  }
+
+protected:
+  volatile bool setup_done_ = false;
+  vector<RID>   hot_rids_;
+  int64_t       hit_count_  = 0;
+  int64_t       miss_count_ = 0;
+};
+
+BENCHMARK_DEFINE_F(ScanResistanceBenchmark, ScanResistance)(State &state)
+{
+  Stat stat;
+
+  if (0 == state.thread_index()) {
+    BufferPoolIterator bp_iterator;
+    bp_iterator.init(*buffer_pool_, 1);
+    for (auto _ : state) {
+      ScanPage(bp_iterator, stat);
+    }
+
+    BPFrameManager &frame_manager = bpm_->get_frame_manager();
+    const int64_t   hit_count     = frame_manager.hit_count() - hit_count_;
+    const int64_t   miss_count    = frame_manager.miss_count() - miss_count_;
+    state.counters["hit_ratio"]   = hit_count + miss_count == 0 ? 0 : double(hit_count) / (hit_count + miss_count);
+    state.counters["scan"]        = Counter(stat.scan_success_count, Counter::kIsRate);
+    state.counters["scan_other"]  = Counter(stat.scan_other_count + stat.scan_open_failed_count, Counter::kIsRate);
+  } else {
+    IntegerGenerator generator(0, static_cast<int>(hot_rids_.size() - 1));
+    int64_t          success_count = 0;
+    int64_t          other_count   = 0;
+
+    Record record;
+    for (auto _ : state) {
+      RC rc = handler_->get_record(hot_rids_[generator.next()], record);
+      if (OB_SUCC(rc)) {
+        success_count++;
+      } else {
+        other_count++;
+      }
+    }
+
+    state.counters["lookup"]       = Counter(success_count, Counter::kIsRate);
+    state.counters["lookup_other"] = Counter(other_count, Counter::kIsRate);
+  }
+}
+
+BENCHMARK_REGISTER_F(ScanResistanceBenchmark, ScanResistance)
+    ->ArgsProduct({{4 * 10000}, {0, 1}})
+    ->Threads(4)
+    ->UseRealTime();
+
+////////////////////////////////////////////////////////////////////////////////
+
 class ScanBenchmark : public BenchmarkBase
 {
 public:
@@ -14,6 +14,7 @@ See the Mulan PSL v2 for more details. */
 
 #include <dirent.h>
 #include <iostream>
+#include <limits.h>
 #include <stdio.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -386,4 +387,33 @@ int readn(int fd, void *buf, int size)
   }
   return 0;
 }
+
+int pwritevn(int fd, struct iovec *iov, int iovcnt, off_t offset)
+{
+  while (iovcnt > 0) {
+    const int     batch = iovcnt < IOV_MAX ? iovcnt : IOV_MAX;
+    const ssize_t ret   = ::pwritev(fd, iov, batch, offset);
+    if (ret < 0) {
+      const int err = errno;
+      if (EAGAIN != err && EINTR != err)
+        return err;
+      continue;
+    }
+
+    offset += ret;
+
+    // 跳过已经写完的数据段，调整只写了一部分的数据段
+    size_t left = static_cast<size_t>(ret);
+    while (iovcnt > 0 && left >= iov->iov_len) {
+      left -= iov->iov_len;
+      ++iov;
+      --iovcnt;
+    }
+    if (left > 0) {
+      iov->iov_base = static_cast<char *>(iov->iov_base) + left;
+      iov->iov_len -= left;
+    }
+  }
+  return 0;
+}
 }  // namespace common
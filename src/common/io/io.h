@@ -14,6 +14,7 @@ See the Mulan PSL v2 for more details. */
 
 #pragma once
 
+#include <sys/uio.h>
 #include <vector>
 
 #include "common/defs.h"
@@ -77,4 +78,15 @@ int writen(int fd, const void *buf, int size);
  */
 int readn(int fd, void *buf, int size);
 
+/**
+ * @brief 从指定偏移开始，一次性写入多段数据
+ * @details 使用pwritev批量写入，会处理部分写入和IOV_MAX的限制。
+ * @param fd     写入的描述符
+ * @param iov    写入的数据段。写入过程中会修改这个数组的内容
+ * @param iovcnt 数据段个数
+ * @param offset 从文件的哪个位置开始写
+ * @return int 0 表示成功，否则返回errno
+ */
+int pwritevn(int fd, struct iovec *iov, int iovcnt, off_t offset);
+
 }  // namespace common
@@ -35,7 +35,9 @@ using std::lock_guard;
 using std::mutex;
 using std::once_flag;
 using std::scoped_lock;
+using std::shared_lock;
 using std::shared_mutex;
+using std::try_to_lock;
 using std::unique_lock;
 
 namespace common {
@@ -317,6 +319,7 @@ public:
   void unlock_shared();
 
   void lock();
+  bool try_lock();
   void unlock();
 
 private:
@@ -25,3 +25,24 @@ See the Mulan PSL v2 for more details. */
 #define SOCKET_BUFFER_SIZE 8192
 
 #define SESSION_STAGE_NAME "SessionStage"
+
+//! 存储引擎相关的配置项都放在这个section中
+#define STORAGE "STORAGE"
+//! 重启恢复时并行回放日志的线程数，不大于1时串行回放
+#define CLOG_REPLAY_THREADS "CLOG_REPLAY_THREADS"
+#define CLOG_REPLAY_THREADS_DEFAULT 0
+//! 后台做模糊检查点的间隔，单位秒。不大于0时不做检查点，只有sync时才会推进检查点
+#define CHECKPOINT_INTERVAL "CHECKPOINT_INTERVAL"
+#define CHECKPOINT_INTERVAL_DEFAULT 60
+//! 后台刷脏线程需要保持的空闲页帧与干净页帧的个数。不大于0时不启动刷脏线程
+#define PAGE_CLEANER_WATERMARK "PAGE_CLEANER_WATERMARK"
+#define PAGE_CLEANER_WATERMARK_DEFAULT 128
+//! 页帧的置换策略。lru 或者 2q，2q 可以避免全表扫描把热点页面淘汰掉
+#define BUFFER_POOL_REPLACER "BUFFER_POOL_REPLACER"
+#define BUFFER_POOL_REPLACER_DEFAULT "lru"
+//! 顺序扫描时每次预读多少个页面，不大于0时不预读
+#define READ_AHEAD_PAGES "READ_AHEAD_PAGES"
+#define READ_AHEAD_PAGES_DEFAULT 32
+//! 页面读写使用的IO后端。sync、thread_pool 或者 io_uring，io_uring 不可用时使用 thread_pool
+#define PAGE_IO_BACKEND "PAGE_IO_BACKEND"
+#define PAGE_IO_BACKEND_DEFAULT "io_uring"
@@ -42,13 +42,17 @@ enum class ReadWriteMode
 
 /**
  * @brief 存储格式
- * @details 当前仅支持行存格式（ROW_FORMAT）以及 PAX 存储格式(PAX_FORMAT)。
+ * @details 当前支持行存格式（ROW_FORMAT）、PAX 存储格式(PAX_FORMAT)，页面写满后
+ * 对每列做轻量级压缩的 PAX 存储格式(PAX_COMPRESSED_FORMAT)，以及在页面中按变长格式存放记录的
+ * 行存格式(SLOTTED_FORMAT)。
  */
 enum class StorageFormat
 {
   UNKNOWN_FORMAT = 0,
   ROW_FORMAT,
-  PAX_FORMAT
+  PAX_FORMAT,
+  PAX_COMPRESSED_FORMAT,
+  SLOTTED_FORMAT
 };
 
 /**
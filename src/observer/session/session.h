@@ -87,6 +87,12 @@ public:
 
   void set_used_chunk_mode(bool used_chunk_mode) { used_chunk_mode_ = used_chunk_mode; }
 
+  void set_parallel_scan_threads(int thread_num) { parallel_scan_threads_ = thread_num; }
+  int  parallel_scan_threads() const { return parallel_scan_threads_; }
+
+  void set_index_fill_factor(int fill_factor) { index_fill_factor_ = fill_factor; }
+  int  index_fill_factor() const { return index_fill_factor_; }
+
   /**
    * @brief 将指定会话设置到线程变量中
    *
@@ -113,4 +119,10 @@ private:
   bool used_chunk_mode_ = false;
 
   ExecutionMode execution_mode_ = ExecutionMode::TUPLE_ITERATOR;
+
+  // 只读的表扫描使用的线程个数，1 表示在当前线程中扫描。并行扫描时返回数据的顺序是不确定的
+  int parallel_scan_threads_ = 1;
+
+  // 在已有数据的表上创建索引时，批量构建的B+树节点填充的百分比。留一些空闲位置可以减少后续插入时的页面分裂
+  int index_fill_factor_ = 90;
 };
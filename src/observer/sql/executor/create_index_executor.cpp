@@ -32,5 +32,9 @@ RC CreateIndexExecutor::execute(SQLStageEvent *sql_event)
 
   Trx   *trx   = session->current_trx();
   Table *table = create_index_stmt->table();
-  return table->create_index(trx, create_index_stmt->field_meta(), create_index_stmt->index_name().c_str());
+  return table->create_index(trx,
+      create_index_stmt->field_metas(),
+      create_index_stmt->include_field_metas(),
+      create_index_stmt->index_name().c_str(),
+      session->index_fill_factor());
 }
\ No newline at end of file
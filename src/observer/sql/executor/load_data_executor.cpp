@@ -33,15 +33,16 @@ RC LoadDataExecutor::execute(SQLStageEvent *sql_event)
 }
 
 /**
- * 从文件中导入数据时使用。尝试向表中插入解析后的一行数据。
+ * 从文件中导入数据时使用。把解析后的一行数据转换成表中的一条记录。
  * @param table  要导入的表
  * @param file_values 从文件中读取到的一行数据，使用分隔符拆分后的几个字段值
- * @param record_values Table::insert_record使用的参数，为了防止频繁的申请内存
+ * @param record_values Table::make_record使用的参数，为了防止频繁的申请内存
+ * @param record 返回生成的记录
  * @param errmsg 如果出现错误，通过这个参数返回错误信息
  * @return 成功返回RC::SUCCESS
  */
-RC insert_record_from_file(
-    Table *table, vector<string> &file_values, vector<Value> &record_values, stringstream &errmsg)
+RC make_record_from_file(
+    Table *table, vector<string> &file_values, vector<Value> &record_values, Record &record, stringstream &errmsg)
 {
 
   const int field_num     = record_values.size();
@@ -65,17 +66,52 @@ RC insert_record_from_file(
   }
 
   if (RC::SUCCESS == rc) {
-    Record record;
     rc = table->make_record(field_num, record_values.data(), record);
     if (rc != RC::SUCCESS) {
       errmsg << "insert failed.";
-    } else if (RC::SUCCESS != (rc = table->insert_record(record))) {
-      errmsg << "insert failed.";
     }
   }
   return rc;
 }
 
+/**
+ * 把攒下的一批记录插入到表中。
+ * @details 批量插入失败时所有记录都会回滚，然后逐条插入，找到出错的那一行，并保留出错之前的数据，
+ * 与逐条导入的结果一致。
+ * @param records 要插入的记录，插入后清空
+ * @param line_nums 每条记录在文件中的行号，出错时用来返回错误信息
+ * @param insertion_count 插入成功的记录个数
+ * @param result_string 如果出现错误，通过这个参数返回错误信息
+ */
+static RC insert_records_from_file(Table *table, vector<Record> &records, vector<int> &line_nums,
+    int &insertion_count, stringstream &result_string)
+{
+  if (records.empty()) {
+    return RC::SUCCESS;
+  }
+
+  shared_lock<common::RecursiveSharedMutex> guard(table->latch());
+
+  RC rc = table->insert_records(records);
+  if (RC::SUCCESS == rc) {
+    insertion_count += static_cast<int>(records.size());
+  } else {
+    for (size_t i = 0; i < records.size(); i++) {
+      rc = table->insert_record(records[i]);
+      if (rc != RC::SUCCESS) {
+        result_string << "Line:" << line_nums[i] << " insert record failed:insert failed.. error:" << strrc(rc)
+                      << endl;
+        break;
+      }
+      insertion_count++;
+    }
+  }
+
+  records.clear();
+  line_nums.clear();
+  return rc;
+}
+
 void LoadDataExecutor::load_data(Table *table, const char *file_name, SqlResult *sql_result)
 {
   stringstream result_string;
@@ -101,6 +137,10 @@ void LoadDataExecutor::load_data(Table *table, const char *file_name, SqlResult
   int            line_num        = 0;
   int            insertion_count = 0;
   RC             rc              = RC::SUCCESS;
+  vector<Record> records;
+  vector<int>    line_nums;
+  records.reserve(LOAD_DATA_BATCH_SIZE);
+  line_nums.reserve(LOAD_DATA_BATCH_SIZE);
   while (!fs.eof() && RC::SUCCESS == rc) {
     getline(fs, line);
     line_num++;
@@ -111,13 +151,25 @@ void LoadDataExecutor::load_data(Table *table, const char *file_name, SqlResult
     file_values.clear();
     common::split_string(line, delim, file_values);
     stringstream errmsg;
-    rc = insert_record_from_file(table, file_values, record_values, errmsg);
+    Record       record;
+    rc = make_record_from_file(table, file_values, record_values, record, errmsg);
     if (rc != RC::SUCCESS) {
       result_string << "Line:" << line_num << " insert record failed:" << errmsg.str() << ". error:" << strrc(rc)
                     << endl;
-    } else {
-      insertion_count++;
+      break;
     }
+
+    records.emplace_back(std::move(record));
+    line_nums.push_back(line_num);
+    if (static_cast<int>(records.size()) >= LOAD_DATA_BATCH_SIZE) {
+      rc = insert_records_from_file(table, records, line_nums, insertion_count, result_string);
+    }
+  }
+
+  // 格式错误的行之前的数据仍然需要导入
+  RC rc2 = insert_records_from_file(table, records, line_nums, insertion_count, result_string);
+  if (RC::SUCCESS == rc) {
+    rc = rc2;
   }
   fs.close();
 
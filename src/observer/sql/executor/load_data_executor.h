@@ -33,5 +33,8 @@ public:
   RC execute(SQLStageEvent *sql_event);
 
 private:
+  /// 导入数据时，每攒够这么多条记录批量插入一次
+  static constexpr int LOAD_DATA_BATCH_SIZE = 256;
+
   void load_data(Table *table, const char *file_name, SqlResult *sql_result);
 };
@@ -34,6 +34,22 @@ RC SetVariableExecutor::execute(SQLStageEvent *sql_event)
     } else {
       rc = RC::INVALID_ARGUMENT;
     }
+  } else if (strcasecmp(var_name, "parallel_scan_threads") == 0) {
+    if (var_value.attr_type() == AttrType::INTS && var_value.get_int() >= 1 &&
+        var_value.get_int() <= MAX_PARALLEL_SCAN_THREADS) {
+      session->set_parallel_scan_threads(var_value.get_int());
+      LOG_TRACE("set parallel_scan_threads to %d", var_value.get_int());
+    } else {
+      rc = RC::VARIABLE_NOT_VALID;
+    }
+  } else if (strcasecmp(var_name, "index_fill_factor") == 0) {
+    if (var_value.attr_type() == AttrType::INTS && var_value.get_int() >= MIN_INDEX_FILL_FACTOR &&
+        var_value.get_int() <= MAX_INDEX_FILL_FACTOR) {
+      session->set_index_fill_factor(var_value.get_int());
+      LOG_TRACE("set index_fill_factor to %d", var_value.get_int());
+    } else {
+      rc = RC::VARIABLE_NOT_VALID;
+    }
   } else {
     rc = RC::VARIABLE_NOT_EXISTS;
   }
@@ -26,6 +26,14 @@ See the Mulan PSL v2 for more details. */
  */
 class SetVariableExecutor
 {
+public:
+  /// parallel_scan_threads 变量允许的最大值
+  static constexpr int MAX_PARALLEL_SCAN_THREADS = 64;
+
+  /// index_fill_factor 变量允许的最小值和最大值
+  static constexpr int MIN_INDEX_FILL_FACTOR = 50;
+  static constexpr int MAX_INDEX_FILL_FACTOR = 100;
+
 public:
   SetVariableExecutor()          = default;
   virtual ~SetVariableExecutor() = default;
@@ -0,0 +1,45 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "sql/executor/vacuum_executor.h"
+#include "common/log/log.h"
+#include "event/session_event.h"
+#include "event/sql_event.h"
+#include "session/session.h"
+#include "sql/stmt/vacuum_stmt.h"
+#include "storage/table/table.h"
+
+RC VacuumExecutor::execute(SQLStageEvent *sql_event)
+{
+  Stmt    *stmt    = sql_event->stmt();
+  Session *session = sql_event->session_event()->session();
+  ASSERT(stmt->type() == StmtType::VACUUM,
+      "vacuum executor can not run this command: %d",
+      static_cast<int>(stmt->type()));
+
+  VacuumStmt *vacuum_stmt = static_cast<VacuumStmt *>(stmt);
+  Table      *table       = vacuum_stmt->table();
+
+  // 当前事务可能还引用着记录原来的位置
+  if (session->is_trx_multi_operation_mode()) {
+    LOG_WARN("cannot vacuum table in a transaction. table=%s", table->name());
+    return RC::LOCKED_CONCURRENCY_CONFLICT;
+  }
+
+  int freed_pages = 0;
+  RC  rc          = table->compact(freed_pages);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to vacuum table. table=%s, rc=%s", table->name(), strrc(rc));
+    return rc;
+  }
+
+  LOG_INFO("vacuum table done. table=%s, freed pages=%d", table->name(), freed_pages);
+  return rc;
+}
@@ -0,0 +1,30 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include "common/sys/rc.h"
+
+class SQLStageEvent;
+
+/**
+ * @brief 整理表数据文件的执行器
+ * @ingroup Executor
+ * @details 合并稀疏的页面并释放空的页面，参考 Table::compact。
+ * 记录的位置会改变，在显式开启的事务中或者表正在被其它语句访问时不能执行
+ */
+class VacuumExecutor
+{
+public:
+  VacuumExecutor()          = default;
+  virtual ~VacuumExecutor() = default;
+
+  RC execute(SQLStageEvent *sql_event);
+};
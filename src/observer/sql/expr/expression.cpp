@@ -72,14 +72,19 @@ bool FieldExpr::equal(const Expression &other) const
   return table_name() == other_field_expr.table_name() && field_name() == other_field_expr.field_name();
 }
 
-// TODO: 在进行表达式计算时，`chunk` 包含了所有列，因此可以通过 `field_id` 获取到对应列。
-// 后续可以优化成在 `FieldExpr` 中存储 `chunk` 中某列的位置信息。
+// 表扫描只会返回用到的列(参考 ProjectionPushdown)，所以要根据 chunk 中的列ID查找 `field_id` 对应的列。
+// TODO: 后续可以优化成在 `FieldExpr` 中存储 `chunk` 中某列的位置信息。
 RC FieldExpr::get_column(Chunk &chunk, Column &column)
 {
   if (pos_ != -1) {
     column.reference(chunk.column(pos_));
   } else {
-    column.reference(chunk.column(field().meta()->field_id()));
+    int index = chunk.column_index(field().meta()->field_id());
+    if (index < 0) {
+      LOG_WARN("field is not in the chunk. field=%s.%s", table_name(), field_name());
+      return RC::INTERNAL;
+    }
+    column.reference(chunk.column(index));
   }
   return RC::SUCCESS;
 }
@@ -516,6 +521,22 @@ RC ComparisonExpr::compare_column(const Column &left, const Column &right, vecto
 
   bool left_const  = left.column_type() == Column::Type::CONSTANT_COLUMN;
   bool right_const = right.column_type() == Column::Type::CONSTANT_COLUMN;
+
+  // 列在页面中是编码存放的，编码的部分直接在编码数据上比较，剩下的部分逐个比较
+  const EncodedColumn &encoded = left.encoded();
+  if (!left_const && right_const && encoded.valid() && encoded.count() <= left.count()) {
+    encoded.filter<T>(comp_, *(T *)right.data(), result.data());
+
+    const int encoded_count = encoded.count();
+    const int rest_count    = left.count() - encoded_count;
+    if (rest_count > 0) {
+      vector<uint8_t> rest_result(result.begin() + encoded_count, result.begin() + left.count());
+      compare_result<T, false, true>((T *)left.data() + encoded_count, (T *)right.data(), rest_count, rest_result, comp_);
+      std::copy(rest_result.begin(), rest_result.end(), result.begin() + encoded_count);
+    }
+    return rc;
+  }
+
   if (left_const && right_const) {
     compare_result<T, true, true>((T *)left.data(), (T *)right.data(), left.count(), result, comp_);
   } else if (left_const && !right_const) {
@@ -94,7 +94,15 @@ void AggregateVecPhysicalOperator::update_aggregate_state(void *state, const Col
 {
   STATE *state_ptr = reinterpret_cast<STATE *>(state);
   T     *data      = (T *)column.data();
-  state_ptr->update(data, column.count());
+
+  // 编码的部分直接在编码数据上求和
+  int                  start   = 0;
+  const EncodedColumn &encoded = column.encoded();
+  if (encoded.valid() && encoded.count() <= column.count()) {
+    state_ptr->value += encoded.sum<T>();
+    start = encoded.count();
+  }
+  state_ptr->update(data + start, column.count() - start);
 }
 
 RC AggregateVecPhysicalOperator::next(Chunk &chunk)
@@ -25,6 +25,9 @@ RC DeletePhysicalOperator::open(Trx *trx)
 
   unique_ptr<PhysicalOperator> &child = children_[0];
 
+  // 收集和删除记录期间一直持有表的共享锁，避免整理数据文件时移动记录
+  shared_lock<common::RecursiveSharedMutex> guard(table_->latch());
+
   RC rc = child->open(trx);
   if (rc != RC::SUCCESS) {
     LOG_WARN("failed to open child operator: %s", strrc(rc));
@@ -49,12 +52,11 @@ RC DeletePhysicalOperator::open(Trx *trx)
 
   // 先收集记录再删除
   // 记录的有效性由事务来保证，如果事务不保证删除的有效性，那说明此事务类型不支持并发控制，比如VacuousTrx
-  for (Record &record : records_) {
-    rc = trx_->delete_record(table_, record);
-    if (rc != RC::SUCCESS) {
-      LOG_WARN("failed to delete record: %s", strrc(rc));
-      return rc;
-    }
+  // 同一个页面中的记录由事务批量删除
+  rc = trx_->delete_records(table_, records_);
+  if (rc != RC::SUCCESS) {
+    LOG_WARN("failed to delete records: %s", strrc(rc));
+    return rc;
   }
 
   return RC::SUCCESS;
@@ -13,7 +13,9 @@ See the Mulan PSL v2 for more details. */
 //
 
 #include "sql/operator/index_scan_physical_operator.h"
+#include "common/lang/algorithm.h"
 #include "storage/index/index.h"
+#include "storage/table/table.h"
 #include "storage/trx/trx.h"
 #include <cassert>
 
@@ -35,12 +37,41 @@ RC IndexScanPhysicalOperator::open(Trx *trx)
     return RC::INTERNAL;
   }
 
-  IndexScanner *index_scanner = index_->create_scanner(left_value_.data(),
-      left_value_.length(),
-      left_inclusive_,
-      right_value_.data(),
-      right_value_.length(),
-      right_inclusive_);
+  table_guard_ = shared_lock<common::RecursiveSharedMutex>(table_->latch());
+
+  if (!in_values_.empty()) {
+    RC rc = lookup_in_values();
+    if (OB_FAIL(rc)) {
+      table_guard_.unlock();
+      return rc;
+    }
+    tuple_.set_schema(table_, table_->table_meta().field_metas());
+    record_handler_ = table_->record_handler();
+    trx_            = trx;
+    return RC::SUCCESS;
+  }
+
+  IndexScanner *index_scanner = nullptr;
+  if (!prefix_values_.empty()) {
+    string prefix_key;
+    RC     rc = make_prefix_key(prefix_key);
+    if (OB_FAIL(rc)) {
+      return rc;
+    }
+    index_scanner = index_->create_scanner(prefix_key.data(),
+        static_cast<int>(prefix_key.size()),
+        true /*left_inclusive*/,
+        prefix_key.data(),
+        static_cast<int>(prefix_key.size()),
+        true /*right_inclusive*/);
+  } else {
+    index_scanner = index_->create_scanner(left_value_.data(),
+        left_value_.length(),
+        left_inclusive_,
+        right_value_.data(),
+        right_value_.length(),
+        right_inclusive_);
+  }
   if (nullptr == index_scanner) {
     LOG_WARN("failed to create index scanner");
     return RC::INTERNAL;
@@ -58,6 +89,21 @@ RC IndexScanPhysicalOperator::open(Trx *trx)
 
   tuple_.set_schema(table_, table_->table_meta().field_metas());
 
+  if (covering_) {
+    int key_length = 0;
+    for (const FieldMeta &field_meta : index_->field_metas()) {
+      key_length += field_meta.len();
+    }
+    key_.resize(key_length);
+    RC rc = current_record_.new_record(table_->table_meta().record_size());
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to allocate record for covering index scan. rc=%s", strrc(rc));
+      index_scanner_->destroy();
+      index_scanner_ = nullptr;
+      return rc;
+    }
+  }
+
   trx_ = trx;
   return RC::SUCCESS;
 }
@@ -67,13 +113,17 @@ RC IndexScanPhysicalOperator::next()
   RID rid;
   RC  rc = RC::SUCCESS;
 
-  assert(index_scanner_ != nullptr);
   bool filter_result = false;
-  while (RC::SUCCESS == (rc = index_scanner_->next_entry(&rid))) {
-    rc = record_handler_->get_record(rid, current_record_);
-    if (OB_FAIL(rc)) {
-      LOG_TRACE("failed to get record. rid=%s, rc=%s", rid.to_string().c_str(), strrc(rc));
-      return rc;
+  while (RC::SUCCESS == (rc = next_entry(rid))) {
+    if (covering_) {
+      fill_record_from_key();
+      current_record_.set_rid(rid);
+    } else {
+      rc = record_handler_->get_record(rid, current_record_);
+      if (OB_FAIL(rc)) {
+        LOG_TRACE("failed to get record. rid=%s, rc=%s", rid.to_string().c_str(), strrc(rc));
+        return rc;
+      }
     }
 
     LOG_TRACE("got a record. rid=%s", rid.to_string().c_str());
@@ -104,11 +154,110 @@ RC IndexScanPhysicalOperator::next()
 
 RC IndexScanPhysicalOperator::close()
 {
-  index_scanner_->destroy();
-  index_scanner_ = nullptr;
+  if (index_scanner_ != nullptr) {
+    index_scanner_->destroy();
+    index_scanner_ = nullptr;
+  }
+  in_rids_.clear();
+  in_rid_pos_ = 0;
+  if (table_guard_.owns_lock()) {
+    table_guard_.unlock();
+  }
   return RC::SUCCESS;
 }
 
+RC IndexScanPhysicalOperator::lookup_in_values()
+{
+  const FieldMeta &field_meta = index_->field_metas()[0];
+  if (index_->field_metas().size() != 1) {
+    LOG_WARN("in values can only be used with single field index. index=%s", index_->index_meta().name());
+    return RC::INVALID_ARGUMENT;
+  }
+
+  // 批量查找要求键值有序，重复的键值会重复返回相同的RID，所以要去重
+  vector<Value> values = in_values_;
+  sort(values.begin(), values.end(), [](const Value &left, const Value &right) { return left.compare(right) < 0; });
+  auto last = unique(
+      values.begin(), values.end(), [](const Value &left, const Value &right) { return left.compare(right) == 0; });
+  values.erase(last, values.end());
+
+  const int    key_len = field_meta.len();
+  vector<char> keys(static_cast<size_t>(key_len) * values.size(), '\0');
+  for (size_t i = 0; i < values.size(); i++) {
+    const Value &value = values[i];
+    if (value.attr_type() != field_meta.type()) {
+      LOG_WARN("type of in value mismatch. field=%s, field type=%s, value type=%s",
+               field_meta.name(), attr_type_to_string(field_meta.type()), attr_type_to_string(value.attr_type()));
+      return RC::INVALID_ARGUMENT;
+    }
+    // 字符串后面补0，与记录中的字段相同
+    memcpy(keys.data() + i * key_len, value.data(), min(value.length(), key_len));
+  }
+
+  in_rids_.clear();
+  in_rid_pos_ = 0;
+  RC rc       = index_->get_entries(keys.data(), key_len, static_cast<int>(values.size()), in_rids_);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to lookup in values in index. index=%s, rc=%s", index_->index_meta().name(), strrc(rc));
+    return rc;
+  }
+  LOG_TRACE("lookup in values. value num=%d, rid num=%d", (int)values.size(), (int)in_rids_.size());
+  return RC::SUCCESS;
+}
+
+RC IndexScanPhysicalOperator::next_entry(RID &rid)
+{
+  if (!in_values_.empty()) {
+    if (in_rid_pos_ >= in_rids_.size()) {
+      return RC::RECORD_EOF;
+    }
+    rid = in_rids_[in_rid_pos_++];
+    return RC::SUCCESS;
+  }
+
+  assert(index_scanner_ != nullptr);
+  return covering_ ? index_scanner_->next_entry(&rid, key_.data()) : index_scanner_->next_entry(&rid);
+}
+
+RC IndexScanPhysicalOperator::make_prefix_key(string &key) const
+{
+  const vector<FieldMeta> &field_metas = index_->field_metas();
+  if (prefix_values_.size() > index_->index_meta().fields().size()) {
+    LOG_WARN("too many prefix values for index. index=%s, value num=%d",
+             index_->index_meta().name(), static_cast<int>(prefix_values_.size()));
+    return RC::INVALID_ARGUMENT;
+  }
+
+  key.clear();
+  for (size_t i = 0; i < prefix_values_.size(); i++) {
+    const Value     &value      = prefix_values_[i];
+    const FieldMeta &field_meta = field_metas[i];
+    if (value.attr_type() != field_meta.type()) {
+      LOG_WARN("type of prefix value mismatch. field=%s, field type=%s, value type=%s",
+               field_meta.name(), attr_type_to_string(field_meta.type()), attr_type_to_string(value.attr_type()));
+      return RC::INVALID_ARGUMENT;
+    }
+
+    // 每个字段都是完整的长度，字符串后面补0
+    string field_data(field_meta.len(), '\0');
+    memcpy(field_data.data(), value.data(), min(value.length(), field_meta.len()));
+    key.append(field_data);
+  }
+  return RC::SUCCESS;
+}
+
+void IndexScanPhysicalOperator::fill_record_from_key()
+{
+  char *data = current_record_.data();
+  memset(data, 0, table_->table_meta().record_size());
+
+  int offset = 0;
+  for (const FieldMeta &field_meta : index_->field_metas()) {
+    memcpy(data + field_meta.offset(), key_.data() + offset, field_meta.len());
+    offset += field_meta.len();
+  }
+}
+
 Tuple *IndexScanPhysicalOperator::current_tuple()
 {
   tuple_.set_record(&current_record_);
@@ -143,5 +292,11 @@ RC IndexScanPhysicalOperator::filter(RowTuple &tuple, bool &result)
 
 string IndexScanPhysicalOperator::param() const
 {
-  return string(index_->index_meta().name()) + " ON " + table_->name();
+  string result = string(index_->index_meta().name()) + " ON " + table_->name();
+  if (!in_values_.empty()) {
+    result += " IN LIST";
+  } else if (covering_) {
+    result += " COVERING";
+  }
+  return result;
 }
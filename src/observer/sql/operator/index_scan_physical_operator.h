@@ -14,6 +14,7 @@ See the Mulan PSL v2 for more details. */
 
 #pragma once
 
+#include "common/lang/mutex.h"
 #include "sql/expr/tuple.h"
 #include "sql/operator/physical_operator.h"
 #include "storage/record/record_manager.h"
@@ -42,10 +43,42 @@ public:
 
   void set_predicates(vector<unique_ptr<Expression>> &&exprs);
 
+  /**
+   * @brief 使用索引前面几个字段的等值条件扫描
+   * @details 用于多个字段的索引，values 依次对应索引的前几个字段，类型与字段相同。
+   * 设置之后不再使用构造函数中的左右边界
+   */
+  void set_prefix_values(vector<Value> &&values) { prefix_values_ = std::move(values); }
+
+  /**
+   * @brief 使用 IN 列表中的值批量查找索引
+   * @details 用于只有一个字段的索引，值的类型与字段相同。打开算子时把值排序去重之后，
+   * 一次调用 Index::get_entries 找到所有的RID。设置之后不再使用构造函数中的左右边界，也不能使用覆盖索引
+   */
+  void set_in_values(vector<Value> &&values) { in_values_ = std::move(values); }
+
+  /**
+   * @brief 只使用索引中的数据返回结果，不再读取记录(覆盖索引)
+   * @details 上层算子用到的字段都在索引中时才可以设置
+   */
+  void set_covering(bool covering) { covering_ = covering; }
+
 private:
   // 与TableScanPhysicalOperator代码相同，可以优化
   RC filter(RowTuple &tuple, bool &result);
 
+  /// 把前缀的值拼接成索引的键值
+  RC make_prefix_key(string &key) const;
+
+  /// 批量查找 IN 列表中所有值对应的RID
+  RC lookup_in_values();
+
+  /// 取下一个索引项，IN 列表时从批量查找的结果中取
+  RC next_entry(RID &rid);
+
+  /// 使用索引的键值构造记录，记录中不在索引中的字段都是0
+  void fill_record_from_key();
+
 private:
   Trx               *trx_            = nullptr;
   Table             *table_          = nullptr;
@@ -62,5 +95,14 @@ private:
   bool  left_inclusive_  = false;
   bool  right_inclusive_ = false;
 
+  vector<Value> prefix_values_;
+  vector<Value> in_values_;
+  vector<RID>   in_rids_;        ///< IN 列表中所有值对应的RID
+  size_t        in_rid_pos_ = 0;  ///< 下一个要返回的 in_rids_ 的位置
+  bool          covering_ = false;
+  vector<char>  key_;  ///< 覆盖索引扫描时，当前的键值
+
   vector<unique_ptr<Expression>> predicates_;
+
+  shared_lock<common::RecursiveSharedMutex> table_guard_;  ///< 扫描期间持有表的共享锁，索引中的RID不会失效
 };
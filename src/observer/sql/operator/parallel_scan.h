@@ -0,0 +1,225 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include "common/lang/algorithm.h"
+#include "common/lang/atomic.h"
+#include "common/lang/deque.h"
+#include "common/lang/functional.h"
+#include "common/lang/memory.h"
+#include "common/lang/mutex.h"
+#include "common/lang/thread.h"
+#include "common/lang/vector.h"
+#include "common/log/log.h"
+#include "common/sys/rc.h"
+#include "common/thread/thread_util.h"
+#include "common/types.h"
+
+/**
+ * @brief 并行扫描时工作线程与父算子之间交换数据的队列
+ * @ingroup PhysicalOperator
+ * @details 有界的队列，多个生产者(工作线程)，一个消费者(父算子)。队列满时生产者等待，
+ * 所有的生产者都结束并且队列为空时，消费者拿到 RECORD_EOF，如果某个生产者失败了就拿到它的错误码。
+ * 消费者提前结束时关闭队列，生产者发现队列关闭后不再生产数据。
+ */
+template <typename T>
+class ExchangeQueue
+{
+public:
+  ExchangeQueue()  = default;
+  ~ExchangeQueue() = default;
+
+  void init(int capacity, int producer_num)
+  {
+    lock_guard guard(mutex_);
+    items_.clear();
+    capacity_     = capacity;
+    producer_num_ = producer_num;
+    closed_       = false;
+    rc_           = RC::SUCCESS;
+  }
+
+  /**
+   * @brief 生产者放入一个数据，队列满时等待
+   * @return 队列已经关闭时返回 false，生产者应该停止
+   */
+  bool push(T &&value)
+  {
+    unique_lock lock(mutex_);
+    not_full_.wait(lock, [this] { return closed_ || static_cast<int>(items_.size()) < capacity_; });
+    if (closed_) {
+      return false;
+    }
+    items_.push_back(std::move(value));
+    not_empty_.notify_one();
+    return true;
+  }
+
+  /**
+   * @brief 消费者取出一个数据，队列为空时等待
+   * @return 所有的生产者都结束并且没有数据时返回 RECORD_EOF，或者生产者的错误码
+   */
+  RC pop(T &value)
+  {
+    unique_lock lock(mutex_);
+    not_empty_.wait(lock, [this] { return !items_.empty() || producer_num_ == 0 || OB_FAIL(rc_) || closed_; });
+    if (OB_FAIL(rc_)) {
+      return rc_;
+    }
+    if (items_.empty()) {
+      return RC::RECORD_EOF;
+    }
+    value = std::move(items_.front());
+    items_.pop_front();
+    not_full_.notify_one();
+    return RC::SUCCESS;
+  }
+
+  /**
+   * @brief 一个生产者结束了
+   * @param rc 生产者的执行结果，失败时消费者不再读取剩下的数据
+   */
+  void producer_done(RC rc)
+  {
+    lock_guard guard(mutex_);
+    producer_num_--;
+    if (OB_FAIL(rc) && OB_SUCC(rc_)) {
+      rc_ = rc;
+    }
+    not_empty_.notify_all();
+  }
+
+  /**
+   * @brief 关闭队列并丢弃还没有取出的数据，等待中的生产者会被唤醒
+   */
+  void close()
+  {
+    lock_guard guard(mutex_);
+    closed_ = true;
+    items_.clear();
+    not_full_.notify_all();
+    not_empty_.notify_all();
+  }
+
+  bool closed()
+  {
+    lock_guard guard(mutex_);
+    return closed_;
+  }
+
+private:
+  mutex              mutex_;
+  condition_variable not_empty_;
+  condition_variable not_full_;
+  deque<T>           items_;
+  int                capacity_     = 0;
+  int                producer_num_ = 0;     ///< 还没有结束的生产者个数
+  bool               closed_       = false;
+  RC                 rc_           = RC::SUCCESS;  ///< 第一个失败的生产者的错误码
+};
+
+/**
+ * @brief 按照页面范围并行扫描一个文件
+ * @ingroup PhysicalOperator
+ * @details 把文件中的页面划分成每 MORSEL_PAGES 个页面一组(morsel)，工作线程每次领取一组页面，
+ * 调用 MorselScanner 扫描这些页面，把结果放到交换队列中，父算子通过 next 从队列中获取结果。
+ * 领取页面时只需要一个原子操作，扫描快的线程会领取更多的页面，不需要预先平均分配。
+ * 结果的顺序与页面的顺序无关。工作线程在每次 start 时创建，stop 时直接 join 等待它们退出，
+ * 不使用线程池，避免线程池轮询等待线程退出带来的延迟。
+ */
+template <typename T>
+class ParallelScanner
+{
+public:
+  /// 每个工作线程一次领取的页面个数
+  static constexpr int MORSEL_PAGES = 64;
+
+  /**
+   * @brief 扫描 [begin_page, end_page) 范围内的页面，结果放到队列中
+   * @details 在工作线程中调用。队列关闭后(push 返回 false)应该尽快返回
+   */
+  using MorselScanner = function<RC(PageNum begin_page, PageNum end_page, ExchangeQueue<T> &queue)>;
+
+public:
+  ParallelScanner() = default;
+  ~ParallelScanner() { stop(); }
+
+  /**
+   * @brief 启动工作线程开始扫描
+   * @param thread_num 工作线程个数
+   * @param page_count 文件中的页面个数，扫描的页面范围是 [1, page_count)
+   * @param scanner 扫描一组页面的函数，在多个线程中同时调用
+   */
+  RC start(int thread_num, PageNum page_count, MorselScanner scanner)
+  {
+    stop();
+
+    scanner_    = std::move(scanner);
+    page_count_ = page_count;
+    next_page_.store(1);
+    queue_.init(thread_num * 2 /*capacity*/, thread_num);
+
+    workers_.reserve(thread_num);
+    for (int i = 0; i < thread_num; i++) {
+      workers_.emplace_back([this]() { this->worker(); });
+    }
+    return RC::SUCCESS;
+  }
+
+  /**
+   * @brief 获取下一个结果，所有的页面都扫描完时返回 RECORD_EOF
+   */
+  RC next(T &value) { return queue_.pop(value); }
+
+  /**
+   * @brief 停止扫描并等待所有的工作线程退出
+   */
+  void stop()
+  {
+    if (workers_.empty()) {
+      return;
+    }
+    queue_.close();
+    for (thread &worker : workers_) {
+      worker.join();
+    }
+    workers_.clear();
+  }
+
+private:
+  void worker()
+  {
+    common::thread_set_name("ParallelScan");
+
+    RC rc = RC::SUCCESS;
+    while (!queue_.closed()) {
+      PageNum begin_page = next_page_.fetch_add(MORSEL_PAGES);
+      if (begin_page >= page_count_) {
+        break;
+      }
+
+      PageNum end_page = min(begin_page + MORSEL_PAGES, page_count_);
+      rc               = scanner_(begin_page, end_page, queue_);
+      if (OB_FAIL(rc)) {
+        LOG_WARN("failed to scan pages. begin page=%d, end page=%d, rc=%s", begin_page, end_page, strrc(rc));
+        break;
+      }
+    }
+    queue_.producer_done(rc);
+  }
+
+private:
+  MorselScanner    scanner_;
+  PageNum          page_count_ = 0;
+  atomic<PageNum>  next_page_{1};  ///< 下一个还没有被领取的页面
+  ExchangeQueue<T> queue_;
+  vector<thread>   workers_;
+};
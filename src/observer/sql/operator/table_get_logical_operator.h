@@ -36,6 +36,13 @@ public:
   void set_predicates(vector<unique_ptr<Expression>> &&exprs);
   auto predicates() -> vector<unique_ptr<Expression>> & { return predicates_; }
 
+  /**
+   * @brief 设置需要读取的列
+   * @param field_ids 需要读取的字段ID，从小到大排列。为空表示读取所有的列
+   */
+  void               set_projection(vector<int> &&field_ids) { projection_ = std::move(field_ids); }
+  const vector<int> &projection() const { return projection_; }
+
   void               set_table_alias(const std::string &table_alias) { table_alias_ = table_alias; }
   const std::string &table_alias() const { return table_alias_; }
 
@@ -49,5 +56,8 @@ private:
   // 如果有多个表达式，他们的关系都是 AND
   vector<unique_ptr<Expression>> predicates_;
 
+  // 上层算子用到的字段，为空表示需要所有的字段
+  vector<int> projection_;
+
   std::string table_alias_;
 };
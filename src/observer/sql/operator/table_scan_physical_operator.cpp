@@ -20,9 +20,29 @@ using namespace std;
 
 RC TableScanPhysicalOperator::open(Trx *trx)
 {
+  table_guard_ = shared_lock<common::RecursiveSharedMutex>(table_->latch());
+
+  if (parallel_threads_ > 1) {
+    trx_ = trx;
+    tuple_.set_schema(table_, table_->table_meta().field_metas());
+    zone_map_filter_.init(table_, predicates_);
+    records_.clear();
+    record_index_ = 0;
+    return parallel_scanner_.start(parallel_threads_,
+        table_->data_buffer_pool()->page_count(),
+        [this](PageNum begin_page, PageNum end_page, ExchangeQueue<vector<Record>> &queue) {
+          return scan_morsel(begin_page, end_page, queue);
+        });
+  }
+
   RC rc = table_->get_record_scanner(record_scanner_, trx, mode_);
   if (rc == RC::SUCCESS) {
     tuple_.set_schema(table_, table_->table_meta().field_metas());
+
+    // 用谓词中的简单比较条件跳过不可能满足条件的页面
+    ZoneMapFilter zone_map_filter;
+    zone_map_filter.init(table_, predicates_);
+    record_scanner_.set_zone_map_filter(std::move(zone_map_filter));
   }
   trx_ = trx;
   return rc;
@@ -32,6 +52,23 @@ RC TableScanPhysicalOperator::next()
 {
   RC rc = RC::SUCCESS;
 
+  if (parallel_threads_ > 1) {
+    // 工作线程已经过滤过了
+    while (record_index_ >= records_.size()) {
+      records_.clear();
+      record_index_ = 0;
+      rc            = parallel_scanner_.next(records_);
+      if (OB_FAIL(rc)) {
+        return rc;
+      }
+    }
+    current_record_ = std::move(records_[record_index_++]);
+    tuple_.set_record(&current_record_);
+    tuple_.set_table_name(table_->name());
+    tuple_.table_alias_ = table_alias_;
+    return rc;
+  }
+
   bool filter_result = false;
   while (OB_SUCC(rc = record_scanner_.next(current_record_))) {
     LOG_TRACE("got a record. rid=%s", current_record_.rid().to_string().c_str());
@@ -56,7 +93,16 @@ RC TableScanPhysicalOperator::next()
   return rc;
 }
 
-RC TableScanPhysicalOperator::close() { return record_scanner_.close_scan(); }
+RC TableScanPhysicalOperator::close()
+{
+  parallel_scanner_.stop();
+  records_.clear();
+  RC rc = record_scanner_.close_scan();
+  if (table_guard_.owns_lock()) {
+    table_guard_.unlock();
+  }
+  return rc;
+}
 
 Tuple *TableScanPhysicalOperator::current_tuple()
 {
@@ -71,11 +117,68 @@ void TableScanPhysicalOperator::set_predicates(vector<unique_ptr<Expression>> &&
   predicates_ = std::move(exprs);
 }
 
-RC TableScanPhysicalOperator::filter(RowTuple &tuple, bool &result)
+RC TableScanPhysicalOperator::scan_morsel(PageNum begin_page, PageNum end_page, ExchangeQueue<vector<Record>> &queue)
+{
+  /// 每次放到队列中的记录个数，减少队列的加锁次数
+  static constexpr size_t BATCH_SIZE = 256;
+
+  RecordFileScanner scanner;
+  RC                rc = table_->get_record_scanner(scanner, trx_, mode_);
+  if (OB_SUCC(rc)) {
+    rc = scanner.set_page_range(begin_page, end_page);
+  }
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+  scanner.set_zone_map_filter(zone_map_filter_);
+
+  RowTuple tuple;
+  tuple.set_schema(table_, table_->table_meta().field_metas());
+  tuple.set_table_name(table_->name());
+  tuple.table_alias_ = table_alias_;
+
+  vector<Record> batch;
+  Record         record;
+  bool           filter_result = false;
+  while (OB_SUCC(rc = scanner.next(record))) {
+    tuple.set_record(&record);
+    rc = filter(tuple, filter_result);
+    if (OB_FAIL(rc)) {
+      return rc;
+    }
+    if (!filter_result) {
+      continue;
+    }
+
+    // 记录可能直接引用页面中的数据，需要复制一份
+    Record &copy = batch.emplace_back();
+    rc           = copy.copy_data(record.data(), record.len());
+    if (OB_FAIL(rc)) {
+      return rc;
+    }
+    copy.set_rid(record.rid());
+    if (batch.size() >= BATCH_SIZE) {
+      if (!queue.push(std::move(batch))) {
+        return RC::SUCCESS;
+      }
+      batch = vector<Record>();
+    }
+  }
+
+  if (rc != RC::RECORD_EOF) {
+    return rc;
+  }
+  if (!batch.empty()) {
+    queue.push(std::move(batch));
+  }
+  return RC::SUCCESS;
+}
+
+RC TableScanPhysicalOperator::filter(RowTuple &tuple, bool &result) const
 {
   RC    rc = RC::SUCCESS;
   Value value;
-  for (unique_ptr<Expression> &expr : predicates_) {
+  for (const unique_ptr<Expression> &expr : predicates_) {
     rc = expr->get_value(tuple, value);
     if (rc != RC::SUCCESS) {
       return rc;
@@ -15,6 +15,8 @@ See the Mulan PSL v2 for more details. */
 #pragma once
 
 #include "common/sys/rc.h"
+#include "common/lang/mutex.h"
+#include "sql/operator/parallel_scan.h"
 #include "sql/operator/physical_operator.h"
 #include "storage/record/record_manager.h"
 #include "common/types.h"
@@ -44,13 +46,28 @@ public:
 
   void set_predicates(vector<unique_ptr<Expression>> &&exprs);
 
+  /**
+   * @brief 设置并行扫描的线程个数，不大于1时在当前线程中扫描
+   * @details 并行扫描时返回记录的顺序是不确定的，而且谓词会在多个线程中同时计算，
+   * 所以只有只读的扫描并且谓词可以并发计算时才能设置
+   */
+  void set_parallel_threads(int thread_num) { parallel_threads_ = thread_num; }
+
   void               set_table_alias(const std::string &table_alias) { table_alias_ = table_alias; }
   const std::string &table_alias() const { return table_alias_; }
 
 private:
-  RC filter(RowTuple &tuple, bool &result);
+  RC filter(RowTuple &tuple, bool &result) const;
+
+  /**
+   * @brief 并行扫描时在工作线程中扫描一组页面，把满足条件的记录复制出来放到队列中
+   */
+  RC scan_morsel(PageNum begin_page, PageNum end_page, ExchangeQueue<vector<Record>> &queue);
 
 private:
+  /// 扫描期间持有表的共享锁。放在最前面，析构时最后释放，此时并行扫描的工作线程都已经退出了
+  shared_lock<common::RecursiveSharedMutex> table_guard_;
+
   Table                         *table_ = nullptr;
   Trx                           *trx_   = nullptr;
   ReadWriteMode                  mode_  = ReadWriteMode::READ_WRITE;
@@ -59,5 +76,11 @@ private:
   RowTuple                       tuple_;
   vector<unique_ptr<Expression>> predicates_;  // TODO chang predicate to table tuple filter
 
+  int                             parallel_threads_ = 1;
+  ZoneMapFilter                   zone_map_filter_;    ///< 并行扫描时每个工作线程复制一份
+  ParallelScanner<vector<Record>> parallel_scanner_;
+  vector<Record>                  records_;            ///< 并行扫描时从队列中取出的一批记录
+  size_t                          record_index_ = 0;
+
   string table_alias_;
 };
@@ -16,17 +16,37 @@ using namespace std;
 
 RC TableScanVecPhysicalOperator::open(Trx *trx)
 {
-  RC rc = table_->get_chunk_scanner(chunk_scanner_, trx, mode_);
+  table_guard_ = shared_lock<common::RecursiveSharedMutex>(table_->latch());
+
+  const TableMeta &table_meta = table_->table_meta();
+  if (projection_.empty()) {
+    for (int i = 0; i < table_meta.field_num(); ++i) {
+      projection_.push_back(table_meta.field(i)->field_id());
+    }
+  }
+
+  // all_columns_ 中的列由 chunk_scanner_ 按照 projection_ 的顺序创建
+  RC rc = table_->get_chunk_scanner(chunk_scanner_, trx, mode_, projection_);
   if (rc != RC::SUCCESS) {
     LOG_WARN("failed to get chunk scanner", strrc(rc));
     return rc;
   }
-  // TODO: don't need to fetch all columns from record manager
-  for (int i = 0; i < table_->table_meta().field_num(); ++i) {
-    all_columns_.add_column(
-        make_unique<Column>(*table_->table_meta().field(i)), table_->table_meta().field(i)->field_id());
-    filterd_columns_.add_column(
-        make_unique<Column>(*table_->table_meta().field(i)), table_->table_meta().field(i)->field_id());
+
+  zone_map_filter_.init(table_, predicates_);
+  chunk_scanner_.set_zone_map_filter(zone_map_filter_);
+
+  filterd_columns_.reset();
+  for (int field_id : projection_) {
+    filterd_columns_.add_column(make_unique<Column>(*table_meta.field(field_id)), field_id);
+  }
+
+  if (parallel_threads_ > 1) {
+    parallel_chunk_.reset();
+    rc = parallel_scanner_.start(parallel_threads_,
+        table_->data_buffer_pool()->page_count(),
+        [this](PageNum begin_page, PageNum end_page, ExchangeQueue<unique_ptr<Chunk>> &queue) {
+          return scan_morsel(begin_page, end_page, queue);
+        });
   }
   return rc;
 }
@@ -35,35 +55,48 @@ RC TableScanVecPhysicalOperator::next(Chunk &chunk)
 {
   RC rc = RC::SUCCESS;
 
+  if (parallel_threads_ > 1) {
+    // 工作线程已经过滤过了，chunk 中只有满足条件的行
+    if (OB_SUCC(rc = parallel_scanner_.next(parallel_chunk_))) {
+      chunk.reference(*parallel_chunk_);
+    }
+    return rc;
+  }
+
   all_columns_.reset_data();
   filterd_columns_.reset_data();
   if (OB_SUCC(rc = chunk_scanner_.next_chunk(all_columns_))) {
-    select_.assign(all_columns_.rows(), 1);
-    if (predicates_.empty()) {
+    // all_columns_ 中的列直接引用页面数据，页面上空的槽位由选择向量标记
+    if (all_columns_.has_select()) {
+      select_ = all_columns_.select();
+    } else {
+      select_.assign(all_columns_.rows(), 1);
+    }
+    if (predicates_.empty() && !all_columns_.has_select()) {
       chunk.reference(all_columns_);
     } else {
-      rc = filter(all_columns_);
+      rc = filter(all_columns_, select_);
       if (rc != RC::SUCCESS) {
         LOG_TRACE("filtered failed=%s", strrc(rc));
         return rc;
       }
-      // TODO: if all setted, it doesn't need to set one by one
-      for (int i = 0; i < all_columns_.rows(); i++) {
-        if (select_[i] == 0) {
-          continue;
-        }
-        for (int j = 0; j < all_columns_.column_num(); j++) {
-          filterd_columns_.column(j).append_one(
-              (char *)all_columns_.column(filterd_columns_.column_ids(j)).get_value(i).data());
-        }
-      }
+      copy_selected(all_columns_, select_, filterd_columns_);
       chunk.reference(filterd_columns_);
     }
   }
   return rc;
 }
 
-RC TableScanVecPhysicalOperator::close() { return chunk_scanner_.close_scan(); }
+RC TableScanVecPhysicalOperator::close()
+{
+  parallel_scanner_.stop();
+  parallel_chunk_.reset();
+  RC rc = chunk_scanner_.close_scan();
+  if (table_guard_.owns_lock()) {
+    table_guard_.unlock();
+  }
+  return rc;
+}
 
 string TableScanVecPhysicalOperator::param() const { return table_->name(); }
 
@@ -72,14 +105,73 @@ void TableScanVecPhysicalOperator::set_predicates(vector<unique_ptr<Expression>>
   predicates_ = std::move(exprs);
 }
 
-RC TableScanVecPhysicalOperator::filter(Chunk &chunk)
+RC TableScanVecPhysicalOperator::filter(Chunk &chunk, vector<uint8_t> &select)
 {
   RC rc = RC::SUCCESS;
   for (unique_ptr<Expression> &expr : predicates_) {
-    rc = expr->eval(chunk, select_);
+    rc = expr->eval(chunk, select);
     if (rc != RC::SUCCESS) {
       return rc;
     }
   }
   return rc;
 }
+
+void TableScanVecPhysicalOperator::copy_selected(Chunk &chunk, const vector<uint8_t> &select, Chunk &output)
+{
+  // TODO: if all setted, it doesn't need to set one by one
+  for (int i = 0; i < chunk.rows(); i++) {
+    if (select[i] == 0) {
+      continue;
+    }
+    for (int j = 0; j < chunk.column_num(); j++) {
+      Column &column = chunk.column(j);
+      output.column(j).append_one(column.data() + i * column.attr_len());
+    }
+  }
+}
+
+RC TableScanVecPhysicalOperator::scan_morsel(
+    PageNum begin_page, PageNum end_page, ExchangeQueue<unique_ptr<Chunk>> &queue)
+{
+  const TableMeta &table_meta = table_->table_meta();
+
+  ChunkFileScanner scanner;
+  RC               rc = table_->get_chunk_scanner(scanner, nullptr /*trx*/, mode_, projection_);
+  if (OB_SUCC(rc)) {
+    rc = scanner.set_page_range(begin_page, end_page);
+  }
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+  scanner.set_zone_map_filter(zone_map_filter_);
+
+  // 页面中的数据只在扫描下一个页面之前有效，所以满足条件的行都要复制出来
+  Chunk           page_columns;
+  vector<uint8_t> select;
+  while (OB_SUCC(rc = scanner.next_chunk(page_columns))) {
+    if (page_columns.has_select()) {
+      select = page_columns.select();
+    } else {
+      select.assign(page_columns.rows(), 1);
+    }
+    rc = filter(page_columns, select);
+    if (OB_FAIL(rc)) {
+      return rc;
+    }
+
+    auto output = make_unique<Chunk>();
+    for (int field_id : projection_) {
+      output->add_column(make_unique<Column>(*table_meta.field(field_id)), field_id);
+    }
+    copy_selected(page_columns, select, *output);
+    page_columns.reset_data();
+    if (output->rows() == 0) {
+      continue;
+    }
+    if (!queue.push(std::move(output))) {
+      return RC::SUCCESS;
+    }
+  }
+  return rc == RC::RECORD_EOF ? RC::SUCCESS : rc;
+}
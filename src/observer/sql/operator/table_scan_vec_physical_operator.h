@@ -11,6 +11,8 @@ See the Mulan PSL v2 for more details. */
 #pragma once
 
 #include "common/sys/rc.h"
+#include "common/lang/mutex.h"
+#include "sql/operator/parallel_scan.h"
 #include "sql/operator/physical_operator.h"
 #include "storage/record/record_manager.h"
 #include "common/types.h"
@@ -38,10 +40,33 @@ public:
 
   void set_predicates(vector<unique_ptr<Expression>> &&exprs);
 
+  /**
+   * @brief 设置需要读取的列，为空表示读取所有的列
+   */
+  void set_projection(const vector<int> &field_ids) { projection_ = field_ids; }
+
+  /**
+   * @brief 设置并行扫描的线程个数，参考 TableScanPhysicalOperator::set_parallel_threads
+   */
+  void set_parallel_threads(int thread_num) { parallel_threads_ = thread_num; }
+
 private:
-  RC filter(Chunk &chunk);
+  RC filter(Chunk &chunk, vector<uint8_t> &select);
+
+  /**
+   * @brief 把 chunk 中被选中的行追加到 output 中
+   */
+  static void copy_selected(Chunk &chunk, const vector<uint8_t> &select, Chunk &output);
+
+  /**
+   * @brief 并行扫描时在工作线程中扫描一组页面，每个页面中满足条件的行复制到一个新的 chunk 中放到队列里
+   */
+  RC scan_morsel(PageNum begin_page, PageNum end_page, ExchangeQueue<unique_ptr<Chunk>> &queue);
 
 private:
+  /// 扫描期间持有表的共享锁。放在最前面，析构时最后释放，此时并行扫描的工作线程都已经退出了
+  shared_lock<common::RecursiveSharedMutex> table_guard_;
+
   Table                         *table_ = nullptr;
   ReadWriteMode                  mode_  = ReadWriteMode::READ_WRITE;
   ChunkFileScanner               chunk_scanner_;
@@ -49,4 +74,10 @@ private:
   Chunk                          filterd_columns_;
   vector<uint8_t>                select_;
   vector<unique_ptr<Expression>> predicates_;
+  vector<int>                    projection_;  ///< 需要读取的字段ID
+
+  int                                 parallel_threads_ = 1;
+  ZoneMapFilter                       zone_map_filter_;  ///< 并行扫描时每个工作线程复制一份
+  ParallelScanner<unique_ptr<Chunk>> parallel_scanner_;
+  unique_ptr<Chunk>                   parallel_chunk_;  ///< 并行扫描时当前返回给上层的 chunk
 };
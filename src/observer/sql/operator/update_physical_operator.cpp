@@ -19,6 +19,9 @@ RC UpdatePhysicalOperator::next()
 
 RC UpdatePhysicalOperator::open(Trx *trx)
 {
+  // 收集和更新记录期间一直持有表的共享锁，避免整理数据文件时移动记录
+  shared_lock<common::RecursiveSharedMutex> guard(table_->latch());
+
   RC rc = children_[0]->open(trx);
   if (rc != RC::SUCCESS)
     return rc;
@@ -23,6 +23,7 @@ See the Mulan PSL v2 for more details. */
 #include "event/session_event.h"
 #include "event/sql_event.h"
 #include "sql/operator/logical_operator.h"
+#include "sql/optimizer/projection_pushdown.h"
 #include "sql/stmt/stmt.h"
 
 using namespace std;
@@ -68,8 +69,13 @@ RC OptimizeStage::handle_request(SQLStageEvent *sql_event)
 
 RC OptimizeStage::optimize(unique_ptr<LogicalOperator> &oper)
 {
-  // do nothing
-  return RC::SUCCESS;
+  // 收集字段时会保存状态，每次使用新的对象，不同的会话之间互不影响
+  ProjectionPushdown projection_pushdown;
+  RC                 rc = projection_pushdown.optimize(*oper);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to pushdown projection. rc=%s", strrc(rc));
+  }
+  return rc;
 }
 
 RC OptimizeStage::generate_physical_plan(
@@ -43,9 +43,165 @@ See the Mulan PSL v2 for more details. */
 #include "sql/operator/scalar_group_by_physical_operator.h"
 #include "sql/operator/table_scan_vec_physical_operator.h"
 #include "sql/optimizer/physical_plan_generator.h"
+#include "sql/expr/expression_iterator.h"
+#include "session/session.h"
+#include "storage/index/index.h"
+#include "storage/table/table.h"
 
 using namespace std;
 
+/**
+ * @brief 表达式是否可以在多个线程中同时计算
+ * @details 子查询、值列表等表达式计算时会修改自己的状态，不能在多个线程中同时计算
+ */
+static bool parallel_safe(Expression &expr)
+{
+  switch (expr.type()) {
+    case ExprType::FIELD:
+    case ExprType::VALUE:
+    case ExprType::CAST:
+    case ExprType::COMPARISON:
+    case ExprType::CONJUNCTION:
+    case ExprType::ARITHMETIC: break;
+    default: return false;
+  }
+
+  bool safe = true;
+  ExpressionIterator::iterate_child_expr(expr, [&safe](unique_ptr<Expression> &child) {
+    safe = safe && child && parallel_safe(*child);
+    return RC::SUCCESS;
+  });
+  return safe;
+}
+
+/**
+ * @brief 表扫描使用的线程个数
+ * @details 由会话变量 parallel_scan_threads 控制。只有只读的扫描并且谓词可以并发计算时才并行扫描
+ */
+static int parallel_scan_threads(TableGetLogicalOperator &table_get_oper)
+{
+  Session *session = Session::current_session();
+  if (session == nullptr || session->parallel_scan_threads() <= 1 ||
+      table_get_oper.read_write_mode() != ReadWriteMode::READ_ONLY) {
+    return 1;
+  }
+
+  for (unique_ptr<Expression> &predicate : table_get_oper.predicates()) {
+    if (!parallel_safe(*predicate)) {
+      return 1;
+    }
+  }
+  return session->parallel_scan_threads();
+}
+
+/**
+ * @brief 根据等值条件选择索引
+ * @details 选择等值条件能覆盖的前缀最长的索引。多个字段的索引要求值的类型与字段相同，
+ * 只有一个字段的索引与之前一样直接使用条件中的值
+ * @param conditions 等值条件中的字段和值
+ * @param[out] prefix_values 索引前缀字段对应的值
+ */
+static Index *choose_index(const Table &table, const vector<pair<const FieldMeta *, const Value *>> &conditions,
+    vector<Value> &prefix_values)
+{
+  Index *best_index = nullptr;
+  prefix_values.clear();
+  for (Index *index : table.indexes()) {
+    if (index->is_vector_index()) {
+      continue;
+    }
+
+    const vector<FieldMeta> &field_metas = index->field_metas();
+    const size_t             key_num     = index->index_meta().fields().size();
+    vector<Value>            values;
+    for (size_t i = 0; i < key_num; i++) {
+      const FieldMeta &field_meta = field_metas[i];
+      auto             iter       = find_if(conditions.begin(), conditions.end(), [&field_meta](const auto &condition) {
+        return 0 == strcmp(condition.first->name(), field_meta.name());
+      });
+      if (iter == conditions.end()) {
+        break;
+      }
+
+      const Value &value = *iter->second;
+      if (field_metas.size() > 1 && (value.attr_type() != field_meta.type() || value.length() > field_meta.len())) {
+        break;
+      }
+      values.push_back(value);
+    }
+
+    if (values.size() > prefix_values.size()) {
+      best_index    = index;
+      prefix_values = std::move(values);
+    }
+  }
+  return best_index;
+}
+
+/**
+ * @brief 根据 IN 条件选择只有一个字段的索引
+ * @details 列表中的值都要与字段类型相同，NULL 不会与任何值相等，直接去掉
+ * @param conditions IN 条件中的字段和值列表
+ * @param[out] in_values 要在索引中查找的值
+ */
+static Index *choose_in_index(const Table &table,
+    const vector<pair<const FieldMeta *, const vector<Value> *>> &conditions, vector<Value> &in_values)
+{
+  in_values.clear();
+  for (const auto &[field_meta, values] : conditions) {
+    auto single_field_index = [field_meta](Index *index) {
+      return !index->is_vector_index() && index->field_metas().size() == 1 &&
+             0 == strcmp(index->field_metas()[0].name(), field_meta->name());
+    };
+    auto iter = find_if(table.indexes().begin(), table.indexes().end(), single_field_index);
+    if (iter == table.indexes().end()) {
+      continue;
+    }
+
+    bool          usable = true;
+    vector<Value> candidates;
+    for (const Value &value : *values) {
+      if (value.is_null()) {
+        continue;
+      }
+      if (value.attr_type() != field_meta->type() || value.length() > field_meta->len()) {
+        usable = false;
+        break;
+      }
+      candidates.push_back(value);
+    }
+
+    if (usable && !candidates.empty()) {
+      in_values = std::move(candidates);
+      return *iter;
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * @brief 上层算子用到的字段是否都在索引中，这时只读取索引不需要再读取记录(覆盖索引)
+ * @details 索引中没有记录 NULL 和事务相关的字段，所以要求用到的字段都不能为 NULL，并且表中没有事务字段(不是 MVCC)
+ */
+static bool index_covers(const TableGetLogicalOperator &table_get_oper, const Index &index)
+{
+  const TableMeta &table_meta = table_get_oper.table()->table_meta();
+  if (table_get_oper.read_write_mode() != ReadWriteMode::READ_ONLY || table_get_oper.projection().empty() ||
+      !table_meta.trx_fields().empty()) {
+    return false;
+  }
+
+  const vector<FieldMeta> &index_field_metas = index.field_metas();
+  for (int field_id : table_get_oper.projection()) {
+    auto same_field = [field_id](const FieldMeta &field_meta) { return field_meta.field_id() == field_id; };
+    auto iter       = find_if(index_field_metas.begin(), index_field_metas.end(), same_field);
+    if (iter == index_field_metas.end() || iter->nullable()) {
+      return false;
+    }
+  }
+  return true;
+}
+
 RC PhysicalPlanGenerator::create(LogicalOperator &logical_operator, unique_ptr<PhysicalOperator> &oper)
 {
   RC rc = RC::SUCCESS;
@@ -130,8 +286,10 @@ RC PhysicalPlanGenerator::create_plan(TableGetLogicalOperator &table_get_oper, u
   Table *table = table_get_oper.table();
 
   // LOG_INFO("table name=%s, predicates size=%zu", table->name(), predicates.size());
-  Index     *index      = nullptr;
-  ValueExpr *value_expr = nullptr;
+  // 等值条件中的字段和值
+  vector<pair<const FieldMeta *, const Value *>> equal_conditions;
+  // IN 条件中的字段和值列表
+  vector<pair<const FieldMeta *, const vector<Value> *>> in_conditions;
   for (auto &expr : predicates) {
     // LOG_INFO("expr type=%d", expr->type());
     if (expr->type() == ExprType::COMPARISON) {
@@ -165,6 +323,15 @@ RC PhysicalPlanGenerator::create_plan(TableGetLogicalOperator &table_get_oper, u
         }
         sub_query_expr->set_physical_operator(std::move(subquery_phy_oper));
       }
+      // 字段 IN (常量列表)，可以在索引中批量查找
+      if (comparison_expr->comp() == IN_OP && comparison_expr->left()->type() == ExprType::FIELD &&
+          comparison_expr->right()->type() == ExprType::VALUES) {
+        auto field_expr = static_cast<FieldExpr *>(comparison_expr->left().get());
+        auto list_expr  = static_cast<ValueListExpr *>(comparison_expr->right().get());
+        in_conditions.emplace_back(field_expr->field().meta(), &list_expr->get_values());
+        continue;
+      }
+
       // 简单处理，就找等值查询
       if (comparison_expr->comp() != EQUAL_TO) {
         continue;
@@ -178,6 +345,7 @@ RC PhysicalPlanGenerator::create_plan(TableGetLogicalOperator &table_get_oper, u
       }
 
       FieldExpr *field_expr = nullptr;
+      ValueExpr *value_expr = nullptr;
       if (left_expr->type() == ExprType::FIELD) {
         ASSERT(right_expr->type() == ExprType::VALUE, "right expr should be a value expr while left is field expr");
         field_expr = static_cast<FieldExpr *>(left_expr.get());
@@ -192,32 +360,60 @@ RC PhysicalPlanGenerator::create_plan(TableGetLogicalOperator &table_get_oper, u
         continue;
       }
 
-      const Field &field = field_expr->field();
-      index              = table->find_index_by_field(field.field_name());
-      if (nullptr != index) {
-        break;
-      }
+      equal_conditions.emplace_back(field_expr->field().meta(), &value_expr->get_value());
     }
   }
 
-  if (index != nullptr) {
-    ASSERT(value_expr != nullptr, "got an index but value expr is null ?");
+  vector<Value> prefix_values;
+  Index        *index = choose_index(*table, equal_conditions, prefix_values);
+  vector<Value> in_values;
+  if (index == nullptr) {
+    index = choose_in_index(*table, in_conditions, in_values);
+  }
 
-    const Value               &value           = value_expr->get_value();
-    IndexScanPhysicalOperator *index_scan_oper = new IndexScanPhysicalOperator(table,
+  if (index != nullptr && !in_values.empty()) {
+    auto index_scan_oper = new IndexScanPhysicalOperator(table,
         index,
         table_get_oper.read_write_mode(),
-        &value,
+        nullptr /*left_value*/,
         true /*left_inclusive*/,
-        &value,
+        nullptr /*right_value*/,
         true /*right_inclusive*/);
+    index_scan_oper->set_in_values(std::move(in_values));
+    index_scan_oper->set_predicates(std::move(predicates));
+    oper = unique_ptr<PhysicalOperator>(index_scan_oper);
+    LOG_TRACE("use index scan with in list");
+  } else if (index != nullptr) {
+    IndexScanPhysicalOperator *index_scan_oper = nullptr;
+    if (index->field_metas().size() == 1) {
+      const Value &value = prefix_values[0];
+      index_scan_oper    = new IndexScanPhysicalOperator(table,
+          index,
+          table_get_oper.read_write_mode(),
+          &value,
+          true /*left_inclusive*/,
+          &value,
+          true /*right_inclusive*/);
+    } else {
+      // 多个字段的索引使用前缀扫描
+      index_scan_oper = new IndexScanPhysicalOperator(table,
+          index,
+          table_get_oper.read_write_mode(),
+          nullptr /*left_value*/,
+          true /*left_inclusive*/,
+          nullptr /*right_value*/,
+          true /*right_inclusive*/);
+      index_scan_oper->set_prefix_values(std::move(prefix_values));
+    }
 
+    index_scan_oper->set_covering(index_covers(table_get_oper, *index));
     index_scan_oper->set_predicates(std::move(predicates));
     oper = unique_ptr<PhysicalOperator>(index_scan_oper);
     LOG_TRACE("use index scan");
   } else {
     auto table_scan_oper = new TableScanPhysicalOperator(table, table_get_oper.read_write_mode());
     table_scan_oper->set_table_alias(table_get_oper.table_alias());
+    table_scan_oper->set_parallel_threads(parallel_scan_threads(table_get_oper));
     table_scan_oper->set_predicates(std::move(predicates));
     oper = unique_ptr<PhysicalOperator>(table_scan_oper);
     LOG_TRACE("use table scan");
@@ -465,7 +661,9 @@ RC PhysicalPlanGenerator::create_vec_plan(TableGetLogicalOperator &table_get_ope
   Table                          *table      = table_get_oper.table();
   TableScanVecPhysicalOperator   *table_scan_oper =
       new TableScanVecPhysicalOperator(table, table_get_oper.read_write_mode());
+  table_scan_oper->set_parallel_threads(parallel_scan_threads(table_get_oper));
   table_scan_oper->set_predicates(std::move(predicates));
+  table_scan_oper->set_projection(table_get_oper.projection());
   oper = unique_ptr<PhysicalOperator>(table_scan_oper);
   LOG_TRACE("use vectorized table scan");
 
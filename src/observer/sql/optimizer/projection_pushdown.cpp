@@ -0,0 +1,134 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "sql/optimizer/projection_pushdown.h"
+#include "common/log/log.h"
+#include "sql/expr/expression.h"
+#include "sql/expr/expression_iterator.h"
+#include "sql/operator/group_by_logical_operator.h"
+#include "sql/operator/logical_operator.h"
+#include "sql/operator/table_get_logical_operator.h"
+#include "storage/table/table.h"
+
+RC ProjectionPushdown::optimize(LogicalOperator &root)
+{
+  fields_.clear();
+  if (!collect_fields(root)) {
+    LOG_TRACE("cannot pushdown projection, all columns will be read");
+    return RC::SUCCESS;
+  }
+
+  apply(root);
+  return RC::SUCCESS;
+}
+
+bool ProjectionPushdown::collect_fields(LogicalOperator &oper)
+{
+  for (unique_ptr<Expression> &expr : oper.expressions()) {
+    if (expr && !collect_fields(*expr)) {
+      return false;
+    }
+  }
+
+  switch (oper.type()) {
+    case LogicalOperatorType::TABLE_GET: {
+      auto &table_get_oper = static_cast<TableGetLogicalOperator &>(oper);
+      for (unique_ptr<Expression> &expr : table_get_oper.predicates()) {
+        if (expr && !collect_fields(*expr)) {
+          return false;
+        }
+      }
+    } break;
+
+    case LogicalOperatorType::GROUP_BY: {
+      auto &group_by_oper = static_cast<GroupByLogicalOperator &>(oper);
+      for (unique_ptr<Expression> &expr : group_by_oper.group_by_expressions()) {
+        if (expr && !collect_fields(*expr)) {
+          return false;
+        }
+      }
+      for (Expression *expr : group_by_oper.aggregate_expressions()) {
+        if (expr && !collect_fields(*expr)) {
+          return false;
+        }
+      }
+    } break;
+
+    default: break;
+  }
+
+  for (unique_ptr<LogicalOperator> &child : oper.children()) {
+    if (!collect_fields(*child)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ProjectionPushdown::collect_fields(Expression &expr)
+{
+  switch (expr.type()) {
+    case ExprType::FIELD: {
+      auto &field_expr = static_cast<FieldExpr &>(expr);
+      fields_[field_expr.field().table()].insert(field_expr.field().meta()->field_id());
+      return true;
+    }
+
+    // 这些表达式要么没有展开，要么 ExpressionIterator 不会访问它们的参数，不知道它们引用了哪些字段
+    case ExprType::STAR:
+    case ExprType::UNBOUND_FIELD:
+    case ExprType::UNBOUND_AGGREGATION:
+    case ExprType::IS:
+    case ExprType::LIKE:
+    case ExprType::SUB_QUERY: return false;
+
+    default: break;
+  }
+
+  bool supported = true;
+  RC   rc        = ExpressionIterator::iterate_child_expr(expr, [this, &supported](unique_ptr<Expression> &child) {
+    if (child && !collect_fields(*child)) {
+      supported = false;
+      return RC::UNSUPPORTED;
+    }
+    return RC::SUCCESS;
+  });
+  return OB_SUCC(rc) && supported;
+}
+
+void ProjectionPushdown::apply(LogicalOperator &oper)
+{
+  if (oper.type() == LogicalOperatorType::TABLE_GET) {
+    auto &table_get_oper = static_cast<TableGetLogicalOperator &>(oper);
+    // 修改数据时需要完整的记录
+    if (table_get_oper.read_write_mode() == ReadWriteMode::READ_ONLY) {
+      vector<int> field_ids;
+      auto        iter = fields_.find(table_get_oper.table());
+      if (iter != fields_.end()) {
+        field_ids.assign(iter->second.begin(), iter->second.end());
+      } else {
+        // 比如 count(*)，不需要任何字段，但是仍然需要知道有多少行，就读取一个最短的列
+        const TableMeta &table_meta = table_get_oper.table()->table_meta();
+        int              field_id   = 0;
+        for (int i = 1; i < table_meta.field_num(); i++) {
+          if (table_meta.field(i)->len() < table_meta.field(field_id)->len()) {
+            field_id = i;
+          }
+        }
+        field_ids.push_back(table_meta.field(field_id)->field_id());
+      }
+      table_get_oper.set_projection(std::move(field_ids));
+    }
+  }
+
+  for (unique_ptr<LogicalOperator> &child : oper.children()) {
+    apply(*child);
+  }
+}
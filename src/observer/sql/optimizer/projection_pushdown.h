@@ -0,0 +1,46 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include "common/lang/set.h"
+#include "common/lang/unordered_map.h"
+#include "common/sys/rc.h"
+
+class Expression;
+class LogicalOperator;
+class Table;
+
+/**
+ * @brief 将投影下推到表数据扫描中
+ * @ingroup Rewriter
+ * @details 收集整个逻辑计划中所有表达式引用到的字段，记录到对应的 TableGetLogicalOperator 中，
+ * 向量化的表扫描只会读取这些列。
+ * 与 RewriteRule 不同，它需要看到完整的计划，所以只能在计划的根节点上执行一次。
+ * 遇到无法分析的表达式(比如子查询)时，不做任何修改，表扫描会读取所有的列。
+ */
+class ProjectionPushdown
+{
+public:
+  ProjectionPushdown()  = default;
+  ~ProjectionPushdown() = default;
+
+  RC optimize(LogicalOperator &root);
+
+private:
+  /// 收集算子及其子算子中引用的字段，遇到无法分析的表达式时返回 false
+  bool collect_fields(LogicalOperator &oper);
+  bool collect_fields(Expression &expr);
+
+  void apply(LogicalOperator &oper);
+
+private:
+  unordered_map<const Table *, set<int>> fields_;  ///< 每张表被引用的字段ID
+};
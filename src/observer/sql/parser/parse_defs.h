@@ -242,13 +242,15 @@ struct DropTableSqlNode
  * @brief 描述一个create index语句
  * @ingroup SQLParser
  * @details 创建索引时，需要指定索引名，表名，字段名。
- * 正常的SQL语句中，一个索引可能包含了多个字段，这里仅支持一个字段。
+ * 一个索引可以包含多个字段，还可以通过 INCLUDE 指定只存放在索引中的字段，比如
+ * `CREATE INDEX i ON t(a, b) INCLUDE(c)`
  */
 struct CreateIndexSqlNode
 {
-  string index_name;      ///< Index name
-  string relation_name;   ///< Relation name
-  string attribute_name;  ///< Attribute name
+  string         index_name;       ///< Index name
+  string         relation_name;    ///< Relation name
+  vector<string> attribute_names;  ///< Attribute names
+  vector<string> include_names;    ///< Include attribute names
 };
 
 /**
@@ -271,6 +273,16 @@ struct DescTableSqlNode
   string relation_name;
 };
 
+/**
+ * @brief 描述一个vacuum语句
+ * @ingroup SQLParser
+ * @details 整理表的数据文件，合并稀疏的页面并释放空的页面
+ */
+struct VacuumSqlNode
+{
+  string relation_name;
+};
+
 /**
  * @brief 描述一个load data语句
  * @ingroup SQLParser
@@ -347,6 +359,7 @@ enum SqlCommandFlag
   SCF_EXIT,
   SCF_EXPLAIN,
   SCF_SET_VARIABLE,  ///< 设置变量
+  SCF_VACUUM,        ///< 整理表的数据文件
 };
 /**
  * @brief 表示一个SQL语句
@@ -370,6 +383,7 @@ public:
   LoadDataSqlNode     load_data;
   ExplainSqlNode      explain;
   SetVariableSqlNode  set_variable;
+  VacuumSqlNode       vacuum;
 
 public:
   ParsedSqlNode();
@@ -84,6 +84,7 @@ UnboundAggregateExpr *create_aggregate_expression(const char *aggregate_name,
         TABLE
         TABLES
         INDEX
+        INCLUDE
         CALC
         SELECT
         DESC
@@ -123,6 +124,7 @@ UnboundAggregateExpr *create_aggregate_expression(const char *aggregate_name,
         DATA
         INFILE
         EXPLAIN
+        VACUUM
         STORAGE
         FORMAT
         AS
@@ -154,6 +156,7 @@ UnboundAggregateExpr *create_aggregate_expression(const char *aggregate_name,
   vector<Value> *                       value_list;
   vector<ConditionSqlNode> *            condition_list;
   vector<RelAttrSqlNode> *              rel_attr_list;
+  vector<string> *                      id_list;
   vector<RelationSqlNode> *                 relation_list;
   vector<JoinSqlNode> *                 join_list;
   char *                                     cstring;
@@ -188,6 +191,8 @@ UnboundAggregateExpr *create_aggregate_expression(const char *aggregate_name,
 %type <join_list>           join_list
 %type <cstring>             storage_format
 %type <relation_list>       rel_list
+%type <id_list>             id_list
+%type <id_list>             index_include
 %type <expression>          expression
 %type <expression>          aggregate_func
 %type <expression>          sys_func
@@ -212,6 +217,7 @@ UnboundAggregateExpr *create_aggregate_expression(const char *aggregate_name,
 %type <sql_node>            load_data_stmt
 %type <sql_node>            explain_stmt
 %type <sql_node>            set_variable_stmt
+%type <sql_node>            vacuum_stmt
 %type <sql_node>            help_stmt
 %type <sql_node>            exit_stmt
 %type <sql_node>            command_wrapper
@@ -251,6 +257,7 @@ command_wrapper:
   | load_data_stmt
   | explain_stmt
   | set_variable_stmt
+  | vacuum_stmt
   | help_stmt
   | exit_stmt
     ;
@@ -319,15 +326,51 @@ desc_table_stmt:
     }
     ;
 
+vacuum_stmt:
+    VACUUM ID {
+      $$ = new ParsedSqlNode(SCF_VACUUM);
+      context->add_object($$);
+      $$->vacuum.relation_name = $2;
+    }
+    ;
+
 create_index_stmt:    /*create index 语句的语法解析树*/
-    CREATE INDEX ID ON ID LBRACE ID RBRACE
+    CREATE INDEX ID ON ID LBRACE id_list RBRACE index_include
     {
       $$ = new ParsedSqlNode(SCF_CREATE_INDEX);
       context->add_object($$);
       CreateIndexSqlNode &create_index = $$->create_index;
       create_index.index_name = $3;
       create_index.relation_name = $5;
-      create_index.attribute_name = $7;
+      create_index.attribute_names.swap(*$7);
+      if ($9 != nullptr) {
+        create_index.include_names.swap(*$9);
+      }
+    }
+    ;
+
+index_include:
+    /* empty */
+    {
+      $$ = nullptr;
+    }
+    | INCLUDE LBRACE id_list RBRACE
+    {
+      $$ = $3;
+    }
+    ;
+
+id_list:
+    ID
+    {
+      $$ = new vector<string>;
+      context->add_object($$);
+      $$->push_back($1);
+    }
+    | id_list COMMA ID
+    {
+      $$ = $1;
+      $$->push_back($3);
     }
     ;
 
@@ -15,7 +15,9 @@ See the Mulan PSL v2 for more details. */
 #include "sql/stmt/create_index_stmt.h"
 #include "common/lang/string.h"
 #include "common/log/log.h"
+#include "common/lang/algorithm.h"
 #include "storage/db/db.h"
+#include "storage/index/bplus_tree.h"
 #include "storage/table/table.h"
 
 using namespace std;
@@ -26,10 +28,9 @@ RC CreateIndexStmt::create(Db *db, const CreateIndexSqlNode &create_index, Stmt
   stmt = nullptr;
 
   const char *table_name = create_index.relation_name.c_str();
-  if (is_blank(table_name) || is_blank(create_index.index_name.c_str()) ||
-      is_blank(create_index.attribute_name.c_str())) {
-    LOG_WARN("invalid argument. db=%p, table_name=%p, index name=%s, attribute name=%s",
-        db, table_name, create_index.index_name.c_str(), create_index.attribute_name.c_str());
+  if (is_blank(table_name) || is_blank(create_index.index_name.c_str()) || create_index.attribute_names.empty()) {
+    LOG_WARN("invalid argument. db=%p, table_name=%p, index name=%s, attribute num=%d",
+        db, table_name, create_index.index_name.c_str(), static_cast<int>(create_index.attribute_names.size()));
     return RC::INVALID_ARGUMENT;
   }
 
@@ -40,11 +41,34 @@ RC CreateIndexStmt::create(Db *db, const CreateIndexSqlNode &create_index, Stmt
     return RC::SCHEMA_TABLE_NOT_EXIST;
   }
 
-  const FieldMeta *field_meta = table->table_meta().field(create_index.attribute_name.c_str());
-  if (nullptr == field_meta) {
-    LOG_WARN("no such field in table. db=%s, table=%s, field name=%s", 
-             db->name(), table_name, create_index.attribute_name.c_str());
-    return RC::SCHEMA_FIELD_NOT_EXIST;
+  vector<const FieldMeta *> field_metas;
+  vector<const FieldMeta *> include_field_metas;
+  for (auto [attribute_names, metas] : {pair(&create_index.attribute_names, &field_metas),
+           pair(&create_index.include_names, &include_field_metas)}) {
+    for (const string &attribute_name : *attribute_names) {
+      const FieldMeta *field_meta = table->table_meta().field(attribute_name.c_str());
+      if (nullptr == field_meta) {
+        LOG_WARN("no such field in table. db=%s, table=%s, field name=%s", 
+                 db->name(), table_name, attribute_name.c_str());
+        return RC::SCHEMA_FIELD_NOT_EXIST;
+      }
+
+      // 一个字段在索引中只能出现一次
+      auto same_field = [field_meta](const FieldMeta *meta) { return meta == field_meta; };
+      if (any_of(field_metas.begin(), field_metas.end(), same_field) ||
+          any_of(include_field_metas.begin(), include_field_metas.end(), same_field)) {
+        LOG_WARN("duplicate field in index. table=%s, field name=%s", table_name, attribute_name.c_str());
+        return RC::INVALID_ARGUMENT;
+      }
+      metas->push_back(field_meta);
+    }
+  }
+
+  if (field_metas.size() + include_field_metas.size() > static_cast<size_t>(IndexFileHeader::MAX_ATTR_NUM)) {
+    LOG_WARN("too many fields in index. table=%s, field num=%d, max=%d",
+             table_name, static_cast<int>(field_metas.size() + include_field_metas.size()),
+             IndexFileHeader::MAX_ATTR_NUM);
+    return RC::INVALID_ARGUMENT;
   }
 
   Index *index = table->find_index(create_index.index_name.c_str());
@@ -53,6 +77,6 @@ RC CreateIndexStmt::create(Db *db, const CreateIndexSqlNode &create_index, Stmt
     return RC::SCHEMA_INDEX_NAME_REPEAT;
   }
 
-  stmt = new CreateIndexStmt(table, field_meta, create_index.index_name);
+  stmt = new CreateIndexStmt(table, std::move(field_metas), std::move(include_field_metas), create_index.index_name);
   return RC::SUCCESS;
 }
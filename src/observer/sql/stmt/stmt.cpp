@@ -31,6 +31,7 @@ See the Mulan PSL v2 for more details. */
 #include "sql/stmt/trx_begin_stmt.h"
 #include "sql/stmt/trx_end_stmt.h"
 #include "sql/stmt/drop_table_stmt.h"
+#include "sql/stmt/vacuum_stmt.h"
 
 bool stmt_type_ddl(StmtType type)
 {
@@ -118,6 +119,10 @@ RC Stmt::create_stmt(Db *db, ParsedSqlNode &sql_node, Stmt *&stmt)
       return UpdateStmt::create(db, sql_node.update, stmt);
     }
 
+    case SCF_VACUUM: {
+      return VacuumStmt::create(db, sql_node.vacuum, stmt);
+    }
+
     default: {
       LOG_INFO("Command::type %d doesn't need to create statement.", sql_node.flag);
     } break;
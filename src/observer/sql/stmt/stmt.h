@@ -50,7 +50,8 @@ class Db;
   DEFINE_ENUM_ITEM(EXIT)         \
   DEFINE_ENUM_ITEM(EXPLAIN)      \
   DEFINE_ENUM_ITEM(PREDICATE)    \
-  DEFINE_ENUM_ITEM(SET_VARIABLE)
+  DEFINE_ENUM_ITEM(SET_VARIABLE) \
+  DEFINE_ENUM_ITEM(VACUUM)
 
 enum class StmtType
 {
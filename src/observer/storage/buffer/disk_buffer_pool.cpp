@@ -17,6 +17,7 @@ See the Mulan PSL v2 for more details. */
 #include "common/io/io.h"
 #include "common/lang/mutex.h"
 #include "common/lang/algorithm.h"
+#include "common/lang/limits.h"
 #include "common/log/log.h"
 #include "common/math/crc.h"
 #include "storage/buffer/disk_buffer_pool.h"
@@ -40,56 +41,111 @@ string BPFileHeader::to_string() const
 
 BPFrameManager::BPFrameManager(const char *name) : allocator_(name) {}
 
-RC BPFrameManager::init(int pool_num)
+RC BPFrameManager::init(int pool_num, int shard_num /* = DEFAULT_SHARD_NUM */,
+    const string &replacer /* = DEFAULT_REPLACER */)
 {
   int ret = allocator_.init(false, pool_num);
-  if (ret == 0) {
-    return RC::SUCCESS;
+  if (ret != 0) {
+    return RC::NOMEM;
+  }
+
+  string replacer_name = replacer;
+  if (FrameReplacer::create(replacer_name) == nullptr) {
+    LOG_WARN("unknown frame replacer %s, use %s instead", replacer.c_str(), DEFAULT_REPLACER);
+    replacer_name = DEFAULT_REPLACER;
   }
-  return RC::NOMEM;
+
+  shard_num = max(min(shard_num, allocator_.get_size()), 1);
+  for (int i = 0; i < shard_num; i++) {
+    auto shard      = make_unique<Shard>();
+    shard->replacer = FrameReplacer::create(replacer_name);
+    shards_.push_back(std::move(shard));
+  }
+
+  // 页帧内存一次性申请好，平均分配到每个分片的空闲链表中
+  int    index = 0;
+  Frame *frame = nullptr;
+  while ((frame = allocator_.alloc()) != nullptr) {
+    shards_[index++ % shard_num]->free_frames.push_back(frame);
+  }
+  return RC::SUCCESS;
 }
 
 RC BPFrameManager::cleanup()
 {
-  if (frames_.count() > 0) {
+  if (frame_num() > 0) {
     return RC::INTERNAL;
   }
 
-  frames_.destroy();
+  for (auto &shard : shards_) {
+    shard->frames.clear();
+  }
   return RC::SUCCESS;
 }
 
-int BPFrameManager::purge_frames(int count, function<RC(Frame *frame)> purger)
+BPFrameManager::Shard &BPFrameManager::shard_of(const FrameId &frame_id)
 {
-  lock_guard<mutex> lock_guard(lock_);
+  return *shards_[frame_id.hash() % shards_.size()];
+}
 
-  vector<Frame *> frames_can_purge;
+int BPFrameManager::purge_frames(int count, function<RC(Frame *frame)> purger)
+{
   if (count <= 0) {
     count = 1;
   }
+
+  // 优先淘汰快要被淘汰的那些页面中干净的页面，这样不需要写磁盘。刷脏线程会在后台把这些脏页刷掉
+  // 每次从不同的分片开始查找，不让淘汰总是集中在某一个分片上
+  const size_t start       = purge_cursor_.fetch_add(1);
+  int          freed_count = 0;
+  for (bool clean_only : {true, false}) {
+    for (size_t i = 0; i < shards_.size() && freed_count < count; i++) {
+      Shard &shard = *shards_[(start + i) % shards_.size()];
+      freed_count += purge_shard_frames(shard, count - freed_count, clean_only, purger);
+    }
+  }
+  LOG_INFO("purge frame done. number=%d", freed_count);
+  return freed_count;
+}
+
+int BPFrameManager::purge_shard_frames(Shard &shard, int count, bool clean_only, function<RC(Frame *frame)> &purger)
+{
+  lock_guard<mutex> lock_guard(shard.lock);
+
+  vector<Frame *> frames_can_purge;
   frames_can_purge.reserve(count);
 
-  auto purge_finder = [&frames_can_purge, count](const FrameId &frame_id, Frame *const frame) {
-    if (frame->can_purge()) {
+  const int scan_depth = max(static_cast<int>(shard.frames.size()) / CLEAN_VICTIM_SCAN_RATIO, count);
+  int       scanned    = 0;
+
+  auto purge_finder = [&frames_can_purge, &scanned, scan_depth, count, clean_only](Frame *frame) {
+    if (!frame->can_purge()) {
+      return true;
+    }
+
+    if (!clean_only || !frame->dirty()) {
       frame->pin();
       frames_can_purge.push_back(frame);
       if (frames_can_purge.size() >= static_cast<size_t>(count)) {
         return false;  // false to break the progress
       }
     }
-    return true;  // true continue to look up
+    return !clean_only || ++scanned < scan_depth;  // true continue to look up
   };
 
-  frames_.foreach_reverse(purge_finder);
+  shard.replacer->foreach_victim(purge_finder);
+  if (frames_can_purge.empty()) {
+    return 0;
+  }
   LOG_INFO("purge frames find %ld pages total", frames_can_purge.size());
 
-  /// 当前还在frameManager的锁内，而 purger 是一个非常耗时的操作
-  /// 他需要把脏页数据刷新到磁盘上去，所以这里会极大地降低并发度
+  /// 当前还在分片的锁内，而 purger 是一个非常耗时的操作
+  /// 他需要把脏页数据刷新到磁盘上去，所以这里会降低这个分片的并发度
   int freed_count = 0;
   for (Frame *frame : frames_can_purge) {
     RC rc = purger(frame);
     if (RC::SUCCESS == rc) {
-      free_internal(frame->frame_id(), frame);
+      free_internal(shard, frame->frame_id(), frame);
       freed_count++;
     } else {
       frame->unpin();
@@ -97,103 +153,302 @@ int BPFrameManager::purge_frames(int count, function<RC(Frame *frame)> purger)
                frame->frame_id().to_string().c_str(), strrc(rc));
     }
   }
-  LOG_INFO("purge frame done. number=%d", freed_count);
   return freed_count;
 }
 
 Frame *BPFrameManager::get(int buffer_pool_id, PageNum page_num)
 {
   FrameId frame_id(buffer_pool_id, page_num);
+  Shard  &shard = shard_of(frame_id);
 
-  lock_guard<mutex> lock_guard(lock_);
-  return get_internal(frame_id);
+  lock_guard<mutex> lock_guard(shard.lock);
+  Frame            *frame = get_internal(shard, frame_id);
+  if (frame != nullptr) {
+    shard.hit_count.fetch_add(1, memory_order_relaxed);
+  } else {
+    shard.miss_count.fetch_add(1, memory_order_relaxed);
+  }
+  return frame;
 }
 
-Frame *BPFrameManager::get_internal(const FrameId &frame_id)
+Frame *BPFrameManager::get_internal(Shard &shard, const FrameId &frame_id)
 {
-  Frame *frame = nullptr;
-  (void)frames_.get(frame_id, frame);
-  if (frame != nullptr) {
-    frame->pin();
-    LOG_DEBUG("got a frame. frame=%s", frame->to_string().c_str());
+  auto iter = shard.frames.find(frame_id);
+  if (iter == shard.frames.end()) {
+    return nullptr;
   }
+
+  Frame *frame = iter->second;
+  shard.replacer->access(frame);
+  frame->pin();
+  LOG_DEBUG("got a frame. frame=%s", frame->to_string().c_str());
   return frame;
 }
 
-Frame *BPFrameManager::alloc(int buffer_pool_id, PageNum page_num)
+bool BPFrameManager::contains(int buffer_pool_id, PageNum page_num)
 {
   FrameId frame_id(buffer_pool_id, page_num);
+  Shard  &shard = shard_of(frame_id);
 
-  lock_guard<mutex> lock_guard(lock_);
+  lock_guard<mutex> lock_guard(shard.lock);
+  return shard.frames.find(frame_id) != shard.frames.end();
+}
 
-  Frame *frame = get_internal(frame_id);
-  if (frame != nullptr) {
-    return frame;
+Frame *BPFrameManager::alloc(int buffer_pool_id, PageNum page_num, bool *allocated /* = nullptr */)
+{
+  FrameId frame_id(buffer_pool_id, page_num);
+  Shard  &shard = shard_of(frame_id);
+
+  bool dummy_allocated = false;
+  if (allocated == nullptr) {
+    allocated = &dummy_allocated;
   }
+  *allocated = false;
+
+  {
+    lock_guard<mutex> lock_guard(shard.lock);
 
-  frame = allocator_.alloc();
+    Frame *frame = get_internal(shard, frame_id);
+    if (frame != nullptr) {
+      return frame;
+    }
+
+    if (!shard.free_frames.empty()) {
+      frame = shard.free_frames.back();
+      shard.free_frames.pop_back();
+      *allocated = true;
+      return alloc_internal(shard, frame_id, frame);
+    }
+  }
+
+  // 当前分片没有空闲页帧了，从其它分片拿一个过来。不能同时持有两个分片的锁，否则可能死锁
+  Frame *free_frame = steal_free_frame(shard);
+  if (free_frame == nullptr) {
+    return nullptr;
+  }
+
+  lock_guard<mutex> lock_guard(shard.lock);
+
+  // 释放锁的这段时间内，其他线程可能已经加载了这个页面
+  Frame *frame = get_internal(shard, frame_id);
   if (frame != nullptr) {
-    ASSERT(frame->pin_count() == 0, "got an invalid frame that pin count is not 0. frame=%s", 
-           frame->to_string().c_str());
-    frame->set_buffer_pool_id(buffer_pool_id);
-    frame->set_page_num(page_num);
-    frame->pin();
-    frames_.put(frame_id, frame);
-    LOG_DEBUG("allocate a new frame. frame=%s", frame->to_string().c_str());
+    shard.free_frames.push_back(free_frame);
+    return frame;
   }
+  *allocated = true;
+  return alloc_internal(shard, frame_id, free_frame);
+}
+
+Frame *BPFrameManager::alloc_internal(Shard &shard, const FrameId &frame_id, Frame *frame)
+{
+  frame->reinit();
+  ASSERT(frame->pin_count() == 0, "got an invalid frame that pin count is not 0. frame=%s", 
+         frame->to_string().c_str());
+  frame->set_buffer_pool_id(frame_id.buffer_pool_id());
+  frame->set_page_num(frame_id.page_num());
+  frame->pin();
+  shard.frames.emplace(frame_id, frame);
+  shard.replacer->insert(frame_id, frame);
+  LOG_DEBUG("allocate a new frame. frame=%s", frame->to_string().c_str());
   return frame;
 }
 
+Frame *BPFrameManager::steal_free_frame(Shard &thief)
+{
+  for (auto &shard : shards_) {
+    if (shard.get() == &thief) {
+      continue;
+    }
+
+    lock_guard<mutex> lock_guard(shard->lock);
+    if (!shard->free_frames.empty()) {
+      Frame *frame = shard->free_frames.back();
+      shard->free_frames.pop_back();
+      return frame;
+    }
+  }
+  return nullptr;
+}
+
 RC BPFrameManager::free(int buffer_pool_id, PageNum page_num, Frame *frame)
 {
   FrameId frame_id(buffer_pool_id, page_num);
+  Shard  &shard = shard_of(frame_id);
 
-  lock_guard<mutex> lock_guard(lock_);
-  return free_internal(frame_id, frame);
+  lock_guard<mutex> lock_guard(shard.lock);
+  return free_internal(shard, frame_id, frame);
 }
 
-RC BPFrameManager::free_internal(const FrameId &frame_id, Frame *frame)
+RC BPFrameManager::try_free(int buffer_pool_id, PageNum page_num, Frame *frame)
 {
-  Frame                *frame_source = nullptr;
-  [[maybe_unused]] bool found        = frames_.get(frame_id, frame_source);
+  FrameId frame_id(buffer_pool_id, page_num);
+  Shard  &shard = shard_of(frame_id);
+
+  lock_guard<mutex> lock_guard(shard.lock);
+  if (frame->pin_count() != 1) {
+    return RC::LOCKED_UNLOCK;
+  }
+  return free_internal(shard, frame_id, frame);
+}
+
+RC BPFrameManager::free_internal(Shard &shard, const FrameId &frame_id, Frame *frame)
+{
+  auto                  iter         = shard.frames.find(frame_id);
+  [[maybe_unused]] bool found        = iter != shard.frames.end();
+  Frame                *frame_source = found ? iter->second : nullptr;
   ASSERT(found && frame == frame_source && frame->pin_count() == 1,
       "failed to free frame. found=%d, frameId=%s, frame_source=%p, frame=%p, pinCount=%d, lbt=%s",
       found, frame_id.to_string().c_str(), frame_source, frame, frame->pin_count(), lbt());
 
   frame->set_page_num(-1);
   frame->unpin();
-  frames_.remove(frame_id);
-  allocator_.free(frame);
+  shard.frames.erase(iter);
+  shard.replacer->remove(frame_id, frame);
+  frame->reset();
+  shard.free_frames.push_back(frame);
   return RC::SUCCESS;
 }
 
-list<Frame *> BPFrameManager::find_list(int buffer_pool_id)
+void BPFrameManager::pick_dirty_frames(int watermark, int max_count, vector<Frame *> &frames, vector<Page> &pages)
 {
-  lock_guard<mutex> lock_guard(lock_);
+  // 还没有使用过的页帧，可以直接分配
+  int clean_count = 0;
+  for (auto &shard : shards_) {
+    lock_guard<mutex> lock_guard(shard->lock);
+    clean_count += static_cast<int>(shard->free_frames.size());
+  }
+  if (clean_count >= watermark) {
+    return;
+  }
 
-  list<Frame *> frames;
-  auto          fetcher = [&frames, buffer_pool_id](const FrameId &frame_id, Frame *const frame) -> bool {
-    if (buffer_pool_id == frame_id.buffer_pool_id()) {
+  auto picker = [&](Frame *frame) -> bool {
+    if (!frame->can_purge()) {
+      return true;
+    }
+
+    if (!frame->dirty()) {
+      clean_count++;
+    } else {
+      // 页面没有被使用，也就不会有人修改，可以放心地拷贝
       frame->pin();
       frames.push_back(frame);
+      pages.push_back(frame->page());
     }
-    return true;
+    return clean_count + static_cast<int>(frames.size()) < watermark && static_cast<int>(frames.size()) < max_count;
   };
-  frames_.foreach (fetcher);
+
+  // 每个分片都有自己的置换策略，每次从不同的分片开始，依次按照淘汰顺序查找
+  const size_t start = clean_cursor_.fetch_add(1);
+  for (size_t i = 0; i < shards_.size(); i++) {
+    if (clean_count + static_cast<int>(frames.size()) >= watermark || static_cast<int>(frames.size()) >= max_count) {
+      break;
+    }
+
+    Shard            &shard = *shards_[(start + i) % shards_.size()];
+    lock_guard<mutex> lock_guard(shard.lock);
+    shard.replacer->foreach_victim(picker);
+  }
+}
+
+bool BPFrameManager::finish_clean(Frame *frame, const Page &page)
+{
+  Shard            &shard = shard_of(frame->frame_id());
+  lock_guard<mutex> lock_guard(shard.lock);
+
+  // 只有刷脏线程在使用这个页面，并且页面内容与写到磁盘上的一样，才可以清除脏标识
+  bool cleaned = false;
+  if (frame->pin_count() == 1 && frame->dirty() && frame->lsn() == page.lsn &&
+      memcmp(frame->data(), page.data, BP_PAGE_DATA_SIZE) == 0) {
+    frame->set_check_sum(page.check_sum);
+    frame->clear_dirty();
+    cleaned = true;
+  }
+  frame->unpin();
+  return cleaned;
+}
+
+LSN BPFrameManager::min_rec_lsn()
+{
+  LSN min_lsn = 0;
+  for (auto &shard : shards_) {
+    lock_guard<mutex> lock_guard(shard->lock);
+    for (auto &[frame_id, frame] : shard->frames) {
+      LSN rec_lsn = frame->rec_lsn();
+      if (rec_lsn > 0 && (min_lsn == 0 || rec_lsn < min_lsn)) {
+        min_lsn = rec_lsn;
+      }
+    }
+  }
+  return min_lsn;
+}
+
+list<Frame *> BPFrameManager::find_list(int buffer_pool_id)
+{
+  list<Frame *> frames;
+  for (auto &shard : shards_) {
+    lock_guard<mutex> lock_guard(shard->lock);
+    for (auto &[frame_id, frame] : shard->frames) {
+      if (buffer_pool_id == frame_id.buffer_pool_id()) {
+        frame->pin();
+        frames.push_back(frame);
+      }
+    }
+  }
   return frames;
 }
 
+size_t BPFrameManager::frame_num() const
+{
+  size_t count = 0;
+  for (auto &shard : shards_) {
+    count += shard->frames.size();
+  }
+  return count;
+}
+
+const char *BPFrameManager::replacer_name() const
+{
+  return shards_.empty() ? DEFAULT_REPLACER : shards_.front()->replacer->name();
+}
+
+int64_t BPFrameManager::hit_count() const
+{
+  int64_t count = 0;
+  for (auto &shard : shards_) {
+    count += shard->hit_count.load(memory_order_relaxed);
+  }
+  return count;
+}
+
+int64_t BPFrameManager::miss_count() const
+{
+  int64_t count = 0;
+  for (auto &shard : shards_) {
+    count += shard->miss_count.load(memory_order_relaxed);
+  }
+  return count;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 BufferPoolIterator::BufferPoolIterator() {}
 BufferPoolIterator::~BufferPoolIterator() {}
-RC BufferPoolIterator::init(DiskBufferPool &bp, PageNum start_page /* = 0 */)
+RC BufferPoolIterator::init(
+    DiskBufferPool &bp, PageNum start_page /* = 0 */, bool read_ahead /* = false */, PageNum end_page /* = -1 */)
 {
-  bitmap_.init(bp.file_header_->bitmap, bp.file_header_->page_count);
+  int page_count = bp.file_header_->page_count;
+  if (end_page >= 0) {
+    page_count = min(page_count, end_page);
+  }
+  bitmap_.init(bp.file_header_->bitmap, page_count);
   if (start_page <= 0) {
     current_page_num_ = -1;
   } else {
     current_page_num_ = start_page - 1;
   }
+
+  read_ahead_bp_      = read_ahead ? &bp : nullptr;
+  read_ahead_trigger_ = -1;
+  read_ahead_end_     = current_page_num_;
   return RC::SUCCESS;
 }
 
@@ -204,13 +459,47 @@ PageNum BufferPoolIterator::next()
   PageNum next_page = bitmap_.next_setted_bit(current_page_num_ + 1);
   if (next_page != -1) {
     current_page_num_ = next_page;
+    if (read_ahead_bp_ != nullptr && current_page_num_ >= read_ahead_trigger_) {
+      read_ahead();
+    }
   }
   return next_page;
 }
 
+void BufferPoolIterator::read_ahead()
+{
+  const int window = read_ahead_bp_->bp_manager_.page_prefetcher().window();
+  if (window <= 0) {
+    return;
+  }
+
+  vector<PageNum> page_nums;
+  page_nums.reserve(window);
+  PageNum page_num = max(current_page_num_, read_ahead_end_);
+  while (static_cast<int>(page_nums.size()) < window) {
+    page_num = bitmap_.next_setted_bit(page_num + 1);
+    if (page_num == -1) {
+      break;
+    }
+    page_nums.push_back(page_num);
+  }
+
+  if (page_nums.empty()) {
+    // 已经到了文件末尾，不需要再预读了
+    read_ahead_trigger_ = numeric_limits<PageNum>::max();
+    return;
+  }
+
+  read_ahead_trigger_ = page_nums.front();
+  read_ahead_end_     = page_nums.back();
+  read_ahead_bp_->read_ahead(std::move(page_nums));
+}
+
 RC BufferPoolIterator::reset()
 {
-  current_page_num_ = 0;
+  current_page_num_   = 0;
+  read_ahead_trigger_ = -1;
+  read_ahead_end_     = current_page_num_;
   return RC::SUCCESS;
 }
 
@@ -286,6 +575,12 @@ RC DiskBufferPool::close_file()
     return rc;
   }
 
+  // 预读线程可能正在往这个文件的页帧中放页面
+  wait_read_ahead();
+
+  // 刷脏线程可能正在刷这个文件的页面，等它完成这一批
+  unique_lock clean_guard(bp_manager_.page_cleaner().clean_lock());
+
   hdr_frame_->unpin();
 
   // TODO: 理论上是在回放时回滚未提交事务，但目前没有undo log，因此不下刷数据page，只通过redo log回放
@@ -300,6 +595,7 @@ RC DiskBufferPool::close_file()
     LOG_WARN("failed to clear pages in double write buffer. filename=%s, rc=%s", file_name_.c_str(), strrc(rc));
     return rc;
   }
+  clean_guard.unlock();
 
   disposed_pages_.clear();
 
@@ -333,6 +629,7 @@ RC DiskBufferPool::get_this_page(PageNum page_num, Frame **frame)
 
   Frame *used_match_frame = frame_manager_.get(id(), page_num);
   if (used_match_frame != nullptr) {
+    wait_read_ahead_installing();
     used_match_frame->access();
     *frame = used_match_frame;
     return RC::SUCCESS;
@@ -342,8 +639,9 @@ RC DiskBufferPool::get_this_page(PageNum page_num, Frame **frame)
 
   // Allocate one page and load the data into this page
   Frame *allocated_frame = nullptr;
+  bool   allocated       = false;
 
-  rc = allocate_frame(page_num, &allocated_frame);
+  rc = allocate_frame(page_num, &allocated_frame, &allocated);
   if (rc != RC::SUCCESS) {
     LOG_ERROR("Failed to alloc frame %s:%d, due to failed to alloc page.", file_name_.c_str(), page_num);
     return rc;
@@ -353,6 +651,13 @@ RC DiskBufferPool::get_this_page(PageNum page_num, Frame **frame)
   // allocated_frame->pin(); // pined in manager::get
   allocated_frame->access();
 
+  if (!allocated) {
+    // 在加锁之前页面已经被别人(比如预读线程)加载进来了
+    wait_read_ahead_installing();
+    *frame = allocated_frame;
+    return RC::SUCCESS;
+  }
+
   if ((rc = load_page(page_num, allocated_frame)) != RC::SUCCESS) {
     LOG_ERROR("Failed to load page %s:%d", file_name_.c_str(), page_num);
     purge_frame(page_num, allocated_frame);
@@ -459,8 +764,12 @@ RC DiskBufferPool::dispose_page(PageNum page_num)
   scoped_lock lock_guard(lock_);
   Frame      *used_frame = frame_manager_.get(id(), page_num);
   if (used_frame != nullptr) {
-    ASSERT("the page try to dispose is in use. frame:%s", used_frame->to_string().c_str());
-    frame_manager_.free(id(), page_num, used_frame);
+    // B+树的乐观读不加锁就会pin住页面(参考 BplusTreeHandler::optimistic_find_leaf)，这时不能释放页帧，
+    // 只在文件中把页面标记为空闲。读线程校验版本号失败后会放弃这个页面，页帧之后被正常淘汰或者在重新分配页面时复用
+    if (OB_FAIL(frame_manager_.try_free(id(), page_num, used_frame))) {
+      LOG_DEBUG("page is pinned by others while disposing it. frame=%s", used_frame->to_string().c_str());
+      used_frame->unpin();
+    }
   } else {
     LOG_DEBUG("page not found in memory while disposing it. pageNum=%d", page_num);
   }
@@ -595,6 +904,20 @@ RC DiskBufferPool::flush_all_pages()
   return RC::SUCCESS;
 }
 
+RC DiskBufferPool::flush_page_copy(PageNum page_num, Page &page)
+{
+  // 与flush_page_internal不同，日志没有落盘时不能写页面，否则重启后无法恢复
+  RC rc = log_handler_.flush_page(page);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to wait log of page. buffer_pool_id=%d, page_num=%d, lsn=%ld, rc=%s",
+             id(), page_num, page.lsn, strrc(rc));
+    return rc;
+  }
+
+  page.check_sum = crc32(page.data, BP_PAGE_DATA_SIZE);
+  return dblwr_manager_.add_page(this, page_num, page);
+}
+
 RC DiskBufferPool::recover_page(PageNum page_num)
 {
   int byte = 0, bit = 0;
@@ -613,19 +936,167 @@ RC DiskBufferPool::recover_page(PageNum page_num)
 
 RC DiskBufferPool::write_page(PageNum page_num, Page &page)
 {
-  scoped_lock lock_guard(wr_lock_);
-  int64_t     offset = ((int64_t)page_num) * sizeof(Page);
-  if (lseek(file_desc_, offset, SEEK_SET) == -1) {
-    LOG_ERROR("Failed to write page %lld of %d due to failed to seek %s.", offset, file_desc_, strerror(errno));
-    return RC::IOERR_SEEK;
+  PageIoBatch batch;
+  add_write_page(batch, page_num, page);
+  RC rc = bp_manager_.page_io().execute(batch);
+  if (OB_FAIL(rc)) {
+    LOG_ERROR("Failed to write page %s:%d. rc=%s", file_name_.c_str(), page_num, strrc(rc));
+    return rc;
   }
 
-  if (writen(file_desc_, &page, sizeof(Page)) != 0) {
-    LOG_ERROR("Failed to write page %lld of %d due to %s.", offset, file_desc_, strerror(errno));
-    return RC::IOERR_WRITE;
-  }
+  finish_write_pages();
+  return RC::SUCCESS;
+}
+
+void DiskBufferPool::add_write_page(PageIoBatch &batch, PageNum page_num, Page &page)
+{
+  const int64_t offset = static_cast<int64_t>(page_num) * BP_PAGE_SIZE;
+  batch.add_write(file_desc_, offset, &page, BP_PAGE_SIZE);
 
   LOG_TRACE("write_page: buffer_pool_id:%d, page_num:%d, lsn=%d, check_sum=%d", id(), page_num, page.lsn, page.check_sum);
+}
+
+void DiskBufferPool::read_ahead(vector<PageNum> page_nums)
+{
+  {
+    lock_guard guard(read_ahead_lock_);
+    read_ahead_pending_++;
+  }
+
+  RC rc = bp_manager_.page_prefetcher().submit(*this, std::move(page_nums));
+  if (OB_FAIL(rc)) {
+    lock_guard guard(read_ahead_lock_);
+    read_ahead_pending_--;
+    read_ahead_cond_.notify_all();
+  }
+}
+
+void DiskBufferPool::wait_read_ahead()
+{
+  unique_lock guard(read_ahead_lock_);
+  read_ahead_cond_.wait(guard, [this]() { return read_ahead_pending_ == 0; });
+}
+
+void DiskBufferPool::wait_read_ahead_installing()
+{
+  if (read_ahead_installing_.load()) {
+    lock_guard guard(read_ahead_lock_);
+  }
+}
+
+void DiskBufferPool::load_pages_ahead(const vector<PageNum> &page_nums)
+{
+  // 在读取之前记录下来，读取期间如果有页面写到了文件中，读到的页面可能是旧的
+  const uint64_t write_epoch = write_epoch_.load();
+
+  vector<PageNum> missing_pages;
+  missing_pages.reserve(page_nums.size());
+  for (PageNum page_num : page_nums) {
+    if (!frame_manager_.contains(id(), page_num)) {
+      missing_pages.push_back(page_num);
+    }
+  }
+
+  // 连续的页面用一个请求读出来，所有的请求一起提交
+  vector<Page>   pages(missing_pages.size());
+  vector<size_t> run_starts;
+  PageIoBatch    batch;
+  for (size_t start = 0; start < missing_pages.size();) {
+    size_t end = start + 1;
+    while (end < missing_pages.size() && missing_pages[end] == missing_pages[end - 1] + 1) {
+      end++;
+    }
+
+    const int64_t offset = static_cast<int64_t>(missing_pages[start]) * BP_PAGE_SIZE;
+    batch.add_read(file_desc_, offset, &pages[start], static_cast<int64_t>(end - start) * BP_PAGE_SIZE);
+    run_starts.push_back(start);
+    start = end;
+  }
+
+  RC rc = bp_manager_.page_io().execute(batch);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to read pages ahead. file=%s, rc=%s", file_name_.c_str(), strrc(rc));
+  }
+
+  int loaded_count = 0;
+  for (int run = 0; run < batch.size(); run++) {
+    const PageIoRequest &request = batch.request(run);
+    if (OB_FAIL(request.rc)) {
+      continue;
+    }
+
+    // 读到文件末尾时，只有完整读到的页面才能用
+    const size_t start      = run_starts[run];
+    const int    read_count = static_cast<int>(request.done_size / BP_PAGE_SIZE);
+    bool         stale      = false;
+    for (int i = 0; i < read_count; i++) {
+      bool installed = false;
+      rc = install_read_ahead_page(missing_pages[start + i], pages[start + i], write_epoch, installed);
+      if (OB_FAIL(rc)) {
+        // 读到的页面已经过时了，剩下的也不用再放了
+        stale = true;
+        break;
+      }
+      loaded_count += installed ? 1 : 0;
+    }
+    if (stale) {
+      break;
+    }
+  }
+
+  LOG_DEBUG("read ahead pages. file=%s, requested=%d, loaded=%d",
+            file_name_.c_str(), static_cast<int>(page_nums.size()), loaded_count);
+
+  lock_guard guard(read_ahead_lock_);
+  read_ahead_pending_--;
+  read_ahead_cond_.notify_all();
+}
+
+RC DiskBufferPool::install_read_ahead_page(PageNum page_num, Page &page, uint64_t write_epoch, bool &installed)
+{
+  installed = false;
+
+  scoped_lock bp_guard(lock_);
+
+  // 刷脏时页面会先写到double write buffer中，那里的数据比文件中的新。
+  // 要先查double write buffer再检查write_epoch_，因为它在写完文件并增加write_epoch_之后才会释放页面
+  const bool from_dblwr = OB_SUCC(dblwr_manager_.read_page(this, page_num, page));
+
+  lock_guard guard(read_ahead_lock_);
+  if (!from_dblwr && write_epoch != write_epoch_.load()) {
+    return RC::LOCKED_CONCURRENCY_CONFLICT;
+  }
+
+  // 读取期间页面可能已经被删除了
+  if (page_num >= file_header_->page_count ||
+      (file_header_->bitmap[page_num / 8] & (1 << (page_num % 8))) == 0) {
+    return RC::SUCCESS;
+  }
+
+  read_ahead_installing_.store(true);
+
+  Frame *frame     = nullptr;
+  bool   allocated = false;
+  RC     rc        = allocate_frame(page_num, &frame, &allocated);
+  if (OB_FAIL(rc)) {
+    read_ahead_installing_.store(false);
+    return rc;
+  }
+
+  if (!allocated) {
+    // 页面已经被别人加载进来了
+    frame->unpin();
+    read_ahead_installing_.store(false);
+    return RC::SUCCESS;
+  }
+
+  memcpy(&frame->page(), &page, sizeof(Page));
+  frame->set_buffer_pool_id(id());
+  frame->set_page_num(page_num);
+  frame->unpin();
+
+  read_ahead_installing_.store(false);
+  installed = true;
   return RC::SUCCESS;
 }
 
@@ -700,7 +1171,7 @@ RC DiskBufferPool::redo_deallocate_page(LSN lsn, PageNum page_num)
   return RC::SUCCESS;
 }
 
-RC DiskBufferPool::allocate_frame(PageNum page_num, Frame **buffer)
+RC DiskBufferPool::allocate_frame(PageNum page_num, Frame **buffer, bool *allocated /* = nullptr */)
 {
   auto purger = [this](Frame *frame) {
     if (!frame->dirty()) {
@@ -721,7 +1192,7 @@ RC DiskBufferPool::allocate_frame(PageNum page_num, Frame **buffer)
   };
 
   while (true) {
-    Frame *frame = frame_manager_.alloc(id(), page_num);
+    Frame *frame = frame_manager_.alloc(id(), page_num, allocated);
     if (frame != nullptr) {
       *buffer = frame;
       LOG_DEBUG("allocate frame %p, page num %d, frame=%s", frame, page_num, frame->to_string().c_str());
@@ -729,6 +1200,7 @@ RC DiskBufferPool::allocate_frame(PageNum page_num, Frame **buffer)
     }
 
     LOG_TRACE("frames are all allocated, so we should purge some frames to get one free frame");
+    bp_manager_.page_cleaner().wakeup();
     (void)frame_manager_.purge_frames(1 /*count*/, purger);
   }
   return RC::BUFFERPOOL_NOBUF;
@@ -755,19 +1227,17 @@ RC DiskBufferPool::load_page(PageNum page_num, Frame *frame)
     return rc;
   }
 
-  scoped_lock lock_guard(wr_lock_);
-  int64_t     offset = ((int64_t)page_num) * BP_PAGE_SIZE;
-  if (lseek(file_desc_, offset, SEEK_SET) == -1) {
-    LOG_ERROR("Failed to load page %s:%d, due to failed to lseek:%s.", file_name_.c_str(), page_num, strerror(errno));
-
-    return RC::IOERR_SEEK;
+  PageIoBatch batch;
+  batch.add_read(file_desc_, static_cast<int64_t>(page_num) * BP_PAGE_SIZE, &page, BP_PAGE_SIZE);
+  rc = bp_manager_.page_io().execute(batch);
+  if (OB_SUCC(rc) && batch.request(0).done_size != BP_PAGE_SIZE) {
+    rc = RC::IOERR_READ;
   }
-
-  int ret = readn(file_desc_, &page, BP_PAGE_SIZE);
-  if (ret != 0) {
-    LOG_ERROR("Failed to load page %s, file_desc:%d, page num:%d, due to failed to read data:%s, ret=%d, page count=%d",
-              file_name_.c_str(), file_desc_, page_num, strerror(errno), ret, file_header_->allocated_pages);
-    return RC::IOERR_READ;
+  if (OB_FAIL(rc)) {
+    LOG_ERROR("Failed to load page %s, file_desc:%d, page num:%d, read size=%ld, page count=%d, rc=%s",
+              file_name_.c_str(), file_desc_, page_num, batch.request(0).done_size,
+              file_header_ != nullptr ? file_header_->allocated_pages : 0, strrc(rc));
+    return rc;
   }
 
   frame->set_page_num(page_num);
@@ -780,19 +1250,32 @@ RC DiskBufferPool::load_page(PageNum page_num, Frame *frame)
 int DiskBufferPool::file_desc() const { return file_desc_; }
 
 ////////////////////////////////////////////////////////////////////////////////
-BufferPoolManager::BufferPoolManager(int memory_size /* = 0 */)
+BufferPoolManager::BufferPoolManager(int memory_size /* = 0 */, int frame_shard_num /* = DEFAULT_SHARD_NUM */,
+    const string &frame_replacer /* = DEFAULT_REPLACER */, const string &page_io /* = DEFAULT_PAGE_IO */)
 {
   if (memory_size <= 0) {
     memory_size = MEM_POOL_ITEM_NUM * DEFAULT_ITEM_NUM_PER_POOL * BP_PAGE_SIZE;
   }
   const int pool_num = max(memory_size / BP_PAGE_SIZE / DEFAULT_ITEM_NUM_PER_POOL, 1);
-  frame_manager_.init(pool_num);
-  LOG_INFO("buffer pool manager init with memory size %d, page num: %d, pool num: %d",
-           memory_size, pool_num * DEFAULT_ITEM_NUM_PER_POOL, pool_num);
+  frame_manager_.init(pool_num, frame_shard_num, frame_replacer);
+
+  page_io_ = PageIoBackend::create(page_io);
+  if (!page_io_) {
+    LOG_WARN("unknown page io backend %s, use %s instead", page_io.c_str(), DEFAULT_PAGE_IO);
+    page_io_ = PageIoBackend::create(DEFAULT_PAGE_IO);
+  }
+
+  LOG_INFO("buffer pool manager init with memory size %d, page num: %d, pool num: %d, shard num: %d, replacer: %s, "
+           "page io: %s",
+           memory_size, pool_num * DEFAULT_ITEM_NUM_PER_POOL, pool_num, frame_manager_.shard_num(),
+           frame_manager_.replacer_name(), page_io_->name());
 }
 
 BufferPoolManager::~BufferPoolManager()
 {
+  page_cleaner_.stop();
+  page_prefetcher_.stop();
+
   unordered_map<string, DiskBufferPool *> tmp_bps;
   tmp_bps.swap(buffer_pools_);
 
@@ -912,11 +1395,12 @@ RC BufferPoolManager::remove_file(const char *_file_name)
   string file_name(_file_name);
 
   // 加锁以保护 buffer_pools_ 和 id_to_buffer_pools_
-  scoped_lock lock_guard(lock_);
+  lock_.lock();
 
   // 检查文件是否在 buffer_pools_ 中
   auto iter = buffer_pools_.find(file_name);
   if (iter == buffer_pools_.end()) {
+    lock_.unlock();
     LOG_TRACE("file has not opened or does not exist in buffer pools: %s", _file_name);
     // 如果文件未打开，直接尝试删除磁盘文件
   } else {
@@ -925,6 +1409,9 @@ RC BufferPoolManager::remove_file(const char *_file_name)
     DiskBufferPool *bp = iter->second;
     buffer_pools_.erase(iter);
 
+    // 关闭文件时会等待刷脏线程，而刷脏线程会查找buffer pool，所以不能持有锁
+    lock_.unlock();
+
     // 关闭文件并释放资源
     // 析构 DiskBufferPool 对象时会自动关闭文件，这里手动关闭表示强调
     RC rc = bp->close_file();
@@ -948,16 +1435,13 @@ RC BufferPoolManager::remove_file(const char *_file_name)
 
 RC BufferPoolManager::flush_page(Frame &frame)
 {
-  int buffer_pool_id = frame.buffer_pool_id();
-
-  scoped_lock lock_guard(lock_);
-  auto        iter = id_to_buffer_pools_.find(buffer_pool_id);
-  if (iter == id_to_buffer_pools_.end()) {
-    LOG_WARN("unknown buffer pool of id %d", buffer_pool_id);
-    return RC::INTERNAL;
+  // 刷页面时double write buffer也可能会查找buffer pool，所以不能持有锁
+  DiskBufferPool *bp = nullptr;
+  RC              rc = get_buffer_pool(frame.buffer_pool_id(), bp);
+  if (OB_FAIL(rc)) {
+    return rc;
   }
 
-  DiskBufferPool *bp = iter->second;
   return bp->flush_page(frame);
 }
 
@@ -25,16 +25,21 @@ See the Mulan PSL v2 for more details. */
 #include <time.h>
 #include <optional>
 
+#include "common/lang/atomic.h"
 #include "common/lang/bitmap.h"
-#include "common/lang/lru_cache.h"
 #include "common/lang/mutex.h"
 #include "common/lang/memory.h"
 #include "common/lang/unordered_map.h"
+#include "common/lang/vector.h"
 #include "common/mm/mem_pool.h"
 #include "common/sys/rc.h"
 #include "common/types.h"
 #include "storage/buffer/frame.h"
+#include "storage/buffer/frame_replacer.h"
 #include "storage/buffer/page.h"
+#include "storage/buffer/page_cleaner.h"
+#include "storage/buffer/page_io.h"
+#include "storage/buffer/page_prefetcher.h"
 #include "storage/buffer/buffer_pool_log.h"
 
 class BufferPoolManager;
@@ -83,13 +88,35 @@ struct BPFileHeader
  * 当内存中的页帧不够用时，需要从内存中淘汰一些页帧，以便为新的页帧腾出空间。
  * 这个管理器负责为所有的BufferPool提供页帧管理服务，也就是所有的BufferPool磁盘文件
  * 在访问时都使用这个管理器映射到内存。
+ *
+ * 所有的页面访问都要经过这个管理器，为了不让一把锁成为瓶颈，页帧按照FrameId的哈希值划分到
+ * 多个分片中，每个分片有自己的锁、置换策略和空闲页帧链表。某个分片的空闲页帧用完时，
+ * 会从其它分片拿空闲页帧，淘汰页面时也会在所有分片中查找。
+ *
+ * 淘汰哪些页面由置换策略(FrameReplacer)决定。默认使用LRU，也可以使用能够抵抗全表扫描的2Q。
  */
 class BPFrameManager
 {
+public:
+  /// 默认的分片个数
+  static constexpr int DEFAULT_SHARD_NUM = 8;
+
+  /// 默认的置换策略
+  static constexpr const char *DEFAULT_REPLACER = "lru";
+
+  /// 优先淘汰干净页面时，只在分片中最先淘汰的这一部分页面中查找，否则热点的干净页面会比冷的脏页先被淘汰
+  static constexpr int CLEAN_VICTIM_SCAN_RATIO = 8;
+
 public:
   BPFrameManager(const char *tag);
 
-  RC init(int pool_num);
+  /**
+   * @brief 初始化
+   * @param pool_num 页帧内存池的个数，每个内存池有DEFAULT_ITEM_NUM_PER_POOL个页帧
+   * @param shard_num 分片个数。不会超过页帧的个数
+   * @param replacer 置换策略的名字，参考 FrameReplacer::create。不认识的名字会使用默认的置换策略
+   */
+  RC init(int pool_num, int shard_num = DEFAULT_SHARD_NUM, const string &replacer = DEFAULT_REPLACER);
   RC cleanup();
 
   /**
@@ -101,6 +128,12 @@ public:
    */
   Frame *get(int buffer_pool_id, PageNum page_num);
 
+  /**
+   * @brief 页面是否已经在内存中
+   * @details 不会pin页帧，也不计入命中率的统计。预读时用来跳过已经在内存中的页面
+   */
+  bool contains(int buffer_pool_id, PageNum page_num);
+
   /**
    * @brief 列出所有指定文件的页面
    *
@@ -114,9 +147,10 @@ public:
    *
    * @param buffer_pool_id buffer Pool标识
    * @param page_num 页面编号
+   * @param allocated 返回是否新分配了页帧。页面已经在内存中时，返回已有的页帧，此时为false
    * @return Frame* 页帧指针
    */
-  Frame *alloc(int buffer_pool_id, PageNum page_num);
+  Frame *alloc(int buffer_pool_id, PageNum page_num, bool *allocated = nullptr);
 
   /**
    * 尽管frame中已经包含了buffer_pool_id和page_num，但是依然要求
@@ -124,6 +158,12 @@ public:
    */
   RC free(int buffer_pool_id, PageNum page_num, Frame *frame);
 
+  /**
+   * @brief 页帧只被调用者自己pin着时才释放它，否则返回 LOCKED_UNLOCK，页帧保持不变
+   * @details 检查引用计数和释放页帧在同一个分片锁内完成，不会与并发的 get 交错
+   */
+  RC try_free(int buffer_pool_id, PageNum page_num, Frame *frame);
+
   /**
    * 如果不能从空闲链表中分配新的页面，就使用这个接口，
    * 尝试从pin count=0的页面中淘汰一些
@@ -133,16 +173,57 @@ public:
    */
   int purge_frames(int count, function<RC(Frame *frame)> purger);
 
-  size_t frame_num() const { return frames_.count(); }
+  /**
+   * @brief 为刷脏线程挑选需要刷盘的页面
+   * @details 按照置换策略的淘汰顺序查找，如果空闲页帧与可以直接淘汰的干净页帧不足watermark个，
+   * 就挑选一些没有被使用的脏页。挑选出来的页帧会被pin住，同时拷贝一份页面内容，刷盘时就不需要再加锁了。
+   * @param watermark 需要保持的空闲页帧与干净页帧的个数
+   * @param max_count 最多挑选多少个页面
+   * @param frames 挑选出来的页帧
+   * @param pages 页帧对应的页面内容
+   */
+  void pick_dirty_frames(int watermark, int max_count, vector<Frame *> &frames, vector<Page> &pages);
+
+  /**
+   * @brief 刷脏线程把页面写到磁盘之后调用
+   * @details 如果刷盘期间页面没有被修改，也没有其他人在使用，就清除脏标识。然后释放pick_dirty_frames时的pin
+   * @param frame 刷盘的页帧
+   * @param page 写到磁盘上的页面内容
+   * @return 是否清除了脏标识
+   */
+  bool finish_clean(Frame *frame, const Page &page);
+
+  /**
+   * @brief 所有页帧中最小的recovery LSN
+   * @details 检查点使用这个值确定重启时从哪里开始回放日志。没有未刷盘的修改时返回0
+   * @see Frame::rec_lsn
+   */
+  LSN min_rec_lsn();
+
+  /**
+   * @brief 正在使用的页帧个数
+   * @details 没有加锁，只是一个近似值
+   */
+  size_t frame_num() const;
 
   /**
    * 测试使用。返回已经从内存申请的个数
    */
   size_t total_frame_num() const { return allocator_.get_size(); }
 
-private:
-  Frame *get_internal(const FrameId &frame_id);
-  RC     free_internal(const FrameId &frame_id, Frame *frame);
+  int shard_num() const { return static_cast<int>(shards_.size()); }
+
+  /**
+   * @brief 置换策略的名字
+   */
+  const char *replacer_name() const;
+
+  /**
+   * @brief 获取页面时在内存中找到的次数与没有找到的次数
+   * @details 用来计算命中率。没有加锁，只是一个近似值
+   */
+  int64_t hit_count() const;
+  int64_t miss_count() const;
 
 private:
   class BPFrameIdHasher
@@ -151,12 +232,39 @@ private:
     size_t operator()(const FrameId &frame_id) const { return frame_id.hash(); }
   };
 
-  using FrameLruCache  = common::LruCache<FrameId, Frame *, BPFrameIdHasher>;
   using FrameAllocator = common::MemPoolSimple<Frame>;
 
-  mutex          lock_;
-  FrameLruCache  frames_;
-  FrameAllocator allocator_;
+  /**
+   * @brief 页帧管理的一个分片
+   */
+  struct Shard
+  {
+    mutex                                             lock;
+    unordered_map<FrameId, Frame *, BPFrameIdHasher> frames;       /// 正在使用的页帧
+    unique_ptr<FrameReplacer>                         replacer;     /// 正在使用的页帧按照什么顺序淘汰
+    vector<Frame *>                                   free_frames;  /// 空闲的页帧
+    atomic<int64_t>                                   hit_count{0};
+    atomic<int64_t>                                   miss_count{0};
+  };
+
+private:
+  Shard &shard_of(const FrameId &frame_id);
+
+  Frame *get_internal(Shard &shard, const FrameId &frame_id);
+  Frame *alloc_internal(Shard &shard, const FrameId &frame_id, Frame *frame);
+  RC     free_internal(Shard &shard, const FrameId &frame_id, Frame *frame);
+
+  /// 从其它分片拿一个空闲页帧
+  Frame *steal_free_frame(Shard &thief);
+
+  /// 在一个分片中淘汰页面。clean_only为true时只在最先淘汰的一部分页面中查找干净的页面
+  int purge_shard_frames(Shard &shard, int count, bool clean_only, function<RC(Frame *frame)> &purger);
+
+private:
+  vector<unique_ptr<Shard>> shards_;
+  FrameAllocator            allocator_;        /// 页帧的内存在初始化时全部申请好，分配到各个分片中
+  atomic<size_t>            purge_cursor_{0};  /// 下次从哪个分片开始淘汰
+  atomic<size_t>            clean_cursor_{0};  /// 刷脏线程下次从哪个分片开始查找
 };
 
 /**
@@ -169,14 +277,27 @@ public:
   BufferPoolIterator();
   ~BufferPoolIterator();
 
-  RC      init(DiskBufferPool &bp, PageNum start_page = 0);
+  /**
+   * @param bp 需要遍历的BufferPool
+   * @param start_page 从哪个页面开始遍历
+   * @param read_ahead 是否预读。顺序扫描整个文件时使用，会提前异步地加载后面的页面
+   * @param end_page 遍历到哪个页面为止(不包含)，小于0表示遍历到文件末尾。并行扫描时每个线程只遍历一部分页面
+   */
+  RC      init(DiskBufferPool &bp, PageNum start_page = 0, bool read_ahead = false, PageNum end_page = -1);
   bool    has_next();
   PageNum next();
   RC      reset();
 
 private:
-  common::Bitmap bitmap_;
-  PageNum        current_page_num_ = -1;
+  /// 遍历到了上次预读的第一个页面时，预读下一批页面，这样总是提前一批
+  void read_ahead();
+
+private:
+  common::Bitmap  bitmap_;
+  PageNum         current_page_num_ = -1;
+  DiskBufferPool *read_ahead_bp_    = nullptr;  /// 不预读时为空
+  PageNum         read_ahead_trigger_ = -1;     /// 遍历到这个页面时开始下一次预读
+  PageNum         read_ahead_end_     = -1;     /// 已经预读过的最后一个页面
 };
 
 /**
@@ -259,6 +380,23 @@ public:
    */
   RC flush_all_pages();
 
+  /**
+   * @brief 把页面的一个副本刷新到double write buffer
+   * @details 刷脏线程使用。会等待页面相关的日志落盘，但是不修改页帧的任何状态
+   */
+  RC flush_page_copy(PageNum page_num, Page &page);
+
+  /**
+   * @brief 异步地预读一批页面
+   * @details 顺序扫描时由 BufferPoolIterator 调用。没有启动预读线程时什么都不做
+   */
+  void read_ahead(vector<PageNum> page_nums);
+
+  /**
+   * @brief 等待这个文件已经提交的预读任务全部完成
+   */
+  void wait_read_ahead();
+
   /**
    * 回放日志时处理page0中已被认定为不存在的page
    */
@@ -269,16 +407,39 @@ public:
    */
   RC write_page(PageNum page_num, Page &page);
 
+  /**
+   * @brief 把页面的写请求加到batch中，由调用者与其它页面一起提交
+   * @details 请求全部完成之后，调用者需要调用 finish_write_pages。page在完成之前不能释放
+   */
+  void add_write_page(PageIoBatch &batch, PageNum page_num, Page &page);
+
+  /**
+   * @brief 通过 add_write_page 加入的写请求已经完成
+   */
+  void finish_write_pages() { write_epoch_++; }
+
   RC redo_allocate_page(LSN lsn, PageNum page_num);
   RC redo_deallocate_page(LSN lsn, PageNum page_num);
 
 public:
   int32_t id() const { return buffer_pool_id_; }
 
+  /// 文件中的页面个数，包括已经释放的页面
+  int32_t page_count() const { return file_header_->page_count; }
+
   const char *filename() const { return file_name_.c_str(); }
 
 protected:
-  RC allocate_frame(PageNum page_num, Frame **buf);
+  /**
+   * @brief 为页面分配一个页帧，没有空闲页帧时淘汰一些页面
+   * @param allocated 返回是否新分配了页帧。页面已经在内存中时为false
+   */
+  RC allocate_frame(PageNum page_num, Frame **buf, bool *allocated = nullptr);
+
+  /**
+   * @brief 预读线程正在把页面放到页帧中时，等待它完成
+   */
+  void wait_read_ahead_installing();
 
   /**
    * 刷新指定页面到磁盘(flush)，并且释放关联的Frame
@@ -296,6 +457,20 @@ protected:
    */
   RC flush_page_internal(Frame &frame);
 
+  /**
+   * @brief 预读线程执行。跳过已经在内存中的页面，把剩下的页面读到页帧中
+   */
+  void load_pages_ahead(const vector<PageNum> &page_nums);
+
+  /**
+   * @brief 把预读的页面放到页帧中
+   * @details 如果页面已经在内存中或者已经被删除，就什么都不做。如果读取页面之后文件被写过，读到的页面可能已经过时了，
+   * 返回 LOCKED_CONCURRENCY_CONFLICT
+   * @param write_epoch 读取页面之前的 write_epoch_
+   * @param installed 是否真的放到了页帧中
+   */
+  RC install_read_ahead_page(PageNum page_num, Page &page, uint64_t write_epoch, bool &installed);
+
 private:
   BufferPoolManager   &bp_manager_;     /// BufferPool 管理器
   BPFrameManager      &frame_manager_;  /// Frame 管理器
@@ -312,10 +487,18 @@ private:
   string file_name_;  /// 文件名
 
   common::Mutex lock_;
-  common::Mutex wr_lock_;
+
+  /// 预读线程把页面放到页帧时持有这把锁并设置read_ahead_installing_，访问页面时如果发现正在放置，就等待放置完成
+  mutex              read_ahead_lock_;
+  condition_variable read_ahead_cond_;
+  int                read_ahead_pending_ = 0;  /// 已经提交还没有完成的预读任务个数
+  atomic<bool>       read_ahead_installing_{false};
+  /// 每次把页面写到文件中时加1，预读时用来判断读到的页面是否已经过时
+  atomic<uint64_t> write_epoch_{0};
 
 private:
   friend class BufferPoolIterator;
+  friend class PagePrefetcher;
 };
 
 /**
@@ -325,7 +508,18 @@ private:
 class BufferPoolManager final
 {
 public:
-  BufferPoolManager(int memory_size = 0);
+  /// 默认在访问页面的线程中同步地读写
+  static constexpr const char *DEFAULT_PAGE_IO = "sync";
+
+public:
+  /**
+   * @param memory_size 页帧占用的内存大小。不大于0时使用默认值
+   * @param frame_shard_num 页帧管理的分片个数
+   * @param frame_replacer 页帧的置换策略
+   * @param page_io 页面IO的后端，参考 PageIoBackend::create
+   */
+  BufferPoolManager(int memory_size = 0, int frame_shard_num = BPFrameManager::DEFAULT_SHARD_NUM,
+      const string &frame_replacer = BPFrameManager::DEFAULT_REPLACER, const string &page_io = DEFAULT_PAGE_IO);
   ~BufferPoolManager();
 
   RC init(unique_ptr<DoubleWriteBuffer> dblwr_buffer);
@@ -339,6 +533,9 @@ public:
 
   BPFrameManager    &get_frame_manager() { return frame_manager_; }
   DoubleWriteBuffer *get_dblwr_buffer() { return dblwr_buffer_.get(); }
+  PageCleaner       &page_cleaner() { return page_cleaner_; }
+  PagePrefetcher    &page_prefetcher() { return page_prefetcher_; }
+  PageIoBackend     &page_io() { return *page_io_; }
 
   /**
    * @brief 根据ID获取对应的BufferPool对象
@@ -351,8 +548,13 @@ public:
 private:
   BPFrameManager frame_manager_{"BufPool"};
 
+  unique_ptr<PageIoBackend> page_io_;  /// double write buffer析构时还要写页面，所以放在它的前面
+
   unique_ptr<DoubleWriteBuffer> dblwr_buffer_;
 
+  PageCleaner    page_cleaner_{*this};
+  PagePrefetcher page_prefetcher_;
+
   common::Mutex                            lock_;
   unordered_map<string, DiskBufferPool *>  buffer_pools_;
   unordered_map<int32_t, DiskBufferPool *> id_to_buffer_pools_;
@@ -16,6 +16,7 @@ See the Mulan PSL v2 for more details. */
 #include "storage/buffer/double_write_buffer.h"
 #include "storage/buffer/disk_buffer_pool.h"
 #include "common/io/io.h"
+#include "common/lang/algorithm.h"
 #include "common/log/log.h"
 #include "common/math/crc.h"
 
@@ -44,8 +45,8 @@ const int32_t DoubleWritePage::SIZE = sizeof(DoubleWritePage);
 
 const int32_t DoubleWriteBufferHeader::SIZE = sizeof(DoubleWriteBufferHeader);
 
-DiskDoubleWriteBuffer::DiskDoubleWriteBuffer(BufferPoolManager &bp_manager, int max_pages /*=16*/)
-    : max_pages_(max_pages), bp_manager_(bp_manager)
+DiskDoubleWriteBuffer::DiskDoubleWriteBuffer(BufferPoolManager &bp_manager, int max_pages /*=DEFAULT_MAX_PAGES*/)
+    : max_pages_(max(max_pages, 1)), bp_manager_(bp_manager), area_(max_pages_)
 {}
 
 DiskDoubleWriteBuffer::~DiskDoubleWriteBuffer()
@@ -73,22 +74,31 @@ RC DiskDoubleWriteBuffer::open_file(const char *filename)
 
 RC DiskDoubleWriteBuffer::flush_page()
 {
-  sync();
+  scoped_lock lock_guard(lock_);
+  return flush_page_internal();
+}
 
-  for (const auto &pair : dblwr_pages_) {
-    RC rc = write_page(pair.second);
-    if (rc != RC::SUCCESS) {
-      return rc;
-    }
-    pair.second->valid = false;
-    write_page_internal(pair.second);
-    delete pair.second;
+RC DiskDoubleWriteBuffer::flush_page_internal()
+{
+  if (header_.page_cnt == 0) {
+    return RC::SUCCESS;
+  }
+
+  RC rc = write_area();
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  rc = write_pages();
+  if (OB_FAIL(rc)) {
+    return rc;
   }
 
+  LOG_TRACE("double write buffer flushed a batch of pages. page count=%d", header_.page_cnt);
+
   dblwr_pages_.clear();
   header_.page_cnt = 0;
-
-  return RC::SUCCESS;
+  return write_header();
 }
 
 RC DiskDoubleWriteBuffer::add_page(DiskBufferPool *bp, PageNum page_num, Page &page)
@@ -100,37 +110,18 @@ RC DiskDoubleWriteBuffer::add_page(DiskBufferPool *bp, PageNum page_num, Page &p
     iter->second->page = page;
     LOG_TRACE("[cache hit]add page into double write buffer. buffer_pool_id:%d,page_num:%d,lsn=%d, dwb size=%d",
               bp->id(), page_num, page.lsn, static_cast<int>(dblwr_pages_.size()));
-    return write_page_internal(iter->second);
+    return RC::SUCCESS;
   }
 
-  int64_t          page_cnt   = dblwr_pages_.size();
-  DoubleWritePage *dblwr_page = new DoubleWritePage(bp->id(), page_num, page_cnt, page);
+  const int32_t    page_index = header_.page_cnt++;
+  DoubleWritePage *dblwr_page = &area_[page_index];
+  *dblwr_page                 = DoubleWritePage(bp->id(), page_num, page_index, page);
   dblwr_pages_.insert(pair<DoubleWritePageKey, DoubleWritePage *>(key, dblwr_page));
   LOG_TRACE("insert page into double write buffer. buffer_pool_id:%d,page_num:%d,lsn=%d, dwb size:%d",
             bp->id(), page_num, page.lsn, static_cast<int>(dblwr_pages_.size()));
 
-  RC rc = write_page_internal(dblwr_page);
-  if (OB_FAIL(rc)) {
-    LOG_WARN("failed to write page into double write buffer. rc=%s buffer_pool_id:%d,page_num:%d,lsn=%d.",
-        strrc(rc), bp->id(), page_num, page.lsn);
-    return rc;
-  }
-
-  if (page_cnt + 1 > header_.page_cnt) {
-    header_.page_cnt = page_cnt + 1;
-    if (lseek(file_desc_, 0, SEEK_SET) == -1) {
-      LOG_ERROR("Failed to add page header due to failed to seek %s.", strerror(errno));
-      return RC::IOERR_SEEK;
-    }
-
-    if (writen(file_desc_, &header_, sizeof(header_)) != 0) {
-      LOG_ERROR("Failed to add page header due to %s.", strerror(errno));
-      return RC::IOERR_WRITE;
-    }
-  }
-
-  if (static_cast<int>(dblwr_pages_.size()) >= max_pages_) {
-    RC rc = flush_page();
+  if (header_.page_cnt >= max_pages_) {
+    RC rc = flush_page_internal();
     if (rc != RC::SUCCESS) {
       LOG_ERROR("Failed to flush pages in double write buffer");
       return rc;
@@ -140,39 +131,99 @@ RC DiskDoubleWriteBuffer::add_page(DiskBufferPool *bp, PageNum page_num, Page &p
   return RC::SUCCESS;
 }
 
-RC DiskDoubleWriteBuffer::write_page_internal(DoubleWritePage *page)
+RC DiskDoubleWriteBuffer::write_area()
 {
-  int32_t page_index = page->page_index;
-  int64_t offset     = page_index * DoubleWritePage::SIZE + DoubleWriteBufferHeader::SIZE;
-  if (lseek(file_desc_, offset, SEEK_SET) == -1) {
-    LOG_ERROR("Failed to add page %lld of %d due to failed to seek %s.", offset, file_desc_, strerror(errno));
-    return RC::IOERR_SEEK;
+  // 文件头与页面区域是连续的，一起顺序写入
+  PageIoBatch write_batch;
+  write_batch.add_write(file_desc_, 0, &header_, DoubleWriteBufferHeader::SIZE);
+  write_batch.add_write(file_desc_,
+      DoubleWriteBufferHeader::SIZE,
+      area_.data(),
+      static_cast<int64_t>(header_.page_cnt) * DoubleWritePage::SIZE);
+
+  RC rc = bp_manager_.page_io().execute(write_batch);
+  if (OB_FAIL(rc)) {
+    LOG_ERROR("Failed to write double write buffer area. page count=%d, rc=%s", header_.page_cnt, strrc(rc));
+    return rc;
   }
 
-  if (writen(file_desc_, page, DoubleWritePage::SIZE) != 0) {
-    LOG_ERROR("Failed to add page %lld of %d due to %s.", offset, file_desc_, strerror(errno));
-    return RC::IOERR_WRITE;
+  PageIoBatch sync_batch;
+  sync_batch.add_sync(file_desc_);
+  rc = bp_manager_.page_io().execute(sync_batch);
+  if (OB_FAIL(rc)) {
+    LOG_ERROR("Failed to sync double write buffer. rc=%s", strrc(rc));
+    return rc;
   }
-
   return RC::SUCCESS;
 }
 
-RC DiskDoubleWriteBuffer::write_page(DoubleWritePage *dblwr_page)
+RC DiskDoubleWriteBuffer::write_header()
+{
+  PageIoBatch batch;
+  batch.add_write(file_desc_, 0, &header_, DoubleWriteBufferHeader::SIZE);
+  RC rc = bp_manager_.page_io().execute(batch);
+  if (OB_FAIL(rc)) {
+    LOG_ERROR("Failed to write double write buffer header. rc=%s", strrc(rc));
+  }
+  return rc;
+}
+
+RC DiskDoubleWriteBuffer::write_pages()
 {
-  DiskBufferPool *disk_buffer = nullptr;
-  // skip invalid page
-  if (!dblwr_page->valid) {
-    LOG_TRACE("double write buffer write page invalid. buffer_pool_id:%d,page_num:%d,lsn=%d",
+  PageIoBatch              batch;
+  vector<DiskBufferPool *> buffer_pools;
+  for (int32_t i = 0; i < header_.page_cnt; i++) {
+    DoubleWritePage *dblwr_page = &area_[i];
+    // skip invalid page
+    if (!dblwr_page->valid) {
+      LOG_TRACE("double write buffer write page invalid. buffer_pool_id:%d,page_num:%d,lsn=%d",
+                dblwr_page->key.buffer_pool_id, dblwr_page->key.page_num, dblwr_page->page.lsn);
+      continue;
+    }
+
+    DiskBufferPool *disk_buffer = nullptr;
+    RC rc = bp_manager_.get_buffer_pool(dblwr_page->key.buffer_pool_id, disk_buffer);
+    if (OB_FAIL(rc) || disk_buffer == nullptr) {
+      // 重启时，共享表空间中可能还有已经删除的文件的页面
+      LOG_WARN("skip page of a buffer pool not opened. buffer_pool_id:%d,page_num:%d",
+               dblwr_page->key.buffer_pool_id, dblwr_page->key.page_num);
+      continue;
+    }
+
+    LOG_TRACE("double write buffer write page. buffer_pool_id:%d,page_num:%d,lsn=%d",
               dblwr_page->key.buffer_pool_id, dblwr_page->key.page_num, dblwr_page->page.lsn);
+
+    disk_buffer->add_write_page(batch, dblwr_page->key.page_num, dblwr_page->page);
+    if (find(buffer_pools.begin(), buffer_pools.end(), disk_buffer) == buffer_pools.end()) {
+      buffer_pools.push_back(disk_buffer);
+    }
+  }
+
+  if (batch.empty()) {
     return RC::SUCCESS;
   }
-  RC rc = bp_manager_.get_buffer_pool(dblwr_page->key.buffer_pool_id, disk_buffer);
-  ASSERT(OB_SUCC(rc) && disk_buffer != nullptr, "failed to get disk buffer pool of %d", dblwr_page->key.buffer_pool_id);
 
-  LOG_TRACE("double write buffer write page. buffer_pool_id:%d,page_num:%d,lsn=%d",
-            dblwr_page->key.buffer_pool_id, dblwr_page->key.page_num, dblwr_page->page.lsn);
+  RC rc = bp_manager_.page_io().execute(batch);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to write pages in double write buffer. page count=%d, rc=%s", batch.size(), strrc(rc));
+    return rc;
+  }
+
+  // 每个文件只做一次fdatasync，不同的文件同时进行
+  PageIoBatch sync_batch;
+  for (DiskBufferPool *disk_buffer : buffer_pools) {
+    sync_batch.add_sync(disk_buffer->file_desc());
+  }
+  rc = bp_manager_.page_io().execute(sync_batch);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to sync files in double write buffer. file count=%d, rc=%s", sync_batch.size(), strrc(rc));
+    return rc;
+  }
 
-  return disk_buffer->write_page(dblwr_page->key.page_num, dblwr_page->page);
+  for (DiskBufferPool *disk_buffer : buffer_pools) {
+    disk_buffer->finish_write_pages();
+  }
+  return RC::SUCCESS;
 }
 
 RC DiskDoubleWriteBuffer::read_page(DiskBufferPool *bp, PageNum page_num, Page &page)
@@ -191,44 +242,16 @@ RC DiskDoubleWriteBuffer::read_page(DiskBufferPool *bp, PageNum page_num, Page &
 
 RC DiskDoubleWriteBuffer::clear_pages(DiskBufferPool *buffer_pool)
 {
-  vector<DoubleWritePage *> spec_pages;
-
-  auto remove_pred = [&spec_pages, buffer_pool](const pair<DoubleWritePageKey, DoubleWritePage *> &pair) {
-    DoubleWritePage *dbl_page = pair.second;
-    if (buffer_pool->id() == dbl_page->key.buffer_pool_id) {
-      spec_pages.push_back(dbl_page);
-      return true;
-    }
-    return false;
-  };
-
-  lock_.lock();
-  erase_if(dblwr_pages_, remove_pred);
-  lock_.unlock();
+  scoped_lock lock_guard(lock_);
 
   LOG_INFO("clear pages in double write buffer. file name=%s, page count=%d",
-           buffer_pool->filename(), spec_pages.size());
-
-  // 页面从小到大排序，防止出现小页面还没有写入，而页面编号更大的seek失败的情况
-  sort(spec_pages.begin(), spec_pages.end(), [](DoubleWritePage *a, DoubleWritePage *b) {
-    return a->key.page_num < b->key.page_num;
-  });
-
-  RC rc = RC::SUCCESS;
-  for (DoubleWritePage *dbl_page : spec_pages) {
-    rc = buffer_pool->write_page(dbl_page->key.page_num, dbl_page->page);
-    if (OB_FAIL(rc)) {
-      LOG_WARN("Failed to write page %s:%d to disk buffer pool. rc=%s",
-               buffer_pool->filename(), dbl_page->key.page_num, strrc(rc));
-      break;
-    }
-    dbl_page->valid = false;
-    write_page_internal(dbl_page);
-  }
+           buffer_pool->filename(), header_.page_cnt);
 
-  for_each(spec_pages.begin(), spec_pages.end(), [](DoubleWritePage *dbl_page) { delete dbl_page; });
-
-  return RC::SUCCESS;
+  RC rc = flush_page_internal();
+  if (OB_FAIL(rc)) {
+    LOG_WARN("Failed to flush double write buffer. file name=%s, rc=%s", buffer_pool->filename(), strrc(rc));
+  }
+  return rc;
 }
 
 RC DiskDoubleWriteBuffer::load_pages()
@@ -249,37 +272,42 @@ RC DiskDoubleWriteBuffer::load_pages()
   }
 
   int ret = readn(file_desc_, &header_, sizeof(header_));
-  if (ret != 0 && ret != -1) {
+  if (ret == -1) {
+    // 新创建的文件
+    header_.page_cnt = 0;
+  } else if (ret != 0) {
     LOG_ERROR("Failed to load page header, file_desc:%d, due to failed to read data:%s, ret=%d",
                 file_desc_, strerror(errno), ret);
     return RC::IOERR_READ;
   }
 
-  for (int page_num = 0; page_num < header_.page_cnt; page_num++) {
-    int64_t offset = ((int64_t)page_num) * DoubleWritePage::SIZE + DoubleWriteBufferHeader::SIZE;
+  if (header_.page_cnt < 0) {
+    LOG_ERROR("Failed to load pages, due to invalid page count %d", header_.page_cnt);
+    return RC::IOERR_READ;
+  }
 
-    if (lseek(file_desc_, offset, SEEK_SET) == -1) {
-      LOG_ERROR("Failed to load page %d, offset=%ld, due to failed to lseek:%s.", page_num, offset, strerror(errno));
-      return RC::IOERR_SEEK;
-    }
+  // 上次运行时的批次可能比现在大，区域在这里一次分配好
+  if (header_.page_cnt > static_cast<int32_t>(area_.size())) {
+    area_.resize(header_.page_cnt);
+  }
 
-    auto  dblwr_page = make_unique<DoubleWritePage>();
-    Page &page       = dblwr_page->page;
-    page.check_sum   = (CheckSum)-1;
+  ret = readn(file_desc_, area_.data(), static_cast<int64_t>(header_.page_cnt) * DoubleWritePage::SIZE);
+  if (ret != 0) {
+    LOG_ERROR("Failed to load pages, file_desc:%d, due to failed to read data:%s, ret=%d, page count=%d",
+              file_desc_, strerror(errno), ret, header_.page_cnt);
+    return RC::IOERR_READ;
+  }
 
-    ret = readn(file_desc_, dblwr_page.get(), DoubleWritePage::SIZE);
-    if (ret != 0) {
-      LOG_ERROR("Failed to load page, file_desc:%d, page num:%d, due to failed to read data:%s, ret=%d, page count=%d",
-                file_desc_, page_num, strerror(errno), ret, page_num);
-      return RC::IOERR_READ;
-    }
+  for (int32_t i = 0; i < header_.page_cnt; i++) {
+    DoubleWritePage &dblwr_page = area_[i];
+    Page            &page       = dblwr_page.page;
 
     const CheckSum check_sum = crc32(page.data, BP_PAGE_DATA_SIZE);
-    if (check_sum == page.check_sum) {
-      DoubleWritePageKey key = dblwr_page->key;
-      dblwr_pages_.insert(pair<DoubleWritePageKey, DoubleWritePage *>(key, dblwr_page.release()));
+    if (check_sum == page.check_sum && dblwr_page.valid) {
+      dblwr_pages_.insert(pair<DoubleWritePageKey, DoubleWritePage *>(dblwr_page.key, &dblwr_page));
     } else {
       LOG_TRACE("got a page with an invalid checksum. on disk:%d, in memory:%d", page.check_sum, check_sum);
+      dblwr_page.valid = false;
     }
   }
 
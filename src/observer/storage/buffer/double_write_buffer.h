@@ -16,6 +16,7 @@ See the Mulan PSL v2 for more details. */
 
 #include "common/lang/mutex.h"
 #include "common/lang/unordered_map.h"
+#include "common/lang/vector.h"
 #include "common/types.h"
 #include "common/sys/rc.h"
 #include "storage/buffer/page.h"
@@ -80,18 +81,29 @@ struct DoubleWritePageKeyHash
  * 当我们从磁盘中读取页面时，会校验页面的checksum，如果校验失败，则说明页面写入不完整，这时候可以从
  * DoubleWriteBuffer中读取数据。
  *
- * @note 每次都要保证，不管在内存中还是在文件中，这里的数据都是最新的，都比Buffer pool中的数据要新
+ * 页面先攒在内存中一块连续的区域里，攒满之后按批次刷盘：
+ * 1. 把整个区域顺序地写到共享文件中，只做一次fdatasync；
+ * 2. 把所有页面同时写到各自的文件中，每个涉及到的文件只做一次fdatasync；
+ * 3. 清空区域，文件头中的页面个数改为0。这一步不需要fdatasync，因为区域中的页面与文件中的相同，
+ *    重启后再写一次也没有影响。
+ * 还没有刷盘的页面只在内存中，它们的修改依靠redo日志恢复，所以检查点推进之前要先刷盘。
+ *
+ * @note 每次都要保证，在内存中的数据都是最新的，都比Buffer pool中的数据要新
  */
 class DiskDoubleWriteBuffer : public DoubleWriteBuffer
 {
+public:
+  /// 默认每一批刷盘的页面数
+  static constexpr int DEFAULT_MAX_PAGES = 128;
+
 public:
   /**
    * @brief 构造函数
    *
    * @param bp_manager 关联的buffer pool manager
-   * @param max_pages  内存中保存的最大页面数
+   * @param max_pages  内存中保存的最大页面数，也就是每一批刷盘的页面数
    */
-  DiskDoubleWriteBuffer(BufferPoolManager &bp_manager, int max_pages = 16);
+  DiskDoubleWriteBuffer(BufferPoolManager &bp_manager, int max_pages = DEFAULT_MAX_PAGES);
   virtual ~DiskDoubleWriteBuffer();
 
   /**
@@ -106,7 +118,7 @@ public:
   RC flush_page();
 
   /**
-   * 将页面加入buffer，并且写入磁盘中的共享表空间
+   * 将页面加入buffer。buffer满了之后整批写入共享表空间和页面所在的文件
    */
   RC add_page(DiskBufferPool *bp, PageNum page_num, Page &page) override;
 
@@ -114,6 +126,8 @@ public:
 
   /**
    * @brief 清空所有与指定buffer pool关联的页面
+   * @details 会把buffer中所有的页面都刷盘。页面写回文件总是要走完整的批次流程，
+   * 否则共享表空间中可能留下比文件中更旧的页面
    */
   RC clear_pages(DiskBufferPool *bp) override;
 
@@ -123,17 +137,27 @@ public:
   RC recover();
 
 private:
+  /**
+   * 与flush_page相同，调用者需要持有lock_
+   */
+  RC flush_page_internal();
+
   /**
    * 将buffer中的页面写入对应的磁盘
+   * @details 所有页面的写请求一起提交给 PageIoBackend，可以同时写入多个文件。
+   * 写完之后每个涉及到的文件做一次fdatasync
    */
-  RC write_page(DoubleWritePage *page);
+  RC write_pages();
 
   /**
-   * 将页面写到当前double write buffer文件中
-   * @details 每次页面更新都应该写入到磁盘中。保证double write buffer
-   * 内存和文件中的数据都是最新的。
+   * @brief 把整个区域顺序地写到共享表空间中，然后做一次fdatasync
    */
-  RC write_page_internal(DoubleWritePage *page);
+  RC write_area();
+
+  /**
+   * @brief 把文件头写到共享表空间中
+   */
+  RC write_header();
 
   /**
    * @brief 将磁盘文件中的内容加载到内存中。在启动时调用
@@ -143,9 +167,12 @@ private:
 private:
   int                     file_desc_ = -1;
   int                     max_pages_ = 0;
-  common::Mutex           lock_;
+  mutex                   lock_;  /// 刷脏线程与前台线程会同时写入，所以总是使用真正的锁
   BufferPoolManager      &bp_manager_;
-  DoubleWriteBufferHeader header_;
+  DoubleWriteBufferHeader header_;  /// page_cnt 是区域中已经使用的页面个数
+
+  /// 内存中连续的页面区域，与共享表空间中的布局相同。只会在启动加载时扩大，之后元素的地址不会变化
+  vector<DoubleWritePage> area_;
 
   unordered_map<DoubleWritePageKey, DoubleWritePage *, DoubleWritePageKeyHash> dblwr_pages_;
 };
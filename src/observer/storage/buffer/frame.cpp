@@ -75,6 +75,9 @@ void Frame::write_latch(intptr_t xid)
   }
 
   lock_.lock();
+  if (write_depth_++ == 0) {
+    version_.fetch_add(1);
+  }
 
 #ifdef DEBUG
   write_locker_ = xid;
@@ -91,6 +94,45 @@ void Frame::write_latch(intptr_t xid)
 #endif
 }
 
+bool Frame::try_write_latch()
+{
+  intptr_t xid = get_default_debug_xid();
+  {
+    scoped_lock debug_lock(debug_lock_);
+    ASSERT(pin_count_.load() > 0,
+        "frame try lock. write lock failed while pin count is invalid. "
+        "this=%p, pin=%d, frameId=%s, xid=%lx, lbt=%s",
+        this, pin_count_.load(), frame_id_.to_string().c_str(), xid, lbt());
+
+    ASSERT(read_lockers_.find(xid) == read_lockers_.end(),
+        "frame try to lock write while holding the read lock."
+        "this=%p, pin=%d, frameId=%s, xid=%lx, lbt=%s",
+        this, pin_count_.load(), frame_id_.to_string().c_str(), xid, lbt());
+  }
+
+  bool ret = lock_.try_lock();
+  if (ret) {
+    if (write_depth_++ == 0) {
+      version_.fetch_add(1);
+    }
+#ifdef DEBUG
+    scoped_lock debug_lock(debug_lock_);
+    write_locker_ = xid;
+    ++write_recursive_count_;
+    TRACE("frame write lock success."
+          "this=%p, pin=%d, frameId=%s, write locker=%lx(recursive=%d), xid=%lx, lbt=%s",
+        this,
+        pin_count_.load(),
+        frame_id_.to_string().c_str(),
+        write_locker_,
+        write_recursive_count_,
+        xid,
+        lbt());
+#endif
+  }
+  return ret;
+}
+
 void Frame::write_unlatch() { write_unlatch(get_default_debug_xid()); }
 
 void Frame::write_unlatch(intptr_t xid)
@@ -120,6 +162,9 @@ void Frame::write_unlatch(intptr_t xid)
   }
   debug_lock_.unlock();
 
+  if (--write_depth_ == 0) {
+    version_.fetch_add(1);
+  }
   lock_.unlock();
 }
 
@@ -75,7 +75,7 @@ public:
    * @details 在 MemPoolSimple 分配和释放一个Frame对象时，不会调用构造函数和析构函数，
    * 而是调用reinit和reset。
    */
-  void reinit() {}
+  void reinit() { rec_lsn_.store(0); }
   void reset() {}
 
   void clear_page() { memset(&page_, 0, sizeof(page_)); }
@@ -104,7 +104,19 @@ public:
    * 序列号要小，那就可以从日志中读取这些更大序列号的日志，做重做操作，将页面恢复到最新状态，也就是redo。
    */
   LSN  lsn() const { return page_.lsn; }
-  void set_lsn(LSN lsn) { page_.lsn = lsn; }
+  void set_lsn(LSN lsn)
+  {
+    page_.lsn    = lsn;
+    LSN expected = 0;
+    rec_lsn_.compare_exchange_strong(expected, lsn);
+  }
+
+  /**
+   * @brief 页面上次刷盘之后，第一次修改对应的日志序列号(recovery LSN)
+   * @details 比这个LSN小的日志，在当前页面上的修改都已经写到磁盘中了，恢复时不再需要。
+   * 检查点会取所有页面中最小的recovery LSN作为回放日志的起点。页面没有未刷盘的修改时返回0。
+   */
+  LSN rec_lsn() const { return rec_lsn_.load(); }
 
   /**
    * @brief 页面校验和
@@ -132,7 +144,11 @@ public:
    * @brief 重置“脏”标记
    * @details 如果页面已经被写入磁盘文件，则应调用此函数。
    */
-  void clear_dirty() { dirty_ = false; }
+  void clear_dirty()
+  {
+    dirty_ = false;
+    rec_lsn_.store(0);
+  }
   bool dirty() const { return dirty_; }
 
   char *data() { return page_.data; }
@@ -155,6 +171,10 @@ public:
 
   void write_latch();
   void write_latch(intptr_t xid);
+  /**
+   * @brief 尝试加写锁，页面已经被其它线程加锁时立即返回false
+   */
+  bool try_write_latch();
 
   void write_unlatch();
   void write_unlatch(intptr_t xid);
@@ -166,6 +186,30 @@ public:
   void read_unlatch();
   void read_unlatch(intptr_t xid);
 
+  /**
+   * @brief 页面的版本号，用于不加锁的乐观读
+   * @details 加写锁和释放写锁时版本号都会加1(递归加锁时只有最外层的加锁解锁会修改)，
+   * 所以版本号是奇数时表示有线程正在修改页面。读线程不加锁读取页面内容，读之前和读之后
+   * 版本号相同并且是偶数，就说明读取的过程中页面没有被修改过，否则读到的内容可能不一致，需要重新读取。
+   * 读线程需要pin住页面，防止页帧被淘汰后用于其它页面。
+   */
+  uint64_t version() const { return version_.load(memory_order_acquire); }
+
+  /**
+   * @brief 版本号是否表示有线程正在修改页面
+   */
+  static bool version_locked(uint64_t version) { return (version & 1) != 0; }
+
+  /**
+   * @brief 检查页面的版本号是否还是之前读到的版本
+   * @details 在这之前读取的页面内容，只有版本号没有变化时才是有效的
+   */
+  bool validate_version(uint64_t version) const
+  {
+    atomic_thread_fence(memory_order_acquire);
+    return version_.load(memory_order_relaxed) == version;
+  }
+
   string to_string() const;
 
 private:
@@ -173,6 +217,7 @@ private:
 
   bool          dirty_ = false;
   atomic<int>   pin_count_{0};
+  atomic<LSN>   rec_lsn_{0};
   unsigned long acc_time_ = 0;
   FrameId       frame_id_;
   Page          page_;
@@ -180,6 +225,9 @@ private:
   /// 在非并发编译时，加锁解锁动作将什么都不做
   common::RecursiveSharedMutex lock_;
 
+  atomic<uint64_t> version_{0};      ///< 页面版本号，参考 version()
+  int              write_depth_ = 0;  ///< 当前写锁递归加锁的层数，只有持有写锁的线程会访问
+
   /// 使用一些手段来做测试，提前检测出头疼的死锁问题
   /// 如果编译时没有增加调试选项，这些代码什么都不做
   common::DebugMutex           debug_lock_;
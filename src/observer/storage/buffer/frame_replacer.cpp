@@ -0,0 +1,142 @@
+/* Copyright (c) 2021-2022 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "storage/buffer/frame_replacer.h"
+#include "common/lang/algorithm.h"
+#include "common/lang/string.h"
+
+unique_ptr<FrameReplacer> FrameReplacer::create(const string &name)
+{
+  if (name.empty() || 0 == strcasecmp(name.c_str(), "lru")) {
+    return make_unique<LruFrameReplacer>();
+  }
+  if (0 == strcasecmp(name.c_str(), "2q")) {
+    return make_unique<TwoQueueFrameReplacer>();
+  }
+  return nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void LruFrameReplacer::insert(const FrameId &, Frame *frame)
+{
+  lru_list_.push_front(frame);
+  positions_[frame] = lru_list_.begin();
+}
+
+void LruFrameReplacer::access(Frame *frame)
+{
+  auto iter = positions_.find(frame);
+  if (iter != positions_.end()) {
+    lru_list_.splice(lru_list_.begin(), lru_list_, iter->second);
+  }
+}
+
+void LruFrameReplacer::remove(const FrameId &, Frame *frame)
+{
+  auto iter = positions_.find(frame);
+  if (iter != positions_.end()) {
+    lru_list_.erase(iter->second);
+    positions_.erase(iter);
+  }
+}
+
+void LruFrameReplacer::foreach_victim(const function<bool(Frame *)> &visitor)
+{
+  for (auto iter = lru_list_.rbegin(); iter != lru_list_.rend(); ++iter) {
+    if (!visitor(*iter)) {
+      break;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t TwoQueueFrameReplacer::a1in_capacity() const
+{
+  return max(static_cast<size_t>(capacity_ * A1IN_RATIO), static_cast<size_t>(1));
+}
+
+size_t TwoQueueFrameReplacer::a1out_capacity() const
+{
+  return max(static_cast<size_t>(capacity_ * A1OUT_RATIO), static_cast<size_t>(1));
+}
+
+void TwoQueueFrameReplacer::insert(const FrameId &frame_id, Frame *frame)
+{
+  Position position;
+  auto     ghost_iter = a1out_index_.find(frame_id);
+  if (ghost_iter != a1out_index_.end()) {
+    // 最近刚被淘汰过，说明不是只访问一次的页面
+    a1out_.erase(ghost_iter->second);
+    a1out_index_.erase(ghost_iter);
+
+    am_.push_front(frame);
+    position.in_am = true;
+    position.iter  = am_.begin();
+  } else {
+    a1in_.push_front(frame);
+    position.in_am = false;
+    position.iter  = a1in_.begin();
+  }
+  positions_[frame] = position;
+  capacity_         = max(capacity_, positions_.size());
+}
+
+void TwoQueueFrameReplacer::access(Frame *frame)
+{
+  // A1in中的页面再次访问时不调整位置，短时间内的多次访问(比如扫描同一个页面上的记录)只算一次
+  auto iter = positions_.find(frame);
+  if (iter != positions_.end() && iter->second.in_am) {
+    am_.splice(am_.begin(), am_, iter->second.iter);
+  }
+}
+
+void TwoQueueFrameReplacer::remove(const FrameId &frame_id, Frame *frame)
+{
+  auto iter = positions_.find(frame);
+  if (iter == positions_.end()) {
+    return;
+  }
+
+  if (iter->second.in_am) {
+    am_.erase(iter->second.iter);
+  } else {
+    a1in_.erase(iter->second.iter);
+
+    // 从A1in中淘汰的页面记录在A1out中，超出容量时丢掉最老的
+    if (a1out_index_.find(frame_id) == a1out_index_.end()) {
+      a1out_.push_front(frame_id);
+      a1out_index_[frame_id] = a1out_.begin();
+    }
+  }
+  positions_.erase(iter);
+
+  const size_t capacity = a1out_capacity();
+  while (a1out_.size() > capacity) {
+    a1out_index_.erase(a1out_.back());
+    a1out_.pop_back();
+  }
+}
+
+void TwoQueueFrameReplacer::foreach_victim(const function<bool(Frame *)> &visitor)
+{
+  // A1in超过容量时优先淘汰A1in中的页面，否则优先淘汰Am中的页面
+  list<Frame *> *queues[2] = {&a1in_, &am_};
+  if (a1in_.size() <= a1in_capacity()) {
+    swap(queues[0], queues[1]);
+  }
+
+  for (list<Frame *> *queue : queues) {
+    for (auto iter = queue->rbegin(); iter != queue->rend(); ++iter) {
+      if (!visitor(*iter)) {
+        return;
+      }
+    }
+  }
+}
@@ -0,0 +1,127 @@
+/* Copyright (c) 2021-2022 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include "common/lang/functional.h"
+#include "common/lang/list.h"
+#include "common/lang/memory.h"
+#include "common/lang/string.h"
+#include "common/lang/unordered_map.h"
+#include "storage/buffer/frame.h"
+
+/**
+ * @brief 页帧置换策略
+ * @ingroup BufferPool
+ * @details 决定页帧不够用时先淘汰哪些页面。BPFrameManager 的每个分片都有一个置换策略对象，
+ * 调用时已经持有了分片的锁，所以这里的实现不需要考虑并发。
+ */
+class FrameReplacer
+{
+public:
+  virtual ~FrameReplacer() = default;
+
+  virtual const char *name() const = 0;
+
+  /**
+   * @brief 新加载了一个页面
+   */
+  virtual void insert(const FrameId &frame_id, Frame *frame) = 0;
+
+  /**
+   * @brief 访问了一个已经在内存中的页面
+   */
+  virtual void access(Frame *frame) = 0;
+
+  /**
+   * @brief 页面被淘汰或者释放
+   */
+  virtual void remove(const FrameId &frame_id, Frame *frame) = 0;
+
+  /**
+   * @brief 按照淘汰的先后顺序遍历页帧
+   * @details 遍历时不能修改置换策略的状态
+   * @param visitor 返回false时停止遍历
+   */
+  virtual void foreach_victim(const function<bool(Frame *)> &visitor) = 0;
+
+  /**
+   * @brief 根据名字创建置换策略
+   * @param name 当前支持 lru 与 2q
+   * @return 不认识的名字返回nullptr
+   */
+  static unique_ptr<FrameReplacer> create(const string &name);
+};
+
+/**
+ * @brief 最近最少使用(LRU)
+ * @details 一次全表扫描就会把所有的热点页面都淘汰掉
+ */
+class LruFrameReplacer : public FrameReplacer
+{
+public:
+  const char *name() const override { return "lru"; }
+
+  void insert(const FrameId &frame_id, Frame *frame) override;
+  void access(Frame *frame) override;
+  void remove(const FrameId &frame_id, Frame *frame) override;
+  void foreach_victim(const function<bool(Frame *)> &visitor) override;
+
+private:
+  list<Frame *>                                   lru_list_;  /// 最近访问的在前面
+  unordered_map<Frame *, list<Frame *>::iterator> positions_;
+};
+
+/**
+ * @brief 2Q置换策略，能够抵抗全表扫描
+ * @details 参考 Johnson and Shasha, 2Q: A Low Overhead High Performance Buffer Management Replacement Algorithm.
+ * 第一次加载的页面放在先进先出的A1in队列中，在A1in中再次访问不会改变它的位置。从A1in淘汰的页面只记录页面编号，
+ * 放在A1out队列中。如果A1out中的页面又被加载进来，说明它不只是被访问了一次，就放到按照LRU管理的Am队列中。
+ * 全表扫描的页面只会在A1in中停留，不会把Am中的热点页面挤出去。
+ */
+class TwoQueueFrameReplacer : public FrameReplacer
+{
+public:
+  const char *name() const override { return "2q"; }
+
+  void insert(const FrameId &frame_id, Frame *frame) override;
+  void access(Frame *frame) override;
+  void remove(const FrameId &frame_id, Frame *frame) override;
+  void foreach_victim(const function<bool(Frame *)> &visitor) override;
+
+private:
+  /// A1in最多占用的页帧比例，A1out最多记录的页面个数与页帧个数的比例，参考论文中的推荐值。
+  /// 分片之间会互相借用空闲页帧，所以页帧个数使用分片中同时存在的页面个数的最大值
+  static constexpr double A1IN_RATIO  = 0.25;
+  static constexpr double A1OUT_RATIO = 0.5;
+
+  struct Position
+  {
+    bool                    in_am = false;
+    list<Frame *>::iterator iter;
+  };
+
+  class FrameIdHasher
+  {
+  public:
+    size_t operator()(const FrameId &frame_id) const { return frame_id.hash(); }
+  };
+
+  size_t a1in_capacity() const;
+  size_t a1out_capacity() const;
+
+private:
+  list<Frame *>                     a1in_;  /// 新的在前面
+  list<Frame *>                     am_;    /// 最近访问的在前面
+  unordered_map<Frame *, Position>  positions_;
+  size_t                            capacity_ = 0;
+  list<FrameId>                     a1out_;  /// 新的在前面
+  unordered_map<FrameId, list<FrameId>::iterator, FrameIdHasher> a1out_index_;
+};
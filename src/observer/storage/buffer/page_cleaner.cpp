@@ -0,0 +1,130 @@
+/* Copyright (c) 2021-2022 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "storage/buffer/page_cleaner.h"
+#include "common/lang/chrono.h"
+#include "common/log/log.h"
+#include "common/thread/thread_util.h"
+#include "storage/buffer/disk_buffer_pool.h"
+
+using namespace common;
+
+PageCleaner::PageCleaner(BufferPoolManager &bp_manager) : bp_manager_(bp_manager) {}
+
+PageCleaner::~PageCleaner() { stop(); }
+
+RC PageCleaner::start(int watermark)
+{
+  if (watermark <= 0) {
+    LOG_INFO("page cleaner is disabled");
+    return RC::SUCCESS;
+  }
+
+  if (thread_) {
+    LOG_ERROR("page cleaner has been started");
+    return RC::INTERNAL;
+  }
+
+  watermark_ = watermark;
+  running_   = true;
+  thread_    = make_unique<thread>(&PageCleaner::thread_func, this);
+  LOG_INFO("page cleaner started. watermark=%d", watermark);
+  return RC::SUCCESS;
+}
+
+void PageCleaner::stop()
+{
+  if (!thread_) {
+    return;
+  }
+
+  {
+    lock_guard guard(thread_mutex_);
+    running_ = false;
+    cond_.notify_all();
+  }
+
+  thread_->join();
+  thread_.reset();
+  LOG_INFO("page cleaner stopped");
+}
+
+void PageCleaner::wakeup()
+{
+  lock_guard guard(thread_mutex_);
+  if (running_) {
+    notified_ = true;
+    cond_.notify_one();
+  }
+}
+
+int PageCleaner::clean(int watermark)
+{
+  lock_guard clean_guard(clean_lock_);
+
+  vector<Frame *> frames;
+  vector<Page>    pages;
+  frames.reserve(BATCH_SIZE);
+  pages.reserve(BATCH_SIZE);
+
+  BPFrameManager &frame_manager = bp_manager_.get_frame_manager();
+  frame_manager.pick_dirty_frames(watermark, BATCH_SIZE, frames, pages);
+
+  int cleaned_count = 0;
+  for (size_t i = 0; i < frames.size(); i++) {
+    Frame          *frame       = frames[i];
+    DiskBufferPool *buffer_pool = nullptr;
+
+    RC rc = bp_manager_.get_buffer_pool(frame->buffer_pool_id(), buffer_pool);
+    if (OB_SUCC(rc)) {
+      rc = buffer_pool->flush_page_copy(frame->page_num(), pages[i]);
+    }
+
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to flush page in page cleaner. frame=%s, rc=%s", frame->to_string().c_str(), strrc(rc));
+      frame->unpin();
+      continue;
+    }
+
+    // 刷盘期间被修改过的页面依然是脏的，下次再刷
+    if (frame_manager.finish_clean(frame, pages[i])) {
+      cleaned_count++;
+    }
+  }
+
+  if (!frames.empty()) {
+    LOG_DEBUG("page cleaner flushed a batch. picked=%d, cleaned=%d", static_cast<int>(frames.size()), cleaned_count);
+  }
+  return cleaned_count;
+}
+
+void PageCleaner::thread_func()
+{
+  /*
+  没有需要刷的脏页时，定时醒过来检查一下；前台找不到空闲页帧时，也会主动唤醒这个线程。
+  只要这一批还有页面变干净了，就继续检查是否需要刷下一批。
+  */
+  thread_set_name("PageCleaner");
+  LOG_INFO("page cleaner thread started");
+
+  unique_lock lock(thread_mutex_);
+  while (running_) {
+    notified_ = false;
+    lock.unlock();
+    int cleaned = clean(watermark_);
+    lock.lock();
+
+    if (cleaned == 0 && running_ && !notified_) {
+      cond_.wait_for(lock, chrono::milliseconds(100), [this]() { return !running_ || notified_; });
+    }
+  }
+
+  LOG_INFO("page cleaner thread stopped");
+}
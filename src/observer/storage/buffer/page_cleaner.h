@@ -0,0 +1,86 @@
+/* Copyright (c) 2021-2022 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include "common/lang/memory.h"
+#include "common/lang/mutex.h"
+#include "common/lang/thread.h"
+#include "common/sys/rc.h"
+
+class BufferPoolManager;
+
+/**
+ * @brief 后台刷脏线程
+ * @ingroup BufferPool
+ * @details 页帧不够用时，DiskBufferPool 需要淘汰一个页面。如果淘汰的是脏页，就要在前台的请求中
+ * 同步地把页面写到磁盘上(还要写一次double write buffer)，读请求的延迟会因此变得很高。
+ * 刷脏线程在后台按批次把LRU链表尾部的脏页刷到磁盘，让空闲页帧和可以直接淘汰的干净页帧保持在
+ * 水位线(watermark)之上，这样前台淘汰页面时几乎不需要再写磁盘。
+ *
+ * 刷盘时不持有任何页面锁：页面内容是在frame manager的锁内、页面没有被使用(pin count为0)时拷贝出来的，
+ * 写完之后如果页面在这期间没有被修改过，才会清除脏标识。
+ */
+class PageCleaner
+{
+public:
+  /// 每一批最多刷多少个页面
+  static constexpr int BATCH_SIZE = 32;
+
+public:
+  PageCleaner(BufferPoolManager &bp_manager);
+  ~PageCleaner();
+
+  /**
+   * @brief 启动后台线程
+   * @param watermark 需要保持的空闲页帧与干净页帧的个数。不大于0时不启动
+   */
+  RC start(int watermark);
+
+  /**
+   * @brief 停止后台线程并等待它退出
+   */
+  void stop();
+
+  /**
+   * @brief 唤醒后台线程
+   * @details 前台发现没有空闲页帧时调用，不需要等到下一次定时检查
+   */
+  void wakeup();
+
+  /**
+   * @brief 刷一批脏页
+   * @details 后台线程会不停地调用这个函数，测试时也可以直接调用
+   * @param watermark 需要保持的空闲页帧与干净页帧的个数
+   * @return int 本次变成干净页面的个数。刷盘期间又被修改的页面不计算在内
+   */
+  int clean(int watermark);
+
+  /**
+   * @brief 刷脏过程中持有的锁
+   * @details 关闭文件时要先持有这把锁，防止刷脏线程还在使用这个文件的页面
+   */
+  mutex &clean_lock() { return clean_lock_; }
+
+private:
+  void thread_func();
+
+private:
+  BufferPoolManager &bp_manager_;
+
+  mutex clean_lock_;
+
+  unique_ptr<thread> thread_;
+  mutex              thread_mutex_;
+  condition_variable cond_;
+  bool               running_   = false;
+  bool               notified_  = false;
+  int                watermark_ = 0;
+};
@@ -0,0 +1,443 @@
+/* Copyright (c) 2021-2022 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <errno.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#ifdef USE_IO_URING
+#include <liburing.h>
+#endif
+
+#include "storage/buffer/page_io.h"
+#include "common/log/log.h"
+#include "common/thread/thread_util.h"
+
+using namespace common;
+
+namespace {
+
+const char *request_type_name(PageIoRequest::Type type)
+{
+  switch (type) {
+    case PageIoRequest::Type::READ: return "read";
+    case PageIoRequest::Type::WRITE: return "write";
+    case PageIoRequest::Type::SYNC: return "sync";
+  }
+  return "unknown";
+}
+
+RC request_error(PageIoRequest::Type type)
+{
+  switch (type) {
+    case PageIoRequest::Type::READ: return RC::IOERR_READ;
+    case PageIoRequest::Type::WRITE: return RC::IOERR_WRITE;
+    case PageIoRequest::Type::SYNC: return RC::IOERR_SYNC;
+  }
+  return RC::INTERNAL;
+}
+
+}  // namespace
+
+PageIoBatch::~PageIoBatch()
+{
+  // 后端还可能在访问这个对象
+  wait();
+}
+
+void PageIoBatch::add_read(int fd, int64_t offset, void *buf, int64_t size)
+{
+  PageIoRequest request;
+  request.type   = PageIoRequest::Type::READ;
+  request.fd     = fd;
+  request.offset = offset;
+  request.buf    = static_cast<char *>(buf);
+  request.size   = size;
+  requests_.push_back(request);
+}
+
+void PageIoBatch::add_write(int fd, int64_t offset, const void *buf, int64_t size)
+{
+  PageIoRequest request;
+  request.type   = PageIoRequest::Type::WRITE;
+  request.fd     = fd;
+  request.offset = offset;
+  request.buf    = const_cast<char *>(static_cast<const char *>(buf));
+  request.size   = size;
+  requests_.push_back(request);
+}
+
+void PageIoBatch::add_sync(int fd)
+{
+  PageIoRequest request;
+  request.type = PageIoRequest::Type::SYNC;
+  request.fd   = fd;
+  requests_.push_back(request);
+}
+
+void PageIoBatch::start()
+{
+  lock_guard guard(lock_);
+  pending_ = static_cast<int>(requests_.size());
+}
+
+void PageIoBatch::complete(int index, int64_t done_size, RC rc)
+{
+  PageIoRequest &request = requests_[index];
+  request.done_size      = done_size;
+  request.rc             = rc;
+
+  lock_guard guard(lock_);
+  if (--pending_ == 0) {
+    cond_.notify_all();
+  }
+}
+
+RC PageIoBatch::wait()
+{
+  unique_lock guard(lock_);
+  cond_.wait(guard, [this]() { return pending_ == 0; });
+
+  for (const PageIoRequest &request : requests_) {
+    if (OB_FAIL(request.rc)) {
+      return request.rc;
+    }
+  }
+  return RC::SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+RC PageIoBackend::execute(PageIoBatch &batch)
+{
+  RC rc = submit(batch);
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+  return batch.wait();
+}
+
+void PageIoBackend::do_request(PageIoBatch &batch, int index)
+{
+  const PageIoRequest &request   = batch.request(index);
+  int64_t              done_size = 0;
+  RC                   rc        = RC::SUCCESS;
+  if (request.type == PageIoRequest::Type::SYNC) {
+    if (fdatasync(request.fd) != 0) {
+      LOG_ERROR("failed to sync file. fd=%d, error=%s", request.fd, strerror(errno));
+      rc = request_error(request.type);
+    }
+    complete_request(batch, index, 0, rc);
+    return;
+  }
+
+  while (done_size < request.size) {
+    ssize_t ret = 0;
+    if (request.type == PageIoRequest::Type::READ) {
+      ret = pread(request.fd, request.buf + done_size, request.size - done_size, request.offset + done_size);
+    } else {
+      ret = pwrite(request.fd, request.buf + done_size, request.size - done_size, request.offset + done_size);
+    }
+
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG_ERROR("failed to %s page. fd=%d, offset=%ld, size=%ld, error=%s",
+                request_type_name(request.type), request.fd, request.offset, request.size, strerror(errno));
+      rc = request_error(request.type);
+      break;
+    }
+    if (ret == 0) {
+      // 读到了文件末尾
+      break;
+    }
+    done_size += ret;
+  }
+
+  complete_request(batch, index, done_size, rc);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+RC SyncPageIoBackend::submit(PageIoBatch &batch)
+{
+  start_batch(batch);
+  for (int i = 0; i < batch.size(); i++) {
+    do_request(batch, i);
+  }
+  return RC::SUCCESS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+ThreadPoolPageIoBackend::ThreadPoolPageIoBackend(int thread_num /* = DEFAULT_THREAD_NUM */)
+{
+  for (int i = 0; i < thread_num; i++) {
+    threads_.push_back(make_unique<thread>(&ThreadPoolPageIoBackend::thread_func, this));
+  }
+  LOG_INFO("page io thread pool started. thread num=%d", thread_num);
+}
+
+ThreadPoolPageIoBackend::~ThreadPoolPageIoBackend()
+{
+  {
+    lock_guard guard(mutex_);
+    running_ = false;
+    cond_.notify_all();
+  }
+
+  for (auto &thread : threads_) {
+    thread->join();
+  }
+  threads_.clear();
+  LOG_INFO("page io thread pool stopped");
+}
+
+RC ThreadPoolPageIoBackend::submit(PageIoBatch &batch)
+{
+  start_batch(batch);
+
+  lock_guard guard(mutex_);
+  if (!running_) {
+    return RC::INTERNAL;
+  }
+
+  for (int i = 0; i < batch.size(); i++) {
+    tasks_.push_back(Task{&batch, i});
+  }
+  cond_.notify_all();
+  return RC::SUCCESS;
+}
+
+void ThreadPoolPageIoBackend::thread_func()
+{
+  thread_set_name("PageIo");
+
+  unique_lock lock(mutex_);
+  while (true) {
+    cond_.wait(lock, [this]() { return !running_ || !tasks_.empty(); });
+    // 退出之前把已经提交的请求做完，否则等待的线程永远也等不到
+    if (tasks_.empty()) {
+      break;
+    }
+
+    Task task = tasks_.front();
+    tasks_.pop_front();
+    lock.unlock();
+
+    do_request(*task.batch, task.index);
+
+    lock.lock();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#ifdef USE_IO_URING
+/**
+ * @brief 使用io_uring读写
+ * @details 提交的线程把请求放到提交队列中，一个专门的线程从完成队列中取出结果。
+ * 遇到短读短写时，会接着提交剩下的部分。
+ */
+class UringPageIoBackend : public PageIoBackend
+{
+public:
+  UringPageIoBackend() = default;
+  ~UringPageIoBackend() override;
+
+  const char *name() const override { return "io_uring"; }
+
+  RC init(int queue_depth);
+
+  RC submit(PageIoBatch &batch) override;
+
+private:
+  /// 一个正在进行的请求
+  struct Context
+  {
+    PageIoBatch *batch     = nullptr;
+    int          index     = -1;
+    int64_t      done_size = 0;
+  };
+
+  /// 把请求剩下的部分放到提交队列中。调用者需要持有 sq_lock_，并且保证提交队列还有空间
+  void prepare(Context *context);
+
+  void reap_func();
+
+private:
+  struct io_uring ring_;
+  bool            ring_inited_ = false;
+  int             queue_depth_ = 0;
+
+  mutex              sq_lock_;
+  condition_variable sq_cond_;
+  int                inflight_ = 0;  ///< 已经提交还没有完成的请求个数，不能超过队列深度
+
+  unique_ptr<thread> reaper_;
+};
+
+UringPageIoBackend::~UringPageIoBackend()
+{
+  if (!ring_inited_) {
+    return;
+  }
+
+  if (reaper_) {
+    // user_data为空的请求通知完成线程退出
+    unique_lock guard(sq_lock_);
+    sq_cond_.wait(guard, [this]() { return inflight_ < queue_depth_; });
+    struct io_uring_sqe *sqe = io_uring_get_sqe(&ring_);
+    io_uring_prep_nop(sqe);
+    io_uring_sqe_set_data(sqe, nullptr);
+    io_uring_submit(&ring_);
+    guard.unlock();
+
+    reaper_->join();
+    reaper_.reset();
+  }
+
+  io_uring_queue_exit(&ring_);
+  LOG_INFO("page io uring stopped");
+}
+
+RC UringPageIoBackend::init(int queue_depth)
+{
+  int ret = io_uring_queue_init(queue_depth, &ring_, 0);
+  if (ret < 0) {
+    LOG_WARN("failed to init io_uring. queue depth=%d, error=%s", queue_depth, strerror(-ret));
+    return RC::IOERR_OPEN;
+  }
+
+  ring_inited_ = true;
+  queue_depth_ = queue_depth;
+  reaper_      = make_unique<thread>(&UringPageIoBackend::reap_func, this);
+  LOG_INFO("page io uring started. queue depth=%d", queue_depth);
+  return RC::SUCCESS;
+}
+
+void UringPageIoBackend::prepare(Context *context)
+{
+  const PageIoRequest &request = context->batch->request(context->index);
+  char                *buf     = request.buf + context->done_size;
+  const unsigned       size    = static_cast<unsigned>(request.size - context->done_size);
+  const int64_t        offset  = request.offset + context->done_size;
+
+  struct io_uring_sqe *sqe = io_uring_get_sqe(&ring_);
+  if (request.type == PageIoRequest::Type::SYNC) {
+    io_uring_prep_fsync(sqe, request.fd, IORING_FSYNC_DATASYNC);
+  } else if (request.type == PageIoRequest::Type::READ) {
+    io_uring_prep_read(sqe, request.fd, buf, size, offset);
+  } else {
+    io_uring_prep_write(sqe, request.fd, buf, size, offset);
+  }
+  io_uring_sqe_set_data(sqe, context);
+}
+
+RC UringPageIoBackend::submit(PageIoBatch &batch)
+{
+  start_batch(batch);
+
+  unique_lock guard(sq_lock_);
+  int         prepared = 0;
+  for (int i = 0; i < batch.size(); i++) {
+    if (inflight_ >= queue_depth_) {
+      // 队列满了，先把已经准备好的提交上去，再等一些请求完成
+      io_uring_submit(&ring_);
+      prepared = 0;
+      sq_cond_.wait(guard, [this]() { return inflight_ < queue_depth_; });
+    }
+
+    prepare(new Context{&batch, i, 0});
+    inflight_++;
+    prepared++;
+  }
+
+  if (prepared > 0) {
+    int ret = io_uring_submit(&ring_);
+    if (ret < 0) {
+      LOG_ERROR("failed to submit io_uring requests. error=%s", strerror(-ret));
+    }
+  }
+  return RC::SUCCESS;
+}
+
+void UringPageIoBackend::reap_func()
+{
+  thread_set_name("PageIoUring");
+
+  while (true) {
+    struct io_uring_cqe *cqe = nullptr;
+    int                  ret = io_uring_wait_cqe(&ring_, &cqe);
+    if (ret < 0) {
+      if (ret != -EINTR) {
+        LOG_ERROR("failed to wait io_uring completion. error=%s", strerror(-ret));
+      }
+      continue;
+    }
+
+    auto     *context = static_cast<Context *>(io_uring_cqe_get_data(cqe));
+    const int result  = cqe->res;
+    io_uring_cqe_seen(&ring_, cqe);
+
+    if (context == nullptr) {
+      break;
+    }
+
+    const PageIoRequest &request = context->batch->request(context->index);
+    if (result > 0) {
+      context->done_size += result;
+      if (context->done_size < request.size) {
+        // 短读短写，接着提交剩下的部分。这个请求仍然占着队列中的位置
+        lock_guard guard(sq_lock_);
+        prepare(context);
+        io_uring_submit(&ring_);
+        continue;
+      }
+    }
+
+    RC rc = RC::SUCCESS;
+    if (result < 0) {
+      LOG_ERROR("failed to %s page. fd=%d, offset=%ld, size=%ld, error=%s",
+                request_type_name(request.type), request.fd, request.offset, request.size, strerror(-result));
+      rc = request_error(request.type);
+    }
+
+    complete_request(*context->batch, context->index, context->done_size, rc);
+    delete context;
+
+    lock_guard guard(sq_lock_);
+    inflight_--;
+    sq_cond_.notify_one();
+  }
+}
+#endif  // USE_IO_URING
+
+////////////////////////////////////////////////////////////////////////////////
+unique_ptr<PageIoBackend> PageIoBackend::create(const string &name)
+{
+  if (name.empty() || 0 == strcasecmp(name.c_str(), "sync")) {
+    return make_unique<SyncPageIoBackend>();
+  }
+  if (0 == strcasecmp(name.c_str(), "thread_pool")) {
+    return make_unique<ThreadPoolPageIoBackend>();
+  }
+  if (0 == strcasecmp(name.c_str(), "io_uring")) {
+#ifdef USE_IO_URING
+    auto backend = make_unique<UringPageIoBackend>();
+    if (OB_SUCC(backend->init(DEFAULT_QUEUE_DEPTH))) {
+      return backend;
+    }
+    LOG_WARN("io_uring is not available, use thread_pool instead");
+#else
+    LOG_INFO("observer is built without io_uring, use thread_pool instead");
+#endif
+    return make_unique<ThreadPoolPageIoBackend>();
+  }
+  return nullptr;
+}
@@ -0,0 +1,182 @@
+/* Copyright (c) 2021-2022 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include "common/lang/deque.h"
+#include "common/lang/memory.h"
+#include "common/lang/mutex.h"
+#include "common/lang/string.h"
+#include "common/lang/thread.h"
+#include "common/lang/vector.h"
+#include "common/sys/rc.h"
+
+/**
+ * @brief 一个页面读写请求
+ * @ingroup BufferPool
+ * @details 读写的位置由offset指定，不会使用也不会修改文件的偏移量，所以同一个文件的多个请求可以同时进行。
+ * SYNC 请求把文件的数据刷到磁盘上(fdatasync)，它不会等待同一批次中的其它请求，需要的话要放在下一个批次中。
+ */
+struct PageIoRequest
+{
+  enum class Type
+  {
+    READ,
+    WRITE,
+    SYNC
+  };
+
+  Type    type   = Type::READ;
+  int     fd     = -1;
+  int64_t offset = 0;
+  char   *buf    = nullptr;
+  int64_t size   = 0;
+
+  int64_t done_size = 0;            ///< 完成后实际读写的字节数。读到文件末尾时可能比size少
+  RC      rc        = RC::SUCCESS;  ///< 完成后的结果
+};
+
+/**
+ * @brief 一批页面读写请求
+ * @ingroup BufferPool
+ * @details 由调用者持有。提交给 PageIoBackend 之后，所有的请求完成之前，不能释放这个对象，也不能访问请求中的缓冲区。
+ * 一个batch只能提交一次。
+ */
+class PageIoBatch
+{
+public:
+  PageIoBatch() = default;
+  ~PageIoBatch();
+
+  void add_read(int fd, int64_t offset, void *buf, int64_t size);
+  void add_write(int fd, int64_t offset, const void *buf, int64_t size);
+  void add_sync(int fd);
+
+  bool empty() const { return requests_.empty(); }
+  int  size() const { return static_cast<int>(requests_.size()); }
+
+  const PageIoRequest &request(int index) const { return requests_[index]; }
+
+  /**
+   * @brief 等待所有的请求完成
+   * @return RC 第一个失败的请求的错误码。读到文件末尾不算失败，需要调用者检查 done_size
+   */
+  RC wait();
+
+private:
+  friend class PageIoBackend;
+
+  /// 提交之前调用
+  void start();
+
+  /// 由后端在某个请求完成时调用，可能在任意线程中
+  void complete(int index, int64_t done_size, RC rc);
+
+private:
+  vector<PageIoRequest> requests_;
+
+  mutex              lock_;
+  condition_variable cond_;
+  int                pending_ = 0;  ///< 还没有完成的请求个数
+};
+
+/**
+ * @brief 页面IO的后端
+ * @ingroup BufferPool
+ * @details 所有的页面读写都通过这里完成。请求按批次提交，提交之后立即返回，调用者可以先做别的事情，
+ * 需要结果时再调用 PageIoBatch::wait。同一批次中的请求可能以任意的顺序、同时完成。
+ * 当前支持三种实现：
+ * - sync 在提交的线程中直接读写，提交返回时请求就已经完成了；
+ * - thread_pool 由几个IO线程使用 pread/pwrite 完成；
+ * - io_uring 使用Linux的io_uring，编译时需要打开 WITH_IO_URING 并且找到 liburing。
+ *   不支持时会退化成 thread_pool。
+ */
+class PageIoBackend
+{
+public:
+  /// thread_pool 默认的线程个数
+  static constexpr int DEFAULT_THREAD_NUM = 4;
+  /// io_uring 默认的队列深度
+  static constexpr int DEFAULT_QUEUE_DEPTH = 128;
+
+public:
+  virtual ~PageIoBackend() = default;
+
+  virtual const char *name() const = 0;
+
+  /**
+   * @brief 异步地提交一批请求
+   */
+  virtual RC submit(PageIoBatch &batch) = 0;
+
+  /**
+   * @brief 提交一批请求并等待它们完成
+   */
+  RC execute(PageIoBatch &batch);
+
+  /**
+   * @brief 根据名字创建页面IO的后端
+   * @param name sync、thread_pool 或 io_uring。io_uring 不可用时返回 thread_pool
+   * @return 不认识的名字返回nullptr
+   */
+  static unique_ptr<PageIoBackend> create(const string &name);
+
+protected:
+  static void start_batch(PageIoBatch &batch) { batch.start(); }
+  static void complete_request(PageIoBatch &batch, int index, int64_t done_size, RC rc)
+  {
+    batch.complete(index, done_size, rc);
+  }
+
+  /// 同步地完成一个请求，sync与thread_pool使用
+  static void do_request(PageIoBatch &batch, int index);
+};
+
+/**
+ * @brief 在提交的线程中同步地读写
+ */
+class SyncPageIoBackend : public PageIoBackend
+{
+public:
+  const char *name() const override { return "sync"; }
+
+  RC submit(PageIoBatch &batch) override;
+};
+
+/**
+ * @brief 使用几个IO线程完成读写
+ * @details 一个批次中的请求会分给所有的线程同时执行
+ */
+class ThreadPoolPageIoBackend : public PageIoBackend
+{
+public:
+  explicit ThreadPoolPageIoBackend(int thread_num = DEFAULT_THREAD_NUM);
+  ~ThreadPoolPageIoBackend() override;
+
+  const char *name() const override { return "thread_pool"; }
+
+  RC submit(PageIoBatch &batch) override;
+
+private:
+  void thread_func();
+
+private:
+  struct Task
+  {
+    PageIoBatch *batch = nullptr;
+    int          index = -1;
+  };
+
+  vector<unique_ptr<thread>> threads_;
+  mutex                      mutex_;
+  condition_variable         cond_;
+  deque<Task>                tasks_;
+  bool                       running_ = true;
+};
@@ -0,0 +1,97 @@
+/* Copyright (c) 2021-2022 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "storage/buffer/page_prefetcher.h"
+#include "common/log/log.h"
+#include "common/thread/thread_util.h"
+#include "storage/buffer/disk_buffer_pool.h"
+
+using namespace common;
+
+PagePrefetcher::~PagePrefetcher() { stop(); }
+
+RC PagePrefetcher::start(int window, int thread_num /* = DEFAULT_THREAD_NUM */)
+{
+  if (window <= 0 || thread_num <= 0) {
+    LOG_INFO("page prefetcher is disabled");
+    return RC::SUCCESS;
+  }
+
+  lock_guard guard(mutex_);
+  if (running_) {
+    LOG_ERROR("page prefetcher has been started");
+    return RC::INTERNAL;
+  }
+
+  running_ = true;
+  for (int i = 0; i < thread_num; i++) {
+    threads_.push_back(make_unique<thread>(&PagePrefetcher::thread_func, this));
+  }
+  window_.store(window);
+  LOG_INFO("page prefetcher started. window=%d, thread num=%d", window, thread_num);
+  return RC::SUCCESS;
+}
+
+void PagePrefetcher::stop()
+{
+  {
+    lock_guard guard(mutex_);
+    if (!running_) {
+      return;
+    }
+
+    window_.store(0);
+    running_ = false;
+    cond_.notify_all();
+  }
+
+  for (auto &thread : threads_) {
+    thread->join();
+  }
+  threads_.clear();
+  LOG_INFO("page prefetcher stopped");
+}
+
+RC PagePrefetcher::submit(DiskBufferPool &buffer_pool, vector<PageNum> page_nums)
+{
+  lock_guard guard(mutex_);
+  if (!running_) {
+    return RC::INVALID_ARGUMENT;
+  }
+
+  tasks_.push_back(Task{&buffer_pool, std::move(page_nums)});
+  cond_.notify_one();
+  return RC::SUCCESS;
+}
+
+void PagePrefetcher::thread_func()
+{
+  thread_set_name("PagePrefetcher");
+  LOG_INFO("page prefetcher thread started");
+
+  unique_lock lock(mutex_);
+  while (true) {
+    cond_.wait(lock, [this]() { return !running_ || !tasks_.empty(); });
+    // 停止之前要把已经提交的任务执行完，DiskBufferPool 关闭文件时会等待这些任务
+    if (tasks_.empty()) {
+      break;
+    }
+
+    Task task = std::move(tasks_.front());
+    tasks_.pop_front();
+    lock.unlock();
+
+    task.buffer_pool->load_pages_ahead(task.page_nums);
+
+    lock.lock();
+  }
+
+  LOG_INFO("page prefetcher thread stopped");
+}
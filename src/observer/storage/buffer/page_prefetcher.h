@@ -0,0 +1,80 @@
+/* Copyright (c) 2021-2022 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include "common/lang/atomic.h"
+#include "common/lang/deque.h"
+#include "common/lang/memory.h"
+#include "common/lang/mutex.h"
+#include "common/lang/thread.h"
+#include "common/lang/vector.h"
+#include "common/sys/rc.h"
+#include "common/types.h"
+
+class DiskBufferPool;
+
+/**
+ * @brief 预读线程
+ * @ingroup BufferPool
+ * @details 顺序扫描时，每个页面都要在访问时同步地从磁盘读取，扫描的速度受限于单个页面读取的延迟。
+ * 扫描时 BufferPoolIterator 会提前把后面的一批页面交给预读线程，预读线程把其中连续的页面用一次
+ * preadv读出来，再放到页帧中。这样磁盘读取与扫描的计算可以同时进行，冷数据的扫描也能跑满磁盘带宽。
+ */
+class PagePrefetcher
+{
+public:
+  /// 默认的预读线程个数
+  static constexpr int DEFAULT_THREAD_NUM = 2;
+
+public:
+  PagePrefetcher() = default;
+  ~PagePrefetcher();
+
+  /**
+   * @brief 启动预读线程
+   * @param window 每次预读多少个页面。不大于0时不启动，扫描时也就不会预读
+   * @param thread_num 预读线程的个数
+   */
+  RC start(int window, int thread_num = DEFAULT_THREAD_NUM);
+
+  /**
+   * @brief 执行完已经提交的任务，然后停止预读线程
+   */
+  void stop();
+
+  /**
+   * @brief 每次预读多少个页面。没有启动时返回0
+   */
+  int window() const { return window_.load(); }
+
+  /**
+   * @brief 提交一批需要预读的页面
+   * @details 由 DiskBufferPool::read_ahead 调用，预读线程会调用 DiskBufferPool::load_pages_ahead
+   */
+  RC submit(DiskBufferPool &buffer_pool, vector<PageNum> page_nums);
+
+private:
+  void thread_func();
+
+private:
+  struct Task
+  {
+    DiskBufferPool *buffer_pool = nullptr;
+    vector<PageNum> page_nums;
+  };
+
+  vector<unique_ptr<thread>> threads_;
+  mutex                      mutex_;
+  condition_variable         cond_;
+  deque<Task>                tasks_;
+  bool                       running_ = false;
+  atomic<int>                window_{0};
+};
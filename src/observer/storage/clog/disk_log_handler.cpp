@@ -26,7 +26,13 @@ using namespace common;
 RC DiskLogHandler::init(const char *path)
 {
   const int max_entry_number_per_file = 1000;
-  return file_manager_.init(path, max_entry_number_per_file);
+  RC        rc                        = file_manager_.init(path, max_entry_number_per_file);
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  // 回放日志之后会使用最大的LSN重新初始化缓冲区
+  return entry_buffer_.init(0);
 }
 
 RC DiskLogHandler::start()
@@ -51,6 +57,13 @@ RC DiskLogHandler::stop()
 
   running_.store(false);
 
+  // 刷盘线程会把剩余的日志都刷到磁盘后再退出
+  {
+    lock_guard guard(flusher_mutex_);
+    flusher_cond_.notify_one();
+  }
+  notify_waiters(true /*all*/);
+
   LOG_INFO("log handler stopped");
   return RC::SUCCESS;
 }
@@ -133,6 +146,15 @@ RC DiskLogHandler::iterate(function<RC(LogEntry &)> consumer, LSN start_lsn)
   return RC::SUCCESS;
 }
 
+RC DiskLogHandler::truncate(LSN check_point_lsn)
+{
+  RC rc = file_manager_.remove_files_before(check_point_lsn);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to remove clog files. check point lsn=%ld, rc=%s", check_point_lsn, strrc(rc));
+  }
+  return rc;
+}
+
 RC DiskLogHandler::_append(LSN &lsn, LogModule module, vector<char> &&data)
 {
   ASSERT(running_.load(), "log handler is not running. lsn=%ld, module=%s, size=%d", 
@@ -144,16 +166,30 @@ RC DiskLogHandler::_append(LSN &lsn, LogModule module, vector<char> &&data)
     return rc;
   }
 
+  wakeup_flusher();
   return RC::SUCCESS;
 }
 
 RC DiskLogHandler::wait_lsn(LSN lsn)
 {
-  // 直接强制等待。在生产系统中，我们可能会使用条件变量来等待。
-  while (running_.load() && current_flushed_lsn() < lsn) {
-    this_thread::sleep_for(chrono::milliseconds(100));
+  if (current_flushed_lsn() >= lsn) {
+    return RC::SUCCESS;
   }
 
+  /*
+  组提交：等待者按照LSN挂在waiters_上，刷盘线程每刷完一批日志，就唤醒LSN已经落盘的那些等待者。
+  检查flushed_lsn与注册都在waiter_mutex_的保护下进行，而刷盘线程总是先更新flushed_lsn再加锁唤醒，
+  所以不会丢失唤醒。停止时会唤醒所有的等待者。
+  */
+  LsnWaiter waiter;
+
+  unique_lock lock(waiter_mutex_);
+  if (current_flushed_lsn() < lsn && running_.load()) {
+    waiters_.emplace(lsn, &waiter);
+    waiter.cond.wait(lock, [&waiter]() { return waiter.notified; });
+  }
+  lock.unlock();
+
   if (current_flushed_lsn() >= lsn) {
     return RC::SUCCESS;
   } else {
@@ -161,12 +197,33 @@ RC DiskLogHandler::wait_lsn(LSN lsn)
   }
 }
 
+void DiskLogHandler::wakeup_flusher()
+{
+  if (flusher_sleeping_.load()) {
+    lock_guard guard(flusher_mutex_);
+    flusher_cond_.notify_one();
+  }
+}
+
+void DiskLogHandler::notify_waiters(bool all /*= false*/)
+{
+  lock_guard guard(waiter_mutex_);
+
+  const LSN flushed_lsn = current_flushed_lsn();
+  auto      iter        = waiters_.begin();
+  for (; iter != waiters_.end() && (all || iter->first <= flushed_lsn); ++iter) {
+    iter->second->notified = true;
+    iter->second->cond.notify_one();
+  }
+  waiters_.erase(waiters_.begin(), iter);
+}
+
 void DiskLogHandler::thread_func()
 {
   /*
-  这个线程一直不停的循环，检查日志缓冲区中是否有日志在内存中，如果在内存中就刷新到磁盘。
-  这种做法很粗暴简单，与生产数据库的做法不同。生产数据库通常会在内存达到一定量，或者一定时间
-  之后，会刷新一下磁盘。这样做的好处是减少磁盘的IO次数，提高性能。
+  这个线程在缓冲区中没有日志时会在条件变量上等待，有新日志追加进来时就会被唤醒。
+  每次唤醒会把缓冲区中所有的日志一次性刷到磁盘，然后唤醒那些等待的日志已经落盘的线程，
+  也就是组提交(group commit)。这样多个并发提交的事务可以共享一次刷盘。
   */
   thread_set_name("LogHandler");
   LOG_INFO("log handler thread started");
@@ -198,11 +255,28 @@ void DiskLogHandler::thread_func()
       LOG_WARN("failed to flush log entry buffer. rc=%s", strrc(rc));
     }
 
+    if (flush_count > 0) {
+      notify_waiters();
+    }
+
     if (flush_count == 0 && rc == RC::SUCCESS) {
-      this_thread::sleep_for(chrono::milliseconds(100));
-      continue;
+      if (entry_buffer_.entry_number() > 0) {
+        // 有日志已经预留了位置，但是还没有拷贝完成，稍等一下就可以刷盘了
+        this_thread::yield();
+        continue;
+      }
+
+      // 先设置休眠标识再检查缓冲区，与追加日志的线程先写缓冲区再检查休眠标识相对应，不会丢失唤醒。
+      // 超时只是一个保护措施
+      unique_lock lock(flusher_mutex_);
+      flusher_sleeping_.store(true);
+      flusher_cond_.wait_for(lock, chrono::milliseconds(100), [this]() {
+        return !running_.load() || entry_buffer_.entry_number() > 0;
+      });
+      flusher_sleeping_.store(false);
     }
   }
 
+  notify_waiters(true /*all*/);
   LOG_INFO("log handler thread stopped");
 }
@@ -18,7 +18,9 @@ See the Mulan PSL v2 for more details. */
 #include "common/sys/rc.h"
 #include "common/lang/vector.h"
 #include "common/lang/deque.h"
+#include "common/lang/map.h"
 #include "common/lang/memory.h"
+#include "common/lang/mutex.h"
 #include "common/lang/thread.h"
 #include "storage/clog/log_module.h"
 #include "storage/clog/log_file.h"
@@ -33,6 +35,8 @@ class LogReplayer;
  * @details 该模块负责日志的写入、读取、回放等功能。
  * 会在后台开启一个线程，一直尝试刷新内存中的日志到磁盘。
  * 所有的CLog日志文件都存放在指定的目录下，每个日志文件按照日志条数来划分。
+ * 刷盘使用组提交(group commit)：后台线程在有新日志时被唤醒，一次刷新缓冲区中所有的日志，
+ * 然后只唤醒那些等待的LSN已经落盘的线程。
  * 调用的顺序应该是：
  * @code {.cpp}
  * DiskLogHandler handler;
@@ -92,7 +96,7 @@ public:
 
   /**
    * @brief 等待指定的日志刷盘
-   *
+   * @details 调用线程会挂在条件变量上，直到刷盘线程把这条日志写入磁盘后将其唤醒
    * @param lsn 想要等待的日志
    */
   RC wait_lsn(LSN lsn) override;
@@ -102,6 +106,11 @@ public:
   /// @brief 当前刷新到哪个日志
   LSN current_flushed_lsn() const { return entry_buffer_.flushed_lsn(); }
 
+  /**
+   * @brief 删除所有日志都在检查点之前的日志文件
+   */
+  RC truncate(LSN check_point_lsn) override;
+
 private:
   /**
    * @brief 在缓存中增加一条日志
@@ -118,6 +127,17 @@ private:
    */
   void thread_func();
 
+  /**
+   * @brief 如果刷盘线程正在等待新的日志，就唤醒它
+   */
+  void wakeup_flusher();
+
+  /**
+   * @brief 唤醒所有等待的LSN已经刷盘的线程
+   * @param all 是否唤醒所有等待者，停止时使用
+   */
+  void notify_waiters(bool all = false);
+
 private:
   unique_ptr<thread> thread_;          /// 刷新日志的线程
   atomic_bool        running_{false};  /// 是否还要继续运行
@@ -125,5 +145,19 @@ private:
   LogFileManager file_manager_;  /// 管理所有的日志文件
   LogEntryBuffer entry_buffer_;  /// 缓存日志
 
+  mutex              flusher_mutex_;            /// 保护刷盘线程的休眠与唤醒
+  condition_variable flusher_cond_;             /// 刷盘线程在这里等待新的日志
+  atomic_bool        flusher_sleeping_{false};  /// 刷盘线程是否在等待新的日志
+
+  /// 一个等待日志刷盘的线程
+  struct LsnWaiter
+  {
+    condition_variable cond;
+    bool               notified = false;  /// 是否已经被唤醒并从waiters_中移除
+  };
+
+  mutex                      waiter_mutex_;  /// 保护waiters_
+  multimap<LSN, LsnWaiter *> waiters_;       /// 等待刷盘的线程，按照等待的LSN排序
+
   string path_;  /// 日志文件存放的目录
 };
@@ -14,6 +14,141 @@ See the Mulan PSL v2 for more details. */
 
 #include "storage/clog/integrated_log_replayer.h"
 #include "storage/clog/log_entry.h"
+#include "common/lang/deque.h"
+#include "common/lang/mutex.h"
+#include "common/lang/serializer.h"
+#include "common/lang/string.h"
+#include "common/lang/thread.h"
+#include "common/thread/thread_util.h"
+
+using namespace common;
+
+/**
+ * @brief 并行回放时的一个回放线程
+ * @details 按照接收的顺序回放分配给它的日志。等待回放的日志个数有上限，超过上限时分发日志的线程需要等待，
+ * 避免日志全部读到内存中。
+ */
+class IntegratedLogReplayer::ReplayWorker
+{
+public:
+  ReplayWorker(IntegratedLogReplayer &replayer, int index)
+      : replayer_(replayer), index_(index), thread_(&ReplayWorker::thread_func, this)
+  {}
+
+  ~ReplayWorker() { (void)stop(); }
+
+  /**
+   * @brief 添加一条需要回放的日志
+   * @return 如果这个线程已经回放失败了，返回失败的错误码
+   */
+  RC push(LogEntry &&entry)
+  {
+    unique_lock lock(mutex_);
+    cond_.wait(lock, [this]() { return entries_.size() < MAX_PENDING_ENTRIES || OB_FAIL(rc_); });
+    if (OB_FAIL(rc_)) {
+      return rc_;
+    }
+
+    entries_.emplace_back(std::move(entry));
+    cond_.notify_all();
+    return RC::SUCCESS;
+  }
+
+  /**
+   * @brief 回放完所有的日志后退出线程
+   * @return 回放的结果
+   */
+  RC stop()
+  {
+    {
+      lock_guard guard(mutex_);
+      stopped_ = true;
+      cond_.notify_all();
+    }
+
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+    return rc_;
+  }
+
+private:
+  void thread_func()
+  {
+    string name = "LogReplay" + to_string(index_);
+    thread_set_name(name.c_str());
+
+    while (true) {
+      LogEntry entry;
+      {
+        unique_lock lock(mutex_);
+        cond_.wait(lock, [this]() { return !entries_.empty() || stopped_; });
+        if (entries_.empty()) {
+          break;
+        }
+
+        entry = std::move(entries_.front());
+        entries_.pop_front();
+        cond_.notify_all();
+      }
+
+      RC rc = replayer_.replay_entry(entry);
+      if (OB_FAIL(rc)) {
+        LOG_WARN("failed to replay log entry. worker=%d, entry=%s, rc=%s", index_, entry.to_string().c_str(), strrc(rc));
+        lock_guard guard(mutex_);
+        rc_ = rc;
+        entries_.clear();  // 后面的日志不再回放
+        cond_.notify_all();
+        break;
+      }
+    }
+  }
+
+private:
+  static constexpr size_t MAX_PENDING_ENTRIES = 4096;  ///< 最多有多少条日志等待回放
+
+  IntegratedLogReplayer &replayer_;
+  int                    index_ = 0;
+
+  mutex              mutex_;
+  condition_variable cond_;
+  deque<LogEntry>    entries_;          ///< 等待回放的日志
+  bool               stopped_ = false;  ///< 不会再有新的日志了
+  RC                 rc_      = RC::SUCCESS;
+
+  thread thread_;  ///< 放在最后，保证线程启动时其它成员都已经初始化完成
+};
+
+/**
+ * @brief 页面相关的日志关联的缓冲池ID
+ * @details 并行回放时，按照缓冲池把日志分发给回放线程。
+ * 缓冲池和record manager的日志都以固定的结构开头，B+树日志的第一个字段是缓冲池ID
+ */
+static RC buffer_pool_id_of(const LogEntry &entry, int32_t &buffer_pool_id)
+{
+  switch (entry.module().id()) {
+    case LogModule::Id::BUFFER_POOL: {
+      if (entry.payload_size() < static_cast<int32_t>(sizeof(BufferPoolLogEntry))) {
+        return RC::LOG_ENTRY_INVALID;
+      }
+      buffer_pool_id = reinterpret_cast<const BufferPoolLogEntry *>(entry.data())->buffer_pool_id;
+    } break;
+    case LogModule::Id::RECORD_MANAGER: {
+      if (entry.payload_size() < RecordLogHeader::SIZE) {
+        return RC::LOG_ENTRY_INVALID;
+      }
+      buffer_pool_id = reinterpret_cast<const RecordLogHeader *>(entry.data())->buffer_pool_id;
+    } break;
+    case LogModule::Id::BPLUS_TREE: {
+      Deserializer buffer(entry.data(), entry.payload_size());
+      if (buffer.read_int32(buffer_pool_id) != 0) {
+        return RC::LOG_ENTRY_INVALID;
+      }
+    } break;
+    default: return RC::INVALID_ARGUMENT;
+  }
+  return RC::SUCCESS;
+}
 
 IntegratedLogReplayer::IntegratedLogReplayer(BufferPoolManager &bpm)
     : buffer_pool_log_replayer_(bpm),
@@ -23,13 +158,51 @@ IntegratedLogReplayer::IntegratedLogReplayer(BufferPoolManager &bpm)
 {}
 
 IntegratedLogReplayer::IntegratedLogReplayer(BufferPoolManager &bpm, unique_ptr<LogReplayer> trx_log_replayer)
+    : IntegratedLogReplayer(bpm, std::move(trx_log_replayer), 0)
+{}
+
+IntegratedLogReplayer::IntegratedLogReplayer(
+    BufferPoolManager &bpm, unique_ptr<LogReplayer> trx_log_replayer, int worker_num)
     : buffer_pool_log_replayer_(bpm),
       record_log_replayer_(bpm),
       bplus_tree_log_replayer_(bpm),
       trx_log_replayer_(std::move(trx_log_replayer))
-{}
+{
+  if (worker_num > 1) {
+    for (int i = 0; i < worker_num; i++) {
+      workers_.emplace_back(make_unique<ReplayWorker>(*this, i));
+    }
+    LOG_INFO("replay log with %d workers", worker_num);
+  }
+}
+
+IntegratedLogReplayer::~IntegratedLogReplayer() { (void)stop_workers(); }
 
 RC IntegratedLogReplayer::replay(const LogEntry &entry)
+{
+  if (workers_.empty() || entry.module().id() == LogModule::Id::TRANSACTION) {
+    return replay_entry(entry);
+  }
+
+  int32_t buffer_pool_id = -1;
+  RC      rc             = buffer_pool_id_of(entry, buffer_pool_id);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to get buffer pool id of log entry. entry=%s, rc=%s", entry.to_string().c_str(), strrc(rc));
+    return rc;
+  }
+
+  // 日志读取之后就会被释放，所以这里需要复制一份交给回放线程
+  LogEntry copied_entry;
+  rc = copied_entry.init(entry.lsn(), entry.module(), vector<char>(entry.data(), entry.data() + entry.payload_size()));
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  ReplayWorker &worker = *workers_[static_cast<uint32_t>(buffer_pool_id) % workers_.size()];
+  return worker.push(std::move(copied_entry));
+}
+
+RC IntegratedLogReplayer::replay_entry(const LogEntry &entry)
 {
   switch (entry.module().id()) {
     case LogModule::Id::BUFFER_POOL: return buffer_pool_log_replayer_.replay(entry);
@@ -40,9 +213,28 @@ RC IntegratedLogReplayer::replay(const LogEntry &entry)
   }
 }
 
+RC IntegratedLogReplayer::stop_workers()
+{
+  RC rc = RC::SUCCESS;
+  for (unique_ptr<ReplayWorker> &worker : workers_) {
+    RC worker_rc = worker->stop();
+    if (OB_FAIL(worker_rc) && OB_SUCC(rc)) {
+      rc = worker_rc;
+    }
+  }
+  workers_.clear();
+  return rc;
+}
+
 RC IntegratedLogReplayer::on_done()
 {
-  RC rc = buffer_pool_log_replayer_.on_done();
+  RC rc = stop_workers();
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to replay log in parallel. rc=%s", strrc(rc));
+    return rc;
+  }
+
+  rc = buffer_pool_log_replayer_.on_done();
   if (OB_FAIL(rc)) {
     LOG_WARN("failed to do buffer pool log replay. rc=%s", strrc(rc));
     return rc;
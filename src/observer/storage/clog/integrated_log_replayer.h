@@ -19,13 +19,20 @@ See the Mulan PSL v2 for more details. */
 #include "storage/record/record_log.h"
 #include "storage/index/bplus_tree_log.h"
 #include "storage/trx/mvcc_trx_log.h"
+#include "common/lang/memory.h"
+#include "common/lang/vector.h"
 
 class BufferPoolManager;
 
 /**
  * @brief 整体日志回放类
  * @ingroup Clog
- * @details 负责回放所有日志，是其它各模块日志回放的分发器
+ * @details 负责回放所有日志，是其它各模块日志回放的分发器。
+ * 可以指定多个回放线程并行回放：读日志的线程按照日志关联的缓冲池(buffer pool)，把页面相关的日志
+ * (缓冲池、record manager、B+树)分发给对应的回放线程，同一个缓冲池的日志总是在同一个线程中按照LSN的顺序回放。
+ * 这里没有按照页面分发，因为分配/释放页面的日志会修改文件头，B+树的一条日志也会修改多个页面。
+ * 事务日志在回放时只会记录内存中的事务状态，不会修改页面，所以直接在读日志的线程中按顺序回放。
+ * on_done 会等待所有回放线程结束，再执行各个模块的 on_done。
  */
 class IntegratedLogReplayer : public LogReplayer
 {
@@ -44,7 +51,14 @@ public:
    * 区别于另一个构造函数，这个构造函数可以指定不同的事务日志回放器。比如进程启动时可以指定选择使用VacuousTrx还是MvccTrx。
    */
   IntegratedLogReplayer(BufferPoolManager &bpm, unique_ptr<LogReplayer> trx_log_replayer);
-  virtual ~IntegratedLogReplayer() = default;
+
+  /**
+   * @brief 构造函数
+   * @details 使用多个线程并行回放页面相关的日志
+   * @param worker_num 回放线程的个数。小于等于1时在当前线程中串行回放
+   */
+  IntegratedLogReplayer(BufferPoolManager &bpm, unique_ptr<LogReplayer> trx_log_replayer, int worker_num);
+  virtual ~IntegratedLogReplayer();
 
   //! @copydoc LogReplayer::replay
   RC replay(const LogEntry &entry) override;
@@ -52,9 +66,20 @@ public:
   //! @copydoc LogReplayer::on_done
   RC on_done() override;
 
+private:
+  class ReplayWorker;
+
+  /// @brief 把日志交给对应模块的回放器回放
+  RC replay_entry(const LogEntry &entry);
+
+  /// @brief 等待所有回放线程回放完成并退出，返回第一个回放失败的错误码
+  RC stop_workers();
+
 private:
   BufferPoolLogReplayer   buffer_pool_log_replayer_;  ///< 缓冲池日志回放器
   RecordLogReplayer       record_log_replayer_;       ///< record manager 日志回放器
   BplusTreeLogReplayer    bplus_tree_log_replayer_;   ///< bplus tree 日志回放器
   unique_ptr<LogReplayer> trx_log_replayer_;          ///< trx 日志回放器
+
+  vector<unique_ptr<ReplayWorker>> workers_;  ///< 并行回放的线程。为空时串行回放
 };
\ No newline at end of file
@@ -14,18 +14,41 @@ See the Mulan PSL v2 for more details. */
 
 #include "storage/clog/log_buffer.h"
 #include "storage/clog/log_file.h"
+#include "common/lang/algorithm.h"
 #include "common/lang/chrono.h"
+#include "common/lang/thread.h"
+#include "common/log/log.h"
 
 using namespace common;
 
-RC LogEntryBuffer::init(LSN lsn, int32_t max_bytes /*= 0*/)
+static uint32_t round_up_power_of_two(uint32_t value)
 {
-  current_lsn_.store(lsn);
-  flushed_lsn_.store(lsn);
+  uint32_t result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
 
+RC LogEntryBuffer::init(LSN lsn, int32_t max_bytes /*= 0*/)
+{
   if (max_bytes > 0) {
     max_bytes_ = max_bytes;
   }
+
+  // 缓冲区至少要能放下一条最大的日志
+  capacity_   = round_up_power_of_two(static_cast<uint32_t>(max(max_bytes_, LogEntry::max_size())));
+  slot_count_ = capacity_ / LogHeader::SIZE;  // 每条日志至少占用 LogHeader::SIZE + 1 字节，槽位不会不够用
+  buffer_     = make_unique<char[]>(capacity_);
+  slots_      = make_unique<atomic<LSN>[]>(slot_count_);
+  for (uint32_t i = 0; i < slot_count_; i++) {
+    slots_[i].store(0, memory_order_relaxed);
+  }
+
+  reserve_.store(make_reserve(static_cast<uint32_t>(lsn), 0));
+  flushed_offset_.store(0);
+  entry_number_.store(0);
+  flushed_lsn_.store(lsn);
   return RC::SUCCESS;
 }
 
@@ -36,26 +59,45 @@ RC LogEntryBuffer::append(LSN &lsn, LogModule::Id module_id, vector<char> &&data
 
 RC LogEntryBuffer::append(LSN &lsn, LogModule module, vector<char> &&data)
 {
-  /// 控制当前buffer使用的内存
-  /// 简单粗暴，强制原地等待
-  /// 但是如果当前想要新插入的日志比较大，不会做控制。所以理论上容纳的最大buffer内存是2*max_bytes_
-  while (bytes_.load() >= max_bytes_) {
-    this_thread::sleep_for(chrono::milliseconds(10));
+  if (static_cast<int32_t>(data.size()) > LogEntry::max_payload_size()) {
+    LOG_WARN("log entry size is too large. size=%d, max_payload_size=%d", data.size(), LogEntry::max_payload_size());
+    return RC::INVALID_ARGUMENT;
   }
 
-  LogEntry entry;
-  RC       rc = entry.init(lsn, module, std::move(data));
-  if (OB_FAIL(rc)) {
-    LOG_WARN("failed to init log entry. rc=%s", strrc(rc));
-    return rc;
+  LogHeader header;
+  header.size      = static_cast<int32_t>(data.size());
+  header.module_id = module.index();
+
+  const uint32_t total_size = static_cast<uint32_t>(LogHeader::SIZE + header.size);
+
+  // 一次CAS同时预留LSN和缓冲区中的空间，这样日志在缓冲区中的顺序与LSN的顺序是一致的
+  uint64_t reserve     = reserve_.load(memory_order_relaxed);
+  uint64_t new_reserve = 0;
+  do {
+    new_reserve = make_reserve(reserve_lsn(reserve) + 1, reserve_offset(reserve) + total_size);
+  } while (!reserve_.compare_exchange_weak(reserve, new_reserve));
+
+  header.lsn            = full_lsn(flushed_lsn_.load(), reserve_lsn(new_reserve));
+  const uint32_t offset = reserve_offset(reserve);
+
+  /// 控制当前buffer使用的内存
+  /// 预留的空间还没有被刷盘线程释放时，原地等待
+  for (int i = 0; offset + total_size - flushed_offset_.load(memory_order_acquire) > capacity_; i++) {
+    if (i < 100) {
+      this_thread::yield();
+    } else {
+      this_thread::sleep_for(chrono::microseconds(100));
+    }
   }
 
-  lock_guard guard(mutex_);
-  lsn = ++current_lsn_;
-  entry.set_lsn(lsn);
+  copy_in(offset, &header, LogHeader::SIZE);
+  copy_in(offset + LogHeader::SIZE, data.data(), header.size);
 
-  entries_.push_back(std::move(entry));
-  bytes_ += entry.total_size();
+  // 先增加计数再发布，刷盘线程看到的日志条数不会是负数
+  ++entry_number_;
+  slots_[header.lsn & (slot_count_ - 1)].store(header.lsn, memory_order_release);
+
+  lsn = header.lsn;
   return RC::SUCCESS;
 }
 
@@ -63,38 +105,98 @@ RC LogEntryBuffer::flush(LogFileWriter &writer, int &count)
 {
   count = 0;
 
-  while (entry_number() > 0) {
-    LogEntry entry;
-    {
-      lock_guard guard(mutex_);
-      if (entries_.empty()) {
-        break;
-      }
-
-      LogEntry &front_entry = entries_.front();
-      ASSERT(front_entry.lsn() > 0 && front_entry.payload_size() > 0, "invalid log entry");
-      entry = std::move(entries_.front());
-      ASSERT(entry.payload_size() > 0 && entry.lsn() > 0, "invalid log entry");
-      entries_.pop_front();
-      bytes_ -= entry.total_size();
+  const LSN      start_lsn    = flushed_lsn_.load();
+  const uint32_t start_offset = flushed_offset_.load();
+
+  // 一次取出连续的、已经发布的并且当前文件能够容纳的所有日志，一起写入文件
+  LSN      lsn       = start_lsn;
+  uint32_t offset    = start_offset;
+  bool     file_full = false;
+  while (published(lsn + 1)) {
+    if (lsn + 1 > writer.end_lsn()) {
+      file_full = true;
+      break;
     }
 
-    RC rc = writer.write(entry);
-    if (OB_FAIL(rc)) {
-      lock_guard guard(mutex_);
-      entries_.emplace_front(std::move(entry));
-      LogEntry &front_entry = entries_.front();
-      ASSERT(front_entry.lsn() > 0 && front_entry.payload_size() > 0, "invalid log entry");
-      return rc;
-    } else {
-      ++count;
-      flushed_lsn_ = entry.lsn();
-    }
+    LogHeader header;
+    copy_out(offset, &header, LogHeader::SIZE);
+    ASSERT(header.lsn == lsn + 1 && header.size > 0, "invalid log entry");
+
+    offset += LogHeader::SIZE + header.size;
+    lsn = header.lsn;
+  }
+
+  if (lsn == start_lsn) {
+    // 剩下的日志不能写入当前文件了，或者没有可以刷盘的日志
+    return file_full ? RC::LOG_FILE_FULL : RC::SUCCESS;
   }
 
+  // 这些日志在缓冲区中是连续存放的，最多绕回一次，所以最多有两段内存
+  const uint32_t size     = offset - start_offset;
+  const uint32_t position = start_offset & (capacity_ - 1);
+  const uint32_t first    = min(size, capacity_ - position);
+
+  struct iovec iov[2];
+  int          iov_count = 1;
+  iov[0]                 = {buffer_.get() + position, first};
+  if (size > first) {
+    iov[1]    = {buffer_.get(), size - first};
+    iov_count = 2;
+  }
+
+  RC rc = writer.write(span<struct iovec>(iov, iov_count), start_lsn + 1, lsn);
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  count = static_cast<int>(lsn - start_lsn);
+  entry_number_ -= count;
+  flushed_lsn_.store(lsn);
+  flushed_offset_.store(offset, memory_order_release);  // 之后这段空间才可以被新的日志使用
   return RC::SUCCESS;
 }
 
-int64_t LogEntryBuffer::bytes() const { return bytes_.load(); }
+int64_t LogEntryBuffer::bytes() const
+{
+  const uint32_t flushed_offset = flushed_offset_.load();
+  return static_cast<uint32_t>(reserve_offset(reserve_.load()) - flushed_offset);
+}
+
+int32_t LogEntryBuffer::entry_number() const { return entry_number_.load(); }
+
+LSN LogEntryBuffer::current_lsn() const
+{
+  // 先读取flushed_lsn，保证它不会比预留的LSN大
+  const LSN flushed_lsn = flushed_lsn_.load();
+  return full_lsn(flushed_lsn, reserve_lsn(reserve_.load()));
+}
+
+LSN LogEntryBuffer::full_lsn(LSN base_lsn, uint32_t lsn)
+{
+  return base_lsn + static_cast<uint32_t>(lsn - static_cast<uint32_t>(base_lsn));
+}
 
-int32_t LogEntryBuffer::entry_number() const { return entries_.size(); }
+bool LogEntryBuffer::published(LSN lsn) const
+{
+  return slots_[lsn & (slot_count_ - 1)].load(memory_order_acquire) == lsn;
+}
+
+void LogEntryBuffer::copy_in(uint32_t offset, const void *data, int32_t size)
+{
+  const uint32_t position = offset & (capacity_ - 1);
+  const uint32_t first    = min(static_cast<uint32_t>(size), capacity_ - position);
+  memcpy(buffer_.get() + position, data, first);
+  if (static_cast<uint32_t>(size) > first) {
+    memcpy(buffer_.get(), static_cast<const char *>(data) + first, size - first);
+  }
+}
+
+void LogEntryBuffer::copy_out(uint32_t offset, void *data, int32_t size) const
+{
+  const uint32_t position = offset & (capacity_ - 1);
+  const uint32_t first    = min(static_cast<uint32_t>(size), capacity_ - position);
+  memcpy(data, buffer_.get() + position, first);
+  if (static_cast<uint32_t>(size) > first) {
+    memcpy(static_cast<char *>(data) + first, buffer_.get(), size - first);
+  }
+}
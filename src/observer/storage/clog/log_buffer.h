@@ -16,10 +16,9 @@ See the Mulan PSL v2 for more details. */
 
 #include "common/sys/rc.h"
 #include "common/types.h"
-#include "common/lang/mutex.h"
 #include "common/lang/vector.h"
-#include "common/lang/deque.h"
 #include "common/lang/atomic.h"
+#include "common/lang/memory.h"
 #include "storage/clog/log_module.h"
 #include "storage/clog/log_entry.h"
 
@@ -29,8 +28,13 @@ class LogFileWriter;
  * @brief 日志数据缓冲区
  * @ingroup CLog
  * @details 缓存一部分日志在内存中而不是直接写入磁盘。
- * 这里的缓存没有考虑高性能操作，比如使用预分配内存、环形缓冲池等。
- * 在生产数据库中，通常会使用预分配内存形式的缓存来提高性能，并且可以减少内存碎片。
+ * 缓冲区是一块预先分配好的环形内存，日志按照"日志头+日志数据"的格式连续存放，与日志文件中的格式相同。
+ * 追加日志时不加锁：
+ * 1. 通过一次CAS同时预留LSN和缓冲区中的一段空间；
+ * 2. 把日志直接拷贝到预留的空间中；
+ * 3. 在LSN对应的槽位上写入LSN，表示这条日志已经发布。
+ * 刷盘线程只有一个，它从上次刷盘的位置开始，取出所有连续已经发布的日志，直接把这段内存写入文件。
+ * 所以追加日志时不需要为每条日志分配内存，刷盘时也不需要拷贝。
  */
 class LogEntryBuffer
 {
@@ -38,17 +42,24 @@ public:
   LogEntryBuffer()  = default;
   ~LogEntryBuffer() = default;
 
+  /**
+   * @brief 初始化
+   * @param lsn 当前最大的LSN，新的日志从lsn+1开始
+   * @param max_bytes 缓冲区大小。会向上取整到2的幂，并且至少能放下一条最大的日志
+   */
   RC init(LSN lsn, int32_t max_bytes = 0);
 
   /**
    * @brief 在缓冲区中追加一条日志
+   * @details 日志数据会被拷贝到缓冲区中。如果缓冲区没有足够的空间，会等待刷盘线程腾出空间
    */
   RC append(LSN &lsn, LogModule::Id module_id, vector<char> &&data);
   RC append(LSN &lsn, LogModule module, vector<char> &&data);
 
   /**
    * @brief 刷新缓冲区中的日志到磁盘
-   *
+   * @details 取出当前文件能容纳的所有连续的已发布日志，一次批量写入文件。
+   * 只能有一个线程调用
    * @param file_handle 使用它来写文件
    * @param count 刷了多少条日志
    */
@@ -60,19 +71,43 @@ public:
   int64_t bytes() const;
 
   /**
-   * @brief 当前缓冲区中有多少条日志
+   * @brief 当前缓冲区中有多少条已经发布但是还没有刷盘的日志
    */
   int32_t entry_number() const;
 
-  LSN current_lsn() const { return current_lsn_.load(); }
+  LSN current_lsn() const;
   LSN flushed_lsn() const { return flushed_lsn_.load(); }
 
 private:
-  mutex mutex_;  /// 当前数据结构一定会在多线程中访问，所以强制使用有效的锁，而不是有条件生效的common::Mutex
-  deque<LogEntry> entries_;  /// 日志缓冲区
-  atomic<int64_t> bytes_;    /// 当前缓冲区中的日志数据大小
+  /// @brief 预留的LSN和缓冲区位置。高32位是LSN的低32位，低32位是缓冲区中的字节偏移（未取模）
+  static uint64_t make_reserve(uint32_t lsn, uint32_t offset) { return (uint64_t(lsn) << 32) | offset; }
+  static uint32_t reserve_lsn(uint64_t reserve) { return static_cast<uint32_t>(reserve >> 32); }
+  static uint32_t reserve_offset(uint64_t reserve) { return static_cast<uint32_t>(reserve); }
+
+  /**
+   * @brief 根据LSN的低32位还原出完整的LSN
+   * @details 缓冲区中日志的LSN与flushed_lsn的距离远小于2^32，所以可以还原出来。
+   * base_lsn 不能比要还原的LSN大
+   */
+  static LSN full_lsn(LSN base_lsn, uint32_t lsn);
+
+  /// @brief 指定LSN的日志是否已经发布（完整拷贝到了缓冲区中）
+  bool published(LSN lsn) const;
+
+  /// @brief 拷贝数据到缓冲区或从缓冲区拷贝数据，处理环形绕回的情况
+  void copy_in(uint32_t offset, const void *data, int32_t size);
+  void copy_out(uint32_t offset, void *data, int32_t size) const;
+
+private:
+  unique_ptr<char[]>        buffer_;     /// 环形缓冲区
+  unique_ptr<atomic<LSN>[]> slots_;      /// 每条日志发布时在 LSN % slot_count_ 的位置上写入LSN
+  uint32_t                  capacity_   = 0;  /// 缓冲区大小，是2的幂
+  uint32_t                  slot_count_ = 0;  /// 槽位个数，是2的幂
+
+  atomic<uint64_t> reserve_{0};         /// 已经预留的LSN和缓冲区位置，参考 make_reserve
+  atomic<uint32_t> flushed_offset_{0};  /// 已经刷盘的缓冲区位置（未取模），只有刷盘线程修改
+  atomic<int32_t>  entry_number_{0};    /// 已经发布但是还没有刷盘的日志条数。刷盘线程会在不加锁的情况下检查它
 
-  atomic<LSN> current_lsn_{0};
   atomic<LSN> flushed_lsn_{0};
 
   int32_t max_bytes_ = 4 * 1024 * 1024;  /// 缓冲区最大字节数
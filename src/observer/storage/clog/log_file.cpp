@@ -13,6 +13,8 @@ See the Mulan PSL v2 for more details. */
 //
 
 #include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 #include "common/lang/string_view.h"
 #include "common/lang/charconv.h"
@@ -152,13 +154,22 @@ RC LogFileWriter::open(const char *filename, int end_lsn)
   filename_ = filename;
   end_lsn_  = end_lsn;
 
-  fd_ = ::open(filename, O_WRONLY | O_APPEND | O_CREAT | O_SYNC, 0644);
+  // 不再使用 O_SYNC，每批日志写完后调用一次 fdatasync
+  fd_ = ::open(filename, O_WRONLY | O_CREAT, 0644);
   if (fd_ < 0) {
     LOG_WARN("open file failed. filename=%s, error=%s", filename, strerror(errno));
     return RC::FILE_OPEN;
   }
 
-  LOG_INFO("open file success. filename=%s, fd=%d", filename, fd_);
+  offset_ = lseek(fd_, 0, SEEK_END);
+  if (offset_ < 0) {
+    LOG_WARN("seek file failed. filename=%s, error=%s", filename, strerror(errno));
+    ::close(fd_);
+    fd_ = -1;
+    return RC::IOERR_SEEK;
+  }
+
+  LOG_INFO("open file success. filename=%s, fd=%d, offset=%ld", filename, fd_, offset_);
   return RC::SUCCESS;
 }
 
@@ -173,10 +184,49 @@ RC LogFileWriter::close()
   return RC::SUCCESS;
 }
 
-RC LogFileWriter::write(LogEntry &entry)
+RC LogFileWriter::write(LogEntry &entry) { return write(span<const LogEntry>(&entry, 1)); }
+
+RC LogFileWriter::write(span<const LogEntry> entries)
 {
+  if (entries.empty()) {
+    return RC::SUCCESS;
+  }
+
   // 一个日志文件写的日志条数是有限制的
-  if (entry.lsn() > end_lsn_) {
+  if (entries.back().lsn() > end_lsn_) {
+    return RC::LOG_FILE_FULL;
+  }
+
+  if (fd_ < 0) {
+    return RC::FILE_NOT_OPENED;
+  }
+
+  vector<struct iovec> iovs;
+  iovs.reserve(entries.size() * 2);
+
+  LSN last_lsn = last_lsn_;
+  for (const LogEntry &entry : entries) {
+    if (entry.lsn() <= last_lsn) {
+      LOG_WARN("write log entry failed. lsn is too small. filename=%s, last_lsn=%ld, entry=%s", 
+               filename_.c_str(), last_lsn, entry.to_string().c_str());
+      return RC::INVALID_ARGUMENT;
+    }
+    last_lsn = entry.lsn();
+
+    iovs.push_back({const_cast<LogHeader *>(&entry.header()), static_cast<size_t>(LogHeader::SIZE)});
+    iovs.push_back({const_cast<char *>(entry.data()), static_cast<size_t>(entry.payload_size())});
+  }
+
+  return write(span<struct iovec>(iovs), entries.front().lsn(), last_lsn);
+}
+
+RC LogFileWriter::write(span<struct iovec> iov, LSN first_lsn, LSN last_lsn)
+{
+  if (iov.empty()) {
+    return RC::SUCCESS;
+  }
+
+  if (last_lsn > end_lsn_) {
     return RC::LOG_FILE_FULL;
   }
 
@@ -184,30 +234,51 @@ RC LogFileWriter::write(LogEntry &entry)
     return RC::FILE_NOT_OPENED;
   }
 
-  if (entry.lsn() <= last_lsn_) {
-    LOG_WARN("write log entry failed. lsn is too small. filename=%s, last_lsn=%ld, entry=%s", 
-             filename_.c_str(), last_lsn_, entry.to_string().c_str());
+  if (first_lsn <= last_lsn_ || first_lsn > last_lsn) {
+    LOG_WARN("write log entries failed. invalid lsn. filename=%s, last_lsn=%d, first_lsn=%ld, last_lsn=%ld", 
+             filename_.c_str(), last_lsn_, first_lsn, last_lsn);
     return RC::INVALID_ARGUMENT;
   }
 
+  int64_t total_size = 0;
+  for (const struct iovec &item : iov) {
+    total_size += static_cast<int64_t>(item.iov_len);
+  }
+
   /// WARNING 这里需要处理日志写一半的情况
   /// 日志只写成功一部分到文件中非常难处理
-  int ret = writen(fd_, reinterpret_cast<const char *>(&entry.header()), LogHeader::SIZE);
+  int ret = pwritevn(fd_, iov.data(), static_cast<int>(iov.size()), offset_);
   if (0 != ret) {
-    LOG_WARN("write log entry header failed. filename=%s, ret = %d, error=%s, entry=%s", 
-             filename_.c_str(), ret, strerror(errno), entry.to_string().c_str());
+    LOG_WARN("write log entries failed. filename=%s, ret = %d, error=%s, first lsn=%ld, last lsn=%ld", 
+             filename_.c_str(), ret, strerror(ret), first_lsn, last_lsn);
     return RC::IOERR_WRITE;
   }
 
-  ret = writen(fd_, entry.data(), entry.payload_size());
-  if (0 != ret) {
-    LOG_WARN("write log entry payload failed. filename=%s, ret = %d, error=%s, entry=%s", 
-             filename_.c_str(), ret, strerror(errno), entry.to_string().c_str());
-    return RC::IOERR_WRITE;
+  if (fdatasync(fd_) != 0) {
+    LOG_WARN("sync log file failed. filename=%s, error=%s", filename_.c_str(), strerror(errno));
+    return RC::IOERR_SYNC;
   }
 
-  last_lsn_ = entry.lsn();
-  LOG_TRACE("write log entry success. filename=%s, entry=%s", filename_.c_str(), entry.to_string().c_str());
+  offset_ += total_size;
+  last_lsn_ = last_lsn;
+  LOG_TRACE("write log entries success. filename=%s, first lsn=%ld, last lsn=%ld", 
+            filename_.c_str(), first_lsn, last_lsn_);
+  return RC::SUCCESS;
+}
+
+RC LogFileWriter::preallocate(int64_t size)
+{
+  if (fd_ < 0) {
+    return RC::FILE_NOT_OPENED;
+  }
+
+#ifdef __linux__
+  if (size > offset_ && fallocate(fd_, FALLOC_FL_KEEP_SIZE, offset_, size - offset_) != 0) {
+    // 预分配只是一个优化，失败了也不影响正确性
+    LOG_INFO("failed to preallocate log file. filename=%s, size=%ld, error=%s", 
+             filename_.c_str(), size, strerror(errno));
+  }
+#endif
   return RC::SUCCESS;
 }
 
@@ -287,6 +358,7 @@ RC LogFileManager::list_files(vector<string> &files, LSN start_lsn)
 {
   files.clear();
 
+  lock_guard guard(lock_);
   // 这里的代码是AI自动生成的
   // 其实写的不好，我们只需要找到比start_lsn相等或者小的第一个日志文件就可以了
   for (auto &file : log_files_) {
@@ -300,7 +372,9 @@ RC LogFileManager::list_files(vector<string> &files, LSN start_lsn)
 
 RC LogFileManager::last_file(LogFileWriter &file_writer)
 {
+  unique_lock lock(lock_);
   if (log_files_.empty()) {
+    lock.unlock();
     return next_file(file_writer);
   }
 
@@ -314,14 +388,53 @@ RC LogFileManager::next_file(LogFileWriter &file_writer)
 {
   file_writer.close();
 
-  LSN lsn = 0;
+  unique_lock lock(lock_);
+  LSN         lsn            = 0;
+  int64_t     last_file_size = 0;
   if (!log_files_.empty()) {
     lsn = log_files_.rbegin()->first + max_entry_number_per_file_;
+
+    error_code ec;
+    last_file_size = static_cast<int64_t>(filesystem::file_size(log_files_.rbegin()->second, ec));
+    if (ec) {
+      last_file_size = 0;
+    }
   }
 
   string           filename  = file_prefix_ + to_string(lsn) + file_suffix_;
   filesystem::path file_path = directory_ / filename;
   log_files_.emplace(lsn, file_path);
+  lock.unlock();
+
+  RC rc = file_writer.open(file_path.c_str(), lsn + max_entry_number_per_file_ - 1);
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  // 每个文件存放的日志条数是固定的，所以上一个文件的大小可以用来估计新文件的大小
+  return file_writer.preallocate(last_file_size);
+}
+
+RC LogFileManager::remove_files_before(LSN lsn)
+{
+  lock_guard guard(lock_);
+
+  // 最后一个文件可能正在写入，不能删除
+  while (log_files_.size() > 1) {
+    auto iter = log_files_.begin();
+    if (iter->first + max_entry_number_per_file_ - 1 >= lsn) {
+      break;
+    }
 
-  return file_writer.open(file_path.c_str(), lsn + max_entry_number_per_file_ - 1);
+    error_code ec;
+    filesystem::remove(iter->second, ec);
+    if (ec) {
+      LOG_WARN("failed to remove log file. file=%s, error=%s", iter->second.c_str(), ec.message().c_str());
+      return RC::IOERR_DELETE;
+    }
+
+    LOG_INFO("log file removed. file=%s, checkpoint lsn=%ld", iter->second.c_str(), lsn);
+    log_files_.erase(iter);
+  }
+  return RC::SUCCESS;
 }
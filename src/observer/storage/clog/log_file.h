@@ -14,12 +14,16 @@ See the Mulan PSL v2 for more details. */
 
 #pragma once
 
+#include <sys/uio.h>
+
 #include "common/sys/rc.h"
 #include "common/types.h"
 #include "common/lang/map.h"
 #include "common/lang/functional.h"
 #include "common/lang/filesystem.h"
 #include "common/lang/fstream.h"
+#include "common/lang/mutex.h"
+#include "common/lang/span.h"
 #include "common/lang/string.h"
 
 class LogEntry;
@@ -56,6 +60,8 @@ private:
 /**
  * @brief 负责写入一个日志文件
  * @ingroup CLog
+ * @details 一批日志会组装成iovec数组，使用一次pwritev写入，然后调用一次fdatasync，
+ * 而不是每条日志的头和数据各调用一次write并使用O_SYNC同步。
  */
 class LogFileWriter
 {
@@ -76,6 +82,32 @@ public:
   /// @brief 写入一条日志
   RC write(LogEntry &entry);
 
+  /**
+   * @brief 批量写入日志
+   * @details 所有日志通过一次pwritev写入，并且只做一次fdatasync。
+   * 日志的LSN必须是递增的，并且都不能超过end_lsn。
+   * @param entries 要写入的日志
+   */
+  RC write(span<const LogEntry> entries);
+
+  /**
+   * @brief 写入一段已经序列化好的日志
+   * @details 数据是若干条连续存放的日志(日志头+日志数据)，可以分散在多块内存中，
+   * 比如环形缓冲区中绕回的两段数据。同样只调用一次pwritev和一次fdatasync。
+   * @param iov 日志数据所在的内存块。写入过程中可能会被修改
+   * @param first_lsn 第一条日志的LSN
+   * @param last_lsn 最后一条日志的LSN
+   */
+  RC write(span<struct iovec> iov, LSN first_lsn, LSN last_lsn);
+
+  /**
+   * @brief 预先给文件分配磁盘空间
+   * @details 不会改变文件大小，只是提前分配好磁盘块，避免追加写入时频繁分配空间。
+   * 仅在Linux上生效
+   * @param size 预分配的字节数
+   */
+  RC preallocate(int64_t size);
+
   /**
    * @brief 当前文件是否已经打开
    */
@@ -90,11 +122,15 @@ public:
 
   const char *filename() const { return filename_.c_str(); }
 
+  /// @brief 当前日志文件中允许写入的最大的LSN
+  LSN end_lsn() const { return end_lsn_; }
+
 private:
-  string filename_;       /// 日志文件名
-  int    fd_       = -1;  /// 日志文件描述符
-  int    last_lsn_ = 0;   /// 写入的最后一条日志LSN
-  int    end_lsn_  = 0;   /// 当前日志文件中允许写入的最大的LSN，包括这条日志
+  string  filename_;       /// 日志文件名
+  int     fd_       = -1;  /// 日志文件描述符
+  int     last_lsn_ = 0;   /// 写入的最后一条日志LSN
+  int     end_lsn_  = 0;   /// 当前日志文件中允许写入的最大的LSN，包括这条日志
+  int64_t offset_   = 0;   /// 下一次写入的文件偏移
 };
 
 /**
@@ -137,6 +173,13 @@ public:
    */
   RC next_file(LogFileWriter &file_writer);
 
+  /**
+   * @brief 删除所有日志都小于lsn的日志文件
+   * @details 检查点之前的日志在重启时不再需要回放，可以删除掉。最后一个日志文件可能正在写入，永远不会删除
+   * @param lsn 检查点LSN
+   */
+  RC remove_files_before(LSN lsn);
+
 private:
   /**
    * @brief 从文件名称中获取LSN
@@ -151,5 +194,6 @@ private:
   filesystem::path directory_;                  /// 日志文件存放的目录
   int              max_entry_number_per_file_;  /// 一个文件最大允许存放多少条日志
 
+  mutex                      lock_;       /// 保护log_files_，刷盘线程和检查点会同时访问
   map<LSN, filesystem::path> log_files_;  /// 日志文件名和第一个LSN的映射
 };
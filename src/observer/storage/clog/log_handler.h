@@ -96,6 +96,13 @@ public:
 
   virtual LSN current_lsn() const = 0;
 
+  /**
+   * @brief 删除检查点之前的日志
+   * @details 检查点之前的日志在重启时不会再回放，可以回收掉
+   * @param check_point_lsn 检查点LSN，重启时会从这个LSN开始回放
+   */
+  virtual RC truncate(LSN check_point_lsn) = 0;
+
   static RC create(const char *name, LogHandler *&handler);
 
 private:
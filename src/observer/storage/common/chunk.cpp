@@ -16,6 +16,16 @@ void Chunk::add_column(unique_ptr<Column> col, int col_id)
   column_ids_.push_back(col_id);
 }
 
+int Chunk::column_index(int col_id) const
+{
+  for (size_t i = 0; i < column_ids_.size(); ++i) {
+    if (column_ids_[i] == col_id) {
+      return static_cast<int>(i);
+    }
+  }
+  return -1;
+}
+
 RC Chunk::reference(Chunk &chunk)
 {
   reset();
@@ -27,6 +37,8 @@ RC Chunk::reference(Chunk &chunk)
     columns_[i]->reference(chunk.column(i));
     column_ids_.push_back(chunk.column_ids(i));
   }
+  select_  = chunk.select_;
+  holders_ = chunk.holders_;
   return RC::SUCCESS;
 }
 
@@ -38,6 +50,18 @@ int Chunk::rows() const
   return 0;
 }
 
+int Chunk::selected_rows() const
+{
+  if (select_.empty()) {
+    return rows();
+  }
+  int selected = 0;
+  for (uint8_t s : select_) {
+    selected += (s != 0) ? 1 : 0;
+  }
+  return selected;
+}
+
 int Chunk::capacity() const
 {
   if (!columns_.empty()) {
@@ -51,10 +75,14 @@ void Chunk::reset_data()
   for (auto &col : columns_) {
     col->reset_data();
   }
+  select_.clear();
+  holders_.clear();
 }
 
 void Chunk::reset()
 {
   columns_.clear();
   column_ids_.clear();
+  select_.clear();
+  holders_.clear();
 }
\ No newline at end of file
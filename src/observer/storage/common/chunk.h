@@ -46,6 +46,12 @@ public:
     return column_ids_[i];
   }
 
+  /**
+   * @brief 查找列ID为 col_id 的列在 Chunk 中的下标
+   * @return 找不到时返回 -1
+   */
+  int column_index(int col_id) const;
+
   void add_column(unique_ptr<Column> col, int col_id);
 
   RC reference(Chunk &chunk);
@@ -70,6 +76,26 @@ public:
    */
   Value get_value(int col_idx, int row_idx) const { return columns_[col_idx]->get_value(row_idx); }
 
+  /**
+   * @brief 选择向量，select()[i] 为 0 表示第 i 行无效，使用数据时需要跳过
+   * @details 为空表示所有的行都有效。比如直接引用 PAX 页面数据时，被删除的槽位会在这里标记为无效。
+   */
+  vector<uint8_t>       &select() { return select_; }
+  const vector<uint8_t> &select() const { return select_; }
+  bool                   has_select() const { return !select_.empty(); }
+
+  /**
+   * @brief 获取 Chunk 中有效的行数，即选择向量中被选中的行数
+   */
+  int selected_rows() const;
+
+  /**
+   * @brief 持有一个资源，直到 Chunk 被重置或者销毁
+   * @details 列数据引用了外部内存时(比如 buffer pool 中的页面)，通过这里保证这段内存在使用期间有效。
+   * 引用当前 Chunk 的其它 Chunk 也会一起持有这个资源。
+   */
+  void hold(shared_ptr<void> resource) { holders_.push_back(std::move(resource)); }
+
   /**
    * @brief 重置 Chunk 中的数据，不会修改 Chunk 的列属性。
    */
@@ -82,4 +108,7 @@ private:
   // TODO: remove it and support multi-tables,
   // `columnd_ids` store the ids of child operator that need to be output
   vector<int> column_ids_;
+
+  vector<uint8_t>          select_;   ///< 选择向量，为空表示所有行都有效
+  vector<shared_ptr<void>> holders_;  ///< 列数据引用的外部资源
 };
@@ -84,6 +84,7 @@ void Column::reset()
   own_       = false;
   attr_type_ = AttrType::UNDEFINED;
   attr_len_  = -1;
+  encoded_   = EncodedColumn();
 }
 
 RC Column::append_one(char *data) { return append(data, 1); }
@@ -127,4 +128,17 @@ void Column::reference(const Column &column)
   this->column_type_ = column.column_type();
   this->attr_type_   = column.attr_type();
   this->attr_len_    = column.attr_len();
-}
\ No newline at end of file
+  this->encoded_     = column.encoded();
+}
+
+void Column::reference(char *data, int count)
+{
+  if (data_ != nullptr && own_) {
+    delete[] data_;
+  }
+  data_     = data;
+  count_    = count;
+  capacity_ = count;
+  own_      = false;
+  encoded_  = EncodedColumn();
+}
@@ -12,6 +12,7 @@ See the Mulan PSL v2 for more details. */
 
 #include <string.h>
 
+#include "storage/common/column_encoding.h"
 #include "storage/field/field_meta.h"
 
 /**
@@ -66,13 +67,31 @@ public:
   /**
    * @brief 重置列数据，但不修改元信息
    */
-  void reset_data() { count_ = 0; }
+  void reset_data()
+  {
+    count_   = 0;
+    encoded_ = EncodedColumn();
+  }
 
   /**
    * @brief 引用另一个 Column
    */
   void reference(const Column &column);
 
+  /**
+   * @brief 引用一段外部的列数据，不会复制数据，也不会修改列的属性
+   * @param data  列数据的起始地址，调用者需要保证使用期间这段内存有效
+   * @param count 列值的个数
+   */
+  void reference(char *data, int count);
+
+  /**
+   * @brief 列中前 encoded().count() 个值在页面中的编码形式，没有编码时 encoded().valid() 为false
+   * @details 与 data() 中对应的值相同。过滤和聚合可以直接使用编码数据，不需要逐个访问 data() 中的值
+   */
+  const EncodedColumn &encoded() const { return encoded_; }
+  void                 set_encoded(const EncodedColumn &encoded) { encoded_ = encoded; }
+
   void set_column_type(Type column_type) { column_type_ = column_type; }
   void set_count(int count) { count_ = count; }
 
@@ -98,4 +117,6 @@ private:
   int attr_len_ = -1;
   /// 列类型
   Type column_type_ = Type::NORMAL_COLUMN;
+  /// 列数据的编码形式，引用的是页面中的数据
+  EncodedColumn encoded_;
 };
\ No newline at end of file
@@ -0,0 +1,462 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <string.h>
+
+#include "storage/common/column_encoding.h"
+#include "common/lang/algorithm.h"
+#include "common/lang/string_view.h"
+#include "common/lang/unordered_map.h"
+#include "common/log/log.h"
+
+namespace {
+
+int align4(int size) { return (size + 3) & ~3; }
+
+/// count 个值，每个值 width 位，压缩后占用的字节数
+int packed_size(int count, int width) { return static_cast<int>((static_cast<int64_t>(count) * width + 7) / 8); }
+
+/// 表示 value 最少需要多少位
+int bit_width(uint32_t value)
+{
+  int width = 0;
+  while (width < 32 && (value >> width) != 0) {
+    width++;
+  }
+  return width;
+}
+
+void pack(const vector<uint32_t> &values, int width, char *output)
+{
+  uint64_t buffer = 0;
+  int      bits   = 0;
+  for (uint32_t value : values) {
+    buffer |= static_cast<uint64_t>(value) << bits;
+    bits += width;
+    while (bits >= 8) {
+      *output++ = static_cast<char>(buffer & 0xFF);
+      buffer >>= 8;
+      bits -= 8;
+    }
+  }
+  if (bits > 0) {
+    *output = static_cast<char>(buffer & 0xFF);
+  }
+}
+
+uint32_t unpack(const char *packed, int packed_bytes, int width, int index)
+{
+  if (width == 0) {
+    return 0;
+  }
+  const int64_t bit  = static_cast<int64_t>(index) * width;
+  const int     byte = static_cast<int>(bit / 8);
+  uint64_t      word = 0;
+  memcpy(&word, packed + byte, min(8, packed_bytes - byte));
+  const uint32_t mask = width >= 32 ? 0xFFFFFFFFu : ((1u << width) - 1);
+  return static_cast<uint32_t>(word >> (bit % 8)) & mask;
+}
+
+template <typename T>
+bool compare_value(T left, T right, CompOp op)
+{
+  switch (op) {
+    case EQUAL_TO: return left == right;
+    case NOT_EQUAL: return left != right;
+    case LESS_EQUAL: return left <= right;
+    case LESS_THAN: return left < right;
+    case GREAT_EQUAL: return left >= right;
+    case GREAT_THAN: return left > right;
+    default: return true;
+  }
+}
+
+int run_num(int attr_len, const char *values, int count)
+{
+  int runs = count > 0 ? 1 : 0;
+  for (int i = 1; i < count; i++) {
+    if (0 != memcmp(values + (i - 1) * attr_len, values + i * attr_len, attr_len)) {
+      runs++;
+    }
+  }
+  return runs;
+}
+
+/// 字典的大小。不同的值超过一半时不再统计，返回-1，这时字典编码不会更小
+int dictionary_size(int attr_len, const char *values, int count)
+{
+  unordered_map<string_view, int> dictionary;
+  for (int i = 0; i < count; i++) {
+    dictionary.emplace(string_view(values + i * attr_len, attr_len), static_cast<int>(dictionary.size()));
+    if (static_cast<int>(dictionary.size()) > count / 2 + 1) {
+      return -1;
+    }
+  }
+  return static_cast<int>(dictionary.size());
+}
+
+bool support_frame_of_reference(AttrType attr_type, int attr_len)
+{
+  return (attr_type == AttrType::INTS || attr_type == AttrType::DATES) && attr_len == sizeof(int32_t);
+}
+
+void int_range(const char *values, int count, int32_t &min_value, int32_t &max_value)
+{
+  min_value = 0;
+  max_value = 0;
+  for (int i = 0; i < count; i++) {
+    int32_t value;
+    memcpy(&value, values + i * sizeof(value), sizeof(value));
+    if (i == 0 || value < min_value) {
+      min_value = value;
+    }
+    if (i == 0 || value > max_value) {
+      max_value = value;
+    }
+  }
+}
+
+}  // namespace
+
+const char *column_encoding_name(ColumnEncoding encoding)
+{
+  switch (encoding) {
+    case ColumnEncoding::PLAIN: return "plain";
+    case ColumnEncoding::RLE: return "rle";
+    case ColumnEncoding::DICTIONARY: return "dictionary";
+    case ColumnEncoding::FRAME_OF_REFERENCE: return "frame_of_reference";
+    default: return "unknown";
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ColumnEncoder::encode(AttrType attr_type, int attr_len, const char *values, int count, vector<char> &output)
+{
+  // 计算每种编码方式编码后的大小，选择最小的
+  const int64_t header_size = sizeof(EncodedColumn::Header);
+
+  ColumnEncoding best      = ColumnEncoding::PLAIN;
+  int64_t        best_size = header_size + static_cast<int64_t>(count) * attr_len;
+
+  const int64_t rle_size = header_size + static_cast<int64_t>(run_num(attr_len, values, count)) * (4 + attr_len);
+  if (rle_size < best_size) {
+    best      = ColumnEncoding::RLE;
+    best_size = rle_size;
+  }
+
+  if (attr_type == AttrType::CHARS) {
+    const int dict_size = dictionary_size(attr_len, values, count);
+    if (dict_size > 0) {
+      const int64_t size = header_size + static_cast<int64_t>(dict_size) * attr_len +
+                           packed_size(count, bit_width(static_cast<uint32_t>(dict_size - 1)));
+      if (size < best_size) {
+        best      = ColumnEncoding::DICTIONARY;
+        best_size = size;
+      }
+    }
+  }
+
+  if (support_frame_of_reference(attr_type, attr_len)) {
+    int32_t min_value, max_value;
+    int_range(values, count, min_value, max_value);
+    const uint32_t range = static_cast<uint32_t>(static_cast<int64_t>(max_value) - min_value);
+    const int64_t  size  = header_size + packed_size(count, bit_width(range));
+    if (size < best_size) {
+      best      = ColumnEncoding::FRAME_OF_REFERENCE;
+      best_size = size;
+    }
+  }
+
+  encode(best, attr_type, attr_len, values, count, output);
+}
+
+void ColumnEncoder::encode(
+    ColumnEncoding encoding, AttrType attr_type, int attr_len, const char *values, int count, vector<char> &output)
+{
+  if (encoding == ColumnEncoding::FRAME_OF_REFERENCE && !support_frame_of_reference(attr_type, attr_len)) {
+    encoding = ColumnEncoding::PLAIN;
+  }
+
+  EncodedColumn::Header header;
+  header.encoding = static_cast<int32_t>(encoding);
+  header.count    = count;
+  header.attr_len = attr_len;
+
+  vector<char> payload;
+  switch (encoding) {
+    case ColumnEncoding::RLE: {
+      vector<int32_t> run_ends;
+      vector<char>    run_values;
+      for (int i = 0; i < count; i++) {
+        const char *value = values + i * attr_len;
+        if (i == 0 || 0 != memcmp(values + (i - 1) * attr_len, value, attr_len)) {
+          run_ends.push_back(i + 1);
+          run_values.insert(run_values.end(), value, value + attr_len);
+        } else {
+          run_ends.back() = i + 1;
+        }
+      }
+      header.param1 = static_cast<int32_t>(run_ends.size());
+      payload.resize(run_ends.size() * sizeof(int32_t));
+      memcpy(payload.data(), run_ends.data(), payload.size());
+      payload.insert(payload.end(), run_values.begin(), run_values.end());
+    } break;
+
+    case ColumnEncoding::DICTIONARY: {
+      unordered_map<string_view, uint32_t> dictionary;
+      vector<uint32_t>                     codes;
+      vector<char>                         dictionary_values;
+      codes.reserve(count);
+      for (int i = 0; i < count; i++) {
+        const char *value  = values + i * attr_len;
+        auto        result = dictionary.emplace(string_view(value, attr_len), static_cast<uint32_t>(dictionary.size()));
+        if (result.second) {
+          dictionary_values.insert(dictionary_values.end(), value, value + attr_len);
+        }
+        codes.push_back(result.first->second);
+      }
+      const int width = dictionary.empty() ? 0 : bit_width(static_cast<uint32_t>(dictionary.size() - 1));
+      header.param1   = static_cast<int32_t>(dictionary.size());
+      header.param2   = width;
+      payload         = std::move(dictionary_values);
+      const size_t packed_offset = payload.size();
+      payload.resize(packed_offset + packed_size(count, width), 0);
+      pack(codes, width, payload.data() + packed_offset);
+    } break;
+
+    case ColumnEncoding::FRAME_OF_REFERENCE: {
+      int32_t min_value, max_value;
+      int_range(values, count, min_value, max_value);
+      vector<uint32_t> deltas(count);
+      for (int i = 0; i < count; i++) {
+        int32_t value;
+        memcpy(&value, values + i * sizeof(value), sizeof(value));
+        deltas[i] = static_cast<uint32_t>(static_cast<int64_t>(value) - min_value);
+      }
+      const int width = bit_width(static_cast<uint32_t>(static_cast<int64_t>(max_value) - min_value));
+      header.param1   = min_value;
+      header.param2   = width;
+      payload.resize(packed_size(count, width), 0);
+      pack(deltas, width, payload.data());
+    } break;
+
+    case ColumnEncoding::PLAIN:
+    default: {
+      header.encoding = static_cast<int32_t>(ColumnEncoding::PLAIN);
+      payload.assign(values, values + static_cast<int64_t>(count) * attr_len);
+    } break;
+  }
+
+  header.size        = align4(sizeof(header) + payload.size());
+  const size_t start = output.size();
+  output.resize(start + header.size, 0);
+  memcpy(output.data() + start, &header, sizeof(header));
+  if (!payload.empty()) {
+    memcpy(output.data() + start + sizeof(header), payload.data(), payload.size());
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+EncodedColumn::EncodedColumn(const char *data) : data_(data) { memcpy(&header_, data, sizeof(header_)); }
+
+int EncodedColumn::run_of(int index) const
+{
+  const int32_t *run_ends = reinterpret_cast<const int32_t *>(payload());
+  return static_cast<int>(std::upper_bound(run_ends, run_ends + header_.param1, index) - run_ends);
+}
+
+void EncodedColumn::decode(char *output) const
+{
+  const int attr_len = header_.attr_len;
+  switch (encoding()) {
+    case ColumnEncoding::PLAIN: {
+      memcpy(output, payload(), static_cast<int64_t>(header_.count) * attr_len);
+    } break;
+
+    case ColumnEncoding::RLE: {
+      const int32_t *run_ends   = reinterpret_cast<const int32_t *>(payload());
+      const char    *run_values = payload() + header_.param1 * sizeof(int32_t);
+      for (int run = 0, index = 0; run < header_.param1; run++) {
+        for (; index < run_ends[run]; index++) {
+          memcpy(output + index * attr_len, run_values + run * attr_len, attr_len);
+        }
+      }
+    } break;
+
+    case ColumnEncoding::DICTIONARY: {
+      const char *dictionary   = payload();
+      const char *packed       = dictionary + header_.param1 * attr_len;
+      const int   packed_bytes = packed_size(header_.count, header_.param2);
+      for (int i = 0; i < header_.count; i++) {
+        const uint32_t code = unpack(packed, packed_bytes, header_.param2, i);
+        memcpy(output + i * attr_len, dictionary + code * attr_len, attr_len);
+      }
+    } break;
+
+    case ColumnEncoding::FRAME_OF_REFERENCE: {
+      const int packed_bytes = packed_size(header_.count, header_.param2);
+      for (int i = 0; i < header_.count; i++) {
+        const int32_t value = static_cast<int32_t>(header_.param1 + unpack(payload(), packed_bytes, header_.param2, i));
+        memcpy(output + i * sizeof(value), &value, sizeof(value));
+      }
+    } break;
+
+    default: {
+      LOG_ERROR("unknown column encoding %d", header_.encoding);
+    } break;
+  }
+}
+
+void EncodedColumn::get(int index, char *output) const
+{
+  const int attr_len = header_.attr_len;
+  switch (encoding()) {
+    case ColumnEncoding::PLAIN: {
+      memcpy(output, payload() + index * attr_len, attr_len);
+    } break;
+
+    case ColumnEncoding::RLE: {
+      const char *run_values = payload() + header_.param1 * sizeof(int32_t);
+      memcpy(output, run_values + run_of(index) * attr_len, attr_len);
+    } break;
+
+    case ColumnEncoding::DICTIONARY: {
+      const char    *dictionary = payload();
+      const char    *packed     = dictionary + header_.param1 * attr_len;
+      const uint32_t code = unpack(packed, packed_size(header_.count, header_.param2), header_.param2, index);
+      memcpy(output, dictionary + code * attr_len, attr_len);
+    } break;
+
+    case ColumnEncoding::FRAME_OF_REFERENCE: {
+      const uint32_t delta = unpack(payload(), packed_size(header_.count, header_.param2), header_.param2, index);
+      const int32_t  value = static_cast<int32_t>(header_.param1 + delta);
+      memcpy(output, &value, sizeof(value));
+    } break;
+
+    default: {
+      LOG_ERROR("unknown column encoding %d", header_.encoding);
+    } break;
+  }
+}
+
+template <typename T>
+void EncodedColumn::filter(CompOp op, T value, uint8_t *select) const
+{
+  switch (encoding()) {
+    case ColumnEncoding::RLE: {
+      // 每个 run 只比较一次
+      const int32_t *run_ends   = reinterpret_cast<const int32_t *>(payload());
+      const char    *run_values = payload() + header_.param1 * sizeof(int32_t);
+      for (int run = 0, begin = 0; run < header_.param1; run++) {
+        T run_value;
+        memcpy(&run_value, run_values + run * sizeof(T), sizeof(T));
+        if (!compare_value<T>(run_value, value, op)) {
+          memset(select + begin, 0, run_ends[run] - begin);
+        }
+        begin = run_ends[run];
+      }
+    } break;
+
+    case ColumnEncoding::DICTIONARY: {
+      // 每个字典项只比较一次
+      const char     *dictionary = payload();
+      vector<uint8_t> matched(header_.param1);
+      for (int code = 0; code < header_.param1; code++) {
+        T dictionary_value;
+        memcpy(&dictionary_value, dictionary + code * sizeof(T), sizeof(T));
+        matched[code] = compare_value<T>(dictionary_value, value, op) ? 1 : 0;
+      }
+      const char *packed       = dictionary + header_.param1 * sizeof(T);
+      const int   packed_bytes = packed_size(header_.count, header_.param2);
+      for (int i = 0; i < header_.count; i++) {
+        select[i] &= matched[unpack(packed, packed_bytes, header_.param2, i)];
+      }
+    } break;
+
+    case ColumnEncoding::FRAME_OF_REFERENCE: {
+      // 常量减去最小值之后，直接与差值比较，不需要还原每个值
+      const int64_t target       = static_cast<int64_t>(value) - header_.param1;
+      const int     packed_bytes = packed_size(header_.count, header_.param2);
+      for (int i = 0; i < header_.count; i++) {
+        const int64_t delta = unpack(payload(), packed_bytes, header_.param2, i);
+        select[i] &= compare_value<int64_t>(delta, target, op) ? 1 : 0;
+      }
+    } break;
+
+    case ColumnEncoding::PLAIN:
+    default: {
+      for (int i = 0; i < header_.count; i++) {
+        T item;
+        memcpy(&item, payload() + i * sizeof(T), sizeof(T));
+        select[i] &= compare_value<T>(item, value, op) ? 1 : 0;
+      }
+    } break;
+  }
+}
+
+template <typename T>
+T EncodedColumn::sum() const
+{
+  T result = 0;
+  switch (encoding()) {
+    case ColumnEncoding::RLE: {
+      const int32_t *run_ends   = reinterpret_cast<const int32_t *>(payload());
+      const char    *run_values = payload() + header_.param1 * sizeof(int32_t);
+      for (int run = 0, begin = 0; run < header_.param1; run++) {
+        T run_value;
+        memcpy(&run_value, run_values + run * sizeof(T), sizeof(T));
+        result += run_value * static_cast<T>(run_ends[run] - begin);
+        begin = run_ends[run];
+      }
+    } break;
+
+    case ColumnEncoding::DICTIONARY: {
+      const char   *dictionary   = payload();
+      const char   *packed       = dictionary + header_.param1 * sizeof(T);
+      const int     packed_bytes = packed_size(header_.count, header_.param2);
+      vector<int>   counts(header_.param1, 0);
+      for (int i = 0; i < header_.count; i++) {
+        counts[unpack(packed, packed_bytes, header_.param2, i)]++;
+      }
+      for (int code = 0; code < header_.param1; code++) {
+        T dictionary_value;
+        memcpy(&dictionary_value, dictionary + code * sizeof(T), sizeof(T));
+        result += dictionary_value * static_cast<T>(counts[code]);
+      }
+    } break;
+
+    case ColumnEncoding::FRAME_OF_REFERENCE: {
+      // sum = base * count + sum(delta)
+      const int packed_bytes = packed_size(header_.count, header_.param2);
+      int64_t   delta_sum    = 0;
+      for (int i = 0; i < header_.count; i++) {
+        delta_sum += unpack(payload(), packed_bytes, header_.param2, i);
+      }
+      result = static_cast<T>(static_cast<int64_t>(header_.param1) * header_.count + delta_sum);
+    } break;
+
+    case ColumnEncoding::PLAIN:
+    default: {
+      for (int i = 0; i < header_.count; i++) {
+        T item;
+        memcpy(&item, payload() + i * sizeof(T), sizeof(T));
+        result += item;
+      }
+    } break;
+  }
+  return result;
+}
+
+template void EncodedColumn::filter<int>(CompOp op, int value, uint8_t *select) const;
+template void EncodedColumn::filter<float>(CompOp op, float value, uint8_t *select) const;
+template int  EncodedColumn::sum<int>() const;
+template float EncodedColumn::sum<float>() const;
@@ -0,0 +1,124 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "common/lang/vector.h"
+#include "common/type/attr_type.h"
+#include "sql/parser/parse_defs.h"
+
+/**
+ * @brief 一列定长数据的编码(轻量级压缩)方式
+ */
+enum class ColumnEncoding : int32_t
+{
+  PLAIN = 0,          ///< 不压缩，按照定长连续存放
+  RLE,                ///< run-length encoding，连续相同的值只存放一次
+  DICTIONARY,         ///< 字典编码，每个值存放它在字典中的编号，编号按位压缩(bit-packing)。只用于 CHARS
+  FRAME_OF_REFERENCE  ///< 存放与最小值的差，差值按位压缩(bit-packing)。只用于 INTS 和 DATES
+};
+
+const char *column_encoding_name(ColumnEncoding encoding);
+
+/**
+ * @brief 编码一列定长的数据
+ * @details 编码后的格式：
+ * @code
+ * | header | payload |
+ * PLAIN:              payload = values
+ * RLE:                payload = run ends(int32) | run values
+ * DICTIONARY:         payload = dictionary values | packed codes
+ * FRAME_OF_REFERENCE: payload = packed (value - base)
+ * @endcode
+ * 编码后的数据长度按照4字节对齐，多列编码后的数据可以直接拼接在一起。
+ */
+class ColumnEncoder
+{
+public:
+  /**
+   * @brief 选择编码后最小的方式编码一列数据，追加到 output 的后面
+   * @param attr_type 列的类型，决定可以使用哪些编码方式
+   * @param attr_len  每个值的长度
+   * @param values    连续存放的 count 个值
+   */
+  static void encode(AttrType attr_type, int attr_len, const char *values, int count, vector<char> &output);
+
+  /**
+   * @brief 使用指定的编码方式编码。FRAME_OF_REFERENCE 只能用于4字节的 INTS 和 DATES，其它类型会退化成 PLAIN
+   */
+  static void encode(
+      ColumnEncoding encoding, AttrType attr_type, int attr_len, const char *values, int count, vector<char> &output);
+};
+
+/**
+ * @brief 一列编码后数据的只读视图
+ * @details 不持有内存，调用者需要保证访问期间编码数据有效。
+ * 除了解码之外，还可以直接在编码数据上做比较和求和：RLE 每个 run 只计算一次，
+ * 字典编码每个字典项只比较一次，FRAME_OF_REFERENCE 把常量转换成差值后直接与压缩的差值比较。
+ */
+class EncodedColumn
+{
+public:
+  EncodedColumn() = default;
+  explicit EncodedColumn(const char *data);
+
+  bool           valid() const { return data_ != nullptr; }
+  ColumnEncoding encoding() const { return static_cast<ColumnEncoding>(header_.encoding); }
+  int            count() const { return header_.count; }
+  int            attr_len() const { return header_.attr_len; }
+  /// 包括头部在内的编码后数据的长度
+  int            size() const { return header_.size; }
+
+  /**
+   * @brief 解码所有的值，output 至少要有 count() * attr_len() 字节
+   */
+  void decode(char *output) const;
+
+  /**
+   * @brief 解码第 index 个值
+   */
+  void get(int index, char *output) const;
+
+  /**
+   * @brief 计算 `value[i] op value`，结果与 select[i] 做与运算
+   * @details 只支持 int 和 float，T 需要与列的类型一致
+   */
+  template <typename T>
+  void filter(CompOp op, T value, uint8_t *select) const;
+
+  /**
+   * @brief 所有值的和，T 需要与列的类型一致
+   */
+  template <typename T>
+  T sum() const;
+
+public:
+  struct Header
+  {
+    int32_t encoding = 0;
+    int32_t count    = 0;
+    int32_t attr_len = 0;
+    int32_t size     = 0;  ///< 包括头部在内的编码后数据的长度
+    int32_t param1   = 0;  ///< RLE: run 的个数；DICTIONARY: 字典项的个数；FRAME_OF_REFERENCE: 最小值
+    int32_t param2   = 0;  ///< DICTIONARY/FRAME_OF_REFERENCE: 每个值压缩后的位数
+  };
+
+private:
+  const char *payload() const { return data_ + sizeof(Header); }
+
+  /// RLE 中第 index 个值所在的 run
+  int run_of(int index) const;
+
+private:
+  const char *data_ = nullptr;
+  Header      header_;
+};
@@ -34,3 +34,8 @@ string table_index_file(const char *base_dir, const char *table_name, const char
 {
   return filesystem::path(base_dir) / (string(table_name) + "-" + index_name + TABLE_INDEX_SUFFIX);
 }
+
+string table_compact_file(const char *base_dir, const char *table_name)
+{
+  return filesystem::path(base_dir) / (string(table_name) + TABLE_COMPACT_SUFFIX);
+}
@@ -17,9 +17,14 @@ See the Mulan PSL v2 for more details. */
 #include <fcntl.h>
 #include <sys/stat.h>
 
+#include "common/conf/ini.h"
+#include "common/ini_setting.h"
+#include "common/lang/algorithm.h"
+#include "common/lang/chrono.h"
 #include "common/lang/string.h"
 #include "common/log/log.h"
 #include "common/os/path.h"
+#include "common/thread/thread_util.h"
 #include "common/global_context.h"
 #include "storage/common/meta_util.h"
 #include "storage/table/table.h"
@@ -30,8 +35,28 @@ See the Mulan PSL v2 for more details. */
 
 using namespace common;
 
+/**
+ * @brief 读取配置文件 STORAGE 段中的整数配置项，没有配置时使用默认值
+ */
+static int storage_int_property(const char *key, int default_value)
+{
+  int    value = default_value;
+  string str   = get_properties()->get(key, "", STORAGE);
+  if (!str.empty()) {
+    str_to_val(str, value);
+  }
+  return value;
+}
+
 Db::~Db()
 {
+  stop_checkpoint_thread();
+  if (buffer_pool_manager_) {
+    // 刷脏线程会等待日志落盘，要在日志模块停止之前退出
+    buffer_pool_manager_->page_cleaner().stop();
+    buffer_pool_manager_->page_prefetcher().stop();
+  }
+
   for (auto &iter : opened_tables_) {
     delete iter.second;
   }
@@ -67,7 +92,16 @@ RC Db::init(const char *name, const char *dbpath, const char *trx_kit_name, cons
 
   trx_kit_.reset(trx_kit);
 
-  buffer_pool_manager_ = make_unique<BufferPoolManager>();
+  string frame_replacer = get_properties()->get(BUFFER_POOL_REPLACER, BUFFER_POOL_REPLACER_DEFAULT, STORAGE);
+  if (FrameReplacer::create(frame_replacer) == nullptr) {
+    LOG_ERROR("Failed to init DB, unknown buffer pool replacer: %s", frame_replacer.c_str());
+    return RC::INVALID_ARGUMENT;
+  }
+
+  string page_io = get_properties()->get(PAGE_IO_BACKEND, PAGE_IO_BACKEND_DEFAULT, STORAGE);
+
+  buffer_pool_manager_ = make_unique<BufferPoolManager>(
+      0 /*memory_size*/, BPFrameManager::DEFAULT_SHARD_NUM, frame_replacer, page_io);
   auto dblwr_buffer    = make_unique<DiskDoubleWriteBuffer>(*buffer_pool_manager_);
 
   const char      *double_write_buffer_filename  = "dblwr.db";
@@ -131,6 +165,30 @@ RC Db::init(const char *name, const char *dbpath, const char *trx_kit_name, cons
     return rc;
   }
 
+  const int checkpoint_interval = storage_int_property(CHECKPOINT_INTERVAL, CHECKPOINT_INTERVAL_DEFAULT);
+
+  rc = start_checkpoint_thread(checkpoint_interval);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to start checkpoint thread. dbpath=%s, rc=%s", dbpath, strrc(rc));
+    return rc;
+  }
+
+  const int page_cleaner_watermark = storage_int_property(PAGE_CLEANER_WATERMARK, PAGE_CLEANER_WATERMARK_DEFAULT);
+
+  rc = buffer_pool_manager_->page_cleaner().start(page_cleaner_watermark);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to start page cleaner. dbpath=%s, rc=%s", dbpath, strrc(rc));
+    return rc;
+  }
+
+  const int read_ahead_pages = storage_int_property(READ_AHEAD_PAGES, READ_AHEAD_PAGES_DEFAULT);
+
+  rc = buffer_pool_manager_->page_prefetcher().start(read_ahead_pages);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to start page prefetcher. dbpath=%s, rc=%s", dbpath, strrc(rc));
+    return rc;
+  }
+
   return rc;
 }
 
@@ -276,16 +334,137 @@ RC Db::sync()
     return rc;
   }
 
-  check_point_lsn_ = current_lsn;
-  rc               = flush_meta();
+  lock_guard guard(checkpoint_mutex_);
+  rc = advance_check_point(max(current_lsn, check_point_lsn_));
   if (OB_FAIL(rc)) {
-    LOG_ERROR("Failed to flush meta. db=%s, rc=%d:%s", name_.c_str(), rc, strrc(rc));
+    LOG_ERROR("Failed to advance check point. db=%s, rc=%d:%s", name_.c_str(), rc, strrc(rc));
     return rc;
   }
   LOG_INFO("Successfully sync db. db=%s", name_.c_str());
   return rc;
 }
 
+RC Db::checkpoint()
+{
+  lock_guard guard(checkpoint_mutex_);
+
+  // 以上次检查点时的LSN为上限，同时记录当前的LSN给下一次检查点使用
+  LSN lsn                      = last_checkpoint_current_lsn_;
+  last_checkpoint_current_lsn_ = log_handler_->current_lsn();
+
+  // 检查点之后的日志要在重启时回放，必须已经在磁盘上
+  RC rc = log_handler_->wait_lsn(lsn);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to wait lsn. lsn=%ld, rc=%s", lsn, strrc(rc));
+    return rc;
+  }
+
+  const LSN page_lsn = buffer_pool_manager_->get_frame_manager().min_rec_lsn();
+  if (page_lsn > 0 && page_lsn < lsn) {
+    lsn = page_lsn;
+  }
+
+  const LSN trx_lsn = trx_kit_->min_active_lsn();
+  if (trx_lsn > 0 && trx_lsn < lsn) {
+    lsn = trx_lsn;
+  }
+
+  if (lsn <= check_point_lsn_) {
+    LOG_TRACE("check point not changed. db=%s, check_point_lsn=%ld, page_lsn=%ld, trx_lsn=%ld",
+              name_.c_str(), check_point_lsn_, page_lsn, trx_lsn);
+    return RC::SUCCESS;
+  }
+
+  // 已经不是脏页的页面可能还在double write buffer的内存中，要先落盘。
+  // 必须在计算page_lsn之后刷，在这之后才离开脏页的页面仍然受page_lsn的保护
+  auto dblwr_buffer = static_cast<DiskDoubleWriteBuffer *>(buffer_pool_manager_->get_dblwr_buffer());
+  rc                = dblwr_buffer->flush_page();
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to flush double write buffer. db=%s, rc=%s", name_.c_str(), strrc(rc));
+    return rc;
+  }
+
+  rc = advance_check_point(lsn);
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  LOG_INFO("checkpoint done. db=%s, check_point_lsn=%ld, page_lsn=%ld, trx_lsn=%ld",
+           name_.c_str(), check_point_lsn_, page_lsn, trx_lsn);
+  return RC::SUCCESS;
+}
+
+RC Db::advance_check_point(LSN lsn)
+{
+  const LSN old_check_point_lsn = check_point_lsn_;
+
+  check_point_lsn_ = lsn;
+  RC rc            = flush_meta();
+  if (OB_FAIL(rc)) {
+    LOG_ERROR("Failed to flush meta. db=%s, rc=%d:%s", name_.c_str(), rc, strrc(rc));
+    check_point_lsn_ = old_check_point_lsn;
+    return rc;
+  }
+
+  // 元数据已经落盘，检查点之前的日志再也不会用到了
+  rc = log_handler_->truncate(check_point_lsn_);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to truncate log. db=%s, check_point_lsn=%ld, rc=%s", name_.c_str(), check_point_lsn_, strrc(rc));
+    return rc;
+  }
+  return RC::SUCCESS;
+}
+
+RC Db::start_checkpoint_thread(int interval_seconds)
+{
+  if (interval_seconds <= 0) {
+    LOG_INFO("checkpoint thread is disabled. db=%s", name_.c_str());
+    return RC::SUCCESS;
+  }
+
+  checkpoint_running_ = true;
+  checkpoint_thread_  = make_unique<thread>(&Db::checkpoint_thread_func, this, interval_seconds);
+  LOG_INFO("checkpoint thread started. db=%s, interval=%ds", name_.c_str(), interval_seconds);
+  return RC::SUCCESS;
+}
+
+void Db::stop_checkpoint_thread()
+{
+  if (!checkpoint_thread_) {
+    return;
+  }
+
+  {
+    lock_guard guard(checkpoint_thread_mutex_);
+    checkpoint_running_ = false;
+    checkpoint_cond_.notify_all();
+  }
+
+  checkpoint_thread_->join();
+  checkpoint_thread_.reset();
+  LOG_INFO("checkpoint thread stopped. db=%s", name_.c_str());
+}
+
+void Db::checkpoint_thread_func(int interval_seconds)
+{
+  thread_set_name("Checkpoint");
+
+  unique_lock lock(checkpoint_thread_mutex_);
+  while (checkpoint_running_) {
+    checkpoint_cond_.wait_for(lock, chrono::seconds(interval_seconds), [this]() { return !checkpoint_running_; });
+    if (!checkpoint_running_) {
+      break;
+    }
+
+    lock.unlock();
+    RC rc = checkpoint();
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to do checkpoint. db=%s, rc=%s", name_.c_str(), strrc(rc));
+    }
+    lock.lock();
+  }
+}
+
 RC Db::recover()
 {
   LOG_TRACE("db recover begin. check_point_lsn=%d", check_point_lsn_);
@@ -296,7 +475,9 @@ RC Db::recover()
     return RC::INTERNAL;
   }
 
-  IntegratedLogReplayer log_replayer(*buffer_pool_manager_, unique_ptr<LogReplayer>(trx_log_replayer));
+  const int replay_threads = storage_int_property(CLOG_REPLAY_THREADS, CLOG_REPLAY_THREADS_DEFAULT);
+
+  IntegratedLogReplayer log_replayer(*buffer_pool_manager_, unique_ptr<LogReplayer>(trx_log_replayer), replay_threads);
   RC                    rc = log_handler_->replay(log_replayer, check_point_lsn_ /*start_lsn*/);
   if (OB_FAIL(rc)) {
     LOG_WARN("failed to replay log. rc=%s", strrc(rc));
@@ -315,6 +496,18 @@ RC Db::recover()
     return rc;
   }
 
+  // 整理数据文件时中断的表，索引中可能还有记录原来的位置，需要根据数据重建
+  for (auto &iter : opened_tables_) {
+    rc = iter.second->recover_compaction();
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to recover compaction of table. table=%s, rc=%s", iter.first.c_str(), strrc(rc));
+      return rc;
+    }
+  }
+
+  // 启动时没有正在进行的修改，当前的LSN可以直接作为第一次检查点的上限
+  last_checkpoint_current_lsn_ = log_handler_->current_lsn();
+
   LOG_INFO("Successfully recover db. db=%s checkpoint_lsn=%d", name_.c_str(), check_point_lsn_);
   return rc;
 }
@@ -19,7 +19,9 @@ See the Mulan PSL v2 for more details. */
 #include "common/lang/string.h"
 #include "common/lang/unordered_map.h"
 #include "common/lang/memory.h"
+#include "common/lang/mutex.h"
 #include "common/lang/span.h"
+#include "common/lang/thread.h"
 #include "sql/parser/parse_defs.h"
 #include "storage/buffer/disk_buffer_pool.h"
 #include "storage/clog/disk_log_handler.h"
@@ -94,6 +96,18 @@ public:
    */
   RC sync();
 
+  /**
+   * @brief 做一次模糊检查点(fuzzy checkpoint)
+   * @details 不刷新任何页面，也不阻塞事务。取所有页面的recovery LSN、活跃事务的第一条日志，
+   * 以及上次检查点时的LSN，三者中最小的作为新的检查点，写入元数据后删除检查点之前的日志文件。
+   * 重启时从检查点开始回放，回放的日志量与检查点间隔成正比。
+   * 后台线程会定期调用，见CHECKPOINT_INTERVAL配置项。
+   */
+  RC checkpoint();
+
+  /// @brief 当前的检查点LSN
+  LSN check_point_lsn() const { return check_point_lsn_; }
+
   /// @brief 获取当前数据库的日志处理器
   LogHandler &log_handler();
 
@@ -117,6 +131,15 @@ private:
   /// @brief 初始化数据库的double buffer pool
   RC init_dblwr_buffer();
 
+  /// @brief 启动定期做检查点的后台线程。间隔不大于0时不启动
+  RC start_checkpoint_thread(int interval_seconds);
+  /// @brief 停止检查点线程
+  void stop_checkpoint_thread();
+  void checkpoint_thread_func(int interval_seconds);
+
+  /// @brief 推进检查点并写入元数据，然后删除不再需要的日志。调用者需要持有checkpoint_mutex_
+  RC advance_check_point(LSN lsn);
+
 private:
   string                         name_;                 ///< 数据库名称
   string                         path_;                 ///< 数据库文件存放的目录
@@ -129,4 +152,14 @@ private:
   int32_t next_table_id_ = 0;
 
   LSN check_point_lsn_ = 0;  ///< 当前数据库的检查点LSN。会记录到磁盘中。
+
+  /// 上一次做检查点时的LSN。那时已经分配LSN的日志，早就在页面或活跃事务上留下了记录，
+  /// 以它为上限就不会漏掉刚写了日志、还没来得及设置页面LSN的修改
+  LSN last_checkpoint_current_lsn_ = 0;
+
+  mutex              checkpoint_mutex_;            ///< 保护检查点相关的数据，sync也会修改检查点
+  unique_ptr<thread> checkpoint_thread_;           ///< 定期做检查点的线程
+  mutex              checkpoint_thread_mutex_;     ///< 配合条件变量，让检查点线程可以及时退出
+  condition_variable checkpoint_cond_;             ///< 检查点线程在这里等待
+  bool               checkpoint_running_ = false;  ///< 检查点线程是否应该继续运行
 };
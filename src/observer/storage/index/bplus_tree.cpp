@@ -14,6 +14,7 @@ See the Mulan PSL v2 for more details. */
 //
 
 #include "storage/index/bplus_tree.h"
+#include "common/lang/limits.h"
 #include "common/lang/lower_bound.h"
 #include "common/log/log.h"
 #include "common/global_context.h"
@@ -51,9 +52,10 @@ IndexNodeHandler::IndexNodeHandler(BplusTreeMiniTransaction &mtr, const IndexFil
 bool IndexNodeHandler::is_leaf() const { return node_->is_leaf; }
 void IndexNodeHandler::init_empty(bool leaf)
 {
-  node_->is_leaf = leaf;
-  node_->key_num = 0;
-  node_->parent  = BP_INVALID_PAGE_NUM;
+  node_->is_leaf       = leaf;
+  node_->prefix_length = 0;
+  node_->key_num       = 0;
+  node_->parent        = BP_INVALID_PAGE_NUM;
 }
 PageNum IndexNodeHandler::page_num() const { return frame_->page_num(); }
 
@@ -71,10 +73,18 @@ int IndexNodeHandler::size() const { return node_->key_num; }
 
 int IndexNodeHandler::max_size() const { return is_leaf() ? header_.leaf_max_size : header_.internal_max_size; }
 
-int IndexNodeHandler::min_size() const
+int IndexNodeHandler::min_size() const { return min_size(header_, is_leaf()); }
+
+int IndexNodeHandler::min_size(const IndexFileHeader &header, bool leaf)
 {
-  const int max = this->max_size();
-  return max - max / 2;
+  const int max      = leaf ? header.leaf_max_size : header.internal_max_size;
+  int       min_size = max - max / 2;
+  if (leaf && header.leaf_prefix_compression) {
+    // 键值没有公共前缀时，一个叶子节点只能放下不压缩时那么多的元素，最少的元素个数按照不压缩时计算
+    const int capacity = calc_leaf_page_capacity(header.attr_length);
+    min_size           = min(min_size, capacity - capacity / 2);
+  }
+  return min_size;
 }
 
 void IndexNodeHandler::increase_size(int n) { node_->key_num += n; }
@@ -97,14 +107,15 @@ RC IndexNodeHandler::set_parent_page_num(PageNum page_num)
  * @return true 需要分裂或合并；
  *         false 不需要分裂或合并
  */
-bool IndexNodeHandler::is_safe(BplusTreeOperationType op, bool is_root_node)
+bool IndexNodeHandler::is_safe(BplusTreeOperationType op, bool is_root_node, const char *key /* = nullptr */)
 {
   switch (op) {
     case BplusTreeOperationType::READ: {
       return true;
     } break;
     case BplusTreeOperationType::INSERT: {
-      return size() < max_size();
+      // 内部节点插入的是子节点分裂后的键值，查找时还不知道
+      return can_insert(is_leaf() ? key : nullptr);
     } break;
     case BplusTreeOperationType::DELETE: {
       if (is_root_node) {  // 参考adjust_root
@@ -153,9 +164,126 @@ bool IndexNodeHandler::validate() const
   return true;
 }
 
+bool IndexNodeHandler::can_insert(const char *key) const
+{
+  if (size() >= max_size()) {
+    return false;
+  }
+  if (!prefix_compressed()) {
+    return true;
+  }
+
+  const int prefix_length = (key == nullptr) ? 0 : shared_prefix_length(key, 1);
+  return compressed_items_size(header_, prefix_length, size() + 1) <= compressed_items_capacity();
+}
+
+bool IndexNodeHandler::prefix_compressed() const { return node_->is_leaf && header_.leaf_prefix_compression != 0; }
+
+int IndexNodeHandler::compressed_items_size(const IndexFileHeader &header, int prefix_length, int num)
+{
+  return prefix_length + num * (header.key_length - prefix_length + static_cast<int>(sizeof(RID)));
+}
+
+int IndexNodeHandler::compressed_items_capacity()
+{
+  return static_cast<int>(BP_PAGE_DATA_SIZE) - LeafIndexNode::HEADER_SIZE;
+}
+
+int IndexNodeHandler::common_prefix_length(const char *key1, const char *key2, int length)
+{
+  int i = 0;
+  while (i < length && key1[i] == key2[i]) {
+    i++;
+  }
+  return i;
+}
+
+char *IndexNodeHandler::compressed_prefix() const { return reinterpret_cast<LeafIndexNode *>(node_)->array; }
+
+int IndexNodeHandler::compressed_slot_size() const
+{
+  return key_size() - node_->prefix_length + static_cast<int>(sizeof(RID));
+}
+
+char *IndexNodeHandler::compressed_slot_at(int index) const
+{
+  return compressed_prefix() + node_->prefix_length + index * compressed_slot_size();
+}
+
+int IndexNodeHandler::shared_prefix_length(const char *items, int num) const
+{
+  // 空节点的前缀完全由新的元素决定
+  const char *prefix        = size() > 0 ? compressed_prefix() : items;
+  int         prefix_length = size() > 0 ? node_->prefix_length : key_size();
+  for (int i = 0; i < num && prefix_length > 0; i++) {
+    prefix_length = common_prefix_length(prefix, items + static_cast<size_t>(i) * item_size(), prefix_length);
+  }
+  return prefix_length;
+}
+
+void IndexNodeHandler::decode_items(int index, int num, char *items) const
+{
+  const int prefix_length = node_->prefix_length;
+  const int slot_size     = compressed_slot_size();
+  const int item_size     = this->item_size();
+  for (int i = 0; i < num; i++) {
+    char *item = items + static_cast<size_t>(i) * item_size;
+    memcpy(item, compressed_prefix(), prefix_length);
+    memcpy(item + prefix_length, compressed_slot_at(index + i), slot_size);
+  }
+}
+
+void IndexNodeHandler::encode_items(const char *items, int num, int prefix_length)
+{
+  ASSERT(compressed_items_size(header_, prefix_length, num) <= compressed_items_capacity(),
+         "compressed items overflow. page num=%d, item num=%d, prefix length=%d",
+         page_num(), num, prefix_length);
+
+  node_->prefix_length = static_cast<int16_t>(prefix_length);
+  node_->key_num       = num;
+  if (num > 0) {
+    memcpy(compressed_prefix(), items, prefix_length);
+  }
+
+  const int slot_size = compressed_slot_size();
+  const int item_size = this->item_size();
+  for (int i = 0; i < num; i++) {
+    memcpy(compressed_slot_at(i), items + static_cast<size_t>(i) * item_size + prefix_length, slot_size);
+  }
+}
+
 RC IndexNodeHandler::recover_insert_items(int index, const char *items, int num)
 {
   const int item_size = this->item_size();
+  if (prefix_compressed()) {
+    const int prefix_length = shared_prefix_length(items, num);
+    if (size() == 0 || prefix_length != node_->prefix_length) {
+      // 前缀变短了，所有的元素都要重新编码
+      const int    total_num = size() + num;
+      vector<char> all_items(static_cast<size_t>(total_num) * item_size);
+      decode_items(0, index, all_items.data());
+      memcpy(all_items.data() + static_cast<size_t>(index) * item_size, items, static_cast<size_t>(num) * item_size);
+      decode_items(index, size() - index, all_items.data() + static_cast<size_t>(index + num) * item_size);
+      encode_items(all_items.data(), total_num, prefix_length);
+      return RC::SUCCESS;
+    }
+
+    ASSERT(compressed_items_size(header_, prefix_length, size() + num) <= compressed_items_capacity(),
+           "compressed items overflow. page num=%d, item num=%d, prefix length=%d",
+           page_num(), size() + num, prefix_length);
+
+    const int slot_size = compressed_slot_size();
+    if (index < size()) {
+      memmove(compressed_slot_at(index + num), compressed_slot_at(index),
+          (static_cast<size_t>(size()) - index) * slot_size);
+    }
+    for (int i = 0; i < num; i++) {
+      memcpy(compressed_slot_at(index + i), items + static_cast<size_t>(i) * item_size + prefix_length, slot_size);
+    }
+    increase_size(num);
+    return RC::SUCCESS;
+  }
+
   if (index < size()) {
     memmove(__item_at(index + num), __item_at(index), (static_cast<size_t>(size()) - index) * item_size);
   }
@@ -165,8 +293,28 @@ RC IndexNodeHandler::recover_insert_items(int index, const char *items, int num)
   return RC::SUCCESS;
 }
 
+RC IndexNodeHandler::append_items(const char *items, int num)
+{
+  RC rc = mtr_.logger().node_insert_items(*this, size(), span<const char>(items, num * item_size()), num);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to log append items. rc=%s", strrc(rc));
+    return rc;
+  }
+
+  return recover_insert_items(size(), items, num);
+}
+
 RC IndexNodeHandler::recover_remove_items(int index, int num)
 {
+  if (prefix_compressed()) {
+    if (index < size() - num) {
+      memmove(compressed_slot_at(index), compressed_slot_at(index + num),
+          (static_cast<size_t>(size()) - index - num) * compressed_slot_size());
+    }
+    increase_size(-num);
+    return RC::SUCCESS;
+  }
+
   const int item_size = this->item_size();
   if (index < size() - num) {
     memmove(__item_at(index), __item_at(index + num), (static_cast<size_t>(size()) - index - num) * item_size);
@@ -210,18 +358,54 @@ PageNum LeafIndexNodeHandler::next_page() const { return leaf_node_->next_brothe
 char *LeafIndexNodeHandler::key_at(int index)
 {
   assert(index >= 0 && index < size());
-  return __key_at(index);
+  if (!prefix_compressed()) {
+    return __key_at(index);
+  }
+
+  const int prefix_length = node_->prefix_length;
+  key_buffer_.resize(key_size());
+  memcpy(key_buffer_.data(), compressed_prefix(), prefix_length);
+  memcpy(key_buffer_.data() + prefix_length, compressed_slot_at(index), key_size() - prefix_length);
+  return key_buffer_.data();
 }
 
 char *LeafIndexNodeHandler::value_at(int index)
 {
   assert(index >= 0 && index < size());
+  if (prefix_compressed()) {
+    return compressed_slot_at(index) + key_size() - node_->prefix_length;
+  }
   return __value_at(index);
 }
 
 int LeafIndexNodeHandler::lookup(const KeyComparator &comparator, const char *key, bool *found /* = nullptr */) const
 {
-  const int                    size = this->size();
+  const int size = this->size();
+  if (prefix_compressed()) {
+    if (size == 0) {
+      if (found) {
+        *found = false;
+      }
+      return 0;
+    }
+
+    // 元素仍然是定长的，二分查找时把元素中的后缀与公共前缀拼成完整的键值再比较
+    const int    prefix_length = node_->prefix_length;
+    const int    suffix_length = key_size() - prefix_length;
+    vector<char> full_key(key_size());
+    memcpy(full_key.data(), compressed_prefix(), prefix_length);
+    auto suffix_comparator = [&comparator, &full_key, prefix_length, suffix_length](
+                                 const char *suffix, const char *key) {
+      memcpy(full_key.data() + prefix_length, suffix, suffix_length);
+      return comparator(full_key.data(), key);
+    };
+
+    common::BinaryIterator<char> iter_begin(compressed_slot_size(), compressed_slot_at(0));
+    common::BinaryIterator<char> iter_end(compressed_slot_size(), compressed_slot_at(size));
+    common::BinaryIterator<char> iter = lower_bound(iter_begin, iter_end, key, suffix_comparator, found);
+    return iter - iter_begin;
+  }
+
   common::BinaryIterator<char> iter_begin(item_size(), __key_at(0));
   common::BinaryIterator<char> iter_end(item_size(), __key_at(size));
   common::BinaryIterator<char> iter = lower_bound(iter_begin, iter_end, key, comparator, found);
@@ -248,7 +432,9 @@ RC LeafIndexNodeHandler::remove(int index)
 {
   assert(index >= 0 && index < size());
 
-  RC rc = mtr_.logger().node_remove_items(*this, index, span<const char>(__item_at(index), item_size()), 1);
+  vector<char> buffer;
+  const char  *item = items_at(index, 1, buffer);
+  RC           rc   = mtr_.logger().node_remove_items(*this, index, span<const char>(item, item_size()), 1);
   if (OB_FAIL(rc)) {
     LOG_WARN("failed to log remove item. rc=%s", strrc(rc));
     return rc;
@@ -275,10 +461,12 @@ RC LeafIndexNodeHandler::move_half_to(LeafIndexNodeHandler &other)
   const int move_index    = size / 2;
   const int move_item_num = size - move_index;
 
-  other.append(__item_at(move_index), move_item_num);
+  vector<char> buffer;
+  const char  *items = items_at(move_index, move_item_num, buffer);
+  other.append(items, move_item_num);
 
   RC rc = mtr_.logger().node_remove_items(
-      *this, move_index, span<const char>(__item_at(move_index), move_item_num * item_size()), move_item_num);
+      *this, move_index, span<const char>(items, move_item_num * item_size()), move_item_num);
   if (OB_FAIL(rc)) {
     LOG_WARN("failed to log shrink leaf node. rc=%s", strrc(rc));
     return rc;
@@ -289,14 +477,16 @@ RC LeafIndexNodeHandler::move_half_to(LeafIndexNodeHandler &other)
 }
 RC LeafIndexNodeHandler::move_first_to_end(LeafIndexNodeHandler &other)
 {
-  other.append(__item_at(0));
+  vector<char> buffer;
+  other.append(items_at(0, 1, buffer));
 
   return this->remove(0);
 }
 
 RC LeafIndexNodeHandler::move_last_to_front(LeafIndexNodeHandler &other)
 {
-  other.preappend(__item_at(size() - 1));
+  vector<char> buffer;
+  other.preappend(items_at(size() - 1, 1, buffer));
 
   this->remove(size() - 1);
   return RC::SUCCESS;
@@ -306,11 +496,12 @@ RC LeafIndexNodeHandler::move_last_to_front(LeafIndexNodeHandler &other)
  */
 RC LeafIndexNodeHandler::move_to(LeafIndexNodeHandler &other)
 {
-  other.append(__item_at(0), this->size());
+  vector<char> buffer;
+  const char  *items = items_at(0, this->size(), buffer);
+  other.append(items, this->size());
   other.set_next_page(this->next_page());
 
-  RC rc = mtr_.logger().node_remove_items(
-      *this, 0, span<const char>(__item_at(0), this->size() * item_size()), this->size());
+  RC rc = mtr_.logger().node_remove_items(*this, 0, span<const char>(items, this->size() * item_size()), this->size());
   if (OB_FAIL(rc)) {
     LOG_WARN("failed to log shrink leaf node. rc=%s", strrc(rc));
   }
@@ -337,13 +528,49 @@ RC LeafIndexNodeHandler::preappend(const char *item) { return insert(0, item, it
 
 char *LeafIndexNodeHandler::__item_at(int index) const { return leaf_node_->array + (index * item_size()); }
 
+const char *LeafIndexNodeHandler::items_at(int index, int num, vector<char> &buffer) const
+{
+  if (!prefix_compressed()) {
+    return __item_at(index);
+  }
+
+  buffer.resize(static_cast<size_t>(num) * item_size());
+  decode_items(index, num, buffer.data());
+  return buffer.data();
+}
+
+bool LeafIndexNodeHandler::can_move_to(LeafIndexNodeHandler &other)
+{
+  if (size() + other.size() > other.max_size()) {
+    return false;
+  }
+  if (!prefix_compressed()) {
+    return true;
+  }
+
+  // 合并之后的前缀可能会变短，需要按照合并后的前缀计算能否放下
+  vector<char> buffer;
+  const char  *items         = items_at(0, size(), buffer);
+  const int    prefix_length = other.shared_prefix_length(items, size());
+  return compressed_items_size(header_, prefix_length, size() + other.size()) <= compressed_items_capacity();
+}
+
 string to_string(const LeafIndexNodeHandler &handler, const KeyPrinter &printer)
 {
+  vector<char> buffer;
+  const char  *items = handler.items_at(0, handler.size(), buffer);
+
   stringstream ss;
   ss << to_string((const IndexNodeHandler &)handler) << ",next page:" << handler.next_page();
-  ss << ",values=[" << printer(handler.__key_at(0));
-  for (int i = 1; i < handler.size(); i++) {
-    ss << "," << printer(handler.__key_at(i));
+  if (handler.prefix_compressed()) {
+    ss << ",prefix length:" << handler.node_->prefix_length;
+  }
+  ss << ",values=[";
+  for (int i = 0; i < handler.size(); i++) {
+    if (i > 0) {
+      ss << ",";
+    }
+    ss << printer(items + static_cast<size_t>(i) * handler.item_size());
   }
   ss << "]";
   return ss.str();
@@ -357,8 +584,18 @@ bool LeafIndexNodeHandler::validate(const KeyComparator &comparator, DiskBufferP
   }
 
   const int node_size = size();
+  if (prefix_compressed() && node_size > 0 &&
+      compressed_items_size(header_, node_->prefix_length, node_size) > compressed_items_capacity()) {
+    LOG_WARN("page number = %d, compressed items overflow. item num=%d, prefix length=%d",
+             page_num(), node_size, node_->prefix_length);
+    return false;
+  }
+
+  vector<char> buffer;
+  const char  *items    = items_at(0, node_size, buffer);
+  auto         item_key = [this, items](int index) { return items + static_cast<size_t>(index) * item_size(); };
   for (int i = 1; i < node_size; i++) {
-    if (comparator(__key_at(i - 1), __key_at(i)) >= 0) {
+    if (comparator(item_key(i - 1), item_key(i)) >= 0) {
       LOG_WARN("page number = %d, invalid key order. id1=%d,id2=%d, this=%s",
                page_num(), i - 1, i, to_string(*this).c_str());
       return false;
@@ -387,7 +624,7 @@ bool LeafIndexNodeHandler::validate(const KeyComparator &comparator, DiskBufferP
   }
 
   if (0 != index_in_parent) {
-    int cmp_result = comparator(__key_at(0), parent_node.key_at(index_in_parent));
+    int cmp_result = comparator(item_key(0), parent_node.key_at(index_in_parent));
     if (cmp_result < 0) {
       LOG_WARN("invalid leaf node. first item should be greate than or equal to parent item. "
                "this page num=%d, parent page num=%d, index in parent=%d",
@@ -398,7 +635,7 @@ bool LeafIndexNodeHandler::validate(const KeyComparator &comparator, DiskBufferP
   }
 
   if (index_in_parent < parent_node.size() - 1) {
-    int cmp_result = comparator(__key_at(size() - 1), parent_node.key_at(index_in_parent + 1));
+    int cmp_result = comparator(item_key(size() - 1), parent_node.key_at(index_in_parent + 1));
     if (cmp_result >= 0) {
       LOG_WARN("invalid leaf node. last item should be less than the item at the first after item in parent."
                "this page num=%d, parent page num=%d, parent item to compare=%d",
@@ -562,6 +799,11 @@ int InternalIndexNodeHandler::value_index(PageNum page_num)
   return -1;
 }
 
+bool InternalIndexNodeHandler::can_move_to(InternalIndexNodeHandler &other) const
+{
+  return size() + other.size() <= other.max_size();
+}
+
 void InternalIndexNodeHandler::remove(int index)
 {
   assert(index >= 0 && index < size());
@@ -782,6 +1024,20 @@ RC BplusTreeHandler::sync()
 
 RC BplusTreeHandler::create(LogHandler &log_handler, BufferPoolManager &bpm, const char *file_name, AttrType attr_type,
     int attr_length, int internal_max_size /* = -1*/, int leaf_max_size /* = -1 */)
+{
+  return create(log_handler, bpm, file_name, vector<KeyAttr>{KeyAttr{attr_type, attr_length}}, 1 /*key_attr_num*/,
+      internal_max_size, leaf_max_size);
+}
+
+RC BplusTreeHandler::create(LogHandler &log_handler, DiskBufferPool &buffer_pool, AttrType attr_type, int attr_length,
+    int internal_max_size /* = -1 */, int leaf_max_size /* = -1 */)
+{
+  return create(log_handler, buffer_pool, vector<KeyAttr>{KeyAttr{attr_type, attr_length}}, 1 /*key_attr_num*/,
+      internal_max_size, leaf_max_size);
+}
+
+RC BplusTreeHandler::create(LogHandler &log_handler, BufferPoolManager &bpm, const char *file_name,
+    const vector<KeyAttr> &attrs, int key_attr_num, int internal_max_size /* = -1*/, int leaf_max_size /* = -1 */)
 {
   RC rc = bpm.create_file(file_name);
   if (OB_FAIL(rc)) {
@@ -799,7 +1055,7 @@ RC BplusTreeHandler::create(LogHandler &log_handler, BufferPoolManager &bpm, con
   }
   LOG_INFO("Successfully open index file %s.", file_name);
 
-  rc = this->create(log_handler, *bp, attr_type, attr_length, internal_max_size, leaf_max_size);
+  rc = this->create(log_handler, *bp, attrs, key_attr_num, internal_max_size, leaf_max_size);
   if (OB_FAIL(rc)) {
     bpm.close_file(file_name);
     return rc;
@@ -809,14 +1065,38 @@ RC BplusTreeHandler::create(LogHandler &log_handler, BufferPoolManager &bpm, con
   return rc;
 }
 
-RC BplusTreeHandler::create(LogHandler &log_handler, DiskBufferPool &buffer_pool, AttrType attr_type, int attr_length,
-    int internal_max_size /* = -1 */, int leaf_max_size /* = -1 */)
+RC BplusTreeHandler::create(LogHandler &log_handler, DiskBufferPool &buffer_pool, const vector<KeyAttr> &attrs,
+    int key_attr_num, int internal_max_size /* = -1 */, int leaf_max_size /* = -1 */)
 {
+  if (attrs.empty() || static_cast<int>(attrs.size()) > IndexFileHeader::MAX_ATTR_NUM || key_attr_num <= 0 ||
+      key_attr_num > static_cast<int>(attrs.size())) {
+    LOG_WARN("invalid key attributes of bplus tree. attr num=%d, key attr num=%d",
+             static_cast<int>(attrs.size()), key_attr_num);
+    return RC::INVALID_ARGUMENT;
+  }
+
+  int  attr_length        = 0;
+  bool prefix_compression = false;
+  for (const KeyAttr &attr : attrs) {
+    attr_length += attr.length;
+    // 只有字符串类型的键值相邻之间才有较长的公共前缀，其它类型按照小端存储，压缩不了多少
+    prefix_compression = prefix_compression || attr.type == AttrType::CHARS;
+  }
+
   if (internal_max_size < 0) {
     internal_max_size = calc_internal_page_capacity(attr_length);
   }
-  if (leaf_max_size < 0) {
-    leaf_max_size = calc_leaf_page_capacity(attr_length);
+
+  const int leaf_capacity = calc_leaf_page_capacity(attr_length);
+  if (prefix_compression) {
+    // 压缩后一个页面能放下的元素个数取决于键值，这里按照最多能放下两倍的元素来限制。
+    // 页面的字节数满了就分裂，分裂后的两个页面都能按照未压缩的格式放下，保证分裂和合并总是能成功
+    const int compressed_leaf_max_size = max(leaf_capacity, 2 * leaf_capacity - 2);
+    if (leaf_max_size < 0 || leaf_max_size > compressed_leaf_max_size) {
+      leaf_max_size = compressed_leaf_max_size;
+    }
+  } else if (leaf_max_size < 0) {
+    leaf_max_size = leaf_capacity;
   }
 
   log_handler_      = &log_handler;
@@ -844,10 +1124,17 @@ RC BplusTreeHandler::create(LogHandler &log_handler, DiskBufferPool &buffer_pool
   IndexFileHeader *file_header   = (IndexFileHeader *)pdata;
   file_header->attr_length       = attr_length;
   file_header->key_length        = attr_length + sizeof(RID);
-  file_header->attr_type         = attr_type;
+  file_header->attr_type         = attrs[0].type;
+  file_header->attr_num          = static_cast<int32_t>(attrs.size());
+  file_header->key_attr_num      = key_attr_num;
+  for (size_t i = 0; i < attrs.size(); i++) {
+    file_header->attr_types[i]   = attrs[i].type;
+    file_header->attr_lengths[i] = attrs[i].length;
+  }
   file_header->internal_max_size = internal_max_size;
   file_header->leaf_max_size     = leaf_max_size;
   file_header->root_page         = BP_INVALID_PAGE_NUM;
+  file_header->leaf_prefix_compression = prefix_compression ? 1 : 0;
 
   // 取消记录日志的原因请参考下面的sync调用的地方。
   // mtr.logger().init_header_page(header_frame, *file_header);
@@ -864,8 +1151,8 @@ RC BplusTreeHandler::create(LogHandler &log_handler, DiskBufferPool &buffer_pool
     return RC::NOMEM;
   }
 
-  key_comparator_.init(file_header->attr_type, file_header->attr_length);
-  key_printer_.init(file_header->attr_type, file_header->attr_length);
+  key_comparator_.init(file_header->key_attrs(), file_header->compare_attr_num());
+  key_printer_.init(file_header->key_attrs());
 
   /*
   虽然我们针对B+树记录了WAL，但是我们记录的都是逻辑日志，并没有记录某个页面如何修改的物理日志。
@@ -936,8 +1223,8 @@ RC BplusTreeHandler::open(LogHandler &log_handler, DiskBufferPool &buffer_pool)
   // close old page_handle
   buffer_pool.unpin_page(frame);
 
-  key_comparator_.init(file_header_.attr_type, file_header_.attr_length);
-  key_printer_.init(file_header_.attr_type, file_header_.attr_length);
+  key_comparator_.init(file_header_.key_attrs(), file_header_.compare_attr_num());
+  key_printer_.init(file_header_.key_attrs());
   LOG_INFO("Successfully open index");
   return RC::SUCCESS;
 }
@@ -1178,18 +1465,29 @@ RC BplusTreeHandler::find_leaf(BplusTreeMiniTransaction &mtr, BplusTreeOperation
   auto child_page_getter = [this, key](InternalIndexNodeHandler &internal_node) {
     return internal_node.value_at(internal_node.lookup(key_comparator_, key));
   };
-  return find_leaf_internal(mtr, op, child_page_getter, frame);
+  return find_leaf_internal(mtr, op, child_page_getter, key, frame);
 }
 
 RC BplusTreeHandler::left_most_page(BplusTreeMiniTransaction &mtr, Frame *&frame)
 {
   auto child_page_getter = [](InternalIndexNodeHandler &internal_node) { return internal_node.value_at(0); };
-  return find_leaf_internal(mtr, BplusTreeOperationType::READ, child_page_getter, frame);
+  return find_leaf_internal(mtr, BplusTreeOperationType::READ, child_page_getter, nullptr /* key */, frame);
 }
 
 RC BplusTreeHandler::find_leaf_internal(BplusTreeMiniTransaction &mtr, BplusTreeOperationType op,
-    const function<PageNum(InternalIndexNodeHandler &)> &child_page_getter, Frame *&frame)
+    const function<PageNum(InternalIndexNodeHandler &)> &child_page_getter, const char *key, Frame *&frame)
 {
+  if (op == BplusTreeOperationType::READ && optimistic_read_) {
+    for (int i = 0; i < OPTIMISTIC_READ_RETRY_NUM; i++) {
+      bool need_restart = false;
+      RC   rc           = optimistic_find_leaf(mtr, child_page_getter, frame, need_restart);
+      if (!need_restart) {
+        return rc;
+      }
+    }
+    LOG_TRACE("optimistic read conflicts too many times, fall back to crabbing protocol");
+  }
+
   LatchMemo &latch_memo = mtr.latch_memo();
 
   // root locked
@@ -1203,7 +1501,7 @@ RC BplusTreeHandler::find_leaf_internal(BplusTreeMiniTransaction &mtr, BplusTree
     return RC::EMPTY;
   }
 
-  RC rc = crabing_protocal_fetch_page(mtr, op, file_header_.root_page, true /* is_root_node */, frame);
+  RC rc = crabing_protocal_fetch_page(mtr, op, file_header_.root_page, true /* is_root_node */, key, frame);
   if (OB_FAIL(rc)) {
     LOG_WARN("failed to fetch root page. page id=%d, rc=%d:%s", file_header_.root_page, rc, strrc(rc));
     return rc;
@@ -1214,7 +1512,7 @@ RC BplusTreeHandler::find_leaf_internal(BplusTreeMiniTransaction &mtr, BplusTree
   for (; !node->is_leaf;) {
     InternalIndexNodeHandler internal_node(mtr, file_header_, frame);
     next_page_id = child_page_getter(internal_node);
-    rc           = crabing_protocal_fetch_page(mtr, op, next_page_id, false /* is_root_node */, frame);
+    rc           = crabing_protocal_fetch_page(mtr, op, next_page_id, false /* is_root_node */, key, frame);
     if (OB_FAIL(rc)) {
       LOG_WARN("Failed to load page page_num:%d. rc=%s", next_page_id, strrc(rc));
       return rc;
@@ -1225,8 +1523,8 @@ RC BplusTreeHandler::find_leaf_internal(BplusTreeMiniTransaction &mtr, BplusTree
   return RC::SUCCESS;
 }
 
-RC BplusTreeHandler::crabing_protocal_fetch_page(
-    BplusTreeMiniTransaction &mtr, BplusTreeOperationType op, PageNum page_num, bool is_root_node, Frame *&frame)
+RC BplusTreeHandler::crabing_protocal_fetch_page(BplusTreeMiniTransaction &mtr, BplusTreeOperationType op,
+    PageNum page_num, bool is_root_node, const char *key, Frame *&frame)
 {
   LatchMemo &latch_memo = mtr.latch_memo();
   bool       readonly   = (op == BplusTreeOperationType::READ);
@@ -1241,12 +1539,89 @@ RC BplusTreeHandler::crabing_protocal_fetch_page(
   LatchMemoType latch_type = readonly ? LatchMemoType::SHARED : LatchMemoType::EXCLUSIVE;
   mtr.latch_memo().latch(frame, latch_type);
   IndexNodeHandler index_node(mtr, file_header_, frame);
-  if (index_node.is_safe(op, is_root_node)) {
+  if (index_node.is_safe(op, is_root_node, key)) {
     latch_memo.release_to(memo_point);  // 当前节点不会分裂或合并，可以将前面的锁都释放掉
   }
   return rc;
 }
 
+RC BplusTreeHandler::optimistic_find_leaf(BplusTreeMiniTransaction &mtr,
+    const function<PageNum(InternalIndexNodeHandler &)> &child_page_getter, Frame *&frame, bool &need_restart)
+{
+  LatchMemo &latch_memo = mtr.latch_memo();
+
+  // 冲突时释放所有的页面，重新从根节点开始查找
+  auto restart = [&latch_memo, &need_restart]() {
+    latch_memo.release_to(latch_memo.memo_point());
+    need_restart = true;
+    return RC::SUCCESS;
+  };
+
+  need_restart = false;
+
+  const PageNum root_page_num = file_header_.root_page;
+  if (root_page_num == BP_INVALID_PAGE_NUM) {
+    return RC::EMPTY;
+  }
+
+  RC rc = latch_memo.get_page(root_page_num, frame);
+  if (OB_FAIL(rc)) {
+    return restart();
+  }
+
+  // 更换根节点时会加着旧根节点的写锁修改根节点页号，所以拿到版本号之后根节点页号没有变化，
+  // 这个页面在这个版本时就还是根节点
+  uint64_t version = frame->version();
+  if (Frame::version_locked(version) || file_header_.root_page != root_page_num) {
+    return restart();
+  }
+
+  while (true) {
+    const IndexNode *node    = reinterpret_cast<const IndexNode *>(frame->data());
+    const bool       is_leaf = node->is_leaf;
+    if (!frame->validate_version(version)) {
+      return restart();
+    }
+    if (is_leaf) {
+      break;
+    }
+
+    // 页面可能正在被修改，读到的键值个数不可信，越界时就不要再去查找了
+    InternalIndexNodeHandler internal_node(mtr, file_header_, frame);
+    const int                size = internal_node.size();
+    if (size < 0 || size > file_header_.internal_max_size) {
+      return restart();
+    }
+
+    const PageNum child_page_num = child_page_getter(internal_node);
+    if (!frame->validate_version(version)) {
+      return restart();
+    }
+
+    const int memo_point  = latch_memo.memo_point();
+    Frame    *child_frame = nullptr;
+    rc                    = latch_memo.get_page(child_page_num, child_frame);
+    if (OB_FAIL(rc)) {
+      return restart();
+    }
+
+    const uint64_t child_version = child_frame->version();
+    if (Frame::version_locked(child_version) || !frame->validate_version(version)) {
+      return restart();
+    }
+
+    latch_memo.release_to(memo_point);  // 父节点不再需要了
+    frame   = child_frame;
+    version = child_version;
+  }
+
+  latch_memo.slatch(frame);
+  if (!frame->validate_version(version)) {
+    return restart();
+  }
+  return RC::SUCCESS;
+}
+
 RC BplusTreeHandler::insert_entry_into_leaf_node(
     BplusTreeMiniTransaction &mtr, Frame *frame, const char *key, const RID *rid)
 {
@@ -1258,7 +1633,7 @@ RC BplusTreeHandler::insert_entry_into_leaf_node(
     return RC::RECORD_DUPLICATE_KEY;
   }
 
-  if (leaf_node.size() < leaf_node.max_size()) {
+  if (leaf_node.can_insert(key)) {
     leaf_node.insert(insert_position, key, (const char *)rid);
     frame->mark_dirty();
     // disk_buffer_pool_->unpin_page(frame); // unpin pages 由latch memo 来操作
@@ -1428,8 +1803,8 @@ RC BplusTreeHandler::recover_init_header_page(
   header_dirty_ = false;
   frame->mark_dirty();
 
-  key_comparator_.init(file_header_.attr_type, file_header_.attr_length);
-  key_printer_.init(file_header_.attr_type, file_header_.attr_length);
+  key_comparator_.init(file_header_.key_attrs(), file_header_.compare_attr_num());
+  key_printer_.init(file_header_.key_attrs());
 
   return RC::SUCCESS;
 }
@@ -1557,6 +1932,246 @@ RC BplusTreeHandler::get_entry(const char *user_key, int key_len, list<RID> &rid
   return rc;
 }
 
+RC BplusTreeHandler::get_entries(
+    const char *user_keys, int key_len, int key_num, vector<RID> &rids, vector<int> *offsets /* = nullptr */)
+{
+  if (offsets != nullptr) {
+    offsets->clear();
+    offsets->reserve(key_num + 1);
+  }
+
+  const int    key_length = file_header_.key_length;
+  vector<char> left_key(key_length);
+  vector<char> right_key(key_length);
+  vector<char> last_left_key(key_length);
+
+  BplusTreeMiniTransaction mtr(*this);
+
+  RC     rc         = RC::SUCCESS;
+  Frame *frame      = nullptr;  // 当前加了读锁的叶子节点
+  size_t last_begin = rids.size();
+  for (int i = 0; i < key_num; i++) {
+    const char *user_key = user_keys + static_cast<size_t>(i) * key_len;
+    rc                   = make_bound_key(user_key, key_len, false /*max_bound*/, left_key.data());
+    if (OB_SUCC(rc)) {
+      rc = make_bound_key(user_key, key_len, true /*max_bound*/, right_key.data());
+    }
+    if (OB_FAIL(rc)) {
+      return rc;
+    }
+
+    const size_t begin = rids.size();
+    if (offsets != nullptr) {
+      offsets->push_back(static_cast<int>(begin));
+    }
+
+    if (i > 0) {
+      const int result = key_comparator_(last_left_key.data(), left_key.data());
+      if (result > 0) {
+        LOG_WARN("keys of batch lookup should be sorted. index=%d", i);
+        return RC::INVALID_ARGUMENT;
+      }
+
+      if (result == 0) {
+        // 重复的键值，直接复制上一个键值的结果
+        for (size_t j = last_begin; j < begin; j++) {
+          rids.push_back(rids[j]);
+        }
+        last_begin = begin;
+        continue;
+      }
+    }
+
+    rc = get_entries_in_leaves(mtr, left_key.data(), right_key.data(), frame, rids);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to lookup key in batch. index=%d, rc=%s", i, strrc(rc));
+      return rc;
+    }
+
+    last_begin = begin;
+    last_left_key.swap(left_key);
+  }
+
+  if (offsets != nullptr) {
+    offsets->push_back(static_cast<int>(rids.size()));
+  }
+  return RC::SUCCESS;
+}
+
+RC BplusTreeHandler::get_entries_in_leaves(
+    BplusTreeMiniTransaction &mtr, const char *left_key, const char *right_key, Frame *&frame, vector<RID> &rids)
+{
+  LatchMemo   &latch_memo = mtr.latch_memo();
+  const size_t begin      = rids.size();
+
+  // 左边界是否在这个叶子节点中。键值是有序的，所以不需要检查叶子节点的第一个键值
+  auto leaf_covers = [this, &mtr, left_key](Frame *leaf_frame) {
+    LeafIndexNodeHandler leaf(mtr, file_header_, leaf_frame);
+    return leaf.size() == 0 || leaf.next_page() == BP_INVALID_PAGE_NUM ||
+           key_comparator_(left_key, leaf.key_at(leaf.size() - 1)) <= 0;
+  };
+
+  RC rc = RC::SUCCESS;
+  while (true) {
+    if (frame != nullptr && !leaf_covers(frame)) {
+      rc = move_to_next_leaf(mtr, frame);
+      if (OB_FAIL(rc) && rc != RC::LOCKED_NEED_WAIT) {
+        return rc;
+      }
+      if (OB_FAIL(rc) || !leaf_covers(frame)) {
+        latch_memo.release();
+        frame = nullptr;
+      }
+    }
+
+    if (frame == nullptr) {
+      rc = find_leaf(mtr, BplusTreeOperationType::READ, left_key, frame);
+      if (rc == RC::EMPTY) {
+        frame = nullptr;
+        return RC::SUCCESS;
+      } else if (OB_FAIL(rc)) {
+        LOG_WARN("failed to find leaf. rc=%s", strrc(rc));
+        return rc;
+      }
+    }
+
+    LeafIndexNodeHandler first_leaf(mtr, file_header_, frame);
+    int                  index = first_leaf.lookup(key_comparator_, left_key);
+    while (true) {
+      LeafIndexNodeHandler leaf(mtr, file_header_, frame);
+      for (; index < leaf.size(); index++) {
+        if (key_comparator_(leaf.key_at(index), right_key) > 0) {
+          return RC::SUCCESS;
+        }
+
+        RID rid;
+        memcpy(&rid, leaf.value_at(index), sizeof(rid));
+        rids.push_back(rid);
+      }
+
+      if (leaf.next_page() == BP_INVALID_PAGE_NUM) {
+        return RC::SUCCESS;
+      }
+
+      rc = move_to_next_leaf(mtr, frame);
+      if (OB_FAIL(rc)) {
+        break;
+      }
+      index = 0;
+    }
+
+    if (rc != RC::LOCKED_NEED_WAIT) {
+      LOG_WARN("failed to move to next leaf. rc=%s", strrc(rc));
+      return rc;
+    }
+
+    // 与修改操作冲突了，放弃这个键值已经找到的数据，从根节点重新查找
+    latch_memo.release();
+    frame = nullptr;
+    rids.resize(begin);
+  }
+  return rc;
+}
+
+RC BplusTreeHandler::move_to_next_leaf(BplusTreeMiniTransaction &mtr, Frame *&frame)
+{
+  LeafIndexNodeHandler leaf(mtr, file_header_, frame);
+  const PageNum        next_page_num = leaf.next_page();
+
+  LatchMemo &latch_memo = mtr.latch_memo();
+  const int  memo_point = latch_memo.memo_point();
+  Frame     *next_frame = nullptr;
+  RC         rc         = latch_memo.get_page(next_page_num, next_frame);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to get next page. page num=%d, rc=%s", next_page_num, strrc(rc));
+    return rc;
+  }
+
+  if (!latch_memo.try_slatch(next_frame)) {
+    return RC::LOCKED_NEED_WAIT;
+  }
+
+  latch_memo.release_to(memo_point);
+  frame = next_frame;
+  return RC::SUCCESS;
+}
+
+RC BplusTreeHandler::make_bound_key(const char *user_key, int key_len, bool max_bound, char *key) const
+{
+  const int attr_length = file_header_.attr_length;
+  if (key_len <= 0 || key_len > attr_length) {
+    LOG_WARN("invalid key length. key len=%d, attr length=%d", key_len, attr_length);
+    return RC::INVALID_ARGUMENT;
+  }
+
+  if (file_header_.attr_num > 1) {
+    RC rc = fill_prefix_key(user_key, key_len, max_bound /*fill_max*/, key);
+    if (OB_FAIL(rc)) {
+      return rc;
+    }
+  } else {
+    // CHARS 类型的键值可能比字段短，与插入的数据一样后面补0
+    memcpy(key, user_key, key_len);
+    memset(key + key_len, 0, attr_length - key_len);
+  }
+
+  memcpy(key + attr_length, max_bound ? RID::max() : RID::min(), sizeof(RID));
+  return RC::SUCCESS;
+}
+
+/**
+ * @brief 把一列填充为这个类型的最小值或最大值
+ */
+static void fill_attr_bound(const KeyAttr &attr, char *data, bool fill_max)
+{
+  switch (attr.type) {
+    case AttrType::INTS:
+    case AttrType::DATES: {
+      int32_t value = fill_max ? numeric_limits<int32_t>::max() : numeric_limits<int32_t>::min();
+      memcpy(data, &value, min(attr.length, static_cast<int>(sizeof(value))));
+    } break;
+    case AttrType::FLOATS: {
+      float value = fill_max ? numeric_limits<float>::infinity() : -numeric_limits<float>::infinity();
+      memcpy(data, &value, min(attr.length, static_cast<int>(sizeof(value))));
+    } break;
+    default: {
+      // 字符串按照字节比较，全是0的最小，全是0xFF的最大
+      memset(data, fill_max ? 0xFF : 0, attr.length);
+    } break;
+  }
+}
+
+RC BplusTreeHandler::fill_prefix_key(const char *user_key, int key_len, bool fill_max, char *fixed_key) const
+{
+  const AttrComparator  &attr_comparator = key_comparator_.attr_comparator();
+  const vector<KeyAttr> &attrs           = attr_comparator.attrs();
+
+  // 前缀必须是前面的几个完整的列
+  int attr_index = 0;
+  int prefix_len = 0;
+  for (; attr_index < attr_comparator.compare_num() && prefix_len < key_len; attr_index++) {
+    prefix_len += attrs[attr_index].length;
+  }
+  if (key_len <= 0 || prefix_len != key_len) {
+    LOG_WARN("invalid prefix key of bplus tree. key len=%d", key_len);
+    return RC::INVALID_ARGUMENT;
+  }
+
+  memcpy(fixed_key, user_key, key_len);
+
+  int offset = key_len;
+  for (; attr_index < static_cast<int>(attrs.size()); attr_index++) {
+    if (attr_index < attr_comparator.compare_num()) {
+      fill_attr_bound(attrs[attr_index], fixed_key + offset, fill_max);
+    } else {
+      // INCLUDE 列不参与比较
+      memset(fixed_key + offset, 0, attrs[attr_index].length);
+    }
+    offset += attrs[attr_index].length;
+  }
+  return RC::SUCCESS;
+}
+
 RC BplusTreeHandler::adjust_root(BplusTreeMiniTransaction &mtr, Frame *root_frame)
 {
   LatchMemo &latch_memo = mtr.latch_memo();
@@ -1654,7 +2269,9 @@ RC BplusTreeHandler::coalesce_or_redistribute(BplusTreeMiniTransaction &mtr, Fra
   latch_memo.xlatch(neighbor_frame);
 
   IndexNodeHandlerType neighbor_node(mtr, file_header_, neighbor_frame);
-  if (index_node.size() + neighbor_node.size() > index_node.max_size()) {
+  // 合并时总是把右边的节点移动到左边的节点上。前缀压缩的叶子节点还要看合并后的空间是否足够
+  const bool can_coalesce = (index == 0) ? neighbor_node.can_move_to(index_node) : index_node.can_move_to(neighbor_node);
+  if (!can_coalesce) {
     rc = redistribute<IndexNodeHandlerType>(mtr, neighbor_frame, frame, parent_frame, index);
   } else {
     rc = coalesce<IndexNodeHandlerType>(mtr, neighbor_frame, frame, parent_frame, index);
@@ -1830,6 +2447,26 @@ RC BplusTreeScanner::open(const char *left_user_key, int left_len, bool left_inc
 
   LatchMemo &latch_memo = mtr_.latch_memo();
 
+  // 多列的键值，先把前缀补齐成完整的键值，后面就与单列的处理方式一样了
+  const bool         multi_attrs = tree_handler_.file_header_.attr_num > 1;
+  unique_ptr<char[]> left_prefix_key;
+  unique_ptr<char[]> right_prefix_key;
+  if (multi_attrs && left_user_key != nullptr) {
+    // [prefix 从前缀的最小值开始，(prefix 从前缀的最大值之后开始
+    rc = fix_prefix_key(left_user_key, left_len, !left_inclusive /*fill_max*/, left_prefix_key);
+    if (OB_FAIL(rc)) {
+      return rc;
+    }
+    left_user_key = left_prefix_key.get();
+  }
+  if (multi_attrs && right_user_key != nullptr) {
+    rc = fix_prefix_key(right_user_key, right_len, right_inclusive /*fill_max*/, right_prefix_key);
+    if (OB_FAIL(rc)) {
+      return rc;
+    }
+    right_user_key = right_prefix_key.get();
+  }
+
   // 校验输入的键值是否是合法范围
   if (left_user_key && right_user_key) {
     const auto &attr_comparator = tree_handler_.key_comparator_.attr_comparator();
@@ -1857,7 +2494,7 @@ RC BplusTreeScanner::open(const char *left_user_key, int left_len, bool left_inc
   } else {
 
     char *fixed_left_key = const_cast<char *>(left_user_key);
-    if (tree_handler_.file_header_.attr_type == AttrType::CHARS) {
+    if (!multi_attrs && tree_handler_.file_header_.attr_type == AttrType::CHARS) {
       bool should_inclusive_after_fix = false;
       rc = fix_user_key(left_user_key, left_len, true /*greater*/, &fixed_left_key, &should_inclusive_after_fix);
       if (OB_FAIL(rc)) {
@@ -1924,7 +2561,7 @@ RC BplusTreeScanner::open(const char *left_user_key, int left_len, bool left_inc
 
     char *fixed_right_key          = const_cast<char *>(right_user_key);
     bool  should_include_after_fix = false;
-    if (tree_handler_.file_header_.attr_type == AttrType::CHARS) {
+    if (!multi_attrs && tree_handler_.file_header_.attr_type == AttrType::CHARS) {
       rc = fix_user_key(right_user_key, right_len, false /*want_greater*/, &fixed_right_key, &should_include_after_fix);
       if (OB_FAIL(rc)) {
         LOG_WARN("failed to fix right user key. rc=%s", strrc(rc));
@@ -1954,10 +2591,13 @@ RC BplusTreeScanner::open(const char *left_user_key, int left_len, bool left_inc
   return RC::SUCCESS;
 }
 
-void BplusTreeScanner::fetch_item(RID &rid)
+void BplusTreeScanner::fetch_item(RID &rid, char *user_key)
 {
   LeafIndexNodeHandler node(mtr_, tree_handler_.file_header_, current_frame_);
   memcpy(&rid, node.value_at(iter_index_), sizeof(rid));
+  if (user_key != nullptr) {
+    memcpy(user_key, node.key_at(iter_index_), tree_handler_.file_header_.attr_length);
+  }
 }
 
 bool BplusTreeScanner::touch_end()
@@ -1973,14 +2613,16 @@ bool BplusTreeScanner::touch_end()
   return compare_result > 0;
 }
 
-RC BplusTreeScanner::next_entry(RID &rid)
+RC BplusTreeScanner::next_entry(RID &rid) { return next_entry(rid, nullptr); }
+
+RC BplusTreeScanner::next_entry(RID &rid, char *user_key)
 {
   if (nullptr == current_frame_) {
     return RC::RECORD_EOF;
   }
 
   if (!first_emitted_) {
-    fetch_item(rid);
+    fetch_item(rid, user_key);
     first_emitted_ = true;
     return RC::SUCCESS;
   }
@@ -1993,7 +2635,7 @@ RC BplusTreeScanner::next_entry(RID &rid)
       return RC::RECORD_EOF;
     }
 
-    fetch_item(rid);
+    fetch_item(rid, user_key);
     return RC::SUCCESS;
   }
 
@@ -2024,7 +2666,7 @@ RC BplusTreeScanner::next_entry(RID &rid)
 
   latch_memo.release_to(memo_point);
   iter_index_ = -1;  // `next` will add 1
-  return next_entry(rid);
+  return next_entry(rid, user_key);
 }
 
 RC BplusTreeScanner::close()
@@ -2084,3 +2726,9 @@ RC BplusTreeScanner::fix_user_key(
   *fixed_key = key_buf;
   return RC::SUCCESS;
 }
+
+RC BplusTreeScanner::fix_prefix_key(const char *user_key, int key_len, bool fill_max, unique_ptr<char[]> &fixed_key)
+{
+  fixed_key = make_unique<char[]>(tree_handler_.file_header_.attr_length);
+  return tree_handler_.fill_prefix_key(user_key, key_len, fill_max, fixed_key.get());
+}
@@ -23,6 +23,7 @@ See the Mulan PSL v2 for more details. */
 #include "common/lang/memory.h"
 #include "common/lang/sstream.h"
 #include "common/lang/functional.h"
+#include "common/lang/vector.h"
 #include "common/log/log.h"
 #include "sql/parser/parse_defs.h"
 #include "storage/buffer/disk_buffer_pool.h"
@@ -49,36 +50,74 @@ enum class BplusTreeOperationType
   DELETE,
 };
 
+/**
+ * @brief 键值中一列的类型和长度
+ * @ingroup BPlusTree
+ */
+struct KeyAttr
+{
+  AttrType type;
+  int      length;
+};
+
 /**
  * @brief 属性比较(BplusTree)
  * @ingroup BPlusTree
+ * @details 键值可以由多列组成(复合索引)，按照列的顺序依次比较，前面的列相等时再比较后面的列。
+ * 只有前 compare_num 列参与比较，后面的列是 INCLUDE 列，只存放在键值中。
  */
 class AttrComparator
 {
 public:
-  void init(AttrType type, int length)
+  void init(AttrType type, int length) { init(vector<KeyAttr>{KeyAttr{type, length}}, 1); }
+
+  void init(const vector<KeyAttr> &attrs, int compare_num)
   {
-    attr_type_   = type;
-    attr_length_ = length;
+    attrs_       = attrs;
+    compare_num_ = compare_num;
+    attr_length_ = 0;
+    for (const KeyAttr &attr : attrs_) {
+      attr_length_ += attr.length;
+    }
   }
 
+  /// 所有列的总长度，包括 INCLUDE 列
   int attr_length() const { return attr_length_; }
 
+  const vector<KeyAttr> &attrs() const { return attrs_; }
+  int                    compare_num() const { return compare_num_; }
+
   int operator()(const char *v1, const char *v2) const
+  {
+    int offset = 0;
+    for (int i = 0; i < compare_num_; i++) {
+      const KeyAttr &attr   = attrs_[i];
+      const int      result = compare_attr(attr, v1 + offset, v2 + offset);
+      if (result != 0) {
+        return result;
+      }
+      offset += attr.length;
+    }
+    return 0;
+  }
+
+private:
+  static int compare_attr(const KeyAttr &attr, const char *v1, const char *v2)
   {
     // TODO: optimized the comparison
     Value left;
-    left.set_type(attr_type_);
-    left.set_data(v1, attr_length_);
+    left.set_type(attr.type);
+    left.set_data(v1, attr.length);
     Value right;
-    right.set_type(attr_type_);
-    right.set_data(v2, attr_length_);
-    return DataType::type_instance(attr_type_)->compare(left, right);
+    right.set_type(attr.type);
+    right.set_data(v2, attr.length);
+    return DataType::type_instance(attr.type)->compare(left, right);
   }
 
 private:
-  AttrType attr_type_;
-  int      attr_length_;
+  vector<KeyAttr> attrs_;
+  int             compare_num_ = 0;
+  int             attr_length_ = 0;
 };
 
 /**
@@ -90,6 +129,7 @@ class KeyComparator
 {
 public:
   void init(AttrType type, int length) { attr_comparator_.init(type, length); }
+  void init(const vector<KeyAttr> &attrs, int compare_num) { attr_comparator_.init(attrs, compare_num); }
 
   const AttrComparator &attr_comparator() const { return attr_comparator_; }
 
@@ -116,23 +156,37 @@ private:
 class AttrPrinter
 {
 public:
-  void init(AttrType type, int length)
+  void init(AttrType type, int length) { init(vector<KeyAttr>{KeyAttr{type, length}}); }
+
+  void init(const vector<KeyAttr> &attrs)
   {
-    attr_type_   = type;
-    attr_length_ = length;
+    attrs_       = attrs;
+    attr_length_ = 0;
+    for (const KeyAttr &attr : attrs_) {
+      attr_length_ += attr.length;
+    }
   }
 
   int attr_length() const { return attr_length_; }
 
   string operator()(const char *v) const
   {
-    Value value(attr_type_, const_cast<char *>(v), attr_length_);
-    return value.to_string();
+    string result;
+    int    offset = 0;
+    for (size_t i = 0; i < attrs_.size(); i++) {
+      Value value(attrs_[i].type, const_cast<char *>(v + offset), attrs_[i].length);
+      if (i > 0) {
+        result += ",";
+      }
+      result += value.to_string();
+      offset += attrs_[i].length;
+    }
+    return result;
   }
 
 private:
-  AttrType attr_type_;
-  int      attr_length_;
+  vector<KeyAttr> attrs_;
+  int             attr_length_ = 0;
 };
 
 /**
@@ -143,6 +197,7 @@ class KeyPrinter
 {
 public:
   void init(AttrType type, int length) { attr_printer_.init(type, length); }
+  void init(const vector<KeyAttr> &attrs) { attr_printer_.init(attrs); }
 
   const AttrPrinter &attr_printer() const { return attr_printer_; }
 
@@ -164,10 +219,14 @@ private:
  * @brief the meta information of bplus tree
  * @ingroup BPlusTree
  * @details this is the first page of bplus tree.
- * only one field can be supported, can you extend it to multi-fields?
+ * 键值可以由多列组成，前 key_attr_num 列参与比较，后面的是 INCLUDE 列。
+ * 多列的描述和前缀压缩的标记追加在最后，旧版本的索引文件中这些字段都是0，表示只有 attr_type 一列，不使用前缀压缩。
  */
 struct IndexFileHeader
 {
+  /// 键值最多包含的列数，包括 INCLUDE 列
+  static constexpr int MAX_ATTR_NUM = 16;
+
   IndexFileHeader()
   {
     memset(this, 0, sizeof(IndexFileHeader));
@@ -176,9 +235,31 @@ struct IndexFileHeader
   PageNum  root_page;          ///< 根节点在磁盘中的页号
   int32_t  internal_max_size;  ///< 内部节点最大的键值对数
   int32_t  leaf_max_size;      ///< 叶子节点最大的键值对数
-  int32_t  attr_length;        ///< 键值的长度
+  int32_t  attr_length;        ///< 键值的长度，多列时是所有列的长度之和
   int32_t  key_length;         ///< attr length + sizeof(RID)
-  AttrType attr_type;          ///< 键值的类型
+  AttrType attr_type;          ///< 键值的类型，多列时是第一列的类型
+  int32_t  attr_num;           ///< 键值的列数，包括 INCLUDE 列。0 表示只有一列
+  int32_t  key_attr_num;       ///< 参与比较的列数
+  AttrType attr_types[MAX_ATTR_NUM];
+  int32_t  attr_lengths[MAX_ATTR_NUM];
+  int32_t  leaf_prefix_compression;  ///< 叶子节点是否使用前缀压缩
+
+  /// 键值中所有列的类型和长度
+  vector<KeyAttr> key_attrs() const
+  {
+    if (attr_num == 0) {
+      return vector<KeyAttr>{KeyAttr{attr_type, attr_length}};
+    }
+
+    vector<KeyAttr> attrs;
+    for (int i = 0; i < attr_num; i++) {
+      attrs.push_back(KeyAttr{attr_types[i], attr_lengths[i]});
+    }
+    return attrs;
+  }
+
+  /// 参与比较的列数
+  int compare_attr_num() const { return attr_num == 0 ? 1 : key_attr_num; }
 
   const string to_string() const
   {
@@ -186,7 +267,9 @@ struct IndexFileHeader
 
     ss << "attr_length:" << attr_length << "," << "key_length:" << key_length << ","
        << "attr_type:" << attr_type_to_string(attr_type) << "," << "root_page:" << root_page << ","
-       << "internal_max_size:" << internal_max_size << "," << "leaf_max_size:" << leaf_max_size << ";";
+       << "internal_max_size:" << internal_max_size << "," << "leaf_max_size:" << leaf_max_size << ","
+       << "attr_num:" << attr_num << "," << "key_attr_num:" << key_attr_num << ","
+       << "leaf_prefix_compression:" << leaf_prefix_compression << ";";
 
     return ss.str();
   }
@@ -197,16 +280,18 @@ struct IndexFileHeader
  * @ingroup BPlusTree
  * @code
  * storage format:
- * | page type | item number | parent page id |
+ * | page type | prefix length | item number | parent page id |
  * @endcode
+ * prefix length 放在 page type 后面原来用于对齐的位置，不影响页面的布局
  */
 struct IndexNode
 {
   static constexpr int HEADER_SIZE = 12;
 
-  bool    is_leaf;  /// 当前是叶子节点还是内部节点
-  int     key_num;  /// 当前页面上一共有多少个键值对
-  PageNum parent;   /// 父节点页面编号
+  bool    is_leaf;        /// 当前是叶子节点还是内部节点
+  int16_t prefix_length;  /// 叶子节点使用前缀压缩时，所有键值共同的前缀长度
+  int     key_num;        /// 当前页面上一共有多少个键值对
+  PageNum parent;         /// 父节点页面编号
 };
 
 /**
@@ -221,6 +306,11 @@ struct IndexNode
  * so the key in leaf page must be unique.
  * the value is rid.
  * can you implenment a cluster index ?
+ *
+ * 使用前缀压缩时，页面中先存放所有键值共同的前缀，每个元素只存放键值去掉前缀之后的部分和rid，
+ * 元素仍然是定长的，可以直接二分查找：
+ * | common header | prev page id | next page id |
+ * | prefix | suffix0, rid0 | suffix1, rid1 | ... | suffixn, ridn |
  */
 struct LeafIndexNode : public IndexNode
 {
@@ -284,6 +374,9 @@ public:
   int     size() const;
   int     max_size() const;
   int     min_size() const;
+
+  /// 节点中最少的元素个数，非根节点的元素少于这个值时需要合并或重新分配
+  static int min_size(const IndexFileHeader &header, bool leaf);
   RC      set_parent_page_num(PageNum page_num);
   PageNum parent_page_num() const;
   PageNum page_num() const;
@@ -293,8 +386,25 @@ public:
    * @details 安全是指在操作执行后，节点不需要调整，比如分裂、合并或重新分配
    * @param op 将要执行的操作
    * @param is_root_node 是否根节点
+   * @param key 要插入的键值。叶子节点使用前缀压缩时能否放下与键值有关，为空时按照没有公共前缀判断
    */
-  bool is_safe(BplusTreeOperationType op, bool is_root_node);
+  bool is_safe(BplusTreeOperationType op, bool is_root_node, const char *key = nullptr);
+
+  /**
+   * @brief 当前节点能否直接放下一个新的元素，不需要分裂
+   * @param key 新元素的键值，为空时按照与其它键值没有公共前缀判断
+   */
+  bool can_insert(const char *key) const;
+
+  /// 是否使用了前缀压缩。只有叶子节点会压缩
+  bool prefix_compressed() const;
+
+  /// 前缀压缩时，num 个元素共享 prefix_length 字节的前缀时占用的空间
+  static int compressed_items_size(const IndexFileHeader &header, int prefix_length, int num);
+  /// 前缀压缩时，叶子节点中可以用来存放前缀和元素的空间
+  static int compressed_items_capacity();
+  /// 两个键值在前 length 个字节中相同的前缀长度
+  static int common_prefix_length(const char *key1, const char *key2, int length);
 
   /**
    * @brief 验证当前节点是否有问题
@@ -308,6 +418,12 @@ public:
   RC recover_insert_items(int index, const char *items, int num);
   RC recover_remove_items(int index, int num);
 
+  /**
+   * @brief 在节点的最后追加一些元素并记录日志
+   * @details 只修改当前页面，不会调整子节点的父节点编号。批量构建B+树时使用
+   */
+  RC append_items(const char *items, int num);
+
 protected:
   /**
    * @brief 获取指定元素的开始内存位置
@@ -318,6 +434,23 @@ protected:
   char         *__key_at(int index) const { return __item_at(index); }
   char         *__value_at(int index) const { return __item_at(index) + key_size(); };
 
+  /// 前缀压缩时的公共前缀，存放在元素数组的最前面
+  char *compressed_prefix() const;
+  /// 前缀压缩时每个元素占用的空间，即键值去掉前缀之后的部分加上值
+  int   compressed_slot_size() const;
+  char *compressed_slot_at(int index) const;
+
+  /**
+   * @brief 把 num 个完整的元素加入当前节点之后，所有键值共同的前缀长度
+   * @details 只会在当前的前缀上缩短，删除元素之后前缀不会再变长
+   */
+  int shared_prefix_length(const char *items, int num) const;
+
+  /// 把从 index 开始的 num 个压缩的元素还原成完整的元素
+  void decode_items(int index, int num, char *items) const;
+  /// 使用指定的前缀长度重新编码当前节点的所有元素
+  void encode_items(const char *items, int num, int prefix_length);
+
 protected:
   BplusTreeMiniTransaction &mtr_;
   const IndexFileHeader    &header_;
@@ -339,6 +472,10 @@ public:
   RC      set_next_page(PageNum page_num);
   PageNum next_page() const;
 
+  /**
+   * @brief 获取指定位置的键值
+   * @note 前缀压缩时返回的是还原出来的键值，下次调用 key_at 之前有效
+   */
   char *key_at(int index);
   char *value_at(int index);
 
@@ -348,6 +485,11 @@ public:
    */
   int lookup(const KeyComparator &comparator, const char *key, bool *found = nullptr) const;
 
+  /**
+   * @brief 当前节点的所有元素能否全部移动到另一个节点中，即能否合并
+   */
+  bool can_move_to(LeafIndexNodeHandler &other);
+
   RC  insert(int index, const char *key, const char *value);
   RC  remove(int index);
   int remove(const char *key, const KeyComparator &comparator);
@@ -370,8 +512,15 @@ protected:
   RC append(const char *item);
   RC preappend(const char *item);
 
+  /**
+   * @brief 获取从 index 开始的 num 个完整的元素
+   * @details 没有压缩时直接返回页面中的数据，否则还原到 buffer 中
+   */
+  const char *items_at(int index, int num, vector<char> &buffer) const;
+
 private:
   LeafIndexNode *leaf_node_ = nullptr;
+  vector<char>   key_buffer_;  ///< 前缀压缩时 key_at 还原出来的键值
 };
 
 /**
@@ -398,6 +547,11 @@ public:
   void set_key_at(int index, const char *key);
   void remove(int index);
 
+  /**
+   * @brief 当前节点的所有元素能否全部移动到另一个节点中，即能否合并
+   */
+  bool can_move_to(InternalIndexNodeHandler &other) const;
+
   /**
    * 与Leaf节点不同，lookup返回指定key应该属于哪个子节点，返回这个子节点在当前节点中的索引
    * 如果想要返回插入位置，就提供 `insert_position` 参数
@@ -461,6 +615,18 @@ public:
   RC create(LogHandler &log_handler, DiskBufferPool &buffer_pool, AttrType attr_type, int attr_length,
       int internal_max_size = -1, int leaf_max_size = -1);
 
+  /**
+   * @brief 创建一个键值由多列组成的B+树
+   * @details 键值中有 CHARS 类型的列时，叶子节点使用前缀压缩。其它类型的数据按照小端存储，
+   * 相邻键值的公共前缀通常很短，压缩没有意义
+   * @param attrs 键值中每一列的类型和长度
+   * @param key_attr_num 前面多少列参与比较，后面的列是 INCLUDE 列，只存放在键值中
+   */
+  RC create(LogHandler &log_handler, BufferPoolManager &bpm, const char *file_name, const vector<KeyAttr> &attrs,
+      int key_attr_num, int internal_max_size = -1, int leaf_max_size = -1);
+  RC create(LogHandler &log_handler, DiskBufferPool &buffer_pool, const vector<KeyAttr> &attrs, int key_attr_num,
+      int internal_max_size = -1, int leaf_max_size = -1);
+
   /**
    * @brief 打开一个B+树
    * @param log_handler 记录日志
@@ -504,6 +670,17 @@ public:
    */
   RC get_entry(const char *user_key, int key_len, list<RID> &rids);
 
+  /**
+   * @brief 批量获取多个键值对应的record
+   * @details 键值需要按照从小到大的顺序排列，可以重复。查找下一个键值时先在当前的叶子节点和它后面的一个叶子节点中定位，
+   * 都不在时才从根节点重新查找。适合索引嵌套循环连接、IN 列表这样一次查找很多个有序键值的场景
+   * @param user_keys 连续存放的 key_num 个键值
+   * @param key_len 每个键值的长度，不能超过 attr_length。键值由多列组成时可以只给出前缀，与 BplusTreeScanner::open 相同
+   * @param[out] rids 所有键值对应的RID，按照键值的顺序追加到后面
+   * @param[out] offsets 可以为空。第i个键值的结果是 rids 中 [offsets[i], offsets[i+1]) 范围内的数据
+   */
+  RC get_entries(const char *user_keys, int key_len, int key_num, vector<RID> &rids, vector<int> *offsets = nullptr);
+
   RC sync();
 
   /**
@@ -518,6 +695,14 @@ public:
   DiskBufferPool        &buffer_pool() const { return *disk_buffer_pool_; }
   LogHandler            &log_handler() const { return *log_handler_; }
 
+  /**
+   * @brief 只读操作查找叶子节点时是否使用乐观读，默认开启
+   * @details 乐观读时不对根节点和内部节点加锁，使用页面的版本号校验读到的内容，只对叶子节点加读锁。
+   * 与修改操作冲突时重新查找，多次冲突后退回到加锁的方式。修改操作总是使用加锁的方式(crabbing protocol)
+   */
+  void set_optimistic_read(bool enable) { optimistic_read_ = enable; }
+  bool optimistic_read() const { return optimistic_read_; }
+
 public:
   /**
    * @brief 恢复更新ROOT页面
@@ -565,16 +750,54 @@ protected:
    * @brief 查找指定的叶子节点
    * @param op 当前想要执行的操作。操作类型不同会在查找的过程中加不同类型的锁
    * @param child_page_getter 用于获取子节点的函数
+   * @param key 查找的键值，可以为空
    * @param[out] frame 返回找到的叶子节点
    */
   RC find_leaf_internal(BplusTreeMiniTransaction &mtr, BplusTreeOperationType op,
-      const function<PageNum(InternalIndexNodeHandler &)> &child_page_getter, Frame *&frame);
+      const function<PageNum(InternalIndexNodeHandler &)> &child_page_getter, const char *key, Frame *&frame);
 
   /**
    * @brief 使用crabing protocol 获取页面
+   * @param key 要插入或删除的键值，可以为空。用来判断使用前缀压缩的叶子节点能否放下新的键值
+   */
+  RC crabing_protocal_fetch_page(BplusTreeMiniTransaction &mtr, BplusTreeOperationType op, PageNum page_num,
+      bool is_root_page, const char *key, Frame *&frame);
+
+  /**
+   * @brief 使用乐观读查找叶子节点
+   * @details 从根节点向下查找时只pin住页面，不加锁。先读取子节点的页号并校验父节点的版本号，
+   * pin住子节点并读取它的版本号后再校验一次父节点，保证子节点是从没有被修改过的父节点中找到的。
+   * 找到叶子节点后加读锁，并校验叶子节点的版本号。
+   * @param[out] need_restart 与修改操作冲突了，已经释放了所有的页面，需要重新查找
    */
-  RC crabing_protocal_fetch_page(
-      BplusTreeMiniTransaction &mtr, BplusTreeOperationType op, PageNum page_num, bool is_root_page, Frame *&frame);
+  RC optimistic_find_leaf(BplusTreeMiniTransaction &mtr,
+      const function<PageNum(InternalIndexNodeHandler &)> &child_page_getter, Frame *&frame, bool &need_restart);
+
+  /**
+   * @brief 把前缀 user_key 后面没有给出的列补齐为最小值或最大值
+   * @param[out] fixed_key 补齐之后的 user_key，内存大小是 attr_length
+   */
+  RC fill_prefix_key(const char *user_key, int key_len, bool fill_max, char *fixed_key) const;
+
+  /**
+   * @brief 生成查找等于 user_key 的数据时的边界键值(包含RID)
+   * @param max_bound 生成上边界还是下边界
+   * @param[out] key 边界键值，内存大小是 key_length
+   */
+  RC make_bound_key(const char *user_key, int key_len, bool max_bound, char *key) const;
+
+  /**
+   * @brief 批量查找时查找一个键值，当前的叶子节点在查找之后移动到最后访问的叶子节点
+   * @param[in,out] frame 当前加了读锁的叶子节点，可以为空
+   */
+  RC get_entries_in_leaves(BplusTreeMiniTransaction &mtr, const char *left_key, const char *right_key, Frame *&frame,
+      vector<RID> &rids);
+
+  /**
+   * @brief 移动到下一个叶子节点并释放当前的叶子节点
+   * @return LOCKED_NEED_WAIT 没有拿到下一个叶子节点的读锁。向右加锁的顺序与修改操作不同，为了避免死锁不等待
+   */
+  RC move_to_next_leaf(BplusTreeMiniTransaction &mtr, Frame *&frame);
 
   /**
    * @brief 从叶子节点中删除指定的键值对
@@ -647,6 +870,11 @@ protected:
   // 这个锁可以使用递归读写锁，但是这里偷懒先不改
   common::SharedMutex root_lock_;
 
+  /// 乐观读连续冲突多少次之后退回到加锁的方式
+  static constexpr int OPTIMISTIC_READ_RETRY_NUM = 8;
+
+  bool optimistic_read_ = true;
+
   KeyComparator key_comparator_;
   KeyPrinter    key_printer_;
 
@@ -655,6 +883,7 @@ protected:
 private:
   friend class BplusTreeScanner;
   friend class BplusTreeTester;
+  friend class BplusTreeBulkLoader;
 };
 
 /**
@@ -675,6 +904,8 @@ public:
    * @param right_user_key 扫描范围的右边界。如果是null，则没有右边界
    * @param right_len right_user_key 的内存大小(只有在变长字段中才会关注)
    * @param right_inclusive 右边界的值是否包含在内
+   * @details 键值由多列组成时，边界可以只包含前面几列(前缀)，每列都是完整的长度，没有给出的列按照最小值或最大值补齐，
+   * 比如索引(a,b)上的 [a=1, a=1] 会扫描 a=1 的所有数据
    * TODO 重构参数表示方法
    */
   RC open(const char *left_user_key, int left_len, bool left_inclusive, const char *right_user_key, int right_len,
@@ -685,12 +916,17 @@ public:
    *
    * @param rid 当前默认所有值都是RID类型。对B+树来说并不是一个好的抽象
    * @return RC RECORD_EOF 表示遍历完成
-   * TODO 需要增加返回 key 的接口
    * @warning 不要在遍历时删除数据。删除数据会导致遍历器失效。
    * 当前默认的走索引删除的逻辑就是这样做的，所以删除逻辑有BUG。
    */
   RC next_entry(RID &rid);
 
+  /**
+   * @brief 获取下一条记录，同时返回键值
+   * @param user_key 返回键值(不包含RID)，内存大小至少是 attr_length，包括 INCLUDE 列
+   */
+  RC next_entry(RID &rid, char *user_key);
+
   /**
    * @brief 关闭当前扫描器
    * @details 可以不调用，在析构函数时会自动执行
@@ -703,7 +939,12 @@ private:
    */
   RC fix_user_key(const char *user_key, int key_len, bool want_greater, char **fixed_key, bool *should_inclusive);
 
-  void fetch_item(RID &rid);
+  /**
+   * 如果键值由多列组成，把前缀 user_key 后面没有给出的列补齐为最小值或最大值
+   */
+  RC fix_prefix_key(const char *user_key, int key_len, bool fill_max, unique_ptr<char[]> &fixed_key);
+
+  void fetch_item(RID &rid, char *user_key);
 
   /**
    * @brief 判断是否到了扫描的结束位置
@@ -0,0 +1,493 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "storage/index/bplus_tree_bulk_loader.h"
+#include "common/io/io.h"
+#include "common/lang/algorithm.h"
+#include "common/lang/queue.h"
+#include "common/log/log.h"
+#include "storage/index/bplus_tree.h"
+
+namespace {
+
+/// 外部排序时每次写入临时文件的数据大小
+constexpr int RUN_WRITE_BUFFER_SIZE = 1024 * 1024;
+
+/**
+ * @brief 按顺序读取一个 run 中的键值，每次从文件中读取一批
+ */
+class RunReader
+{
+public:
+  RunReader(int fd, int64_t key_num, int key_length, int batch_key_num)
+      : fd_(fd), remain_num_(key_num), key_length_(key_length), buffer_(static_cast<size_t>(batch_key_num) * key_length)
+  {}
+
+  /// 当前的键值，到达结尾之后不能调用
+  const char *current() const { return buffer_.data() + static_cast<size_t>(pos_) * key_length_; }
+
+  bool eof() const { return pos_ >= num_ && remain_num_ == 0; }
+
+  /// 移动到下一个键值，当前批次读完时读取下一批
+  RC next()
+  {
+    if (++pos_ < num_ || remain_num_ == 0) {
+      return RC::SUCCESS;
+    }
+
+    const int batch_key_num = static_cast<int>(buffer_.size() / key_length_);
+    num_                    = static_cast<int>(min<int64_t>(remain_num_, batch_key_num));
+    pos_                    = 0;
+    int ret                 = common::readn(fd_, buffer_.data(), num_ * key_length_);
+    if (ret != 0) {
+      LOG_WARN("failed to read sort run. fd=%d, ret=%d, error=%s", fd_, ret, strerror(errno));
+      return RC::IOERR_READ;
+    }
+    remain_num_ -= num_;
+    return RC::SUCCESS;
+  }
+
+private:
+  int          fd_         = -1;
+  int64_t      remain_num_ = 0;  ///< 文件中还没有读取的键值个数
+  int          key_length_ = 0;
+  int          pos_        = -1;
+  int          num_        = 0;  ///< 当前批次中的键值个数
+  vector<char> buffer_;
+};
+
+}  // namespace
+
+BplusTreeBulkLoader::BplusTreeBulkLoader(BplusTreeHandler &tree_handler, int fill_factor, int64_t sort_memory)
+    : tree_handler_(tree_handler),
+      fill_factor_(min(max(fill_factor, 1), 100)),
+      sort_memory_(sort_memory),
+      key_length_(tree_handler.file_header().key_length)
+{
+  sort_memory_ = max<int64_t>(sort_memory_, key_length_);
+}
+
+BplusTreeBulkLoader::~BplusTreeBulkLoader()
+{
+  release_levels();
+  remove_runs();
+}
+
+RC BplusTreeBulkLoader::add(const char *user_key, const RID &rid)
+{
+  if (static_cast<int64_t>(buffer_.size()) + key_length_ > sort_memory_) {
+    RC rc = spill();
+    if (OB_FAIL(rc)) {
+      return rc;
+    }
+  }
+
+  const int attr_length = tree_handler_.file_header().attr_length;
+  buffer_.insert(buffer_.end(), user_key, user_key + attr_length);
+  buffer_.insert(buffer_.end(), reinterpret_cast<const char *>(&rid), reinterpret_cast<const char *>(&rid) + sizeof(rid));
+  key_num_++;
+  return RC::SUCCESS;
+}
+
+void BplusTreeBulkLoader::sort_buffer(vector<const char *> &sorted_keys) const
+{
+  const size_t key_num = buffer_.size() / key_length_;
+  sorted_keys.resize(key_num);
+  for (size_t i = 0; i < key_num; i++) {
+    sorted_keys[i] = buffer_.data() + i * key_length_;
+  }
+
+  const KeyComparator &comparator = tree_handler_.key_comparator_;
+  sort(sorted_keys.begin(), sorted_keys.end(),
+      [&comparator](const char *key1, const char *key2) { return comparator(key1, key2) < 0; });
+}
+
+RC BplusTreeBulkLoader::spill()
+{
+  if (buffer_.empty()) {
+    return RC::SUCCESS;
+  }
+
+  Run run;
+  run.file_name = string(tree_handler_.buffer_pool().filename()) + ".sort." + to_string(runs_.size());
+  run.fd        = ::open(run.file_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (run.fd < 0) {
+    LOG_WARN("failed to create sort run file. file=%s, error=%s", run.file_name.c_str(), strerror(errno));
+    return RC::IOERR_OPEN;
+  }
+  runs_.push_back(run);
+
+  vector<const char *> sorted_keys;
+  sort_buffer(sorted_keys);
+
+  vector<char> write_buffer;
+  write_buffer.reserve(RUN_WRITE_BUFFER_SIZE + key_length_);
+  for (size_t i = 0; i < sorted_keys.size(); i++) {
+    write_buffer.insert(write_buffer.end(), sorted_keys[i], sorted_keys[i] + key_length_);
+    if (static_cast<int>(write_buffer.size()) >= RUN_WRITE_BUFFER_SIZE || i == sorted_keys.size() - 1) {
+      int ret = common::writen(run.fd, write_buffer.data(), static_cast<int>(write_buffer.size()));
+      if (ret != 0) {
+        LOG_WARN("failed to write sort run file. file=%s, error=%s", run.file_name.c_str(), strerror(ret));
+        return RC::IOERR_WRITE;
+      }
+      write_buffer.clear();
+    }
+  }
+
+  runs_.back().key_num = static_cast<int64_t>(sorted_keys.size());
+  buffer_.clear();
+  LOG_DEBUG("spill sort run. file=%s, key num=%zu", run.file_name.c_str(), sorted_keys.size());
+  return RC::SUCCESS;
+}
+
+RC BplusTreeBulkLoader::finish()
+{
+  if (runs_.empty()) {
+    sort_buffer(sorted_keys_);
+    return build();
+  }
+
+  RC rc = spill();
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  // 归并时不再需要排序用的内存
+  vector<char>().swap(buffer_);
+  return build();
+}
+
+RC BplusTreeBulkLoader::scan_keys(const function<RC(const char *key)> &visitor)
+{
+  if (!runs_.empty()) {
+    return merge_runs(visitor);
+  }
+
+  for (const char *key : sorted_keys_) {
+    RC rc = visitor(key);
+    if (OB_FAIL(rc)) {
+      return rc;
+    }
+  }
+  return RC::SUCCESS;
+}
+
+RC BplusTreeBulkLoader::merge_runs(const function<RC(const char *key)> &visitor)
+{
+  // 排序使用的内存平均分给每个 run 作为读缓冲
+  const int batch_key_num =
+      static_cast<int>(max<int64_t>(1, sort_memory_ / (key_length_ * static_cast<int64_t>(runs_.size()))));
+
+  vector<RunReader> readers;
+  readers.reserve(runs_.size());
+  for (Run &run : runs_) {
+    if (::lseek(run.fd, 0, SEEK_SET) < 0) {
+      LOG_WARN("failed to seek sort run file. file=%s, error=%s", run.file_name.c_str(), strerror(errno));
+      return RC::IOERR_SEEK;
+    }
+    readers.emplace_back(run.fd, run.key_num, key_length_, batch_key_num);
+  }
+
+  // 最小堆，堆顶是当前键值最小的 run
+  const KeyComparator &comparator = tree_handler_.key_comparator_;
+  auto                 greater    = [&readers, &comparator](int run1, int run2) {
+    return comparator(readers[run1].current(), readers[run2].current()) > 0;
+  };
+  priority_queue<int, vector<int>, decltype(greater)> heap(greater);
+
+  for (int i = 0; i < static_cast<int>(readers.size()); i++) {
+    RC rc = readers[i].next();
+    if (OB_FAIL(rc)) {
+      return rc;
+    }
+    if (!readers[i].eof()) {
+      heap.push(i);
+    }
+  }
+
+  while (!heap.empty()) {
+    const int run = heap.top();
+    heap.pop();
+
+    RC rc = visitor(readers[run].current());
+    if (OB_FAIL(rc)) {
+      return rc;
+    }
+
+    rc = readers[run].next();
+    if (OB_FAIL(rc)) {
+      return rc;
+    }
+    if (!readers[run].eof()) {
+      heap.push(run);
+    }
+  }
+  return RC::SUCCESS;
+}
+
+RC BplusTreeBulkLoader::plan_compressed_leaves()
+{
+  const IndexFileHeader &header   = tree_handler_.file_header();
+  const int              min_size = IndexNodeHandler::min_size(header, true /*leaf*/);
+  const int              max_size = max(min_size, header.leaf_max_size * fill_factor_ / 100);
+  const int              capacity = IndexNodeHandler::compressed_items_capacity() * fill_factor_ / 100;
+
+  // 每个页面能放下多少元素取决于页面内键值的公共前缀，所以要先按顺序扫描一遍键值，贪心地填充每个页面
+  leaf_counts_.clear();
+  vector<char> first_key(key_length_);
+  int          count         = 0;
+  int          prefix_length = 0;
+  RC rc = scan_keys([&](const char *key) {
+    if (count > 0) {
+      const int new_prefix_length = IndexNodeHandler::common_prefix_length(first_key.data(), key, prefix_length);
+      if (count < min_size ||
+          (count < max_size &&
+              IndexNodeHandler::compressed_items_size(header, new_prefix_length, count + 1) <= capacity)) {
+        prefix_length = new_prefix_length;
+        count++;
+        return RC::SUCCESS;
+      }
+      leaf_counts_.push_back(count);
+    }
+
+    memcpy(first_key.data(), key, key_length_);
+    prefix_length = key_length_;
+    count         = 1;
+    return RC::SUCCESS;
+  });
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+  leaf_counts_.push_back(count);
+
+  // 最后一个页面的元素可能不够 min_size 个，从前一个页面挪一些过来，挪不够时就与前一个页面合并。
+  // 合并后的元素不超过 2 * min_size - 1 个，按照未压缩的格式也能放下
+  const int page_num = static_cast<int>(leaf_counts_.size());
+  if (page_num > 1 && leaf_counts_[page_num - 1] < min_size) {
+    const int total = leaf_counts_[page_num - 2] + leaf_counts_[page_num - 1];
+    if (total < 2 * min_size) {
+      leaf_counts_.pop_back();
+      leaf_counts_.back() = total;
+    } else {
+      leaf_counts_[page_num - 2] = total - min_size;
+      leaf_counts_[page_num - 1] = min_size;
+    }
+  }
+  return RC::SUCCESS;
+}
+
+void BplusTreeBulkLoader::plan_levels()
+{
+  const IndexFileHeader &header = tree_handler_.file_header();
+
+  // 元素平均分配到每个页面。除了根节点，每个节点至少要有 min_size 个元素(与 IndexNodeHandler::min_size 相同)，
+  // 否则删除数据时合并和重新分配节点的逻辑不成立，所以填充比例过低时会减少页面个数
+  auto page_num_of = [this](int64_t item_num, int max_size) {
+    const int capacity = max(1, max_size * fill_factor_ / 100);
+    const int min_size = max(1, max_size - max_size / 2);
+
+    int64_t page_num = (item_num + capacity - 1) / capacity;
+    page_num         = min(page_num, item_num / min_size);
+    return max(page_num, (item_num + max_size - 1) / max_size);
+  };
+
+  levels_.clear();
+  int64_t item_num = key_num_;
+  int     max_size = header.leaf_max_size;
+  while (true) {
+    Level level;
+    level.item_num = item_num;
+    // 前缀压缩的叶子节点已经按照页面的字节数规划好了每个页面的元素个数
+    level.page_num = (levels_.empty() && !leaf_counts_.empty()) ? static_cast<int64_t>(leaf_counts_.size())
+                                                                : page_num_of(item_num, max_size);
+    levels_.push_back(std::move(level));
+    if (levels_.back().page_num <= 1) {
+      break;
+    }
+
+    item_num = levels_.back().page_num;
+    max_size = header.internal_max_size;
+  }
+}
+
+RC BplusTreeBulkLoader::build()
+{
+  if (!tree_handler_.is_empty()) {
+    LOG_WARN("cannot bulk load a non-empty bplus tree. root page=%d", tree_handler_.file_header().root_page);
+    return RC::INTERNAL;
+  }
+  if (key_num_ == 0) {
+    return RC::SUCCESS;
+  }
+
+  RC rc = RC::SUCCESS;
+  if (tree_handler_.file_header().leaf_prefix_compression != 0) {
+    rc = plan_compressed_leaves();
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to plan compressed leaf pages. rc=%s", strrc(rc));
+      return rc;
+    }
+  }
+
+  plan_levels();
+
+  int64_t num = 0;
+  rc          = scan_keys([this, &num](const char *key) {
+    RC rc = add_item(0 /*level*/, key, key + key_length_ - sizeof(RID));
+    if (OB_SUCC(rc)) {
+      num++;
+    }
+    return rc;
+  });
+
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to bulk load bplus tree. loaded key num=%ld, rc=%s", num, strrc(rc));
+    return rc;
+  }
+  if (num != key_num_) {
+    LOG_WARN("key num mismatch while bulk loading bplus tree. loaded=%ld, expected=%ld", num, key_num_);
+    return RC::INTERNAL;
+  }
+
+  const PageNum root_page_num = levels_.back().frame->page_num();
+  for (int i = 0; i < static_cast<int>(levels_.size()); i++) {
+    rc = finish_page(i, BP_INVALID_PAGE_NUM);
+    if (OB_FAIL(rc)) {
+      return rc;
+    }
+  }
+
+  BplusTreeMiniTransaction mtr(tree_handler_, &rc);
+  tree_handler_.update_root_page_num_locked(mtr, root_page_num);
+
+  LOG_INFO("bulk load bplus tree done. key num=%ld, level num=%d, leaf page num=%ld, root page=%d",
+           key_num_, static_cast<int>(levels_.size()), levels_.front().page_num, root_page_num);
+  return rc;
+}
+
+RC BplusTreeBulkLoader::add_item(int level_index, const char *key, const char *value)
+{
+  RC     rc    = RC::SUCCESS;
+  Level &level = levels_[level_index];
+  if (level.frame == nullptr || level.count >= level.target) {
+    Frame *frame = nullptr;
+    rc           = tree_handler_.buffer_pool().allocate_page(&frame);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to allocate page while bulk loading bplus tree. level=%d, rc=%s", level_index, strrc(rc));
+      return rc;
+    }
+
+    // 先分配新的页面，叶子节点完成时需要知道下一个叶子节点
+    if (level.frame != nullptr) {
+      rc = finish_page(level_index, frame->page_num());
+      if (OB_FAIL(rc)) {
+        tree_handler_.buffer_pool().unpin_page(frame);
+        return rc;
+      }
+    }
+
+    level.frame = frame;
+    level.page_index++;
+    level.count  = 0;
+    if (level_index == 0 && !leaf_counts_.empty()) {
+      level.target = leaf_counts_[level.page_index];
+    } else {
+      level.target = static_cast<int>(
+          level.item_num / level.page_num + (level.page_index < level.item_num % level.page_num ? 1 : 0));
+    }
+    level.parent = BP_INVALID_PAGE_NUM;
+    level.items.clear();
+
+    // 新页面的第一个键值放到父节点中。内部节点的第一个键值不会被使用，这里也放上子节点的第一个键值
+    if (level_index + 1 < static_cast<int>(levels_.size())) {
+      const PageNum page_num = frame->page_num();
+      rc = add_item(level_index + 1, key, reinterpret_cast<const char *>(&page_num));
+      if (OB_FAIL(rc)) {
+        return rc;
+      }
+      level.parent = levels_[level_index + 1].frame->page_num();
+    }
+  }
+
+  const int value_size = (level_index == 0) ? sizeof(RID) : sizeof(PageNum);
+  level.items.insert(level.items.end(), key, key + key_length_);
+  level.items.insert(level.items.end(), value, value + value_size);
+  level.count++;
+  return rc;
+}
+
+RC BplusTreeBulkLoader::finish_page(int level_index, PageNum next_page_num)
+{
+  Level                 &level  = levels_[level_index];
+  const IndexFileHeader &header = tree_handler_.file_header();
+
+  RC rc = RC::SUCCESS;
+  {
+    // 每个页面一个 mini transaction，日志中记录的是整个页面的内容
+    BplusTreeMiniTransaction mtr(tree_handler_, &rc);
+    if (level_index == 0) {
+      LeafIndexNodeHandler node(mtr, header, level.frame);
+      rc = node.init_empty();
+      if (OB_SUCC(rc) && level.parent != BP_INVALID_PAGE_NUM) {
+        rc = node.set_parent_page_num(level.parent);
+      }
+      if (OB_SUCC(rc)) {
+        rc = node.append_items(level.items.data(), level.count);
+      }
+      if (OB_SUCC(rc) && next_page_num != BP_INVALID_PAGE_NUM) {
+        rc = node.set_next_page(next_page_num);
+      }
+    } else {
+      InternalIndexNodeHandler node(mtr, header, level.frame);
+      rc = node.init_empty();
+      if (OB_SUCC(rc) && level.parent != BP_INVALID_PAGE_NUM) {
+        rc = node.set_parent_page_num(level.parent);
+      }
+      if (OB_SUCC(rc)) {
+        rc = node.append_items(level.items.data(), level.count);
+      }
+    }
+    level.frame->mark_dirty();
+  }
+
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to fill page while bulk loading bplus tree. level=%d, page=%d, rc=%s",
+             level_index, level.frame->page_num(), strrc(rc));
+  }
+
+  tree_handler_.buffer_pool().unpin_page(level.frame);
+  level.frame = nullptr;
+  return rc;
+}
+
+void BplusTreeBulkLoader::release_levels()
+{
+  for (Level &level : levels_) {
+    if (level.frame != nullptr) {
+      tree_handler_.buffer_pool().unpin_page(level.frame);
+      level.frame = nullptr;
+    }
+  }
+}
+
+void BplusTreeBulkLoader::remove_runs()
+{
+  for (Run &run : runs_) {
+    if (run.fd >= 0) {
+      ::close(run.fd);
+      run.fd = -1;
+    }
+    ::unlink(run.file_name.c_str());
+  }
+  runs_.clear();
+}
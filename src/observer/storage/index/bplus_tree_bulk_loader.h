@@ -0,0 +1,149 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include "common/lang/functional.h"
+#include "common/lang/string.h"
+#include "common/lang/vector.h"
+#include "common/sys/rc.h"
+#include "common/types.h"
+#include "storage/buffer/page.h"
+
+class BplusTreeHandler;
+class Frame;
+struct RID;
+
+/**
+ * @brief 批量构建B+树
+ * @ingroup BPlusTree
+ * @details 在已经有数据的表上创建索引时使用。逐条插入时每条数据都要从根节点查找叶子节点，
+ * 还会频繁地分裂页面并记录日志。批量构建时先收集所有的键值(user_key + RID)并排序，
+ * 然后从左到右依次填充叶子节点，再自底向上逐层构建内部节点，不需要查找和分裂页面。
+ * 每个页面只在填充完成后使用一个 mini transaction 记录整个页面的内容。
+ *
+ * 收集的键值超过 sort_memory 时，把内存中的键值排序后写到临时文件中(一个有序的 run)，
+ * 最后对所有的 run 做多路归并。临时文件放在索引文件旁边，析构时删除。
+ *
+ * 叶子节点使用前缀压缩时，每个页面能放下的元素个数与键值相关，构建前会先扫描一遍有序的键值，
+ * 规划好每个叶子页面的元素个数。
+ *
+ * 批量构建要求B+树是空的，调用者需要保证期间没有其它线程访问这棵B+树。
+ */
+class BplusTreeBulkLoader
+{
+public:
+  /// 默认的节点填充百分比。留一些空闲位置，避免后续的插入马上导致页面分裂
+  static constexpr int DEFAULT_FILL_FACTOR = 90;
+
+  /// 默认排序时使用的内存大小
+  static constexpr int64_t DEFAULT_SORT_MEMORY = 64 * 1024 * 1024;
+
+public:
+  /**
+   * @param fill_factor 节点填充的百分比，[1, 100]。除了根节点，每个节点至少会填充一半
+   * @param sort_memory 排序时在内存中最多存放多少字节的键值，超过时使用外部排序
+   */
+  BplusTreeBulkLoader(BplusTreeHandler &tree_handler, int fill_factor = DEFAULT_FILL_FACTOR,
+      int64_t sort_memory = DEFAULT_SORT_MEMORY);
+  ~BplusTreeBulkLoader();
+
+  /**
+   * @brief 添加一个键值，顺序不限
+   * @note 这里假设user_key的内存大小与attr_length 一致
+   */
+  RC add(const char *user_key, const RID &rid);
+
+  /**
+   * @brief 排序所有添加的键值并构建B+树
+   */
+  RC finish();
+
+  /// 添加的键值个数
+  int64_t key_num() const { return key_num_; }
+  /// 外部排序生成的 run 个数，全部在内存中排序时为0
+  int run_num() const { return static_cast<int>(runs_.size()); }
+
+private:
+  /// 外部排序时写到临时文件中的一个有序的键值序列
+  struct Run
+  {
+    string  file_name;
+    int     fd      = -1;
+    int64_t key_num = 0;
+  };
+
+  /// 构建过程中每一层正在填充的页面
+  struct Level
+  {
+    int64_t      item_num   = 0;                    ///< 这一层总共的元素个数
+    int64_t      page_num   = 0;                    ///< 这一层总共的页面个数
+    int64_t      page_index = -1;                   ///< 正在填充第几个页面
+    int          target     = 0;                    ///< 当前页面要填充的元素个数
+    int          count      = 0;                    ///< 当前页面已经填充的元素个数
+    Frame       *frame      = nullptr;              ///< 当前页面
+    PageNum      parent     = BP_INVALID_PAGE_NUM;  ///< 当前页面的父节点
+    vector<char> items;                             ///< 当前页面的元素
+  };
+
+  /// 排序内存中的键值，返回排好序的键值地址
+  void sort_buffer(vector<const char *> &sorted_keys) const;
+
+  /// 把内存中的键值排序后写到一个新的临时文件中
+  RC spill();
+
+  /**
+   * @brief 按照从小到大的顺序访问所有的键值，可以多次调用
+   * @param visitor 访问一个键值，传入的地址只在本次调用中有效
+   */
+  RC scan_keys(const function<RC(const char *key)> &visitor);
+
+  /// 对所有的 run 做多路归并，按顺序访问每个键值
+  RC merge_runs(const function<RC(const char *key)> &visitor);
+
+  /// 按照从小到大的顺序构建B+树
+  RC build();
+
+  /// 按照页面的字节数规划前缀压缩的叶子节点每个页面放多少元素
+  RC plan_compressed_leaves();
+
+  /// 计算每一层有多少元素和页面
+  void plan_levels();
+
+  /**
+   * @brief 在指定的层中添加一个元素，当前页面填满时分配新的页面并在上一层中添加新页面的元素
+   * @param value 叶子节点中是RID，内部节点中是子节点的页号
+   */
+  RC add_item(int level, const char *key, const char *value);
+
+  /**
+   * @brief 当前页面填充完成，记录日志并释放页面
+   * @param next_page_num 下一个叶子节点，对内部节点没有作用
+   */
+  RC finish_page(int level, PageNum next_page_num);
+
+  /// 释放还没有完成的页面，失败时调用
+  void release_levels();
+
+  void remove_runs();
+
+private:
+  BplusTreeHandler &tree_handler_;
+  int               fill_factor_ = DEFAULT_FILL_FACTOR;
+  int64_t           sort_memory_ = DEFAULT_SORT_MEMORY;
+  int               key_length_  = 0;  ///< user_key + RID 的长度
+  int64_t           key_num_     = 0;
+
+  vector<char>         buffer_;       ///< 内存中还没有排序的键值
+  vector<const char *> sorted_keys_;  ///< 没有外部排序时，排好序的键值地址
+  vector<Run>          runs_;
+  vector<Level>        levels_;       ///< 从叶子节点开始的每一层
+  vector<int>          leaf_counts_;  ///< 前缀压缩时每个叶子页面的元素个数
+};
@@ -14,12 +14,14 @@ See the Mulan PSL v2 for more details. */
 
 #include "storage/index/bplus_tree_index.h"
 #include "common/log/log.h"
+#include "storage/index/bplus_tree_bulk_loader.h"
 #include "storage/table/table.h"
 #include "storage/db/db.h"
 
 BplusTreeIndex::~BplusTreeIndex() noexcept { close(); }
 
-RC BplusTreeIndex::create(Table *table, const char *file_name, const IndexMeta &index_meta, const FieldMeta &field_meta)
+RC BplusTreeIndex::create(
+    Table *table, const char *file_name, const IndexMeta &index_meta, const vector<FieldMeta> &field_metas)
 {
   if (inited_) {
     LOG_WARN("Failed to create index due to the index has been created before. file_name:%s, index:%s, field:%s",
@@ -27,10 +29,16 @@ RC BplusTreeIndex::create(Table *table, const char *file_name, const IndexMeta &
     return RC::RECORD_OPENNED;
   }
 
-  Index::init(index_meta, field_meta);
+  Index::init(index_meta, field_metas);
+
+  vector<KeyAttr> key_attrs;
+  for (const FieldMeta &field_meta : field_metas) {
+    key_attrs.push_back(KeyAttr{field_meta.type(), field_meta.len()});
+  }
+  const int key_attr_num = static_cast<int>(index_meta.fields().size());
 
   BufferPoolManager &bpm = table->db()->buffer_pool_manager();
-  RC rc = index_handler_.create(table->db()->log_handler(), bpm, file_name, field_meta.type(), field_meta.len());
+  RC rc = index_handler_.create(table->db()->log_handler(), bpm, file_name, key_attrs, key_attr_num);
   if (RC::SUCCESS != rc) {
     LOG_WARN("Failed to create index_handler, file_name:%s, index:%s, field:%s, rc:%s",
         file_name, index_meta.name(), index_meta.field(), strrc(rc));
@@ -44,7 +52,8 @@ RC BplusTreeIndex::create(Table *table, const char *file_name, const IndexMeta &
   return RC::SUCCESS;
 }
 
-RC BplusTreeIndex::open(Table *table, const char *file_name, const IndexMeta &index_meta, const FieldMeta &field_meta)
+RC BplusTreeIndex::open(
+    Table *table, const char *file_name, const IndexMeta &index_meta, const vector<FieldMeta> &field_metas)
 {
   if (inited_) {
     LOG_WARN("Failed to open index due to the index has been initedd before. file_name:%s, index:%s, field:%s",
@@ -52,7 +61,7 @@ RC BplusTreeIndex::open(Table *table, const char *file_name, const IndexMeta &in
     return RC::RECORD_OPENNED;
   }
 
-  Index::init(index_meta, field_meta);
+  Index::init(index_meta, field_metas);
 
   BufferPoolManager &bpm = table->db()->buffer_pool_manager();
   RC                 rc  = index_handler_.open(table->db()->log_handler(), bpm, file_name);
@@ -91,14 +100,117 @@ RC BplusTreeIndex::destroy()
   return RC::SUCCESS;
 }
 
+void BplusTreeIndex::make_user_key(const char *record, char *user_key) const
+{
+  int offset = 0;
+  for (const FieldMeta &field_meta : field_metas_) {
+    memcpy(user_key + offset, record + field_meta.offset(), field_meta.len());
+    offset += field_meta.len();
+  }
+}
+
 RC BplusTreeIndex::insert_entry(const char *record, const RID *rid)
 {
-  return index_handler_.insert_entry(record + field_meta_.offset(), rid);
+  if (field_metas_.size() == 1) {
+    return index_handler_.insert_entry(record + field_metas_[0].offset(), rid);
+  }
+
+  vector<char> user_key(index_handler_.file_header().attr_length);
+  make_user_key(record, user_key.data());
+  return index_handler_.insert_entry(user_key.data(), rid);
 }
 
 RC BplusTreeIndex::delete_entry(const char *record, const RID *rid)
 {
-  return index_handler_.delete_entry(record + field_meta_.offset(), rid);
+  if (field_metas_.size() == 1) {
+    return index_handler_.delete_entry(record + field_metas_[0].offset(), rid);
+  }
+
+  vector<char> user_key(index_handler_.file_header().attr_length);
+  make_user_key(record, user_key.data());
+  return index_handler_.delete_entry(user_key.data(), rid);
+}
+
+RC BplusTreeIndex::bulk_load(RecordFileScanner &scanner, int fill_factor)
+{
+  BplusTreeBulkLoader loader(index_handler_, fill_factor);
+  vector<char>        user_key(index_handler_.file_header().attr_length);
+
+  RC     rc = RC::SUCCESS;
+  Record record;
+  while (OB_SUCC(rc = scanner.next(record))) {
+    make_user_key(record.data(), user_key.data());
+    rc = loader.add(user_key.data(), record.rid());
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to add key into bulk loader. index=%s, rc=%s", index_meta_.name(), strrc(rc));
+      return rc;
+    }
+  }
+
+  if (rc != RC::RECORD_EOF) {
+    LOG_WARN("failed to scan records while bulk loading index. index=%s, rc=%s", index_meta_.name(), strrc(rc));
+    return rc;
+  }
+
+  return loader.finish();
+}
+
+RC BplusTreeIndex::rebuild(RecordFileScanner &scanner)
+{
+  const int key_len = index_handler_.file_header().attr_length;
+
+  // 遍历时不能删除数据，先收集所有的键值和RID
+  vector<char> keys;
+  vector<RID>  rids;
+  {
+    BplusTreeScanner tree_scanner(index_handler_);
+    RC rc = tree_scanner.open(nullptr, 0, true /*left_inclusive*/, nullptr, 0, true /*right_inclusive*/);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to open tree scanner. index=%s, rc=%s", index_meta_.name(), strrc(rc));
+      return rc;
+    }
+
+    RID rid;
+    keys.resize(key_len);
+    while (OB_SUCC(rc = tree_scanner.next_entry(rid, keys.data() + rids.size() * key_len))) {
+      rids.push_back(rid);
+      keys.resize((rids.size() + 1) * key_len);
+    }
+    if (rc != RC::RECORD_EOF) {
+      LOG_WARN("failed to scan index entries. index=%s, rc=%s", index_meta_.name(), strrc(rc));
+      return rc;
+    }
+  }
+
+  for (size_t i = 0; i < rids.size(); i++) {
+    RC rc = index_handler_.delete_entry(keys.data() + i * key_len, &rids[i]);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to delete index entry. index=%s, rid=%s, rc=%s",
+               index_meta_.name(), rids[i].to_string().c_str(), strrc(rc));
+      return rc;
+    }
+  }
+
+  RC           rc = RC::SUCCESS;
+  Record       record;
+  vector<char> user_key(key_len);
+  while (OB_SUCC(rc = scanner.next(record))) {
+    make_user_key(record.data(), user_key.data());
+    rc = index_handler_.insert_entry(user_key.data(), &record.rid());
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to insert index entry. index=%s, rid=%s, rc=%s",
+               index_meta_.name(), record.rid().to_string().c_str(), strrc(rc));
+      return rc;
+    }
+  }
+
+  if (rc != RC::RECORD_EOF) {
+    LOG_WARN("failed to scan records while rebuilding index. index=%s, rc=%s", index_meta_.name(), strrc(rc));
+    return rc;
+  }
+
+  LOG_INFO("rebuild index done. index=%s, removed entries=%d", index_meta_.name(), (int)rids.size());
+  return RC::SUCCESS;
 }
 
 IndexScanner *BplusTreeIndex::create_scanner(
@@ -114,6 +226,11 @@ IndexScanner *BplusTreeIndex::create_scanner(
   return index_scanner;
 }
 
+RC BplusTreeIndex::get_entries(const char *keys, int key_len, int key_num, vector<RID> &rids)
+{
+  return index_handler_.get_entries(keys, key_len, key_num, rids);
+}
+
 RC BplusTreeIndex::sync() { return index_handler_.sync(); }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -129,6 +246,8 @@ RC BplusTreeIndexScanner::open(
 
 RC BplusTreeIndexScanner::next_entry(RID *rid) { return tree_scanner_.next_entry(*rid); }
 
+RC BplusTreeIndexScanner::next_entry(RID *rid, char *key) { return tree_scanner_.next_entry(*rid, key); }
+
 RC BplusTreeIndexScanner::destroy()
 {
   delete this;
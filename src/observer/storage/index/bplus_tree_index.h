@@ -27,22 +27,49 @@ public:
   BplusTreeIndex() = default;
   virtual ~BplusTreeIndex() noexcept;
 
-  RC create(Table *table, const char *file_name, const IndexMeta &index_meta, const FieldMeta &field_meta) override;
-  RC open(Table *table, const char *file_name, const IndexMeta &index_meta, const FieldMeta &field_meta) override;
+  RC create(
+      Table *table, const char *file_name, const IndexMeta &index_meta, const vector<FieldMeta> &field_metas) override;
+  RC open(
+      Table *table, const char *file_name, const IndexMeta &index_meta, const vector<FieldMeta> &field_metas) override;
   RC close();
   RC destroy() override;
 
   RC insert_entry(const char *record, const RID *rid) override;
   RC delete_entry(const char *record, const RID *rid) override;
 
+  /**
+   * @brief 使用扫描到的所有记录批量构建索引
+   * @details 在已经有数据的表上创建索引时使用，索引必须是空的。参考 BplusTreeBulkLoader
+   * @param fill_factor 节点填充的百分比
+   */
+  RC bulk_load(RecordFileScanner &scanner, int fill_factor);
+
+  /**
+   * @brief 删除索引中所有的数据，再把扫描到的所有记录重新插入
+   * @details 用来修复与表数据不一致的索引，比如整理数据文件时中断了。每个修改都会记录日志，
+   * 中途崩溃之后再执行一次就可以
+   */
+  RC rebuild(RecordFileScanner &scanner);
+
   /**
    * 扫描指定范围的数据
    */
   IndexScanner *create_scanner(const char *left_key, int left_len, bool left_inclusive, const char *right_key,
       int right_len, bool right_inclusive) override;
 
+  /**
+   * @brief 批量查找多个键值，参考 BplusTreeHandler::get_entries
+   */
+  RC get_entries(const char *keys, int key_len, int key_num, vector<RID> &rids) override;
+
   RC sync() override;
 
+private:
+  /**
+   * @brief 从记录中取出索引的各个字段，拼接成索引的键值
+   */
+  void make_user_key(const char *record, char *user_key) const;
+
 private:
   bool             inited_ = false;
   Table           *table_  = nullptr;
@@ -60,6 +87,7 @@ public:
   ~BplusTreeIndexScanner() noexcept override;
 
   RC next_entry(RID *rid) override;
+  RC next_entry(RID *rid, char *key) override;
   RC destroy() override;
 
   RC open(const char *left_key, int left_len, bool left_inclusive, const char *right_key, int right_len,
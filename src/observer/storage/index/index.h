@@ -15,7 +15,8 @@ See the Mulan PSL v2 for more details. */
 #pragma once
 
 #include <stddef.h>
-#include <vector>
+
+#include "common/lang/vector.h"
 
 #include "common/sys/rc.h"
 #include "storage/field/field_meta.h"
@@ -40,11 +41,16 @@ public:
   Index()          = default;
   virtual ~Index() = default;
 
-  virtual RC create(Table *table, const char *file_name, const IndexMeta &index_meta, const FieldMeta &field_meta)
+  /**
+   * @brief 创建索引
+   * @param field_metas 索引包含的字段，前面是参与比较的字段，后面是 INCLUDE 字段，与 index_meta 中的顺序一致
+   */
+  virtual RC create(
+      Table *table, const char *file_name, const IndexMeta &index_meta, const vector<FieldMeta> &field_metas)
   {
     return RC::UNSUPPORTED;
   }
-  virtual RC open(Table *table, const char *file_name, const IndexMeta &index_meta, const FieldMeta &field_meta)
+  virtual RC open(Table *table, const char *file_name, const IndexMeta &index_meta, const vector<FieldMeta> &field_metas)
   {
     return RC::UNSUPPORTED;
   }
@@ -55,6 +61,9 @@ public:
 
   const IndexMeta &index_meta() const { return index_meta_; }
 
+  /// 索引包含的字段，前面是参与比较的字段，后面是 INCLUDE 字段
+  const vector<FieldMeta> &field_metas() const { return field_metas_; }
+
   /**
    * @brief 插入一条数据
    *
@@ -84,6 +93,16 @@ public:
   virtual IndexScanner *create_scanner(const char *left_key, int left_len, bool left_inclusive, const char *right_key,
       int right_len, bool right_inclusive) = 0;
 
+  /**
+   * @brief 批量查找多个键值对应的记录
+   * @details 键值需要按照从小到大的顺序排列。比逐个键值创建扫描器少了很多次从根节点开始的查找，
+   * 适合 IN 列表这样一次查找很多个键值的场景
+   * @param keys 连续存放的 key_num 个键值，每个键值的格式与 create_scanner 的边界相同
+   * @param key_len 每个键值的长度
+   * @param[out] rids 所有键值对应的RID，按照键值的顺序追加到后面
+   */
+  virtual RC get_entries(const char *keys, int key_len, int key_num, vector<RID> &rids) { return RC::UNSUPPORTED; }
+
   /**
    * @brief 同步索引数据到磁盘
    *
@@ -91,11 +110,11 @@ public:
   virtual RC sync() = 0;
 
 protected:
-  RC init(const IndexMeta &index_meta, const FieldMeta &field_meta);
+  RC init(const IndexMeta &index_meta, const vector<FieldMeta> &field_metas);
 
 protected:
-  IndexMeta index_meta_;  ///< 索引的元数据
-  FieldMeta field_meta_;  ///< 当前实现仅考虑一个字段的索引
+  IndexMeta         index_meta_;   ///< 索引的元数据
+  vector<FieldMeta> field_metas_;  ///< 索引包含的字段
 };
 
 /**
@@ -113,5 +132,12 @@ public:
    * 如果没有更多的元素，返回RECORD_EOF
    */
   virtual RC next_entry(RID *rid) = 0;
-  virtual RC destroy()            = 0;
+
+  /**
+   * 遍历元素数据，同时返回索引的键值
+   * @param key 返回索引中所有字段(包括 INCLUDE 字段)的值，依次排列，内存大小是这些字段的长度之和
+   */
+  virtual RC next_entry(RID *rid, char *key) { return RC::UNIMPLEMENTED; }
+
+  virtual RC destroy() = 0;
 };
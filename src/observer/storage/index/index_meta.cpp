@@ -21,23 +21,73 @@ See the Mulan PSL v2 for more details. */
 
 const static Json::StaticString FIELD_NAME("name");
 const static Json::StaticString FIELD_FIELD_NAME("field_name");
+const static Json::StaticString FIELD_FIELD_NAMES("field_names");
+const static Json::StaticString FIELD_INCLUDE_FIELD_NAMES("include_field_names");
 
-RC IndexMeta::init(const char *name, const FieldMeta &field)
+RC IndexMeta::init(const char *name, const FieldMeta &field) { return init(name, {&field}, {}); }
+
+RC IndexMeta::init(
+    const char *name, const vector<const FieldMeta *> &fields, const vector<const FieldMeta *> &include_fields)
 {
   if (common::is_blank(name)) {
     LOG_ERROR("Failed to init index, name is empty.");
     return RC::INVALID_ARGUMENT;
   }
 
-  name_  = name;
-  field_ = field.name();
+  if (fields.empty()) {
+    LOG_ERROR("Failed to init index, no field. name=%s", name);
+    return RC::INVALID_ARGUMENT;
+  }
+
+  name_ = name;
+  fields_.clear();
+  include_fields_.clear();
+  for (const FieldMeta *field : fields) {
+    fields_.push_back(field->name());
+  }
+  for (const FieldMeta *field : include_fields) {
+    include_fields_.push_back(field->name());
+  }
   return RC::SUCCESS;
 }
 
 void IndexMeta::to_json(Json::Value &json_value) const
 {
   json_value[FIELD_NAME]       = name_;
-  json_value[FIELD_FIELD_NAME] = field_;
+  json_value[FIELD_FIELD_NAME] = fields_[0];
+  // 只有一个字段时与之前的格式相同
+  if (fields_.size() > 1 || !include_fields_.empty()) {
+    Json::Value fields_value(Json::arrayValue);
+    for (const string &field : fields_) {
+      fields_value.append(field);
+    }
+    Json::Value include_fields_value(Json::arrayValue);
+    for (const string &field : include_fields_) {
+      include_fields_value.append(field);
+    }
+    json_value[FIELD_FIELD_NAMES]         = std::move(fields_value);
+    json_value[FIELD_INCLUDE_FIELD_NAMES] = std::move(include_fields_value);
+  }
+}
+
+static RC fields_from_json(const TableMeta &table, const char *index_name, const Json::Value &json_value,
+    vector<const FieldMeta *> &fields)
+{
+  for (const Json::Value &field_value : json_value) {
+    if (!field_value.isString()) {
+      LOG_ERROR("Field name of index [%s] is not a string. json value=%s",
+          index_name, field_value.toStyledString().c_str());
+      return RC::INTERNAL;
+    }
+
+    const FieldMeta *field = table.field(field_value.asCString());
+    if (nullptr == field) {
+      LOG_ERROR("Deserialize index [%s]: no such field: %s", index_name, field_value.asCString());
+      return RC::SCHEMA_FIELD_MISSING;
+    }
+    fields.push_back(field);
+  }
+  return RC::SUCCESS;
 }
 
 RC IndexMeta::from_json(const TableMeta &table, const Json::Value &json_value, IndexMeta &index)
@@ -49,6 +99,28 @@ RC IndexMeta::from_json(const TableMeta &table, const Json::Value &json_value, I
     return RC::INTERNAL;
   }
 
+  // 多个字段的索引
+  if (json_value.isMember(FIELD_FIELD_NAMES)) {
+    const Json::Value &fields_value         = json_value[FIELD_FIELD_NAMES];
+    const Json::Value &include_fields_value = json_value[FIELD_INCLUDE_FIELD_NAMES];
+    if (!fields_value.isArray() || (!include_fields_value.isNull() && !include_fields_value.isArray())) {
+      LOG_ERROR("Field names of index [%s] is not an array. json value=%s",
+          name_value.asCString(), json_value.toStyledString().c_str());
+      return RC::INTERNAL;
+    }
+
+    vector<const FieldMeta *> fields;
+    vector<const FieldMeta *> include_fields;
+    RC                        rc = fields_from_json(table, name_value.asCString(), fields_value, fields);
+    if (OB_SUCC(rc)) {
+      rc = fields_from_json(table, name_value.asCString(), include_fields_value, include_fields);
+    }
+    if (OB_FAIL(rc)) {
+      return rc;
+    }
+    return index.init(name_value.asCString(), fields, include_fields);
+  }
+
   if (!field_value.isString()) {
     LOG_ERROR("Field name of index [%s] is not a string. json value=%s",
         name_value.asCString(), field_value.toStyledString().c_str());
@@ -66,6 +138,18 @@ RC IndexMeta::from_json(const TableMeta &table, const Json::Value &json_value, I
 
 const char *IndexMeta::name() const { return name_.c_str(); }
 
-const char *IndexMeta::field() const { return field_.c_str(); }
+const char *IndexMeta::field() const { return fields_.empty() ? "" : fields_[0].c_str(); }
 
-void IndexMeta::desc(ostream &os) const { os << "index name=" << name_ << ", field=" << field_; }
\ No newline at end of file
+void IndexMeta::desc(ostream &os) const
+{
+  os << "index name=" << name_ << ", field=" << fields_[0];
+  for (size_t i = 1; i < fields_.size(); i++) {
+    os << "," << fields_[i];
+  }
+  if (!include_fields_.empty()) {
+    os << ", include=" << include_fields_[0];
+    for (size_t i = 1; i < include_fields_.size(); i++) {
+      os << "," << include_fields_[i];
+    }
+  }
+}
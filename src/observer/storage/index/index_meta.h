@@ -16,6 +16,7 @@ See the Mulan PSL v2 for more details. */
 
 #include "common/sys/rc.h"
 #include "common/lang/string.h"
+#include "common/lang/vector.h"
 
 class TableMeta;
 class FieldMeta;
@@ -28,6 +29,8 @@ class Value;
  * @brief 描述一个索引
  * @ingroup Index
  * @details 一个索引包含了表的哪些字段，索引的名称等。
+ * 索引可以包含多个字段(复合索引)，按照字段的顺序比较。还可以包含一些 INCLUDE 字段，
+ * 这些字段只存放在索引的键值中，不参与比较，查询只用到索引中的字段时就不需要再读取记录(覆盖索引)。
  * 如果以后实现了多种类型的索引，还需要记录索引的类型，对应类型的一些元数据等
  */
 class IndexMeta
@@ -36,11 +39,19 @@ public:
   IndexMeta() = default;
 
   RC init(const char *name, const FieldMeta &field);
+  RC init(const char *name, const vector<const FieldMeta *> &fields, const vector<const FieldMeta *> &include_fields);
 
 public:
   const char *name() const;
+
+  /// 第一个字段的名字
   const char *field() const;
 
+  /// 参与比较的字段，至少有一个
+  const vector<string> &fields() const { return fields_; }
+  /// INCLUDE 字段
+  const vector<string> &include_fields() const { return include_fields_; }
+
   void desc(ostream &os) const;
 
 public:
@@ -48,6 +59,7 @@ public:
   static RC from_json(const TableMeta &table, const Json::Value &json_value, IndexMeta &index);
 
 protected:
-  string name_;   // index's name
-  string field_;  // field's name
+  string         name_;            // index's name
+  vector<string> fields_;          // fields' name
+  vector<string> include_fields_;  // include fields' name
 };
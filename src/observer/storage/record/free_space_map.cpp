@@ -0,0 +1,327 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "storage/record/free_space_map.h"
+#include "common/lang/algorithm.h"
+#include "common/log/log.h"
+#include "storage/buffer/disk_buffer_pool.h"
+#include "storage/buffer/frame.h"
+
+const int FreeSpaceMap::SLOT_NUM = BP_PAGE_DATA_SIZE - sizeof(FreeSpaceMap::PageHeader);
+
+static uint8_t *map_levels(Frame &frame)
+{
+  return reinterpret_cast<uint8_t *>(frame.data() + sizeof(FreeSpaceMap::PageHeader));
+}
+
+/**
+ * @brief 页面内容是否全是0
+ * @details 新分配的页面还没有初始化就崩溃时，映射页面的位置上是全0的页面
+ */
+static bool is_zero_page(Frame &frame)
+{
+  const char *data = frame.data();
+  return std::all_of(data, data + BP_PAGE_DATA_SIZE, [](char c) { return c == 0; });
+}
+
+void FreeSpaceMap::init(
+    DiskBufferPool &buffer_pool, LogHandler &log_handler, StorageFormat storage_format, bool persistent)
+{
+  disk_buffer_pool_ = &buffer_pool;
+  (void)log_handler_.init(log_handler, buffer_pool.id(), 0 /*record_size*/, storage_format);
+  map_num_.store(0);
+  persistent_ = persistent;
+  memory_levels_.clear();
+}
+
+RC FreeSpaceMap::load(vector<int> &broken_maps)
+{
+  if (!persistent_) {
+    return RC::SUCCESS;
+  }
+
+  DiskBufferPool &buffer_pool = *disk_buffer_pool_;
+
+  // 映射页面不会被释放，所以 page_count 之前的映射页面都是分配过的
+  RC  rc        = RC::SUCCESS;
+  int map_index = 0;
+  for (; map_page_num(map_index) < buffer_pool.page_count(); map_index++) {
+    Frame *frame = nullptr;
+    rc           = buffer_pool.get_this_page(map_page_num(map_index), &frame);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to get free space map page. map index=%d, rc=%s", map_index, strrc(rc));
+      return rc;
+    }
+
+    auto header = reinterpret_cast<const PageHeader *>(frame->data());
+    if (header->magic != MAGIC || header->map_index != map_index) {
+      if (is_zero_page(*frame)) {
+        // 分配了页面但是没有来得及初始化映射页面就崩溃了
+        LOG_WARN("uninitialized free space map page, reinitialize it. map index=%d, page num=%d",
+                 map_index, map_page_num(map_index));
+        rc = init_map_page(*frame, map_index);
+        broken_maps.push_back(map_index);
+      } else {
+        // 可能是其它格式的数据文件，不能覆盖页面中的数据
+        LOG_ERROR("page at free space map position is not a map page. map index=%d, page num=%d, magic=%x",
+                  map_index, map_page_num(map_index), header->magic);
+        rc = RC::INTERNAL;
+      }
+    }
+    buffer_pool.unpin_page(frame);
+    if (OB_FAIL(rc)) {
+      return rc;
+    }
+  }
+
+  map_num_.store(map_index);
+  LOG_INFO("free space map load done. buffer pool id=%d, map num=%d", buffer_pool.id(), map_index);
+  return RC::SUCCESS;
+}
+
+void FreeSpaceMap::close()
+{
+  disk_buffer_pool_ = nullptr;
+  map_num_.store(0);
+  memory_levels_.clear();
+}
+
+bool FreeSpaceMap::is_map_page(PageNum page_num) { return page_num >= 1 && (page_num - 1) % (SLOT_NUM + 1) == 0; }
+
+PageNum FreeSpaceMap::map_page_num(int map_index) { return 1 + map_index * (SLOT_NUM + 1); }
+
+void FreeSpaceMap::locate(PageNum page_num, int &map_index, int &slot)
+{
+  map_index = (page_num - 1) / (SLOT_NUM + 1);
+  slot      = (page_num - 1) % (SLOT_NUM + 1) - 1;
+}
+
+int FreeSpaceMap::level_of(bool full, int record_num, int record_capacity)
+{
+  if (full) {
+    return 0;
+  }
+  const int free_num = record_capacity - record_num;
+  if (free_num <= 0 || record_capacity <= 0) {
+    return 1;
+  }
+  return 1 + min(LEVEL_NUM - 2, free_num * (LEVEL_NUM - 1) / record_capacity);
+}
+
+RC FreeSpaceMap::init_map_page(PageNum page_num)
+{
+  int map_index = 0;
+  int slot      = 0;
+  locate(page_num, map_index, slot);
+  if (slot != -1 || map_index != map_num_.load()) {
+    LOG_WARN("invalid free space map page. page num=%d, map num=%d", page_num, map_num_.load());
+    return RC::INVALID_ARGUMENT;
+  }
+
+  Frame *frame = nullptr;
+  RC     rc    = disk_buffer_pool_->get_this_page(page_num, &frame);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to get free space map page. page num=%d, rc=%s", page_num, strrc(rc));
+    return rc;
+  }
+
+  rc = init_map_page(*frame, map_index);
+  disk_buffer_pool_->unpin_page(frame);
+  if (OB_SUCC(rc)) {
+    map_num_.store(map_index + 1);
+  }
+  return rc;
+}
+
+RC FreeSpaceMap::init_map_page(Frame &frame, int map_index)
+{
+  frame.write_latch();
+  redo_init_map_page(frame, map_index);
+  RC rc = log_handler_.init_map_page(&frame, frame.page_num(), map_index);
+  frame.write_unlatch();
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to log init free space map page. page num=%d, rc=%s", frame.page_num(), strrc(rc));
+  }
+  return rc;
+}
+
+RC FreeSpaceMap::update(PageNum page_num, int level)
+{
+  if (!persistent_) {
+    return update_in_memory(page_num, level);
+  }
+
+  int map_index = 0;
+  int slot      = 0;
+  locate(page_num, map_index, slot);
+  if (slot < 0 || map_index >= map_num_.load()) {
+    LOG_WARN("page is not managed by free space map. page num=%d, map num=%d", page_num, map_num_.load());
+    return RC::INVALID_ARGUMENT;
+  }
+
+  Frame *frame = nullptr;
+  RC     rc    = disk_buffer_pool_->get_this_page(map_page_num(map_index), &frame);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to get free space map page. map index=%d, rc=%s", map_index, strrc(rc));
+    return rc;
+  }
+
+  frame->write_latch();
+  uint8_t *levels = map_levels(*frame);
+  if (levels[slot] != level) {
+    redo_update(*frame, slot, level);
+    rc = log_handler_.update_free_space(frame, frame->page_num(), slot, level);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to log free space update. page num=%d, rc=%s", page_num, strrc(rc));
+    }
+  }
+  frame->write_unlatch();
+  disk_buffer_pool_->unpin_page(frame);
+  return rc;
+}
+
+RC FreeSpaceMap::get(PageNum page_num, int &level)
+{
+  if (!persistent_) {
+    level = get_in_memory(page_num);
+    return RC::SUCCESS;
+  }
+
+  int map_index = 0;
+  int slot      = 0;
+  locate(page_num, map_index, slot);
+  if (slot < 0 || map_index >= map_num_.load()) {
+    level = 0;
+    return RC::SUCCESS;
+  }
+
+  Frame *frame = nullptr;
+  RC     rc    = disk_buffer_pool_->get_this_page(map_page_num(map_index), &frame);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to get free space map page. map index=%d, rc=%s", map_index, strrc(rc));
+    return rc;
+  }
+  frame->read_latch();
+  level = map_levels(*frame)[slot];
+  frame->read_unlatch();
+  disk_buffer_pool_->unpin_page(frame);
+  return RC::SUCCESS;
+}
+
+RC FreeSpaceMap::find_pages(PageNum start, int max_num, vector<PageNum> &pages)
+{
+  if (!persistent_) {
+    find_pages_in_memory(start, max_num, pages);
+    return RC::SUCCESS;
+  }
+
+  const int map_num = map_num_.load();
+  if (map_num == 0) {
+    return RC::SUCCESS;
+  }
+
+  int start_map  = 0;
+  int start_slot = 0;
+  if (start > 1) {
+    locate(start, start_map, start_slot);
+    start_slot = max(start_slot, 0);
+  }
+  if (start_map >= map_num) {
+    start_map  = 0;
+    start_slot = 0;
+  }
+
+  // 从起始位置查找到最后一个映射页面，再从头查找到起始位置
+  for (int i = 0; i <= map_num && static_cast<int>(pages.size()) < max_num; i++) {
+    const int map_index = (start_map + i) % map_num;
+    const int begin     = (i == 0) ? start_slot : 0;
+    const int end       = (i == map_num) ? start_slot : SLOT_NUM;
+    if (begin >= end) {
+      continue;
+    }
+
+    Frame *frame = nullptr;
+    RC     rc    = disk_buffer_pool_->get_this_page(map_page_num(map_index), &frame);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to get free space map page. map index=%d, rc=%s", map_index, strrc(rc));
+      return rc;
+    }
+
+    frame->read_latch();
+    const uint8_t *levels = map_levels(*frame);
+    for (int slot = begin; slot < end && static_cast<int>(pages.size()) < max_num; slot++) {
+      if (levels[slot] > 0) {
+        pages.push_back(map_page_num(map_index) + 1 + slot);
+      }
+    }
+    frame->read_unlatch();
+    disk_buffer_pool_->unpin_page(frame);
+  }
+  return RC::SUCCESS;
+}
+
+RC FreeSpaceMap::update_in_memory(PageNum page_num, int level)
+{
+  if (page_num <= 0) {
+    LOG_WARN("invalid page num for free space map. page num=%d", page_num);
+    return RC::INVALID_ARGUMENT;
+  }
+
+  lock_guard guard(memory_lock_);
+  if (static_cast<size_t>(page_num) >= memory_levels_.size()) {
+    memory_levels_.resize(page_num + 1, 0);
+  }
+  memory_levels_[page_num] = static_cast<uint8_t>(level);
+  return RC::SUCCESS;
+}
+
+int FreeSpaceMap::get_in_memory(PageNum page_num)
+{
+  lock_guard guard(memory_lock_);
+  if (page_num <= 0 || static_cast<size_t>(page_num) >= memory_levels_.size()) {
+    return 0;
+  }
+  return memory_levels_[page_num];
+}
+
+void FreeSpaceMap::find_pages_in_memory(PageNum start, int max_num, vector<PageNum> &pages)
+{
+  lock_guard guard(memory_lock_);
+  const int  page_num = static_cast<int>(memory_levels_.size());
+  if (page_num <= 1) {
+    return;
+  }
+
+  // 与映射页面相同，从起始位置查找到最后一个页面，再从头查找到起始位置
+  if (start < 1 || start >= page_num) {
+    start = 1;
+  }
+  for (int i = 0; i < page_num - 1 && static_cast<int>(pages.size()) < max_num; i++) {
+    const PageNum current = 1 + (start - 1 + i) % (page_num - 1);
+    if (memory_levels_[current] > 0) {
+      pages.push_back(current);
+    }
+  }
+}
+
+void FreeSpaceMap::redo_init_map_page(Frame &frame, int map_index)
+{
+  memset(frame.data(), 0, BP_PAGE_DATA_SIZE);
+  auto header       = reinterpret_cast<PageHeader *>(frame.data());
+  header->magic     = MAGIC;
+  header->map_index = map_index;
+  frame.mark_dirty();
+}
+
+void FreeSpaceMap::redo_update(Frame &frame, int slot, int level)
+{
+  map_levels(frame)[slot] = static_cast<uint8_t>(level);
+  frame.mark_dirty();
+}
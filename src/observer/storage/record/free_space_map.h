@@ -0,0 +1,147 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "common/lang/atomic.h"
+#include "common/lang/mutex.h"
+#include "common/lang/vector.h"
+#include "common/sys/rc.h"
+#include "common/types.h"
+#include "storage/record/record_log.h"
+
+class DiskBufferPool;
+class Frame;
+class LogHandler;
+
+/**
+ * @brief 记录文件的空闲空间映射(free space map)
+ * @ingroup RecordManager
+ * @details 记录文件中每个数据页面的空闲程度，插入记录时用来查找有空闲位置的页面，
+ * 打开表时不需要再遍历所有的页面。
+ * 空闲空间映射存放在数据文件中专门的页面上，每个映射页面管理紧跟在它后面的 SLOT_NUM 个页面，
+ * 每个页面使用一个字节记录空闲程度，所以映射页面的位置是固定的：
+ * @code
+ * | page 0: buffer pool header | page 1: map page 0 | page 2 ... page SLOT_NUM + 1 | map page 1 | ...
+ * @endcode
+ * 映射页面不会被释放，只有整理文件时空的数据页面才会被释放(RecordFileHandler::compact)。新页面总是分配编号最小的空闲页面，
+ * 所以映射页面总是在它管理的页面之前分配。释放的数据页面在映射中的等级为0。
+ * 空闲程度只记录粗略的等级，只有等级变化时才修改映射页面并记录日志。
+ * 空闲空间映射只是一个提示，使用时需要检查页面是否真的有空闲位置。
+ *
+ * 之前版本创建的数据文件中，映射页面的位置上存放的是记录，不能当作映射页面使用(TableMeta::free_space_map)。
+ * 这时空闲空间映射只保存在内存中，打开文件时遍历所有的页面重新计算，与之前版本的行为相同。
+ */
+class FreeSpaceMap
+{
+public:
+  /// 空闲程度的等级个数。0 表示没有空闲位置或者不是数据页面，LEVEL_NUM - 1 表示几乎是空的
+  static constexpr int LEVEL_NUM = 4;
+
+  /// 映射页面开头的标识，用来检查映射页面是否初始化过
+  static constexpr int32_t MAGIC = 0x46534d31;  // "FSM1"
+
+  struct PageHeader
+  {
+    int32_t magic;
+    int32_t map_index;  ///< 第几个映射页面
+  };
+
+  /// 每个映射页面管理的页面个数
+  static const int SLOT_NUM;
+
+public:
+  FreeSpaceMap()  = default;
+  ~FreeSpaceMap() = default;
+
+  /**
+   * @param persistent 映射是否存放在数据文件的映射页面中。为 false 时只保存在内存中
+   */
+  void init(DiskBufferPool &buffer_pool, LogHandler &log_handler, StorageFormat storage_format, bool persistent);
+
+  /**
+   * @brief 加载文件中已有的映射页面，需要在日志回放之后调用
+   * @details 映射页面的位置上不是映射页面时，只有页面内容全是0(分配了页面但是没有来得及初始化就崩溃了)才重新初始化，
+   * 否则返回错误，不会覆盖页面中的数据。只保存在内存中时什么都不做
+   * @param[out] broken_maps 没有初始化成功的映射页面，它们已经被重新初始化为空，
+   * 调用者需要根据数据页面重新设置它们管理的页面的空闲程度
+   */
+  RC load(vector<int> &broken_maps);
+
+  void close();
+
+  /// 映射是否存放在数据文件的映射页面中
+  bool persistent() const { return persistent_; }
+
+  /**
+   * @brief 页面编号是否是映射页面的位置。只有 persistent 的文件中这些位置上才是映射页面
+   */
+  static bool is_map_page(PageNum page_num);
+
+  /**
+   * @brief 第 map_index 个映射页面的页面编号
+   */
+  static PageNum map_page_num(int map_index);
+
+  /**
+   * @brief 根据页面中的记录个数计算空闲程度
+   */
+  static int level_of(bool full, int record_num, int record_capacity);
+
+  /**
+   * @brief 初始化一个新分配的映射页面
+   * @details 新分配的页面在映射页面的位置上时调用
+   */
+  RC init_map_page(PageNum page_num);
+
+  /**
+   * @brief 修改一个数据页面的空闲程度。等级没有变化时什么都不做
+   */
+  RC update(PageNum page_num, int level);
+
+  /**
+   * @brief 获取一个数据页面的空闲程度
+   */
+  RC get(PageNum page_num, int &level);
+
+  /**
+   * @brief 从 start 开始(到最后一个页面后再从头开始)查找最多 max_num 个有空闲位置的页面
+   */
+  RC find_pages(PageNum start, int max_num, vector<PageNum> &pages);
+
+  /// 当前映射页面的个数
+  int map_num() const { return map_num_.load(); }
+
+public:
+  /// 重做日志
+  static void redo_init_map_page(Frame &frame, int map_index);
+  static void redo_update(Frame &frame, int slot, int level);
+
+private:
+  static void locate(PageNum page_num, int &map_index, int &slot);
+
+  RC init_map_page(Frame &frame, int map_index);
+
+  /// 只保存在内存中时的操作
+  RC   update_in_memory(PageNum page_num, int level);
+  int  get_in_memory(PageNum page_num);
+  void find_pages_in_memory(PageNum start, int max_num, vector<PageNum> &pages);
+
+private:
+  DiskBufferPool  *disk_buffer_pool_ = nullptr;
+  RecordLogHandler log_handler_;
+  atomic<int>      map_num_{0};  ///< 已经初始化的映射页面个数
+  bool             persistent_ = true;
+
+  common::Mutex   memory_lock_;    ///< 保护 memory_levels_
+  vector<uint8_t> memory_levels_;  ///< 只保存在内存中时，每个页面的空闲程度，下标是页面编号
+};
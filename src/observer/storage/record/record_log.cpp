@@ -22,6 +22,7 @@ See the Mulan PSL v2 for more details. */
 #include "storage/clog/log_entry.h"
 #include "storage/clog/vacuous_log_handler.h"
 #include "storage/record/record_manager.h"
+#include "storage/record/free_space_map.h"
 #include "storage/buffer/frame.h"
 #include "storage/record/record_log.h"
 
@@ -37,6 +38,12 @@ string RecordOperation::to_string() const
     case Type::INSERT: return ret + "INSERT";
     case Type::DELETE: return ret + "DELETE";
     case Type::UPDATE: return ret + "UPDATE";
+    case Type::INIT_FSM_PAGE: return ret + "INIT_FSM_PAGE";
+    case Type::UPDATE_FSM: return ret + "UPDATE_FSM";
+    case Type::INSERT_BATCH: return ret + "INSERT_BATCH";
+    case Type::OVERFLOW_PAGE: return ret + "OVERFLOW_PAGE";
+    case Type::DELETE_BATCH: return ret + "DELETE_BATCH";
+    case Type::MOVE_RECORDS: return ret + "MOVE_RECORDS";
     default: return ret + "UNKNOWN";
   }
 }
@@ -53,12 +60,18 @@ string RecordLogHeader::to_string() const
      << ", page_num:" << page_num;
 
   switch (RecordOperation(operation_type).type()) {
-    case RecordOperation::Type::INIT_PAGE: {
+    case RecordOperation::Type::INIT_PAGE:
+    case RecordOperation::Type::INSERT_BATCH:
+    case RecordOperation::Type::DELETE_BATCH:
+    case RecordOperation::Type::MOVE_RECORDS: {
       ss << ", record_size:" << record_size;
     } break;
     case RecordOperation::Type::INSERT:
     case RecordOperation::Type::DELETE:
-    case RecordOperation::Type::UPDATE: {
+    case RecordOperation::Type::UPDATE:
+    case RecordOperation::Type::INIT_FSM_PAGE:
+    case RecordOperation::Type::UPDATE_FSM:
+    case RecordOperation::Type::OVERFLOW_PAGE: {
       ss << ", slot_num:" << slot_num;
     } break;
     default: {
@@ -85,8 +98,8 @@ RC RecordLogHandler::init(
   return rc;
 }
 
-// data is the column index in page
-RC RecordLogHandler::init_new_page(Frame *frame, PageNum page_num, span<const char> data)
+// data is the column index and the column types in page
+RC RecordLogHandler::init_new_page(Frame *frame, PageNum page_num, int column_num, span<const char> data)
 {
   const int        log_payload_size = RecordLogHeader::SIZE + data.size();
   vector<char>     log_payload(log_payload_size);
@@ -96,7 +109,7 @@ RC RecordLogHandler::init_new_page(Frame *frame, PageNum page_num, span<const ch
   header->page_num        = page_num;
   header->record_size     = record_size_;
   header->storage_format  = static_cast<int>(storage_format_);
-  header->column_num      = data.size() / sizeof(int);
+  header->column_num      = column_num;
   if (data.size() > 0) {
     memcpy(log_payload.data() + RecordLogHeader::SIZE, data.data(), data.size());
   }
@@ -109,9 +122,9 @@ RC RecordLogHandler::init_new_page(Frame *frame, PageNum page_num, span<const ch
   return rc;
 }
 
-RC RecordLogHandler::insert_record(Frame *frame, const RID &rid, const char *record)
+RC RecordLogHandler::insert_record(Frame *frame, const RID &rid, span<const char> record)
 {
-  const int        log_payload_size = RecordLogHeader::SIZE + record_size_;
+  const int        log_payload_size = RecordLogHeader::SIZE + record.size();
   vector<char>     log_payload(log_payload_size);
   RecordLogHeader *header = reinterpret_cast<RecordLogHeader *>(log_payload.data());
   header->buffer_pool_id  = buffer_pool_id_;
@@ -119,7 +132,40 @@ RC RecordLogHandler::insert_record(Frame *frame, const RID &rid, const char *rec
   header->page_num        = rid.page_num;
   header->slot_num        = rid.slot_num;
   header->storage_format  = static_cast<int>(storage_format_);
-  memcpy(log_payload.data() + RecordLogHeader::SIZE, record, record_size_);
+  memcpy(log_payload.data() + RecordLogHeader::SIZE, record.data(), record.size());
+
+  LSN lsn = 0;
+  RC  rc  = log_handler_->append(lsn, LogModule::Id::RECORD_MANAGER, std::move(log_payload));
+  if (OB_SUCC(rc) && lsn > 0) {
+    frame->set_lsn(lsn);
+  }
+  return rc;
+}
+
+// the payload of batch insert log is the record number and the records
+RC RecordLogHandler::insert_records(Frame *frame, PageNum page_num, span<const span<const char>> records)
+{
+  const int32_t record_num       = static_cast<int32_t>(records.size());
+  int           log_payload_size = RecordLogHeader::SIZE + sizeof(record_num);
+  for (span<const char> record : records) {
+    log_payload_size += record.size();
+  }
+  vector<char>     log_payload(log_payload_size);
+  RecordLogHeader *header = reinterpret_cast<RecordLogHeader *>(log_payload.data());
+  header->buffer_pool_id  = buffer_pool_id_;
+  header->operation_type  = RecordOperation(RecordOperation::Type::INSERT_BATCH).type_id();
+  header->page_num        = page_num;
+  header->record_size     = record_size_;
+  header->storage_format  = static_cast<int>(storage_format_);
+  header->column_num      = 0;
+
+  char *data = log_payload.data() + RecordLogHeader::SIZE;
+  memcpy(data, &record_num, sizeof(record_num));
+  data += sizeof(record_num);
+  for (span<const char> record : records) {
+    memcpy(data, record.data(), record.size());
+    data += record.size();
+  }
 
   LSN lsn = 0;
   RC  rc  = log_handler_->append(lsn, LogModule::Id::RECORD_MANAGER, std::move(log_payload));
@@ -129,9 +175,9 @@ RC RecordLogHandler::insert_record(Frame *frame, const RID &rid, const char *rec
   return rc;
 }
 
-RC RecordLogHandler::update_record(Frame *frame, const RID &rid, const char *record)
+RC RecordLogHandler::update_record(Frame *frame, const RID &rid, span<const char> record)
 {
-  const int        log_payload_size = RecordLogHeader::SIZE + record_size_;
+  const int        log_payload_size = RecordLogHeader::SIZE + record.size();
   vector<char>     log_payload(log_payload_size);
   RecordLogHeader *header = reinterpret_cast<RecordLogHeader *>(log_payload.data());
   header->buffer_pool_id  = buffer_pool_id_;
@@ -139,7 +185,7 @@ RC RecordLogHandler::update_record(Frame *frame, const RID &rid, const char *rec
   header->page_num        = rid.page_num;
   header->slot_num        = rid.slot_num;
   header->storage_format  = static_cast<int>(storage_format_);
-  memcpy(log_payload.data() + RecordLogHeader::SIZE, record, record_size_);
+  memcpy(log_payload.data() + RecordLogHeader::SIZE, record.data(), record.size());
 
   LSN lsn = 0;
   RC  rc  = log_handler_->append(lsn, LogModule::Id::RECORD_MANAGER, std::move(log_payload));
@@ -168,6 +214,123 @@ RC RecordLogHandler::delete_record(Frame *frame, const RID &rid)
   return rc;
 }
 
+// the payload of batch delete log is the record number and the slots
+RC RecordLogHandler::delete_records(Frame *frame, PageNum page_num, span<const SlotNum> slots)
+{
+  const int32_t    record_num = static_cast<int32_t>(slots.size());
+  vector<char>     log_payload(RecordLogHeader::SIZE + sizeof(record_num) + slots.size_bytes());
+  RecordLogHeader *header = reinterpret_cast<RecordLogHeader *>(log_payload.data());
+  header->buffer_pool_id  = buffer_pool_id_;
+  header->operation_type  = RecordOperation(RecordOperation::Type::DELETE_BATCH).type_id();
+  header->page_num        = page_num;
+  header->record_size     = record_size_;
+  header->storage_format  = static_cast<int>(storage_format_);
+  header->column_num      = 0;
+
+  char *data = log_payload.data() + RecordLogHeader::SIZE;
+  memcpy(data, &record_num, sizeof(record_num));
+  memcpy(data + sizeof(record_num), slots.data(), slots.size_bytes());
+
+  LSN lsn = 0;
+  RC  rc  = log_handler_->append(lsn, LogModule::Id::RECORD_MANAGER, std::move(log_payload));
+  if (OB_SUCC(rc) && lsn > 0) {
+    frame->set_lsn(lsn);
+  }
+  return rc;
+}
+
+// the payload of move log is the target page, the record number, the slots in the source page and the records
+RC RecordLogHandler::move_records(
+    Frame *source, Frame *target, span<const SlotNum> slots, span<const span<const char>> records)
+{
+  const PageNum target_page = target->page_num();
+  const int32_t record_num  = static_cast<int32_t>(slots.size());
+  int log_payload_size = RecordLogHeader::SIZE + sizeof(target_page) + sizeof(record_num) + slots.size_bytes();
+  for (span<const char> record : records) {
+    log_payload_size += record.size();
+  }
+  vector<char>     log_payload(log_payload_size);
+  RecordLogHeader *header = reinterpret_cast<RecordLogHeader *>(log_payload.data());
+  header->buffer_pool_id  = buffer_pool_id_;
+  header->operation_type  = RecordOperation(RecordOperation::Type::MOVE_RECORDS).type_id();
+  header->page_num        = source->page_num();
+  header->record_size     = record_size_;
+  header->storage_format  = static_cast<int>(storage_format_);
+  header->column_num      = 0;
+
+  char *data = log_payload.data() + RecordLogHeader::SIZE;
+  memcpy(data, &target_page, sizeof(target_page));
+  data += sizeof(target_page);
+  memcpy(data, &record_num, sizeof(record_num));
+  data += sizeof(record_num);
+  memcpy(data, slots.data(), slots.size_bytes());
+  data += slots.size_bytes();
+  for (span<const char> record : records) {
+    memcpy(data, record.data(), record.size());
+    data += record.size();
+  }
+
+  LSN lsn = 0;
+  RC  rc  = log_handler_->append(lsn, LogModule::Id::RECORD_MANAGER, std::move(log_payload));
+  if (OB_SUCC(rc) && lsn > 0) {
+    source->set_lsn(lsn);
+    target->set_lsn(lsn);
+  }
+  return rc;
+}
+
+RC RecordLogHandler::write_overflow_page(Frame *frame, span<const char> content)
+{
+  vector<char>     log_payload(RecordLogHeader::SIZE + content.size());
+  RecordLogHeader *header = reinterpret_cast<RecordLogHeader *>(log_payload.data());
+  header->buffer_pool_id  = buffer_pool_id_;
+  header->operation_type  = RecordOperation(RecordOperation::Type::OVERFLOW_PAGE).type_id();
+  header->page_num        = frame->page_num();
+  header->slot_num        = -1;
+  header->storage_format  = static_cast<int>(storage_format_);
+  header->column_num      = 0;
+  memcpy(log_payload.data() + RecordLogHeader::SIZE, content.data(), content.size());
+
+  LSN lsn = 0;
+  RC  rc  = log_handler_->append(lsn, LogModule::Id::RECORD_MANAGER, std::move(log_payload));
+  if (OB_SUCC(rc) && lsn > 0) {
+    frame->set_lsn(lsn);
+  }
+  return rc;
+}
+
+RC RecordLogHandler::init_map_page(Frame *frame, PageNum page_num, int map_index)
+{
+  return append_fsm_log(frame, RecordOperation::Type::INIT_FSM_PAGE, page_num, -1, map_index);
+}
+
+RC RecordLogHandler::update_free_space(Frame *frame, PageNum page_num, int slot, int level)
+{
+  return append_fsm_log(frame, RecordOperation::Type::UPDATE_FSM, page_num, slot, level);
+}
+
+// the payload of free space map logs is an int32 value: the map index or the level
+RC RecordLogHandler::append_fsm_log(
+    Frame *frame, RecordOperation::Type type, PageNum page_num, int slot, int32_t value)
+{
+  vector<char>     log_payload(RecordLogHeader::SIZE + sizeof(value));
+  RecordLogHeader *header = reinterpret_cast<RecordLogHeader *>(log_payload.data());
+  header->buffer_pool_id  = buffer_pool_id_;
+  header->operation_type  = RecordOperation(type).type_id();
+  header->page_num        = page_num;
+  header->slot_num        = slot;
+  header->storage_format  = static_cast<int>(storage_format_);
+  header->column_num      = 0;
+  memcpy(log_payload.data() + RecordLogHeader::SIZE, &value, sizeof(value));
+
+  LSN lsn = 0;
+  RC  rc  = log_handler_->append(lsn, LogModule::Id::RECORD_MANAGER, std::move(log_payload));
+  if (OB_SUCC(rc) && lsn > 0) {
+    frame->set_lsn(lsn);
+  }
+  return rc;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // class RecordLogReplayer
 
@@ -197,6 +360,11 @@ RC RecordLogReplayer::replay(const LogEntry &entry)
     return rc;
   }
 
+  // 移动记录的日志修改了两个页面，需要分别判断
+  if (RecordOperation(log_header->operation_type).type() == RecordOperation::Type::MOVE_RECORDS) {
+    return replay_move_records(*buffer_pool, entry.lsn(), *log_header);
+  }
+
   rc = buffer_pool->get_this_page(log_header->page_num, &frame);
   if (OB_FAIL(rc)) {
     LOG_WARN("fail to get this page. page num=%d, rc=%s", log_header->page_num, strrc(rc));
@@ -220,12 +388,25 @@ RC RecordLogReplayer::replay(const LogEntry &entry)
     case RecordOperation::Type::INSERT: {
       rc = replay_insert(*buffer_pool, *log_header);
     } break;
+    case RecordOperation::Type::INSERT_BATCH: {
+      rc = replay_insert_batch(*buffer_pool, *log_header);
+    } break;
     case RecordOperation::Type::DELETE: {
       rc = replay_delete(*buffer_pool, *log_header);
     } break;
+    case RecordOperation::Type::DELETE_BATCH: {
+      rc = replay_delete_batch(*buffer_pool, *log_header);
+    } break;
     case RecordOperation::Type::UPDATE: {
       rc = replay_update(*buffer_pool, *log_header);
     } break;
+    case RecordOperation::Type::INIT_FSM_PAGE:
+    case RecordOperation::Type::UPDATE_FSM: {
+      rc = replay_free_space_map(*frame, *log_header);
+    } break;
+    case RecordOperation::Type::OVERFLOW_PAGE: {
+      rc = replay_overflow_page(*frame, *log_header, entry.payload_size() - RecordLogHeader::SIZE);
+    } break;
     default: {
       LOG_WARN("unknown record operation type: %d", log_header->operation_type);
       return RC::INVALID_ARGUMENT;
@@ -285,6 +466,33 @@ RC RecordLogReplayer::replay_insert(DiskBufferPool &buffer_pool, const RecordLog
   return rc;
 }
 
+RC RecordLogReplayer::replay_insert_batch(DiskBufferPool &buffer_pool, const RecordLogHeader &log_header)
+{
+  VacuousLogHandler             vacuous_log_handler;
+  unique_ptr<RecordPageHandler> record_page_handler(
+      RecordPageHandler::create(StorageFormat(log_header.storage_format)));
+
+  RC rc = record_page_handler->init(buffer_pool, vacuous_log_handler, log_header.page_num, ReadWriteMode::READ_WRITE);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("fail to init record page handler. page num=%d, rc=%s", log_header.page_num, strrc(rc));
+    return rc;
+  }
+
+  int32_t record_num = 0;
+  memcpy(&record_num, log_header.data, sizeof(record_num));
+  const char *record = log_header.data + sizeof(record_num);
+  for (int32_t i = 0; i < record_num; i++, record += record_page_handler->record_log_size(record)) {
+    rc = record_page_handler->insert_record(record, nullptr);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("fail to recover insert records. page num=%d, record index=%d, rc=%s",
+               log_header.page_num, i, strrc(rc));
+      return rc;
+    }
+  }
+
+  return rc;
+}
+
 RC RecordLogReplayer::replay_delete(DiskBufferPool &buffer_pool, const RecordLogHeader &log_header)
 {
   VacuousLogHandler             vacuous_log_handler;
@@ -308,6 +516,85 @@ RC RecordLogReplayer::replay_delete(DiskBufferPool &buffer_pool, const RecordLog
   return rc;
 }
 
+RC RecordLogReplayer::replay_delete_batch(DiskBufferPool &buffer_pool, const RecordLogHeader &log_header)
+{
+  VacuousLogHandler             vacuous_log_handler;
+  unique_ptr<RecordPageHandler> record_page_handler(
+      RecordPageHandler::create(StorageFormat(log_header.storage_format)));
+
+  RC rc = record_page_handler->init(buffer_pool, vacuous_log_handler, log_header.page_num, ReadWriteMode::READ_WRITE);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("fail to init record page handler. page num=%d, rc=%s", log_header.page_num, strrc(rc));
+    return rc;
+  }
+
+  int32_t record_num = 0;
+  memcpy(&record_num, log_header.data, sizeof(record_num));
+  vector<SlotNum> slots(record_num);
+  memcpy(slots.data(), log_header.data + sizeof(record_num), record_num * sizeof(SlotNum));
+  rc = record_page_handler->delete_records(slots);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("fail to recover delete records. page num=%d, rc=%s", log_header.page_num, strrc(rc));
+    return rc;
+  }
+
+  return rc;
+}
+
+RC RecordLogReplayer::replay_move_records(DiskBufferPool &buffer_pool, LSN lsn, const RecordLogHeader &log_header)
+{
+  const char *data        = log_header.data;
+  PageNum     target_page = BP_INVALID_PAGE_NUM;
+  int32_t     record_num  = 0;
+  memcpy(&target_page, data, sizeof(target_page));
+  data += sizeof(target_page);
+  memcpy(&record_num, data, sizeof(record_num));
+  data += sizeof(record_num);
+  vector<SlotNum> slots(record_num);
+  memcpy(slots.data(), data, record_num * sizeof(SlotNum));
+  const char *records = data + record_num * sizeof(SlotNum);
+
+  VacuousLogHandler vacuous_log_handler;
+  for (PageNum page_num : {target_page, log_header.page_num}) {
+    Frame *frame = nullptr;
+    RC     rc    = buffer_pool.get_this_page(page_num, &frame);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("fail to get this page. page num=%d, rc=%s", page_num, strrc(rc));
+      return rc;
+    }
+
+    DEFER(buffer_pool.unpin_page(frame));
+    if (frame->lsn() >= lsn) {
+      LOG_TRACE("page %d has been moved, skip replaying record log. frame lsn %d, log lsn %d", page_num, frame->lsn(), lsn);
+      continue;
+    }
+
+    unique_ptr<RecordPageHandler> record_page_handler(
+        RecordPageHandler::create(StorageFormat(log_header.storage_format)));
+    rc = record_page_handler->init(buffer_pool, vacuous_log_handler, page_num, ReadWriteMode::READ_WRITE);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("fail to init record page handler. page num=%d, rc=%s", page_num, strrc(rc));
+      return rc;
+    }
+
+    if (page_num == target_page) {
+      const char *record = records;
+      for (int32_t i = 0; i < record_num && OB_SUCC(rc); i++, record += record_page_handler->record_log_size(record)) {
+        rc = record_page_handler->insert_record(record, nullptr);
+      }
+    } else {
+      rc = record_page_handler->delete_records(slots);
+    }
+    if (OB_FAIL(rc)) {
+      LOG_WARN("fail to recover move records. page num=%d, rc=%s", page_num, strrc(rc));
+      return rc;
+    }
+
+    frame->set_lsn(lsn);
+  }
+  return RC::SUCCESS;
+}
+
 RC RecordLogReplayer::replay_update(DiskBufferPool &buffer_pool, const RecordLogHeader &header)
 {
   VacuousLogHandler             vacuous_log_handler;
@@ -329,3 +616,30 @@ RC RecordLogReplayer::replay_update(DiskBufferPool &buffer_pool, const RecordLog
 
   return rc;
 }
+
+RC RecordLogReplayer::replay_free_space_map(Frame &frame, const RecordLogHeader &header)
+{
+  int32_t value = 0;
+  memcpy(&value, header.data, sizeof(value));
+  if (RecordOperation(header.operation_type).type() == RecordOperation::Type::INIT_FSM_PAGE) {
+    FreeSpaceMap::redo_init_map_page(frame, value);
+  } else {
+    if (header.slot_num < 0 || header.slot_num >= FreeSpaceMap::SLOT_NUM) {
+      LOG_WARN("invalid free space map slot. page num=%d, slot=%d", header.page_num, header.slot_num);
+      return RC::INVALID_ARGUMENT;
+    }
+    FreeSpaceMap::redo_update(frame, header.slot_num, value);
+  }
+  return RC::SUCCESS;
+}
+
+RC RecordLogReplayer::replay_overflow_page(Frame &frame, const RecordLogHeader &header, int data_len)
+{
+  if (data_len < static_cast<int>(sizeof(SlottedOverflowPageHeader)) ||
+      data_len > BP_PAGE_DATA_SIZE - SlottedRecordPageHandler::overflow_page_header_offset()) {
+    LOG_WARN("invalid overflow page log. page num=%d, data length=%d", header.page_num, data_len);
+    return RC::INVALID_ARGUMENT;
+  }
+  SlottedRecordPageHandler::redo_overflow_page(frame, span<const char>(header.data, data_len));
+  return RC::SUCCESS;
+}
@@ -38,10 +38,16 @@ class RecordOperation
 public:
   enum class Type : int32_t
   {
-    INIT_PAGE,  /// 初始化空页面
-    INSERT,     /// 插入一条记录
-    DELETE,     /// 删除一条记录
-    UPDATE      /// 更新一条记录
+    INIT_PAGE,      /// 初始化空页面
+    INSERT,         /// 插入一条记录
+    DELETE,         /// 删除一条记录
+    UPDATE,         /// 更新一条记录
+    INIT_FSM_PAGE,  /// 初始化空闲空间映射页面
+    UPDATE_FSM,     /// 修改空闲空间映射中一个页面的空闲程度
+    INSERT_BATCH,   /// 在一个页面中插入多条记录
+    OVERFLOW_PAGE,  /// 写入一个溢出页面
+    DELETE_BATCH,   /// 在一个页面中删除多条记录
+    MOVE_RECORDS    /// 把一个页面中的多条记录移动到另一个页面
   };
 
 public:
@@ -97,17 +103,28 @@ public:
    * 或者页面在访问时会出现异常。
    * @param frame 页帧
    * @param page_num 页面编号
-   * @param data 页面数据目前主要是 `column index`
+   * @param column_num 页面中的列数，只有PAX格式的页面不为0
+   * @param data 页面数据目前主要是 `column index` 和每列的类型
    */
-  RC init_new_page(Frame *frame, PageNum page_num, span<const char> data);
+  RC init_new_page(Frame *frame, PageNum page_num, int column_num, span<const char> data);
 
   /**
    * @brief 插入一条记录
    * @param frame 页帧
    * @param rid 记录的位置
-   * @param record 记录的内容
+   * @param record 记录的内容。SLOTTED 格式中是变长的 SlottedRow，其它格式的长度都是 record_size
    */
-  RC insert_record(Frame *frame, const RID &rid, const char *record);
+  RC insert_record(Frame *frame, const RID &rid, span<const char> record);
+
+  /**
+   * @brief 在同一个页面中插入多条记录，只记录一条日志
+   * @details 日志中只记录插入的记录内容，不记录位置。重放时按照顺序逐条插入，
+   * 页面选择槽位的方式是确定的，所以与原来的位置相同。
+   * @param frame 页帧
+   * @param page_num 页面编号
+   * @param records 按照插入顺序排列的记录
+   */
+  RC insert_records(Frame *frame, PageNum page_num, span<const span<const char>> records);
 
   /**
    * @brief 删除一条记录
@@ -116,14 +133,62 @@ public:
    */
   RC delete_record(Frame *frame, const RID &rid);
 
+  /**
+   * @brief 在同一个页面中删除多条记录，只记录一条日志
+   * @param frame 页帧
+   * @param page_num 页面编号
+   * @param slots 删除的记录的槽位
+   */
+  RC delete_records(Frame *frame, PageNum page_num, span<const SlotNum> slots);
+
+  /**
+   * @brief 把 source 页面中的多条记录移动到 target 页面中，只记录一条日志
+   * @details 日志同时修改两个页面，重放时每个页面分别根据自己的LSN判断是否需要重放，
+   * 所以崩溃后不会出现记录在两个页面中都存在或者都不存在的情况。
+   * 与 insert_records 一样，日志中不记录记录在 target 页面中的位置，按照顺序插入就会得到同样的位置。
+   * @param source 记录原来所在页面的页帧
+   * @param target 记录移动到的页面的页帧
+   * @param slots 记录在 source 页面中的槽位
+   * @param records 记录在页面中存放的内容，与 insert_record 相同
+   */
+  RC move_records(Frame *source, Frame *target, span<const SlotNum> slots, span<const span<const char>> records);
+
   /**
    * @brief 更新一条记录
    * @param frame 页帧
    * @param rid 记录的位置
-   * @param record 更新后的记录。不需要做回滚，所以不用记录原先的数据
+   * @param record 更新后的记录，与 insert_record 相同。不需要做回滚，所以不用记录原先的数据
    * @details 更新数据时，通常只更新其中几个字段，这里记录所有数据，是可以优化的。
    */
-  RC update_record(Frame *frame, const RID &rid, const char *record);
+  RC update_record(Frame *frame, const RID &rid, span<const char> record);
+
+  /**
+   * @brief 写入一个溢出页面
+   * @details 溢出页面只会在新分配之后写入一次，日志中记录页面中 PageHeader 之后的全部内容
+   * @param frame 溢出页面的页帧
+   * @param content SlottedOverflowPageHeader 和数据
+   */
+  RC write_overflow_page(Frame *frame, span<const char> content);
+
+  /**
+   * @brief 初始化一个空闲空间映射页面
+   * @param frame 映射页面的页帧
+   * @param page_num 映射页面的编号
+   * @param map_index 第几个映射页面
+   */
+  RC init_map_page(Frame *frame, PageNum page_num, int map_index);
+
+  /**
+   * @brief 修改空闲空间映射中一个页面的空闲程度
+   * @param frame 映射页面的页帧
+   * @param page_num 映射页面的编号
+   * @param slot 数据页面在映射页面中的位置
+   * @param level 空闲程度
+   */
+  RC update_free_space(Frame *frame, PageNum page_num, int slot, int level);
+
+private:
+  RC append_fsm_log(Frame *frame, RecordOperation::Type type, PageNum page_num, int slot, int32_t value);
 
 private:
   LogHandler   *log_handler_    = nullptr;
@@ -147,8 +212,13 @@ public:
 private:
   RC replay_init_page(DiskBufferPool &buffer_pool, const RecordLogHeader &log_header);
   RC replay_insert(DiskBufferPool &buffer_pool, const RecordLogHeader &log_header);
+  RC replay_insert_batch(DiskBufferPool &buffer_pool, const RecordLogHeader &log_header);
   RC replay_delete(DiskBufferPool &buffer_pool, const RecordLogHeader &log_header);
+  RC replay_delete_batch(DiskBufferPool &buffer_pool, const RecordLogHeader &log_header);
+  RC replay_move_records(DiskBufferPool &buffer_pool, LSN lsn, const RecordLogHeader &log_header);
   RC replay_update(DiskBufferPool &buffer_pool, const RecordLogHeader &log_header);
+  RC replay_free_space_map(Frame &frame, const RecordLogHeader &log_header);
+  RC replay_overflow_page(Frame &frame, const RecordLogHeader &log_header, int data_len);
 
 private:
   BufferPoolManager &bpm_;
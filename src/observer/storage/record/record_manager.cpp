@@ -12,6 +12,7 @@ See the Mulan PSL v2 for more details. */
 // Created by Meiyi & Longda on 2021/4/13.
 //
 #include "storage/record/record_manager.h"
+#include "common/lang/algorithm.h"
 #include "common/log/log.h"
 #include "storage/common/condition_filter.h"
 #include "storage/trx/trx.h"
@@ -24,8 +25,10 @@ RecordPageHandler   *RecordPageHandler::create(StorageFormat format)
 {
   if (format == StorageFormat::ROW_FORMAT) {
     return new RowRecordPageHandler();
+  } else if (format == StorageFormat::SLOTTED_FORMAT) {
+    return new SlottedRecordPageHandler();
   } else {
-    return new PaxRecordPageHandler();
+    return new PaxRecordPageHandler(format);
   }
 }
 /**
@@ -40,15 +43,35 @@ int align8(int size) { return (size + 7) & ~7; }
  * @brief 计算指定大小的页面，可以容纳多少个记录
  *
  * @param page_size   页面的大小
+ * @param header_size 页头的大小，参考 RecordPageHandler::page_header_size
  * @param record_size 记录的大小
- * @param fixed_size  除 PAGE_HEADER 外，页面中其余固定长度占用，目前为PAX存储格式中的
- *                    列偏移索引大小（column index）。
+ * @param fixed_size  除页头外，页面中其余固定长度占用，目前为PAX存储格式中的
+ *                    列偏移索引（column index）和 zone map 的大小。
  */
-int page_record_capacity(int page_size, int record_size, int fixed_size)
+int page_record_capacity(int page_size, int header_size, int record_size, int fixed_size)
 {
   // (record_capacity * record_size) + record_capacity/8 + 1 <= (page_size - fix_size)
   // ==> record_capacity = ((page_size - fix_size) - 1) / (record_size + 0.125)
-  return (int)((page_size - PAGE_HEADER_SIZE - fixed_size - 1) / (record_size + 0.125));
+  return (int)((page_size - header_size - fixed_size - 1) / (record_size + 0.125));
+}
+
+/**
+ * @brief PAX 格式的页面中每列固定占用的空间：列偏移索引和 zone map
+ */
+int pax_column_fixed_size(int column_num) { return column_num * (sizeof(int) + sizeof(PaxColumnZoneMap)); }
+
+/**
+ * @brief PAX_COMPRESSED 格式的页面中，编码之后最多可以比不编码多存放几倍的记录，决定了 bitmap 的大小
+ */
+static constexpr int PAX_MAX_COMPRESSION_RATIO = 4;
+
+/**
+ * @brief 计算 PAX_COMPRESSED 格式的页面中，未编码部分最多可以容纳多少个记录
+ * @details 与 page_record_capacity 类似，只是 bitmap 需要按照 PAX_MAX_COMPRESSION_RATIO 倍的记录个数预留
+ */
+int pax_raw_capacity(int page_size, int header_size, int record_size, int fixed_size)
+{
+  return (int)((page_size - header_size - fixed_size - 1) / (record_size + 0.125 * PAX_MAX_COMPRESSION_RATIO));
 }
 
 /**
@@ -67,6 +90,13 @@ string PageHeader::to_string() const
   return ss.str();
 }
 
+string PageHeaderExtension::to_string() const
+{
+  stringstream ss;
+  ss << "raw_capacity:" << raw_capacity << ",encoded_rows:" << encoded_rows << ",encoded_size:" << encoded_size;
+  return ss.str();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 RecordPageIterator::RecordPageIterator()  = default;
 RecordPageIterator::~RecordPageIterator() = default;  
@@ -103,6 +133,18 @@ void RecordPageIterator::clean_record_page_handler_() {
 RecordPageHandler::~RecordPageHandler() { cleanup(); }
 
 RC RecordPageHandler::init(DiskBufferPool &buffer_pool, LogHandler &log_handler, PageNum page_num, ReadWriteMode mode)
+{
+  return init(buffer_pool, log_handler, page_num, mode, true /*wait*/);
+}
+
+RC RecordPageHandler::try_init(
+    DiskBufferPool &buffer_pool, LogHandler &log_handler, PageNum page_num, ReadWriteMode mode)
+{
+  return init(buffer_pool, log_handler, page_num, mode, false /*wait*/);
+}
+
+RC RecordPageHandler::init(
+    DiskBufferPool &buffer_pool, LogHandler &log_handler, PageNum page_num, ReadWriteMode mode, bool wait)
 {
   if (disk_buffer_pool_ != nullptr) {
     if (frame_->page_num() == page_num) {
@@ -123,14 +165,18 @@ RC RecordPageHandler::init(DiskBufferPool &buffer_pool, LogHandler &log_handler,
 
   if (mode == ReadWriteMode::READ_ONLY) {
     frame_->read_latch();
-  } else {
+  } else if (wait) {
     frame_->write_latch();
+  } else if (!frame_->try_write_latch()) {
+    buffer_pool.unpin_page(frame_);
+    frame_ = nullptr;
+    LOG_TRACE("page is locked by others. page_num %d.", page_num);
+    return RC::LOCKED_NEED_WAIT;
   }
   disk_buffer_pool_ = &buffer_pool;
 
-  rw_mode_     = mode;
-  page_header_ = (PageHeader *)(data);
-  bitmap_      = data + PAGE_HEADER_SIZE;
+  rw_mode_ = mode;
+  bind_page_header(data);
 
   (void)log_handler_.init(log_handler, buffer_pool.id(), page_header_->record_real_size, storage_format_);
 
@@ -156,8 +202,7 @@ RC RecordPageHandler::recover_init(DiskBufferPool &buffer_pool, PageNum page_num
   frame_->write_latch();
   disk_buffer_pool_ = &buffer_pool;
   rw_mode_          = ReadWriteMode::READ_WRITE;
-  page_header_      = (PageHeader *)(data);
-  bitmap_           = data + PAGE_HEADER_SIZE;
+  bind_page_header(data);
 
   buffer_pool.recover_page(page_num);
 
@@ -165,50 +210,77 @@ RC RecordPageHandler::recover_init(DiskBufferPool &buffer_pool, PageNum page_num
   return ret;
 }
 
-RC RecordPageHandler::init_empty_page(
-    DiskBufferPool &buffer_pool, LogHandler &log_handler, PageNum page_num, int record_size, TableMeta *table_meta)
+void RecordPageHandler::bind_page_header(char *data)
 {
-  RC rc = init(buffer_pool, log_handler, page_num, ReadWriteMode::READ_WRITE);
-  if (OB_FAIL(rc)) {
-    LOG_ERROR("Failed to init empty page page_num:record_size %d:%d. rc=%s", page_num, record_size, strrc(rc));
-    return rc;
+  page_header_ = (PageHeader *)(data);
+  if (has_header_extension(storage_format_)) {
+    header_ext_ = (PageHeaderExtension *)(data + PAGE_HEADER_SIZE);
+  } else {
+    plain_header_ext_.raw_capacity = page_header_->record_capacity;
+    plain_header_ext_.encoded_rows = 0;
+    plain_header_ext_.encoded_size = 0;
+    header_ext_                    = &plain_header_ext_;
   }
+  bitmap_ = data + page_header_size(storage_format_);
+}
 
-  (void)log_handler_.init(log_handler, buffer_pool.id(), record_size, storage_format_);
+void RecordPageHandler::init_page_header(int record_size, int column_num)
+{
+  const int fixed_size  = pax_column_fixed_size(column_num);
+  const int header_size = page_header_size(storage_format_);
 
-  int column_num = 0;
-  // only pax format need column index
-  if (table_meta != nullptr && storage_format_ == StorageFormat::PAX_FORMAT) {
-    column_num = table_meta->field_num();
-  }
   page_header_->record_num       = 0;
   page_header_->column_num       = column_num;
   page_header_->record_real_size = record_size;
   page_header_->record_size      = align8(record_size);
-  page_header_->record_capacity  = page_record_capacity(
-      BP_PAGE_DATA_SIZE, page_header_->record_size, column_num * sizeof(int) /* other fixed size*/);
-  page_header_->col_idx_offset = align8(PAGE_HEADER_SIZE + page_bitmap_size(page_header_->record_capacity));
-  page_header_->data_offset    = align8(PAGE_HEADER_SIZE + page_bitmap_size(page_header_->record_capacity)) +
-                              column_num * sizeof(int) /* column index*/;
-  this->fix_record_capacity();
-  ASSERT(page_header_->data_offset + page_header_->record_capacity * page_header_->record_size 
+  header_ext_->encoded_rows     = 0;
+  header_ext_->encoded_size     = 0;
+  if (storage_format_ == StorageFormat::PAX_COMPRESSED_FORMAT) {
+    // 编码之后页面可以存放更多的记录，bitmap 需要按照最多可以存放的记录个数预留
+    int raw_capacity = pax_raw_capacity(BP_PAGE_DATA_SIZE, header_size, page_header_->record_size, fixed_size);
+    while (true) {
+      page_header_->record_capacity = raw_capacity * PAX_MAX_COMPRESSION_RATIO;
+      page_header_->col_idx_offset  = align8(header_size + page_bitmap_size(page_header_->record_capacity));
+      page_header_->data_offset     = page_header_->col_idx_offset + fixed_size /* column index and zone maps*/;
+      if (page_header_->data_offset + raw_capacity * page_header_->record_size <= BP_PAGE_DATA_SIZE) {
+        break;
+      }
+      raw_capacity--;
+    }
+    header_ext_->raw_capacity = raw_capacity;
+  } else {
+    page_header_->record_capacity = page_record_capacity(
+        BP_PAGE_DATA_SIZE, header_size, page_header_->record_size, fixed_size /* other fixed size*/);
+    page_header_->col_idx_offset = align8(header_size + page_bitmap_size(page_header_->record_capacity));
+    page_header_->data_offset    = page_header_->col_idx_offset + fixed_size /* column index and zone maps*/;
+    this->fix_record_capacity();
+    header_ext_->raw_capacity = page_header_->record_capacity;
+  }
+  ASSERT(page_header_->data_offset + header_ext_->raw_capacity * page_header_->record_size 
               <= BP_PAGE_DATA_SIZE, 
          "Record overflow the page size");
 
-  bitmap_ = frame_->data() + PAGE_HEADER_SIZE;
+  bitmap_ = frame_->data() + header_size;
   memset(bitmap_, 0, page_bitmap_size(page_header_->record_capacity));
-  // column_index[i] store the end offset of column `i` or the start offset of column `i+1`
-  int *column_index = reinterpret_cast<int *>(frame_->data() + page_header_->col_idx_offset);
-  for (int i = 0; i < column_num; ++i) {
-    ASSERT(i == table_meta->field(i)->field_id(), "i should be the col_id of fields[i]");
-    if (i == 0) {
-      column_index[i] = table_meta->field(i)->len() * page_header_->record_capacity;
-    } else {
-      column_index[i] = table_meta->field(i)->len() * page_header_->record_capacity + column_index[i - 1];
-    }
+}
+
+RC RecordPageHandler::init_empty_page(
+    DiskBufferPool &buffer_pool, LogHandler &log_handler, PageNum page_num, int record_size, TableMeta *table_meta)
+{
+  RC rc = init(buffer_pool, log_handler, page_num, ReadWriteMode::READ_WRITE);
+  if (OB_FAIL(rc)) {
+    LOG_ERROR("Failed to init empty page page_num:record_size %d:%d. rc=%s", page_num, record_size, strrc(rc));
+    return rc;
   }
 
-  rc = log_handler_.init_new_page(frame_, page_num, span((const char *)column_index, column_num * sizeof(int)));
+  (void)log_handler_.init(log_handler, buffer_pool.id(), record_size, storage_format_);
+
+  vector<int> log_data;
+  const int   column_num = init_page_layout(record_size, table_meta, log_data);
+  frame_->mark_dirty();
+
+  rc = log_handler_.init_new_page(
+      frame_, page_num, column_num, span((const char *)log_data.data(), log_data.size() * sizeof(int)));
   if (OB_FAIL(rc)) {
     LOG_ERROR("Failed to init empty page: write log failed. page_num:record_size %d:%d. rc=%s", 
               page_num, record_size, strrc(rc));
@@ -229,35 +301,196 @@ RC RecordPageHandler::init_empty_page(DiskBufferPool &buffer_pool, LogHandler &l
 
   (void)log_handler_.init(log_handler, buffer_pool.id(), record_size, storage_format_);
 
-  page_header_->record_num       = 0;
-  page_header_->column_num       = column_num;
-  page_header_->record_real_size = record_size;
-  page_header_->record_size      = align8(record_size);
-  page_header_->record_capacity =
-      page_record_capacity(BP_PAGE_DATA_SIZE, page_header_->record_size, page_header_->column_num * sizeof(int));
-  page_header_->col_idx_offset = align8(PAGE_HEADER_SIZE + page_bitmap_size(page_header_->record_capacity));
-  page_header_->data_offset    = align8(PAGE_HEADER_SIZE + page_bitmap_size(page_header_->record_capacity)) +
-                              column_num * sizeof(int) /* column index*/;
-  this->fix_record_capacity();
-  ASSERT(page_header_->data_offset + page_header_->record_capacity * page_header_->record_size 
-              <= BP_PAGE_DATA_SIZE, 
-         "Record overflow the page size");
+  init_page_layout(record_size, column_num, col_idx_data);
+  frame_->mark_dirty();
+
+  return RC::SUCCESS;
+}
+
+int RecordPageHandler::init_page_layout(int record_size, TableMeta *table_meta, vector<int> &log_data)
+{
+  int column_num = 0;
+  // only pax format need column index
+  if (table_meta != nullptr && storage_format_ != StorageFormat::ROW_FORMAT) {
+    column_num = table_meta->field_num();
+  }
+  init_page_header(record_size, column_num);
+
+  // column_index[i] store the end offset of column `i` or the start offset of column `i+1`
+  int *column_index = reinterpret_cast<int *>(frame_->data() + page_header_->col_idx_offset);
+  for (int i = 0; i < column_num; ++i) {
+    ASSERT(i == table_meta->field(i)->field_id(), "i should be the col_id of fields[i]");
+    if (i == 0) {
+      column_index[i] = table_meta->field(i)->len() * header_ext_->raw_capacity;
+    } else {
+      column_index[i] = table_meta->field(i)->len() * header_ext_->raw_capacity + column_index[i - 1];
+    }
+  }
+
+  // zone maps 紧跟在列索引之后，日志中记录列索引和每列的类型
+  log_data.assign(column_index, column_index + column_num);
+  PaxColumnZoneMap *zone_maps = reinterpret_cast<PaxColumnZoneMap *>(column_index + column_num);
+  for (int i = 0; i < column_num; ++i) {
+    zone_maps[i].init(table_meta->field(i)->type());
+    log_data.push_back(static_cast<int>(table_meta->field(i)->type()));
+  }
+  return column_num;
+}
+
+void RecordPageHandler::init_page_layout(int record_size, int column_num, const char *col_idx_data)
+{
+  init_page_header(record_size, column_num);
 
-  bitmap_ = frame_->data() + PAGE_HEADER_SIZE;
-  memset(bitmap_, 0, page_bitmap_size(page_header_->record_capacity));
   // column_index[i] store the end offset of column `i` the start offset of column `i+1`
   int *column_index = reinterpret_cast<int *>(frame_->data() + page_header_->col_idx_offset);
   memcpy(column_index, col_idx_data, column_num * sizeof(int));
 
+  // 日志中列索引之后是每列的类型
+  PaxColumnZoneMap *zone_maps = reinterpret_cast<PaxColumnZoneMap *>(column_index + column_num);
+  for (int i = 0; i < column_num; ++i) {
+    int column_type = 0;
+    memcpy(&column_type, col_idx_data + (column_num + i) * sizeof(int), sizeof(int));
+    zone_maps[i].init(static_cast<AttrType>(column_type));
+  }
+}
+
+RC RecordPageHandler::insert_record(const char *data, RID *rid)
+{
+  SlotNum slot = -1;
+  RC      rc   = insert_record_data(data, slot);
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  rc = log_handler_.insert_record(frame_, RID(get_page_num(), slot), span<const char>(data, record_log_size(data)));
+  if (OB_FAIL(rc)) {
+    LOG_ERROR("Failed to insert record. page_num %d:%d. rc=%s", disk_buffer_pool_->file_desc(), frame_->page_num(), strrc(rc));
+    // return rc; // ignore errors
+  }
+
+  if (rid) {
+    rid->page_num = get_page_num();
+    rid->slot_num = slot;
+  }
+  return RC::SUCCESS;
+}
+
+RC RecordPageHandler::insert_records(span<const char *const> records, RID *rids, int &inserted)
+{
+  RC rc    = RC::SUCCESS;
+  inserted = 0;
+  for (const char *data : records) {
+    if (!has_space(data)) {
+      break;
+    }
+
+    SlotNum slot = -1;
+    rc           = insert_record_data(data, slot);
+    if (OB_FAIL(rc)) {
+      break;
+    }
+    rids[inserted].page_num = get_page_num();
+    rids[inserted].slot_num = slot;
+    inserted++;
+  }
+
+  if (inserted > 0) {
+    vector<span<const char>> log_records;
+    log_records.reserve(inserted);
+    for (const char *data : records.first(inserted)) {
+      log_records.emplace_back(data, record_log_size(data));
+    }
+    RC rc2 = log_handler_.insert_records(frame_, get_page_num(), log_records);
+    if (OB_FAIL(rc2)) {
+      LOG_ERROR("Failed to insert records. page_num %d:%d. rc=%s", disk_buffer_pool_->file_desc(), frame_->page_num(), strrc(rc2));
+      // ignore errors, the same as insert_record
+    }
+  }
+  return rc;
+}
+
+RC RecordPageHandler::delete_record(const RID *rid)
+{
+  RC rc = delete_record_data(rid->slot_num);
   if (OB_FAIL(rc)) {
-    LOG_ERROR("Failed to init empty page: write log failed. page_num:record_size %d:%d. rc=%s", 
-              page_num, record_size, strrc(rc));
     return rc;
   }
 
+  rc = log_handler_.delete_record(frame_, *rid);
+  if (OB_FAIL(rc)) {
+    LOG_ERROR("Failed to delete record. page_num %d:%d. rc=%s", disk_buffer_pool_->file_desc(), frame_->page_num(), strrc(rc));
+    // return rc; // ignore errors
+  }
   return RC::SUCCESS;
 }
 
+RC RecordPageHandler::delete_records(span<const SlotNum> slots)
+{
+  RC  rc      = RC::SUCCESS;
+  int deleted = 0;
+  for (SlotNum slot : slots) {
+    rc = delete_record_data(slot);
+    if (OB_FAIL(rc)) {
+      break;
+    }
+    deleted++;
+  }
+
+  if (deleted > 0) {
+    RC rc2 = log_handler_.delete_records(frame_, get_page_num(), slots.first(deleted));
+    if (OB_FAIL(rc2)) {
+      LOG_ERROR("Failed to delete records. page_num %d:%d. rc=%s", disk_buffer_pool_->file_desc(), frame_->page_num(), strrc(rc2));
+      // ignore errors, the same as delete_record
+    }
+  }
+  return rc;
+}
+
+RC RecordPageHandler::move_records(RecordPageHandler &target, span<const SlotNum> slots, RID *new_rids, int &moved)
+{
+  ASSERT(storage_format_ == target.storage_format_, "cannot move records between pages of different formats");
+
+  RC                   rc = RC::SUCCESS;
+  vector<vector<char>> records;
+  moved = 0;
+  for (SlotNum slot : slots) {
+    vector<char> data;
+    rc = export_record(slot, data);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to export record. page num=%d, slot num=%d, rc=%s", get_page_num(), slot, strrc(rc));
+      break;
+    }
+    if (!target.has_space(data.data())) {
+      break;
+    }
+
+    SlotNum new_slot = -1;
+    rc               = target.insert_record_data(data.data(), new_slot);
+    if (OB_FAIL(rc)) {
+      break;
+    }
+    rc = delete_record_data(slot);
+    if (OB_FAIL(rc)) {
+      target.delete_record_data(new_slot);
+      break;
+    }
+
+    new_rids[moved] = RID(target.get_page_num(), new_slot);
+    records.push_back(std::move(data));
+    moved++;
+  }
+
+  if (moved > 0) {
+    vector<span<const char>> log_records(records.begin(), records.end());
+    RC rc2 = log_handler_.move_records(frame_, target.frame_, slots.first(moved), log_records);
+    if (OB_FAIL(rc2)) {
+      LOG_ERROR("Failed to move records. page_num %d:%d. rc=%s", disk_buffer_pool_->file_desc(), frame_->page_num(), strrc(rc2));
+      // ignore errors, the same as insert_records
+    }
+  }
+  return rc;
+}
+
 RC RecordPageHandler::cleanup()
 {
   if (disk_buffer_pool_ != nullptr) {
@@ -273,7 +506,7 @@ RC RecordPageHandler::cleanup()
   return RC::SUCCESS;
 }
 
-RC RowRecordPageHandler::insert_record(const char *data, RID *rid)
+RC RowRecordPageHandler::insert_record_data(const char *data, SlotNum &slot)
 {
   ASSERT(rw_mode_ != ReadWriteMode::READ_ONLY, 
          "cannot insert record into page while the page is readonly");
@@ -289,24 +522,13 @@ RC RowRecordPageHandler::insert_record(const char *data, RID *rid)
   bitmap.set_bit(index);
   page_header_->record_num++;
 
-  RC rc = log_handler_.insert_record(frame_, RID(get_page_num(), index), data);
-  if (OB_FAIL(rc)) {
-    LOG_ERROR("Failed to insert record. page_num %d:%d. rc=%s", disk_buffer_pool_->file_desc(), frame_->page_num(), strrc(rc));
-    // return rc; // ignore errors
-  }
-
   // assert index < page_header_->record_capacity
   char *record_data = get_record_data(index);
   memcpy(record_data, data, page_header_->record_real_size);
 
   frame_->mark_dirty();
 
-  if (rid) {
-    rid->page_num = get_page_num();
-    rid->slot_num = index;
-  }
-
-  // LOG_TRACE("Insert record. rid page_num=%d, slot num=%d", get_page_num(), index);
+  slot = index;
   return RC::SUCCESS;
 }
 
@@ -333,28 +555,33 @@ RC RowRecordPageHandler::recover_insert_record(const char *data, const RID &rid)
   return RC::SUCCESS;
 }
 
-RC RowRecordPageHandler::delete_record(const RID *rid)
+RC RowRecordPageHandler::delete_record_data(SlotNum slot)
 {
   ASSERT(rw_mode_ != ReadWriteMode::READ_ONLY, 
          "cannot delete record from page while the page is readonly");
 
   Bitmap bitmap(bitmap_, page_header_->record_capacity);
-  if (bitmap.get_bit(rid->slot_num)) {
-    bitmap.clear_bit(rid->slot_num);
+  if (slot >= 0 && slot < page_header_->record_capacity && bitmap.get_bit(slot)) {
+    bitmap.clear_bit(slot);
     page_header_->record_num--;
     frame_->mark_dirty();
-
-    RC rc = log_handler_.delete_record(frame_, *rid);
-    if (OB_FAIL(rc)) {
-      LOG_ERROR("Failed to delete record. page_num %d:%d. rc=%s", disk_buffer_pool_->file_desc(), frame_->page_num(), strrc(rc));
-      // return rc; // ignore errors
-    }
-
     return RC::SUCCESS;
   } else {
-    LOG_DEBUG("Invalid slot_num %d, slot is empty, page_num %d.", rid->slot_num, frame_->page_num());
+    LOG_DEBUG("Invalid slot_num %d, slot is empty, page_num %d.", slot, frame_->page_num());
+    return RC::RECORD_NOT_EXIST;
+  }
+}
+
+RC RowRecordPageHandler::export_record(SlotNum slot, vector<char> &data)
+{
+  Bitmap bitmap(bitmap_, page_header_->record_capacity);
+  if (slot < 0 || slot >= page_header_->record_capacity || !bitmap.get_bit(slot)) {
     return RC::RECORD_NOT_EXIST;
   }
+
+  const char *record_data = get_record_data(slot);
+  data.assign(record_data, record_data + page_header_->record_real_size);
+  return RC::SUCCESS;
 }
 
 RC RowRecordPageHandler::update_record(const RID &rid, const char *data)
@@ -378,7 +605,7 @@ RC RowRecordPageHandler::update_record(const RID &rid, const char *data)
       memcpy(record_data, data, page_header_->record_real_size);
     }
 
-    RC rc = log_handler_.update_record(frame_, rid, data);
+    RC rc = log_handler_.update_record(frame_, rid, span<const char>(data, page_header_->record_real_size));
     if (OB_FAIL(rc)) {
       LOG_ERROR("Failed to update record. page_num %d:%d. rc=%s", 
                 disk_buffer_pool_->file_desc(), frame_->page_num(), strrc(rc));
@@ -421,215 +648,1413 @@ PageNum RecordPageHandler::get_page_num() const
 
 bool RecordPageHandler::is_full() const { return page_header_->record_num >= page_header_->record_capacity; }
 
-RC PaxRecordPageHandler::insert_record(const char *data, RID *rid)
+int RecordPageHandler::free_space_level() const
+{
+  return FreeSpaceMap::level_of(is_full(), page_header_->record_num, page_header_->record_capacity);
+}
+
+RC PaxRecordPageHandler::insert_record_data(const char *data, SlotNum &slot)
 {
-  // your code here
-  exit(-1);
+  ASSERT(rw_mode_ != ReadWriteMode::READ_ONLY, 
+         "cannot insert record into page while the page is readonly");
+
+  if (page_header_->record_num == page_header_->record_capacity) {
+    LOG_WARN("Page is full, page_num %d:%d.", disk_buffer_pool_->file_desc(), frame_->page_num());
+    return RC::RECORD_NOMEM;
+  }
+
+  // 找到空闲位置。编码区域中的槽位不会再被使用，只能在未编码的部分中查找
+  int index = next_free_slot();
+  if (index < 0) {
+    LOG_WARN("Page is full, page_num %d:%d.", disk_buffer_pool_->file_desc(), frame_->page_num());
+    return RC::RECORD_NOMEM;
+  }
+  Bitmap bitmap(bitmap_, page_header_->record_capacity);
+  bitmap.set_bit(index);
+  page_header_->record_num++;
+
+  write_record_data(index, data);
+  update_zone_maps(data, true /*add*/);
+  compress_if_full();
+
+  frame_->mark_dirty();
+
+  slot = index;
+  return RC::SUCCESS;
+}
+
+RC PaxRecordPageHandler::recover_insert_record(const char *data, const RID &rid)
+{
+  if (rid.slot_num >= page_header_->record_capacity) {
+    LOG_WARN("slot_num illegal, slot_num(%d) > record_capacity(%d).", rid.slot_num, page_header_->record_capacity);
+    return RC::RECORD_INVALID_RID;
+  }
+
+  if (rid.slot_num < header_ext_->encoded_rows ||
+      rid.slot_num >= header_ext_->encoded_rows + header_ext_->raw_capacity) {
+    LOG_WARN("slot_num illegal, slot_num(%d) is not in the uncompressed part [%d, %d).",
+             rid.slot_num, header_ext_->encoded_rows, header_ext_->encoded_rows + header_ext_->raw_capacity);
+    return RC::RECORD_INVALID_RID;
+  }
+
+  // 更新位图。槽位上已经有数据时，需要先把旧的数据从 zone map 中去掉
+  Bitmap bitmap(bitmap_, page_header_->record_capacity);
+  if (!bitmap.get_bit(rid.slot_num)) {
+    bitmap.set_bit(rid.slot_num);
+    page_header_->record_num++;
+  } else {
+    vector<char> old_data(page_header_->record_real_size);
+    read_record_data(rid.slot_num, old_data.data());
+    update_zone_maps(old_data.data(), false /*add*/);
+  }
+
+  // 恢复数据。与插入时一样，未编码的部分写满之后重新编码
+  write_record_data(rid.slot_num, data);
+  update_zone_maps(data, true /*add*/);
+  compress_if_full();
+
+  frame_->mark_dirty();
+
+  return RC::SUCCESS;
 }
 
-RC PaxRecordPageHandler::delete_record(const RID *rid)
+RC PaxRecordPageHandler::delete_record_data(SlotNum slot)
 {
   ASSERT(rw_mode_ != ReadWriteMode::READ_ONLY, 
          "cannot delete record from page while the page is readonly");
 
   Bitmap bitmap(bitmap_, page_header_->record_capacity);
-  if (bitmap.get_bit(rid->slot_num)) {
-    bitmap.clear_bit(rid->slot_num);
+  if (slot >= 0 && slot < page_header_->record_capacity && bitmap.get_bit(slot)) {
+    vector<char> old_data(page_header_->record_real_size);
+    read_record_data(slot, old_data.data());
+    update_zone_maps(old_data.data(), false /*add*/);
+    bitmap.clear_bit(slot);
     page_header_->record_num--;
     frame_->mark_dirty();
-
-    RC rc = log_handler_.delete_record(frame_, *rid);
-    if (OB_FAIL(rc)) {
-      LOG_ERROR("Failed to delete record. page_num %d:%d. rc=%s", disk_buffer_pool_->file_desc(), frame_->page_num(), strrc(rc));
-      // return rc; // ignore errors
-    }
-
     return RC::SUCCESS;
   } else {
-    LOG_DEBUG("Invalid slot_num %d, slot is empty, page_num %d.", rid->slot_num, frame_->page_num());
+    LOG_DEBUG("Invalid slot_num %d, slot is empty, page_num %d.", slot, frame_->page_num());
+    return RC::RECORD_NOT_EXIST;
+  }
+}
+
+RC PaxRecordPageHandler::export_record(SlotNum slot, vector<char> &data)
+{
+  Bitmap bitmap(bitmap_, page_header_->record_capacity);
+  if (slot < 0 || slot >= page_header_->record_capacity || !bitmap.get_bit(slot)) {
     return RC::RECORD_NOT_EXIST;
   }
+
+  data.resize(page_header_->record_real_size);
+  read_record_data(slot, data.data());
+  return RC::SUCCESS;
 }
 
-RC PaxRecordPageHandler::get_record(const RID &rid, Record &record)
-{
-  // your code here
-  exit(-1);
+RC PaxRecordPageHandler::get_record(const RID &rid, Record &record)
+{
+  if (rid.slot_num >= page_header_->record_capacity) {
+    LOG_ERROR("Invalid slot_num %d, exceed page's record capacity, frame=%s, page_header=%s",
+              rid.slot_num, frame_->to_string().c_str(), page_header_->to_string().c_str());
+    return RC::RECORD_INVALID_RID;
+  }
+
+  Bitmap bitmap(bitmap_, page_header_->record_capacity);
+  if (!bitmap.get_bit(rid.slot_num)) {
+    LOG_ERROR("Invalid slot_num:%d, slot is empty, page_num %d.", rid.slot_num, frame_->page_num());
+    return RC::RECORD_NOT_EXIST;
+  }
+
+  // 列数据在页面中不是连续存放的，所以需要把它们拼起来复制一份
+  RC rc = record.new_record(page_header_->record_real_size);
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  read_record_data(rid.slot_num, record.data());
+  record.set_rid(rid);
+  return RC::SUCCESS;
+}
+
+RC PaxRecordPageHandler::get_chunk(Chunk &chunk)
+{
+  if (page_header_->record_num == 0) {
+    return RC::RECORD_EOF;
+  }
+
+  // 只需要覆盖到最后一个有效的槽位，之后的槽位都是空的
+  Bitmap  bitmap(bitmap_, page_header_->record_capacity);
+  SlotNum last_slot = -1;
+  for (SlotNum slot = bitmap.next_setted_bit(0); slot != -1; slot = bitmap.next_setted_bit(slot + 1)) {
+    last_slot = slot;
+  }
+  // 编码区域总是整体解码，所以至少要覆盖所有编码的记录
+  const int rows = std::max(last_slot + 1, header_ext_->encoded_rows);
+
+  for (int i = 0; i < chunk.column_num(); i++) {
+    const int col_id = chunk.column_ids(i);
+    if (col_id < 0 || col_id >= page_header_->column_num) {
+      LOG_WARN("invalid column id. col_id=%d, column_num=%d", col_id, page_header_->column_num);
+      return RC::INVALID_ARGUMENT;
+    }
+
+    Column &column = chunk.column(i);
+    if (column.attr_len() != get_field_len(col_id)) {
+      LOG_WARN("column length mismatch. col_id=%d, column len=%d, field len=%d",
+               col_id, column.attr_len(), get_field_len(col_id));
+      return RC::INVALID_ARGUMENT;
+    }
+    if (header_ext_->encoded_rows == 0) {
+      column.reference(get_field_data(0, col_id), rows);
+      continue;
+    }
+
+    // 编码的部分需要解码到单独的内存中，同时保留编码数据，过滤和聚合时可以直接使用
+    const int     field_len = get_field_len(col_id);
+    EncodedColumn encoded   = get_encoded_column(col_id);
+    char         *data      = static_cast<char *>(malloc(rows * field_len));
+    if (data == nullptr) {
+      LOG_WARN("failed to allocate memory for column. col_id=%d, rows=%d", col_id, rows);
+      return RC::NOMEM;
+    }
+    encoded.decode(data);
+    memcpy(data + encoded.count() * field_len,
+           get_field_data(header_ext_->encoded_rows, col_id),
+           (rows - encoded.count()) * field_len);
+    column.reference(data, rows);
+    column.set_encoded(encoded);
+    chunk.hold(shared_ptr<void>(data, free));
+  }
+
+  // 被删除的槽位通过选择向量标记出来，而不是把有效的数据复制到一起
+  vector<uint8_t> &select = chunk.select();
+  select.clear();
+  if (page_header_->record_num != rows) {
+    select.resize(rows);
+    for (SlotNum slot = 0; slot < rows; slot++) {
+      select[slot] = bitmap.get_bit(slot) ? 1 : 0;
+    }
+  }
+
+  // 列数据和编码数据直接引用的是页面的内存，Chunk 释放之前页面不能被淘汰
+  DiskBufferPool *buffer_pool = disk_buffer_pool_;
+  Frame          *frame       = frame_;
+  frame->pin();
+  chunk.hold(shared_ptr<void>(frame, [buffer_pool](void *f) { buffer_pool->unpin_page(static_cast<Frame *>(f)); }));
+  return RC::SUCCESS;
+}
+
+bool PaxRecordPageHandler::may_match(const ZoneMapFilter &filter)
+{
+  return filter.may_match(get_zone_maps(), page_header_->column_num);
+}
+
+bool PaxRecordPageHandler::is_full() const { return next_free_slot() < 0; }
+
+int PaxRecordPageHandler::next_free_slot() const
+{
+  Bitmap bitmap(bitmap_, page_header_->record_capacity);
+  int    index = bitmap.next_unsetted_bit(header_ext_->encoded_rows);
+  if (index < 0 || index >= header_ext_->encoded_rows + header_ext_->raw_capacity) {
+    return -1;
+  }
+  return index;
+}
+
+void PaxRecordPageHandler::compress_if_full()
+{
+  if (!compressible() || !is_full()) {
+    return;
+  }
+
+  RC rc = compress();
+  if (OB_FAIL(rc)) {
+    LOG_TRACE("page cannot be compressed any more. page_num=%d, rc=%s", frame_->page_num(), strrc(rc));
+  }
+}
+
+RC PaxRecordPageHandler::compress()
+{
+  if (!compressible()) {
+    return RC::UNSUPPORTED;
+  }
+
+  // 只需要覆盖到最后一个有效的槽位。被删除的槽位也会被编码，但是不会再被使用
+  Bitmap bitmap(bitmap_, page_header_->record_capacity);
+  int    rows = header_ext_->encoded_rows;
+  for (SlotNum slot = bitmap.next_setted_bit(rows); slot != -1; slot = bitmap.next_setted_bit(slot + 1)) {
+    rows = slot + 1;
+  }
+  if (rows == header_ext_->encoded_rows) {
+    return RC::SUCCESS;
+  }
+
+  // 把每一列(包括NULL位图)已经编码的部分和未编码的部分拼起来重新编码
+  const int         phys_num  = physical_column_num();
+  const int         raw_rows  = rows - header_ext_->encoded_rows;
+  PaxColumnZoneMap *zone_maps = get_zone_maps();
+  vector<int>       field_lens(page_header_->column_num);
+  vector<char>      encoded_area(phys_num * sizeof(int32_t));
+  vector<char>      values;
+  for (int i = 0; i < phys_num; i++) {
+    const bool  is_null_bitmap = i == page_header_->column_num;
+    const int   len            = is_null_bitmap ? get_null_bitmap_len() : get_field_len(i);
+    const char *raw_data       = is_null_bitmap ? get_null_bitmap(header_ext_->encoded_rows)
+                                                : get_field_data(header_ext_->encoded_rows, i);
+    AttrType    type = is_null_bitmap ? AttrType::CHARS : static_cast<AttrType>(zone_maps[i].attr_type);
+    if (!is_null_bitmap) {
+      field_lens[i] = len;
+    }
+
+    values.resize(rows * len);
+    if (header_ext_->encoded_rows > 0) {
+      get_encoded_column(i).decode(values.data());
+    }
+    memcpy(values.data() + header_ext_->encoded_rows * len, raw_data, raw_rows * len);
+
+    ColumnEncoder::encode(type, len, values.data(), rows, encoded_area);
+    int32_t end = static_cast<int32_t>(encoded_area.size());
+    memcpy(encoded_area.data() + i * sizeof(int32_t), &end, sizeof(end));
+  }
+
+  // 压缩之后腾出的空间太少时就不再压缩，避免频繁地重新编码
+  const int encoded_size = align8(static_cast<int>(encoded_area.size()));
+  const int free_size    = BP_PAGE_DATA_SIZE - page_header_->data_offset - encoded_size;
+  const int max_raw      = page_header_->record_capacity - rows;
+  const int raw_capacity = std::min(std::max(free_size, 0) / page_header_->record_size, max_raw);
+  if (max_raw <= 0 || raw_capacity < std::min(std::max(1, rows / 16), max_raw)) {
+    LOG_TRACE("no enough space after compressing. page_num=%d, rows=%d, encoded_size=%d, raw_capacity=%d",
+              frame_->page_num(), rows, encoded_size, raw_capacity);
+    return RC::RECORD_NOMEM;
+  }
+
+  memcpy(frame_->data() + page_header_->data_offset, encoded_area.data(), encoded_area.size());
+  header_ext_->encoded_rows = rows;
+  header_ext_->encoded_size = encoded_size;
+  header_ext_->raw_capacity = raw_capacity;
+
+  // 未编码部分的容量变了，每列的位置也要跟着变
+  int *column_index = reinterpret_cast<int *>(frame_->data() + page_header_->col_idx_offset);
+  for (int i = 0; i < page_header_->column_num; i++) {
+    column_index[i] = field_lens[i] * raw_capacity + (i == 0 ? 0 : column_index[i - 1]);
+  }
+
+  frame_->mark_dirty();
+  LOG_TRACE("compress page done. page_num=%d, page_header=%s", frame_->page_num(), page_header_->to_string().c_str());
+  return RC::SUCCESS;
+}
+
+int PaxRecordPageHandler::physical_column_num() { return page_header_->column_num + (get_null_bitmap_len() > 0 ? 1 : 0); }
+
+// 编码区域的格式是 | end offset of each column | column1 | column2 | ... | null bitmaps |
+EncodedColumn PaxRecordPageHandler::get_encoded_column(int phys_col_id)
+{
+  const char *area  = frame_->data() + page_header_->data_offset;
+  int32_t     start = physical_column_num() * sizeof(int32_t);
+  if (phys_col_id > 0) {
+    memcpy(&start, area + (phys_col_id - 1) * sizeof(int32_t), sizeof(start));
+  }
+  return EncodedColumn(area + start);
+}
+
+// 记录的格式是 | null bitmap | column1 | column2 | ... | columnN |，参考 TableMeta
+void PaxRecordPageHandler::write_record_data(SlotNum slot_num, const char *data)
+{
+  const int null_bitmap_len = get_null_bitmap_len();
+  memcpy(get_null_bitmap(slot_num), data, null_bitmap_len);
+  for (int col_id = 0, offset = null_bitmap_len; col_id < page_header_->column_num; col_id++) {
+    int field_len = get_field_len(col_id);
+    memcpy(get_field_data(slot_num, col_id), data + offset, field_len);
+    offset += field_len;
+  }
+}
+
+void PaxRecordPageHandler::read_record_data(SlotNum slot_num, char *data)
+{
+  const int null_bitmap_len = get_null_bitmap_len();
+  if (slot_num < header_ext_->encoded_rows) {
+    if (null_bitmap_len > 0) {
+      get_encoded_column(page_header_->column_num).get(slot_num, data);
+    }
+    for (int col_id = 0, offset = null_bitmap_len; col_id < page_header_->column_num; col_id++) {
+      get_encoded_column(col_id).get(slot_num, data + offset);
+      offset += get_field_len(col_id);
+    }
+    return;
+  }
+
+  memcpy(data, get_null_bitmap(slot_num), null_bitmap_len);
+  for (int col_id = 0, offset = null_bitmap_len; col_id < page_header_->column_num; col_id++) {
+    int field_len = get_field_len(col_id);
+    memcpy(data + offset, get_field_data(slot_num, col_id), field_len);
+    offset += field_len;
+  }
+}
+
+void PaxRecordPageHandler::update_zone_maps(const char *data, bool add)
+{
+  const int         null_bitmap_len = get_null_bitmap_len();
+  Bitmap            null_bitmap(const_cast<char *>(data), null_bitmap_len * 8);
+  PaxColumnZoneMap *zone_maps = get_zone_maps();
+  for (int col_id = 0, offset = null_bitmap_len; col_id < page_header_->column_num; col_id++) {
+    PaxColumnZoneMap &zone_map = zone_maps[col_id];
+    const bool        is_null  = col_id < null_bitmap_len * 8 && null_bitmap.get_bit(col_id);
+    if (is_null) {
+      add ? zone_map.add_null() : zone_map.remove_null();
+    } else if (add) {
+      zone_map.add_value(data + offset);
+    } else {
+      zone_map.remove_value();
+    }
+    offset += get_field_len(col_id);
+  }
+}
+
+PaxColumnZoneMap *PaxRecordPageHandler::get_zone_maps()
+{
+  return reinterpret_cast<PaxColumnZoneMap *>(
+      frame_->data() + page_header_->col_idx_offset + page_header_->column_num * sizeof(int));
+}
+
+char *PaxRecordPageHandler::get_null_bitmap(SlotNum slot_num)
+{
+  int *col_idx = reinterpret_cast<int *>(frame_->data() + page_header_->col_idx_offset);
+  return frame_->data() + raw_data_offset() + col_idx[page_header_->column_num - 1] +
+         get_null_bitmap_len() * (slot_num - header_ext_->encoded_rows);
+}
+
+int PaxRecordPageHandler::get_null_bitmap_len()
+{
+  int *col_idx = reinterpret_cast<int *>(frame_->data() + page_header_->col_idx_offset);
+  return page_header_->record_real_size - col_idx[page_header_->column_num - 1] / header_ext_->raw_capacity;
+}
+
+char *PaxRecordPageHandler::get_field_data(SlotNum slot_num, int col_id)
+{
+  int      *col_idx = reinterpret_cast<int *>(frame_->data() + page_header_->col_idx_offset);
+  const int index   = slot_num - header_ext_->encoded_rows;
+  if (col_id == 0) {
+    return frame_->data() + raw_data_offset() + (get_field_len(col_id) * index);
+  } else {
+    return frame_->data() + raw_data_offset() + col_idx[col_id - 1] + (get_field_len(col_id) * index);
+  }
+}
+
+int PaxRecordPageHandler::get_field_len(int col_id)
+{
+  int *col_idx = reinterpret_cast<int *>(frame_->data() + page_header_->col_idx_offset);
+  if (col_id == 0) {
+    return col_idx[col_id] / header_ext_->raw_capacity;
+  } else {
+    return (col_idx[col_id] - col_idx[col_id - 1]) / header_ext_->raw_capacity;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @brief SLOTTED 格式中每列的描述，没有表的元数据时为空，记录原样存放
+ */
+static void slotted_column_metas(const TableMeta *table_meta, vector<SlottedColumnMeta> &columns)
+{
+  columns.clear();
+  if (table_meta == nullptr) {
+    return;
+  }
+  for (int i = 0; i < table_meta->field_num(); i++) {
+    const FieldMeta *field = table_meta->field(i);
+    columns.push_back(SlottedColumnMeta{field->offset(), field->len(), static_cast<int32_t>(field->type())});
+  }
+}
+
+int SlottedRecordPageHandler::init_page_layout(int record_size, TableMeta *table_meta, vector<int> &log_data)
+{
+  vector<SlottedColumnMeta> columns;
+  slotted_column_metas(table_meta, columns);
+  init_slotted_page(record_size, columns);
+
+  // 日志中记录每列的描述
+  const int *column_data = reinterpret_cast<const int *>(columns.data());
+  log_data.assign(column_data, column_data + columns.size() * sizeof(SlottedColumnMeta) / sizeof(int));
+  return static_cast<int>(columns.size());
+}
+
+void SlottedRecordPageHandler::init_page_layout(int record_size, int column_num, const char *log_data)
+{
+  vector<SlottedColumnMeta> columns(column_num);
+  memcpy(columns.data(), log_data, column_num * sizeof(SlottedColumnMeta));
+  init_slotted_page(record_size, columns);
+}
+
+void SlottedRecordPageHandler::init_slotted_page(int record_size, span<const SlottedColumnMeta> columns)
+{
+  codec_.init(record_size, columns);
+
+  const int column_num = static_cast<int>(columns.size());
+  const int fixed_size = column_num * sizeof(SlottedColumnMeta);
+
+  page_header_->record_num       = 0;
+  page_header_->column_num       = column_num;
+  page_header_->record_real_size = record_size;
+  page_header_->record_size      = record_size;
+  header_ext_->raw_capacity     = 0;
+  header_ext_->encoded_rows     = 0;
+  header_ext_->encoded_size     = 0;
+  page_header_->data_offset      = BP_PAGE_DATA_SIZE;
+
+  // 槽位的个数按照最短的记录计算，槽位目录随着使用的槽位增长，不需要预留
+  const int min_size    = min_entry_size();
+  const int header_size = page_header_size(storage_format_);
+  page_header_->record_capacity = page_record_capacity(BP_PAGE_DATA_SIZE, header_size, min_size, fixed_size);
+  page_header_->col_idx_offset  = align8(header_size + page_bitmap_size(page_header_->record_capacity));
+  while (page_header_->col_idx_offset + fixed_size + page_header_->record_capacity * min_size > BP_PAGE_DATA_SIZE) {
+    page_header_->record_capacity--;
+  }
+
+  bitmap_ = frame_->data() + header_size;
+  memset(bitmap_, 0, page_bitmap_size(page_header_->record_capacity));
+  memcpy(frame_->data() + page_header_->col_idx_offset, columns.data(), fixed_size);
+}
+
+const SlottedRowCodec &SlottedRecordPageHandler::codec() const
+{
+  // 同一个文件中所有数据页面的列描述都相同，所以只在第一次访问时构造
+  if (!codec_.inited() || codec_.record_size() != page_header_->record_real_size) {
+    auto columns = reinterpret_cast<const SlottedColumnMeta *>(frame_->data() + page_header_->col_idx_offset);
+    codec_.init(page_header_->record_real_size, span<const SlottedColumnMeta>(columns, page_header_->column_num));
+  }
+  return codec_;
+}
+
+int SlottedRecordPageHandler::min_entry_size() const
+{
+  const int min_length = max(1, min(codec().min_encoded_size(), static_cast<int>(sizeof(SlottedOverflowRef))));
+  return min_length + static_cast<int>(sizeof(SlotEntry));
+}
+
+SlotNum SlottedRecordPageHandler::next_free_slot() const
+{
+  Bitmap bitmap(bitmap_, page_header_->record_capacity);
+  return bitmap.next_unsetted_bit(0);
+}
+
+bool SlottedRecordPageHandler::is_full() const
+{
+  // 溢出页面的 record_capacity 为0，总是满的
+  return page_header_->record_num >= page_header_->record_capacity || free_bytes() < min_entry_size();
+}
+
+bool SlottedRecordPageHandler::has_space(const char *data) const
+{
+  if (page_header_->record_num >= page_header_->record_capacity) {
+    return false;
+  }
+
+  auto      row        = reinterpret_cast<const SlottedRow *>(data);
+  const int dir_growth = next_free_slot() >= header_ext_->raw_capacity ? sizeof(SlotEntry) : 0;
+  return row->length + dir_growth <= free_bytes();
+}
+
+int SlottedRecordPageHandler::free_space_level() const
+{
+  if (page_header_->record_capacity == 0) {
+    return 0;
+  }
+  const int total_bytes = BP_PAGE_DATA_SIZE - page_header_->col_idx_offset -
+                          page_header_->column_num * static_cast<int>(sizeof(SlottedColumnMeta));
+  return FreeSpaceMap::level_of(is_full(), total_bytes - free_bytes(), total_bytes);
+}
+
+RC SlottedRecordPageHandler::put_entry(SlotNum slot, const SlottedRow &row)
+{
+  const int dir_growth = slot >= header_ext_->raw_capacity
+                             ? (slot + 1 - header_ext_->raw_capacity) * static_cast<int>(sizeof(SlotEntry))
+                             : 0;
+  if (row.length + dir_growth > free_bytes()) {
+    LOG_TRACE("no enough space in page. page_num=%d, length=%d, free=%d", frame_->page_num(), row.length, free_bytes());
+    return RC::RECORD_NOMEM;
+  }
+
+  // 连续的空闲空间不够时整理页面
+  if (slot_directory_end() + dir_growth + row.length > page_header_->data_offset) {
+    compact(slot);
+  }
+
+  // 新的槽位在目录中还没有位置时扩展目录，中间跳过的槽位都是空的
+  header_ext_->raw_capacity = max(header_ext_->raw_capacity, slot + 1);
+  page_header_->data_offset -= row.length;
+  header_ext_->encoded_size += row.length;
+  memcpy(frame_->data() + page_header_->data_offset, row.data, row.length);
+
+  SlotEntry &entry = slot_entries()[slot];
+  entry.offset     = static_cast<uint16_t>(page_header_->data_offset);
+  entry.length     = static_cast<uint16_t>(row.length);
+  entry.overflow   = row.overflow != 0 ? 1 : 0;
+  return RC::SUCCESS;
+}
+
+void SlottedRecordPageHandler::compact(SlotNum skip)
+{
+  SlotEntry      *entries = slot_entries();
+  Bitmap          bitmap(bitmap_, page_header_->record_capacity);
+  vector<SlotNum> slots;
+  for (SlotNum slot = bitmap.next_setted_bit(0); slot != -1; slot = bitmap.next_setted_bit(slot + 1)) {
+    if (slot != skip) {
+      slots.push_back(slot);
+    }
+  }
+
+  // 从最后面的记录开始向页面末尾移动，不会覆盖还没有移动的记录
+  std::sort(slots.begin(), slots.end(), [entries](SlotNum a, SlotNum b) { return entries[a].offset > entries[b].offset; });
+  int end = BP_PAGE_DATA_SIZE;
+  for (SlotNum slot : slots) {
+    SlotEntry &entry = entries[slot];
+    end -= entry.length;
+    memmove(frame_->data() + end, frame_->data() + entry.offset, entry.length);
+    entry.offset = static_cast<uint16_t>(end);
+  }
+  page_header_->data_offset = end;
+}
+
+RC SlottedRecordPageHandler::insert_record_data(const char *data, SlotNum &slot)
+{
+  ASSERT(rw_mode_ != ReadWriteMode::READ_ONLY, 
+         "cannot insert record into page while the page is readonly");
+
+  SlotNum index = next_free_slot();
+  if (index < 0) {
+    LOG_WARN("Page is full, page_num %d:%d.", disk_buffer_pool_->file_desc(), frame_->page_num());
+    return RC::RECORD_NOMEM;
+  }
+
+  RC rc = put_entry(index, *reinterpret_cast<const SlottedRow *>(data));
+  if (OB_FAIL(rc)) {
+    LOG_WARN("Page has no enough space, page_num %d:%d.", disk_buffer_pool_->file_desc(), frame_->page_num());
+    return rc;
+  }
+
+  Bitmap bitmap(bitmap_, page_header_->record_capacity);
+  bitmap.set_bit(index);
+  page_header_->record_num++;
+
+  frame_->mark_dirty();
+
+  slot = index;
+  return RC::SUCCESS;
+}
+
+RC SlottedRecordPageHandler::recover_insert_record(const char *data, const RID &rid)
+{
+  if (rid.slot_num >= page_header_->record_capacity) {
+    LOG_WARN("slot_num illegal, slot_num(%d) > record_capacity(%d).", rid.slot_num, page_header_->record_capacity);
+    return RC::RECORD_INVALID_RID;
+  }
+
+  // 槽位上已经有数据时，先释放它占用的空间
+  Bitmap    bitmap(bitmap_, page_header_->record_capacity);
+  const int old_length = bitmap.get_bit(rid.slot_num) ? slot_entries()[rid.slot_num].length : 0;
+  header_ext_->encoded_size -= old_length;
+
+  RC rc = put_entry(rid.slot_num, *reinterpret_cast<const SlottedRow *>(data));
+  if (OB_FAIL(rc)) {
+    header_ext_->encoded_size += old_length;
+    LOG_WARN("failed to recover record. page_num=%d, slot_num=%d, rc=%s", frame_->page_num(), rid.slot_num, strrc(rc));
+    return rc;
+  }
+
+  if (!bitmap.get_bit(rid.slot_num)) {
+    bitmap.set_bit(rid.slot_num);
+    page_header_->record_num++;
+  }
+
+  frame_->mark_dirty();
+
+  return RC::SUCCESS;
+}
+
+RC SlottedRecordPageHandler::delete_record_data(SlotNum slot)
+{
+  ASSERT(rw_mode_ != ReadWriteMode::READ_ONLY, 
+         "cannot delete record from page while the page is readonly");
+
+  Bitmap bitmap(bitmap_, page_header_->record_capacity);
+  if (slot >= 0 && slot < page_header_->record_capacity && bitmap.get_bit(slot)) {
+    bitmap.clear_bit(slot);
+    page_header_->record_num--;
+    header_ext_->encoded_size -= slot_entries()[slot].length;
+
+    // 收回槽位目录末尾空的槽位。记录占用的空间在整理页面时收回，页面空了就不需要整理了
+    while (header_ext_->raw_capacity > 0 && !bitmap.get_bit(header_ext_->raw_capacity - 1)) {
+      header_ext_->raw_capacity--;
+    }
+    if (page_header_->record_num == 0) {
+      page_header_->data_offset = BP_PAGE_DATA_SIZE;
+    }
+    frame_->mark_dirty();
+    return RC::SUCCESS;
+  } else {
+    LOG_DEBUG("Invalid slot_num %d, slot is empty, page_num %d.", slot, frame_->page_num());
+    return RC::RECORD_NOT_EXIST;
+  }
+}
+
+RC SlottedRecordPageHandler::export_record(SlotNum slot, vector<char> &data)
+{
+  Bitmap bitmap(bitmap_, page_header_->record_capacity);
+  if (slot < 0 || slot >= page_header_->record_capacity || !bitmap.get_bit(slot)) {
+    return RC::RECORD_NOT_EXIST;
+  }
+
+  const SlotEntry &entry = slot_entries()[slot];
+  SlottedRow       row;
+  row.length   = entry.length;
+  row.overflow = entry.overflow;
+  data.resize(sizeof(SlottedRow) + entry.length);
+  memcpy(data.data(), &row, sizeof(SlottedRow));
+  memcpy(data.data() + sizeof(SlottedRow), frame_->data() + entry.offset, entry.length);
+  return RC::SUCCESS;
+}
+
+RC SlottedRecordPageHandler::update_record(const RID &rid, const char *data)
+{
+  ASSERT(rw_mode_ != ReadWriteMode::READ_ONLY, "cannot update record in page while the page is readonly");
+
+  if (rid.slot_num >= page_header_->record_capacity) {
+    LOG_ERROR("Invalid slot_num %d, exceed page's record capacity, frame=%s, page_header=%s",
+              rid.slot_num, frame_->to_string().c_str(), page_header_->to_string().c_str());
+    return RC::INVALID_ARGUMENT;
+  }
+
+  Bitmap bitmap(bitmap_, page_header_->record_capacity);
+  if (!bitmap.get_bit(rid.slot_num)) {
+    LOG_DEBUG("Invalid slot_num %d, slot is empty, page_num %d.", rid.slot_num, frame_->page_num());
+    return RC::RECORD_NOT_EXIST;
+  }
+
+  auto       row   = reinterpret_cast<const SlottedRow *>(data);
+  SlotEntry &entry = slot_entries()[rid.slot_num];
+  if (row->length <= entry.length) {
+    // 原地更新，剩下的空间在整理页面时收回
+    memcpy(frame_->data() + entry.offset, row->data, row->length);
+    header_ext_->encoded_size -= entry.length - row->length;
+    entry.length   = static_cast<uint16_t>(row->length);
+    entry.overflow = row->overflow != 0 ? 1 : 0;
+  } else {
+    const int old_length = entry.length;
+    header_ext_->encoded_size -= old_length;
+    RC rc = put_entry(rid.slot_num, *row);
+    if (OB_FAIL(rc)) {
+      header_ext_->encoded_size += old_length;
+      return rc;
+    }
+  }
+  frame_->mark_dirty();
+
+  RC rc = log_handler_.update_record(frame_, rid, span<const char>(data, row->size()));
+  if (OB_FAIL(rc)) {
+    LOG_ERROR("Failed to update record. page_num %d:%d. rc=%s", 
+              disk_buffer_pool_->file_desc(), frame_->page_num(), strrc(rc));
+    // return rc; // ignore errors
+  }
+  return RC::SUCCESS;
+}
+
+RC SlottedRecordPageHandler::get_record(const RID &rid, Record &record)
+{
+  if (rid.slot_num >= page_header_->record_capacity) {
+    LOG_ERROR("Invalid slot_num %d, exceed page's record capacity, frame=%s, page_header=%s",
+              rid.slot_num, frame_->to_string().c_str(), page_header_->to_string().c_str());
+    return RC::RECORD_INVALID_RID;
+  }
+
+  Bitmap bitmap(bitmap_, page_header_->record_capacity);
+  if (!bitmap.get_bit(rid.slot_num)) {
+    LOG_ERROR("Invalid slot_num:%d, slot is empty, page_num %d.", rid.slot_num, frame_->page_num());
+    return RC::RECORD_NOT_EXIST;
+  }
+
+  const SlotEntry &entry  = slot_entries()[rid.slot_num];
+  const char      *data   = frame_->data() + entry.offset;
+  int              length = entry.length;
+
+  RC           rc = RC::SUCCESS;
+  vector<char> overflow_data;
+  if (entry.overflow) {
+    SlottedOverflowRef ref;
+    memcpy(&ref, data, sizeof(ref));
+    rc = read_overflow_pages(ref, overflow_data);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to read overflow pages. rid=%s, rc=%s", rid.to_string().c_str(), strrc(rc));
+      return rc;
+    }
+    data   = overflow_data.data();
+    length = static_cast<int>(overflow_data.size());
+  }
+
+  rc = record.new_record(page_header_->record_real_size);
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  rc = codec().decode(data, length, record.data());
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to decode record. rid=%s, rc=%s", rid.to_string().c_str(), strrc(rc));
+    return rc;
+  }
+  record.set_rid(rid);
+  return RC::SUCCESS;
+}
+
+bool SlottedRecordPageHandler::overflow_ref(const RID &rid, SlottedOverflowRef &ref)
+{
+  Bitmap bitmap(bitmap_, page_header_->record_capacity);
+  if (rid.slot_num >= page_header_->record_capacity || !bitmap.get_bit(rid.slot_num)) {
+    return false;
+  }
+
+  const SlotEntry &entry = slot_entries()[rid.slot_num];
+  if (!entry.overflow) {
+    return false;
+  }
+  memcpy(&ref, frame_->data() + entry.offset, sizeof(ref));
+  return true;
+}
+
+RC SlottedRecordPageHandler::read_overflow_pages(const SlottedOverflowRef &ref, vector<char> &data)
+{
+  // 持有记录所在页面的锁，溢出页面不会被释放
+  data.clear();
+  data.reserve(ref.total_length);
+  PageNum page_num = ref.first_page;
+  while (page_num != BP_INVALID_PAGE_NUM && static_cast<int>(data.size()) < ref.total_length) {
+    Frame *frame = nullptr;
+    RC     rc    = disk_buffer_pool_->get_this_page(page_num, &frame);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to get overflow page. page_num=%d, rc=%s", page_num, strrc(rc));
+      return rc;
+    }
+
+    frame->read_latch();
+    SlottedOverflowPageHeader header;
+    memcpy(&header, frame->data() + overflow_page_header_offset(), sizeof(header));
+    const bool valid = header.length > 0 && header.length <= overflow_page_data_size();
+    if (valid) {
+      const char *page_data = frame->data() + overflow_page_header_offset() + sizeof(header);
+      data.insert(data.end(), page_data, page_data + header.length);
+    }
+    frame->read_unlatch();
+    disk_buffer_pool_->unpin_page(frame);
+
+    if (!valid) {
+      LOG_WARN("invalid overflow page. page_num=%d, length=%d", page_num, header.length);
+      return RC::INTERNAL;
+    }
+    page_num = header.next_page;
+  }
+
+  if (static_cast<int>(data.size()) != ref.total_length) {
+    LOG_WARN("invalid overflow pages. first page=%d, total length=%d, read length=%d",
+             ref.first_page, ref.total_length, static_cast<int>(data.size()));
+    return RC::INTERNAL;
+  }
+  return RC::SUCCESS;
+}
+
+void SlottedRecordPageHandler::redo_overflow_page(Frame &frame, span<const char> content)
+{
+  memset(frame.data(), 0, overflow_page_header_offset());
+  memcpy(frame.data() + overflow_page_header_offset(), content.data(), content.size());
+  frame.mark_dirty();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+RecordFileHandler::~RecordFileHandler() { this->close(); }
+
+RC RecordFileHandler::init(DiskBufferPool &buffer_pool, LogHandler &log_handler, TableMeta *table_meta)
+{
+  if (disk_buffer_pool_ != nullptr) {
+    LOG_ERROR("record file handler has been openned.");
+    return RC::RECORD_OPENNED;
+  }
+
+  disk_buffer_pool_ = &buffer_pool;
+  log_handler_      = &log_handler;
+  table_meta_       = table_meta;
+
+  // 之前版本创建的表，映射页面的位置上存放的是记录，空闲空间映射只保存在内存中
+  const bool persistent = table_meta == nullptr || table_meta->free_space_map();
+  free_space_map_.init(buffer_pool, log_handler, storage_format_, persistent);
+
+  if (storage_format_ == StorageFormat::SLOTTED_FORMAT && table_meta != nullptr) {
+    vector<SlottedColumnMeta> columns;
+    slotted_column_metas(table_meta, columns);
+    slotted_codec_.init(table_meta->record_size(), columns);
+  }
+
+  LOG_INFO("open record file handle done.");
+  return RC::SUCCESS;
+}
+
+void RecordFileHandler::close()
+{
+  if (disk_buffer_pool_ != nullptr) {
+    free_space_map_.close();
+    free_space_map_loaded_.store(false);
+    insert_hint_.store(BP_INVALID_PAGE_NUM);
+    disk_buffer_pool_ = nullptr;
+    log_handler_      = nullptr;
+    table_meta_       = nullptr;
+  }
+}
+
+RC RecordFileHandler::load_free_space_map()
+{
+  if (free_space_map_loaded_.load()) {
+    return RC::SUCCESS;
+  }
+
+  lock_guard guard(lock_);
+  if (free_space_map_loaded_.load()) {
+    return RC::SUCCESS;
+  }
+
+  vector<int> broken_maps;
+  RC          rc = free_space_map_.load(broken_maps);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to load free space map. rc=%s", strrc(rc));
+    return rc;
+  }
+
+  // 映射页面没有来得及初始化，需要遍历这些映射页面管理的数据页面
+  for (int map_index : broken_maps) {
+    const PageNum map_page_num = FreeSpaceMap::map_page_num(map_index);
+    rc = rebuild_free_space_map(map_page_num + 1, map_page_num + FreeSpaceMap::SLOT_NUM + 1);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to rebuild free space map. map index=%d, rc=%s", map_index, strrc(rc));
+      return rc;
+    }
+  }
+
+  // 没有映射页面的文件，遍历所有的页面
+  if (!free_space_map_.persistent()) {
+    rc = rebuild_free_space_map(1, disk_buffer_pool_->page_count());
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to build free space map in memory. rc=%s", strrc(rc));
+      return rc;
+    }
+  }
+
+  free_space_map_loaded_.store(true);
+  return RC::SUCCESS;
+}
+
+RC RecordFileHandler::rebuild_free_space_map(PageNum begin_page, PageNum end_page)
+{
+  RC rc = RC::SUCCESS;
+
+  const PageNum end_page_num = min(end_page, disk_buffer_pool_->page_count());
+
+  // 整理文件时释放的页面不在 buffer pool 的位图中，它们在新初始化的映射中的等级为0
+  BufferPoolIterator bp_iterator;
+  rc = bp_iterator.init(*disk_buffer_pool_, begin_page);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to init buffer pool iterator. begin page=%d, rc=%s", begin_page, strrc(rc));
+    return rc;
+  }
+
+  unique_ptr<RecordPageHandler> record_page_handler(RecordPageHandler::create(storage_format_));
+  while (bp_iterator.has_next()) {
+    const PageNum page_num = bp_iterator.next();
+    if (page_num >= end_page_num) {
+      break;
+    }
+
+    rc = record_page_handler->init(*disk_buffer_pool_, *log_handler_, page_num, ReadWriteMode::READ_ONLY);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to init record page handler. page num=%d, rc=%s", page_num, strrc(rc));
+      return rc;
+    }
+
+    const int level = record_page_handler->free_space_level();
+    record_page_handler->cleanup();
+
+    rc = free_space_map_.update(page_num, level);
+    if (OB_FAIL(rc)) {
+      return rc;
+    }
+  }
+  LOG_INFO("rebuild free space map done. page num=[%d, %d)", begin_page, end_page_num);
+  return rc;
+}
+
+RC RecordFileHandler::find_free_page(RecordPageHandler &record_page_handler, const char *data, bool &found)
+{
+  found = false;
+
+  // 没有满但是放不下这条记录的页面会一直留在映射中，所以最多查找 FREE_PAGE_SEARCH_ROUNDS 次
+  vector<PageNum> candidates;
+  PageNum         start = insert_hint_.load();
+  for (int round = 0; round < FREE_PAGE_SEARCH_ROUNDS; round++) {
+    candidates.clear();
+    RC rc = free_space_map_.find_pages(start, FREE_PAGE_CANDIDATE_NUM, candidates);
+    if (OB_FAIL(rc) || candidates.empty()) {
+      return rc;
+    }
+    start = candidates.back() + 1;
+
+    // 先尝试没有被其它线程锁住的页面，让并发插入的线程分散到不同的页面上，都被锁住时再等待
+    for (bool wait : {false, true}) {
+      for (PageNum page_num : candidates) {
+        rc = wait ? record_page_handler.init(*disk_buffer_pool_, *log_handler_, page_num, ReadWriteMode::READ_WRITE)
+                  : record_page_handler.try_init(*disk_buffer_pool_, *log_handler_, page_num, ReadWriteMode::READ_WRITE);
+        if (rc == RC::LOCKED_NEED_WAIT) {
+          continue;
+        }
+        if (OB_FAIL(rc)) {
+          LOG_WARN("failed to init record page handler. page num=%d, rc=%s", page_num, strrc(rc));
+          return rc;
+        }
+
+        if (record_page_handler.has_space(data)) {
+          found = true;
+          return RC::SUCCESS;
+        }
+
+        // 映射中的等级只是提示，页面已经满了就修正它
+        rc = record_page_handler.is_full() ? free_space_map_.update(page_num, 0) : RC::SUCCESS;
+        record_page_handler.cleanup();
+        if (OB_FAIL(rc)) {
+          return rc;
+        }
+      }
+    }
+  }
+  return RC::SUCCESS;
+}
+
+RC RecordFileHandler::allocate_frame(Frame *&frame)
+{
+  RC rc = RC::SUCCESS;
+
+  // 分配页面与初始化映射页面需要互斥，保证映射页面在它管理的页面之前初始化
+  lock_guard guard(lock_);
+  while (true) {
+    if ((rc = disk_buffer_pool_->allocate_page(&frame)) != RC::SUCCESS) {
+      LOG_ERROR("Failed to allocate page while inserting record. ret:%d", rc);
+      return rc;
+    }
+
+    if (!is_map_page(frame->page_num())) {
+      return RC::SUCCESS;
+    }
+
+    const PageNum map_page_num = frame->page_num();
+    disk_buffer_pool_->unpin_page(frame);
+    rc = free_space_map_.init_map_page(map_page_num);
+    if (OB_FAIL(rc)) {
+      LOG_ERROR("Failed to init free space map page. page num=%d, rc=%s", map_page_num, strrc(rc));
+      return rc;
+    }
+  }
+}
+
+RC RecordFileHandler::allocate_page(RecordPageHandler &record_page_handler, int record_size)
+{
+  Frame *frame = nullptr;
+  RC     rc    = allocate_frame(frame);
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  rc = record_page_handler.init_empty_page(*disk_buffer_pool_, *log_handler_, frame->page_num(), record_size, table_meta_);
+  // frame 在allocate_page的时候，是有一个pin的，在init_empty_page时又会增加一个，所以这里手动释放一个
+  frame->unpin();
+  if (OB_FAIL(rc)) {
+    LOG_ERROR("Failed to init empty page. ret:%d", rc);
+  }
+  return rc;
+}
+
+RC RecordFileHandler::dispose_page(PageNum page_num)
+{
+  RC rc = free_space_map_.update(page_num, 0);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to update free space level before disposing page. page num=%d, rc=%s", page_num, strrc(rc));
+    return rc;
+  }
+
+  rc = disk_buffer_pool_->dispose_page(page_num);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to dispose page. page num=%d, rc=%s", page_num, strrc(rc));
+    return rc;
+  }
+  LOG_TRACE("dispose empty page %d", page_num);
+  return rc;
+}
+
+RC RecordFileHandler::make_slotted_row(
+    const char *data, int record_size, vector<char> &row, const SlottedOverflowRef *old_ref /*= nullptr*/)
+{
+  row.clear();
+  if (storage_format_ != StorageFormat::SLOTTED_FORMAT) {
+    return RC::SUCCESS;
+  }
+
+  row.resize(sizeof(SlottedRow));
+  if (slotted_codec_.inited()) {
+    slotted_codec_.encode(data, row);
+  } else {
+    row.insert(row.end(), data, data + record_size);
+  }
+
+  auto header      = reinterpret_cast<SlottedRow *>(row.data());
+  header->length   = static_cast<int32_t>(row.size() - sizeof(SlottedRow));
+  header->overflow = 0;
+  if (header->length <= SlottedRecordPageHandler::MAX_INLINE_SIZE) {
+    return RC::SUCCESS;
+  }
+
+  if (old_ref == nullptr || old_ref->total_length != header->length) {
+    return spill_slotted_row(row, record_size);
+  }
+
+  RC rc = rewrite_overflow_pages(old_ref->first_page, header->data, header->length);
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+  row.resize(sizeof(SlottedRow) + sizeof(SlottedOverflowRef));
+  header           = reinterpret_cast<SlottedRow *>(row.data());
+  header->length   = sizeof(SlottedOverflowRef);
+  header->overflow = 1;
+  memcpy(header->data, old_ref, sizeof(SlottedOverflowRef));
+  return RC::SUCCESS;
+}
+
+RC RecordFileHandler::spill_slotted_row(vector<char> &row, int record_size)
+{
+  auto               header = reinterpret_cast<SlottedRow *>(row.data());
+  SlottedOverflowRef ref;
+  ref.total_length = header->length;
+  RC rc            = write_overflow_pages(header->data, header->length, record_size, ref.first_page);
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  row.resize(sizeof(SlottedRow) + sizeof(SlottedOverflowRef));
+  header           = reinterpret_cast<SlottedRow *>(row.data());
+  header->length   = sizeof(SlottedOverflowRef);
+  header->overflow = 1;
+  memcpy(header->data, &ref, sizeof(ref));
+  return RC::SUCCESS;
+}
+
+RC RecordFileHandler::write_overflow_pages(const char *data, int length, int record_size, PageNum &first_page)
+{
+  RC rc = load_free_space_map();
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  RecordLogHandler log_handler;
+  (void)log_handler.init(*log_handler_, disk_buffer_pool_->id(), record_size, storage_format_);
+
+  // 从后向前写，写入每个页面时已经知道了下一个页面
+  const int    page_data_size = SlottedRecordPageHandler::overflow_page_data_size();
+  const int    page_count     = (length + page_data_size - 1) / page_data_size;
+  PageNum      next_page      = BP_INVALID_PAGE_NUM;
+  vector<char> content;
+  for (int i = page_count - 1; i >= 0; i--) {
+    Frame *frame = nullptr;
+    rc           = allocate_frame(frame);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to allocate overflow page. rc=%s", strrc(rc));
+      if (next_page != BP_INVALID_PAGE_NUM) {
+        (void)free_overflow_pages(next_page, record_size);
+      }
+      return rc;
+    }
+
+    const int                 offset = i * page_data_size;
+    SlottedOverflowPageHeader page_header{next_page, min(page_data_size, length - offset)};
+    content.resize(sizeof(page_header) + page_header.length);
+    memcpy(content.data(), &page_header, sizeof(page_header));
+    memcpy(content.data() + sizeof(page_header), data + offset, page_header.length);
+
+    frame->write_latch();
+    SlottedRecordPageHandler::redo_overflow_page(*frame, content);
+    rc = log_handler.write_overflow_page(frame, content);
+    frame->write_unlatch();
+    if (OB_FAIL(rc)) {
+      LOG_ERROR("Failed to write overflow page. page_num %d. rc=%s", frame->page_num(), strrc(rc));
+      // ignore errors, the same as insert_record
+    }
+    next_page = frame->page_num();
+    disk_buffer_pool_->unpin_page(frame);
+  }
+
+  first_page = next_page;
+  return RC::SUCCESS;
 }
 
-// TODO: specify the column_ids that chunk needed. currenly we get all columns
-RC PaxRecordPageHandler::get_chunk(Chunk &chunk)
+RC RecordFileHandler::rewrite_overflow_pages(PageNum first_page, const char *data, int length)
 {
-  // your code here
-  exit(-1);
-}
+  RecordLogHandler log_handler;
+  (void)log_handler.init(*log_handler_, disk_buffer_pool_->id(), 0 /*record_size*/, storage_format_);
+
+  // 持有记录所在页面的写锁，溢出页面不会被其它线程访问。长度相同时每个页面中的数据长度也相同
+  vector<char> content;
+  int          offset   = 0;
+  PageNum      page_num = first_page;
+  while (page_num != BP_INVALID_PAGE_NUM && offset < length) {
+    Frame *frame = nullptr;
+    RC     rc    = disk_buffer_pool_->get_this_page(page_num, &frame);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to get overflow page. page_num=%d, rc=%s", page_num, strrc(rc));
+      return rc;
+    }
 
-char *PaxRecordPageHandler::get_field_data(SlotNum slot_num, int col_id)
-{
-  int *col_idx = reinterpret_cast<int *>(frame_->data() + page_header_->col_idx_offset);
-  if (col_id == 0) {
-    return frame_->data() + page_header_->data_offset + (get_field_len(col_id) * slot_num);
-  } else {
-    return frame_->data() + page_header_->data_offset + col_idx[col_id - 1] + (get_field_len(col_id) * slot_num);
-  }
-}
+    frame->write_latch();
+    SlottedOverflowPageHeader page_header;
+    memcpy(&page_header, frame->data() + SlottedRecordPageHandler::overflow_page_header_offset(), sizeof(page_header));
+    if (page_header.length <= 0 || page_header.length > length - offset) {
+      frame->write_unlatch();
+      disk_buffer_pool_->unpin_page(frame);
+      LOG_WARN("invalid overflow page. page_num=%d, length=%d", page_num, page_header.length);
+      return RC::INTERNAL;
+    }
 
-int PaxRecordPageHandler::get_field_len(int col_id)
-{
-  int *col_idx = reinterpret_cast<int *>(frame_->data() + page_header_->col_idx_offset);
-  if (col_id == 0) {
-    return col_idx[col_id] / page_header_->record_capacity;
-  } else {
-    return (col_idx[col_id] - col_idx[col_id - 1]) / page_header_->record_capacity;
+    content.resize(sizeof(page_header) + page_header.length);
+    memcpy(content.data(), &page_header, sizeof(page_header));
+    memcpy(content.data() + sizeof(page_header), data + offset, page_header.length);
+    SlottedRecordPageHandler::redo_overflow_page(*frame, content);
+    rc = log_handler.write_overflow_page(frame, content);
+    frame->write_unlatch();
+    disk_buffer_pool_->unpin_page(frame);
+    if (OB_FAIL(rc)) {
+      LOG_ERROR("Failed to write overflow page. page_num %d. rc=%s", page_num, strrc(rc));
+      // ignore errors, the same as update_record
+    }
+
+    offset += page_header.length;
+    page_num = page_header.next_page;
   }
+  return RC::SUCCESS;
 }
 
-////////////////////////////////////////////////////////////////////////////////
-
-RecordFileHandler::~RecordFileHandler() { this->close(); }
-
-RC RecordFileHandler::init(DiskBufferPool &buffer_pool, LogHandler &log_handler, TableMeta *table_meta)
+RC RecordFileHandler::free_overflow_pages(PageNum first_page, int record_size)
 {
-  if (disk_buffer_pool_ != nullptr) {
-    LOG_ERROR("record file handler has been openned.");
-    return RC::RECORD_OPENNED;
+  RC rc = load_free_space_map();
+  if (OB_FAIL(rc)) {
+    return rc;
   }
 
-  disk_buffer_pool_ = &buffer_pool;
-  log_handler_      = &log_handler;
-  table_meta_       = table_meta;
+  unique_ptr<RecordPageHandler> record_page_handler(RecordPageHandler::create(storage_format_));
+  PageNum                       page_num = first_page;
+  while (page_num != BP_INVALID_PAGE_NUM) {
+    Frame *frame = nullptr;
+    rc           = disk_buffer_pool_->get_this_page(page_num, &frame);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to get overflow page. page_num=%d, rc=%s", page_num, strrc(rc));
+      return rc;
+    }
+    SlottedOverflowPageHeader page_header;
+    frame->read_latch();
+    memcpy(&page_header, frame->data() + SlottedRecordPageHandler::overflow_page_header_offset(), sizeof(page_header));
+    frame->read_unlatch();
+    disk_buffer_pool_->unpin_page(frame);
 
-  RC rc = init_free_pages();
+    rc = record_page_handler->init_empty_page(*disk_buffer_pool_, *log_handler_, page_num, record_size, table_meta_);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to free overflow page. page_num=%d, rc=%s", page_num, strrc(rc));
+      return rc;
+    }
+    const int level = record_page_handler->free_space_level();
+    record_page_handler->cleanup();
 
-  LOG_INFO("open record file handle done. rc=%s", strrc(rc));
+    rc = free_space_map_.update(page_num, level);
+    if (OB_FAIL(rc)) {
+      return rc;
+    }
+    page_num = page_header.next_page;
+  }
   return RC::SUCCESS;
 }
 
-void RecordFileHandler::close()
+void RecordFileHandler::free_overflow_pages(const vector<char> &row, int record_size)
 {
-  if (disk_buffer_pool_ != nullptr) {
-    free_pages_.clear();
-    disk_buffer_pool_ = nullptr;
-    log_handler_      = nullptr;
-    table_meta_       = nullptr;
+  if (row.empty() || !reinterpret_cast<const SlottedRow *>(row.data())->overflow) {
+    return;
+  }
+
+  SlottedOverflowRef ref;
+  memcpy(&ref, reinterpret_cast<const SlottedRow *>(row.data())->data, sizeof(ref));
+  RC rc = free_overflow_pages(ref.first_page, record_size);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to free overflow pages. first page=%d, rc=%s", ref.first_page, strrc(rc));
   }
 }
 
-RC RecordFileHandler::init_free_pages()
+RC RecordFileHandler::insert_record(const char *data, int record_size, RID *rid)
 {
-  // 遍历当前文件上所有页面，找到没有满的页面
-  // 这个效率很低，会降低启动速度
-  // NOTE: 由于是初始化时的动作，所以不需要加锁控制并发
+  RC ret = load_free_space_map();
+  if (OB_FAIL(ret)) {
+    return ret;
+  }
 
-  RC rc = RC::SUCCESS;
+  // SLOTTED 格式的页面中存放的是编码后的记录
+  vector<char> row;
+  ret = make_slotted_row(data, record_size, row);
+  if (OB_FAIL(ret)) {
+    return ret;
+  }
+  const char *page_data = row.empty() ? data : row.data();
 
-  BufferPoolIterator bp_iterator;
-  bp_iterator.init(*disk_buffer_pool_, 1);
   unique_ptr<RecordPageHandler> record_page_handler(RecordPageHandler::create(storage_format_));
-  PageNum                       current_page_num = 0;
-
-  while (bp_iterator.has_next()) {
-    current_page_num = bp_iterator.next();
-
-    rc = record_page_handler->init(*disk_buffer_pool_, *log_handler_, current_page_num, ReadWriteMode::READ_ONLY);
-    if (rc != RC::SUCCESS) {
-      LOG_WARN("failed to init record page handler. page num=%d, rc=%d:%s", current_page_num, rc, strrc(rc));
-      return rc;
+  bool                          page_found = false;
+
+  // 找到可以放下记录的页面。找到时已经拿到了页面的写锁，找不到就分配一个新的页面
+  int old_level = 0;
+  ret           = find_free_page(*record_page_handler, page_data, page_found);
+  if (OB_SUCC(ret)) {
+    if (page_found) {
+      old_level = record_page_handler->free_space_level();
+    } else {
+      ret = allocate_page(*record_page_handler, record_size);
     }
+  }
 
-    if (!record_page_handler->is_full()) {
-      free_pages_.insert(current_page_num);
-    }
+  // 找到空闲位置
+  if (OB_SUCC(ret)) {
+    ret = record_page_handler->insert_record(page_data, rid);
+  }
+  if (OB_FAIL(ret)) {
     record_page_handler->cleanup();
+    free_overflow_pages(row, record_size);
+    return ret;
   }
-  LOG_INFO("record file handler init free pages done. free page num=%d, rc=%s", free_pages_.size(), strrc(rc));
-  return rc;
+
+  // 持有数据页面的写锁时修改映射，加锁顺序总是先数据页面再映射页面
+  const int new_level = record_page_handler->free_space_level();
+  if (new_level != old_level) {
+    ret = free_space_map_.update(rid->page_num, new_level);
+  }
+  insert_hint_.store(rid->page_num);
+  return ret;
 }
 
-RC RecordFileHandler::insert_record(const char *data, int record_size, RID *rid)
+RC RecordFileHandler::insert_records(span<const char *const> records, int record_size, RID *rids, int &inserted)
 {
-  RC ret = RC::SUCCESS;
-
-  unique_ptr<RecordPageHandler> record_page_handler(RecordPageHandler::create(storage_format_));
-  bool                          page_found       = false;
-  PageNum                       current_page_num = 0;
+  inserted = 0;
 
-  // 当前要访问free_pages对象，所以需要加锁。在非并发编译模式下，不需要考虑这个锁
-  lock_.lock();
+  RC ret = load_free_space_map();
+  if (OB_FAIL(ret)) {
+    return ret;
+  }
 
-  // 找到没有填满的页面
-  while (!free_pages_.empty()) {
-    current_page_num = *free_pages_.begin();
+  // SLOTTED 格式先把所有的记录编码，rows 中是编码后的记录，page_records 指向页面中要存放的数据
+  vector<vector<char>> rows;
+  vector<const char *> page_records(records.begin(), records.end());
+  if (storage_format_ == StorageFormat::SLOTTED_FORMAT) {
+    rows.resize(records.size());
+    for (size_t i = 0; i < records.size(); i++) {
+      ret = make_slotted_row(records[i], record_size, rows[i]);
+      if (OB_FAIL(ret)) {
+        for (size_t j = 0; j < i; j++) {
+          free_overflow_pages(rows[j], record_size);
+        }
+        return ret;
+      }
+      page_records[i] = rows[i].data();
+    }
+  }
 
-    ret = record_page_handler->init(*disk_buffer_pool_, *log_handler_, current_page_num, ReadWriteMode::READ_WRITE);
+  unique_ptr<RecordPageHandler> record_page_handler(RecordPageHandler::create(storage_format_));
+  while (inserted < static_cast<int>(page_records.size())) {
+    bool page_found = false;
+    int  old_level  = 0;
+    ret             = find_free_page(*record_page_handler, page_records[inserted], page_found);
+    if (OB_SUCC(ret)) {
+      if (page_found) {
+        old_level = record_page_handler->free_space_level();
+      } else {
+        ret = allocate_page(*record_page_handler, record_size);
+      }
+    }
     if (OB_FAIL(ret)) {
-      lock_.unlock();
-      LOG_WARN("failed to init record page handler. page num=%d, rc=%d:%s", current_page_num, ret, strrc(ret));
-      return ret;
+      break;
     }
 
-    if (!record_page_handler->is_full()) {
-      page_found = true;
+    // 在当前页面上放入尽量多的记录
+    int page_inserted = 0;
+    ret = record_page_handler->insert_records(
+        span<const char *const>(page_records).subspan(inserted), rids + inserted, page_inserted);
+    inserted += page_inserted;
+    if (OB_FAIL(ret)) {
+      LOG_WARN("failed to insert records into page. page num=%d, rc=%s",
+               record_page_handler->get_page_num(), strrc(ret));
       break;
     }
-    record_page_handler->cleanup();
-    free_pages_.erase(free_pages_.begin());
-  }
-  lock_.unlock();  // 如果找到了一个有效的页面，那么此时已经拿到了页面的写锁
-
-  // 找不到就分配一个新的页面
-  if (!page_found) {
-    Frame *frame = nullptr;
-    if ((ret = disk_buffer_pool_->allocate_page(&frame)) != RC::SUCCESS) {
-      LOG_ERROR("Failed to allocate page while inserting record. ret:%d", ret);
-      return ret;
+    if (page_inserted == 0) {
+      LOG_WARN("no record inserted into a free page. page num=%d", record_page_handler->get_page_num());
+      ret = RC::RECORD_NOMEM;
+      break;
     }
 
-    current_page_num = frame->page_num();
-
-    ret = record_page_handler->init_empty_page(
-        *disk_buffer_pool_, *log_handler_, current_page_num, record_size, table_meta_);
-    if (OB_FAIL(ret)) {
-      frame->unpin();
-      LOG_ERROR("Failed to init empty page. ret:%d", ret);
-      // this is for allocate_page
-      return ret;
+    const PageNum page_num  = record_page_handler->get_page_num();
+    const int     new_level = record_page_handler->free_space_level();
+    if (new_level != old_level) {
+      ret = free_space_map_.update(page_num, new_level);
+      if (OB_FAIL(ret)) {
+        break;
+      }
     }
-
-    // frame 在allocate_page的时候，是有一个pin的，在init_empty_page时又会增加一个，所以这里手动释放一个
-    frame->unpin();
-
-    // 这里的加锁顺序看起来与上面是相反的，但是不会出现死锁
-    // 上面的逻辑是先加lock锁，然后加页面写锁，这里是先加上
-    // 了页面写锁，然后加lock的锁，但是不会引起死锁。
-    // 为什么？
-    lock_.lock();
-    free_pages_.insert(current_page_num);
-    lock_.unlock();
+    insert_hint_.store(page_num);
+    record_page_handler->cleanup();
   }
 
-  // 找到空闲位置
-  return record_page_handler->insert_record(data, rid);
+  // 已经插入的记录不会回滚，没有插入的记录需要释放溢出页面
+  if (OB_FAIL(ret)) {
+    record_page_handler->cleanup();
+    for (size_t i = inserted; i < rows.size(); i++) {
+      free_overflow_pages(rows[i], record_size);
+    }
+  }
+  return ret;
 }
 
 RC RecordFileHandler::recover_insert_record(const char *data, int record_size, const RID &rid)
 {
   RC ret = RC::SUCCESS;
 
+  vector<char> row;
+  ret = make_slotted_row(data, record_size, row);
+  if (OB_FAIL(ret)) {
+    return ret;
+  }
+
   unique_ptr<RecordPageHandler> record_page_handler(RecordPageHandler::create(storage_format_));
 
   ret = record_page_handler->recover_init(*disk_buffer_pool_, rid.page_num);
   if (OB_FAIL(ret)) {
     LOG_WARN("failed to init record page handler. page num=%d, rc=%s", rid.page_num, strrc(ret));
+    free_overflow_pages(row, record_size);
     return ret;
   }
 
-  return record_page_handler->recover_insert_record(data, rid);
+  ret = record_page_handler->recover_insert_record(row.empty() ? data : row.data(), rid);
+  if (OB_FAIL(ret)) {
+    record_page_handler->cleanup();
+    free_overflow_pages(row, record_size);
+  }
+  return ret;
 }
 
 RC RecordFileHandler::delete_record(const RID *rid)
 {
-  RC rc = RC::SUCCESS;
+  RC rc = load_free_space_map();
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
 
   unique_ptr<RecordPageHandler> record_page_handler(RecordPageHandler::create(storage_format_));
 
@@ -639,19 +2064,202 @@ RC RecordFileHandler::delete_record(const RID *rid)
     return rc;
   }
 
+  const int          old_level   = record_page_handler->free_space_level();
+  const int          record_size = record_page_handler->record_size();
+  SlottedOverflowRef overflow_ref;
+  const bool         overflow = record_page_handler->overflow_ref(*rid, overflow_ref);
+
   rc = record_page_handler->delete_record(rid);
-  // 📢 这里注意要清理掉资源，否则会与insert_record中的加锁顺序冲突而可能出现死锁
-  // delete record的加锁逻辑是拿到页面锁，删除指定记录，然后加上和释放record manager锁
-  // insert record是加上 record manager锁，然后拿到指定页面锁再释放record manager锁
-  record_page_handler->cleanup();
   if (OB_SUCC(rc)) {
-    // 因为这里已经释放了页面锁，并发时，其它线程可能又把该页面填满了，那就不应该再放入 free_pages_
-    // 中。但是这里可以不关心，因为在查找空闲页面时，会自动过滤掉已经满的页面
-    lock_.lock();
-    free_pages_.insert(rid->page_num);
-    LOG_TRACE("add free page %d to free page list", rid->page_num);
-    lock_.unlock();
+    // 与 insert_record 一样，持有数据页面的写锁时修改映射，保证映射与页面的修改顺序一致
+    const int new_level = record_page_handler->free_space_level();
+    if (new_level != old_level) {
+      rc = free_space_map_.update(rid->page_num, new_level);
+      LOG_TRACE("update free space level of page %d to %d", rid->page_num, new_level);
+    }
+  }
+  record_page_handler->cleanup();
+
+  // 记录已经删除，没有其它线程可以访问它的溢出页面了
+  if (OB_SUCC(rc) && overflow) {
+    rc = free_overflow_pages(overflow_ref.first_page, record_size);
+  }
+  return rc;
+}
+
+RC RecordFileHandler::delete_records(span<const RID> rids)
+{
+  RC rc = load_free_space_map();
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  vector<RID> sorted_rids(rids.begin(), rids.end());
+  std::sort(sorted_rids.begin(), sorted_rids.end(), [](const RID &a, const RID &b) { return RID::compare(&a, &b) < 0; });
+
+  unique_ptr<RecordPageHandler> record_page_handler(RecordPageHandler::create(storage_format_));
+  vector<SlotNum>               slots;
+  vector<PageNum>               overflow_pages;
+  for (size_t begin = 0, end = 0; begin < sorted_rids.size() && OB_SUCC(rc); begin = end) {
+    const PageNum page_num = sorted_rids[begin].page_num;
+    slots.clear();
+    for (end = begin; end < sorted_rids.size() && sorted_rids[end].page_num == page_num; end++) {
+      slots.push_back(sorted_rids[end].slot_num);
+    }
+
+    rc = record_page_handler->init(*disk_buffer_pool_, *log_handler_, page_num, ReadWriteMode::READ_WRITE);
+    if (OB_FAIL(rc)) {
+      LOG_ERROR("Failed to init record page handler.page number=%d. rc=%s", page_num, strrc(rc));
+      return rc;
+    }
+
+    const int old_level   = record_page_handler->free_space_level();
+    const int record_size = record_page_handler->record_size();
+    overflow_pages.clear();
+    for (SlotNum slot : slots) {
+      SlottedOverflowRef overflow_ref;
+      if (record_page_handler->overflow_ref(RID(page_num, slot), overflow_ref)) {
+        overflow_pages.push_back(overflow_ref.first_page);
+      }
+    }
+
+    rc = record_page_handler->delete_records(slots);
+    const int new_level = record_page_handler->free_space_level();
+    if (new_level != old_level) {
+      // 部分记录删除失败时也需要修正空闲程度
+      RC rc2 = free_space_map_.update(page_num, new_level);
+      rc     = OB_SUCC(rc) ? rc2 : rc;
+    }
+    record_page_handler->cleanup();
+
+    // 与 delete_record 相同，记录删除之后再释放溢出页面。删除失败时无法确定哪些记录已经删除，溢出页面不再释放
+    for (size_t i = 0; i < overflow_pages.size() && OB_SUCC(rc); i++) {
+      rc = free_overflow_pages(overflow_pages[i], record_size);
+    }
+  }
+
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to delete records. rc=%s", strrc(rc));
+  }
+  return rc;
+}
+
+RC RecordFileHandler::compact(function<RC(const Record &record, const RID &new_rid)> on_move, int &freed_pages)
+{
+  freed_pages = 0;
+
+  RC rc = load_free_space_map();
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  // 所有已经分配的数据页面。映射页面和溢出页面的空闲程度为0，不会参与整理
+  vector<PageNum>    pages;
+  BufferPoolIterator bp_iterator;
+  rc = bp_iterator.init(*disk_buffer_pool_, 1);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to init buffer pool iterator. rc=%s", strrc(rc));
+    return rc;
+  }
+  while (bp_iterator.has_next()) {
+    const PageNum page_num = bp_iterator.next();
+    if (!is_map_page(page_num)) {
+      pages.push_back(page_num);
+    }
+  }
+
+  unique_ptr<RecordPageHandler> source(RecordPageHandler::create(storage_format_));
+  unique_ptr<RecordPageHandler> target(RecordPageHandler::create(storage_format_));
+  vector<SlotNum>               slots;
+  vector<Record>                records;
+  vector<RID>                   new_rids;
+
+  // 从后向前选择要清空的页面，从前向后选择接收记录的页面，两者相遇时就没有可以移动的位置了
+  size_t target_index = 0;
+  for (size_t source_index = pages.size(); source_index > 0 && OB_SUCC(rc); source_index--) {
+    const PageNum page_num = pages[source_index - 1];
+    int           level    = 0;
+    rc                     = free_space_map_.get(page_num, level);
+    if (OB_FAIL(rc) || level != FreeSpaceMap::LEVEL_NUM - 1) {
+      continue;
+    }
+
+    rc = source->init(*disk_buffer_pool_, *log_handler_, page_num, ReadWriteMode::READ_WRITE);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to init record page handler. page num=%d, rc=%s", page_num, strrc(rc));
+      break;
+    }
+
+    // 记录移动之后页面中的数据就无效了，需要复制一份交给 on_move
+    slots.clear();
+    records.clear();
+    RecordPageIterator record_iterator;
+    record_iterator.init(source.get());
+    while (OB_SUCC(rc) && record_iterator.has_next()) {
+      Record record;
+      rc = record_iterator.next(record);
+      if (OB_SUCC(rc)) {
+        rc = record.copy_data(record.data(), record.len());
+      }
+      if (OB_SUCC(rc)) {
+        slots.push_back(record.rid().slot_num);
+        records.push_back(std::move(record));
+      }
+    }
+    new_rids.resize(slots.size());
+
+    size_t done = 0;
+    while (OB_SUCC(rc) && done < slots.size() && target_index + 1 < source_index) {
+      const PageNum target_page  = pages[target_index];
+      int           target_level = 0;
+      rc                         = free_space_map_.get(target_page, target_level);
+      if (OB_FAIL(rc)) {
+        break;
+      }
+      if (target_level == 0) {
+        target_index++;
+        continue;
+      }
+
+      rc = target->init(*disk_buffer_pool_, *log_handler_, target_page, ReadWriteMode::READ_WRITE);
+      if (OB_FAIL(rc)) {
+        LOG_WARN("failed to init record page handler. page num=%d, rc=%s", target_page, strrc(rc));
+        break;
+      }
+
+      int moved = 0;
+      rc        = source->move_records(*target, span<const SlotNum>(slots).subspan(done), new_rids.data() + done, moved);
+      RC rc2    = free_space_map_.update(target_page, target->free_space_level());
+      target->cleanup();
+      rc = OB_SUCC(rc) ? rc2 : rc;
+
+      for (int i = 0; i < moved && OB_SUCC(rc); i++) {
+        rc = on_move(records[done + i], new_rids[done + i]);
+      }
+      done += moved;
+
+      // 目标页面放不下后面的记录了
+      if (done < slots.size()) {
+        target_index++;
+      }
+    }
+
+    const bool empty = source->record_num() == 0;
+    if (!empty) {
+      RC rc2 = free_space_map_.update(page_num, source->free_space_level());
+      rc     = OB_SUCC(rc) ? rc2 : rc;
+    }
+    source->cleanup();
+
+    if (OB_SUCC(rc) && empty) {
+      rc = dispose_page(page_num);
+      if (OB_SUCC(rc)) {
+        freed_pages++;
+      }
+    }
   }
+
+  LOG_INFO("compact record file done. page num=%d, freed pages=%d, rc=%s", (int)pages.size(), freed_pages, strrc(rc));
   return rc;
 }
 
@@ -701,8 +2309,60 @@ RC RecordFileHandler::visit_record(const RID &rid, function<bool(Record &)> upda
   record.set_rid(rid);
 
   bool updated = updater(record);
-  if (updated) {
-    rc = page_handler->update_record(rid, record.data());
+  if (!updated) {
+    return rc;
+  }
+  if (storage_format_ != StorageFormat::SLOTTED_FORMAT) {
+    return page_handler->update_record(rid, record.data());
+  }
+
+  // SLOTTED 格式中更新后的记录长度可能变化，需要处理溢出页面和空闲空间映射
+  SlottedOverflowRef old_ref;
+  const bool         old_overflow = page_handler->overflow_ref(rid, old_ref);
+  const int          old_level    = page_handler->free_space_level();
+
+  vector<char> row;
+  rc = make_slotted_row(record.data(), record.len(), row, old_overflow ? &old_ref : nullptr);
+  if (OB_FAIL(rc)) {
+    return rc;
+  }
+
+  rc = page_handler->update_record(rid, row.data());
+  if (rc == RC::RECORD_NOMEM && !reinterpret_cast<const SlottedRow *>(row.data())->overflow) {
+    // 页面中放不下更新后的记录，把它移到溢出页面中，记录的位置不变
+    rc = spill_slotted_row(row, record.len());
+    if (OB_SUCC(rc)) {
+      rc = page_handler->update_record(rid, row.data());
+    }
+  }
+
+  SlottedOverflowRef new_ref;
+  new_ref.first_page = BP_INVALID_PAGE_NUM;
+  if (reinterpret_cast<const SlottedRow *>(row.data())->overflow) {
+    memcpy(&new_ref, reinterpret_cast<const SlottedRow *>(row.data())->data, sizeof(new_ref));
+  }
+  const bool reused = old_overflow && new_ref.first_page == old_ref.first_page;
+
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to update record. rid=%s, rc=%s", rid.to_string().c_str(), strrc(rc));
+    page_handler->cleanup();
+    if (!reused) {
+      free_overflow_pages(row, record.len());
+    }
+    return rc;
+  }
+
+  const int new_level = page_handler->free_space_level();
+  if (new_level != old_level && OB_SUCC(rc = load_free_space_map())) {
+    rc = free_space_map_.update(rid.page_num, new_level);
+  }
+  page_handler->cleanup();
+
+  if (old_overflow && !reused) {
+    RC rc2 = free_overflow_pages(old_ref.first_page, record.len());
+    if (OB_FAIL(rc2)) {
+      LOG_WARN("failed to free overflow pages. rid=%s, rc=%s", rid.to_string().c_str(), strrc(rc2));
+    }
   }
   return rc;
 }
@@ -722,17 +2382,16 @@ RC RecordFileScanner::open_scan(Table *table, DiskBufferPool &buffer_pool, Trx *
   log_handler_      = &log_handler;
   rw_mode_          = mode;
 
-  RC rc = bp_iterator_.init(buffer_pool, 1);
+  RC rc = bp_iterator_.init(buffer_pool, 1, true /*read_ahead*/);
   if (rc != RC::SUCCESS) {
     LOG_WARN("failed to init bp iterator. rc=%d:%s", rc, strrc(rc));
     return rc;
   }
   condition_filter_ = condition_filter;
-  if (table == nullptr || table->table_meta().storage_format() == StorageFormat::ROW_FORMAT) {
-    record_page_handler_ = new RowRecordPageHandler();
-  } else {
-    record_page_handler_ = new PaxRecordPageHandler();
-  }
+  zone_map_filter_  = ZoneMapFilter();
+  record_page_handler_ =
+      RecordPageHandler::create(table == nullptr ? StorageFormat::ROW_FORMAT : table->table_meta().storage_format());
+  has_map_pages_ = table == nullptr || table->table_meta().free_space_map();
 
   return rc;
 }
@@ -761,12 +2420,19 @@ RC RecordFileScanner::fetch_next_record()
   while (bp_iterator_.has_next()) {
     PageNum page_num = bp_iterator_.next();
     record_page_handler_->cleanup();
+    if (has_map_pages_ && FreeSpaceMap::is_map_page(page_num)) {
+      continue;
+    }
     rc = record_page_handler_->init(*disk_buffer_pool_, *log_handler_, page_num, rw_mode_);
     if (OB_FAIL(rc)) {
       LOG_WARN("failed to init record page handler. page_num=%d, rc=%s", page_num, strrc(rc));
       return rc;
     }
 
+    if (!zone_map_filter_.empty() && !record_page_handler_->may_match(zone_map_filter_)) {
+      continue;
+    }
+
     record_page_iterator_.init(record_page_handler_);
     rc = fetch_next_record_in_page();
     if (rc == RC::SUCCESS || rc != RC::RECORD_EOF) {
@@ -831,8 +2497,14 @@ RC RecordFileScanner::close_scan()
   if (condition_filter_ != nullptr) {
     condition_filter_ = nullptr;
   }
-  
-  record_page_iterator_.clean_record_page_handler_();
+
+  // 还没有访问过任何页面时，record_page_handler_ 没有交给 record_page_iterator_，需要单独释放
+  if (record_page_iterator_.is_valid()) {
+    record_page_iterator_.clean_record_page_handler_();
+  } else {
+    delete record_page_handler_;
+  }
+  record_page_handler_ = nullptr;
 
   return RC::SUCCESS;
 }
@@ -848,6 +2520,15 @@ RC RecordFileScanner::next(Record &record)
   return RC::SUCCESS;
 }
 
+RC RecordFileScanner::set_page_range(PageNum start_page, PageNum end_page)
+{
+  if (disk_buffer_pool_ == nullptr || record_page_iterator_.is_valid()) {
+    LOG_WARN("cannot set page range after scan started or before scan opened");
+    return RC::INTERNAL;
+  }
+  return bp_iterator_.init(*disk_buffer_pool_, start_page, true /*read_ahead*/, end_page);
+}
+
 RC RecordFileScanner::update_current(const Record &record)
 {
   if (record.rid() != next_record_.rid()) {
@@ -874,8 +2555,8 @@ RC ChunkFileScanner::close_scan()
   return RC::SUCCESS;
 }
 
-RC ChunkFileScanner::open_scan_chunk(
-    Table *table, DiskBufferPool &buffer_pool, LogHandler &log_handler, ReadWriteMode mode)
+RC ChunkFileScanner::open_scan_chunk(Table *table, DiskBufferPool &buffer_pool, LogHandler &log_handler,
+    ReadWriteMode mode, const vector<int> &column_ids /*= {}*/)
 {
   close_scan();
 
@@ -883,38 +2564,87 @@ RC ChunkFileScanner::open_scan_chunk(
   disk_buffer_pool_ = &buffer_pool;
   log_handler_      = &log_handler;
   rw_mode_          = mode;
+  column_ids_       = column_ids;
+  zone_map_filter_  = ZoneMapFilter();
+  if (column_ids_.empty() && table != nullptr) {
+    const TableMeta &table_meta = table->table_meta();
+    for (int i = 0; i < table_meta.field_num(); i++) {
+      column_ids_.push_back(table_meta.field(i)->field_id());
+    }
+  }
 
-  RC rc = bp_iterator_.init(buffer_pool, 1);
+  RC rc = bp_iterator_.init(buffer_pool, 1, true /*read_ahead*/);
   if (rc != RC::SUCCESS) {
     LOG_WARN("failed to init bp iterator. rc=%d:%s", rc, strrc(rc));
     return rc;
   }
-  if (table == nullptr || table->table_meta().storage_format() == StorageFormat::ROW_FORMAT) {
-    record_page_handler_ = new RowRecordPageHandler();
-  } else {
-    record_page_handler_ = new PaxRecordPageHandler();
-  }
+  record_page_handler_ =
+      RecordPageHandler::create(table == nullptr ? StorageFormat::ROW_FORMAT : table->table_meta().storage_format());
+  has_map_pages_ = table == nullptr || table->table_meta().free_space_map();
 
   return rc;
 }
 
+RC ChunkFileScanner::set_page_range(PageNum start_page, PageNum end_page)
+{
+  if (disk_buffer_pool_ == nullptr) {
+    LOG_WARN("cannot set page range before scan opened");
+    return RC::INTERNAL;
+  }
+  return bp_iterator_.init(*disk_buffer_pool_, start_page, true /*read_ahead*/, end_page);
+}
+
+RC ChunkFileScanner::init_chunk(Chunk &chunk)
+{
+  if (table_ == nullptr) {
+    LOG_WARN("cannot init chunk without table");
+    return RC::INVALID_ARGUMENT;
+  }
+
+  const TableMeta &table_meta = table_->table_meta();
+  for (int col_id : column_ids_) {
+    // 字段ID就是字段在表中的下标
+    if (col_id < 0 || col_id >= table_meta.field_num()) {
+      LOG_WARN("invalid column id. table=%s, col_id=%d", table_meta.name(), col_id);
+      return RC::INVALID_ARGUMENT;
+    }
+    const FieldMeta *field_meta = table_meta.field(col_id);
+    chunk.add_column(make_unique<Column>(field_meta->type(), field_meta->len(), 0 /*capacity*/), col_id);
+  }
+  return RC::SUCCESS;
+}
+
 RC ChunkFileScanner::next_chunk(Chunk &chunk)
 {
   RC rc = RC::SUCCESS;
 
+  if (chunk.column_num() == 0) {
+    rc = init_chunk(chunk);
+    if (OB_FAIL(rc)) {
+      return rc;
+    }
+  }
+
   while (bp_iterator_.has_next()) {
     PageNum page_num = bp_iterator_.next();
     record_page_handler_->cleanup();
+    if (has_map_pages_ && FreeSpaceMap::is_map_page(page_num)) {
+      continue;
+    }
     rc = record_page_handler_->init(*disk_buffer_pool_, *log_handler_, page_num, rw_mode_);
     if (OB_FAIL(rc)) {
       LOG_WARN("failed to init record page handler. page_num=%d, rc=%s", page_num, strrc(rc));
       return rc;
     }
+    if (!zone_map_filter_.empty() && !record_page_handler_->may_match(zone_map_filter_)) {
+      continue;
+    }
     rc = record_page_handler_->get_chunk(chunk);
     if (rc == RC::SUCCESS) {
       return rc;
     } else if (rc == RC::RECORD_EOF) {
-      break;
+      // 空页面，继续访问下一个页面
+      continue;
     } else {
       LOG_WARN("failed to get chunk from page. page_num=%d, rc=%s", page_num, strrc(rc));
       return rc;
@@ -18,8 +18,11 @@ See the Mulan PSL v2 for more details. */
 #include "common/lang/sstream.h"
 #include "storage/buffer/disk_buffer_pool.h"
 #include "storage/common/chunk.h"
+#include "storage/record/free_space_map.h"
 #include "storage/record/record.h"
 #include "storage/record/record_log.h"
+#include "storage/record/slotted_row.h"
+#include "storage/record/zone_map.h"
 #include "common/types.h"
 
 class LogHandler;
@@ -71,7 +74,22 @@ struct PageHeader
   int32_t record_size;       ///< 每条记录占用实际空间大小(可能对齐)
   int32_t record_capacity;   ///< 最大记录个数
   int32_t col_idx_offset;    ///< 列索引偏移量
-  int32_t data_offset;       ///< 第一条记录的偏移量
+  int32_t data_offset;       ///< 第一条记录的偏移量。SLOTTED 格式中是记录区域的起始位置，记录从页面末尾向前存放
+
+  string to_string() const;
+};
+
+/**
+ * @brief PAX_COMPRESSED 和 SLOTTED 格式的页面在 PageHeader 之后多出的页头信息
+ * @ingroup RecordManager
+ * @details 只有这两种格式的页面中存放这个结构，bitmap 跟在它后面。ROW 和 PAX 格式的页面布局保持不变，
+ * RecordPageHandler 在内存中按照 raw_capacity = record_capacity 构造一个，方便共用 PAX 格式的代码。
+ */
+struct PageHeaderExtension
+{
+  int32_t raw_capacity;  ///< 未编码部分最多可以存放的记录个数。SLOTTED 格式中是槽位目录的长度
+  int32_t encoded_rows;  ///< 已经编码的记录个数，即槽位 [0, encoded_rows) 存放在编码区域中
+  int32_t encoded_size;  ///< 编码区域占用的空间，包括每列的结束偏移量。SLOTTED 格式中是所有记录占用的空间
 
   string to_string() const;
 };
@@ -140,6 +158,12 @@ public:
    */
   RC init(DiskBufferPool &buffer_pool, LogHandler &log_handler, PageNum page_num, ReadWriteMode mode);
 
+  /**
+   * @brief 与 init 相同，但是页面已经被其它线程加写锁时不等待，返回 LOCKED_NEED_WAIT
+   * @details 只有 READ_WRITE 模式不等待，READ_ONLY 模式与 init 相同
+   */
+  RC try_init(DiskBufferPool &buffer_pool, LogHandler &log_handler, PageNum page_num, ReadWriteMode mode);
+
   /**
    * @brief 数据库恢复时，与普通的运行场景有所不同，不做任何并发操作，也不需要加锁
    *
@@ -165,7 +189,7 @@ public:
    * @param page_num    当前处理哪个页面
    * @param record_size 每个记录的大小
    * @param col_num  表中包含的列数
-   * @param col_idx_data 列索引数据
+   * @param col_idx_data 列索引数据，之后是每列的类型(AttrType)
    */
   RC init_empty_page(DiskBufferPool &buffer_pool, LogHandler &log_handler, PageNum page_num, int record_size,
       int col_num, const char *col_idx_data);
@@ -178,10 +202,19 @@ public:
   /**
    * @brief 插入一条记录
    *
-   * @param data 要插入的记录
+   * @param data 要插入的记录。SLOTTED 格式中是 SlottedRow，插入、更新和恢复记录时都是如此
    * @param rid  如果插入成功，通过这个参数返回插入的位置
    */
-  virtual RC insert_record(const char *data, RID *rid) { return RC::UNIMPLEMENTED; }
+  RC insert_record(const char *data, RID *rid);
+
+  /**
+   * @brief 按照顺序插入多条记录，直到页面满了为止
+   * @details 所有插入的记录只记录一条日志
+   * @param records  要插入的记录
+   * @param rids     插入成功的记录的位置，至少要有 records.size() 个
+   * @param inserted 插入成功的记录个数
+   */
+  RC insert_records(span<const char *const> records, RID *rids, int &inserted);
 
   /**
    * @brief 数据库恢复时，在指定位置插入数据
@@ -196,7 +229,25 @@ public:
    *
    * @param rid 要删除的记录标识
    */
-  virtual RC delete_record(const RID *rid) { return RC::UNIMPLEMENTED; }
+  RC delete_record(const RID *rid);
+
+  /**
+   * @brief 删除当前页面中的多条记录，只记录一条日志
+   * @details 中途失败时，已经删除的记录不会恢复
+   * @param slots 要删除的记录的槽位
+   */
+  RC delete_records(span<const SlotNum> slots);
+
+  /**
+   * @brief 按照顺序把当前页面中的记录移动到 target 页面中，直到 target 页面满了为止
+   * @details 两个页面使用同样的存储格式，并且都加了写锁。所有移动的记录只记录一条日志，参考 RecordLogHandler::move_records。
+   * SLOTTED 格式中溢出的记录只移动页面中的 SlottedOverflowRef，溢出页面保持不变。
+   * @param target   记录移动到的页面
+   * @param slots    要移动的记录在当前页面中的槽位
+   * @param new_rids 移动后记录的位置，至少要有 slots.size() 个
+   * @param moved    移动成功的记录个数
+   */
+  RC move_records(RecordPageHandler &target, span<const SlotNum> slots, RID *new_rids, int &moved);
 
   /**
    * @brief
@@ -220,6 +271,12 @@ public:
    */
   virtual RC get_chunk(Chunk &chunk) { return RC::UNIMPLEMENTED; }
 
+  /**
+   * @brief 根据页面中的统计信息判断页面中是否可能有满足条件的记录
+   * @details 返回false时可以跳过整个页面。没有统计信息的页面总是返回true
+   */
+  virtual bool may_match(const ZoneMapFilter &filter) { return true; }
+
   /**
    * @brief 返回该记录页的页号
    */
@@ -228,9 +285,100 @@ public:
   /**
    * @brief 当前页面是否已经没有空闲位置插入新的记录
    */
-  bool is_full() const;
+  virtual bool is_full() const;
+
+  /**
+   * @brief 当前页面是否有足够的空间插入这条记录
+   * @details 定长记录只需要有空闲的槽位
+   */
+  virtual bool has_space(const char *data) const { return !is_full(); }
+
+  /**
+   * @brief 当前页面在空闲空间映射中的空闲程度，参考 FreeSpaceMap
+   */
+  virtual int free_space_level() const;
+
+  /**
+   * @brief 插入或更新记录时，记录在日志中的长度
+   */
+  virtual int record_log_size(const char *data) const { return page_header_->record_real_size; }
+
+  /**
+   * @brief 页面中是否存放了扩展页头 PageHeaderExtension
+   */
+  static bool has_header_extension(StorageFormat format)
+  {
+    return format == StorageFormat::PAX_COMPRESSED_FORMAT || format == StorageFormat::SLOTTED_FORMAT;
+  }
+
+  /**
+   * @brief 页头的大小，bitmap 从这里开始
+   */
+  static int page_header_size(StorageFormat format)
+  {
+    return static_cast<int>(sizeof(PageHeader) + (has_header_extension(format) ? sizeof(PageHeaderExtension) : 0));
+  }
+
+  /**
+   * @brief 记录存放在溢出页面中时返回 true，ref 中是溢出页面的信息
+   */
+  virtual bool overflow_ref(const RID &rid, SlottedOverflowRef &ref) { return false; }
+
+  /**
+   * @brief 页面中定长记录的长度
+   */
+  int record_size() const { return page_header_->record_real_size; }
+
+  /**
+   * @brief 页面中的记录个数
+   */
+  int record_num() const { return page_header_->record_num; }
 
 protected:
+  RC init(DiskBufferPool &buffer_pool, LogHandler &log_handler, PageNum page_num, ReadWriteMode mode, bool wait);
+
+  /**
+   * @brief 在页面中找一个空闲位置存放记录，不记录日志
+   * @param data 要插入的记录
+   * @param slot 插入的位置
+   */
+  virtual RC insert_record_data(const char *data, SlotNum &slot) { return RC::UNIMPLEMENTED; }
+
+  /**
+   * @brief 删除页面中的一条记录，不记录日志
+   */
+  virtual RC delete_record_data(SlotNum slot) { return RC::UNIMPLEMENTED; }
+
+  /**
+   * @brief 复制一条记录在页面中存放的内容，可以直接用 insert_record_data 插入到其它页面中
+   * @details SLOTTED 格式中是 SlottedRow，其它格式中是定长的记录
+   */
+  virtual RC export_record(SlotNum slot, vector<char> &data) { return RC::UNIMPLEMENTED; }
+
+  /**
+   * @brief 初始化页头、bitmap，计算记录个数、列索引和数据的位置
+   * @param column_num 列数，行存格式为0
+   */
+  void init_page_header(int record_size, int column_num);
+
+  /**
+   * @brief 设置页头、扩展页头和 bitmap 的位置
+   */
+  void bind_page_header(char *data);
+
+  /**
+   * @brief 初始化新页面中页头之后的内容
+   * @param[out] log_data 需要记录在日志中的数据，日志回放时传给另一个 init_page_layout
+   * @return 列数
+   */
+  virtual int init_page_layout(int record_size, TableMeta *table_meta, vector<int> &log_data);
+
+  /**
+   * @brief 日志回放时初始化新页面中页头之后的内容
+   */
+  virtual void init_page_layout(int record_size, int column_num, const char *log_data);
+
+
   /**
    * @details
    * 前面在计算record_capacity时并没有考虑对齐，但第一个record需要8字节对齐
@@ -261,9 +409,11 @@ protected:
   RecordLogHandler log_handler_;                 ///< 当前操作的日志处理器
   Frame           *frame_       = nullptr;       ///< 当前操作页面关联的frame(frame的更多概念可以参考buffer pool和frame)
   ReadWriteMode    rw_mode_     = ReadWriteMode::READ_WRITE;  ///< 当前的操作是否都是只读的
-  PageHeader      *page_header_ = nullptr;                    ///< 当前页面上页面头
-  char            *bitmap_      = nullptr;                    ///< 当前页面上record分配状态信息bitmap内存起始位置
-  StorageFormat    storage_format_;
+  PageHeader          *page_header_ = nullptr;  ///< 当前页面上页面头
+  PageHeaderExtension *header_ext_  = nullptr;  ///< 扩展页头，ROW 和 PAX 格式指向 plain_header_ext_
+  PageHeaderExtension  plain_header_ext_{};     ///< ROW 和 PAX 格式的页面中没有扩展页头，在内存中构造
+  char                *bitmap_ = nullptr;       ///< 当前页面上record分配状态信息bitmap内存起始位置
+  StorageFormat        storage_format_;
 
 protected:
   friend class RecordPageIterator;
@@ -284,12 +434,8 @@ class RowRecordPageHandler : public RecordPageHandler
 public:
   RowRecordPageHandler() : RecordPageHandler(StorageFormat::ROW_FORMAT) {}
 
-  virtual RC insert_record(const char *data, RID *rid) override;
-
   virtual RC recover_insert_record(const char *data, const RID &rid) override;
 
-  virtual RC delete_record(const RID *rid) override;
-
   virtual RC update_record(const RID &rid, const char *data) override;
 
   /**
@@ -299,6 +445,138 @@ public:
    * @param record 返回指定的数据。这里不会将数据复制出来，而是使用指针，所以调用者必须保证数据使用期间受到保护
    */
   virtual RC get_record(const RID &rid, Record &record) override;
+
+protected:
+  virtual RC insert_record_data(const char *data, SlotNum &slot) override;
+  virtual RC delete_record_data(SlotNum slot) override;
+  virtual RC export_record(SlotNum slot, vector<char> &data) override;
+};
+
+/**
+ * @brief 负责处理 SLOTTED 格式页面中的各种操作
+ * @ingroup RecordManager
+ * @details 内存中的记录仍然是定长的，只有存放在页面中时才编码成变长的格式(参考 SlottedRowCodec)，
+ * 记录从页面末尾向前存放，通过槽位目录找到每条记录：
+ * @code
+ * | PageHeader | PageHeaderExtension | record allocate bitmap | column metas | slot directory | ... free ... |
+ * |---------------------------------------------------------------------------------------| recordN | ... | record1 |
+ * @endcode
+ * 槽位目录的长度随着使用的槽位增长，每个槽位记录记录的位置和长度。删除或者变长的更新会在记录区域中留下空洞，
+ * 连续的空闲空间不够时把所有的记录移动到页面末尾(compact)。整理的结果只依赖页面上的数据，
+ * 日志回放时会得到同样的页面，不需要单独记录日志。
+ * 超过 MAX_INLINE_SIZE 的记录存放在溢出页面中，页面中只存放 SlottedOverflowRef。溢出页面由 RecordFileHandler
+ * 分配和释放，这里只负责读取。
+ */
+class SlottedRecordPageHandler : public RecordPageHandler
+{
+public:
+  /// 页面中直接存放的记录的最大长度，更长的记录存放在溢出页面中
+  static constexpr int MAX_INLINE_SIZE = BP_PAGE_DATA_SIZE / 4;
+
+  SlottedRecordPageHandler() : RecordPageHandler(StorageFormat::SLOTTED_FORMAT) {}
+
+  virtual RC recover_insert_record(const char *data, const RID &rid) override;
+
+  /**
+   * @brief 更新一条记录
+   * @details 新的记录不比原来长时原地更新，否则重新找一个位置。页面中没有足够的空间时返回 RECORD_NOMEM，页面保持不变
+   */
+  virtual RC update_record(const RID &rid, const char *data) override;
+
+  /**
+   * @brief 获取指定位置的记录数据
+   * @details 记录解码之后复制一份放到 record 中，溢出的记录会读取所有的溢出页面
+   */
+  virtual RC get_record(const RID &rid, Record &record) override;
+
+  virtual bool is_full() const override;
+
+  virtual bool has_space(const char *data) const override;
+
+  /**
+   * @brief 按照剩余的空间计算空闲程度
+   */
+  virtual int free_space_level() const override;
+
+  virtual int record_log_size(const char *data) const override
+  {
+    return reinterpret_cast<const SlottedRow *>(data)->size();
+  }
+
+  virtual bool overflow_ref(const RID &rid, SlottedOverflowRef &ref) override;
+
+  /**
+   * @brief 写入一个溢出页面，PageHeader 和 PageHeaderExtension 全部置为0。也用于日志回放
+   * @param content SlottedOverflowPageHeader 和数据
+   */
+  static void redo_overflow_page(Frame &frame, span<const char> content);
+
+  /// 溢出页面中 SlottedOverflowPageHeader 的位置，跟在 SLOTTED 格式的页头之后
+  static constexpr int overflow_page_header_offset()
+  {
+    return static_cast<int>(sizeof(PageHeader) + sizeof(PageHeaderExtension));
+  }
+
+  /// 每个溢出页面最多可以存放的数据长度
+  static constexpr int overflow_page_data_size()
+  {
+    return BP_PAGE_DATA_SIZE - overflow_page_header_offset() - static_cast<int>(sizeof(SlottedOverflowPageHeader));
+  }
+
+protected:
+  virtual RC insert_record_data(const char *data, SlotNum &slot) override;
+  virtual RC delete_record_data(SlotNum slot) override;
+  virtual RC export_record(SlotNum slot, vector<char> &data) override;
+
+  virtual int  init_page_layout(int record_size, TableMeta *table_meta, vector<int> &log_data) override;
+  virtual void init_page_layout(int record_size, int column_num, const char *log_data) override;
+
+private:
+  struct SlotEntry
+  {
+    uint16_t offset;         ///< 记录在页面中的位置
+    uint16_t length : 15;    ///< 记录在页面中的长度
+    uint16_t overflow : 1;   ///< 记录是否存放在溢出页面中
+  };
+
+  // initialize the header, bitmap and column metas of an empty page
+  void init_slotted_page(int record_size, span<const SlottedColumnMeta> columns);
+
+  // the codec built from the column metas in the page
+  const SlottedRowCodec &codec() const;
+
+  SlotEntry *slot_entries() const
+  {
+    return reinterpret_cast<SlotEntry *>(
+        frame_->data() + page_header_->col_idx_offset + page_header_->column_num * sizeof(SlottedColumnMeta));
+  }
+
+  // end offset of the slot directory
+  int slot_directory_end() const
+  {
+    return static_cast<int>(reinterpret_cast<char *>(slot_entries() + header_ext_->raw_capacity) - frame_->data());
+  }
+
+  // free space in the page, including the holes between records
+  int free_bytes() const { return BP_PAGE_DATA_SIZE - slot_directory_end() - header_ext_->encoded_size; }
+
+  // the minimum space a record takes in the page, including the slot entry
+  int min_entry_size() const;
+
+  // the first free slot, -1 if there is none
+  SlotNum next_free_slot() const;
+
+  // put the record in the free space of the page, compact the page if necessary
+  RC put_entry(SlotNum slot, const SlottedRow &row);
+
+  // move all the records to the end of the page, `skip` is not moved and is released
+  void compact(SlotNum skip = -1);
+
+  // read the encoded record stored in overflow pages
+  RC read_overflow_pages(const SlottedOverflowRef &ref, vector<char> &data);
+
+private:
+  mutable SlottedRowCodec codec_;
 };
 
 /**
@@ -306,27 +584,24 @@ public:
  * @ingroup RecordManager
  * @details PAX 格式实现，当前定长记录模式下每个页面的组织大概是这样的：
  * @code
- * | PageHeader | record allocate bitmap | column index  |
- * |------------|------------------------| ------------- |
- * | column1 | column2 | ..................... | columnN |
+ * | PageHeader | record allocate bitmap | column index  | zone maps |
+ * |------------|------------------------| ------------- | --------- |
+ * | column1 | column2 | ..................... | columnN | null bitmaps |
  * @endcode
+ * 每列有一个 PaxColumnZoneMap，记录这一列在页面中的最小值、最大值和NULL的个数，扫描时用来跳过整个页面。
+ * 记录中除各列之外的部分(NULL位图)按行存放在所有列之后。
+ * PAX_COMPRESSED 格式中，PageHeader 之后是 PageHeaderExtension，所有列之前还有一个编码区域，
+ * 存放槽位 [0, encoded_rows) 的记录，之后的各列只存放未编码的记录。
  * 更多细节可参考：docs/design/miniob-pax-storage.md
  */
 class PaxRecordPageHandler : public RecordPageHandler
 {
 public:
-  PaxRecordPageHandler() : RecordPageHandler(StorageFormat::PAX_FORMAT) {}
+  explicit PaxRecordPageHandler(StorageFormat storage_format = StorageFormat::PAX_FORMAT)
+      : RecordPageHandler(storage_format)
+  {}
 
-  /**
-   * @brief 插入一条记录
-   *
-   * @param data 要插入的记录
-   * @param rid  如果插入成功，通过这个参数返回插入的位置
-   * 注意：需要将record 按列拆分，在 Page 内按 PAX 格式存储。
-   */
-  virtual RC insert_record(const char *data, RID *rid) override;
-
-  virtual RC delete_record(const RID *rid) override;
+  virtual RC recover_insert_record(const char *data, const RID &rid) override;
 
   /**
    * @brief 获取指定位置的记录数据
@@ -340,12 +615,71 @@ public:
   /**
    * @brief 以 Chunk 格式获取整个页面中指定列的所有记录。
    *
-   * @param chunk 由 chunk.column(i).col_id() 指定列。
+   * @param chunk 由 chunk.column_ids(i) 指定列。
+   * @details 不会复制数据，chunk 中的列直接引用页面中对应列的内存，页面中空的槽位在 chunk 的选择向量中标记为无效。
+   * chunk 会持有页面的 pin，直到 chunk 被重置或销毁，但不会持有页面的锁，调用者需要自己保证读取期间页面不被修改。
+   * 页面上没有记录时返回 RECORD_EOF。
    */
   virtual RC get_chunk(Chunk &chunk) override;
 
+  virtual bool may_match(const ZoneMapFilter &filter) override;
+
+  virtual bool is_full() const override;
+
+  /**
+   * @brief 把页面中已有的记录(编码区域和未编码部分)重新编码，腾出未编码部分的空间
+   * @details 只用于 PAX_COMPRESSED 格式。未编码部分写满时自动调用，重新编码的结果只依赖页面上的数据，
+   * 所以日志回放时按同样的顺序插入就会得到同样的页面，不需要单独记录日志。
+   * 压缩后腾出的空间太少时返回 RECORD_NOMEM，页面保持不变。
+   */
+  RC compress();
+
+protected:
+  /**
+   * @brief 需要将 record 按列拆分，在 Page 内按 PAX 格式存储。
+   */
+  virtual RC insert_record_data(const char *data, SlotNum &slot) override;
+  virtual RC delete_record_data(SlotNum slot) override;
+  virtual RC export_record(SlotNum slot, vector<char> &data) override;
+
 private:
-  // get the field data by `slot_num` and `column id`
+  // whether the page can be compressed: only PAX_COMPRESSED pages have room in the bitmap for more records
+  bool compressible() const { return page_header_->record_capacity > header_ext_->raw_capacity; }
+
+  // compress the page if the uncompressed part is full, called after a record is inserted
+  void compress_if_full();
+
+  // the first free slot in the uncompressed part, -1 if there is none
+  int next_free_slot() const;
+
+  // the encoded data of column `phys_col_id`. The null bitmap is the last physical column if any.
+  EncodedColumn get_encoded_column(int phys_col_id);
+
+  // number of physical columns stored in the encoded area: all the columns and the null bitmap
+  int physical_column_num();
+
+  // start offset of the uncompressed part, which follows the encoded area
+  int raw_data_offset() const { return page_header_->data_offset + header_ext_->encoded_size; }
+
+  // write the record `data` into every column of `slot_num`
+  void write_record_data(SlotNum slot_num, const char *data);
+
+  // read the record of `slot_num` from every column into `data`
+  void read_record_data(SlotNum slot_num, char *data);
+
+  // add (or remove) the record `data` to (or from) the zone maps
+  void update_zone_maps(const char *data, bool add);
+
+  // the zone maps of all columns, stored after the column index
+  PaxColumnZoneMap *get_zone_maps();
+
+  // get the null bitmap of the uncompressed record in `slot_num`, stored after all the columns
+  char *get_null_bitmap(SlotNum slot_num);
+
+  // length of the record null bitmap, which is the part of the record not belonging to any column
+  int get_null_bitmap_len();
+
+  // get the field data of the uncompressed record by `slot_num` and `column id`
   char *get_field_data(SlotNum slot_num, int col_id);
 
   // get the field length by `column id`, all columns are fixed length.
@@ -381,6 +715,25 @@ public:
    */
   RC delete_record(const RID *rid);
 
+  /**
+   * @brief 批量删除记录
+   * @details 按照页面分组，每个页面只加一次锁，只记录一条日志。中途失败时，已经删除的记录不会恢复
+   * @param rids 待删除记录的标识符
+   */
+  RC delete_records(span<const RID> rids);
+
+  /**
+   * @brief 整理文件，合并稀疏的页面，把空的页面归还给 buffer pool
+   * @details 从后向前处理几乎是空的页面(空闲程度为 FreeSpaceMap::LEVEL_NUM - 1)，把其中的记录移动到编号更小、
+   * 有空闲位置的页面中，整理之后记录集中在文件的前面，扫描时需要读取的页面更少。
+   * 每次从一个页面向另一个页面移动记录只记录一条日志，崩溃恢复后记录不会丢失也不会重复，参考 RecordPageHandler::move_records。
+   * 记录的位置会改变，调用者需要保证整理期间没有其它线程访问这个文件，也没有活跃的事务引用其中的记录。
+   * @param on_move     每次移动记录之后对每条记录调用，record 是移动之前的记录(包括原来的RID)，new_rid 是新的位置。
+   *                    返回失败时停止整理，已经移动的记录不会恢复
+   * @param freed_pages 归还给 buffer pool 的页面个数
+   */
+  RC compact(function<RC(const Record &record, const RID &new_rid)> on_move, int &freed_pages);
+
   /**
    * @brief 插入一个新的记录到指定文件中，并返回该记录的标识符
    *
@@ -390,6 +743,17 @@ public:
    */
   RC insert_record(const char *data, int record_size, RID *rid);
 
+  /**
+   * @brief 批量插入记录
+   * @details 每个页面只加一次锁，尽量多的放入记录，每个页面只记录一条日志。
+   * 中途失败时，已经插入的记录不会回滚，通过 inserted 返回它们的个数
+   * @param records     要插入的记录
+   * @param record_size 记录大小
+   * @param rids        返回每条记录的标识符，至少要有 records.size() 个
+   * @param inserted    插入成功的记录个数
+   */
+  RC insert_records(span<const char *const> records, int record_size, RID *rids, int &inserted);
+
   /**
    * @brief 数据库恢复时，在指定文件指定位置插入数据
    *
@@ -403,19 +767,104 @@ public:
 
   RC visit_record(const RID &rid, function<bool(Record &)> updater);
 
+  /**
+   * @brief 空闲空间映射，测试使用
+   */
+  FreeSpaceMap &free_space_map() { return free_space_map_; }
+
 private:
   /**
-   * @brief 初始化当前没有填满记录的页面，初始化free_pages_成员
+   * @brief 第一次插入或删除记录时加载空闲空间映射
+   * @details 打开表时还没有回放日志，映射页面可能还不完整，所以不能在 init 中加载
+   */
+  RC load_free_space_map();
+
+  /**
+   * @brief 根据数据页面重新设置 [begin_page, end_page) 范围内所有页面的空闲程度
+   * @details 用于没有初始化成功的映射页面，以及只保存在内存中的空闲空间映射
+   */
+  RC rebuild_free_space_map(PageNum begin_page, PageNum end_page);
+
+  /// 页面是否是数据文件中的映射页面。之前版本创建的文件中没有映射页面
+  bool is_map_page(PageNum page_num) const
+  {
+    return free_space_map_.persistent() && FreeSpaceMap::is_map_page(page_num);
+  }
+
+  /**
+   * @brief 从空闲空间映射中找一个可以放下 data 的页面，找到时 record_page_handler 持有该页面的写锁
+   * @param data 要插入的记录，参考 RecordPageHandler::has_space
+   */
+  RC find_free_page(RecordPageHandler &record_page_handler, const char *data, bool &found);
+
+  /**
+   * @brief 分配并初始化一个新的页面，遇到映射页面的位置时先初始化映射页面
+   */
+  RC allocate_page(RecordPageHandler &record_page_handler, int record_size);
+
+  /**
+   * @brief 分配一个新的页面，跳过映射页面的位置。返回的 frame 持有一个 pin
+   */
+  RC allocate_frame(Frame *&frame);
+
+  /**
+   * @brief 把一个空的数据页面归还给 buffer pool
+   * @details 先在空闲空间映射中把页面标记为没有空闲位置，插入记录时就不会再选择它，然后再释放页面。
+   * 两步之间崩溃时，页面只是不会再被使用，下次整理时还会释放它。调用者不能持有页面的 pin
    */
-  RC init_free_pages();
+  RC dispose_page(PageNum page_num);
+
+  /**
+   * @brief SLOTTED 格式中把定长的记录转换成页面处理器需要的 SlottedRow，其它格式什么都不做(row 为空)
+   * @details 编码后超过 SlottedRecordPageHandler::MAX_INLINE_SIZE 时写入溢出页面，插入失败时需要释放溢出页面。
+   * @param old_ref 更新记录时原来的溢出页面。编码后的长度不变时直接覆盖原来的溢出页面，
+   * 比如事务提交时只修改了记录中的事务字段
+   */
+  RC make_slotted_row(const char *data, int record_size, vector<char> &row, const SlottedOverflowRef *old_ref = nullptr);
+
+  /**
+   * @brief 把直接存放在页面中的 SlottedRow 转换成溢出的记录
+   */
+  RC spill_slotted_row(vector<char> &row, int record_size);
+
+  /**
+   * @brief 写入一条溢出的记录，返回第一个溢出页面
+   */
+  RC write_overflow_pages(const char *data, int length, int record_size, PageNum &first_page);
+
+  /**
+   * @brief 覆盖已有的溢出页面，data 的长度需要与原来的相同
+   */
+  RC rewrite_overflow_pages(PageNum first_page, const char *data, int length);
+
+  /**
+   * @brief 释放溢出页面，把它们重新初始化为空的数据页面
+   * @details 释放的溢出页面通过空闲空间映射重新用来存放记录，整理文件时空的页面才会归还给 buffer pool。
+   * 在删除记录的日志之后、释放溢出页面之前崩溃时，这些溢出页面不会再被使用
+   */
+  RC free_overflow_pages(PageNum first_page, int record_size);
+
+  /**
+   * @brief 释放 make_slotted_row 生成的记录的溢出页面，插入失败时使用
+   */
+  void free_overflow_pages(const vector<char> &row, int record_size);
 
 private:
-  DiskBufferPool        *disk_buffer_pool_ = nullptr;
-  LogHandler            *log_handler_      = nullptr;  ///< 记录日志的处理器
-  unordered_set<PageNum> free_pages_;                  ///< 没有填充满的页面集合
-  common::Mutex          lock_;                        ///< 当编译时增加-DCONCURRENCY=ON 选项时，才会真正的支持并发
-  StorageFormat          storage_format_;
-  TableMeta             *table_meta_;
+  /// 查找有空闲位置的页面时，每次从空闲空间映射中取出的候选页面个数
+  static constexpr int FREE_PAGE_CANDIDATE_NUM = 8;
+
+  /// 查找有空闲位置的页面时，最多取几次候选页面。变长记录可能在没有满的页面中也放不下
+  static constexpr int FREE_PAGE_SEARCH_ROUNDS = 4;
+
+  DiskBufferPool *disk_buffer_pool_ = nullptr;
+  LogHandler     *log_handler_      = nullptr;  ///< 记录日志的处理器
+  FreeSpaceMap    free_space_map_;              ///< 每个页面的空闲程度
+  atomic<bool>    free_space_map_loaded_{false};
+  atomic<PageNum> insert_hint_{BP_INVALID_PAGE_NUM};  ///< 最近插入记录的页面，从这里开始查找空闲页面
+  common::Mutex   lock_;  ///< 加载空闲空间映射和分配页面时使用。当编译时增加-DCONCURRENCY=ON 选项时，才会真正的支持并发
+  StorageFormat   storage_format_;
+  TableMeta      *table_meta_;
+  SlottedRowCodec slotted_codec_;  ///< SLOTTED 格式编码记录使用，没有表的元数据时记录原样存放
 };
 
 /**
@@ -455,6 +904,18 @@ public:
 
   RC update_current(const Record &record);
 
+  /**
+   * @brief 设置页面级别的过滤条件，不可能有满足条件的记录的页面会被跳过
+   * @details 在 open_scan 之后调用。只是跳过页面，页面中的记录仍然需要调用者自己过滤
+   */
+  void set_zone_map_filter(ZoneMapFilter filter) { zone_map_filter_ = std::move(filter); }
+
+  /**
+   * @brief 只遍历 [start_page, end_page) 范围内的页面
+   * @details 在 open_scan 之后、获取第一条记录之前调用。并行扫描时每个线程只遍历文件中的一段页面
+   */
+  RC set_page_range(PageNum start_page, PageNum end_page);
+
 private:
   /**
    * @brief 获取该文件中的下一条记录
@@ -480,6 +941,8 @@ private:
   RecordPageHandler *record_page_handler_ = nullptr;  ///< 处理文件某页面的记录
   RecordPageIterator record_page_iterator_;           ///< 遍历某个页面上的所有record
   Record             next_record_;                    ///< 获取的记录放在这里缓存起来
+  ZoneMapFilter      zone_map_filter_;                ///< 根据页面的统计信息跳过页面
+  bool               has_map_pages_ = true;           ///< 文件中是否有空闲空间映射页面，遍历时跳过它们
 };
 
 /**
@@ -493,8 +956,15 @@ public:
   ChunkFileScanner() = default;
   ~ChunkFileScanner();
 
+  /**
+   * @brief 打开一个文件扫描
+   * @param column_ids 需要读取的列ID。为空时读取表中所有的列
+   * @details 调用 next_chunk 时如果传入的 chunk 中没有任何列，就按照 column_ids 的顺序添加列；
+   * 否则使用 chunk 中已有的列。只有被请求的列才会被读取。
+   */
   // TODO: not support filter and transaction
-  RC open_scan_chunk(Table *table, DiskBufferPool &buffer_pool, LogHandler &log_handler, ReadWriteMode mode);
+  RC open_scan_chunk(Table *table, DiskBufferPool &buffer_pool, LogHandler &log_handler, ReadWriteMode mode,
+      const vector<int> &column_ids = {});
 
   /**
    * @brief 关闭一个文件扫描，释放相应的资源
@@ -506,8 +976,26 @@ public:
    */
   RC next_chunk(Chunk &chunk);
 
+  /**
+   * @brief 设置页面级别的过滤条件，参考 RecordFileScanner::set_zone_map_filter
+   */
+  void set_zone_map_filter(ZoneMapFilter filter) { zone_map_filter_ = std::move(filter); }
+
+  /**
+   * @brief 只遍历 [start_page, end_page) 范围内的页面，参考 RecordFileScanner::set_page_range
+   */
+  RC set_page_range(PageNum start_page, PageNum end_page);
+
+private:
+  /**
+   * @brief 按照 column_ids_ 向空的 chunk 中添加列
+   * @details 列数据由页面处理器填充(PAX格式直接引用页面)，所以这里不需要分配内存
+   */
+  RC init_chunk(Chunk &chunk);
+
 private:
   Table *table_ = nullptr;  ///< 当前遍历的是哪张表。
+  vector<int> column_ids_;  ///< 需要读取的列
 
   DiskBufferPool *disk_buffer_pool_ = nullptr;  ///< 当前访问的文件
   LogHandler     *log_handler_      = nullptr;
@@ -515,4 +1003,6 @@ private:
 
   BufferPoolIterator bp_iterator_;                    ///< 遍历buffer pool的所有页面
   RecordPageHandler *record_page_handler_ = nullptr;  ///< 处理文件某页面的记录
+  ZoneMapFilter      zone_map_filter_;                ///< 根据页面的统计信息跳过页面
+  bool               has_map_pages_ = true;           ///< 文件中是否有空闲空间映射页面，遍历时跳过它们
 };
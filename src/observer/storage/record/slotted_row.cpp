@@ -0,0 +1,89 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <string.h>
+
+#include "storage/record/slotted_row.h"
+#include "common/lang/algorithm.h"
+#include "common/log/log.h"
+#include "common/type/attr_type.h"
+
+void SlottedRowCodec::init(int record_size, span<const SlottedColumnMeta> columns)
+{
+  record_size_      = record_size;
+  min_encoded_size_ = record_size;
+  char_columns_.clear();
+  for (const SlottedColumnMeta &column : columns) {
+    if (static_cast<AttrType>(column.type) == AttrType::CHARS) {
+      char_columns_.push_back(column);
+      min_encoded_size_ -= column.len - length_bytes(column.len);
+    }
+  }
+  std::sort(char_columns_.begin(), char_columns_.end(), [](const SlottedColumnMeta &a, const SlottedColumnMeta &b) {
+    return a.offset < b.offset;
+  });
+}
+
+void SlottedRowCodec::encode(const char *record, vector<char> &output) const
+{
+  int cursor = 0;
+  for (const SlottedColumnMeta &column : char_columns_) {
+    output.insert(output.end(), record + cursor, record + column.offset);
+
+    const char *value  = record + column.offset;
+    int         length = column.len;
+    while (length > 0 && value[length - 1] == 0) {
+      length--;
+    }
+
+    output.push_back(static_cast<char>(length & 0xFF));
+    if (length_bytes(column.len) > 1) {
+      output.push_back(static_cast<char>((length >> 8) & 0xFF));
+    }
+    output.insert(output.end(), value, value + length);
+    cursor = column.offset + column.len;
+  }
+  output.insert(output.end(), record + cursor, record + record_size_);
+}
+
+RC SlottedRowCodec::decode(const char *data, int length, char *record) const
+{
+  const char *end    = data + length;
+  int         cursor = 0;
+  for (const SlottedColumnMeta &column : char_columns_) {
+    const int raw_len = column.offset - cursor;
+    if (end - data < raw_len + length_bytes(column.len)) {
+      LOG_WARN("invalid slotted row. length=%d, column offset=%d", length, column.offset);
+      return RC::INTERNAL;
+    }
+    memcpy(record + cursor, data, raw_len);
+    data += raw_len;
+
+    int value_len = static_cast<uint8_t>(*data++);
+    if (length_bytes(column.len) > 1) {
+      value_len |= static_cast<uint8_t>(*data++) << 8;
+    }
+    if (value_len > column.len || end - data < value_len) {
+      LOG_WARN("invalid slotted row. length=%d, column offset=%d, value length=%d", length, column.offset, value_len);
+      return RC::INTERNAL;
+    }
+    memcpy(record + column.offset, data, value_len);
+    memset(record + column.offset + value_len, 0, column.len - value_len);
+    data += value_len;
+    cursor = column.offset + column.len;
+  }
+
+  if (end - data != record_size_ - cursor) {
+    LOG_WARN("invalid slotted row. length=%d, remain=%d, expect=%d", length, (int)(end - data), record_size_ - cursor);
+    return RC::INTERNAL;
+  }
+  memcpy(record + cursor, data, record_size_ - cursor);
+  return RC::SUCCESS;
+}
@@ -0,0 +1,117 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "common/lang/span.h"
+#include "common/lang/vector.h"
+#include "common/sys/rc.h"
+#include "common/types.h"
+
+/**
+ * @brief SLOTTED 格式的页面中每一列的描述
+ * @ingroup RecordManager
+ * @details 存放在页面中，新页面的日志中也会记录，日志回放时用来初始化页面
+ */
+struct SlottedColumnMeta
+{
+  int32_t offset;  ///< 列在记录中的偏移量
+  int32_t len;     ///< 列的长度
+  int32_t type;    ///< 列的类型(AttrType)
+};
+
+/**
+ * @brief SLOTTED 格式中插入或更新记录时，在 RecordFileHandler、RecordPageHandler 和日志之间传递的数据
+ * @ingroup RecordManager
+ * @details
+ * @code
+ * | SlottedRow | data (length bytes) |
+ * @endcode
+ * 不溢出时 data 是编码后的记录；溢出时 data 是 SlottedOverflowRef，编码后的记录都存放在溢出页面中。
+ * data 就是页面中存放的内容。
+ */
+struct SlottedRow
+{
+  int32_t length;    ///< data 的长度
+  int32_t overflow;  ///< 1 表示记录存放在溢出页面中
+
+  char data[0];
+
+  int size() const { return static_cast<int>(sizeof(SlottedRow)) + length; }
+};
+
+/**
+ * @brief 溢出的记录在页面中存放的内容
+ * @ingroup RecordManager
+ */
+struct SlottedOverflowRef
+{
+  int32_t total_length;  ///< 编码后记录的长度
+  PageNum first_page;    ///< 第一个溢出页面
+};
+
+/**
+ * @brief 溢出页面的头部，紧跟在记录页面的 PageHeader 之后
+ * @ingroup RecordManager
+ * @details 溢出页面的 PageHeader 全部为0，可以容纳的记录个数为0，所以扫描时会被当做空页面跳过，
+ * 空闲空间映射中也总是满的
+ */
+struct SlottedOverflowPageHeader
+{
+  PageNum next_page;  ///< 下一个溢出页面，最后一个页面为 BP_INVALID_PAGE_NUM
+  int32_t length;     ///< 当前页面中存放的数据长度
+};
+
+/**
+ * @brief SLOTTED 格式中记录的编码
+ * @ingroup RecordManager
+ * @details 内存中的记录仍然是定长的，只有存放在页面中时才编码成变长的格式：
+ * CHARS 类型的列去掉末尾填充的0，前面加上实际的长度(列长度不超过255时使用1个字节，否则使用2个字节)，
+ * 其它的列和不属于任何列的数据(比如NULL位图)原样存放。解码时按照原来的长度补0，所以与编码前完全相同。
+ */
+class SlottedRowCodec
+{
+public:
+  SlottedRowCodec()  = default;
+  ~SlottedRowCodec() = default;
+
+  /**
+   * @brief 初始化
+   * @param record_size 定长记录的长度
+   * @param columns 所有列的描述，没有列时整条记录原样存放
+   */
+  void init(int record_size, span<const SlottedColumnMeta> columns);
+
+  bool inited() const { return record_size_ > 0; }
+  int  record_size() const { return record_size_; }
+
+  /// 编码后最短的长度，即所有 CHARS 列都为空串时的长度
+  int min_encoded_size() const { return min_encoded_size_; }
+
+  /**
+   * @brief 编码一条定长的记录，追加到 output 的后面
+   */
+  void encode(const char *record, vector<char> &output) const;
+
+  /**
+   * @brief 解码一条记录，record 至少要有 record_size() 字节
+   */
+  RC decode(const char *data, int length, char *record) const;
+
+private:
+  static int length_bytes(int column_len) { return column_len <= UINT8_MAX ? 1 : 2; }
+
+private:
+  int                       record_size_      = 0;
+  int                       min_encoded_size_ = 0;
+  vector<SlottedColumnMeta> char_columns_;  ///< 需要编码的 CHARS 列，按照偏移量排序
+};
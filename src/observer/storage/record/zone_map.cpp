@@ -0,0 +1,182 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include "storage/record/zone_map.h"
+#include "common/log/log.h"
+#include "sql/expr/expression.h"
+
+void PaxColumnZoneMap::init(AttrType type)
+{
+  attr_type       = static_cast<int32_t>(type);
+  null_count      = 0;
+  value_count     = 0;
+  min.int_value   = 0;
+  max.int_value   = 0;
+}
+
+bool PaxColumnZoneMap::has_bounds() const
+{
+  switch (static_cast<AttrType>(attr_type)) {
+    case AttrType::INTS:
+    case AttrType::DATES:
+    case AttrType::FLOATS: return true;
+    default: return false;
+  }
+}
+
+void PaxColumnZoneMap::add_value(const char *data)
+{
+  if (has_bounds()) {
+    Bound value;
+    memcpy(&value, data, sizeof(value));
+    if (static_cast<AttrType>(attr_type) == AttrType::FLOATS) {
+      if (value_count == 0 || value.float_value < min.float_value) {
+        min.float_value = value.float_value;
+      }
+      if (value_count == 0 || value.float_value > max.float_value) {
+        max.float_value = value.float_value;
+      }
+    } else {
+      if (value_count == 0 || value.int_value < min.int_value) {
+        min.int_value = value.int_value;
+      }
+      if (value_count == 0 || value.int_value > max.int_value) {
+        max.int_value = value.int_value;
+      }
+    }
+  }
+  value_count++;
+}
+
+void PaxColumnZoneMap::remove_value()
+{
+  value_count--;
+  if (value_count == 0) {
+    min.int_value = 0;
+    max.int_value = 0;
+  }
+}
+
+double PaxColumnZoneMap::min_value() const
+{
+  return static_cast<AttrType>(attr_type) == AttrType::FLOATS ? min.float_value : min.int_value;
+}
+
+double PaxColumnZoneMap::max_value() const
+{
+  return static_cast<AttrType>(attr_type) == AttrType::FLOATS ? max.float_value : max.int_value;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// 交换比较的左右两边时使用，比如 `1 < a` 等价于 `a > 1`
+static CompOp swap_comp_op(CompOp op)
+{
+  switch (op) {
+    case LESS_EQUAL: return GREAT_EQUAL;
+    case LESS_THAN: return GREAT_THAN;
+    case GREAT_EQUAL: return LESS_EQUAL;
+    case GREAT_THAN: return LESS_THAN;
+    default: return op;
+  }
+}
+
+void ZoneMapFilter::init(const Table *table, const vector<unique_ptr<Expression>> &predicates)
+{
+  conditions_.clear();
+  for (const unique_ptr<Expression> &predicate : predicates) {
+    if (!predicate || predicate->type() != ExprType::COMPARISON) {
+      continue;
+    }
+
+    auto       *comparison_expr = static_cast<ComparisonExpr *>(predicate.get());
+    Expression *left            = comparison_expr->left().get();
+    Expression *right           = comparison_expr->right().get();
+    CompOp      op              = comparison_expr->comp();
+    if (left->type() == ExprType::VALUE && right->type() == ExprType::FIELD) {
+      std::swap(left, right);
+      op = swap_comp_op(op);
+    }
+    if (left->type() != ExprType::FIELD || right->type() != ExprType::VALUE) {
+      continue;
+    }
+
+    auto *field_expr = static_cast<FieldExpr *>(left);
+    if (field_expr->field().table() != table) {
+      continue;
+    }
+    add(field_expr->field().meta()->field_id(), op, static_cast<ValueExpr *>(right)->get_value());
+  }
+}
+
+void ZoneMapFilter::add(int col_id, CompOp op, const Value &value)
+{
+  switch (op) {
+    case EQUAL_TO:
+    case NOT_EQUAL:
+    case LESS_EQUAL:
+    case LESS_THAN:
+    case GREAT_EQUAL:
+    case GREAT_THAN: break;
+    default: return;
+  }
+
+  Condition condition;
+  condition.col_id     = col_id;
+  condition.op         = op;
+  condition.value_type = value.attr_type();
+  switch (value.attr_type()) {
+    case AttrType::INTS:
+    case AttrType::DATES: condition.value = value.get_int(); break;
+    case AttrType::FLOATS: condition.value = value.get_float(); break;
+    default: return;  // NULL、字符串等不使用 zone map
+  }
+  conditions_.push_back(condition);
+}
+
+bool ZoneMapFilter::may_match(const PaxColumnZoneMap *zone_maps, int column_num) const
+{
+  for (const Condition &condition : conditions_) {
+    if (condition.col_id < 0 || condition.col_id >= column_num) {
+      continue;
+    }
+    if (!may_match(zone_maps[condition.col_id], condition)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ZoneMapFilter::may_match(const PaxColumnZoneMap &zone_map, const Condition &condition)
+{
+  // 页面中没有非NULL的值时，不确定比较的结果，保守处理
+  if (!zone_map.has_bounds() || zone_map.value_count <= 0) {
+    return true;
+  }
+
+  // 整数和浮点数之间可以比较，日期只与日期比较
+  const bool column_is_date = static_cast<AttrType>(zone_map.attr_type) == AttrType::DATES;
+  if (column_is_date != (condition.value_type == AttrType::DATES)) {
+    return true;
+  }
+
+  const double min   = zone_map.min_value();
+  const double max   = zone_map.max_value();
+  const double value = condition.value;
+  switch (condition.op) {
+    case EQUAL_TO: return min <= value && value <= max;
+    case NOT_EQUAL: return !(min == value && max == value);
+    case LESS_EQUAL: return min <= value;
+    case LESS_THAN: return min < value;
+    case GREAT_EQUAL: return max >= value;
+    case GREAT_THAN: return max > value;
+    default: return true;
+  }
+}
@@ -0,0 +1,103 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#pragma once
+
+#include "common/lang/memory.h"
+#include "common/lang/vector.h"
+#include "common/type/attr_type.h"
+#include "common/value.h"
+#include "sql/parser/parse_defs.h"
+
+class Expression;
+class Table;
+
+/**
+ * @brief PAX 页面中一列的统计信息(zone map)
+ * @ingroup RecordManager
+ * @details 存放在页面的列索引之后，每列一个。只有 INTS、DATES 和 FLOATS 类型的列维护最小值和最大值。
+ * 插入记录时更新。删除记录时不会收缩最小值和最大值，它们仍然是正确的边界，只是可能不够紧凑；
+ * 所有非NULL的值都被删除后会重置。
+ */
+struct PaxColumnZoneMap
+{
+  union Bound
+  {
+    int32_t int_value;
+    float   float_value;
+  };
+
+  int32_t attr_type;    ///< 列的类型，AttrType
+  int32_t null_count;   ///< 为NULL的值的个数
+  int32_t value_count;  ///< 非NULL的值的个数。为0时 min/max 无效
+  Bound   min;
+  Bound   max;
+
+  void init(AttrType type);
+
+  /// 当前列的类型是否维护最小值和最大值
+  bool has_bounds() const;
+
+  void add_value(const char *data);
+  void remove_value();
+  void add_null() { null_count++; }
+  void remove_null() { null_count--; }
+
+  /// 最小值和最大值，转换成double方便与不同类型的值比较
+  double min_value() const;
+  double max_value() const;
+};
+
+/**
+ * @brief 使用 zone map 判断一个页面中是否可能有满足条件的记录
+ * @ingroup RecordManager
+ * @details 由下推到表扫描中的谓词生成，只使用形如 `field op value` 的比较，其它的条件都被忽略。
+ * 所有的条件之间是 AND 的关系，只要有一个条件不可能满足，整个页面就可以跳过。
+ */
+class ZoneMapFilter
+{
+public:
+  ZoneMapFilter() = default;
+
+  /**
+   * @brief 从表扫描的谓词中提取可以使用 zone map 的条件
+   * @param table      扫描的表
+   * @param predicates 下推到表扫描中的谓词，它们之间是 AND 的关系
+   */
+  void init(const Table *table, const vector<unique_ptr<Expression>> &predicates);
+
+  /**
+   * @brief 增加一个条件 `column(col_id) op value`
+   */
+  void add(int col_id, CompOp op, const Value &value);
+
+  bool empty() const { return conditions_.empty(); }
+
+  /**
+   * @brief 页面中是否可能有满足所有条件的记录
+   * @param zone_maps  页面中每列的 zone map
+   * @param column_num 页面中的列数
+   */
+  bool may_match(const PaxColumnZoneMap *zone_maps, int column_num) const;
+
+private:
+  struct Condition
+  {
+    int      col_id     = -1;
+    CompOp   op         = NO_OP;
+    AttrType value_type = AttrType::UNDEFINED;
+    double   value      = 0;
+  };
+
+  static bool may_match(const PaxColumnZoneMap &zone_map, const Condition &condition);
+
+private:
+  vector<Condition> conditions_;
+};
@@ -12,8 +12,10 @@ See the Mulan PSL v2 for more details. */
 // Created by Meiyi & Wangyunlai on 2021/5/13.
 //
 
+#include <fcntl.h>
 #include <limits.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "common/defs.h"
 #include "common/lang/string.h"
@@ -25,6 +27,7 @@ See the Mulan PSL v2 for more details. */
 #include "common/global_context.h"
 #include "storage/db/db.h"
 #include "storage/buffer/disk_buffer_pool.h"
+#include "storage/clog/log_handler.h"
 #include "storage/common/condition_filter.h"
 #include "storage/common/meta_util.h"
 #include "storage/index/bplus_tree_index.h"
@@ -159,6 +162,10 @@ RC Table::drop()
     delete record_handler_;
     record_handler_ = nullptr;
   }
+  // 删除整理数据文件时的标记文件，不存在时忽略
+  string compact_file = table_compact_file(base_dir_.c_str(), name());
+  ::remove(compact_file.c_str());
+
   LOG_INFO("Try to remove index files of table %s", name());
   // 删除相关索引文件
   for (auto index : indexes_) {
@@ -201,20 +208,26 @@ RC Table::open(Db *db, const char *meta_file, const char *base_dir)
 
   const int index_num = table_meta_.index_num();
   for (int i = 0; i < index_num; i++) {
-    const IndexMeta *index_meta = table_meta_.index(i);
-    const FieldMeta *field_meta = table_meta_.field(index_meta->field());
-    if (field_meta == nullptr) {
-      LOG_ERROR("Found invalid index meta info which has a non-exists field. table=%s, index=%s, field=%s",
-                name(), index_meta->name(), index_meta->field());
-      // skip cleanup
-      //  do all cleanup action in destructive Table function
-      return RC::INTERNAL;
+    const IndexMeta  *index_meta = table_meta_.index(i);
+    vector<FieldMeta> field_metas;
+    for (const vector<string> *field_names : {&index_meta->fields(), &index_meta->include_fields()}) {
+      for (const string &field_name : *field_names) {
+        const FieldMeta *field_meta = table_meta_.field(field_name.c_str());
+        if (field_meta == nullptr) {
+          LOG_ERROR("Found invalid index meta info which has a non-exists field. table=%s, index=%s, field=%s",
+                    name(), index_meta->name(), field_name.c_str());
+          // skip cleanup
+          //  do all cleanup action in destructive Table function
+          return RC::INTERNAL;
+        }
+        field_metas.push_back(*field_meta);
+      }
     }
 
     BplusTreeIndex *index      = new BplusTreeIndex();
     string          index_file = table_index_file(base_dir, name(), index_meta->name());
 
-    rc = index->open(this, index_file.c_str(), *index_meta, *field_meta);
+    rc = index->open(this, index_file.c_str(), *index_meta, field_metas);
     if (rc != RC::SUCCESS) {
       delete index;
       LOG_ERROR("Failed to open index. table=%s, index=%s, file=%s, rc=%s",
@@ -254,6 +267,48 @@ RC Table::insert_record(Record &record)
   return rc;
 }
 
+RC Table::insert_records(vector<Record> &records)
+{
+  vector<const char *> record_datas;
+  vector<RID>          rids(records.size());
+  record_datas.reserve(records.size());
+  for (Record &record : records) {
+    record_datas.push_back(record.data());
+  }
+
+  int inserted = 0;
+  RC  rc = record_handler_->insert_records(record_datas, table_meta_.record_size(), rids.data(), inserted);
+  for (int i = 0; i < inserted; i++) {
+    records[i].set_rid(rids[i]);
+  }
+
+  if (OB_SUCC(rc)) {
+    rc = insert_entry_of_indexes(records);
+    if (OB_FAIL(rc)) {  // 可能出现了键值重复
+      for (const Record &record : records) {
+        RC rc2 = delete_entry_of_indexes(record.data(), record.rid(), false /*error_on_not_exists*/);
+        if (rc2 != RC::SUCCESS) {
+          LOG_ERROR("Failed to rollback index data when insert index entries failed. table name=%s, rc=%d:%s",
+                    name(), rc2, strrc(rc2));
+        }
+      }
+    }
+  } else {
+    LOG_ERROR("Insert records failed. table name=%s, rc=%s", table_meta_.name(), strrc(rc));
+  }
+
+  if (OB_FAIL(rc)) {
+    for (int i = 0; i < inserted; i++) {
+      RC rc2 = record_handler_->delete_record(&records[i].rid());
+      if (rc2 != RC::SUCCESS) {
+        LOG_PANIC("Failed to rollback record data when insert records failed. table name=%s, rc=%d:%s",
+                  name(), rc2, strrc(rc2));
+      }
+    }
+  }
+  return rc;
+}
+
 RC Table::visit_record(const RID &rid, function<bool(Record &)> visitor)
 {
   return record_handler_->visit_record(rid, visitor);
@@ -400,43 +455,53 @@ RC Table::get_record_scanner(RecordFileScanner &scanner, Trx *trx, ReadWriteMode
   return rc;
 }
 
-RC Table::get_chunk_scanner(ChunkFileScanner &scanner, Trx *trx, ReadWriteMode mode)
+RC Table::get_chunk_scanner(ChunkFileScanner &scanner, Trx *trx, ReadWriteMode mode, const vector<int> &column_ids)
 {
-  RC rc = scanner.open_scan_chunk(this, *data_buffer_pool_, db_->log_handler(), mode);
+  RC rc = scanner.open_scan_chunk(this, *data_buffer_pool_, db_->log_handler(), mode, column_ids);
   if (rc != RC::SUCCESS) {
     LOG_ERROR("failed to open scanner. rc=%s", strrc(rc));
   }
   return rc;
 }
 
-RC Table::create_index(Trx *trx, const FieldMeta *field_meta, const char *index_name)
+RC Table::create_index(Trx *trx, const vector<const FieldMeta *> &field_metas,
+    const vector<const FieldMeta *> &include_field_metas, const char *index_name, int fill_factor)
 {
-  if (common::is_blank(index_name) || nullptr == field_meta) {
+  if (common::is_blank(index_name) || field_metas.empty()) {
     LOG_INFO("Invalid input arguments, table name is %s, index_name is blank or attribute_name is blank", name());
     return RC::INVALID_ARGUMENT;
   }
 
   IndexMeta new_index_meta;
 
-  RC rc = new_index_meta.init(index_name, *field_meta);
+  RC rc = new_index_meta.init(index_name, field_metas, include_field_metas);
   if (rc != RC::SUCCESS) {
     LOG_INFO("Failed to init IndexMeta in table:%s, index_name:%s, field_name:%s", 
-             name(), index_name, field_meta->name());
+             name(), index_name, field_metas[0]->name());
     return rc;
   }
 
+  vector<FieldMeta> index_field_metas;
+  for (const FieldMeta *field_meta : field_metas) {
+    index_field_metas.push_back(*field_meta);
+  }
+  for (const FieldMeta *field_meta : include_field_metas) {
+    index_field_metas.push_back(*field_meta);
+  }
+
   // 创建索引相关数据
   BplusTreeIndex *index      = new BplusTreeIndex();
   string          index_file = table_index_file(base_dir_.c_str(), name(), index_name);
 
-  rc = index->create(this, index_file.c_str(), new_index_meta, *field_meta);
+  rc = index->create(this, index_file.c_str(), new_index_meta, index_field_metas);
   if (rc != RC::SUCCESS) {
     delete index;
     LOG_ERROR("Failed to create bplus tree index. file name=%s, rc=%d:%s", index_file.c_str(), rc, strrc(rc));
     return rc;
   }
 
-  // 遍历当前的所有数据，插入这个索引
+  // 遍历当前的所有数据，排序之后批量构建索引。持有表的共享锁，避免整理数据文件时移动记录
+  shared_lock<common::RecursiveSharedMutex> guard(latch_);
   RecordFileScanner scanner;
   rc = get_record_scanner(scanner, trx, ReadWriteMode::READ_ONLY);
   if (rc != RC::SUCCESS) {
@@ -445,18 +510,8 @@ RC Table::create_index(Trx *trx, const FieldMeta *field_meta, const char *index_
     return rc;
   }
 
-  Record record;
-  while (OB_SUCC(rc = scanner.next(record))) {
-    rc = index->insert_entry(record.data(), &record.rid());
-    if (rc != RC::SUCCESS) {
-      LOG_WARN("failed to insert record into index while creating index. table=%s, index=%s, rc=%s",
-               name(), index_name, strrc(rc));
-      return rc;
-    }
-  }
-  if (RC::RECORD_EOF == rc) {
-    rc = RC::SUCCESS;
-  } else {
+  rc = index->bulk_load(scanner, fill_factor);
+  if (rc != RC::SUCCESS) {
     LOG_WARN("failed to insert record into index while creating index. table=%s, index=%s, rc=%s",
              name(), index_name, strrc(rc));
     return rc;
@@ -532,6 +587,177 @@ RC Table::delete_record(const Record &record)
   return rc;
 }
 
+RC Table::delete_records(const vector<Record> &records)
+{
+  RC          rc = RC::SUCCESS;
+  vector<RID> rids;
+  rids.reserve(records.size());
+  for (const Record &record : records) {
+    for (Index *index : indexes_) {
+      rc = index->delete_entry(record.data(), &record.rid());
+      ASSERT(RC::SUCCESS == rc, 
+             "failed to delete entry from index. table name=%s, index name=%s, rid=%s, rc=%s",
+             name(), index->index_meta().name(), record.rid().to_string().c_str(), strrc(rc));
+    }
+    rids.push_back(record.rid());
+  }
+  rc = record_handler_->delete_records(rids);
+  return rc;
+}
+
+/**
+ * @brief 创建文件并落盘，包括所在目录中的目录项
+ */
+static RC create_file_sync(const string &file_name)
+{
+  int fd = ::open(file_name.c_str(), O_CREAT | O_WRONLY | O_TRUNC, 0644);
+  if (fd < 0) {
+    LOG_ERROR("Failed to create file. file=%s, errmsg=%s", file_name.c_str(), strerror(errno));
+    return RC::IOERR_OPEN;
+  }
+  int ret = fsync(fd);
+  close(fd);
+  if (ret != 0) {
+    LOG_ERROR("Failed to sync file. file=%s, errmsg=%s", file_name.c_str(), strerror(errno));
+    return RC::IOERR_SYNC;
+  }
+
+  string dir = filesystem::path(file_name).parent_path();
+  fd         = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd < 0) {
+    LOG_ERROR("Failed to open directory. dir=%s, errmsg=%s", dir.c_str(), strerror(errno));
+    return RC::IOERR_OPEN;
+  }
+  ret = fsync(fd);
+  close(fd);
+  if (ret != 0) {
+    LOG_ERROR("Failed to sync directory. dir=%s, errmsg=%s", dir.c_str(), strerror(errno));
+    return RC::IOERR_SYNC;
+  }
+  return RC::SUCCESS;
+}
+
+RC Table::compact(int &freed_pages)
+{
+  freed_pages = 0;
+
+  // 记录的位置会改变，不能有其它语句正在访问这张表，也不能有未结束的事务还引用着记录原来的位置
+  unique_lock<common::RecursiveSharedMutex> guard(latch_, try_to_lock);
+  if (!guard.owns_lock()) {
+    LOG_WARN("failed to compact table which is in use. table=%s", name());
+    return RC::LOCKED_CONCURRENCY_CONFLICT;
+  }
+  if (db_->trx_kit().min_active_lsn() != 0) {
+    LOG_WARN("failed to compact table while there are active transactions. table=%s", name());
+    return RC::LOCKED_CONCURRENCY_CONFLICT;
+  }
+
+  // 标记文件必须在任何移动记录的日志落盘之前就存在，崩溃之后才能知道索引需要重建
+  string compact_file = table_compact_file(base_dir_.c_str(), name());
+  RC     rc           = create_file_sync(compact_file);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to create compact file. table=%s, file=%s, rc=%s", name(), compact_file.c_str(), strrc(rc));
+    return rc;
+  }
+
+  // 先删除原来的索引项再插入新的，唯一索引中不会出现重复的键值
+  auto on_move = [this](const Record &record, const RID &new_rid) {
+    RC rc = delete_entry_of_indexes(record.data(), record.rid(), false /*error_on_not_exists*/);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to delete index entries of moved record. table=%s, rid=%s, rc=%s",
+               name(), record.rid().to_string().c_str(), strrc(rc));
+      return rc;
+    }
+    rc = insert_entry_of_indexes(record.data(), new_rid);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to insert index entries of moved record. table=%s, rid=%s, rc=%s",
+               name(), new_rid.to_string().c_str(), strrc(rc));
+
+      // 恢复成移动之前的索引项，后面还会根据数据重建索引。插入失败的索引以及后面的索引中没有新的索引项，忽略删除失败
+      for (Index *index : indexes_) {
+        index->delete_entry(record.data(), &new_rid);
+      }
+      RC rc2 = insert_entry_of_indexes(record.data(), record.rid());
+      if (OB_FAIL(rc2)) {
+        LOG_WARN("failed to rollback index entries of moved record. table=%s, rid=%s, rc=%s",
+                 name(), record.rid().to_string().c_str(), strrc(rc2));
+      }
+    }
+    return rc;
+  };
+
+  rc = record_handler_->compact(on_move, freed_pages);
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to compact table, rebuild indexes. table=%s, rc=%s", name(), strrc(rc));
+    // 已经移动的记录不会恢复，有些记录的索引项可能还没有修改
+    RC rc2 = rebuild_indexes();
+    if (OB_FAIL(rc2)) {
+      // 保留标记文件，重启时再重建
+      LOG_ERROR("failed to rebuild indexes after compaction failed. table=%s, rc=%s", name(), strrc(rc2));
+      return rc;
+    }
+  }
+
+  // 移动记录和修改索引的日志都落盘之后，崩溃恢复出来的索引就是一致的，不再需要标记文件
+  LogHandler &log_handler = db_->log_handler();
+  RC          rc2         = log_handler.wait_lsn(log_handler.current_lsn());
+  if (OB_FAIL(rc2)) {
+    LOG_WARN("failed to wait log after compaction. table=%s, rc=%s", name(), strrc(rc2));
+    return OB_FAIL(rc) ? rc : rc2;
+  }
+  ::remove(compact_file.c_str());
+
+  if (OB_SUCC(rc)) {
+    LOG_INFO("compact table done. table=%s, freed pages=%d", name(), freed_pages);
+  }
+  return rc;
+}
+
+RC Table::recover_compaction()
+{
+  string compact_file = table_compact_file(base_dir_.c_str(), name());
+  if (!filesystem::exists(compact_file)) {
+    return RC::SUCCESS;
+  }
+
+  LOG_INFO("compaction of table was interrupted, rebuild indexes. table=%s", name());
+  RC rc = rebuild_indexes();
+  if (OB_FAIL(rc)) {
+    LOG_ERROR("failed to rebuild indexes of table. table=%s, rc=%s", name(), strrc(rc));
+    return rc;
+  }
+
+  LogHandler &log_handler = db_->log_handler();
+  rc                      = log_handler.wait_lsn(log_handler.current_lsn());
+  if (OB_FAIL(rc)) {
+    LOG_WARN("failed to wait log after rebuilding indexes. table=%s, rc=%s", name(), strrc(rc));
+    return rc;
+  }
+  ::remove(compact_file.c_str());
+  return rc;
+}
+
+RC Table::rebuild_indexes()
+{
+  RC rc = RC::SUCCESS;
+  for (Index *index : indexes_) {
+    // 索引中要包含所有版本的记录，所以不使用事务过滤
+    RecordFileScanner scanner;
+    rc = get_record_scanner(scanner, nullptr /*trx*/, ReadWriteMode::READ_ONLY);
+    if (OB_FAIL(rc)) {
+      return rc;
+    }
+
+    rc = static_cast<BplusTreeIndex *>(index)->rebuild(scanner);
+    scanner.close_scan();
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to rebuild index. table=%s, index=%s, rc=%s", name(), index->index_meta().name(), strrc(rc));
+      return rc;
+    }
+  }
+  return rc;
+}
+
 RC Table::insert_entry_of_indexes(const char *record, const RID &rid)
 {
   RC rc = RC::SUCCESS;
@@ -544,6 +770,23 @@ RC Table::insert_entry_of_indexes(const char *record, const RID &rid)
   return rc;
 }
 
+// 逐个索引插入所有的记录，同一个索引连续访问，减少在不同索引之间切换的开销
+// 失败时每条记录在前面的索引中都已经插入，在后面的索引中都没有插入，只有失败的索引中插入了一部分，
+// 所以可以使用 delete_entry_of_indexes 回滚
+RC Table::insert_entry_of_indexes(const vector<Record> &records)
+{
+  RC rc = RC::SUCCESS;
+  for (Index *index : indexes_) {
+    for (const Record &record : records) {
+      rc = index->insert_entry(record.data(), &record.rid());
+      if (rc != RC::SUCCESS) {
+        return rc;
+      }
+    }
+  }
+  return rc;
+}
+
 RC Table::delete_entry_of_indexes(const char *record, const RID &rid, bool error_on_not_exists)
 {
   RC rc = RC::SUCCESS;
@@ -18,6 +18,7 @@ See the Mulan PSL v2 for more details. */
 #include "common/types.h"
 #include "common/lang/span.h"
 #include "common/lang/functional.h"
+#include "common/lang/mutex.h"
 
 struct RID;
 class Record;
@@ -83,20 +84,57 @@ public:
    * @param record[in/out] 传入的数据包含具体的数据，插入成功会通过此字段返回RID
    */
   RC insert_record(Record &record);
+
+  /**
+   * @brief 在当前的表中插入多条记录
+   * @details 与 insert_record 相同，只是记录按页面批量写入，索引也按照索引逐个批量插入。
+   * 任何一条记录插入失败时，所有记录都会回滚。
+   * @param records[in/out] 插入成功会通过每条记录返回RID
+   */
+  RC insert_records(vector<Record> &records);
   RC delete_record(const Record &record);
   RC delete_record(const RID &rid);
+
+  /**
+   * @brief 删除多条记录
+   * @details 与 delete_record 相同，只是记录按页面批量删除，每个页面只记录一条日志
+   */
+  RC delete_records(const vector<Record> &records);
+
+  /**
+   * @brief 整理表的数据文件，合并稀疏的页面并释放空的页面，参考 RecordFileHandler::compact
+   * @details 记录移动之后同时修改索引。记录的位置会改变，所以需要拿到表的排它锁(参考 latch)，并且没有活跃的事务，
+   * 否则返回 LOCKED_CONCURRENCY_CONFLICT。
+   * 移动记录与修改索引不在同一条日志中，整理开始前会创建一个标记文件，等所有日志落盘之后再删除。
+   * 在两者之间崩溃时，重启后根据标记文件重建索引，参考 recover_compaction。整理中途失败时也会重建索引。
+   * @param freed_pages 释放的页面个数
+   */
+  RC compact(int &freed_pages);
+
+  /**
+   * @brief 如果上次整理数据文件时中断了，根据表数据重建所有的索引
+   * @details 在重做日志之后调用，此时数据文件与索引各自都是一致的，只是索引中可能还有记录原来的位置
+   */
+  RC recover_compaction();
   RC get_record(const RID &rid, Record &record);
 
   RC recover_insert_record(Record &record);
 
-  // TODO refactor
-  RC create_index(Trx *trx, const FieldMeta *field_meta, const char *index_name);
+  /**
+   * @brief 创建索引
+   * @param field_metas 索引的字段，可以有多个(复合索引)
+   * @param include_field_metas INCLUDE 字段，只存放在索引中，不参与比较
+   * @param fill_factor 使用表中已有的数据批量构建索引时节点填充的百分比
+   */
+  RC create_index(Trx *trx, const vector<const FieldMeta *> &field_metas,
+      const vector<const FieldMeta *> &include_field_metas, const char *index_name, int fill_factor);
 
   RC get_record_scanner(RecordFileScanner &scanner, Trx *trx, ReadWriteMode mode);
 
-  RC get_chunk_scanner(ChunkFileScanner &scanner, Trx *trx, ReadWriteMode mode);
+  RC get_chunk_scanner(ChunkFileScanner &scanner, Trx *trx, ReadWriteMode mode, const vector<int> &column_ids = {});
 
   RecordFileHandler *record_handler() const { return record_handler_; }
+  DiskBufferPool    *data_buffer_pool() const { return data_buffer_pool_; }
 
   /**
    * @brief 可以在页面锁保护的情况下访问记录
@@ -119,16 +157,26 @@ public:
 
 private:
   RC insert_entry_of_indexes(const char *record, const RID &rid);
+  RC insert_entry_of_indexes(const vector<Record> &records);
   RC delete_entry_of_indexes(const char *record, const RID &rid, bool error_on_not_exists);
   RC set_value_to_record(char *record_data, const Value &value, const FieldMeta *field);
 
 private:
   RC init_record_handler(const char *base_dir);
+  RC rebuild_indexes();
 
 public:
   Index *find_index(const char *index_name) const;
   Index *find_index_by_field(const char *field_name) const;
 
+  const vector<Index *> &indexes() const { return indexes_; }
+
+  /**
+   * @brief 表级别的读写锁
+   * @details 访问表中数据的语句在执行期间持有共享锁。整理数据文件(compact)会改变记录的位置，需要持有排它锁
+   */
+  common::RecursiveSharedMutex &latch() { return latch_; }
+
 private:
   Db                *db_ = nullptr;
   string             base_dir_;
@@ -136,4 +184,6 @@ private:
   DiskBufferPool    *data_buffer_pool_ = nullptr;  /// 数据文件关联的buffer pool
   RecordFileHandler *record_handler_   = nullptr;  /// 记录操作
   vector<Index *>    indexes_;
+
+  common::RecursiveSharedMutex latch_;
 };
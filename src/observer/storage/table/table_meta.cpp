@@ -26,6 +26,7 @@ static const Json::StaticString FIELD_TABLE_NAME("table_name");
 static const Json::StaticString FIELD_STORAGE_FORMAT("storage_format");
 static const Json::StaticString FIELD_FIELDS("fields");
 static const Json::StaticString FIELD_INDEXES("indexes");
+static const Json::StaticString FIELD_FREE_SPACE_MAP("free_space_map");
 
 TableMeta::TableMeta(const TableMeta &other)
     : table_id_(other.table_id_),
@@ -33,6 +34,7 @@ TableMeta::TableMeta(const TableMeta &other)
       fields_(other.fields_),
       indexes_(other.indexes_),
       storage_format_(other.storage_format_),
+      free_space_map_(other.free_space_map_),
       record_size_(other.record_size_)
 {}
 
@@ -41,6 +43,7 @@ void TableMeta::swap(TableMeta &other) noexcept
   name_.swap(other.name_);
   fields_.swap(other.fields_);
   indexes_.swap(other.indexes_);
+  std::swap(free_space_map_, other.free_space_map_);
   std::swap(record_size_, other.record_size_);
 }
 
@@ -109,6 +112,7 @@ RC TableMeta::init(int32_t table_id, const char *name, const vector<FieldMeta> *
   table_id_       = table_id;
   name_           = name;
   storage_format_ = storage_format;
+  free_space_map_ = true;
   LOG_INFO("Sussessfully initialized table meta. table id=%d, name=%s", table_id, name);
   return RC::SUCCESS;
 }
@@ -186,6 +190,7 @@ int TableMeta::serialize(ostream &ss) const
   table_value[FIELD_TABLE_ID]       = table_id_;
   table_value[FIELD_TABLE_NAME]     = name_;
   table_value[FIELD_STORAGE_FORMAT] = static_cast<int>(storage_format_);
+  table_value[FIELD_FREE_SPACE_MAP] = free_space_map_;
 
   Json::Value fields_value;
   for (const FieldMeta &field : fields_) {
@@ -257,6 +262,14 @@ int TableMeta::deserialize(istream &is)
 
   int32_t storage_format = storage_format_value.asInt();
 
+  // 之前版本的元数据中没有这个字段，数据文件中也没有映射页面
+  const Json::Value &free_space_map_value = table_value[FIELD_FREE_SPACE_MAP];
+  if (!free_space_map_value.isNull() && !free_space_map_value.isBool()) {
+    LOG_ERROR("Invalid free space map flag. json value=%s", free_space_map_value.toStyledString().c_str());
+    return -1;
+  }
+  const bool free_space_map = free_space_map_value.asBool();
+
   RC  rc        = RC::SUCCESS;
   int field_num = fields_value.size();
 
@@ -277,6 +290,7 @@ int TableMeta::deserialize(istream &is)
 
   table_id_       = table_id;
   storage_format_ = static_cast<StorageFormat>(storage_format);
+  free_space_map_ = free_space_map;
   name_.swap(table_name);
   fields_.swap(fields);
   record_size_ = fields_.back().offset() + fields_.back().len() - fields_.begin()->offset();
@@ -51,6 +51,12 @@ public:
   auto                trx_fields() const -> span<const FieldMeta>;
   const StorageFormat storage_format() const { return storage_format_; }
 
+  /**
+   * @brief 数据文件中是否有空闲空间映射页面，参考 FreeSpaceMap
+   * @details 之前版本创建的表没有映射页面，映射页面的位置上存放的是记录
+   */
+  bool free_space_map() const { return free_space_map_; }
+
   int field_num() const;  // sys field included
   int sys_field_num() const;
   int null_bitmap_start() const;
@@ -76,6 +82,7 @@ protected:
   vector<FieldMeta> fields_;  // 包含sys_fields
   vector<IndexMeta> indexes_;
   StorageFormat     storage_format_;
+  bool              free_space_map_ = true;
   int               null_bitmap_start_;  // null bitmap的起始位置
   int               record_size_ = 0;
 };
@@ -112,6 +112,20 @@ LogReplayer *MvccTrxKit::create_log_replayer(Db &db, LogHandler &log_handler)
   return new MvccTrxLogReplayer(db, *this, log_handler);
 }
 
+LSN MvccTrxKit::min_active_lsn()
+{
+  lock_.lock();
+  LSN min_lsn = 0;
+  for (Trx *trx : trxes_) {
+    LSN first_lsn = static_cast<MvccTrx *>(trx)->first_lsn();
+    if (first_lsn > 0 && (min_lsn == 0 || first_lsn < min_lsn)) {
+      min_lsn = first_lsn;
+    }
+  }
+  lock_.unlock();
+  return min_lsn;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 MvccTrx::MvccTrx(MvccTrxKit &kit, LogHandler &log_handler) : trx_kit_(kit), log_handler_(log_handler) {}
@@ -140,9 +154,11 @@ RC MvccTrx::insert_record(Table *table, Record &record)
     return rc;
   }
 
-  rc = log_handler_.insert_record(trx_id_, table, record.rid());
+  LSN lsn = 0;
+  rc      = log_handler_.insert_record(trx_id_, table, record.rid(), lsn);
   ASSERT(rc == RC::SUCCESS, "failed to append insert record log. trx id=%d, table id=%d, rid=%s, record len=%d, rc=%s",
          trx_id_, table->table_id(), record.rid().to_string().c_str(), record.len(), strrc(rc));
+  record_first_lsn(lsn);
 
   operations_.push_back(Operation(Operation::Type::INSERT, table, record.rid()));
   return rc;
@@ -177,9 +193,11 @@ RC MvccTrx::delete_record(Table *table, Record &record)
     return delete_result;
   }
 
-  rc = log_handler_.delete_record(trx_id_, table, record.rid());
+  LSN lsn = 0;
+  rc      = log_handler_.delete_record(trx_id_, table, record.rid(), lsn);
   ASSERT(rc == RC::SUCCESS, "failed to append delete record log. trx id=%d, table id=%d, rid=%s, record len=%d, rc=%s",
       trx_id_, table->table_id(), record.rid().to_string().c_str(), record.len(), strrc(rc));
+  record_first_lsn(lsn);
 
   operations_.push_back(Operation(Operation::Type::DELETE, table, record.rid()));
 
@@ -340,6 +358,7 @@ RC MvccTrx::commit_with_trx_id(int32_t commit_xid)
   }
 
   operations_.clear();
+  first_lsn_.store(0);
 
   LOG_TRACE("append trx commit log. trx id=%d, commit_xid=%d, rc=%s", trx_id_, commit_xid, strrc(rc));
   return rc;
@@ -419,10 +438,18 @@ RC MvccTrx::rollback()
   if (!recovering_) {
     rc = log_handler_.rollback(trx_id_);
   }
+  first_lsn_.store(0);
   LOG_TRACE("append trx rollback log. trx id=%d, rc=%s", trx_id_, strrc(rc));
   return rc;
 }
 
+void MvccTrx::record_first_lsn(LSN lsn)
+{
+  if (lsn > 0 && first_lsn_.load() == 0) {
+    first_lsn_.store(lsn);
+  }
+}
+
 RC find_table(Db *db, const LogEntry &log_entry, Table *&table)
 {
   auto *trx_log_header = reinterpret_cast<const MvccTrxLogHeader *>(log_entry.data());
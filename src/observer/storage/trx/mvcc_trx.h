@@ -44,6 +44,8 @@ public:
 
   LogReplayer *create_log_replayer(Db &db, LogHandler &log_handler) override;
 
+  LSN min_active_lsn() override;
+
 public:
   int32_t next_trx_id();
 
@@ -55,7 +57,7 @@ private:
 
   atomic<int32_t> current_trx_id_{0};
 
-  common::Mutex lock_;
+  mutex         lock_;  ///< 检查点线程也会遍历事务，所以总是使用真正的锁
   vector<Trx *> trxes_;
 };
 
@@ -99,10 +101,16 @@ public:
 
   int32_t id() const override { return trx_id_; }
 
+  /// @brief 当前事务写的第一条日志的LSN，没有写过日志时返回0
+  LSN first_lsn() const { return first_lsn_.load(); }
+
 private:
   RC   commit_with_trx_id(int32_t commit_id);
   void trx_fields(Table *table, Field &begin_xid_field, Field &end_xid_field) const;
 
+  /// @brief 记录事务写的第一条日志，检查点不能越过它
+  void record_first_lsn(LSN lsn);
+
 private:
   static const int32_t MAX_TRX_ID = numeric_limits<int32_t>::max();
 
@@ -116,4 +124,5 @@ private:
   bool              started_    = false;
   bool              recovering_ = false;
   OperationSet      operations_;
+  atomic<LSN>       first_lsn_{0};  ///< 当前事务写的第一条日志的LSN，检查点使用
 };
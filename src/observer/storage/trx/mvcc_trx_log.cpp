@@ -68,7 +68,7 @@ MvccTrxLogHandler::MvccTrxLogHandler(LogHandler &log_handler) : log_handler_(log
 
 MvccTrxLogHandler::~MvccTrxLogHandler() {}
 
-RC MvccTrxLogHandler::insert_record(int32_t trx_id, Table *table, const RID &rid)
+RC MvccTrxLogHandler::insert_record(int32_t trx_id, Table *table, const RID &rid, LSN &lsn)
 {
   ASSERT(trx_id > 0, "invalid trx_id:%d", trx_id);
 
@@ -78,12 +78,11 @@ RC MvccTrxLogHandler::insert_record(int32_t trx_id, Table *table, const RID &rid
   log_entry.table_id              = table->table_id();
   log_entry.rid                   = rid;
 
-  LSN lsn = 0;
   return log_handler_.append(
       lsn, LogModule::Id::TRANSACTION, span<const char>(reinterpret_cast<const char *>(&log_entry), sizeof(log_entry)));
 }
 
-RC MvccTrxLogHandler::delete_record(int32_t trx_id, Table *table, const RID &rid)
+RC MvccTrxLogHandler::delete_record(int32_t trx_id, Table *table, const RID &rid, LSN &lsn)
 {
   ASSERT(trx_id > 0, "invalid trx_id:%d", trx_id);
 
@@ -93,7 +92,6 @@ RC MvccTrxLogHandler::delete_record(int32_t trx_id, Table *table, const RID &rid
   log_entry.table_id              = table->table_id();
   log_entry.rid                   = rid;
 
-  LSN lsn = 0;
   return log_handler_.append(
       lsn, LogModule::Id::TRANSACTION, span<const char>(reinterpret_cast<const char *>(&log_entry), sizeof(log_entry)));
 }
@@ -141,7 +139,7 @@ RC MvccTrxLogReplayer::replay(const LogEntry &entry)
 {
   RC rc = RC::SUCCESS;
 
-  // 由于当前没有check point，所以所有的事务都重做。
+  // 检查点不会越过活跃事务的第一条日志，所以从检查点开始回放，可以看到没有结束的事务的全部操作。
 
   ASSERT(entry.module().id() == LogModule::Id::TRANSACTION, "invalid log module id: %d", entry.module().id());
 
@@ -156,6 +154,7 @@ RC MvccTrxLogReplayer::replay(const LogEntry &entry)
   if (trx_iter == trx_map_.end()) {
     trx = static_cast<MvccTrx *>(trx_kit_.create_trx(log_handler_, header->trx_id));
     // trx = new MvccTrx(trx_kit_, log_handler_, header->trx_id);
+    trx_map_.emplace(header->trx_id, trx);
   } else {
     trx = trx_iter->second;
   }
@@ -166,7 +165,6 @@ RC MvccTrxLogReplayer::replay(const LogEntry &entry)
   /// 如果事务结束了，需要从内存中把它删除
   if (MvccTrxLogOperation(header->operation_type).type() == MvccTrxLogOperation::Type::ROLLBACK ||
       MvccTrxLogOperation(header->operation_type).type() == MvccTrxLogOperation::Type::COMMIT) {
-    Trx *trx = trx_map_[header->trx_id];
     trx_kit_.destroy_trx(trx);
     trx_map_.erase(header->trx_id);
   }
@@ -180,7 +178,7 @@ RC MvccTrxLogReplayer::on_done()
   for (auto &pair : trx_map_) {
     MvccTrx *trx = pair.second;
     trx->rollback();  // 恢复时的rollback，可能遇到之前已经回滚一半的事务又再次调用回滚的情况
-    delete pair.second;
+    trx_kit_.destroy_trx(trx);
   }
   trx_map_.clear();
 
@@ -114,13 +114,15 @@ public:
 
   /**
    * @brief 记录插入一条记录的日志
+   * @param lsn 返回日志的LSN
    */
-  RC insert_record(int32_t trx_id, Table *table, const RID &rid);
+  RC insert_record(int32_t trx_id, Table *table, const RID &rid, LSN &lsn);
 
   /**
    * @brief 记录删除一条记录的日志
+   * @param lsn 返回日志的LSN
    */
-  RC delete_record(int32_t trx_id, Table *table, const RID &rid);
+  RC delete_record(int32_t trx_id, Table *table, const RID &rid, LSN &lsn);
 
   /**
    * @brief 记录提交事务的日志
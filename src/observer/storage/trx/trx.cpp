@@ -43,3 +43,16 @@ TrxKit *TrxKit::create(const char *name)
 
   return trx_kit;
 }
+
+RC Trx::delete_records(Table *table, vector<Record> &records)
+{
+  RC rc = RC::SUCCESS;
+  for (Record &record : records) {
+    rc = delete_record(table, record);
+    if (OB_FAIL(rc)) {
+      LOG_WARN("failed to delete record. rid=%s, rc=%s", record.rid().to_string().c_str(), strrc(rc));
+      return rc;
+    }
+  }
+  return rc;
+}
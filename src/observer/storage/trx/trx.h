@@ -129,6 +129,13 @@ public:
 
   virtual LogReplayer *create_log_replayer(Db &db, LogHandler &log_handler) = 0;
 
+  /**
+   * @brief 所有活跃事务写过的最小的日志序列号
+   * @details 事务没有结束时，重启后需要从它的第一条日志开始回放，才能把它回滚掉。
+   * 检查点不能越过这个LSN。没有活跃事务或者事务不记录日志时返回0
+   */
+  virtual LSN min_active_lsn() = 0;
+
 public:
   static TrxKit *create(const char *name);
 };
@@ -147,6 +154,12 @@ public:
   virtual RC delete_record(Table *table, Record &record)                    = 0;
   virtual RC visit_record(Table *table, Record &record, ReadWriteMode mode) = 0;
 
+  /**
+   * @brief 删除多条记录
+   * @details 默认逐条调用 delete_record。直接删除物理记录的事务可以按页面批量删除，参考 Table::delete_records
+   */
+  virtual RC delete_records(Table *table, vector<Record> &records);
+
   virtual RC start_if_need() = 0;
   virtual RC commit()        = 0;
   virtual RC rollback()      = 0;
@@ -36,6 +36,8 @@ public:
   void destroy_trx(Trx *trx) override;
 
   LogReplayer *create_log_replayer(Db &db, LogHandler &log_handler) override;
+
+  LSN min_active_lsn() override { return 0; }
 };
 
 class VacuousTrx : public Trx
@@ -46,6 +48,7 @@ public:
 
   RC insert_record(Table *table, Record &record) override;
   RC delete_record(Table *table, Record &record) override;
+  RC delete_records(Table *table, vector<Record> &records) override;
   RC visit_record(Table *table, Record &record, ReadWriteMode mode) override;
   RC start_if_need() override;
   RC commit() override;
@@ -125,6 +125,122 @@ TEST(test_frame_manager, test_frame_manager_simple_lru)
   frame_manager.cleanup();
 }
 
+TEST(test_frame_manager, test_frame_manager_steal_across_shards)
+{
+  // 每个分片只有一个页帧
+  BPFrameManager frame_manager("Test");
+  frame_manager.init(1, DEFAULT_ITEM_NUM_PER_POOL);
+  ASSERT_EQ(DEFAULT_ITEM_NUM_PER_POOL, frame_manager.shard_num());
+
+  // 这些页面都落在同一个分片上，需要从其它分片拿空闲页帧
+  const int       buffer_pool_id = 1;
+  vector<Frame *> frames;
+  for (int i = 0; i < DEFAULT_ITEM_NUM_PER_POOL; i++) {
+    Frame *frame = frame_manager.alloc(buffer_pool_id, i * DEFAULT_ITEM_NUM_PER_POOL);
+    ASSERT_NE(frame, nullptr);
+    frames.push_back(frame);
+  }
+  ASSERT_EQ(nullptr, frame_manager.alloc(buffer_pool_id, DEFAULT_ITEM_NUM_PER_POOL * DEFAULT_ITEM_NUM_PER_POOL));
+  ASSERT_EQ(frames.size(), frame_manager.frame_num());
+
+  // 淘汰之后，页帧可以被其它分片的页面使用
+  for (Frame *frame : frames) {
+    frame->unpin();
+  }
+  ASSERT_EQ(1, frame_manager.purge_frames(1, [](Frame *) { return RC::SUCCESS; }));
+  Frame *frame = frame_manager.alloc(buffer_pool_id, 1);
+  ASSERT_NE(frame, nullptr);
+  ASSERT_EQ(frame, frame_manager.get(buffer_pool_id, 1));
+  frame->unpin();
+  frame->unpin();
+
+  ASSERT_EQ(DEFAULT_ITEM_NUM_PER_POOL, frame_manager.purge_frames(DEFAULT_ITEM_NUM_PER_POOL, [](Frame *) {
+    return RC::SUCCESS;
+  }));
+  ASSERT_EQ(0, frame_manager.frame_num());
+  ASSERT_EQ(RC::SUCCESS, frame_manager.cleanup());
+}
+
+/**
+ * @brief 先把热点页面访问两次，然后做一次比页帧多得多的扫描，返回扫描之后还有多少个热点页面在内存中
+ */
+int hot_pages_after_scan(const char *replacer)
+{
+  BPFrameManager frame_manager("Test");
+  frame_manager.init(1, 1, replacer);
+
+  const int buffer_pool_id = 0;
+  auto      touch          = [&frame_manager](PageNum page_num) {
+    Frame *frame = frame_manager.alloc(buffer_pool_id, page_num);
+    if (frame == nullptr) {
+      frame_manager.purge_frames(1, [](Frame *) { return RC::SUCCESS; });
+      frame = frame_manager.alloc(buffer_pool_id, page_num);
+    }
+    EXPECT_NE(frame, nullptr);
+    frame->unpin();
+  };
+
+  const int hot_page_num = 8;
+  for (PageNum page_num = 0; page_num < DEFAULT_ITEM_NUM_PER_POOL; page_num++) {
+    touch(page_num);
+  }
+
+  // 热点页面被淘汰之后很快又被访问
+  EXPECT_EQ(hot_page_num, frame_manager.purge_frames(hot_page_num, [](Frame *) { return RC::SUCCESS; }));
+  for (PageNum page_num = 0; page_num < hot_page_num; page_num++) {
+    touch(page_num);
+  }
+
+  for (PageNum page_num = 1000; page_num < 1000 + DEFAULT_ITEM_NUM_PER_POOL * 4; page_num++) {
+    touch(page_num);
+  }
+
+  int hot_count = 0;
+  for (PageNum page_num = 0; page_num < hot_page_num; page_num++) {
+    Frame *frame = frame_manager.get(buffer_pool_id, page_num);
+    if (frame != nullptr) {
+      hot_count++;
+      frame->unpin();
+    }
+  }
+
+  frame_manager.purge_frames(DEFAULT_ITEM_NUM_PER_POOL, [](Frame *) { return RC::SUCCESS; });
+  EXPECT_EQ(RC::SUCCESS, frame_manager.cleanup());
+  return hot_count;
+}
+
+TEST(test_frame_manager, test_frame_manager_scan_resistance)
+{
+  ASSERT_EQ(0, hot_pages_after_scan("lru"));
+  ASSERT_EQ(8, hot_pages_after_scan("2q"));
+}
+
+TEST(test_frame_manager, test_frame_manager_hit_count)
+{
+  BPFrameManager frame_manager("Test");
+  frame_manager.init(1, BPFrameManager::DEFAULT_SHARD_NUM, "2q");
+  ASSERT_STREQ("2q", frame_manager.replacer_name());
+
+  ASSERT_EQ(nullptr, frame_manager.get(0, 1));
+  Frame *frame = frame_manager.alloc(0, 1);
+  ASSERT_NE(frame, nullptr);
+  ASSERT_EQ(frame, frame_manager.get(0, 1));
+  ASSERT_EQ(1, frame_manager.hit_count());
+  ASSERT_EQ(1, frame_manager.miss_count());
+
+  frame->unpin();
+  ASSERT_EQ(RC::SUCCESS, frame_manager.free(0, 1, frame));
+  ASSERT_EQ(RC::SUCCESS, frame_manager.cleanup());
+}
+
+TEST(test_frame_manager, test_frame_manager_unknown_replacer)
+{
+  BPFrameManager frame_manager("Test");
+  frame_manager.init(1, 1, "unknown");
+  ASSERT_STREQ(BPFrameManager::DEFAULT_REPLACER, frame_manager.replacer_name());
+  ASSERT_EQ(RC::SUCCESS, frame_manager.cleanup());
+}
+
 int main(int argc, char **argv)
 {
 
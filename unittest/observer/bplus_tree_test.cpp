@@ -15,6 +15,7 @@ See the Mulan PSL v2 for more details. */
 #include <iostream>
 #include <list>
 #include <filesystem>
+#include <random>
 
 #include "common/log/log.h"
 #include "common/lang/memory.h"
@@ -22,6 +23,7 @@ See the Mulan PSL v2 for more details. */
 #include "sql/parser/parse_defs.h"
 #include "storage/buffer/disk_buffer_pool.h"
 #include "storage/index/bplus_tree.h"
+#include "storage/index/bplus_tree_bulk_loader.h"
 #include "storage/clog/vacuous_log_handler.h"
 #include "storage/buffer/double_write_buffer.h"
 #include "gtest/gtest.h"
@@ -793,6 +795,557 @@ TEST(test_bplus_tree, test_scanner)
   handler.close();
 }
 
+TEST(test_bplus_tree, test_composite_key)
+{
+  filesystem::path test_directory("bplus_tree");
+  filesystem::path buffer_pool_file = test_directory / "composite.btree";
+  filesystem::remove_all(test_directory);
+  filesystem::create_directory(test_directory);
+
+  VacuousLogHandler log_handler;
+
+  BufferPoolManager bpm;
+  ASSERT_EQ(RC::SUCCESS, bpm.init(make_unique<VacuousDoubleWriteBuffer>()));
+  ASSERT_EQ(RC::SUCCESS, bpm.create_file(buffer_pool_file.c_str()));
+
+  DiskBufferPool *buffer_pool = nullptr;
+  ASSERT_EQ(RC::SUCCESS, bpm.open_file(log_handler, buffer_pool_file.c_str(), buffer_pool));
+  ASSERT_NE(nullptr, buffer_pool);
+
+  // 键值 (tenant_id, ts)，INCLUDE 一个字符串
+  struct Key
+  {
+    int  tenant_id;
+    int  ts;
+    char payload[4];
+  };
+  const vector<KeyAttr> attrs = {{AttrType::INTS, 4}, {AttrType::INTS, 4}, {AttrType::CHARS, 4}};
+
+  BplusTreeHandler handler;
+  ASSERT_EQ(RC::INVALID_ARGUMENT, handler.create(log_handler, *buffer_pool, attrs, 4 /*key_attr_num*/, ORDER, ORDER));
+  ASSERT_EQ(RC::SUCCESS, handler.create(log_handler, *buffer_pool, attrs, 2 /*key_attr_num*/, ORDER, ORDER));
+  ASSERT_EQ(static_cast<int>(sizeof(Key)), handler.file_header().attr_length);
+
+  const int tenant_num = 10;
+  const int ts_num     = 50;
+  RID       rid;
+  // 倒序插入，扫描时应该按照 (tenant_id, ts) 排序
+  for (int tenant_id = tenant_num - 1; tenant_id >= 0; tenant_id--) {
+    for (int ts = ts_num - 1; ts >= 0; ts--) {
+      Key key{tenant_id, ts, {}};
+      snprintf(key.payload, sizeof(key.payload), "%d", ts % 100);
+      rid.page_num = tenant_id;
+      rid.slot_num = ts;
+      ASSERT_EQ(RC::SUCCESS, handler.insert_entry(reinterpret_cast<const char *>(&key), &rid));
+    }
+  }
+  ASSERT_TRUE(handler.validate_tree());
+
+  // 前缀扫描 tenant_id = 3，同时返回键值
+  {
+    BplusTreeScanner scanner(handler);
+    int              tenant_id = 3;
+    const char      *prefix    = reinterpret_cast<const char *>(&tenant_id);
+    ASSERT_EQ(RC::SUCCESS, scanner.open(prefix, 4, true, prefix, 4, true));
+
+    Key key;
+    int count = 0;
+    while (RC::SUCCESS == scanner.next_entry(rid, reinterpret_cast<char *>(&key))) {
+      ASSERT_EQ(3, key.tenant_id);
+      ASSERT_EQ(count, key.ts);
+      ASSERT_EQ(to_string(count), string(key.payload));
+      ASSERT_EQ(3, rid.page_num);
+      ASSERT_EQ(count, rid.slot_num);
+      count++;
+    }
+    ASSERT_EQ(ts_num, count);
+  }
+
+  // 完整的键值范围 tenant_id = 3 and ts in [10, 20)
+  {
+    BplusTreeScanner scanner(handler);
+    int              left[2]  = {3, 10};
+    int              right[2] = {3, 20};
+    ASSERT_EQ(RC::SUCCESS,
+        scanner.open(reinterpret_cast<const char *>(left), 8, true, reinterpret_cast<const char *>(right), 8, false));
+    int count = 0;
+    while (RC::SUCCESS == scanner.next_entry(rid)) {
+      ASSERT_EQ(10 + count, rid.slot_num);
+      count++;
+    }
+    ASSERT_EQ(10, count);
+  }
+
+  // 不包含边界的前缀范围 (3, 5) 只有 tenant_id = 4
+  {
+    BplusTreeScanner scanner(handler);
+    int              left  = 3;
+    int              right = 5;
+    ASSERT_EQ(RC::SUCCESS,
+        scanner.open(reinterpret_cast<const char *>(&left), 4, false, reinterpret_cast<const char *>(&right), 4, false));
+    int count = 0;
+    while (RC::SUCCESS == scanner.next_entry(rid)) {
+      ASSERT_EQ(4, rid.page_num);
+      count++;
+    }
+    ASSERT_EQ(ts_num, count);
+  }
+
+  // 前缀必须是完整的列，INCLUDE 列不能作为前缀
+  {
+    BplusTreeScanner scanner(handler);
+    Key              key{3, 1, "1"};
+    ASSERT_EQ(RC::INVALID_ARGUMENT,
+        scanner.open(reinterpret_cast<const char *>(&key), 6, true, reinterpret_cast<const char *>(&key), 6, true));
+  }
+  {
+    BplusTreeScanner scanner(handler);
+    Key              key{3, 1, "1"};
+    ASSERT_EQ(RC::INVALID_ARGUMENT, scanner.open(reinterpret_cast<const char *>(&key),
+                                        sizeof(key), true, reinterpret_cast<const char *>(&key), sizeof(key), true));
+  }
+
+  // 删除一个租户的数据
+  for (int ts = 0; ts < ts_num; ts++) {
+    Key key{3, ts, {}};
+    rid.page_num = 3;
+    rid.slot_num = ts;
+    ASSERT_EQ(RC::SUCCESS, handler.delete_entry(reinterpret_cast<const char *>(&key), &rid));
+  }
+  ASSERT_TRUE(handler.validate_tree());
+  {
+    BplusTreeScanner scanner(handler);
+    int              tenant_id = 3;
+    const char      *prefix    = reinterpret_cast<const char *>(&tenant_id);
+    ASSERT_EQ(RC::SUCCESS, scanner.open(prefix, 4, true, prefix, 4, true));
+    ASSERT_EQ(RC::RECORD_EOF, scanner.next_entry(rid));
+  }
+
+  handler.close();
+}
+
+TEST(test_bplus_tree, test_optimistic_read)
+{
+  filesystem::path test_directory("bplus_tree");
+  filesystem::path buffer_pool_file = test_directory / "optimistic_read.btree";
+  filesystem::remove_all(test_directory);
+  filesystem::create_directory(test_directory);
+
+  VacuousLogHandler log_handler;
+
+  BufferPoolManager bpm;
+  ASSERT_EQ(RC::SUCCESS, bpm.init(make_unique<VacuousDoubleWriteBuffer>()));
+  ASSERT_EQ(RC::SUCCESS, bpm.create_file(buffer_pool_file.c_str()));
+
+  DiskBufferPool *buffer_pool = nullptr;
+  ASSERT_EQ(RC::SUCCESS, bpm.open_file(log_handler, buffer_pool_file.c_str(), buffer_pool));
+  ASSERT_NE(nullptr, buffer_pool);
+
+  BplusTreeHandler handler;
+  ASSERT_EQ(RC::SUCCESS, handler.create(log_handler, *buffer_pool, AttrType::INTS, sizeof(int), ORDER, ORDER));
+  ASSERT_TRUE(handler.optimistic_read());
+
+  // 加写锁和释放写锁时版本号加1，递归加锁时不变
+  {
+    Frame *frame = nullptr;
+    ASSERT_EQ(RC::SUCCESS, buffer_pool->allocate_page(&frame));
+    const uint64_t version = frame->version();
+    ASSERT_FALSE(Frame::version_locked(version));
+    frame->write_latch();
+    ASSERT_TRUE(Frame::version_locked(frame->version()));
+    ASSERT_FALSE(frame->validate_version(version));
+    frame->write_latch();
+    frame->write_unlatch();
+    ASSERT_TRUE(Frame::version_locked(frame->version()));
+    frame->write_unlatch();
+    ASSERT_EQ(version + 2, frame->version());
+    frame->read_latch();
+    frame->read_unlatch();
+    ASSERT_TRUE(frame->validate_version(version + 2));
+    const PageNum page_num = frame->page_num();
+    buffer_pool->unpin_page(frame);
+    ASSERT_EQ(RC::SUCCESS, buffer_pool->dispose_page(page_num));
+  }
+
+  const int key_num = 200;
+  RID       rid;
+  for (int i = 0; i < key_num; i++) {
+    rid.page_num = i;
+    rid.slot_num = i;
+    ASSERT_EQ(RC::SUCCESS, handler.insert_entry(reinterpret_cast<const char *>(&i), &rid));
+  }
+
+  auto check_entries = [&handler](int step) {
+    for (bool optimistic : {true, false}) {
+      handler.set_optimistic_read(optimistic);
+      for (int i = 0; i < key_num; i++) {
+        list<RID> rids;
+        ASSERT_EQ(RC::SUCCESS, handler.get_entry(reinterpret_cast<const char *>(&i), sizeof(i), rids));
+        ASSERT_EQ(i % step == 0 ? 1 : 0, static_cast<int>(rids.size()));
+      }
+    }
+    handler.set_optimistic_read(true);
+  };
+  check_entries(1);
+
+  // 乐观读会不加锁pin住页面，页面在这时被释放也不能出错。这里pin住所有的页面再删除数据，合并节点时会释放页面
+  vector<Frame *> frames;
+  for (PageNum page_num = 1; page_num < buffer_pool->page_count(); page_num++) {
+    Frame *frame = nullptr;
+    ASSERT_EQ(RC::SUCCESS, buffer_pool->get_this_page(page_num, &frame));
+    frames.push_back(frame);
+  }
+  for (int i = 0; i < key_num; i++) {
+    if (i % 2 != 0) {
+      rid.page_num = i;
+      rid.slot_num = i;
+      ASSERT_EQ(RC::SUCCESS, handler.delete_entry(reinterpret_cast<const char *>(&i), &rid));
+    }
+  }
+  for (Frame *frame : frames) {
+    buffer_pool->unpin_page(frame);
+  }
+  ASSERT_TRUE(handler.validate_tree());
+  check_entries(2);
+
+  // 释放的页面重新分配出来
+  for (int i = 0; i < key_num; i++) {
+    if (i % 2 != 0) {
+      rid.page_num = i;
+      rid.slot_num = i;
+      ASSERT_EQ(RC::SUCCESS, handler.insert_entry(reinterpret_cast<const char *>(&i), &rid));
+    }
+  }
+  ASSERT_TRUE(handler.validate_tree());
+  check_entries(1);
+
+  handler.close();
+}
+
+TEST(test_bplus_tree, test_bulk_load)
+{
+  filesystem::path test_directory("bplus_tree");
+  filesystem::remove_all(test_directory);
+  filesystem::create_directory(test_directory);
+
+  VacuousLogHandler log_handler;
+
+  // validate_tree 会同时pin住所有的页面，填充比例很低时页面很多
+  BufferPoolManager bpm(64 * 1024 * 1024);
+  ASSERT_EQ(RC::SUCCESS, bpm.init(make_unique<VacuousDoubleWriteBuffer>()));
+
+  // 乱序添加，每两个键值的 user_key 相同，按照(user_key, RID)排序之后第i个键值的RID是i
+  const int   key_num = 1000;
+  vector<int> keys;
+  for (int i = 0; i < key_num; i++) {
+    keys.push_back(i);
+  }
+  shuffle(keys.begin(), keys.end(), std::mt19937(key_num));
+
+  int case_index = 0;
+  for (int max_size : {ORDER, -1}) {
+    for (int fill_factor : {10, 70, 100}) {  // 10 会被调整成节点的最小元素个数
+      // 内存中排序和外部排序
+      for (int64_t sort_memory : {BplusTreeBulkLoader::DEFAULT_SORT_MEMORY, int64_t(1000)}) {
+        filesystem::path buffer_pool_file = test_directory / ("bulk_load_" + to_string(case_index++) + ".btree");
+        ASSERT_EQ(RC::SUCCESS, bpm.create_file(buffer_pool_file.c_str()));
+
+        DiskBufferPool *buffer_pool = nullptr;
+        ASSERT_EQ(RC::SUCCESS, bpm.open_file(log_handler, buffer_pool_file.c_str(), buffer_pool));
+
+        BplusTreeHandler handler;
+        ASSERT_EQ(RC::SUCCESS,
+            handler.create(log_handler, *buffer_pool, AttrType::INTS, sizeof(int), max_size, max_size));
+
+        {
+          BplusTreeBulkLoader loader(handler, fill_factor, sort_memory);
+          for (int key : keys) {
+            const int user_key = key / 2;
+            RID       rid(key, key);
+            ASSERT_EQ(RC::SUCCESS, loader.add(reinterpret_cast<const char *>(&user_key), rid));
+          }
+          ASSERT_EQ(RC::SUCCESS, loader.finish());
+          if (sort_memory == BplusTreeBulkLoader::DEFAULT_SORT_MEMORY) {
+            ASSERT_EQ(0, loader.run_num());
+          } else {
+            ASSERT_GT(loader.run_num(), 1);
+          }
+        }
+        // 排序用的临时文件已经删除
+        ASSERT_FALSE(filesystem::exists(buffer_pool_file.string() + ".sort.0"));
+        ASSERT_FALSE(handler.is_empty());
+        ASSERT_TRUE(handler.validate_tree());
+
+        {
+          BplusTreeScanner scanner(handler);
+          ASSERT_EQ(RC::SUCCESS, scanner.open(nullptr, 0, true, nullptr, 0, true));
+          int count    = 0;
+          int user_key = 0;
+          RID rid;
+          RC  rc = RC::SUCCESS;
+          while (OB_SUCC(rc = scanner.next_entry(rid, reinterpret_cast<char *>(&user_key)))) {
+            ASSERT_EQ(count, rid.page_num);
+            ASSERT_EQ(count / 2, user_key);
+            count++;
+          }
+          ASSERT_EQ(RC::RECORD_EOF, rc);
+          ASSERT_EQ(key_num, count);
+        }
+
+        for (int user_key = 0; user_key < key_num / 2; user_key += 37) {
+          list<RID> rids;
+          ASSERT_EQ(RC::SUCCESS, handler.get_entry(reinterpret_cast<const char *>(&user_key), sizeof(user_key), rids));
+          ASSERT_EQ(2, static_cast<int>(rids.size()));
+        }
+
+        // 批量构建之后还可以正常地插入和删除
+        for (int key = key_num; key < key_num + 200; key++) {
+          const int user_key = key % 100;
+          RID       rid(key, key);
+          ASSERT_EQ(RC::SUCCESS, handler.insert_entry(reinterpret_cast<const char *>(&user_key), &rid));
+        }
+        for (int key = 0; key < key_num; key += 2) {
+          const int user_key = key / 2;
+          RID       rid(key, key);
+          ASSERT_EQ(RC::SUCCESS, handler.delete_entry(reinterpret_cast<const char *>(&user_key), &rid));
+        }
+        ASSERT_TRUE(handler.validate_tree());
+
+        handler.close();
+      }
+    }
+  }
+
+  // 没有数据时B+树还是空的
+  filesystem::path buffer_pool_file = test_directory / "bulk_load_empty.btree";
+  ASSERT_EQ(RC::SUCCESS, bpm.create_file(buffer_pool_file.c_str()));
+  DiskBufferPool *buffer_pool = nullptr;
+  ASSERT_EQ(RC::SUCCESS, bpm.open_file(log_handler, buffer_pool_file.c_str(), buffer_pool));
+  BplusTreeHandler handler;
+  ASSERT_EQ(RC::SUCCESS, handler.create(log_handler, *buffer_pool, AttrType::INTS, sizeof(int), ORDER, ORDER));
+  BplusTreeBulkLoader loader(handler);
+  ASSERT_EQ(RC::SUCCESS, loader.finish());
+  ASSERT_TRUE(handler.is_empty());
+  handler.close();
+}
+
+TEST(test_bplus_tree, test_get_entries)
+{
+  filesystem::path test_directory("bplus_tree");
+  filesystem::path buffer_pool_file = test_directory / "get_entries.btree";
+  filesystem::remove_all(test_directory);
+  filesystem::create_directory(test_directory);
+
+  VacuousLogHandler log_handler;
+
+  BufferPoolManager bpm;
+  ASSERT_EQ(RC::SUCCESS, bpm.init(make_unique<VacuousDoubleWriteBuffer>()));
+  ASSERT_EQ(RC::SUCCESS, bpm.create_file(buffer_pool_file.c_str()));
+
+  DiskBufferPool *buffer_pool = nullptr;
+  ASSERT_EQ(RC::SUCCESS, bpm.open_file(log_handler, buffer_pool_file.c_str(), buffer_pool));
+
+  BplusTreeHandler handler;
+  ASSERT_EQ(RC::SUCCESS, handler.create(log_handler, *buffer_pool, AttrType::INTS, sizeof(int), ORDER, ORDER));
+
+  // 空树
+  {
+    const int   user_keys[] = {1, 2};
+    vector<RID> rids;
+    vector<int> offsets;
+    ASSERT_EQ(RC::SUCCESS, handler.get_entries(reinterpret_cast<const char *>(user_keys), sizeof(int), 2, rids, &offsets));
+    ASSERT_TRUE(rids.empty());
+    ASSERT_EQ((vector<int>{0, 0, 0}), offsets);
+  }
+
+  // 偶数键值，user_key 是 i 的数据有 i % 5 + 1 条，一个键值的数据会跨越多个叶子节点
+  const int key_num = 600;
+  for (int i = 0; i < key_num; i += 2) {
+    for (int j = 0; j <= i % 5; j++) {
+      RID rid(i, j);
+      ASSERT_EQ(RC::SUCCESS, handler.insert_entry(reinterpret_cast<const char *>(&i), &rid));
+    }
+  }
+
+  auto check_entries = [&handler](const vector<int> &user_keys) {
+    vector<RID> rids;
+    vector<int> offsets;
+    ASSERT_EQ(RC::SUCCESS,
+        handler.get_entries(
+            reinterpret_cast<const char *>(user_keys.data()), sizeof(int), user_keys.size(), rids, &offsets));
+    ASSERT_EQ(user_keys.size() + 1, offsets.size());
+    ASSERT_EQ(static_cast<int>(rids.size()), offsets.back());
+    for (size_t i = 0; i < user_keys.size(); i++) {
+      list<RID> expected;
+      ASSERT_EQ(RC::SUCCESS, handler.get_entry(reinterpret_cast<const char *>(&user_keys[i]), sizeof(int), expected));
+      ASSERT_EQ(vector<RID>(expected.begin(), expected.end()),
+          vector<RID>(rids.begin() + offsets[i], rids.begin() + offsets[i + 1]));
+    }
+  };
+
+  // 连续的键值，在当前叶子节点或者下一个叶子节点中
+  vector<int> user_keys;
+  for (int i = -3; i < key_num + 3; i++) {
+    user_keys.push_back(i);
+  }
+  check_entries(user_keys);
+
+  // 重复的键值，以及间隔较大需要从根节点重新查找的键值
+  user_keys = {0, 0, 4, 4, 4, 5, 100, 101, 102, 102, 350, 598, 598, key_num};
+  check_entries(user_keys);
+  check_entries({});
+  check_entries({key_num * 2});
+
+  // 不传 offsets 时结果追加到 rids 后面
+  {
+    const int   keys[] = {8, 10};
+    vector<RID> rids(1);
+    ASSERT_EQ(RC::SUCCESS, handler.get_entries(reinterpret_cast<const char *>(keys), sizeof(int), 2, rids));
+    ASSERT_EQ(1 + 4 + 1, static_cast<int>(rids.size()));
+  }
+
+  // 键值没有排序
+  {
+    const int   keys[] = {10, 8};
+    vector<RID> rids;
+    ASSERT_EQ(RC::INVALID_ARGUMENT, handler.get_entries(reinterpret_cast<const char *>(keys), sizeof(int), 2, rids));
+  }
+
+  handler.close();
+}
+
+TEST(test_bplus_tree, test_prefix_compression)
+{
+  filesystem::path test_directory("bplus_tree");
+  filesystem::remove_all(test_directory);
+  filesystem::create_directory(test_directory);
+
+  VacuousLogHandler log_handler;
+
+  // validate_tree 会同时pin住所有的页面
+  BufferPoolManager bpm(64 * 1024 * 1024);
+  ASSERT_EQ(RC::SUCCESS, bpm.init(make_unique<VacuousDoubleWriteBuffer>()));
+
+  const int attr_length = 64;
+  const int capacity    = (BP_PAGE_DATA_SIZE - LeafIndexNode::HEADER_SIZE) / (attr_length + 2 * sizeof(RID));
+
+  // 第一组键值有很长的公共前缀，第二组键值是随机的字母，几乎没有公共前缀，叶子节点按照字节数分裂
+  std::mt19937   random(attr_length);
+  vector<string> prefixed_keys;
+  vector<string> random_keys;
+  for (int i = 0; i < 10000; i++) {
+    char buf[attr_length + 1];
+    snprintf(buf, sizeof(buf), "%s%016d", string(attr_length - 16, 'p').c_str(), i);
+    prefixed_keys.emplace_back(buf, attr_length);
+  }
+  shuffle(prefixed_keys.begin(), prefixed_keys.end(), random);
+  for (int i = 0; i < 3000; i++) {
+    string key(attr_length, 'a');
+    for (char &c : key) {
+      c = static_cast<char>('a' + random() % 26);
+    }
+    random_keys.push_back(key);
+  }
+
+  int case_index = 0;
+  for (const vector<string> *keys : {&prefixed_keys, &random_keys}) {
+    const int      key_num  = static_cast<int>(keys->size());
+    vector<string> sorted_keys(*keys);
+    sort(sorted_keys.begin(), sorted_keys.end());
+
+    // RID 的页号是键值在 keys 中的下标
+    auto check_tree = [&](BplusTreeHandler &handler) {
+      ASSERT_TRUE(handler.validate_tree());
+
+      BplusTreeScanner scanner(handler);
+      ASSERT_EQ(RC::SUCCESS, scanner.open(nullptr, 0, true, nullptr, 0, true));
+      char user_key[attr_length];
+      RID  rid;
+      RC   rc    = RC::SUCCESS;
+      int  count = 0;
+      while (OB_SUCC(rc = scanner.next_entry(rid, user_key))) {
+        ASSERT_LT(count, key_num);
+        ASSERT_EQ(sorted_keys[count], string(user_key, attr_length));
+        ASSERT_EQ((*keys)[rid.page_num], sorted_keys[count]);
+        count++;
+      }
+      ASSERT_EQ(RC::RECORD_EOF, rc);
+      ASSERT_EQ(key_num, count);
+
+      for (int i = 0; i < key_num; i += 97) {
+        list<RID> rids;
+        ASSERT_EQ(RC::SUCCESS, handler.get_entry((*keys)[i].data(), attr_length, rids));
+        ASSERT_EQ(1, static_cast<int>(rids.size()));
+        ASSERT_EQ(i, rids.front().page_num);
+      }
+    };
+
+    // 逐条插入
+    {
+      filesystem::path buffer_pool_file = test_directory / ("prefix_" + to_string(case_index++) + ".btree");
+      ASSERT_EQ(RC::SUCCESS, bpm.create_file(buffer_pool_file.c_str()));
+      DiskBufferPool *buffer_pool = nullptr;
+      ASSERT_EQ(RC::SUCCESS, bpm.open_file(log_handler, buffer_pool_file.c_str(), buffer_pool));
+
+      BplusTreeHandler handler;
+      ASSERT_EQ(RC::SUCCESS, handler.create(log_handler, *buffer_pool, AttrType::CHARS, attr_length));
+      ASSERT_NE(0, handler.file_header().leaf_prefix_compression);
+      ASSERT_GT(handler.file_header().leaf_max_size, capacity);
+
+      for (int i = 0; i < key_num; i++) {
+        RID rid(i, i);
+        ASSERT_EQ(RC::SUCCESS, handler.insert_entry((*keys)[i].data(), &rid));
+      }
+      check_tree(handler);
+      if (keys == &prefixed_keys) {
+        // 不压缩时叶子节点就需要 key_num / capacity 个页面
+        ASSERT_LT(buffer_pool->page_count(), key_num / capacity);
+      }
+
+      for (int i = 0; i < key_num; i += 2) {
+        RID rid(i, i);
+        ASSERT_EQ(RC::SUCCESS, handler.delete_entry((*keys)[i].data(), &rid));
+      }
+      ASSERT_TRUE(handler.validate_tree());
+      for (int i = 1; i < key_num; i += 2) {
+        RID rid(i, i);
+        ASSERT_EQ(RC::SUCCESS, handler.delete_entry((*keys)[i].data(), &rid));
+      }
+      ASSERT_TRUE(handler.is_empty());
+      handler.close();
+    }
+
+    // 批量构建
+    {
+      filesystem::path buffer_pool_file = test_directory / ("prefix_" + to_string(case_index++) + ".btree");
+      ASSERT_EQ(RC::SUCCESS, bpm.create_file(buffer_pool_file.c_str()));
+      DiskBufferPool *buffer_pool = nullptr;
+      ASSERT_EQ(RC::SUCCESS, bpm.open_file(log_handler, buffer_pool_file.c_str(), buffer_pool));
+
+      BplusTreeHandler handler;
+      ASSERT_EQ(RC::SUCCESS, handler.create(log_handler, *buffer_pool, AttrType::CHARS, attr_length));
+      {
+        BplusTreeBulkLoader loader(handler, 100 /*fill_factor*/);
+        for (int i = 0; i < key_num; i++) {
+          ASSERT_EQ(RC::SUCCESS, loader.add((*keys)[i].data(), RID(i, i)));
+        }
+        ASSERT_EQ(RC::SUCCESS, loader.finish());
+      }
+      check_tree(handler);
+      if (keys == &prefixed_keys) {
+        ASSERT_LT(buffer_pool->page_count(), key_num / capacity / 2 + 10);
+      }
+
+      for (int i = 0; i < key_num; i += 3) {
+        RID rid(i, i);
+        ASSERT_EQ(RC::SUCCESS, handler.delete_entry((*keys)[i].data(), &rid));
+      }
+      ASSERT_TRUE(handler.validate_tree());
+      handler.close();
+    }
+  }
+}
+
 TEST(test_bplus_tree, test_bplus_tree_insert)
 {
   LoggerFactory::init_default("test.log");
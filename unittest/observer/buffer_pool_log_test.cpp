@@ -20,6 +20,8 @@ See the Mulan PSL v2 for more details. */
 #include "storage/clog/disk_log_handler.h"
 #include "storage/buffer/buffer_pool_log.h"
 #include "storage/buffer/double_write_buffer.h"
+#include "storage/clog/integrated_log_replayer.h"
+#include "storage/trx/vacuous_trx.h"
 
 using namespace std;
 using namespace common;
@@ -393,6 +395,92 @@ TEST(BufferPoolLog, test_wal_multi_files)
   ASSERT_EQ(RC::SUCCESS, log_handler2.await_termination());
 }
 
+TEST(BufferPoolLog, test_wal_parallel_replay)
+{
+  /// 与 test_wal_multi_files 相同，但是使用多个线程回放日志
+  filesystem::path test_path("test_disk_buffer_pool_wal_parallel_replay");
+  filesystem::path clog_path = test_path / "clog";
+
+  filesystem::remove_all(test_path);
+  filesystem::create_directory(test_path);
+
+  vector<filesystem::path> buffer_pool_filenames;
+  const int                buffer_pool_file_num = 10;
+  for (int i = 0; i < buffer_pool_file_num; i++) {
+    buffer_pool_filenames.push_back(test_path / ("buffer_pool_" + to_string(i) + ".bp"));
+  }
+
+  BufferPoolManager buffer_pool_manager;
+  ASSERT_EQ(RC::SUCCESS, buffer_pool_manager.init(make_unique<VacuousDoubleWriteBuffer>()));
+
+  DiskLogHandler           log_handler;
+  vector<DiskBufferPool *> buffer_pools;
+  for (const filesystem::path &filename : buffer_pool_filenames) {
+    DiskBufferPool *buffer_pool = nullptr;
+    ASSERT_EQ(RC::SUCCESS, buffer_pool_manager.create_file(filename.c_str()));
+    ASSERT_EQ(RC::SUCCESS, buffer_pool_manager.open_file(log_handler, filename.c_str(), buffer_pool));
+    buffer_pools.push_back(buffer_pool);
+  }
+
+  BufferPoolLogReplayer log_replayer(buffer_pool_manager);
+  ASSERT_EQ(RC::SUCCESS, log_handler.init(clog_path.c_str()));
+  ASSERT_EQ(RC::SUCCESS, log_handler.replay(log_replayer, 0));
+  ASSERT_EQ(RC::SUCCESS, log_handler.start());
+
+  const int allocate_page_num   = 200;
+  const int deallocate_page_num = 50;
+  for (int i = 0; i < allocate_page_num; i++) {
+    for (DiskBufferPool *buffer_pool : buffer_pools) {
+      Frame *frame = nullptr;
+      ASSERT_EQ(RC::SUCCESS, buffer_pool->allocate_page(&frame));
+      ASSERT_EQ(RC::SUCCESS, buffer_pool->unpin_page(frame));
+    }
+  }
+  for (int i = 1; i <= deallocate_page_num; i++) {
+    for (DiskBufferPool *buffer_pool : buffer_pools) {
+      ASSERT_EQ(RC::SUCCESS, buffer_pool->dispose_page(i * 2));
+    }
+  }
+  ASSERT_EQ(RC::SUCCESS, log_handler.stop());
+  ASSERT_EQ(RC::SUCCESS, log_handler.await_termination());
+
+  for (const filesystem::path &filename : buffer_pool_filenames) {
+    ASSERT_EQ(RC::SUCCESS, buffer_pool_manager.close_file(filename.c_str()));
+    ASSERT_TRUE(filesystem::remove(filename));
+  }
+  buffer_pools.clear();
+
+  BufferPoolManager buffer_pool_manager2;
+  ASSERT_EQ(RC::SUCCESS, buffer_pool_manager2.init(make_unique<VacuousDoubleWriteBuffer>()));
+
+  DiskLogHandler log_handler2;
+  for (const filesystem::path &filename : buffer_pool_filenames) {
+    DiskBufferPool *buffer_pool = nullptr;
+    ASSERT_EQ(RC::SUCCESS, buffer_pool_manager2.create_file(filename.c_str()));
+    ASSERT_EQ(RC::SUCCESS, buffer_pool_manager2.open_file(log_handler2, filename.c_str(), buffer_pool));
+    buffer_pools.push_back(buffer_pool);
+  }
+
+  const int             worker_num = 4;
+  IntegratedLogReplayer log_replayer2(buffer_pool_manager2, make_unique<VacuousTrxLogReplayer>(), worker_num);
+  ASSERT_EQ(RC::SUCCESS, log_handler2.init(clog_path.c_str()));
+  ASSERT_EQ(RC::SUCCESS, log_handler2.replay(log_replayer2, 0));
+  ASSERT_EQ(RC::SUCCESS, log_replayer2.on_done());
+  for (DiskBufferPool *buffer_pool : buffer_pools) {
+    ASSERT_EQ(allocate_page_num - deallocate_page_num, buffer_pool_page_count(buffer_pool));
+  }
+
+  ASSERT_EQ(RC::SUCCESS, log_handler2.start());
+  for (const filesystem::path &filename : buffer_pool_filenames) {
+    ASSERT_EQ(RC::SUCCESS, buffer_pool_manager2.close_file(filename.c_str()));
+  }
+  buffer_pools.clear();
+  ASSERT_EQ(RC::SUCCESS, log_handler2.stop());
+  ASSERT_EQ(RC::SUCCESS, log_handler2.await_termination());
+
+  filesystem::remove_all(test_path);
+}
+
 int main(int argc, char **argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -58,6 +58,32 @@ TEST(ChunkTest, chunk_test)
       ASSERT_EQ(chunk2.get_value(1, i).get_float(), value2);
     }
   }
+  // select and hold
+  {
+    int   row_num = 4;
+    int   values[] = {1, 2, 3, 4};
+    Chunk chunk;
+    chunk.add_column(std::make_unique<Column>(AttrType::INTS, sizeof(int), row_num), 0);
+    chunk.column(0).reference((char *)values, row_num);
+    chunk.select() = {1, 0, 1, 0};
+
+    auto resource = std::make_shared<int>(0);
+    chunk.hold(resource);
+    ASSERT_EQ(chunk.rows(), row_num);
+    ASSERT_EQ(chunk.selected_rows(), 2);
+    ASSERT_EQ(chunk.column(0).data(), (char *)values);
+
+    Chunk chunk2;
+    chunk2.reference(chunk);
+    ASSERT_EQ(chunk2.selected_rows(), 2);
+    ASSERT_EQ(chunk2.get_value(0, 2).get_int(), 3);
+
+    chunk.reset_data();
+    ASSERT_FALSE(chunk.has_select());
+    ASSERT_EQ(resource.use_count(), 2);
+    chunk2.reset();
+    ASSERT_EQ(resource.use_count(), 1);
+  }
 }
 
 int main(int argc, char **argv)
@@ -0,0 +1,150 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <string.h>
+
+#include "storage/common/column_encoding.h"
+#include "gtest/gtest.h"
+
+using namespace std;
+
+// 编码后逐个比较解码和随机访问的结果
+static void check_round_trip(const vector<char> &encoded, const char *values, int count, int attr_len)
+{
+  EncodedColumn column(encoded.data());
+  ASSERT_EQ(column.count(), count);
+  ASSERT_EQ(column.attr_len(), attr_len);
+  ASSERT_EQ(column.size(), static_cast<int>(encoded.size()));
+
+  vector<char> decoded(count * attr_len);
+  column.decode(decoded.data());
+  ASSERT_EQ(0, memcmp(decoded.data(), values, decoded.size()));
+
+  vector<char> value(attr_len);
+  for (int i = 0; i < count; i++) {
+    column.get(i, value.data());
+    ASSERT_EQ(0, memcmp(value.data(), values + i * attr_len, attr_len)) << "i=" << i;
+  }
+}
+
+TEST(ColumnEncoding, round_trip)
+{
+  const int   count = 1000;
+  vector<int> runs(count);
+  vector<int> small_range(count);
+  vector<int> random_values(count);
+  for (int i = 0; i < count; i++) {
+    runs[i]          = i / 64;
+    small_range[i]   = -100 + (i * 7) % 37;
+    random_values[i] = static_cast<int>((i * 2654435761u) ^ 0x5bd1e995);
+  }
+
+  const vector<ColumnEncoding> encodings = {ColumnEncoding::PLAIN, ColumnEncoding::RLE,
+      ColumnEncoding::FRAME_OF_REFERENCE};
+  for (const vector<int> *values : {&runs, &small_range, &random_values}) {
+    for (ColumnEncoding encoding : encodings) {
+      vector<char> encoded;
+      ColumnEncoder::encode(encoding, AttrType::INTS, sizeof(int), (const char *)values->data(), count, encoded);
+      ASSERT_EQ(EncodedColumn(encoded.data()).encoding(), encoding);
+      check_round_trip(encoded, (const char *)values->data(), count, sizeof(int));
+    }
+  }
+
+  // 字符串使用字典编码
+  vector<char> names(count * 4);
+  const char  *dict[] = {"abcd", "efgh", "ijkl", "mnop", "qrst"};
+  for (int i = 0; i < count; i++) {
+    memcpy(names.data() + i * 4, dict[(i * 3) % 5], 4);
+  }
+  vector<char> encoded;
+  ColumnEncoder::encode(ColumnEncoding::DICTIONARY, AttrType::CHARS, 4, names.data(), count, encoded);
+  check_round_trip(encoded, names.data(), count, 4);
+}
+
+TEST(ColumnEncoding, choose_smallest)
+{
+  const int   count = 1000;
+  vector<int> values(count);
+  for (int i = 0; i < count; i++) {
+    values[i] = i / 100;
+  }
+
+  vector<char> encoded;
+  ColumnEncoder::encode(AttrType::INTS, sizeof(int), (const char *)values.data(), count, encoded);
+  EncodedColumn column(encoded.data());
+  ASSERT_EQ(column.encoding(), ColumnEncoding::RLE);
+  ASSERT_LT(column.size(), count * static_cast<int>(sizeof(int)) / 10);
+
+  for (int i = 0; i < count; i++) {
+    values[i] = 1000 + i % 16;
+  }
+  encoded.clear();
+  ColumnEncoder::encode(AttrType::INTS, sizeof(int), (const char *)values.data(), count, encoded);
+  ASSERT_EQ(EncodedColumn(encoded.data()).encoding(), ColumnEncoding::FRAME_OF_REFERENCE);
+  check_round_trip(encoded, (const char *)values.data(), count, sizeof(int));
+
+  // 浮点数不能使用 FRAME_OF_REFERENCE
+  vector<float> floats(count);
+  for (int i = 0; i < count; i++) {
+    floats[i] = i * 0.5f;
+  }
+  encoded.clear();
+  ColumnEncoder::encode(AttrType::FLOATS, sizeof(float), (const char *)floats.data(), count, encoded);
+  ASSERT_EQ(EncodedColumn(encoded.data()).encoding(), ColumnEncoding::PLAIN);
+  check_round_trip(encoded, (const char *)floats.data(), count, sizeof(float));
+}
+
+TEST(ColumnEncoding, filter_and_sum)
+{
+  const int   count = 777;
+  vector<int> values(count);
+  for (int i = 0; i < count; i++) {
+    values[i] = (i / 10) % 30 - 5;
+  }
+
+  const vector<CompOp> ops = {EQUAL_TO, NOT_EQUAL, LESS_THAN, LESS_EQUAL, GREAT_THAN, GREAT_EQUAL};
+  for (ColumnEncoding encoding :
+      {ColumnEncoding::PLAIN, ColumnEncoding::RLE, ColumnEncoding::FRAME_OF_REFERENCE}) {
+    vector<char> encoded;
+    ColumnEncoder::encode(encoding, AttrType::INTS, sizeof(int), (const char *)values.data(), count, encoded);
+    EncodedColumn column(encoded.data());
+
+    int expected_sum = 0;
+    for (int value : values) {
+      expected_sum += value;
+    }
+    ASSERT_EQ(column.sum<int>(), expected_sum);
+
+    for (CompOp op : ops) {
+      // 常量在取值范围内、小于最小值、大于最大值
+      for (int constant : {3, -100, 100}) {
+        vector<uint8_t> select(count, 1);
+        select[0] = 0;  // 与已有的结果做与运算
+        column.filter<int>(op, constant, select.data());
+        for (int i = 0; i < count; i++) {
+          bool expected = false;
+          switch (op) {
+            case EQUAL_TO: expected = values[i] == constant; break;
+            case NOT_EQUAL: expected = values[i] != constant; break;
+            case LESS_THAN: expected = values[i] < constant; break;
+            case LESS_EQUAL: expected = values[i] <= constant; break;
+            case GREAT_THAN: expected = values[i] > constant; break;
+            case GREAT_EQUAL: expected = values[i] >= constant; break;
+            default: break;
+          }
+          expected = expected && i != 0;
+          ASSERT_EQ(select[i] != 0, expected)
+              << "encoding=" << column_encoding_name(encoding) << ", op=" << op << ", constant=" << constant
+              << ", i=" << i;
+        }
+      }
+    }
+  }
+}
@@ -12,6 +12,8 @@ See the Mulan PSL v2 for more details. */
 // Created by wangyunlai on 2024/02/01
 //
 
+#include <fcntl.h>
+#include <unistd.h>
 #include <filesystem>
 
 #include "gtest/gtest.h"
@@ -132,6 +134,239 @@ TEST(BufferPool, create)
   ASSERT_EQ(buffer_pool->id(), buffer_pool2->id());
 }
 
+int dirty_frame_count(BPFrameManager &frame_manager, int buffer_pool_id)
+{
+  int count = 0;
+  for (Frame *frame : frame_manager.find_list(buffer_pool_id)) {
+    if (frame->dirty() && frame->page_num() != BP_HEADER_PAGE) {
+      count++;
+    }
+    frame->unpin();
+  }
+  return count;
+}
+
+TEST(PageCleaner, clean)
+{
+  filesystem::path directory("buffer_pool");
+  filesystem::remove_all(directory);
+  filesystem::create_directories(directory);
+  filesystem::path bp_file = directory / "page_cleaner.bp";
+
+  // 只有128个页帧
+  const int         frame_num = DEFAULT_ITEM_NUM_PER_POOL;
+  BufferPoolManager bpm(frame_num * BP_PAGE_SIZE);
+  ASSERT_EQ(RC::SUCCESS, bpm.init(make_unique<VacuousDoubleWriteBuffer>()));
+  ASSERT_EQ(RC::SUCCESS, bpm.create_file(bp_file.c_str()));
+
+  VacuousLogHandler log_handler;
+  DiskBufferPool   *buffer_pool = nullptr;
+  ASSERT_EQ(RC::SUCCESS, bpm.open_file(log_handler, bp_file.c_str(), buffer_pool));
+
+  const int page_num = 100;
+  for (int i = 0; i < page_num; i++) {
+    Frame *frame = nullptr;
+    ASSERT_EQ(RC::SUCCESS, buffer_pool->allocate_page(&frame));
+    memset(frame->data(), i, BP_PAGE_DATA_SIZE);
+    frame->mark_dirty();
+    ASSERT_EQ(RC::SUCCESS, buffer_pool->unpin_page(frame));
+  }
+
+  BPFrameManager &frame_manager = bpm.get_frame_manager();
+  ASSERT_EQ(page_num, dirty_frame_count(frame_manager, buffer_pool->id()));
+
+  // 空闲页帧已经足够时，不会刷任何页面
+  PageCleaner &cleaner = bpm.page_cleaner();
+  ASSERT_EQ(0, cleaner.clean(frame_num - page_num - 1));
+  ASSERT_EQ(page_num, dirty_frame_count(frame_manager, buffer_pool->id()));
+
+  // 每次最多刷一批
+  ASSERT_EQ(PageCleaner::BATCH_SIZE, cleaner.clean(frame_num));
+  ASSERT_EQ(page_num - PageCleaner::BATCH_SIZE, dirty_frame_count(frame_manager, buffer_pool->id()));
+
+  // 刷盘期间又被使用的页面，依然是脏的
+  vector<Frame *> frames;
+  vector<Page>    pages;
+  frame_manager.pick_dirty_frames(frame_num, 1, frames, pages);
+  ASSERT_EQ(1, static_cast<int>(frames.size()));
+  Frame *frame = nullptr;
+  ASSERT_EQ(RC::SUCCESS, buffer_pool->get_this_page(frames[0]->page_num(), &frame));
+  ASSERT_FALSE(frame_manager.finish_clean(frames[0], pages[0]));
+  ASSERT_TRUE(frame->dirty());
+  ASSERT_EQ(RC::SUCCESS, buffer_pool->unpin_page(frame));
+
+  while (cleaner.clean(frame_num) > 0) {}
+  ASSERT_EQ(0, dirty_frame_count(frame_manager, buffer_pool->id()));
+
+  // 没有脏页时，淘汰页面不需要写磁盘，数据也都在磁盘上了
+  ASSERT_EQ(RC::SUCCESS, bpm.close_file(bp_file.c_str()));
+  ASSERT_EQ(RC::SUCCESS, bpm.open_file(log_handler, bp_file.c_str(), buffer_pool));
+  for (int i = 0; i < page_num; i++) {
+    ASSERT_EQ(RC::SUCCESS, buffer_pool->get_this_page(i + 1, &frame));
+    ASSERT_EQ(static_cast<char>(i), frame->data()[0]);
+    ASSERT_EQ(static_cast<char>(i), frame->data()[BP_PAGE_DATA_SIZE - 1]);
+    ASSERT_EQ(RC::SUCCESS, buffer_pool->unpin_page(frame));
+  }
+  ASSERT_EQ(RC::SUCCESS, bpm.close_file(bp_file.c_str()));
+}
+
+TEST(PageCleaner, background)
+{
+  filesystem::path directory("buffer_pool");
+  filesystem::remove_all(directory);
+  filesystem::create_directories(directory);
+  filesystem::path bp_file = directory / "page_cleaner_background.bp";
+
+  // 页面个数远多于页帧个数，前台会不停地淘汰页面，同时刷脏线程在后台刷盘
+  const int         frame_num = DEFAULT_ITEM_NUM_PER_POOL;
+  BufferPoolManager bpm(frame_num * BP_PAGE_SIZE);
+  ASSERT_EQ(RC::SUCCESS, bpm.init(make_unique<VacuousDoubleWriteBuffer>()));
+  ASSERT_EQ(RC::SUCCESS, bpm.create_file(bp_file.c_str()));
+  ASSERT_EQ(RC::SUCCESS, bpm.page_cleaner().start(frame_num / 4));
+
+  VacuousLogHandler log_handler;
+  DiskBufferPool   *buffer_pool = nullptr;
+  ASSERT_EQ(RC::SUCCESS, bpm.open_file(log_handler, bp_file.c_str(), buffer_pool));
+
+  const int page_num = frame_num * 4;
+  for (int i = 0; i < page_num; i++) {
+    Frame *frame = nullptr;
+    ASSERT_EQ(RC::SUCCESS, buffer_pool->allocate_page(&frame));
+    memset(frame->data(), i, BP_PAGE_DATA_SIZE);
+    frame->mark_dirty();
+    ASSERT_EQ(RC::SUCCESS, buffer_pool->unpin_page(frame));
+  }
+
+  for (int round = 0; round < 3; round++) {
+    for (int i = 0; i < page_num; i++) {
+      Frame *frame = nullptr;
+      ASSERT_EQ(RC::SUCCESS, buffer_pool->get_this_page(i + 1, &frame));
+      ASSERT_EQ(static_cast<char>(i + round), frame->data()[0]);
+      memset(frame->data(), i + round + 1, BP_PAGE_DATA_SIZE);
+      frame->mark_dirty();
+      ASSERT_EQ(RC::SUCCESS, buffer_pool->unpin_page(frame));
+    }
+  }
+
+  ASSERT_EQ(RC::SUCCESS, bpm.close_file(bp_file.c_str()));
+  bpm.page_cleaner().stop();
+
+  ASSERT_EQ(RC::SUCCESS, bpm.open_file(log_handler, bp_file.c_str(), buffer_pool));
+  for (int i = 0; i < page_num; i++) {
+    Frame *frame = nullptr;
+    ASSERT_EQ(RC::SUCCESS, buffer_pool->get_this_page(i + 1, &frame));
+    ASSERT_EQ(static_cast<char>(i + 3), frame->data()[0]);
+    ASSERT_EQ(static_cast<char>(i + 3), frame->data()[BP_PAGE_DATA_SIZE - 1]);
+    ASSERT_EQ(RC::SUCCESS, buffer_pool->unpin_page(frame));
+  }
+  ASSERT_EQ(RC::SUCCESS, bpm.close_file(bp_file.c_str()));
+}
+
+TEST(PagePrefetcher, read_ahead)
+{
+  filesystem::path directory("buffer_pool");
+  filesystem::remove_all(directory);
+  filesystem::create_directories(directory);
+  filesystem::path bp_file = directory / "page_prefetcher.bp";
+
+  BufferPoolManager bpm;
+  ASSERT_EQ(RC::SUCCESS, bpm.init(make_unique<VacuousDoubleWriteBuffer>()));
+  ASSERT_EQ(RC::SUCCESS, bpm.create_file(bp_file.c_str()));
+
+  VacuousLogHandler log_handler;
+  DiskBufferPool   *buffer_pool = nullptr;
+  ASSERT_EQ(RC::SUCCESS, bpm.open_file(log_handler, bp_file.c_str(), buffer_pool));
+
+  const int page_num = 64;
+  for (int i = 0; i < page_num; i++) {
+    Frame *frame = nullptr;
+    ASSERT_EQ(RC::SUCCESS, buffer_pool->allocate_page(&frame));
+    memset(frame->data(), i, BP_PAGE_DATA_SIZE);
+    frame->mark_dirty();
+    ASSERT_EQ(RC::SUCCESS, buffer_pool->unpin_page(frame));
+  }
+  // 删除一个页面，预读时要跳过它
+  ASSERT_EQ(RC::SUCCESS, buffer_pool->dispose_page(5));
+  ASSERT_EQ(RC::SUCCESS, bpm.close_file(bp_file.c_str()));
+
+  const int window = 8;
+  ASSERT_EQ(RC::SUCCESS, bpm.page_prefetcher().start(window));
+  ASSERT_EQ(window, bpm.page_prefetcher().window());
+  ASSERT_EQ(RC::SUCCESS, bpm.open_file(log_handler, bp_file.c_str(), buffer_pool));
+
+  BPFrameManager    &frame_manager = bpm.get_frame_manager();
+  BufferPoolIterator iterator;
+  ASSERT_EQ(RC::SUCCESS, iterator.init(*buffer_pool, 1, true /*read_ahead*/));
+  ASSERT_EQ(1, iterator.next());
+  buffer_pool->wait_read_ahead();
+
+  // 访问第一个页面时，预读了后面的window个页面
+  ASSERT_FALSE(frame_manager.contains(buffer_pool->id(), 5));
+  for (PageNum page = 2; page <= window + 2; page++) {
+    ASSERT_EQ(page != 5, frame_manager.contains(buffer_pool->id(), page));
+  }
+  ASSERT_FALSE(frame_manager.contains(buffer_pool->id(), window + 3));
+
+  // 预读的页面与从磁盘直接读取的一样
+  int count = 0;
+  for (PageNum page = 1; page != -1; page = iterator.next()) {
+    Frame *frame = nullptr;
+    ASSERT_EQ(RC::SUCCESS, buffer_pool->get_this_page(page, &frame));
+    ASSERT_EQ(static_cast<char>(page - 1), frame->data()[0]);
+    ASSERT_EQ(static_cast<char>(page - 1), frame->data()[BP_PAGE_DATA_SIZE - 1]);
+    ASSERT_EQ(RC::SUCCESS, buffer_pool->unpin_page(frame));
+    count++;
+  }
+  ASSERT_EQ(page_num - 1, count);
+  ASSERT_EQ(RC::SUCCESS, bpm.close_file(bp_file.c_str()));
+  bpm.page_prefetcher().stop();
+  ASSERT_EQ(0, bpm.page_prefetcher().window());
+}
+
+TEST(PageIoBackend, read_write)
+{
+  filesystem::path directory("buffer_pool");
+  filesystem::remove_all(directory);
+  filesystem::create_directories(directory);
+  filesystem::path file = directory / "page_io.bp";
+
+  for (const char *name : {"sync", "thread_pool", "io_uring"}) {
+    unique_ptr<PageIoBackend> page_io = PageIoBackend::create(name);
+    ASSERT_NE(nullptr, page_io);
+
+    int fd = open(file.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    ASSERT_GE(fd, 0);
+
+    // 页面编号倒着写，后面的请求可能先完成
+    const int    page_num = 16;
+    vector<Page> pages(page_num);
+    PageIoBatch  write_batch;
+    for (int i = page_num - 1; i >= 0; i--) {
+      memset(pages[i].data, i, BP_PAGE_DATA_SIZE);
+      write_batch.add_write(fd, static_cast<int64_t>(i) * BP_PAGE_SIZE, &pages[i], BP_PAGE_SIZE);
+    }
+    ASSERT_EQ(RC::SUCCESS, page_io->execute(write_batch));
+
+    // 最后一个请求超出了文件末尾，只能读到一个页面
+    vector<Page> read_pages(page_num + 1);
+    PageIoBatch  read_batch;
+    read_batch.add_read(fd, 0, read_pages.data(), static_cast<int64_t>(page_num - 1) * BP_PAGE_SIZE);
+    read_batch.add_read(
+        fd, static_cast<int64_t>(page_num - 1) * BP_PAGE_SIZE, &read_pages[page_num - 1], 2 * BP_PAGE_SIZE);
+    ASSERT_EQ(RC::SUCCESS, page_io->submit(read_batch));
+    ASSERT_EQ(RC::SUCCESS, read_batch.wait());
+    ASSERT_EQ((page_num - 1) * BP_PAGE_SIZE, read_batch.request(0).done_size);
+    ASSERT_EQ(BP_PAGE_SIZE, read_batch.request(1).done_size);
+    for (int i = 0; i < page_num; i++) {
+      ASSERT_EQ(0, memcmp(&pages[i], &read_pages[i], BP_PAGE_SIZE)) << "backend " << name << ", page " << i;
+    }
+
+    close(fd);
+  }
+
+  ASSERT_EQ(nullptr, PageIoBackend::create("unknown"));
+}
+
 int main(int argc, char **argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -180,6 +180,47 @@ TEST(DiskLogHandler, multi_thread)
   ASSERT_EQ(RC::SUCCESS, handler.await_termination());
 }
 
+TEST(DiskLogHandler, group_commit)
+{
+  // many threads append and wait for their own log entries, every waiter should be woken up
+  // after its entry is flushed
+  const char *directory = "test_log_handler_group_commit";
+  filesystem::remove_all(directory);
+
+  DiskLogHandler  handler;
+  TestLogReplayer replayer;
+  ASSERT_EQ(RC::SUCCESS, handler.init(directory));
+  ASSERT_EQ(RC::SUCCESS, handler.replay(replayer, 0));
+  ASSERT_EQ(RC::SUCCESS, handler.start());
+
+  const int          times = 2000;
+  atomic<int>        failed_count{0};
+  ThreadPoolExecutor executor;
+  ASSERT_EQ(0, executor.init("TestGroupCommit", 8, 8, 60 * 1000));
+
+  for (int i = 0; i < times; ++i) {
+    ASSERT_EQ(0, executor.execute([&handler, &failed_count]() -> void {
+      LSN          lsn = 0;
+      vector<char> data(10);
+      if (handler.append(lsn, LogModule::Id::BUFFER_POOL, std::move(data)) != RC::SUCCESS ||
+          handler.wait_lsn(lsn) != RC::SUCCESS || handler.current_flushed_lsn() < lsn) {
+        failed_count++;
+      }
+    }));
+  }
+
+  ASSERT_EQ(0, executor.shutdown());
+  ASSERT_EQ(0, executor.await_termination());
+  ASSERT_EQ(0, failed_count.load());
+  ASSERT_EQ(handler.current_flushed_lsn(), times);
+  ASSERT_TRUE(handler.waiters_.empty());
+
+  ASSERT_EQ(RC::SUCCESS, handler.stop());
+  ASSERT_EQ(RC::SUCCESS, handler.await_termination());
+
+  filesystem::remove_all(directory);
+}
+
 int main(int argc, char **argv)
 {
   testing::InitGoogleTest(&argc, argv);
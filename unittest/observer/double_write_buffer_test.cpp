@@ -201,6 +201,63 @@ TEST(DoubleWriteBuffer, single_file_exception)
   bpm  = nullptr;
 }
 
+TEST(DoubleWriteBuffer, batch_flush)
+{
+  /*
+  页面先攒在内存中，攒满一批之后才会写到文件中
+  */
+  filesystem::path directory("double_write_buffer_test_batch_flush_dir");
+  filesystem::remove_all(directory);
+  filesystem::create_directories(directory);
+
+  filesystem::path buffer_pool_filename         = directory / "buffer_pool.bp";
+  filesystem::path double_write_buffer_filename = directory / "double_write_buffer.dwb";
+
+  const int         max_pages = 8;
+  auto              bpm       = make_unique<BufferPoolManager>();
+  VacuousLogHandler log_handler;
+  auto              double_write_buffer = make_unique<DiskDoubleWriteBuffer>(*bpm, max_pages);
+  ASSERT_EQ(RC::SUCCESS, double_write_buffer->open_file(double_write_buffer_filename.c_str()));
+  ASSERT_EQ(bpm->init(std::move(double_write_buffer)), RC::SUCCESS);
+  auto *disk_double_write_buffer = static_cast<DiskDoubleWriteBuffer *>(bpm->get_dblwr_buffer());
+
+  DiskBufferPool *buffer_pool = nullptr;
+  ASSERT_EQ(RC::SUCCESS, bpm->create_file(buffer_pool_filename.c_str()));
+  ASSERT_EQ(RC::SUCCESS, bpm->open_file(log_handler, buffer_pool_filename.c_str(), buffer_pool));
+
+  auto file_page_count = [&buffer_pool_filename]() {
+    return static_cast<int>(filesystem::file_size(buffer_pool_filename) / BP_PAGE_SIZE);
+  };
+
+  // 同一个页面加入多次只占一个位置
+  Page page;
+  memset(&page, 0, sizeof(page));
+  for (int i = 1; i < max_pages; i++) {
+    memset(page.data, i, BP_PAGE_DATA_SIZE);
+    ASSERT_EQ(RC::SUCCESS, disk_double_write_buffer->add_page(buffer_pool, i, page));
+    ASSERT_EQ(RC::SUCCESS, disk_double_write_buffer->add_page(buffer_pool, i, page));
+  }
+  ASSERT_EQ(1, file_page_count());
+
+  Page read_page;
+  ASSERT_EQ(RC::SUCCESS, disk_double_write_buffer->read_page(buffer_pool, max_pages - 1, read_page));
+  ASSERT_EQ(static_cast<char>(max_pages - 1), read_page.data[0]);
+
+  // 攒满一批，所有页面都写到了文件中
+  memset(page.data, max_pages, BP_PAGE_DATA_SIZE);
+  ASSERT_EQ(RC::SUCCESS, disk_double_write_buffer->add_page(buffer_pool, max_pages, page));
+  ASSERT_EQ(max_pages + 1, file_page_count());
+  ASSERT_NE(RC::SUCCESS, disk_double_write_buffer->read_page(buffer_pool, max_pages, read_page));
+
+  // 不满一批时，显式刷盘
+  ASSERT_EQ(RC::SUCCESS, disk_double_write_buffer->add_page(buffer_pool, max_pages + 1, page));
+  ASSERT_EQ(RC::SUCCESS, disk_double_write_buffer->flush_page());
+  ASSERT_EQ(max_pages + 2, file_page_count());
+
+  ASSERT_EQ(RC::SUCCESS, bpm->close_file(buffer_pool_filename.c_str()));
+  bpm = nullptr;
+}
+
 int main(int argc, char **argv)
 {
   testing::InitGoogleTest(&argc, argv);
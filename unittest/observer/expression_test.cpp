@@ -305,6 +305,35 @@ TEST(ComparisonExpr, comparison_expr_test)
       }
     }
   }
+  {
+    // 列的前一部分有编码数据时，编码的部分直接在编码数据上比较
+    const int               int_len = sizeof(int);
+    FieldMeta               field_meta("col1", AttrType::INTS, 0, int_len, true, 0);
+    Field                   field(nullptr, &field_meta);
+    unique_ptr<Expression>  left_expr   = std::make_unique<FieldExpr>(field);
+    int                     count       = 1024;
+    int                     encoded_num = 600;
+    std::unique_ptr<Column> column_left = std::make_unique<Column>(AttrType::INTS, int_len, count);
+    for (int i = 0; i < count; ++i) {
+      int left_value = i / 10;
+      column_left->append_one((char *)&left_value);
+    }
+    vector<char> encoded;
+    ColumnEncoder::encode(ColumnEncoding::RLE, AttrType::INTS, int_len, column_left->data(), encoded_num, encoded);
+    column_left->set_encoded(EncodedColumn(encoded.data()));
+
+    Chunk                chunk;
+    std::vector<uint8_t> select(count, 1);
+    chunk.add_column(std::move(column_left), 0);
+
+    unique_ptr<Expression> right_expr(new ValueExpr(Value(50)));
+    ComparisonExpr         expr_ge(CompOp::GREAT_EQUAL, std::move(left_expr), std::move(right_expr));
+    RC                     rc = expr_ge.eval(chunk, select);
+    ASSERT_EQ(rc, RC::SUCCESS);
+    for (int i = 0; i < count; ++i) {
+      ASSERT_EQ(select[i], i / 10 >= 50 ? 1 : 0) << "i=" << i;
+    }
+  }
 }
 
 TEST(AggregateExpr, aggregate_expr_test)
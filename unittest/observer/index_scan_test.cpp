@@ -0,0 +1,97 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "common/value.h"
+#include "sql/expr/expression.h"
+#include "sql/operator/physical_operator.h"
+#include "sql/operator/table_get_logical_operator.h"
+#include "sql/optimizer/physical_plan_generator.h"
+#include "storage/db/db.h"
+#include "storage/table/table.h"
+#include "storage/trx/trx.h"
+
+using namespace std;
+using namespace common;
+
+static const char *TABLE_NAME = "in_list_table";
+
+TEST(IndexScan, in_list)
+{
+  filesystem::path test_directory("index_scan_test");
+  filesystem::remove_all(test_directory);
+  filesystem::create_directories(test_directory);
+
+  auto db = make_unique<Db>();
+  ASSERT_EQ(RC::SUCCESS, db->init("test_db", test_directory.c_str(), "vacuous", "vacuous"));
+
+  vector<AttrInfoSqlNode> attr_infos(2);
+  for (size_t i = 0; i < attr_infos.size(); i++) {
+    attr_infos[i].name   = string("field_") + to_string(i);
+    attr_infos[i].type   = AttrType::INTS;
+    attr_infos[i].length = 4;
+  }
+  ASSERT_EQ(RC::SUCCESS, db->create_table(TABLE_NAME, attr_infos));
+  Table *table = db->find_table(TABLE_NAME);
+  ASSERT_NE(table, nullptr);
+  vector<const FieldMeta *> field_metas{table->table_meta().field("field_0")};
+  ASSERT_EQ(RC::SUCCESS, table->create_index(nullptr, field_metas, {}, "in_list_index", 90));
+  // 创建索引之后表的元数据是新的
+  const FieldMeta *field_meta = table->table_meta().field("field_0");
+
+  // 每个键值有 10 条记录
+  const int key_num = 100;
+  for (int i = 0; i < key_num * 10; i++) {
+    Value  values[2] = {Value(i % key_num), Value(i)};
+    Record record;
+    ASSERT_EQ(RC::SUCCESS, table->make_record(2, values, record));
+    ASSERT_EQ(RC::SUCCESS, table->insert_record(record));
+  }
+
+  // field_0 in (50, 3, 50, 200, 99)：重复的值只返回一次，不存在的值没有结果
+  vector<Value> in_values{Value(50), Value(3), Value(50), Value(200), Value(99)};
+  auto          predicate = make_unique<ComparisonExpr>(
+      CompOp::IN_OP, make_unique<FieldExpr>(table, field_meta), make_unique<ValueListExpr>(in_values));
+  vector<unique_ptr<Expression>> predicates;
+  predicates.push_back(std::move(predicate));
+  TableGetLogicalOperator table_get_oper(table, ReadWriteMode::READ_ONLY);
+  table_get_oper.set_predicates(std::move(predicates));
+
+  PhysicalPlanGenerator        generator;
+  unique_ptr<PhysicalOperator> oper;
+  ASSERT_EQ(RC::SUCCESS, generator.create(table_get_oper, oper));
+  ASSERT_EQ(PhysicalOperatorType::INDEX_SCAN, oper->type());
+  ASSERT_NE(string::npos, oper->param().find("IN LIST"));
+
+  Trx *trx = db->trx_kit().create_trx(db->log_handler());
+  ASSERT_EQ(RC::SUCCESS, oper->open(trx));
+  map<int, int> key_counts;
+  RC            rc = RC::SUCCESS;
+  while (OB_SUCC(rc = oper->next())) {
+    Value value;
+    ASSERT_EQ(RC::SUCCESS, oper->current_tuple()->cell_at(0, value));
+    key_counts[value.get_int()]++;
+  }
+  ASSERT_EQ(RC::RECORD_EOF, rc);
+  ASSERT_EQ(RC::SUCCESS, oper->close());
+  db->trx_kit().destroy_trx(trx);
+
+  ASSERT_EQ((map<int, int>{{3, 10}, {50, 10}, {99, 10}}), key_counts);
+
+  oper.reset();
+  db.reset();
+  filesystem::remove_all(test_directory);
+}
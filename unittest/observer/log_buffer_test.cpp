@@ -66,6 +66,75 @@ TEST(LogEntryBuffer, test_append)
   filesystem::remove("test_log_entry_buffer.log");
 }
 
+TEST(LogEntryBuffer, concurrent_append)
+{
+  const char *log_file = "test_log_entry_buffer_concurrent.log";
+  filesystem::remove(log_file);
+
+  LogEntryBuffer buffer;
+  ASSERT_EQ(RC::SUCCESS, buffer.init(0));
+
+  LogFileWriter writer;
+  ASSERT_EQ(RC::SUCCESS, writer.open(log_file, numeric_limits<int>::max()));
+
+  // 写入的数据量是缓冲区的好几倍，会覆盖环形缓冲区绕回和等待刷盘的情况
+  const int    thread_num        = 4;
+  const int    entry_per_thread  = 20000;
+  atomic<bool> producers_running = true;
+
+  thread flusher([&]() {
+    int count = 0;
+    while (producers_running.load() || buffer.entry_number() > 0) {
+      ASSERT_EQ(RC::SUCCESS, buffer.flush(writer, count));
+    }
+  });
+
+  vector<thread> producers;
+  for (int t = 0; t < thread_num; t++) {
+    producers.emplace_back([&buffer, t]() {
+      for (int64_t i = 0; i < entry_per_thread; i++) {
+        vector<char> data(sizeof(int64_t) * 2 + i % 512);
+        int64_t      id = t * int64_t(entry_per_thread) + i;
+        memcpy(data.data(), &id, sizeof(id));
+        LSN lsn = 0;
+        ASSERT_EQ(RC::SUCCESS, buffer.append(lsn, LogModule::Id::BUFFER_POOL, std::move(data)));
+      }
+    });
+  }
+
+  for (thread &producer : producers) {
+    producer.join();
+  }
+  producers_running = false;
+  flusher.join();
+
+  ASSERT_EQ(thread_num * entry_per_thread, buffer.current_lsn());
+  ASSERT_EQ(buffer.current_lsn(), buffer.flushed_lsn());
+  ASSERT_EQ(0, buffer.bytes());
+  writer.close();
+
+  // 日志按照LSN的顺序存放，每个线程写入的日志也保持了它们追加的顺序
+  LogFileReader reader;
+  ASSERT_EQ(RC::SUCCESS, reader.open(log_file));
+
+  LSN             expected_lsn = 1;
+  vector<int64_t> next_index(thread_num, 0);
+  ASSERT_EQ(RC::SUCCESS, reader.iterate([&](LogEntry &entry) -> RC {
+    EXPECT_EQ(expected_lsn++, entry.lsn());
+    int64_t id = 0;
+    memcpy(&id, entry.data(), sizeof(id));
+    int64_t t = id / entry_per_thread;
+    int64_t i = id % entry_per_thread;
+    EXPECT_EQ(next_index[t]++, i);
+    EXPECT_EQ(static_cast<int32_t>(sizeof(int64_t) * 2 + i % 512), entry.payload_size());
+    return RC::SUCCESS;
+  }));
+  ASSERT_EQ(thread_num * entry_per_thread + 1, expected_lsn);
+  reader.close();
+
+  filesystem::remove(log_file);
+}
+
 int main(int argc, char **argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -124,6 +124,53 @@ TEST(LogFileReader, basic)
   filesystem::remove(log_file);
 }
 
+TEST(LogFileWriter, batch_write)
+{
+  const char *log_file = "test_log_file_batch_write.log";
+
+  filesystem::remove(log_file);
+
+  LogFileWriter writer;
+  LSN           end_lsn = 1000 - 1;
+  ASSERT_EQ(RC::SUCCESS, writer.open(log_file, end_lsn));
+  ASSERT_EQ(RC::SUCCESS, writer.preallocate(64 * 1024));
+
+  const int batch_size = 100;
+  LSN       lsn        = 1;
+  while (lsn <= end_lsn) {
+    vector<LogEntry> entries;
+    for (int i = 0; i < batch_size && lsn <= end_lsn; i++, lsn++) {
+      LogEntry entry;
+      ASSERT_EQ(RC::SUCCESS, entry.init(lsn, LogModule::Id::BUFFER_POOL, vector<char>(10 + i % 7)));
+      entries.emplace_back(std::move(entry));
+    }
+    ASSERT_EQ(RC::SUCCESS, writer.write(span<const LogEntry>(entries)));
+  }
+  ASSERT_TRUE(writer.full());
+
+  // 超出文件LSN范围的批量写入不能成功
+  vector<LogEntry> entries(1);
+  ASSERT_EQ(RC::SUCCESS, entries[0].init(end_lsn + 1, LogModule::Id::BUFFER_POOL, vector<char>(10)));
+  ASSERT_NE(RC::SUCCESS, writer.write(span<const LogEntry>(entries)));
+  writer.close();
+
+  // 预分配不应该改变文件大小，读取时不会读到空洞
+  LogFileReader reader;
+  ASSERT_EQ(RC::SUCCESS, reader.open(log_file));
+
+  LSN  expected_lsn = 1;
+  auto callback     = [&expected_lsn](LogEntry &entry) -> RC {
+    EXPECT_EQ(expected_lsn, entry.lsn());
+    expected_lsn++;
+    return RC::SUCCESS;
+  };
+  ASSERT_EQ(RC::SUCCESS, reader.iterate(callback));
+  ASSERT_EQ(end_lsn + 1, expected_lsn);
+  reader.close();
+
+  filesystem::remove(log_file);
+}
+
 TEST(LogFileReadWrite, test_read_write)
 {
   const char *log_file = "test_log_file_read_write.log";
@@ -390,6 +437,55 @@ TEST(LogFileManager, next_file)
   filesystem::remove_all(directory);
 }
 
+TEST(LogFileManager, remove_files_before)
+{
+  const char *directory                 = "remove_files_before";
+  int         max_entry_number_per_file = 1000;
+
+  filesystem::remove_all(directory);
+  ASSERT_TRUE(filesystem::create_directory(directory));
+  LSN lsns[] = {0, 1000, 2000, 3000};
+  for (LSN lsn : lsns) {
+    string filename = string(LogFileManager::file_prefix_) + to_string(lsn) + LogFileManager::file_suffix_;
+    ofstream ofs(filesystem::path(directory) / filename);
+    ofs.close();
+  }
+
+  LogFileManager manager;
+  ASSERT_EQ(RC::SUCCESS, manager.init(directory, max_entry_number_per_file));
+
+  // 文件中还有大于等于检查点的日志时不能删除
+  ASSERT_EQ(RC::SUCCESS, manager.remove_files_before(999));
+  vector<string> files;
+  ASSERT_EQ(RC::SUCCESS, manager.list_files(files, 0));
+  ASSERT_EQ(4, files.size());
+
+  ASSERT_EQ(RC::SUCCESS, manager.remove_files_before(2500));
+  ASSERT_EQ(RC::SUCCESS, manager.list_files(files, 0));
+  ASSERT_EQ(2, files.size());
+  ASSERT_FALSE(filesystem::exists(filesystem::path(directory) / "clog_0.log"));
+  ASSERT_FALSE(filesystem::exists(filesystem::path(directory) / "clog_1000.log"));
+  ASSERT_TRUE(filesystem::exists(filesystem::path(directory) / "clog_2000.log"));
+
+  // 最后一个文件永远不会删除
+  ASSERT_EQ(RC::SUCCESS, manager.remove_files_before(10000));
+  ASSERT_EQ(RC::SUCCESS, manager.list_files(files, 0));
+  ASSERT_EQ(1, files.size());
+  ASSERT_TRUE(filesystem::exists(filesystem::path(directory) / "clog_3000.log"));
+
+  // 重新打开后从剩下的文件继续
+  LogFileManager manager2;
+  ASSERT_EQ(RC::SUCCESS, manager2.init(directory, max_entry_number_per_file));
+  LogFileWriter writer;
+  ASSERT_EQ(RC::SUCCESS, manager2.next_file(writer));
+  LSN lsn = 0;
+  ASSERT_EQ(RC::SUCCESS, LogFileManager::get_lsn_from_filename(filesystem::path(writer.filename()).filename(), lsn));
+  ASSERT_EQ(4000, lsn);
+
+  writer.close();
+  filesystem::remove_all(directory);
+}
+
 int main(int argc, char **argv)
 {
   testing::InitGoogleTest(&argc, argv);
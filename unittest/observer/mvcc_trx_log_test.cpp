@@ -716,6 +716,138 @@ TEST(MvccTrxLog, wal_rollback_abnormal)
   db.reset();
 }
 
+TEST(MvccTrxLog, fuzzy_checkpoint)
+{
+  /*
+  插入一些数据，留一个事务不提交，然后把页面都刷下去，再做检查点。
+  检查点不能越过未提交事务的第一条日志，检查点之前的日志文件会被删除。
+  复制文件模拟崩溃，从检查点开始恢复后，已提交的数据都在，未提交的事务被回滚掉。
+  */
+  filesystem::path test_directory("mvcc_trx_log_test");
+  filesystem::remove_all(test_directory);
+  filesystem::create_directory(test_directory);
+
+  const char      *dbname           = "test_db";
+  const char      *dbname2          = "test_db2";
+  filesystem::path db_path          = test_directory / dbname;
+  filesystem::path db_path2         = test_directory / dbname2;
+  const char      *trx_kit_name     = "mvcc";
+  const char      *log_handler_name = "disk";
+
+  filesystem::create_directories(db_path);
+
+  auto db = make_unique<Db>();
+  ASSERT_EQ(RC::SUCCESS, db->init(dbname, db_path.c_str(), trx_kit_name, log_handler_name));
+
+  const int               field_num = 4;
+  vector<AttrInfoSqlNode> attr_infos;
+  for (int i = 0; i < field_num; i++) {
+    AttrInfoSqlNode attr_info;
+    attr_info.name   = string("field_") + to_string(i);
+    attr_info.type   = AttrType::INTS;
+    attr_info.length = 4;
+    attr_infos.push_back(attr_info);
+  }
+
+  const char *table_name = "table_0";
+  ASSERT_EQ(RC::SUCCESS, db->create_table(table_name, attr_infos));
+  ASSERT_EQ(RC::SUCCESS, db->sync());
+  Table *table = db->find_table(table_name);
+  ASSERT_NE(table, nullptr);
+
+  TrxKit &trx_kit       = db->trx_kit();
+  auto    insert_record = [table](Trx *trx, int i) {
+    Record        record;
+    vector<Value> values(field_num);
+    for (Value &value : values) {
+      value.set_int(i);
+    }
+    ASSERT_EQ(RC::SUCCESS, table->make_record(values.size(), values.data(), record));
+    ASSERT_EQ(RC::SUCCESS, trx->insert_record(table, record));
+  };
+
+  const int insert_num = 2000;
+  for (int i = 0; i < insert_num; i++) {
+    Trx *trx = trx_kit.create_trx(db->log_handler());
+    trx->start_if_need();
+    insert_record(trx, i);
+    ASSERT_EQ(RC::SUCCESS, trx->commit());
+    trx_kit.destroy_trx(trx);
+  }
+
+  // 这个事务一直不提交
+  auto *active_trx = static_cast<MvccTrx *>(trx_kit.create_trx(db->log_handler()));
+  active_trx->start_if_need();
+  insert_record(active_trx, insert_num);
+  const LSN active_trx_lsn = active_trx->first_lsn();
+  ASSERT_GT(active_trx_lsn, 0);
+
+  for (int i = 0; i < insert_num; i++) {
+    Trx *trx = trx_kit.create_trx(db->log_handler());
+    trx->start_if_need();
+    insert_record(trx, insert_num + 1 + i);
+    ASSERT_EQ(RC::SUCCESS, trx->commit());
+    trx_kit.destroy_trx(trx);
+  }
+
+  DiskLogHandler &log_handler = static_cast<DiskLogHandler &>(db->log_handler());
+  ASSERT_EQ(RC::SUCCESS, log_handler.wait_lsn(log_handler.current_lsn()));
+
+  auto list_clog_files = [&db_path](LSN start_lsn) {
+    LogFileManager file_manager;
+    vector<string> files;
+    EXPECT_EQ(RC::SUCCESS, file_manager.init((db_path / "clog").c_str(), 1000));
+    EXPECT_EQ(RC::SUCCESS, file_manager.list_files(files, start_lsn));
+    return files.size();
+  };
+  const size_t file_num_before = list_clog_files(0);
+  ASSERT_GT(file_num_before, list_clog_files(active_trx_lsn));
+
+  // 页面都刷到磁盘后，检查点只受上次检查点的LSN和活跃事务限制
+  ASSERT_EQ(RC::SUCCESS, table->sync());
+  ASSERT_EQ(0, db->buffer_pool_manager().get_frame_manager().min_rec_lsn());
+  ASSERT_EQ(RC::SUCCESS, db->checkpoint());
+  ASSERT_LT(db->check_point_lsn(), active_trx_lsn);
+  ASSERT_EQ(RC::SUCCESS, db->checkpoint());
+  ASSERT_EQ(active_trx_lsn, db->check_point_lsn());
+
+  // 检查点之前的日志文件都被删掉了
+  ASSERT_LT(list_clog_files(0), file_num_before);
+  ASSERT_EQ(list_clog_files(0), list_clog_files(active_trx_lsn));
+
+  // copy all files from db to db2
+  filesystem::copy(db_path, db_path2, filesystem::copy_options::recursive);
+
+  auto db2 = make_unique<Db>();
+  ASSERT_EQ(RC::SUCCESS, db2->init(dbname2, db_path2.c_str(), trx_kit_name, log_handler_name));
+  Table *table2 = db2->find_table(table_name);
+  ASSERT_NE(table2, nullptr);
+
+  Trx *trx2 = db2->trx_kit().create_trx(db2->log_handler());
+  trx2->start_if_need();
+  RecordFileScanner scanner2;
+  ASSERT_EQ(RC::SUCCESS, table2->get_record_scanner(scanner2, nullptr, ReadWriteMode::READ_ONLY));
+  int    visible_count = 0;
+  int    total_count   = 0;
+  Record record;
+  RC     rc = RC::SUCCESS;
+  while (OB_SUCC(rc = scanner2.next(record))) {
+    total_count++;
+    if (OB_SUCC(trx2->visit_record(table2, record, ReadWriteMode::READ_ONLY))) {
+      visible_count++;
+    }
+  }
+  ASSERT_EQ(insert_num * 2, visible_count);
+  ASSERT_EQ(insert_num * 2, total_count);  // 未提交的事务插入的数据已经被回滚删除
+  db2->trx_kit().destroy_trx(trx2);
+
+  ASSERT_EQ(RC::SUCCESS, active_trx->rollback());
+  trx_kit.destroy_trx(active_trx);
+
+  db2.reset();
+  db.reset();
+}
+
 int main(int argc, char **argv)
 {
   testing::InitGoogleTest(&argc, argv);
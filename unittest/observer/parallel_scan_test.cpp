@@ -0,0 +1,143 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <filesystem>
+#include <set>
+
+#include "sql/operator/parallel_scan.h"
+#include "storage/buffer/disk_buffer_pool.h"
+#include "storage/buffer/double_write_buffer.h"
+#include "storage/clog/vacuous_log_handler.h"
+#include "storage/record/record_manager.h"
+#include "storage/trx/vacuous_trx.h"
+#include "gtest/gtest.h"
+
+using namespace std;
+
+TEST(ParallelScanner, morsels)
+{
+  // 每个页面都被扫描并且只被扫描一次
+  const PageNum page_count = ParallelScanner<PageNum>::MORSEL_PAGES * 10 + 7;
+
+  ParallelScanner<PageNum> scanner;
+  RC rc = scanner.start(4, page_count, [](PageNum begin_page, PageNum end_page, ExchangeQueue<PageNum> &queue) {
+    for (PageNum page_num = begin_page; page_num < end_page; page_num++) {
+      if (!queue.push(PageNum(page_num))) {
+        break;
+      }
+    }
+    return RC::SUCCESS;
+  });
+  ASSERT_EQ(RC::SUCCESS, rc);
+
+  set<PageNum> pages;
+  PageNum      page_num = 0;
+  while (OB_SUCC(rc = scanner.next(page_num))) {
+    ASSERT_TRUE(pages.insert(page_num).second);
+  }
+  ASSERT_EQ(RC::RECORD_EOF, rc);
+  ASSERT_EQ(page_count - 1, static_cast<PageNum>(pages.size()));
+  ASSERT_EQ(1, *pages.begin());
+  ASSERT_EQ(page_count - 1, *pages.rbegin());
+  scanner.stop();
+
+  // 某个工作线程失败时返回它的错误码
+  rc = scanner.start(4, page_count, [](PageNum begin_page, PageNum end_page, ExchangeQueue<PageNum> &queue) {
+    return begin_page == 1 ? RC::IOERR_READ : RC::SUCCESS;
+  });
+  ASSERT_EQ(RC::SUCCESS, rc);
+  while (OB_SUCC(rc = scanner.next(page_num))) {}
+  ASSERT_EQ(RC::IOERR_READ, rc);
+  scanner.stop();
+
+  // 没有读完就停止，工作线程不会一直阻塞在队列上
+  rc = scanner.start(2, page_count, [](PageNum begin_page, PageNum end_page, ExchangeQueue<PageNum> &queue) {
+    for (PageNum page_num = begin_page; page_num < end_page; page_num++) {
+      if (!queue.push(PageNum(page_num))) {
+        break;
+      }
+    }
+    return RC::SUCCESS;
+  });
+  ASSERT_EQ(RC::SUCCESS, rc);
+  ASSERT_EQ(RC::SUCCESS, scanner.next(page_num));
+  scanner.stop();
+}
+
+TEST(ParallelScanner, record_file)
+{
+  VacuousLogHandler log_handler;
+
+  const char *record_manager_file = "parallel_scan.bp";
+  filesystem::remove(record_manager_file);
+
+  BufferPoolManager bpm;
+  ASSERT_EQ(RC::SUCCESS, bpm.init(make_unique<VacuousDoubleWriteBuffer>()));
+  DiskBufferPool *bp = nullptr;
+  ASSERT_EQ(RC::SUCCESS, bpm.create_file(record_manager_file));
+  ASSERT_EQ(RC::SUCCESS, bpm.open_file(log_handler, record_manager_file, bp));
+
+  RecordFileHandler file_handler(StorageFormat::ROW_FORMAT);
+  ASSERT_EQ(RC::SUCCESS, file_handler.init(*bp, log_handler, nullptr));
+
+  // 页面个数要超过几个 morsel
+  const int   record_num = 30000;
+  char        record_data[100];
+  set<string> rids;
+  for (int i = 0; i < record_num; i++) {
+    snprintf(record_data, sizeof(record_data), "%d", i);
+    RID rid;
+    ASSERT_EQ(RC::SUCCESS, file_handler.insert_record(record_data, sizeof(record_data), &rid));
+    rids.insert(rid.to_string());
+  }
+  ASSERT_GT(bp->page_count(), ParallelScanner<vector<RID>>::MORSEL_PAGES * 3);
+
+  VacuousTrx                  trx;
+  ParallelScanner<vector<RID>> scanner;
+  RC                           rc = scanner.start(
+      4, bp->page_count(), [&](PageNum begin_page, PageNum end_page, ExchangeQueue<vector<RID>> &queue) {
+        RecordFileScanner file_scanner;
+        RC                rc = file_scanner.open_scan(
+            nullptr /*table*/, *bp, &trx, log_handler, ReadWriteMode::READ_ONLY, nullptr /*condition_filter*/);
+        if (OB_SUCC(rc)) {
+          rc = file_scanner.set_page_range(begin_page, end_page);
+        }
+        if (OB_FAIL(rc)) {
+          return rc;
+        }
+
+        vector<RID> batch;
+        Record      record;
+        while (OB_SUCC(rc = file_scanner.next(record))) {
+          batch.push_back(record.rid());
+        }
+        if (rc != RC::RECORD_EOF) {
+          return rc;
+        }
+        queue.push(std::move(batch));
+        return RC::SUCCESS;
+      });
+  ASSERT_EQ(RC::SUCCESS, rc);
+
+  set<string> scanned_rids;
+  vector<RID> batch;
+  while (OB_SUCC(rc = scanner.next(batch))) {
+    for (const RID &rid : batch) {
+      ASSERT_TRUE(scanned_rids.insert(rid.to_string()).second);
+    }
+  }
+  ASSERT_EQ(RC::RECORD_EOF, rc);
+  scanner.stop();
+  ASSERT_EQ(rids, scanned_rids);
+
+  file_handler.close();
+  bpm.close_file(record_manager_file);
+  filesystem::remove(record_manager_file);
+}
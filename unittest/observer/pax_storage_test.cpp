@@ -16,11 +16,11 @@ See the Mulan PSL v2 for more details. */
 #define protected public
 #define private public
 #include "storage/table/table.h"
+#include "storage/record/record_manager.h"
 #undef protected
 #undef private
 
 #include "storage/buffer/disk_buffer_pool.h"
-#include "storage/record/record_manager.h"
 #include "storage/trx/vacuous_trx.h"
 #include "storage/clog/vacuous_log_handler.h"
 #include "storage/clog/disk_log_handler.h"
@@ -36,12 +36,12 @@ using namespace common;
 class PaxRecordFileScannerWithParam : public testing::TestWithParam<int>
 {};
 
-TEST_P(PaxRecordFileScannerWithParam, DISABLED_test_file_iterator)
+TEST_P(PaxRecordFileScannerWithParam, test_file_iterator)
 {
   int               record_insert_num = GetParam();
   VacuousLogHandler log_handler;
 
-  const char *record_manager_file = "record_manager.bp";
+  const char *record_manager_file = "pax_storage.bp";
   filesystem::remove(record_manager_file);
 
   BufferPoolManager *bpm = new BufferPoolManager();
@@ -97,7 +97,7 @@ TEST_P(PaxRecordFileScannerWithParam, DISABLED_test_file_iterator)
   chunk.add_column(std::move(col1), 0);
   count = 0;
   while (OB_SUCC(rc = chunk_scanner.next_chunk(chunk))) {
-    count += chunk.rows();
+    count += chunk.selected_rows();
     chunk.reset_data();
   }
   ASSERT_EQ(rc, RC::RECORD_EOF);
@@ -132,7 +132,7 @@ TEST_P(PaxRecordFileScannerWithParam, DISABLED_test_file_iterator)
   chunk.reset_data();
   count = 0;
   while (OB_SUCC(rc = chunk_scanner.next_chunk(chunk))) {
-    count += chunk.rows();
+    count += chunk.selected_rows();
     chunk.reset_data();
   }
   ASSERT_EQ(rc, RC::RECORD_EOF);
@@ -163,7 +163,7 @@ TEST_P(PaxRecordFileScannerWithParam, DISABLED_test_file_iterator)
   chunk.reset_data();
   count = 0;
   while (OB_SUCC(rc = chunk_scanner.next_chunk(chunk))) {
-    count += chunk.rows();
+    count += chunk.selected_rows();
     chunk.reset_data();
   }
   ASSERT_EQ(rc, RC::RECORD_EOF);
@@ -173,15 +173,342 @@ TEST_P(PaxRecordFileScannerWithParam, DISABLED_test_file_iterator)
   delete bpm;
 }
 
+TEST(PaxChunkFileScanner, projection)
+{
+  VacuousLogHandler log_handler;
+
+  const char *record_manager_file = "pax_projection.bp";
+  filesystem::remove(record_manager_file);
+
+  BufferPoolManager *bpm = new BufferPoolManager();
+  ASSERT_EQ(RC::SUCCESS, bpm->init(make_unique<VacuousDoubleWriteBuffer>()));
+  DiskBufferPool *bp = nullptr;
+  ASSERT_EQ(RC::SUCCESS, bpm->create_file(record_manager_file));
+  ASSERT_EQ(RC::SUCCESS, bpm->open_file(log_handler, record_manager_file, bp));
+
+  Table table;
+  table.table_meta_.storage_format_ = StorageFormat::PAX_FORMAT;
+  vector<FieldMeta> &fields         = table.table_meta_.fields_;
+  fields.resize(3);
+  for (int i = 0; i < 3; i++) {
+    fields[i].attr_type_ = AttrType::INTS;
+    fields[i].attr_len_  = 4;
+    fields[i].field_id_  = i;
+  }
+
+  RecordFileHandler file_handler(StorageFormat::PAX_FORMAT);
+  ASSERT_EQ(RC::SUCCESS, file_handler.init(*bp, log_handler, &table.table_meta_));
+
+  const int record_num = 3000;
+  for (int i = 0; i < record_num; i++) {
+    int record_data[3] = {i, i * 10, i * 100};
+    RID rid;
+    ASSERT_EQ(RC::SUCCESS, file_handler.insert_record((const char *)record_data, sizeof(record_data), &rid));
+  }
+
+  // 只读取第3列，scanner 按照请求的列初始化空的 chunk
+  ChunkFileScanner chunk_scanner;
+  ASSERT_EQ(RC::SUCCESS, chunk_scanner.open_scan_chunk(&table, *bp, log_handler, ReadWriteMode::READ_ONLY, {2}));
+
+  Chunk chunk;
+  RC    rc    = RC::SUCCESS;
+  int   count = 0;
+  long  sum   = 0;
+  while (OB_SUCC(rc = chunk_scanner.next_chunk(chunk))) {
+    ASSERT_EQ(chunk.column_num(), 1);
+    ASSERT_EQ(chunk.column_ids(0), 2);
+    for (int i = 0; i < chunk.rows(); i++) {
+      sum += chunk.get_value(0, i).get_int();
+    }
+    count += chunk.selected_rows();
+    chunk.reset_data();
+  }
+  ASSERT_EQ(rc, RC::RECORD_EOF);
+  ASSERT_EQ(count, record_num);
+  ASSERT_EQ(sum, 100L * record_num * (record_num - 1) / 2);
+  chunk_scanner.close_scan();
+
+  chunk.reset();
+  bpm->close_file(record_manager_file);
+  delete bpm;
+}
+
+TEST(PaxZoneMap, skip_pages)
+{
+  VacuousLogHandler log_handler;
+
+  const char *record_manager_file = "pax_zone_map.bp";
+  filesystem::remove(record_manager_file);
+
+  BufferPoolManager *bpm = new BufferPoolManager();
+  ASSERT_EQ(RC::SUCCESS, bpm->init(make_unique<VacuousDoubleWriteBuffer>()));
+  DiskBufferPool *bp = nullptr;
+  ASSERT_EQ(RC::SUCCESS, bpm->create_file(record_manager_file));
+  ASSERT_EQ(RC::SUCCESS, bpm->open_file(log_handler, record_manager_file, bp));
+
+  // 记录格式: | null bitmap(1 byte) | col0 int | col1 int |
+  Table table;
+  table.table_meta_.storage_format_ = StorageFormat::PAX_FORMAT;
+  vector<FieldMeta> &fields         = table.table_meta_.fields_;
+  fields.resize(2);
+  for (int i = 0; i < 2; i++) {
+    fields[i].attr_type_ = AttrType::INTS;
+    fields[i].attr_len_  = 4;
+    fields[i].field_id_  = i;
+  }
+
+  RecordFileHandler file_handler(StorageFormat::PAX_FORMAT);
+  ASSERT_EQ(RC::SUCCESS, file_handler.init(*bp, log_handler, &table.table_meta_));
+
+  // col0 递增，col1 在奇数行为NULL
+  const int   record_num = 3000;
+  vector<RID> rids;
+  for (int i = 0; i < record_num; i++) {
+    char record_data[9];
+    int  col1       = i * 2;
+    record_data[0]  = (i % 2 == 1) ? 0x02 : 0x00;
+    memcpy(record_data + 1, &i, sizeof(int));
+    memcpy(record_data + 5, &col1, sizeof(int));
+    RID rid;
+    ASSERT_EQ(RC::SUCCESS, file_handler.insert_record(record_data, sizeof(record_data), &rid));
+    rids.push_back(rid);
+  }
+  ASSERT_GT(rids.back().page_num, rids.front().page_num + 2);
+
+  // 页面中的统计信息
+  {
+    PaxRecordPageHandler page_handler;
+    ASSERT_EQ(RC::SUCCESS, page_handler.init(*bp, log_handler, rids.front().page_num, ReadWriteMode::READ_ONLY));
+    const int         page_records = page_handler.page_header_->record_num;
+    PaxColumnZoneMap *zone_maps    = page_handler.get_zone_maps();
+    ASSERT_EQ(zone_maps[0].value_count, page_records);
+    ASSERT_EQ(zone_maps[0].null_count, 0);
+    ASSERT_EQ(zone_maps[0].min.int_value, 0);
+    ASSERT_EQ(zone_maps[0].max.int_value, page_records - 1);
+    ASSERT_EQ(zone_maps[1].null_count, page_records / 2);
+    ASSERT_EQ(zone_maps[1].value_count, page_records - page_records / 2);
+
+    // NULL位图随记录一起保存
+    Record record;
+    ASSERT_EQ(RC::SUCCESS, page_handler.get_record(rids[1], record));
+    ASSERT_EQ(record.data()[0], 0x02);
+    ASSERT_EQ(*(int *)(record.data() + 1), 1);
+    ASSERT_EQ(RC::SUCCESS, page_handler.cleanup());
+  }
+
+  auto scan_chunks = [&](const ZoneMapFilter &filter, int &chunk_num, int &matched) {
+    ChunkFileScanner chunk_scanner;
+    ASSERT_EQ(RC::SUCCESS, chunk_scanner.open_scan_chunk(&table, *bp, log_handler, ReadWriteMode::READ_ONLY, {0}));
+    chunk_scanner.set_zone_map_filter(filter);
+
+    Chunk chunk;
+    RC    rc = RC::SUCCESS;
+    chunk_num = 0;
+    matched   = 0;
+    while (OB_SUCC(rc = chunk_scanner.next_chunk(chunk))) {
+      chunk_num++;
+      for (int i = 0; i < chunk.rows(); i++) {
+        if ((!chunk.has_select() || chunk.select()[i]) && chunk.get_value(0, i).get_int() >= 2500) {
+          matched++;
+        }
+      }
+      chunk.reset_data();
+    }
+    ASSERT_EQ(rc, RC::RECORD_EOF);
+    chunk_scanner.close_scan();
+  };
+
+  int all_chunks = 0;
+  int chunk_num  = 0;
+  int matched    = 0;
+  scan_chunks(ZoneMapFilter(), all_chunks, matched);
+  ASSERT_EQ(matched, 500);
+
+  ZoneMapFilter filter;
+  filter.add(0, GREAT_EQUAL, Value(2500));
+  scan_chunks(filter, chunk_num, matched);
+  ASSERT_EQ(matched, 500);
+  ASSERT_LT(chunk_num, all_chunks);
+
+  // 记录扫描也会跳过页面
+  VacuousTrx        trx;
+  RecordFileScanner record_scanner;
+  ZoneMapFilter     less_filter;
+  less_filter.add(0, LESS_THAN, Value(100));
+  ASSERT_EQ(RC::SUCCESS, record_scanner.open_scan(&table, *bp, &trx, log_handler, ReadWriteMode::READ_ONLY, nullptr));
+  record_scanner.set_zone_map_filter(less_filter);
+  Record record;
+  RC     rc    = RC::SUCCESS;
+  int    count = 0;
+  while (OB_SUCC(rc = record_scanner.next(record))) {
+    count++;
+  }
+  ASSERT_EQ(rc, RC::RECORD_EOF);
+  // 只有第一个页面中有小于100的值
+  int first_page_records = 0;
+  for (const RID &rid : rids) {
+    first_page_records += (rid.page_num == rids.front().page_num) ? 1 : 0;
+  }
+  ASSERT_EQ(count, first_page_records);
+  record_scanner.close_scan();
+
+  // 删除最后一个页面的所有记录后，其它页面都被跳过，最后一个页面没有数据
+  const PageNum last_page = rids.back().page_num;
+  for (const RID &rid : rids) {
+    if (rid.page_num == last_page) {
+      ASSERT_EQ(RC::SUCCESS, file_handler.delete_record(&rid));
+    }
+  }
+  filter = ZoneMapFilter();
+  filter.add(0, GREAT_EQUAL, Value(2999));
+  scan_chunks(filter, chunk_num, matched);
+  ASSERT_EQ(matched, 0);
+  ASSERT_EQ(chunk_num, 0);
+
+  bpm->close_file(record_manager_file);
+  delete bpm;
+}
+
+TEST(PaxCompressed, insert_scan_delete)
+{
+  VacuousLogHandler log_handler;
+
+  const char *record_manager_file = "pax_compressed.bp";
+  filesystem::remove(record_manager_file);
+
+  BufferPoolManager *bpm = new BufferPoolManager();
+  ASSERT_EQ(RC::SUCCESS, bpm->init(make_unique<VacuousDoubleWriteBuffer>()));
+  DiskBufferPool *bp = nullptr;
+  ASSERT_EQ(RC::SUCCESS, bpm->create_file(record_manager_file));
+  ASSERT_EQ(RC::SUCCESS, bpm->open_file(log_handler, record_manager_file, bp));
+
+  // 记录格式: | null bitmap(1 byte) | col0 int | col1 int | col2 char(4) |
+  Table table;
+  table.table_meta_.storage_format_ = StorageFormat::PAX_COMPRESSED_FORMAT;
+  vector<FieldMeta> &fields         = table.table_meta_.fields_;
+  fields.resize(3);
+  for (int i = 0; i < 3; i++) {
+    fields[i].attr_type_ = i == 2 ? AttrType::CHARS : AttrType::INTS;
+    fields[i].attr_len_  = 4;
+    fields[i].field_id_  = i;
+  }
+
+  RecordFileHandler file_handler(StorageFormat::PAX_COMPRESSED_FORMAT);
+  ASSERT_EQ(RC::SUCCESS, file_handler.init(*bp, log_handler, &table.table_meta_));
+
+  // col0 有很多连续相同的值，col1 的取值范围很小，col2 只有几个不同的值并且有NULL
+  const char *names[]     = {"aaaa", "bbbb", "cccc"};
+  auto        make_record = [&](int i, char *data) {
+    int col0 = i / 100;
+    int col1 = 1000 + i % 50;
+    data[0]  = (i % 7 == 0) ? 0x04 : 0x00;
+    memcpy(data + 1, &col0, sizeof(int));
+    memcpy(data + 5, &col1, sizeof(int));
+    memcpy(data + 9, names[i % 3], 4);
+  };
+
+  const int   record_num = 6000;
+  vector<RID> rids;
+  for (int i = 0; i < record_num; i++) {
+    char record_data[13];
+    make_record(i, record_data);
+    RID rid;
+    ASSERT_EQ(RC::SUCCESS, file_handler.insert_record(record_data, sizeof(record_data), &rid));
+    rids.push_back(rid);
+  }
+
+  // 第一个页面中的记录个数比不压缩时页面最多可以存放的记录还多
+  {
+    PaxRecordPageHandler page_handler(StorageFormat::PAX_COMPRESSED_FORMAT);
+    ASSERT_EQ(RC::SUCCESS, page_handler.init(*bp, log_handler, rids.front().page_num, ReadWriteMode::READ_ONLY));
+    ASSERT_GT(page_handler.header_ext_->encoded_rows, 0);
+    ASSERT_GT(page_handler.page_header_->record_num, BP_PAGE_DATA_SIZE / page_handler.page_header_->record_size);
+    ASSERT_EQ(RC::SUCCESS, page_handler.cleanup());
+  }
+
+  // 编码区域和未编码部分中的记录都可以读出来
+  for (int i = 0; i < record_num; i++) {
+    char expected[13];
+    make_record(i, expected);
+    Record record;
+    ASSERT_EQ(RC::SUCCESS, file_handler.get_record(rids[i], record));
+    ASSERT_EQ(0, memcmp(record.data(), expected, sizeof(expected))) << "i=" << i;
+  }
+
+  // 删除一部分记录，包括已经编码的记录
+  int64_t expected_sum = 0;
+  int     expected_num = 0;
+  for (int i = 0; i < record_num; i++) {
+    if (i % 5 == 0) {
+      ASSERT_EQ(RC::SUCCESS, file_handler.delete_record(&rids[i]));
+    } else {
+      expected_sum += 1000 + i % 50;
+      expected_num++;
+    }
+  }
+
+  VacuousTrx        trx;
+  RecordFileScanner record_scanner;
+  ASSERT_EQ(RC::SUCCESS, record_scanner.open_scan(&table, *bp, &trx, log_handler, ReadWriteMode::READ_ONLY, nullptr));
+  Record  record;
+  RC      rc    = RC::SUCCESS;
+  int     count = 0;
+  int64_t sum   = 0;
+  while (OB_SUCC(rc = record_scanner.next(record))) {
+    count++;
+    sum += *(int *)(record.data() + 5);
+  }
+  ASSERT_EQ(rc, RC::RECORD_EOF);
+  ASSERT_EQ(count, expected_num);
+  ASSERT_EQ(sum, expected_sum);
+  record_scanner.close_scan();
+
+  // 按列扫描时编码的部分保留了编码数据，直接在编码数据上求和与解码后的结果相同
+  ChunkFileScanner chunk_scanner;
+  ASSERT_EQ(RC::SUCCESS, chunk_scanner.open_scan_chunk(&table, *bp, log_handler, ReadWriteMode::READ_ONLY, {1, 2}));
+  Chunk chunk;
+  count               = 0;
+  sum                 = 0;
+  int encoded_columns = 0;
+  while (OB_SUCC(rc = chunk_scanner.next_chunk(chunk))) {
+    const Column        &column  = chunk.column(0);
+    const EncodedColumn &encoded = column.encoded();
+    if (encoded.valid()) {
+      encoded_columns++;
+      int decoded_sum = 0;
+      for (int i = 0; i < encoded.count(); i++) {
+        decoded_sum += *(int *)(column.data() + i * sizeof(int));
+      }
+      ASSERT_EQ(encoded.sum<int>(), decoded_sum);
+      ASSERT_TRUE(chunk.column(1).encoded().valid());
+    }
+    for (int i = 0; i < chunk.rows(); i++) {
+      if (!chunk.has_select() || chunk.select()[i]) {
+        count++;
+        sum += chunk.get_value(0, i).get_int();
+      }
+    }
+    chunk.reset_data();
+  }
+  ASSERT_EQ(rc, RC::RECORD_EOF);
+  ASSERT_GT(encoded_columns, 0);
+  ASSERT_EQ(count, expected_num);
+  ASSERT_EQ(sum, expected_sum);
+  chunk_scanner.close_scan();
+
+  bpm->close_file(record_manager_file);
+  delete bpm;
+}
+
 class PaxPageHandlerTestWithParam : public testing::TestWithParam<int>
 {};
 
-TEST_P(PaxPageHandlerTestWithParam, DISABLED_PaxPageHandler)
+TEST_P(PaxPageHandlerTestWithParam, PaxPageHandler)
 {
   int               record_num = GetParam();
   VacuousLogHandler log_handler;
 
-  const char *record_manager_file = "record_manager.bp";
+  const char *record_manager_file = "pax_storage.bp";
   ::remove(record_manager_file);
 
   BufferPoolManager *bpm = new BufferPoolManager();
@@ -271,9 +598,15 @@ TEST_P(PaxPageHandlerTestWithParam, DISABLED_PaxPageHandler)
   chunk1.add_column(std::move(col_3), 2);
   auto col_4 = std::make_unique<Column>(fm4, 2048);
   chunk1.add_column(std::move(col_4), 3);
+  const int pin_count = frame->pin_count();
   rc = record_page_handle->get_chunk(chunk1);
   ASSERT_EQ(rc, RC::SUCCESS);
   ASSERT_EQ(chunk1.rows(), record_num);
+  ASSERT_FALSE(chunk1.has_select());
+  // 列数据直接引用页面，chunk 持有页面的 pin
+  ASSERT_GE(chunk1.column(0).data(), frame->data());
+  ASSERT_LT(chunk1.column(0).data(), frame->data() + BP_PAGE_DATA_SIZE);
+  ASSERT_EQ(frame->pin_count(), pin_count + 1);
   for (int i = 0; i < record_num; i++) {
     int   int_val   = i + int_base;
     float float_val = i + float_base;
@@ -316,12 +649,20 @@ TEST_P(PaxPageHandlerTestWithParam, DISABLED_PaxPageHandler)
 
   // get chunk
   chunk1.reset_data();
-  record_page_handle->get_chunk(chunk1);
-  ASSERT_EQ(chunk1.rows(), record_num - delete_num);
+  rc = record_page_handle->get_chunk(chunk1);
+  if (delete_num == record_num) {
+    ASSERT_EQ(rc, RC::RECORD_EOF);
+  } else {
+    ASSERT_EQ(rc, RC::SUCCESS);
+    ASSERT_EQ(chunk1.selected_rows(), record_num - delete_num);
+  }
 
   int col1_expected = (int_base + 0 + int_base + record_num - 1) * record_num / 2;
   int col1_actual   = 0;
   for (int i = 0; i < chunk1.rows(); i++) {
+    if (chunk1.has_select() && chunk1.select()[i] == 0) {
+      continue;
+    }
     col1_actual += chunk1.get_value(0, i).get_int();
   }
   for (auto it = delete_slots.begin(); it != delete_slots.end(); ++it) {
@@ -334,6 +675,10 @@ TEST_P(PaxPageHandlerTestWithParam, DISABLED_PaxPageHandler)
     ASSERT_EQ(record_page_handle->get_record(get_rid, record), RC::RECORD_NOT_EXIST);
   }
 
+  // chunk 直接引用了页面数据，页面关闭之前需要释放
+  chunk1.reset();
+  chunk2.reset();
+  ASSERT_EQ(frame->pin_count(), pin_count);
   rc = record_page_handle->cleanup();
   ASSERT_EQ(rc, RC::SUCCESS);
   delete record_page_handle;
@@ -344,7 +689,7 @@ TEST_P(PaxPageHandlerTestWithParam, DISABLED_PaxPageHandler)
 INSTANTIATE_TEST_SUITE_P(
     PaxFileScannerTests, PaxRecordFileScannerWithParam, testing::Values(1, 10, 100, 1000, 2000, 10000));
 
-INSTANTIATE_TEST_SUITE_P(PaxPageTests, PaxPageHandlerTestWithParam, testing::Values(1, 10, 100, 337));
+INSTANTIATE_TEST_SUITE_P(PaxPageTests, PaxPageHandlerTestWithParam, testing::Values(1, 10, 100, 333));
 
 int main(int argc, char **argv)
 {
@@ -0,0 +1,114 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <sstream>
+
+#define protected public
+#define private public
+#include "storage/table/table.h"
+#undef protected
+#undef private
+
+#include "sql/expr/expression.h"
+#include "sql/operator/project_logical_operator.h"
+#include "sql/operator/table_get_logical_operator.h"
+#include "sql/optimizer/projection_pushdown.h"
+#include "gtest/gtest.h"
+
+using namespace std;
+
+static void init_table(Table &table)
+{
+  vector<FieldMeta> &fields = table.table_meta_.fields_;
+  fields.resize(4);
+  fields[0].init("a", AttrType::INTS, 0, 4, true, 0);
+  fields[1].init("b", AttrType::CHARS, 4, 8, true, 1);
+  fields[2].init("c", AttrType::INTS, 12, 4, true, 2);
+  fields[3].init("d", AttrType::CHARS, 16, 2, true, 3);
+}
+
+static unique_ptr<LogicalOperator> make_plan(
+    Table &table, ReadWriteMode mode, vector<unique_ptr<Expression>> &&project_exprs, unique_ptr<Expression> predicate)
+{
+  auto table_get_oper = make_unique<TableGetLogicalOperator>(&table, mode);
+  if (predicate) {
+    vector<unique_ptr<Expression>> predicates;
+    predicates.push_back(std::move(predicate));
+    table_get_oper->set_predicates(std::move(predicates));
+  }
+
+  unique_ptr<LogicalOperator> project_oper = make_unique<ProjectLogicalOperator>(std::move(project_exprs));
+  project_oper->add_child(std::move(table_get_oper));
+  return project_oper;
+}
+
+static TableGetLogicalOperator &table_get(unique_ptr<LogicalOperator> &plan)
+{
+  return static_cast<TableGetLogicalOperator &>(*plan->children().front());
+}
+
+TEST(ProjectionPushdown, referenced_fields)
+{
+  Table table;
+  init_table(table);
+
+  // select c, a from t where c > 1
+  vector<unique_ptr<Expression>> project_exprs;
+  project_exprs.push_back(make_unique<FieldExpr>(&table, table.table_meta().field(2)));
+  project_exprs.push_back(make_unique<FieldExpr>(&table, table.table_meta().field(0)));
+  auto predicate = make_unique<ComparisonExpr>(CompOp::GREAT_THAN,
+      make_unique<FieldExpr>(&table, table.table_meta().field(2)),
+      make_unique<ValueExpr>(Value(1)));
+
+  unique_ptr<LogicalOperator> plan =
+      make_plan(table, ReadWriteMode::READ_ONLY, std::move(project_exprs), std::move(predicate));
+
+  ProjectionPushdown projection_pushdown;
+  ASSERT_EQ(RC::SUCCESS, projection_pushdown.optimize(*plan));
+  ASSERT_EQ(table_get(plan).projection(), vector<int>({0, 2}));
+}
+
+TEST(ProjectionPushdown, no_field)
+{
+  Table table;
+  init_table(table);
+
+  // select 1 from t: 仍然需要读取一个最短的列来得到行数
+  vector<unique_ptr<Expression>> project_exprs;
+  project_exprs.push_back(make_unique<ValueExpr>(Value(1)));
+
+  unique_ptr<LogicalOperator> plan = make_plan(table, ReadWriteMode::READ_ONLY, std::move(project_exprs), nullptr);
+
+  ProjectionPushdown projection_pushdown;
+  ASSERT_EQ(RC::SUCCESS, projection_pushdown.optimize(*plan));
+  ASSERT_EQ(table_get(plan).projection(), vector<int>({3}));
+}
+
+TEST(ProjectionPushdown, read_write)
+{
+  Table table;
+  init_table(table);
+
+  // 修改数据时需要完整的记录，不做投影下推
+  vector<unique_ptr<Expression>> project_exprs;
+  project_exprs.push_back(make_unique<FieldExpr>(&table, table.table_meta().field(1)));
+
+  unique_ptr<LogicalOperator> plan = make_plan(table, ReadWriteMode::READ_WRITE, std::move(project_exprs), nullptr);
+
+  ProjectionPushdown projection_pushdown;
+  ASSERT_EQ(RC::SUCCESS, projection_pushdown.optimize(*plan));
+  ASSERT_TRUE(table_get(plan).projection().empty());
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
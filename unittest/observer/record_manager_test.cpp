@@ -15,6 +15,7 @@ See the Mulan PSL v2 for more details. */
 #include <string.h>
 #include <sstream>
 #include <filesystem>
+#include <map>
 #include <utility>
 
 #include "storage/buffer/disk_buffer_pool.h"
@@ -26,6 +27,8 @@ See the Mulan PSL v2 for more details. */
 #include "common/math/integer_generator.h"
 #include "common/thread/thread_pool_executor.h"
 #include "storage/clog/integrated_log_replayer.h"
+#include "storage/table/table_meta.h"
+#include "json/json.h"
 #include "gtest/gtest.h"
 
 using namespace std;
@@ -122,6 +125,18 @@ TEST(RecordPageHandler, test_record_page_handler)
   delete record_page_handle;
 }
 
+TEST(RecordPageHandler, page_header_layout)
+{
+  // ROW 和 PAX 格式的页面布局不能变，否则已有的数据文件无法读取
+  ASSERT_EQ(28, static_cast<int>(sizeof(PageHeader)));
+  ASSERT_EQ(static_cast<int>(sizeof(PageHeader)), RecordPageHandler::page_header_size(StorageFormat::ROW_FORMAT));
+  ASSERT_EQ(static_cast<int>(sizeof(PageHeader)), RecordPageHandler::page_header_size(StorageFormat::PAX_FORMAT));
+  ASSERT_EQ(static_cast<int>(sizeof(PageHeader) + sizeof(PageHeaderExtension)),
+      RecordPageHandler::page_header_size(StorageFormat::PAX_COMPRESSED_FORMAT));
+  ASSERT_EQ(static_cast<int>(sizeof(PageHeader) + sizeof(PageHeaderExtension)),
+      RecordPageHandler::page_header_size(StorageFormat::SLOTTED_FORMAT));
+}
+
 TEST(RecordFileScanner, test_record_file_iterator)
 {
   VacuousLogHandler log_handler;
@@ -204,6 +219,207 @@ TEST(RecordFileScanner, test_record_file_iterator)
   delete bpm;
 }
 
+TEST(RecordManager, free_space_map)
+{
+  VacuousLogHandler log_handler;
+
+  const char *record_manager_file = "record_manager_fsm.bp";
+  filesystem::remove(record_manager_file);
+
+  BufferPoolManager bpm;
+  ASSERT_EQ(RC::SUCCESS, bpm.init(make_unique<VacuousDoubleWriteBuffer>()));
+  DiskBufferPool *bp = nullptr;
+  ASSERT_EQ(RC::SUCCESS, bpm.create_file(record_manager_file));
+  ASSERT_EQ(RC::SUCCESS, bpm.open_file(log_handler, record_manager_file, bp));
+
+  auto file_handler = make_unique<RecordFileHandler>(StorageFormat::ROW_FORMAT);
+  ASSERT_EQ(RC::SUCCESS, file_handler->init(*bp, log_handler, nullptr));
+
+  const int        record_size = 100;
+  char             record_data[record_size];
+  const int        record_insert_num = 1000;
+  std::vector<RID> rids;
+  for (int i = 0; i < record_insert_num; i++) {
+    RID rid;
+    ASSERT_EQ(RC::SUCCESS, file_handler->insert_record(record_data, record_size, &rid));
+    ASSERT_FALSE(FreeSpaceMap::is_map_page(rid.page_num));
+    rids.push_back(rid);
+  }
+
+  // 第一个页面是映射页面，数据从第二个页面开始
+  ASSERT_EQ(1, file_handler->free_space_map().map_num());
+  ASSERT_EQ(2, rids.front().page_num);
+  const PageNum first_page = rids.front().page_num;
+  const PageNum last_page  = rids.back().page_num;
+  ASSERT_GT(last_page, first_page);
+
+  int level = -1;
+  ASSERT_EQ(RC::SUCCESS, file_handler->free_space_map().get(first_page, level));
+  ASSERT_EQ(0, level);
+  ASSERT_EQ(RC::SUCCESS, file_handler->free_space_map().get(last_page, level));
+  ASSERT_GT(level, 0);
+
+  // 删除第一个页面上所有的记录
+  int deleted_num = 0;
+  for (const RID &rid : rids) {
+    if (rid.page_num == first_page) {
+      ASSERT_EQ(RC::SUCCESS, file_handler->delete_record(&rid));
+      deleted_num++;
+    }
+  }
+  ASSERT_EQ(RC::SUCCESS, file_handler->free_space_map().get(first_page, level));
+  ASSERT_EQ(FreeSpaceMap::LEVEL_NUM - 1, level);
+
+  // 重新打开后不需要遍历页面，直接从映射中找到删除过记录的页面
+  file_handler->close();
+  file_handler = make_unique<RecordFileHandler>(StorageFormat::ROW_FORMAT);
+  ASSERT_EQ(RC::SUCCESS, file_handler->init(*bp, log_handler, nullptr));
+  for (int i = 0; i < deleted_num; i++) {
+    RID rid;
+    ASSERT_EQ(RC::SUCCESS, file_handler->insert_record(record_data, record_size, &rid));
+    ASSERT_EQ(first_page, rid.page_num);
+  }
+  ASSERT_EQ(RC::SUCCESS, file_handler->free_space_map().get(first_page, level));
+  ASSERT_EQ(0, level);
+
+  // 扫描时跳过映射页面
+  VacuousTrx        trx;
+  RecordFileScanner file_scanner;
+  ASSERT_EQ(RC::SUCCESS,
+      file_scanner.open_scan(
+          nullptr /*table*/, *bp, &trx, log_handler, ReadWriteMode::READ_ONLY, nullptr /*condition_filter*/));
+  int    count = 0;
+  RC     rc    = RC::SUCCESS;
+  Record record;
+  while (OB_SUCC(rc = file_scanner.next(record))) {
+    ASSERT_FALSE(FreeSpaceMap::is_map_page(record.rid().page_num));
+    count++;
+  }
+  ASSERT_EQ(RC::RECORD_EOF, rc);
+  file_scanner.close_scan();
+  ASSERT_EQ(record_insert_num, count);
+
+  file_handler.reset();
+  bpm.close_file(record_manager_file);
+}
+
+TEST(RecordManager, pre_free_space_map_file)
+{
+  /*
+   * 之前版本创建的数据文件没有映射页面，第1个页面以及之后映射页面的位置上存放的是记录。
+   * 元数据中没有 free_space_map 字段时只在内存中维护空闲空间，插入记录不能覆盖这些页面
+   */
+  VacuousLogHandler log_handler;
+
+  const char *record_manager_file = "record_manager_pre_fsm.bp";
+  filesystem::remove(record_manager_file);
+
+  BufferPoolManager bpm;
+  ASSERT_EQ(RC::SUCCESS, bpm.init(make_unique<VacuousDoubleWriteBuffer>()));
+  DiskBufferPool *bp = nullptr;
+  ASSERT_EQ(RC::SUCCESS, bpm.create_file(record_manager_file));
+  ASSERT_EQ(RC::SUCCESS, bpm.open_file(log_handler, record_manager_file, bp));
+
+  vector<AttrInfoSqlNode> attributes = {{AttrType::INTS, "id", 4, false}, {AttrType::CHARS, "name", 96, false}};
+  TableMeta               table_meta;
+  ASSERT_EQ(RC::SUCCESS, table_meta.init(1, "pre_fsm", nullptr, attributes, StorageFormat::ROW_FORMAT));
+  ASSERT_TRUE(table_meta.free_space_map());
+  const int record_size = table_meta.record_size();
+  const int id_offset   = table_meta.field("id")->offset();
+
+  // 元数据中去掉 free_space_map 字段，模拟之前版本的元数据
+  stringstream meta_stream;
+  table_meta.serialize(meta_stream);
+  Json::Value             meta_value;
+  Json::CharReaderBuilder reader_builder;
+  string                  errors;
+  ASSERT_TRUE(Json::parseFromStream(reader_builder, meta_stream, &meta_value, &errors));
+  ASSERT_TRUE(meta_value.isMember("free_space_map"));
+  meta_value.removeMember("free_space_map");
+  stringstream old_meta_stream(Json::writeString(Json::StreamWriterBuilder(), meta_value));
+  TableMeta    old_table_meta;
+  ASSERT_GT(old_table_meta.deserialize(old_meta_stream), 0);
+  ASSERT_FALSE(old_table_meta.free_space_map());
+
+  // 按照之前版本的方式写入数据：页面从1开始分配，第1个页面写满，第2个页面写一部分
+  map<int, RID> old_records;
+  string        record(record_size, '\0');
+  int           id = 0;
+  for (int page_index = 0; page_index < 2; page_index++) {
+    Frame *frame = nullptr;
+    ASSERT_EQ(RC::SUCCESS, bp->allocate_page(&frame));
+    ASSERT_EQ(page_index + 1, frame->page_num());
+
+    RowRecordPageHandler page_handler;
+    ASSERT_EQ(RC::SUCCESS,
+        page_handler.init_empty_page(*bp, log_handler, frame->page_num(), record_size, &old_table_meta));
+    frame->unpin();
+    const int page_limit = page_index == 0 ? INT32_MAX : id + 10;
+    while (!page_handler.is_full() && id < page_limit) {
+      memcpy(record.data() + id_offset, &id, sizeof(id));
+      RID rid;
+      ASSERT_EQ(RC::SUCCESS, page_handler.insert_record(record.data(), &rid));
+      old_records[id++] = rid;
+    }
+    page_handler.cleanup();
+  }
+  ASSERT_EQ(1, old_records.begin()->second.page_num);
+
+  auto check_old_records = [&](RecordFileHandler &file_handler) {
+    for (const auto &[record_id, rid] : old_records) {
+      Record old_record;
+      ASSERT_EQ(RC::SUCCESS, file_handler.get_record(rid, old_record));
+      ASSERT_EQ(record_id, *reinterpret_cast<const int *>(old_record.data() + id_offset));
+    }
+  };
+
+  // 当作有映射页面的文件打开时，不能把第1个页面当作没有初始化的映射页面覆盖
+  {
+    RecordFileHandler file_handler(StorageFormat::ROW_FORMAT);
+    ASSERT_EQ(RC::SUCCESS, file_handler.init(*bp, log_handler, &table_meta));
+    RID rid;
+    ASSERT_NE(RC::SUCCESS, file_handler.insert_record(record.data(), record_size, &rid));
+    check_old_records(file_handler);
+  }
+
+  // 根据元数据使用内存中的空闲空间映射，先填满第2个页面，再分配新的页面
+  RecordFileHandler file_handler(StorageFormat::ROW_FORMAT);
+  ASSERT_EQ(RC::SUCCESS, file_handler.init(*bp, log_handler, &old_table_meta));
+  ASSERT_FALSE(file_handler.free_space_map().persistent());
+  const int new_record_num = 200;
+  for (int i = 0; i < new_record_num; i++) {
+    const int new_id = id + i;
+    memcpy(record.data() + id_offset, &new_id, sizeof(new_id));
+    RID rid;
+    ASSERT_EQ(RC::SUCCESS, file_handler.insert_record(record.data(), record_size, &rid));
+    ASSERT_NE(1, rid.page_num);
+    if (i == 0) {
+      ASSERT_EQ(2, rid.page_num);
+    }
+  }
+  ASSERT_EQ(0, file_handler.free_space_map().map_num());
+  check_old_records(file_handler);
+
+  // 第1个页面删除记录之后可以再插入
+  const RID first_rid = old_records.begin()->second;
+  ASSERT_EQ(RC::SUCCESS, file_handler.delete_record(&first_rid));
+  old_records.erase(old_records.begin());
+  int level = 0;
+  ASSERT_EQ(RC::SUCCESS, file_handler.free_space_map().get(first_rid.page_num, level));
+  ASSERT_GT(level, 0);
+
+  RID rid(BP_INVALID_PAGE_NUM, -1);
+  for (int i = 0; i < new_record_num && rid.page_num != first_rid.page_num; i++) {
+    ASSERT_EQ(RC::SUCCESS, file_handler.insert_record(record.data(), record_size, &rid));
+  }
+  ASSERT_EQ(first_rid.page_num, rid.page_num);
+  check_old_records(file_handler);
+
+  file_handler.close();
+  bpm.close_file(record_manager_file);
+  filesystem::remove(record_manager_file);
+}
+
 TEST(RecordManager, durability)
 {
   /*
@@ -355,6 +571,417 @@ TEST(RecordManager, durability)
   bpm2.close_file(record_manager_file.c_str());
 }
 
+TEST(RecordManager, insert_records)
+{
+  /*
+   * 测试场景：
+   * 1. 批量插入记录，检查记录的位置和内容
+   * 2. 重启数据库，检查批量插入的日志可以恢复记录
+   */
+  filesystem::path directory("record_manager_insert_records");
+  filesystem::remove_all(directory);
+  ASSERT_TRUE(filesystem::create_directories(directory));
+
+  filesystem::path record_manager_file = directory / "record_manager.bp";
+
+  BufferPoolManager bpm;
+  ASSERT_EQ(bpm.init(make_unique<VacuousDoubleWriteBuffer>()), RC::SUCCESS);
+
+  DiskLogHandler        log_handler;
+  IntegratedLogReplayer log_replayer(bpm);
+  ASSERT_EQ(log_handler.init(directory.c_str()), RC::SUCCESS);
+  ASSERT_EQ(log_handler.replay(log_replayer, 0), RC::SUCCESS);
+  ASSERT_EQ(log_handler.start(), RC::SUCCESS);
+
+  DiskBufferPool *buffer_pool = nullptr;
+  ASSERT_EQ(bpm.create_file(record_manager_file.c_str()), RC::SUCCESS);
+  ASSERT_EQ(bpm.open_file(log_handler, record_manager_file.c_str(), buffer_pool), RC::SUCCESS);
+
+  RecordFileHandler record_file_handler(StorageFormat::ROW_FORMAT);
+  ASSERT_EQ(record_file_handler.init(*buffer_pool, log_handler, nullptr), RC::SUCCESS);
+
+  const int            record_size = 100;
+  const int            record_num  = 1000;
+  vector<string>       records;
+  vector<const char *> record_datas;
+  for (int i = 0; i < record_num; i++) {
+    string record = "record " + to_string(i);
+    record.resize(record_size);
+    records.push_back(std::move(record));
+  }
+  for (const string &record : records) {
+    record_datas.push_back(record.data());
+  }
+
+  // 先插入一条记录，批量插入时要先填满已有的页面
+  RID first_rid;
+  ASSERT_EQ(RC::SUCCESS, record_file_handler.insert_record(records[0].data(), record_size, &first_rid));
+
+  vector<RID> rids(record_num);
+  int         inserted = 0;
+  ASSERT_EQ(RC::SUCCESS, record_file_handler.insert_records(record_datas, record_size, rids.data(), inserted));
+  ASSERT_EQ(record_num, inserted);
+  ASSERT_EQ(first_rid.page_num, rids[0].page_num);
+  for (int i = 1; i < record_num; i++) {
+    ASSERT_FALSE(rids[i] == rids[i - 1]);
+    ASSERT_GE(rids[i].page_num, rids[i - 1].page_num);
+  }
+  ASSERT_GT(rids.back().page_num, rids.front().page_num);
+
+  for (int i = 0; i < record_num; i++) {
+    Record record;
+    ASSERT_EQ(RC::SUCCESS, record_file_handler.get_record(rids[i], record));
+    ASSERT_EQ(0, memcmp(record.data(), records[i].data(), record_size));
+  }
+
+  // 把文件复制出来再删掉，只依赖日志恢复
+  filesystem::path record_manager_file_copy = directory / "record_manager_copy.bp";
+  filesystem::copy_file(record_manager_file, record_manager_file_copy);
+  record_file_handler.close();
+  bpm.close_file(record_manager_file.c_str());
+  filesystem::remove(record_manager_file);
+  ASSERT_EQ(log_handler.stop(), RC::SUCCESS);
+  ASSERT_EQ(log_handler.await_termination(), RC::SUCCESS);
+
+  DiskLogHandler    log_handler2;
+  BufferPoolManager bpm2;
+  ASSERT_EQ(RC::SUCCESS, bpm2.init(make_unique<VacuousDoubleWriteBuffer>()));
+  DiskBufferPool *buffer_pool2 = nullptr;
+  filesystem::copy(record_manager_file_copy, record_manager_file);
+  ASSERT_EQ(bpm2.open_file(log_handler2, record_manager_file.c_str(), buffer_pool2), RC::SUCCESS);
+
+  IntegratedLogReplayer log_replayer2(bpm2);
+  ASSERT_EQ(log_handler2.init(directory.c_str()), RC::SUCCESS);
+  ASSERT_EQ(log_handler2.replay(log_replayer2, 0), RC::SUCCESS);
+  ASSERT_EQ(log_handler2.start(), RC::SUCCESS);
+
+  RecordFileHandler record_file_handler2(StorageFormat::ROW_FORMAT);
+  ASSERT_EQ(record_file_handler2.init(*buffer_pool2, log_handler2, nullptr), RC::SUCCESS);
+  for (int i = 0; i < record_num; i++) {
+    Record record;
+    ASSERT_EQ(RC::SUCCESS, record_file_handler2.get_record(rids[i], record));
+    ASSERT_EQ(0, memcmp(record.data(), records[i].data(), record_size));
+  }
+
+  record_file_handler2.close();
+  ASSERT_EQ(log_handler2.stop(), RC::SUCCESS);
+  ASSERT_EQ(log_handler2.await_termination(), RC::SUCCESS);
+  bpm2.close_file(record_manager_file.c_str());
+}
+
+TEST(RecordManager, compact)
+{
+  /*
+   * 测试场景：
+   * 1. 批量删除大部分记录，留下很多稀疏的页面
+   * 2. 整理文件，剩下的记录移动到前面的页面中，空的页面归还给 buffer pool
+   * 3. 重启数据库，检查移动记录和释放页面的日志可以恢复
+   */
+  filesystem::path directory("record_manager_compact");
+  filesystem::remove_all(directory);
+  ASSERT_TRUE(filesystem::create_directories(directory));
+
+  filesystem::path record_manager_file = directory / "record_manager.bp";
+
+  BufferPoolManager bpm;
+  ASSERT_EQ(bpm.init(make_unique<VacuousDoubleWriteBuffer>()), RC::SUCCESS);
+
+  DiskLogHandler        log_handler;
+  IntegratedLogReplayer log_replayer(bpm);
+  ASSERT_EQ(log_handler.init(directory.c_str()), RC::SUCCESS);
+  ASSERT_EQ(log_handler.replay(log_replayer, 0), RC::SUCCESS);
+  ASSERT_EQ(log_handler.start(), RC::SUCCESS);
+
+  DiskBufferPool *buffer_pool = nullptr;
+  ASSERT_EQ(bpm.create_file(record_manager_file.c_str()), RC::SUCCESS);
+  ASSERT_EQ(bpm.open_file(log_handler, record_manager_file.c_str(), buffer_pool), RC::SUCCESS);
+
+  RecordFileHandler record_file_handler(StorageFormat::ROW_FORMAT);
+  ASSERT_EQ(record_file_handler.init(*buffer_pool, log_handler, nullptr), RC::SUCCESS);
+
+  auto allocated_pages = [](DiskBufferPool &bp) {
+    BufferPoolIterator iterator;
+    EXPECT_EQ(RC::SUCCESS, iterator.init(bp, 0));
+    int count = 0;
+    for (; iterator.has_next(); iterator.next()) {
+      count++;
+    }
+    return count;
+  };
+
+  const int            record_size = 100;
+  const int            record_num  = 2000;
+  vector<string>       records;
+  vector<const char *> record_datas;
+  for (int i = 0; i < record_num; i++) {
+    string record = "record " + to_string(i);
+    record.resize(record_size);
+    records.push_back(std::move(record));
+  }
+  for (const string &record : records) {
+    record_datas.push_back(record.data());
+  }
+
+  vector<RID> rids(record_num);
+  int         inserted = 0;
+  ASSERT_EQ(RC::SUCCESS, record_file_handler.insert_records(record_datas, record_size, rids.data(), inserted));
+  ASSERT_EQ(record_num, inserted);
+
+  // 每10条记录只保留1条
+  vector<RID>   deleted_rids;
+  map<int, RID> kept_rids;
+  for (int i = 0; i < record_num; i++) {
+    if (i % 10 == 0) {
+      kept_rids[i] = rids[i];
+    } else {
+      deleted_rids.push_back(rids[i]);
+    }
+  }
+  ASSERT_EQ(RC::SUCCESS, record_file_handler.delete_records(deleted_rids));
+  for (const RID &rid : deleted_rids) {
+    Record record;
+    ASSERT_NE(RC::SUCCESS, record_file_handler.get_record(rid, record));
+  }
+
+  const int pages_before = allocated_pages(*buffer_pool);
+
+  map<string, RID> moved_rids;
+  auto on_move = [&](const Record &record, const RID &new_rid) {
+    EXPECT_FALSE(record.rid() == new_rid);
+    EXPECT_LT(new_rid.page_num, record.rid().page_num);
+    moved_rids[record.rid().to_string()] = new_rid;
+    return RC::SUCCESS;
+  };
+  int freed_pages = 0;
+  ASSERT_EQ(RC::SUCCESS, record_file_handler.compact(on_move, freed_pages));
+  ASSERT_GT(freed_pages, 0);
+  ASSERT_FALSE(moved_rids.empty());
+  ASSERT_EQ(pages_before - freed_pages, allocated_pages(*buffer_pool));
+
+  for (auto &[index, rid] : kept_rids) {
+    auto iter = moved_rids.find(rid.to_string());
+    if (iter != moved_rids.end()) {
+      rid = iter->second;
+    }
+  }
+
+  auto check_records = [&](RecordFileHandler &handler) {
+    for (const auto &[index, rid] : kept_rids) {
+      Record record;
+      ASSERT_EQ(RC::SUCCESS, handler.get_record(rid, record));
+      ASSERT_EQ(0, memcmp(record.data(), records[index].data(), record_size));
+    }
+  };
+  check_records(record_file_handler);
+
+  // 释放的页面可以重新分配
+  RID new_rid;
+  ASSERT_EQ(RC::SUCCESS, record_file_handler.insert_record(records[1].data(), record_size, &new_rid));
+  kept_rids[1] = new_rid;
+  check_records(record_file_handler);
+  const int pages_after = allocated_pages(*buffer_pool);
+
+  // 把文件复制出来再删掉，只依赖日志恢复
+  filesystem::path record_manager_file_copy = directory / "record_manager_copy.bp";
+  filesystem::copy_file(record_manager_file, record_manager_file_copy);
+  record_file_handler.close();
+  bpm.close_file(record_manager_file.c_str());
+  filesystem::remove(record_manager_file);
+  ASSERT_EQ(log_handler.stop(), RC::SUCCESS);
+  ASSERT_EQ(log_handler.await_termination(), RC::SUCCESS);
+
+  DiskLogHandler    log_handler2;
+  BufferPoolManager bpm2;
+  ASSERT_EQ(RC::SUCCESS, bpm2.init(make_unique<VacuousDoubleWriteBuffer>()));
+  DiskBufferPool *buffer_pool2 = nullptr;
+  filesystem::copy(record_manager_file_copy, record_manager_file);
+  ASSERT_EQ(bpm2.open_file(log_handler2, record_manager_file.c_str(), buffer_pool2), RC::SUCCESS);
+
+  IntegratedLogReplayer log_replayer2(bpm2);
+  ASSERT_EQ(log_handler2.init(directory.c_str()), RC::SUCCESS);
+  ASSERT_EQ(log_handler2.replay(log_replayer2, 0), RC::SUCCESS);
+  ASSERT_EQ(log_handler2.start(), RC::SUCCESS);
+
+  RecordFileHandler record_file_handler2(StorageFormat::ROW_FORMAT);
+  ASSERT_EQ(record_file_handler2.init(*buffer_pool2, log_handler2, nullptr), RC::SUCCESS);
+  ASSERT_EQ(pages_after, allocated_pages(*buffer_pool2));
+  check_records(record_file_handler2);
+
+  record_file_handler2.close();
+  ASSERT_EQ(log_handler2.stop(), RC::SUCCESS);
+  ASSERT_EQ(log_handler2.await_termination(), RC::SUCCESS);
+  bpm2.close_file(record_manager_file.c_str());
+}
+
+TEST(RecordManager, slotted_records)
+{
+  /*
+   * 测试场景：
+   * 1. SLOTTED 格式中 CHARS 列只占用实际的长度，一个页面可以存放多条很长的定长记录
+   * 2. 很长的记录存放在溢出页面中，更新时可以在页面和溢出页面之间移动，RID 不变
+   * 3. 删除记录后溢出页面可以重新用来存放记录，遍历页面时会跳过溢出页面
+   * 4. 重启数据库，检查日志可以恢复记录
+   */
+  filesystem::path directory("record_manager_slotted_records");
+  filesystem::remove_all(directory);
+  ASSERT_TRUE(filesystem::create_directories(directory));
+
+  filesystem::path record_manager_file = directory / "record_manager.bp";
+
+  BufferPoolManager bpm;
+  ASSERT_EQ(bpm.init(make_unique<VacuousDoubleWriteBuffer>()), RC::SUCCESS);
+
+  DiskLogHandler        log_handler;
+  IntegratedLogReplayer log_replayer(bpm);
+  ASSERT_EQ(log_handler.init(directory.c_str()), RC::SUCCESS);
+  ASSERT_EQ(log_handler.replay(log_replayer, 0), RC::SUCCESS);
+  ASSERT_EQ(log_handler.start(), RC::SUCCESS);
+
+  DiskBufferPool *buffer_pool = nullptr;
+  ASSERT_EQ(bpm.create_file(record_manager_file.c_str()), RC::SUCCESS);
+  ASSERT_EQ(bpm.open_file(log_handler, record_manager_file.c_str(), buffer_pool), RC::SUCCESS);
+
+  vector<AttrInfoSqlNode> attributes = {
+      {AttrType::INTS, "id", 4, false}, {AttrType::CHARS, "name", 200, false}, {AttrType::CHARS, "note", 4000, false}};
+  TableMeta table_meta;
+  ASSERT_EQ(RC::SUCCESS, table_meta.init(1, "slotted", nullptr, attributes, StorageFormat::SLOTTED_FORMAT));
+  const int        record_size = table_meta.record_size();
+  const FieldMeta *id_field    = table_meta.field("id");
+  const FieldMeta *name_field  = table_meta.field("name");
+  const FieldMeta *note_field  = table_meta.field("note");
+
+  auto make_record = [&](int id, const string &note) {
+    string record(record_size, '\0');
+    memcpy(record.data() + id_field->offset(), &id, sizeof(id));
+    string name = "name " + to_string(id);
+    memcpy(record.data() + name_field->offset(), name.data(), name.size());
+    memcpy(record.data() + note_field->offset(), note.data(), note.size());
+    return record;
+  };
+
+  RecordFileHandler record_file_handler(StorageFormat::SLOTTED_FORMAT);
+  ASSERT_EQ(record_file_handler.init(*buffer_pool, log_handler, &table_meta), RC::SUCCESS);
+
+  // 短记录：定长时一个页面只能存放一条
+  const int      record_num = 200;
+  vector<string> records;
+  vector<RID>    rids(record_num);
+  for (int i = 0; i < record_num; i++) {
+    records.push_back(make_record(i, "note " + to_string(i)));
+    ASSERT_EQ(RC::SUCCESS, record_file_handler.insert_record(records[i].data(), record_size, &rids[i]));
+  }
+  ASSERT_LT(rids.back().page_num - rids.front().page_num, 5);
+
+  // 长记录：编码后超过页面的 1/4，存放在溢出页面中
+  records.push_back(make_record(record_num, string(3999, 'x')));
+  rids.emplace_back();
+  ASSERT_EQ(RC::SUCCESS, record_file_handler.insert_record(records.back().data(), record_size, &rids.back()));
+
+  // 在页面和溢出页面之间移动记录
+  auto update_note = [&](int index, const string &note) {
+    records[index] = make_record(index, note);
+    return record_file_handler.visit_record(rids[index], [&](Record &record) {
+      memcpy(record.data(), records[index].data(), record_size);
+      return true;
+    });
+  };
+  ASSERT_EQ(RC::SUCCESS, update_note(1, string(3000, 'y')));
+  ASSERT_EQ(RC::SUCCESS, update_note(2, string(1000, 'z')));
+  ASSERT_EQ(RC::SUCCESS, update_note(3, string(1000, 'z')));
+  ASSERT_EQ(RC::SUCCESS, update_note(record_num, "short again"));
+  ASSERT_EQ(RC::SUCCESS, update_note(1, string(3000, 'w')));
+
+  // 删除的记录的位置可能被后面插入的记录使用
+  auto check_records = [&](RecordFileHandler &handler, bool check_deleted) {
+    for (size_t i = 0; i < records.size(); i++) {
+      if (records[i].empty()) {
+        Record record;
+        if (check_deleted) {
+          ASSERT_NE(RC::SUCCESS, handler.get_record(rids[i], record));
+        }
+        continue;
+      }
+      Record record;
+      ASSERT_EQ(RC::SUCCESS, handler.get_record(rids[i], record));
+      ASSERT_EQ(record_size, record.len());
+      ASSERT_EQ(0, memcmp(record.data(), records[i].data(), record_size));
+    }
+  };
+  check_records(record_file_handler, true);
+
+  // 删除溢出的记录，溢出页面变成空的数据页面
+  ASSERT_EQ(RC::SUCCESS, record_file_handler.delete_record(&rids[1]));
+  records[1].clear();
+  for (int i = 10; i < 20; i++) {
+    ASSERT_EQ(RC::SUCCESS, record_file_handler.delete_record(&rids[i]));
+    records[i].clear();
+  }
+  check_records(record_file_handler, true);
+
+  // 遍历所有的页面，溢出页面中没有记录
+  int                      scanned = 0;
+  SlottedRecordPageHandler page_handler;
+  for (PageNum page_num = 1; page_num < buffer_pool->page_count(); page_num++) {
+    if (FreeSpaceMap::is_map_page(page_num)) {
+      continue;
+    }
+    ASSERT_EQ(RC::SUCCESS, page_handler.init(*buffer_pool, log_handler, page_num, ReadWriteMode::READ_ONLY));
+    RecordPageIterator iterator;
+    iterator.init(&page_handler);
+    Record record;
+    while (iterator.has_next()) {
+      ASSERT_EQ(RC::SUCCESS, iterator.next(record));
+      int id = 0;
+      memcpy(&id, record.data() + id_field->offset(), sizeof(id));
+      ASSERT_LT(id, static_cast<int>(records.size()));
+      ASSERT_EQ(0, memcmp(record.data(), records[id].data(), record_size));
+      scanned++;
+    }
+    page_handler.cleanup();
+  }
+  ASSERT_EQ(static_cast<int>(records.size()) - 11, scanned);
+
+  // 再插入一些记录，它们可以使用释放的溢出页面，不需要分配新的页面
+  const int page_count = buffer_pool->page_count();
+  for (int i = 0; i < 20; i++) {
+    records.push_back(make_record(1000 + i, string(500, 'a' + i)));
+    rids.emplace_back();
+    ASSERT_EQ(RC::SUCCESS, record_file_handler.insert_record(records.back().data(), record_size, &rids.back()));
+  }
+  ASSERT_EQ(page_count, buffer_pool->page_count());
+  check_records(record_file_handler, false);
+
+  // 把文件复制出来，只依赖日志恢复
+  filesystem::path record_manager_file_copy = directory / "record_manager_copy.bp";
+  filesystem::copy_file(record_manager_file, record_manager_file_copy);
+  record_file_handler.close();
+  bpm.close_file(record_manager_file.c_str());
+  filesystem::remove(record_manager_file);
+  ASSERT_EQ(log_handler.stop(), RC::SUCCESS);
+  ASSERT_EQ(log_handler.await_termination(), RC::SUCCESS);
+
+  DiskLogHandler    log_handler2;
+  BufferPoolManager bpm2;
+  ASSERT_EQ(RC::SUCCESS, bpm2.init(make_unique<VacuousDoubleWriteBuffer>()));
+  DiskBufferPool *buffer_pool2 = nullptr;
+  filesystem::copy(record_manager_file_copy, record_manager_file);
+  ASSERT_EQ(bpm2.open_file(log_handler2, record_manager_file.c_str(), buffer_pool2), RC::SUCCESS);
+
+  IntegratedLogReplayer log_replayer2(bpm2);
+  ASSERT_EQ(log_handler2.init(directory.c_str()), RC::SUCCESS);
+  ASSERT_EQ(log_handler2.replay(log_replayer2, 0), RC::SUCCESS);
+  ASSERT_EQ(log_handler2.start(), RC::SUCCESS);
+
+  RecordFileHandler record_file_handler2(StorageFormat::SLOTTED_FORMAT);
+  ASSERT_EQ(record_file_handler2.init(*buffer_pool2, log_handler2, &table_meta), RC::SUCCESS);
+  check_records(record_file_handler2, false);
+
+  record_file_handler2.close();
+  ASSERT_EQ(log_handler2.stop(), RC::SUCCESS);
+  ASSERT_EQ(log_handler2.await_termination(), RC::SUCCESS);
+  bpm2.close_file(record_manager_file.c_str());
+}
+
 int main(int argc, char **argv)
 {
   testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,175 @@
+/* Copyright (c) 2021 OceanBase and/or its affiliates. All rights reserved.
+miniob is licensed under Mulan PSL v2.
+You can use this software according to the terms and conditions of the Mulan PSL v2.
+You may obtain a copy of Mulan PSL v2 at:
+         http://license.coscl.org.cn/MulanPSL2
+THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+See the Mulan PSL v2 for more details. */
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "common/value.h"
+#include "storage/clog/log_handler.h"
+#include "storage/common/meta_util.h"
+#include "storage/db/db.h"
+#include "storage/index/index.h"
+#include "storage/record/record_manager.h"
+#include "storage/table/table.h"
+#include "storage/trx/trx.h"
+
+using namespace std;
+using namespace common;
+
+static const char *TABLE_NAME = "compact_table";
+static const char *INDEX_NAME = "compact_index";
+
+static void create_test_table(Db &db, int record_num, vector<Record> &records)
+{
+  vector<AttrInfoSqlNode> attr_infos(2);
+  for (size_t i = 0; i < attr_infos.size(); i++) {
+    attr_infos[i].name   = string("field_") + to_string(i);
+    attr_infos[i].type   = AttrType::INTS;
+    attr_infos[i].length = 4;
+  }
+  ASSERT_EQ(RC::SUCCESS, db.create_table(TABLE_NAME, attr_infos));
+
+  Table *table = db.find_table(TABLE_NAME);
+  ASSERT_NE(table, nullptr);
+  vector<const FieldMeta *> field_metas{table->table_meta().field("field_0")};
+  ASSERT_EQ(RC::SUCCESS, table->create_index(nullptr, field_metas, {}, INDEX_NAME, 90));
+
+  for (int i = 0; i < record_num; i++) {
+    Value  values[2] = {Value(i), Value(i * 10)};
+    Record record;
+    ASSERT_EQ(RC::SUCCESS, table->make_record(2, values, record));
+    ASSERT_EQ(RC::SUCCESS, table->insert_record(record));
+    records.push_back(std::move(record));
+  }
+}
+
+/**
+ * @brief 索引中的RID与表中所有记录的RID一一对应
+ */
+static void check_index(Table *table)
+{
+  const int field_offset = table->table_meta().field("field_0")->offset();
+
+  vector<pair<PageNum, SlotNum>> record_rids;
+  RecordFileScanner              scanner;
+  ASSERT_EQ(RC::SUCCESS, table->get_record_scanner(scanner, nullptr, ReadWriteMode::READ_ONLY));
+  RC     rc = RC::SUCCESS;
+  Record record;
+  while (OB_SUCC(rc = scanner.next(record))) {
+    record_rids.emplace_back(record.rid().page_num, record.rid().slot_num);
+  }
+  ASSERT_EQ(RC::RECORD_EOF, rc);
+  scanner.close_scan();
+
+  Index *index = table->find_index(INDEX_NAME);
+  ASSERT_NE(index, nullptr);
+  IndexScanner *index_scanner = index->create_scanner(nullptr, 0, true, nullptr, 0, true);
+  ASSERT_NE(index_scanner, nullptr);
+
+  vector<pair<PageNum, SlotNum>> index_rids;
+  RID                            rid;
+  int                            key = 0;
+  while (OB_SUCC(rc = index_scanner->next_entry(&rid, reinterpret_cast<char *>(&key)))) {
+    index_rids.emplace_back(rid.page_num, rid.slot_num);
+
+    // 索引中的键值与记录中的字段相同
+    Record index_record;
+    ASSERT_EQ(RC::SUCCESS, table->get_record(rid, index_record));
+    ASSERT_EQ(key, *reinterpret_cast<const int *>(index_record.data() + field_offset));
+  }
+  ASSERT_EQ(RC::RECORD_EOF, rc);
+  index_scanner->destroy();
+
+  sort(record_rids.begin(), record_rids.end());
+  sort(index_rids.begin(), index_rids.end());
+  ASSERT_EQ(record_rids, index_rids);
+}
+
+TEST(TableCompact, compact_and_recover)
+{
+  filesystem::path test_directory("table_compact_test");
+  filesystem::remove_all(test_directory);
+  filesystem::create_directories(test_directory);
+
+  const char *dbname       = "test_db";
+  const char *trx_kit_name = "mvcc";
+  const char *log_handler  = "disk";
+
+  auto db = make_unique<Db>();
+  ASSERT_EQ(RC::SUCCESS, db->init(dbname, test_directory.c_str(), trx_kit_name, log_handler));
+
+  const int      record_num = 20000;
+  vector<Record> records;
+  create_test_table(*db, record_num, records);
+  Table *table = db->find_table(TABLE_NAME);
+
+  // 只保留少量的记录，大部分页面都是稀疏的
+  vector<Record> deleted;
+  for (int i = 0; i < record_num; i++) {
+    if (i % 50 != 0) {
+      deleted.push_back(std::move(records[i]));
+    }
+  }
+  ASSERT_EQ(RC::SUCCESS, table->delete_records(deleted));
+
+  // 有事务还没有结束时，不能整理
+  Trx *trx = db->trx_kit().create_trx(db->log_handler());
+  ASSERT_EQ(RC::SUCCESS, trx->start_if_need());
+  Value  values[2] = {Value(-1), Value(-1)};
+  Record record;
+  ASSERT_EQ(RC::SUCCESS, table->make_record(2, values, record));
+  ASSERT_EQ(RC::SUCCESS, trx->insert_record(table, record));
+
+  int freed_pages = 0;
+  ASSERT_EQ(RC::LOCKED_CONCURRENCY_CONFLICT, table->compact(freed_pages));
+  ASSERT_EQ(0, freed_pages);
+
+  ASSERT_EQ(RC::SUCCESS, trx->commit());
+  db->trx_kit().destroy_trx(trx);
+
+  ASSERT_EQ(RC::SUCCESS, table->compact(freed_pages));
+  ASSERT_GT(freed_pages, 0);
+  ASSERT_FALSE(filesystem::exists(table_compact_file(test_directory.c_str(), TABLE_NAME)));
+  check_index(table);
+
+  // 模拟整理过程中崩溃：索引中有记录原来的位置，标记文件还在
+  RecordFileScanner scanner;
+  ASSERT_EQ(RC::SUCCESS, table->get_record_scanner(scanner, nullptr, ReadWriteMode::READ_ONLY));
+  ASSERT_EQ(RC::SUCCESS, scanner.next(record));
+  ASSERT_EQ(RC::SUCCESS, record.copy_data(record.data(), record.len()));
+  scanner.close_scan();
+
+  Index *index   = table->find_index(INDEX_NAME);
+  RID    old_rid = record.rid();
+  old_rid.page_num += 1000;
+  ASSERT_EQ(RC::SUCCESS, index->delete_entry(record.data(), &record.rid()));
+  ASSERT_EQ(RC::SUCCESS, index->insert_entry(record.data(), &old_rid));
+  ASSERT_EQ(RC::SUCCESS, db->log_handler().wait_lsn(db->log_handler().current_lsn()));
+  ofstream(table_compact_file(test_directory.c_str(), TABLE_NAME)).close();
+
+  db.reset();
+
+  // 重启之后根据数据重建索引
+  db = make_unique<Db>();
+  ASSERT_EQ(RC::SUCCESS, db->init(dbname, test_directory.c_str(), trx_kit_name, log_handler));
+  table = db->find_table(TABLE_NAME);
+  ASSERT_NE(table, nullptr);
+  ASSERT_FALSE(filesystem::exists(table_compact_file(test_directory.c_str(), TABLE_NAME)));
+  check_index(table);
+
+  db.reset();
+  filesystem::remove_all(test_directory);
+}